@@ -837,6 +837,7 @@ local c_fn_signatures = {
   {"marpa_r_earley_item_warning_threshold"},
   {"marpa_r_earley_item_warning_threshold_set", "int", "too_many_earley_items"},
   {"marpa_r_earley_set_value", "Marpa_Earley_Set_ID", "ordinal"},
+  {"marpa_r_event_count"},
   {"marpa_r_expected_symbol_event_set", "Marpa_Symbol_ID", "xsyid", "int", "value"},
   {"marpa_r_furthest_earleme"},
   {"marpa_r_is_exhausted"},
@@ -900,6 +901,10 @@ local c_fn_signatures = {
   {"_marpa_r_first_token_link_trace"},
   {"_marpa_r_is_use_leo"},
   {"_marpa_r_is_use_leo_set", "int", "value"},
+  {"_marpa_r_is_use_postdot_index"},
+  {"_marpa_r_is_use_postdot_index_set", "int", "value"},
+  {"_marpa_r_is_use_prediction_memo"},
+  {"_marpa_r_is_use_prediction_memo_set", "int", "value"},
   {"_marpa_r_leo_base_origin"},
   {"_marpa_r_leo_base_state"},
   {"_marpa_r_leo_predecessor_symbol"},
@@ -964,7 +969,9 @@ for ix = 1, #c_fn_signatures do
    io.write("{\n");
    io.write("  ", libmarpa_class_type[class_letter], " self;\n");
    io.write("  const int self_stack_ix = 1;\n");
-   io.write("  Marpa_Grammar grammar;\n");
+   if class_letter ~= "r" then
+     io.write("  Marpa_Grammar grammar;\n");
+   end
    for arg_ix = 1, arg_count do
      local arg_type = signature[arg_ix*2]
      local arg_name = signature[1 + arg_ix*2]
@@ -1012,11 +1019,14 @@ for ix = 1, #c_fn_signatures do
    io.write("  lua_pop(L, 1);\n")
    -- stack is [ self ]
 
-   io.write('  lua_getfield (L, -1, "_libmarpa_g");\n')
-   -- stack is [ self, grammar_ud ]
-   io.write("  grammar = *(Marpa_Grammar*)lua_touserdata (L, -1);\n")
-   io.write("  lua_pop(L, 1);\n")
-   -- stack is [ self ]
+   -- recognizer errors are read from the recognizer itself
+   if class_letter ~= "r" then
+     io.write('  lua_getfield (L, -1, "_libmarpa_g");\n')
+     -- stack is [ self, grammar_ud ]
+     io.write("  grammar = *(Marpa_Grammar*)lua_touserdata (L, -1);\n")
+     io.write("  lua_pop(L, 1);\n")
+     -- stack is [ self ]
+   end
 
    -- assumes converting result to int is safe and right thing to do
    -- if that assumption is wrong, generate the wrapper by hand
@@ -1028,7 +1038,11 @@ for ix = 1, #c_fn_signatures do
    io.write("    );\n")
    io.write("  if (result == -1) { lua_pushnil(L); return 1; }\n")
    io.write("  if (result < -1) {\n")
-   io.write("    Marpa_Error_Code marpa_error = marpa_g_error(grammar, NULL);\n")
+   if class_letter == "r" then
+     io.write("    Marpa_Error_Code marpa_error = marpa_r_error(self, NULL);\n")
+   else
+     io.write("    Marpa_Error_Code marpa_error = marpa_g_error(grammar, NULL);\n")
+   end
    io.write("    int throw_flag;\n")
    local wrapper_name_as_c_string = '"' .. wrapper_name .. '()"'
    io.write('    lua_getfield (L, -1, "throw");\n')
@@ -1081,6 +1095,9 @@ common_g_error_handler (lua_State * L,
    error, if so desired.
    The error may not be thrown, and it expects the
    caller to handle any non-thrown error.
+   The error is read from the recognizer.
+   If there is no recognizer, because marpa_r_new()
+   failed, it is read from the grammar.
 */
 static void
 common_r_error_handler (lua_State * L,
@@ -1088,12 +1105,24 @@ common_r_error_handler (lua_State * L,
 {
   int throw_flag;
   Marpa_Error_Code marpa_error;
-  Marpa_Grammar *grammar_ud;
-  lua_getfield (L, recce_stack_ix, "_libmarpa_g");
-  /* [ ..., grammar_ud ] */
-  grammar_ud = (Marpa_Grammar *) lua_touserdata (L, -1);
+  Marpa_Recognizer *recce_ud;
+  lua_getfield (L, recce_stack_ix, "_libmarpa");
+  /* [ ..., recce_ud ] */
+  recce_ud = (Marpa_Recognizer *) lua_touserdata (L, -1);
   lua_pop(L, 1);
-  marpa_error = marpa_g_error (*grammar_ud, NULL);
+  if (recce_ud && *recce_ud)
+    {
+      marpa_error = marpa_r_error (*recce_ud, NULL);
+    }
+  else
+    {
+      Marpa_Grammar *grammar_ud;
+      lua_getfield (L, recce_stack_ix, "_libmarpa_g");
+      /* [ ..., grammar_ud ] */
+      grammar_ud = (Marpa_Grammar *) lua_touserdata (L, -1);
+      lua_pop(L, 1);
+      marpa_error = marpa_g_error (*grammar_ud, NULL);
+    }
   lua_getfield (L, recce_stack_ix, "throw");
   /* [ ..., throw_flag ] */
   throw_flag = lua_toboolean (L, -1);
@@ -1482,6 +1511,101 @@ static int wrap_grammar_rule_new(lua_State *L)
     return 1;
 }
 
+/* Returns a snapshot of a precomputed grammar,
+ * as a Lua string.
+ */
+static int wrap_grammar_serialize(lua_State *L)
+{
+  /* [ grammar_object ] */
+  const int grammar_stack_ix = 1;
+  Marpa_Grammar *p_g;
+  int size;
+  luaL_Buffer buffer;
+  char *snapshot;
+
+  lua_getfield (L, grammar_stack_ix, "_libmarpa");
+  /* [ grammar_object, grammar_ud ] */
+  p_g = (Marpa_Grammar *) lua_touserdata (L, -1);
+  lua_pop (L, 1);
+  /* [ grammar_object ] */
+  size = marpa_g_serialize (*p_g, NULL, 0);
+  if (size < 0)
+    {
+      common_g_error_handler (L, p_g, grammar_stack_ix,
+			      "marpa_g_serialize()");
+      lua_pushnil (L);
+      return 1;
+    }
+  snapshot = luaL_buffinitsize (L, &buffer, (size_t) size);
+  /* [ grammar_object, buffer ] */
+  if (marpa_g_serialize (*p_g, snapshot, (size_t) size) != size)
+    {
+      common_g_error_handler (L, p_g, grammar_stack_ix,
+			      "marpa_g_serialize()");
+      lua_pushnil (L);
+      return 1;
+    }
+  luaL_pushresultsize (&buffer, (size_t) size);
+  /* [ grammar_object, snapshot ] */
+  return 1;
+}
+
+/* Like wrap_grammar_new(), but the grammar is loaded
+ * from a snapshot, instead of being created empty.
+ * Libmarpa checks the version of the snapshot, so there is
+ * no version checking here.
+ */
+static int
+wrap_grammar_load (lua_State * L)
+{
+  /* [ grammar_table, snapshot ] */
+  const int grammar_stack_ix = 1;
+  const int snapshot_stack_ix = 2;
+  Marpa_Config marpa_config;
+  Marpa_Grammar *p_g;
+  const char *snapshot;
+  size_t snapshot_size;
+
+  check_libmarpa_table (L, "wrap_grammar_load()", grammar_stack_ix,
+			"grammar");
+  /* The snapshot string stays on the stack until Libmarpa
+   * has read it, so that it is not collected.
+   */
+  snapshot = luaL_checklstring (L, snapshot_stack_ix, &snapshot_size);
+  lua_settop (L, snapshot_stack_ix);
+  /* [ grammar_table, snapshot ] */
+  p_g = (Marpa_Grammar *) lua_newuserdata (L, sizeof (Marpa_Grammar));
+  /* [ grammar_table, snapshot, userdata ] */
+  lua_rawgetp (L, LUA_REGISTRYINDEX, &kollos_g_ud_mt_key);
+  lua_setmetatable (L, -2);
+  lua_pushvalue (L, -1);
+  /* [ grammar_table, snapshot, userdata, userdata ] */
+  lua_setfield (L, grammar_stack_ix, "_libmarpa");
+  lua_setfield (L, grammar_stack_ix, "_libmarpa_g");
+  /* [ grammar_table, snapshot ] */
+
+  marpa_c_init (&marpa_config);
+  *p_g = marpa_g_load_mapped (&marpa_config, snapshot, snapshot_size);
+  lua_settop (L, grammar_stack_ix);
+  /* [ grammar_table ] */
+  if (!*p_g)
+    {
+      int throw_flag;
+      Marpa_Error_Code marpa_error = marpa_c_error (&marpa_config, NULL);
+      lua_getfield (L, grammar_stack_ix, "throw");
+      throw_flag = lua_toboolean (L, -1);
+      /* [ grammar_table, throw_flag ] */
+      if (throw_flag)
+	{
+	  kollos_throw (L, marpa_error, "marpa_g_load_mapped()");
+	}
+      lua_pushnil (L);
+      return 1;
+    }
+  /* [ grammar_table ] */
+  return 1;
+}
+
 ]=]
 
 -- recognizer wrappers which need to be hand-written
@@ -1574,6 +1698,186 @@ static int wrap_progress_item(lua_State *L)
   return 3;
 }
 
+/* The C wrapper for Libmarpa recognizer event reading.
+   It assumes we just want all of them.
+ */
+static int wrap_recce_events(lua_State *L)
+{
+  /* [ recce_object ] */
+  const int recce_stack_ix = 1;
+  Marpa_Recce *p_r;
+  int event_count;
+
+  lua_getfield (L, recce_stack_ix, "_libmarpa");
+  /* [ recce_object, recce_ud ] */
+  p_r = (Marpa_Recce *) lua_touserdata (L, -1);
+  event_count = marpa_r_event_count (*p_r);
+  if (event_count < 0)
+    {
+      common_r_error_handler (L, recce_stack_ix,
+			      "marpa_r_event_count()");
+      return 0;
+    }
+  lua_pop (L, 1);
+  /* [ recce_object ] */
+  lua_createtable (L, event_count, 0);
+  /* [ recce_object, result_table ] */
+  {
+    const int result_table_ix = lua_gettop (L);
+    int event_ix;
+    for (event_ix = 0; event_ix < event_count; event_ix++)
+      {
+	Marpa_Event_Type event_type;
+	Marpa_Event event;
+	/* [ recce_object, result_table ] */
+	event_type = marpa_r_event (*p_r, &event, event_ix);
+	if (event_type <= -2)
+	  {
+	    common_r_error_handler (L, recce_stack_ix,
+				    "marpa_r_event()");
+	    return 0;
+	  }
+	lua_pushinteger (L, event_ix*2 + 1);
+	lua_pushinteger (L, event_type);
+	/* [ recce_object, result_table, event_ix*2+1, event_type ] */
+	lua_settable (L, result_table_ix);
+	/* [ recce_object, result_table ] */
+	lua_pushinteger (L, event_ix*2 + 2);
+	lua_pushinteger (L, marpa_g_event_value (&event));
+	/* [ recce_object, result_table, event_ix*2+2, event_value ] */
+	lua_settable (L, result_table_ix);
+	/* [ recce_object, result_table ] */
+      }
+  }
+  /* [ recce_object, result_table ] */
+  return 1;
+}
+
+/* Another C wrapper for Libmarpa recognizer event reading.
+   It assumes we want them one by one.
+ */
+static int wrap_recce_event(lua_State *L)
+{
+  /* [ recce_object ] */
+  const int recce_stack_ix = 1;
+  const int event_ix_stack_ix = 2;
+  Marpa_Recce *p_r;
+  Marpa_Event_Type event_type;
+  Marpa_Event event;
+  const int event_ix = (int)lua_tointeger(L, event_ix_stack_ix)-1;
+
+  lua_getfield (L, recce_stack_ix, "_libmarpa");
+  /* [ recce_object, recce_ud ] */
+  p_r = (Marpa_Recce *) lua_touserdata (L, -1);
+  /* [ recce_object, recce_ud ] */
+  event_type = marpa_r_event (*p_r, &event, event_ix);
+  if (event_type <= -2)
+    {
+      common_r_error_handler (L, recce_stack_ix, "marpa_r_event()");
+      return 0;
+    }
+  lua_pushinteger (L, event_type);
+  lua_pushinteger (L, marpa_g_event_value (&event));
+  /* [ recce_object, recce_ud, event_type, event_value ] */
+  return 2;
+}
+
+/* The C wrapper for the recognizer statistics.
+   Returns them as a table, keyed by field name.
+ */
+static int wrap_recce_stats(lua_State *L)
+{
+  /* [ recce_object ] */
+  const int recce_stack_ix = 1;
+  Marpa_Recce *p_r;
+  Marpa_Memory_Stats stats;
+
+  lua_getfield (L, recce_stack_ix, "_libmarpa");
+  /* [ recce_object, recce_ud ] */
+  p_r = (Marpa_Recce *) lua_touserdata (L, -1);
+  if (marpa_r_memory_stats (*p_r, &stats) < 0)
+    {
+      common_r_error_handler (L, recce_stack_ix, "marpa_r_memory_stats()");
+      return 0;
+    }
+  lua_pop (L, 1);
+  /* [ recce_object ] */
+  lua_createtable (L, 0, 11);
+  /* [ recce_object, result_table ] */
+#define STATS_FIELD(field) \
+  (lua_pushinteger (L, (lua_Integer) stats.t_ ## field), \
+    lua_setfield (L, -2, #field))
+  STATS_FIELD (obstack_bytes);
+  STATS_FIELD (psl_bytes);
+  STATS_FIELD (alternative_bytes);
+  STATS_FIELD (completion_stack_bytes);
+  STATS_FIELD (postdot_array_bytes);
+  STATS_FIELD (earley_item_size);
+  STATS_FIELD (earley_set_count);
+  STATS_FIELD (earley_item_count);
+  STATS_FIELD (leo_item_count);
+  STATS_FIELD (postdot_item_count);
+  STATS_FIELD (source_link_count);
+#undef STATS_FIELD
+  /* [ recce_object, result_table ] */
+  return 1;
+}
+
+/* The C wrapper for reading all the tokens at an earleme
+   in a single call.
+   The tokens are a flat Lua array of triples:
+   symbol id, value and length.
+   Returns the number of tokens accepted.
+ */
+static int wrap_recce_alternatives_read(lua_State *L)
+{
+  /* [ recce_object, token_table, flags ] */
+  const int recce_stack_ix = 1;
+  const int token_table_stack_ix = 2;
+  const int flags_stack_ix = 3;
+  Marpa_Recce *p_r;
+  Marpa_Alternative *alternatives;
+  int alternative_count;
+  int alternative_ix;
+  int accepted_count;
+  const int flags = (int)luaL_optinteger(L, flags_stack_ix, 0);
+
+  luaL_checktype(L, token_table_stack_ix, LUA_TTABLE);
+  alternative_count = (int)lua_rawlen(L, token_table_stack_ix) / 3;
+  /* A userdata, so that the buffer is collected
+   * even if we throw an error
+   */
+  alternatives = (Marpa_Alternative *)
+    lua_newuserdata (L, sizeof (Marpa_Alternative) * (size_t)(alternative_count+1));
+  /* [ recce_object, token_table, flags, buffer_ud ] */
+  for (alternative_ix = 0; alternative_ix < alternative_count; alternative_ix++)
+    {
+      Marpa_Alternative *const alternative = alternatives + alternative_ix;
+      lua_rawgeti (L, token_table_stack_ix, alternative_ix*3 + 1);
+      lua_rawgeti (L, token_table_stack_ix, alternative_ix*3 + 2);
+      lua_rawgeti (L, token_table_stack_ix, alternative_ix*3 + 3);
+      /* [ recce_object, token_table, flags, buffer_ud,
+       *     symbol_id, value, length ] */
+      alternative->t_token_id = (Marpa_Symbol_ID)lua_tointeger (L, -3);
+      alternative->t_value = (int)lua_tointeger (L, -2);
+      alternative->t_length = (int)lua_tointeger (L, -1);
+      lua_pop (L, 3);
+    }
+  lua_getfield (L, recce_stack_ix, "_libmarpa");
+  /* [ recce_object, token_table, flags, buffer_ud, recce_ud ] */
+  p_r = (Marpa_Recce *) lua_touserdata (L, -1);
+  accepted_count =
+    marpa_r_alternatives_read (*p_r, alternatives, alternative_count, flags);
+  if (accepted_count < 0)
+    {
+      common_r_error_handler (L, recce_stack_ix, "marpa_r_alternatives_read()");
+      return 0;
+    }
+  lua_pushinteger (L, (lua_Integer) accepted_count);
+  /* [ recce_object, token_table, flags, buffer_ud, recce_ud, accepted_count ] */
+  return 1;
+}
+
 ]=]
 
 -- bocage wrappers which need to be hand-written
@@ -1652,7 +1956,8 @@ wrap_bocage_new (lua_State * L)
     *bocage_ud = marpa_b_new (*recce_ud, end_earley_set);
     if (!*bocage_ud)
       {
-	common_b_error_handler (L, bocage_stack_ix, "marpa_b_new()");
+	/* libmarpa reports bocage creation errors in the recognizer */
+	common_r_error_handler (L, recce_stack_ix, "marpa_b_new()");
         lua_pushnil (L);
         return 1;
       }
@@ -1854,6 +2159,61 @@ wrap_value_new (lua_State * L)
   return 1;
 }
 
+/* The C wrapper for taking a batch of valuator steps
+   in a single call.
+   Takes up to |max| steps, and returns them as a flat Lua array
+   of 5-tuples: step type, rule or symbol id, arg 0, arg n
+   and token value.
+   When valuation is finished, the array is empty.
+ */
+static int wrap_value_steps(lua_State *L)
+{
+  /* [ value_object, max ] */
+  const int value_stack_ix = 1;
+  const int max_stack_ix = 2;
+  Marpa_Value *p_v;
+  Marpa_Step *steps;
+  int step_count;
+  int step_ix;
+  const int max = (int)luaL_checkinteger(L, max_stack_ix);
+
+  check_libmarpa_table (L, "wrap_value_steps()", value_stack_ix, "value");
+
+  /* A userdata, so that the buffer is collected
+   * even if we throw an error
+   */
+  steps = (Marpa_Step *)
+    lua_newuserdata (L, sizeof (Marpa_Step) * (size_t)(max > 0 ? max : 1));
+  /* [ value_object, max, buffer_ud ] */
+  lua_getfield (L, value_stack_ix, "_libmarpa");
+  /* [ value_object, max, buffer_ud, value_ud ] */
+  p_v = (Marpa_Value *) lua_touserdata (L, -1);
+  step_count = marpa_v_steps (*p_v, steps, max);
+  if (step_count < 0)
+    {
+      common_v_error_handler (L, value_stack_ix, "marpa_v_steps()");
+      return 0;
+    }
+  lua_createtable (L, step_count * 5, 0);
+  /* [ value_object, max, buffer_ud, value_ud, result_table ] */
+  for (step_ix = 0; step_ix < step_count; step_ix++)
+    {
+      const Marpa_Step *const step = steps + step_ix;
+      lua_pushinteger (L, (lua_Integer) step->t_step_type);
+      lua_rawseti (L, -2, step_ix*5 + 1);
+      lua_pushinteger (L, (lua_Integer) step->t_id);
+      lua_rawseti (L, -2, step_ix*5 + 2);
+      lua_pushinteger (L, (lua_Integer) step->t_arg_0);
+      lua_rawseti (L, -2, step_ix*5 + 3);
+      lua_pushinteger (L, (lua_Integer) step->t_arg_n);
+      lua_rawseti (L, -2, step_ix*5 + 4);
+      lua_pushinteger (L, (lua_Integer) step->t_value);
+      lua_rawseti (L, -2, step_ix*5 + 5);
+    }
+  /* [ value_object, max, buffer_ud, value_ud, result_table ] */
+  return 1;
+}
+
 ]=]
 
 
@@ -2017,18 +2377,41 @@ LUALIB_API int luaopen_kollos_c(lua_State *L)
     lua_pushcfunction(L, wrap_grammar_events);
     lua_setfield(L, kollos_table_stack_ix, "grammar_events");
 
+    lua_pushcfunction(L, wrap_grammar_load);
+    lua_setfield(L, kollos_table_stack_ix, "grammar_load");
+
     lua_pushcfunction(L, wrap_grammar_new);
     lua_setfield(L, kollos_table_stack_ix, "grammar_new");
 
     lua_pushcfunction(L, wrap_grammar_rule_new);
     lua_setfield(L, kollos_table_stack_ix, "grammar_rule_new");
 
+    lua_pushcfunction(L, wrap_grammar_serialize);
+    lua_setfield(L, kollos_table_stack_ix, "grammar_serialize");
+
     lua_pushcfunction(L, wrap_recce_new);
     lua_setfield(L, kollos_table_stack_ix, "recce_new");
 
     lua_pushcfunction(L, wrap_progress_item);
     lua_setfield(L, kollos_table_stack_ix, "recce_progress_item");
 
+    lua_pushcfunction(L, wrap_recce_event);
+    lua_setfield(L, kollos_table_stack_ix, "recce_event");
+
+    lua_pushcfunction(L, wrap_recce_events);
+    lua_setfield(L, kollos_table_stack_ix, "recce_events");
+
+    lua_pushcfunction(L, wrap_recce_stats);
+    lua_setfield(L, kollos_table_stack_ix, "recce_stats");
+
+    lua_pushcfunction(L, wrap_recce_alternatives_read);
+    lua_setfield(L, kollos_table_stack_ix, "recce_alternatives_read");
+
+    lua_pushinteger(L, MARPA_READ_COMPLETE_EARLEME);
+    lua_setfield(L, kollos_table_stack_ix, "READ_COMPLETE_EARLEME");
+    lua_pushinteger(L, MARPA_READ_SKIP_UNEXPECTED);
+    lua_setfield(L, kollos_table_stack_ix, "READ_SKIP_UNEXPECTED");
+
     lua_pushcfunction(L, wrap_bocage_new);
     lua_setfield(L, kollos_table_stack_ix, "bocage_new");
 
@@ -2041,6 +2424,18 @@ LUALIB_API int luaopen_kollos_c(lua_State *L)
     lua_pushcfunction(L, wrap_value_new);
     lua_setfield(L, kollos_table_stack_ix, "value_new");
 
+    lua_pushcfunction(L, wrap_value_steps);
+    lua_setfield(L, kollos_table_stack_ix, "value_steps");
+
+    lua_pushinteger(L, MARPA_STEP_RULE);
+    lua_setfield(L, kollos_table_stack_ix, "STEP_RULE");
+    lua_pushinteger(L, MARPA_STEP_TOKEN);
+    lua_setfield(L, kollos_table_stack_ix, "STEP_TOKEN");
+    lua_pushinteger(L, MARPA_STEP_NULLING_SYMBOL);
+    lua_setfield(L, kollos_table_stack_ix, "STEP_NULLING_SYMBOL");
+    lua_pushinteger(L, MARPA_STEP_TRACE);
+    lua_setfield(L, kollos_table_stack_ix, "STEP_TRACE");
+
     lua_newtable (L);
     /* [ kollos, error_code_table ] */
     {
@@ -2087,6 +2482,25 @@ LUALIB_API int luaopen_kollos_c(lua_State *L)
     /* [ kollos, event_code_table ] */
     lua_setfield (L, kollos_table_stack_ix, "event_code_by_name");
 
+    lua_newtable (L);
+    /* [ kollos, step_code_table ] */
+    {
+      const int name_table_stack_ix = lua_gettop (L);
+      lua_pushinteger (L, (lua_Integer) MARPA_STEP_RULE);
+      lua_setfield (L, name_table_stack_ix, "MARPA_STEP_RULE");
+      lua_pushinteger (L, (lua_Integer) MARPA_STEP_TOKEN);
+      lua_setfield (L, name_table_stack_ix, "MARPA_STEP_TOKEN");
+      lua_pushinteger (L, (lua_Integer) MARPA_STEP_NULLING_SYMBOL);
+      lua_setfield (L, name_table_stack_ix, "MARPA_STEP_NULLING_SYMBOL");
+      lua_pushinteger (L, (lua_Integer) MARPA_STEP_TRACE);
+      lua_setfield (L, name_table_stack_ix, "MARPA_STEP_TRACE");
+      lua_pushinteger (L, (lua_Integer) MARPA_STEP_INACTIVE);
+      lua_setfield (L, name_table_stack_ix, "MARPA_STEP_INACTIVE");
+    }
+
+    /* [ kollos, step_code_table ] */
+    lua_setfield (L, kollos_table_stack_ix, "step_code_by_name");
+
 ]=]
 
 -- This code goes through the signatures table again,
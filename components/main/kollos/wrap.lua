@@ -58,6 +58,7 @@ local grammar_class  = {
   ["rule_null_high"] = kollos_c.grammar_rule_null_high,
   ["rule_null_high_set"] = kollos_c.grammar_rule_null_high_set,
   ["rule_rhs"] = kollos_c.grammar_rule_rhs,
+  ["serialize"] = kollos_c.grammar_serialize,
   ["sequence_min"] = kollos_c.grammar_sequence_min,
   ["sequence_separator"] = kollos_c.grammar_sequence_separator,
   ["start_symbol"] = kollos_c.grammar_start_symbol,
@@ -93,7 +94,19 @@ function wrap.grammar()
   return grammar_object
 end
 
+-- Recreate a grammar from a snapshot made by its serialize() method
+function wrap.grammar_load(snapshot)
+  local grammar_object = kollos_c.grammar_load(
+      { _type = "grammar", throw = true }, snapshot
+  )
+  setmetatable(grammar_object, {
+      __index = grammar_class,
+  })
+  return grammar_object
+end
+
 local recce_class  = {
+  ["alternatives_read"] = kollos_c.recce_alternatives_read,
   ["completion_symbol_activate"] = kollos_c.recce_completion_symbol_activate,
   ["current_earleme"] = kollos_c.recce_current_earleme,
   ["earleme_complete"] = kollos_c.recce_earleme_complete,
@@ -101,6 +114,9 @@ local recce_class  = {
   ["earley_item_warning_threshold"] = kollos_c.recce_earley_item_warning_threshold,
   ["earley_item_warning_threshold_set"] = kollos_c.recce_earley_item_warning_threshold_set,
   ["earley_set_value"] = kollos_c.recce_earley_set_value,
+  ["event"] = kollos_c.recce_event,
+  ["events"] = kollos_c.recce_events,
+  ["event_count"] = kollos_c.recce_event_count,
   ["expected_symbol_event_set"] = kollos_c.recce_expected_symbol_event_set,
   ["furthest_earleme"] = kollos_c.recce_furthest_earleme,
   ["is_exhausted"] = kollos_c.recce_is_exhausted,
@@ -112,6 +128,7 @@ local recce_class  = {
   ["progress_report_finish"] = kollos_c.recce_progress_report_finish,
   ["progress_report_start"] = kollos_c.recce_progress_report_start,
   ["start_input"] = kollos_c.recce_start_input,
+  ["stats"] = kollos_c.recce_stats,
   ["terminal_is_expected"] = kollos_c.recce_terminal_is_expected,
   ["zwa_default"] = kollos_c.recce_zwa_default,
   ["zwa_default_set"] = kollos_c.recce_zwa_default_set,
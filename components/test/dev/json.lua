@@ -349,7 +349,7 @@ local function default_lexer_token_next(lexer)
         local parse_is_exhausted = false
         local current_completions = {}
         for event_ix = 1, event_count do
-            local event_type, event_value = lex_g.inner_g:event(event_ix)
+            local event_type, event_value = klol_r.inner_r:event(event_ix)
             if event_type == symbol_completed_event then
                 current_completions[#current_completions+1] = event_value
             elseif event_type == symbol_exhausted_event then
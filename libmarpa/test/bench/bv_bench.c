@@ -0,0 +1,155 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Microbenchmarks of libmarpa's boolean vector kernels.
+ *
+ * The kernels are private to libmarpa, so this benchmark includes
+ * marpa.c itself.  Build it in the directory which contains
+ * the tangled sources, for example
+ *
+ *     cc -O2 -I. bv_bench.c marpa_obs.c marpa_avl.c marpa_tavl.c \
+ *         marpa_ami.c -o bv_bench
+ *
+ * Usage: bv_bench [iterations]
+ *
+ * Each kernel is timed on vectors of several widths, from the size
+ * of the NSY vector of a small grammar, to the size of the IRL vector
+ * of a large one.  The vectors are about one-eighth full, with the
+ * bits in short runs, which is typical of the symbol and rule
+ * sets in libmarpa.
+ * The time reported is per call.
+ */
+
+#include "marpa.c"
+
+#include <stdio.h>
+#include <time.h>
+
+static const int widths[] = { 64, 256, 1024, 4096, 16384 };
+
+/* A small LCG, so that the vectors are the same on every platform */
+static unsigned int
+next_random (unsigned int *state)
+{
+  *state = *state * 1103515245U + 12345U;
+  return (*state >> 16) & 0x7fff;
+}
+
+static void
+bv_randomize (Bit_Vector bv, int bits, unsigned int *state)
+{
+  int bit;
+  bv_clear (bv);
+  for (bit = 0; bit < bits; bit++)
+    {
+      if (next_random (state) % 32 == 0)
+        {
+          const int run_end = bit + (int) (next_random (state) % 8);
+          for (; bit < bits && bit <= run_end; bit++)
+            bv_bit_set (bv, bit);
+        }
+    }
+}
+
+static double
+nanoseconds_per_call (clock_t start, long calls)
+{
+  return (double) (clock () - start) / CLOCKS_PER_SEC * 1e9 / (double) calls;
+}
+
+int
+main (int argc, char *argv[])
+{
+  long iterations = 1000000;
+  unsigned int width_ix;
+  unsigned int state = 42;
+  /* Keeps the compiler from discarding the calls */
+  long sink = 0;
+
+  if (argc > 1)
+    iterations = atol (argv[1]);
+  if (iterations < 1)
+    {
+      fprintf (stderr, "usage: %s [iterations]\n", argv[0]);
+      return 1;
+    }
+
+  printf ("%8s %12s %12s %12s %12s\n", "bits", "or_assign", "and",
+          "count", "scan");
+  for (width_ix = 0; width_ix < sizeof (widths) / sizeof (widths[0]);
+       width_ix++)
+    {
+      const int bits = widths[width_ix];
+      /* Keep the work per kernel about the same across widths */
+      const long calls = iterations * 64 / bits + 1;
+      Bit_Vector x = bv_create (bits);
+      Bit_Vector y = bv_create (bits);
+      Bit_Vector z = bv_create (bits);
+      double or_assign_ns, and_ns, count_ns, scan_ns;
+      long call;
+      clock_t start;
+
+      bv_randomize (y, bits, &state);
+      bv_randomize (z, bits, &state);
+
+      start = clock ();
+      for (call = 0; call < calls; call++)
+        {
+          bv_or_assign (x, y);
+          sink += (long) x[call % BV_SIZE (x)];
+        }
+      or_assign_ns = nanoseconds_per_call (start, calls);
+
+      start = clock ();
+      for (call = 0; call < calls; call++)
+        {
+          bv_and (x, y, z);
+          sink += (long) x[call % BV_SIZE (x)];
+        }
+      and_ns = nanoseconds_per_call (start, calls);
+
+      start = clock ();
+      for (call = 0; call < calls; call++)
+        {
+          sink += bv_count (y);
+        }
+      count_ns = nanoseconds_per_call (start, calls);
+
+      start = clock ();
+      for (call = 0; call < calls; call++)
+        {
+          int min, max, scan_start;
+          for (scan_start = 0; bv_scan (y, scan_start, &min, &max);
+               scan_start = max + 2)
+            {
+              sink += max - min + 1;
+            }
+        }
+      scan_ns = nanoseconds_per_call (start, calls);
+
+      printf ("%8d %10.1fns %10.1fns %10.1fns %10.1fns\n", bits,
+              or_assign_ns, and_ns, count_ns, scan_ns);
+      bv_free (x);
+      bv_free (y);
+      bv_free (z);
+    }
+  return sink == 42 ? 2 : 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Benchmark of grammar precomputation, as a function of grammar size.
+ *
+ * Usage: precompute_bench [max_symbols]
+ *
+ * For each size, from 1000 symbols up to max_symbols (16000 by
+ * default), doubling each time, a grammar is generated and
+ * precomputed.  The grammars are shaped like the generated grammars
+ * that motivate this benchmark: mostly layered, with each
+ * nonterminal referring to a few of the nonterminals just below it,
+ * but with occasional references back up, which make
+ * recursions.  Every nonterminal also has a rule with a terminal,
+ * so that every symbol is productive.
+ * The generation is the same for every run.
+ *
+ * For each size, the NSY count and the precomputation time
+ * are reported.
+ *
+ * The back references make most nonterminals predict most rules,
+ * so that the prediction matrix and the predicted rule lists
+ * grow with the square of the grammar size, and so does the time.
+ * At 16000 symbols the precomputation takes about 7 seconds
+ * and 1 GB; the time and memory for 32000 symbols are about
+ * four times that.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "marpa.h"
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+/* A small LCG, so that the grammars are the same on every platform */
+static unsigned int
+next_random (unsigned int *state)
+{
+  *state = *state * 1103515245U + 12345U;
+  return (*state >> 16) & 0x7fff;
+}
+
+static Marpa_Grammar
+layered_grammar_new (int nonterminal_count)
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Symbol_ID rhs[3];
+  Marpa_Symbol_ID *nonterminals;
+  Marpa_Symbol_ID terminals[16];
+  unsigned int state = 42;
+  int terminal_ix;
+  int nt_ix;
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode =
+        marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  nonterminals = malloc (sizeof (Marpa_Symbol_ID) * nonterminal_count);
+  for (nt_ix = 0; nt_ix < nonterminal_count; nt_ix++)
+    {
+      ((nonterminals[nt_ix] = marpa_g_symbol_new (g)) >= 0)
+        || fail ("marpa_g_symbol_new", g);
+    }
+  for (terminal_ix = 0; terminal_ix < 16; terminal_ix++)
+    {
+      ((terminals[terminal_ix] = marpa_g_symbol_new (g)) >= 0)
+        || fail ("marpa_g_symbol_new", g);
+    }
+
+  for (nt_ix = 0; nt_ix < nonterminal_count; nt_ix++)
+    {
+      int rule_ix;
+      rhs[0] = terminals[next_random (&state) % 16];
+      (marpa_g_rule_new (g, nonterminals[nt_ix], rhs, 1) >= 0)
+        || fail ("marpa_g_rule_new", g);
+      for (rule_ix = 0; rule_ix < 2; rule_ix++)
+        {
+          int rh_ix;
+          for (rh_ix = 0; rh_ix < 3; rh_ix++)
+            {
+              int target;
+              if (next_random (&state) % 50 == 0)
+                {
+                  /* A reference back up, making a recursion */
+                  target = (int) (next_random (&state) % (nt_ix + 1));
+                }
+              else
+                {
+                  target = nt_ix + 1 + (int) (next_random (&state) % 8);
+                }
+              rhs[rh_ix] = target < nonterminal_count
+                ? nonterminals[target] : terminals[target % 16];
+            }
+          if (marpa_g_rule_new (g, nonterminals[nt_ix], rhs, 3) < 0)
+            {
+              /* A duplicate rule is harmless here -- skip it */
+              marpa_g_error_clear (g);
+            }
+        }
+    }
+  (marpa_g_start_symbol_set (g, nonterminals[0]) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  free (nonterminals);
+  return g;
+}
+
+static double
+seconds_since (clock_t start)
+{
+  return (double) (clock () - start) / CLOCKS_PER_SEC;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int max_symbols = 16000;
+  int nonterminal_count;
+
+  if (argc > 1)
+    max_symbols = atoi (argv[1]);
+  if (max_symbols < 1000)
+    {
+      fprintf (stderr, "usage: %s [max_symbols]\n", argv[0]);
+      return 1;
+    }
+
+  printf ("%12s %12s %12s\n", "symbols", "NSYs", "seconds");
+  for (nonterminal_count = 1000; nonterminal_count <= max_symbols;
+       nonterminal_count *= 2)
+    {
+      Marpa_Grammar g = layered_grammar_new (nonterminal_count);
+      const clock_t start = clock ();
+      double seconds;
+      (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+      seconds = seconds_since (start);
+      printf ("%12d %12d %12.3f\n", nonterminal_count + 16,
+              _marpa_g_nsy_count (g), seconds);
+      marpa_g_unref (g);
+    }
+  return 0;
+}
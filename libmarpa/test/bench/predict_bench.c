@@ -0,0 +1,263 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Benchmark of prediction in the recognizer.
+ *
+ * Usage: predict_bench [levels [tokens [iterations]]]
+ *
+ * The grammar is an expression grammar with one precedence
+ * level per binary operator:
+ *     e[0] ::= e[1] | e[0] op[0] e[1]
+ *     ...
+ *     e[k] ::= e[k+1] | e[k] op[k] e[k+1]
+ *     ...
+ *     e[levels] ::= atom | lparen e[0] rparen
+ * After every operator and every left parenthesis, the Earley set
+ * predicts a chain of rules down to the bottom level, so that
+ * prediction dominates the cost of the parse.
+ * The input is generated, and is the same for every run with
+ * the same arguments.
+ *
+ * Two timings are reported: one with the predictions added item by item,
+ * and one with the prediction memo turned on.
+ * As a check, the Earley item counts of the two are compared.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "marpa.h"
+
+static Marpa_Symbol_ID *S_e;
+static Marpa_Symbol_ID *S_op;
+static Marpa_Symbol_ID S_atom;
+static Marpa_Symbol_ID S_lparen;
+static Marpa_Symbol_ID S_rparen;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+static Marpa_Grammar
+expression_grammar_new (int levels)
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Symbol_ID rhs[3];
+  int level;
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode =
+        marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+
+  S_e = malloc (sizeof (Marpa_Symbol_ID) * (levels + 1));
+  S_op = malloc (sizeof (Marpa_Symbol_ID) * levels);
+  for (level = 0; level <= levels; level++)
+    {
+      ((S_e[level] = marpa_g_symbol_new (g)) >= 0)
+        || fail ("marpa_g_symbol_new", g);
+    }
+  for (level = 0; level < levels; level++)
+    {
+      ((S_op[level] = marpa_g_symbol_new (g)) >= 0)
+        || fail ("marpa_g_symbol_new", g);
+    }
+  ((S_atom = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_lparen = marpa_g_symbol_new (g)) >= 0)
+    || fail ("marpa_g_symbol_new", g);
+  ((S_rparen = marpa_g_symbol_new (g)) >= 0)
+    || fail ("marpa_g_symbol_new", g);
+
+  for (level = 0; level < levels; level++)
+    {
+      rhs[0] = S_e[level + 1];
+      (marpa_g_rule_new (g, S_e[level], rhs, 1) >= 0)
+        || fail ("marpa_g_rule_new", g);
+      rhs[0] = S_e[level];
+      rhs[1] = S_op[level];
+      rhs[2] = S_e[level + 1];
+      (marpa_g_rule_new (g, S_e[level], rhs, 3) >= 0)
+        || fail ("marpa_g_rule_new", g);
+    }
+  rhs[0] = S_atom;
+  (marpa_g_rule_new (g, S_e[levels], rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_lparen;
+  rhs[1] = S_e[0];
+  rhs[2] = S_rparen;
+  (marpa_g_rule_new (g, S_e[levels], rhs, 3) >= 0)
+    || fail ("marpa_g_rule_new", g);
+
+  (marpa_g_start_symbol_set (g, S_e[0]) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  return g;
+}
+
+/* A small LCG, so that the input is the same on every platform */
+static unsigned int
+next_random (unsigned int *state)
+{
+  *state = *state * 1103515245U + 12345U;
+  return (*state >> 16) & 0x7fff;
+}
+
+/* Generate a well-formed expression of about |token_count| tokens.
+ * Returns the actual number of tokens.
+ */
+static int
+expression_generate (int levels, int token_count, Marpa_Symbol_ID * tokens)
+{
+  unsigned int state = 42;
+  int depth = 0;
+  int token_ix = 0;
+  const int max_depth = 20;
+  /* Leave room for a last round of parentheses, and to close them */
+  const int limit = token_count - 3 * max_depth;
+  for (;;)
+    {
+      while (depth < max_depth && next_random (&state) % 4 == 0)
+        {
+          tokens[token_ix++] = S_lparen;
+          depth++;
+        }
+      tokens[token_ix++] = S_atom;
+      while (depth > 0 && next_random (&state) % 4 == 0)
+        {
+          tokens[token_ix++] = S_rparen;
+          depth--;
+        }
+      if (token_ix >= limit)
+        break;
+      tokens[token_ix++] = S_op[next_random (&state) % levels];
+    }
+  while (depth-- > 0)
+    tokens[token_ix++] = S_rparen;
+  return token_ix;
+}
+
+/* Read all the tokens, one earleme each.
+ * Returns the recognizer, which the caller must unref.
+ */
+static Marpa_Recognizer
+recognize (Marpa_Grammar g, const Marpa_Symbol_ID * tokens, int token_count,
+           int use_prediction_memo)
+{
+  int token_ix;
+  Marpa_Recognizer r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  if (_marpa_r_is_use_prediction_memo_set (r, use_prediction_memo) < 0)
+    fail ("_marpa_r_is_use_prediction_memo_set", g);
+  if (marpa_r_start_input (r) < 0)
+    fail ("marpa_r_start_input", g);
+  for (token_ix = 0; token_ix < token_count; token_ix++)
+    {
+      if (marpa_r_alternative (r, tokens[token_ix], 1, 1) != MARPA_ERR_NONE)
+        fail ("marpa_r_alternative", g);
+      if (marpa_r_earleme_complete (r) < 0)
+        fail ("marpa_r_earleme_complete", g);
+    }
+  return r;
+}
+
+static double
+seconds_since (clock_t start)
+{
+  return (double) (clock () - start) / CLOCKS_PER_SEC;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Grammar g;
+  Marpa_Symbol_ID *tokens;
+  int levels = 50;
+  int token_count = 100000;
+  int iterations = 10;
+  int iteration;
+  int use_prediction_memo;
+  int earley_item_count[2];
+
+  if (argc > 1)
+    levels = atoi (argv[1]);
+  if (argc > 2)
+    token_count = atoi (argv[2]);
+  if (argc > 3)
+    iterations = atoi (argv[3]);
+  if (levels < 1 || token_count < 100 || iterations < 1)
+    {
+      fprintf (stderr, "usage: %s [levels [tokens [iterations]]]\n",
+               argv[0]);
+      return 1;
+    }
+
+  g = expression_grammar_new (levels);
+  tokens = malloc (sizeof (Marpa_Symbol_ID) * token_count);
+  token_count = expression_generate (levels, token_count, tokens);
+
+  for (use_prediction_memo = 0; use_prediction_memo <= 1;
+       use_prediction_memo++)
+    {
+      const clock_t start = clock ();
+      double seconds;
+      for (iteration = 0; iteration < iterations; iteration++)
+        {
+          Marpa_Memory_Stats stats;
+          Marpa_Recognizer r =
+            recognize (g, tokens, token_count, use_prediction_memo);
+          if (marpa_r_memory_stats (r, &stats) < 0)
+            fail ("marpa_r_memory_stats", g);
+          earley_item_count[use_prediction_memo] = stats.t_earley_item_count;
+          marpa_r_unref (r);
+        }
+      seconds = seconds_since (start);
+      printf ("%s: %d levels, %d earlemes x %d iterations in %.3f s;"
+              " %.0f earlemes/s\n",
+              use_prediction_memo ? "prediction memo" : "item by item",
+              levels, token_count, iterations, seconds,
+              seconds > 0 ? (double) token_count * iterations / seconds : 0.0);
+    }
+
+  if (earley_item_count[0] != earley_item_count[1])
+    {
+      printf ("Earley item counts differ: %d vs. %d\n",
+              earley_item_count[0], earley_item_count[1]);
+      return 1;
+    }
+
+  free (tokens);
+  free (S_e);
+  free (S_op);
+  marpa_g_unref (g);
+  return 0;
+}
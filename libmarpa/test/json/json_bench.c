@@ -0,0 +1,605 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Microbenchmarks of the recognizer, using the same grammar
+ * as json.c.
+ *
+ * Usage: json_bench file [iterations]
+ *
+ * The input is lexed once, outside of the timings.
+ * Each iteration then creates a recognizer and reads
+ * the whole of the token stream into it.
+ * Two timings are reported: one with
+ * a marpa_r_alternative()/marpa_r_earleme_complete() pair per
+ * token, and one with a single marpa_r_alternatives_read() call
+ * per token.
+ * The first timing is repeated with the postdot index turned on.
+ * Finally, the parse of one recognizer is evaluated, stepping
+ * through every step,
+ * first by way of a bocage, an ordering and a tree iterator,
+ * and then with marpa_r_value_unambiguous().
+ * Last, the steps alone are timed, once with a marpa_v_step()
+ * call per step and once with marpa_v_steps() calls
+ * in batches.
+ * Only libmarpa time is reported.
+ * To compare two versions of libmarpa, run this against
+ * each of them with the same input.
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include "marpa.h"
+
+/* Scan to the location  past a JSON number.
+ * */
+static const unsigned char *
+scan_number (const unsigned char *s, const unsigned char *end)
+{
+  if (*s == '-' || *s == '+')
+    s++;
+  while (s < end && ((unsigned char) (*s - '0') < 10 || *s == '.'
+                     || *s == 'e' || *s == 'E' || *s == '-' || *s == '+'))
+    s++;
+  return s;
+}
+
+/* Scan to location past a JSON string.
+ * Assumes we are pointing an initial double quote.
+ * */
+static const unsigned char *
+scan_string (const unsigned char *s, const unsigned char *end)
+{
+  s++;
+  while (s < end && *s != '"')
+    {
+      if (*s == '\\')
+        s++;
+      s++;
+    }
+  if (s < end)
+    s++;
+  return s;
+}
+
+/* Scan to location past a literal constant
+ * */
+static const unsigned char *
+scan_constant (const unsigned char *target, const unsigned char *s,
+               const unsigned char *end)
+{
+  const unsigned char *t = target;
+  while (*t && s < end && *s == *t)
+    {
+      s++;
+      t++;
+    }
+  return s;
+}
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s\n", s, errcode, error_string);
+  exit (1);
+}
+
+  /* From RFC 7159 */
+static Marpa_Symbol_ID S_begin_array;
+static Marpa_Symbol_ID S_begin_object;
+static Marpa_Symbol_ID S_end_array;
+static Marpa_Symbol_ID S_end_object;
+static Marpa_Symbol_ID S_name_separator;
+static Marpa_Symbol_ID S_value_separator;
+static Marpa_Symbol_ID S_member;
+static Marpa_Symbol_ID S_value;
+static Marpa_Symbol_ID S_false;
+static Marpa_Symbol_ID S_null;
+static Marpa_Symbol_ID S_true;
+static Marpa_Symbol_ID S_object;
+static Marpa_Symbol_ID S_array;
+static Marpa_Symbol_ID S_number;
+static Marpa_Symbol_ID S_string;
+
+  /* Additional */
+static Marpa_Symbol_ID S_object_contents;
+static Marpa_Symbol_ID S_array_contents;
+
+static Marpa_Grammar
+json_grammar_new (void)
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Symbol_ID rhs[4];
+  int i;
+  Marpa_Symbol_ID *symbols[] = {
+    &S_begin_array, &S_begin_object, &S_end_array, &S_end_object,
+    &S_name_separator, &S_value_separator, &S_member, &S_value,
+    &S_false, &S_null, &S_true, &S_object, &S_array, &S_number,
+    &S_string, &S_object_contents, &S_array_contents
+  };
+  Marpa_Symbol_ID *values[] = {
+    &S_false, &S_null, &S_true, &S_object, &S_array, &S_number, &S_string
+  };
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode =
+        marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new returned %d\n", errcode);
+      exit (1);
+    }
+
+  for (i = 0; i < (int) (sizeof (symbols) / sizeof (*symbols)); i++)
+    {
+      ((*symbols[i] = marpa_g_symbol_new (g)) >= 0)
+        || fail ("marpa_g_symbol_new", g);
+    }
+
+  for (i = 0; i < (int) (sizeof (values) / sizeof (*values)); i++)
+    {
+      rhs[0] = *values[i];
+      (marpa_g_rule_new (g, S_value, rhs, 1) >= 0)
+        || fail ("marpa_g_rule_new", g);
+    }
+
+  rhs[0] = S_begin_array;
+  rhs[1] = S_array_contents;
+  rhs[2] = S_end_array;
+  (marpa_g_rule_new (g, S_array, rhs, 3) >= 0)
+    || fail ("marpa_g_rule_new", g);
+
+  rhs[0] = S_begin_object;
+  rhs[1] = S_object_contents;
+  rhs[2] = S_end_object;
+  (marpa_g_rule_new (g, S_object, rhs, 3) >= 0)
+    || fail ("marpa_g_rule_new", g);
+
+  (marpa_g_sequence_new
+   (g, S_array_contents, S_value, S_value_separator, 0,
+    MARPA_PROPER_SEPARATION) >= 0) || fail ("marpa_g_sequence_new", g);
+  (marpa_g_sequence_new
+   (g, S_object_contents, S_member, S_value_separator, 0,
+    MARPA_PROPER_SEPARATION) >= 0) || fail ("marpa_g_sequence_new", g);
+
+  rhs[0] = S_string;
+  rhs[1] = S_name_separator;
+  rhs[2] = S_value;
+  (marpa_g_rule_new (g, S_member, rhs, 3) >= 0)
+    || fail ("marpa_g_rule_new", g);
+
+  (marpa_g_start_symbol_set (g, S_value) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  return g;
+}
+
+/* Lex the input into an array of token symbol IDs.
+ * Returns the token count.
+ */
+static int
+json_lex (const unsigned char *p, const unsigned char *eof,
+          Marpa_Symbol_ID ** p_tokens)
+{
+  int token_count = 0;
+  Marpa_Symbol_ID *tokens =
+    malloc (sizeof (Marpa_Symbol_ID) * (size_t) (eof - p + 1));
+  if (!tokens)
+    abort ();
+  while (p < eof)
+    {
+      switch (*p)
+        {
+        case '-':
+        case '+':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+          p = scan_number (p, eof);
+          tokens[token_count++] = S_number;
+          continue;
+        case '"':
+          p = scan_string (p, eof);
+          tokens[token_count++] = S_string;
+          continue;
+        case '[':
+          tokens[token_count++] = S_begin_array;
+          break;
+        case ']':
+          tokens[token_count++] = S_end_array;
+          break;
+        case '{':
+          tokens[token_count++] = S_begin_object;
+          break;
+        case '}':
+          tokens[token_count++] = S_end_object;
+          break;
+        case ',':
+          tokens[token_count++] = S_value_separator;
+          break;
+        case ':':
+          tokens[token_count++] = S_name_separator;
+          break;
+        case 'n':
+          p = scan_constant ((const unsigned char *) "null", p, eof);
+          tokens[token_count++] = S_null;
+          continue;
+        case 't':
+          p = scan_constant ((const unsigned char *) "true", p, eof);
+          tokens[token_count++] = S_true;
+          continue;
+        case 'f':
+          p = scan_constant ((const unsigned char *) "false", p, eof);
+          tokens[token_count++] = S_false;
+          continue;
+        case ' ':
+        case 0x09:
+        case 0x0A:
+        case 0x0D:
+          break;
+        default:
+          printf ("lexer failed at char '%c'\n", *p);
+          exit (1);
+        }
+      p++;
+    }
+  *p_tokens = tokens;
+  return token_count;
+}
+
+/* Read all the tokens, one earleme each.
+ * Returns the recognizer, which the caller must unref.
+ */
+static Marpa_Recognizer
+recognize (Marpa_Grammar g, const Marpa_Symbol_ID * tokens, int token_count,
+           int use_postdot_index)
+{
+  int token_ix;
+  Marpa_Recognizer r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  if (_marpa_r_is_use_postdot_index_set (r, use_postdot_index) < 0)
+    fail ("_marpa_r_is_use_postdot_index_set", g);
+  if (marpa_r_start_input (r) < 0)
+    fail ("marpa_r_start_input", g);
+  for (token_ix = 0; token_ix < token_count; token_ix++)
+    {
+      if (marpa_r_alternative (r, tokens[token_ix], 1, 1) != MARPA_ERR_NONE)
+        fail ("marpa_r_alternative", g);
+      if (marpa_r_earleme_complete (r) < 0)
+        fail ("marpa_r_earleme_complete", g);
+    }
+  return r;
+}
+
+/* As recognize(), but reading each earleme with a single
+ * call to marpa_r_alternatives_read().
+ */
+static Marpa_Recognizer
+recognize_batched (Marpa_Grammar g, const Marpa_Symbol_ID * tokens,
+                   int token_count)
+{
+  int token_ix;
+  Marpa_Alternative alternative;
+  Marpa_Recognizer r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  if (marpa_r_start_input (r) < 0)
+    fail ("marpa_r_start_input", g);
+  alternative.t_value = 1;
+  alternative.t_length = 1;
+  for (token_ix = 0; token_ix < token_count; token_ix++)
+    {
+      alternative.t_token_id = tokens[token_ix];
+      if (marpa_r_alternatives_read
+          (r, &alternative, 1, MARPA_READ_COMPLETE_EARLEME) != 1)
+        fail ("marpa_r_alternatives_read", g);
+    }
+  return r;
+}
+
+/* Steps through |v|, and returns the number of steps.
+ * Unrefs |v|.
+ */
+static int
+steps_count (Marpa_Grammar g, Marpa_Value v)
+{
+  int step_count = 0;
+  for (;;)
+    {
+      const Marpa_Step_Type step_type = marpa_v_step (v);
+      if (step_type < 0)
+        fail ("marpa_v_step", g);
+      if (step_type == MARPA_STEP_INACTIVE)
+        break;
+      step_count++;
+    }
+  marpa_v_unref (v);
+  return step_count;
+}
+
+/* Evaluates the parse of |r| with the first tree of a new bocage.
+ * Returns the number of steps.
+ */
+static int
+evaluate_by_tree (Marpa_Grammar g, Marpa_Recognizer r)
+{
+  Marpa_Bocage b;
+  Marpa_Order o;
+  Marpa_Tree t;
+  Marpa_Value v;
+  int step_count;
+  b = marpa_b_new (r, -1);
+  if (!b)
+    fail ("marpa_b_new", g);
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  t = marpa_t_new (o);
+  if (!t)
+    fail ("marpa_t_new", g);
+  if (marpa_t_next (t) < 0)
+    fail ("marpa_t_next", g);
+  v = marpa_v_new (t);
+  if (!v)
+    fail ("marpa_v_new", g);
+  step_count = steps_count (g, v);
+  marpa_t_unref (t);
+  marpa_o_unref (o);
+  marpa_b_unref (b);
+  return step_count;
+}
+
+/* As evaluate_by_tree(), but with marpa_r_value_unambiguous().
+ */
+static int
+evaluate_directly (Marpa_Grammar g, Marpa_Recognizer r)
+{
+  const Marpa_Value v = marpa_r_value_unambiguous (r, -1);
+  if (!v)
+    fail ("marpa_r_value_unambiguous", g);
+  return steps_count (g, v);
+}
+
+static double
+seconds_since (clock_t start)
+{
+  return (double) (clock () - start) / CLOCKS_PER_SEC;
+}
+
+#define STEP_BATCH_SIZE 1024
+
+/* Steps through |v| one step at a time with marpa_v_step(),
+ * reading the same fields that marpa_v_steps() records.
+ * Returns a checksum of the fields,
+ * and adds the time taken to |*p_seconds|.
+ * Unrefs |v|.
+ */
+static long
+step_by_one (Marpa_Grammar g, Marpa_Value v, double *p_seconds)
+{
+  long checksum = 0;
+  const clock_t start = clock ();
+  for (;;)
+    {
+      const Marpa_Step_Type step_type = marpa_v_step (v);
+      if (step_type < 0)
+        fail ("marpa_v_step", g);
+      if (step_type == MARPA_STEP_INACTIVE)
+        break;
+      checksum += step_type + marpa_v_result (v) + marpa_v_arg_n (v);
+      checksum += step_type == MARPA_STEP_RULE ? marpa_v_rule (v)
+        : marpa_v_token (v) + marpa_v_token_value (v);
+    }
+  *p_seconds += seconds_since (start);
+  marpa_v_unref (v);
+  return checksum;
+}
+
+/* As step_by_one(), but with marpa_v_steps().
+ */
+static long
+step_in_batches (Marpa_Grammar g, Marpa_Value v, double *p_seconds)
+{
+  Marpa_Step steps[STEP_BATCH_SIZE];
+  long checksum = 0;
+  const clock_t start = clock ();
+  for (;;)
+    {
+      int step_ix;
+      const int step_count = marpa_v_steps (v, steps, STEP_BATCH_SIZE);
+      if (step_count < 0)
+        fail ("marpa_v_steps", g);
+      for (step_ix = 0; step_ix < step_count; step_ix++)
+        {
+          const Marpa_Step *const step = steps + step_ix;
+          checksum += step->t_step_type + step->t_arg_0 + step->t_arg_n;
+          checksum += step->t_step_type == MARPA_STEP_RULE ? step->t_id
+            : step->t_id + step->t_value;
+        }
+      if (step_count < STEP_BATCH_SIZE)
+        break;
+    }
+  *p_seconds += seconds_since (start);
+  marpa_v_unref (v);
+  return checksum;
+}
+
+int
+main (int argc, char *argv[])
+{
+  const unsigned char *p;
+  struct stat sb;
+  Marpa_Grammar g;
+  Marpa_Symbol_ID *tokens;
+  int token_count;
+  int iterations = 10;
+  int iteration;
+  int fd;
+
+  if (argc < 2)
+    {
+      fprintf (stderr, "usage: %s file [iterations]\n", argv[0]);
+      return 1;
+    }
+  if (argc > 2)
+    iterations = atoi (argv[2]);
+
+  fd = open (argv[1], O_RDONLY);
+  if (fstat (fd, &sb) == -1)
+    {
+      perror ("fstat");
+      return 1;
+    }
+  p = (unsigned char *) mmap (0, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED)
+    {
+      perror ("mmap");
+      return 1;
+    }
+
+  g = json_grammar_new ();
+  token_count = json_lex (p, p + sb.st_size, &tokens);
+
+  {
+    const clock_t start = clock ();
+    double seconds;
+    for (iteration = 0; iteration < iterations; iteration++)
+      {
+        marpa_r_unref (recognize (g, tokens, token_count, 0));
+      }
+    seconds = seconds_since (start);
+    printf ("earleme_complete: %d earlemes x %d iterations in %.3f s;"
+            " %.0f earlemes/s\n",
+            token_count, iterations, seconds,
+            seconds > 0 ? (double) token_count * iterations / seconds : 0.0);
+  }
+
+  {
+    const clock_t start = clock ();
+    double seconds;
+    for (iteration = 0; iteration < iterations; iteration++)
+      {
+        marpa_r_unref (recognize (g, tokens, token_count, 1));
+      }
+    seconds = seconds_since (start);
+    printf ("postdot index: %d earlemes x %d iterations in %.3f s;"
+            " %.0f earlemes/s\n",
+            token_count, iterations, seconds,
+            seconds > 0 ? (double) token_count * iterations / seconds : 0.0);
+  }
+
+  {
+    const clock_t start = clock ();
+    double seconds;
+    for (iteration = 0; iteration < iterations; iteration++)
+      {
+        marpa_r_unref (recognize_batched (g, tokens, token_count));
+      }
+    seconds = seconds_since (start);
+    printf ("alternatives_read: %d earlemes x %d iterations in %.3f s;"
+            " %.0f earlemes/s\n",
+            token_count, iterations, seconds,
+            seconds > 0 ? (double) token_count * iterations / seconds : 0.0);
+  }
+
+  {
+    const Marpa_Recognizer r = recognize (g, tokens, token_count, 0);
+    int step_count = 0;
+    {
+      const clock_t start = clock ();
+      double seconds;
+      for (iteration = 0; iteration < iterations; iteration++)
+        {
+          step_count = evaluate_by_tree (g, r);
+        }
+      seconds = seconds_since (start);
+      printf ("bocage, order and tree: %d steps x %d iterations in %.3f s;"
+              " %.0f steps/s\n",
+              step_count, iterations, seconds,
+              seconds > 0 ? (double) step_count * iterations / seconds : 0.0);
+    }
+    {
+      const clock_t start = clock ();
+      double seconds;
+      for (iteration = 0; iteration < iterations; iteration++)
+        {
+          step_count = evaluate_directly (g, r);
+        }
+      seconds = seconds_since (start);
+      printf ("value_unambiguous: %d steps x %d iterations in %.3f s;"
+              " %.0f steps/s\n",
+              step_count, iterations, seconds,
+              seconds > 0 ? (double) step_count * iterations / seconds : 0.0);
+    }
+    {
+      double by_one_seconds = 0.0;
+      double batch_seconds = 0.0;
+      long by_one_checksum = 0;
+      long batch_checksum = 0;
+      Marpa_Value v;
+      for (iteration = 0; iteration < iterations; iteration++)
+        {
+          v = marpa_r_value_unambiguous (r, -1);
+          if (!v)
+            fail ("marpa_r_value_unambiguous", g);
+          by_one_checksum = step_by_one (g, v, &by_one_seconds);
+          v = marpa_r_value_unambiguous (r, -1);
+          if (!v)
+            fail ("marpa_r_value_unambiguous", g);
+          batch_checksum = step_in_batches (g, v, &batch_seconds);
+        }
+      if (by_one_checksum != batch_checksum)
+        fail ("step checksums differ", g);
+      printf ("marpa_v_step: %d steps x %d iterations in %.3f s;"
+              " %.0f steps/s\n",
+              step_count, iterations, by_one_seconds,
+              by_one_seconds >
+              0 ? (double) step_count * iterations / by_one_seconds : 0.0);
+      printf ("marpa_v_steps, batches of %d: %d steps x %d iterations"
+              " in %.3f s; %.0f steps/s\n",
+              STEP_BATCH_SIZE, step_count, iterations, batch_seconds,
+              batch_seconds >
+              0 ? (double) step_count * iterations / batch_seconds : 0.0);
+    }
+    marpa_r_unref (r);
+  }
+
+  free (tokens);
+  marpa_g_unref (g);
+  return 0;
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Reading a batch of tokens: marpa_r_alternatives_read().
+ *
+ * The grammar is
+ *     top ::= x x
+ *     top ::= c c
+ *     x ::= a
+ *     x ::= b
+ * so that a, b and c are expected at the start,
+ * and c is unexpected once an x has been read.
+ * If both a and b are read at the first earleme,
+ * the parse is ambiguous.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+static Marpa_Symbol_ID S_top, S_x, S_a, S_b, S_c;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+static Marpa_Recognizer
+started_recce_new (Marpa_Grammar g)
+{
+  Marpa_Recognizer r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  return r;
+}
+
+static void
+alternative_set (Marpa_Alternative * alternative, Marpa_Symbol_ID token_id,
+                 int value)
+{
+  alternative->t_token_id = token_id;
+  alternative->t_value = value;
+  alternative->t_length = 1;
+}
+
+/* The ambiguity metric of the parse at the latest Earley set:
+ * 1 if the parse is unambiguous, more than 1 if it is ambiguous.
+ */
+static int
+ambiguity_metric (Marpa_Grammar g, Marpa_Recognizer r)
+{
+  Marpa_Bocage b;
+  Marpa_Order o;
+  int metric;
+  b = marpa_b_new (r, -1);
+  if (!b)
+    fail ("marpa_b_new", g);
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  metric = marpa_o_ambiguity_metric (o);
+  marpa_o_unref (o);
+  marpa_b_unref (b);
+  return metric;
+}
+
+/* Returns 1 if the exhausted event is among the events of |r|. */
+static int
+is_exhausted_event (Marpa_Recognizer r)
+{
+  Marpa_Event event;
+  const int event_count = marpa_r_event_count (r);
+  int event_ix;
+  for (event_ix = 0; event_ix < event_count; event_ix++)
+    {
+      if (marpa_r_event (r, &event, event_ix) == MARPA_EVENT_EXHAUSTED)
+        return 1;
+    }
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Recognizer r;
+  Marpa_Symbol_ID rhs[2];
+  Marpa_Alternative alternatives[3];
+  int rc;
+
+  plan (19);
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode = marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_x = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_b = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_c = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  rhs[0] = S_x;
+  rhs[1] = S_x;
+  (marpa_g_rule_new (g, S_top, rhs, 2) >= 0) || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_c;
+  rhs[1] = S_c;
+  (marpa_g_rule_new (g, S_top, rhs, 2) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_rule_new (g, S_x, &S_a, 1) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_rule_new (g, S_x, &S_b, 1) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+
+  /* Before the input is started */
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  alternative_set (alternatives + 0, S_a, 1);
+  rc = marpa_r_alternatives_read (r, alternatives, 1, 0);
+  ok ((rc == -2
+       && marpa_r_error (r, NULL) == MARPA_ERR_RECCE_NOT_ACCEPTING_INPUT),
+      "marpa_r_alternatives_read() fails before input is started");
+  marpa_r_unref (r);
+
+  /* Skipping an unexpected token */
+  r = started_recce_new (g);
+  alternative_set (alternatives + 0, S_a, 1);
+  alternative_set (alternatives + 1, S_b, 2);
+  (marpa_r_alternatives_read (r, alternatives, 2, 0) == 2)
+    || fail ("marpa_r_alternatives_read", g);
+  (marpa_r_earleme_complete (r) >= 0)
+    || fail ("marpa_r_earleme_complete", g);
+  alternative_set (alternatives + 0, S_c, 3);
+  alternative_set (alternatives + 1, S_a, 4);
+  alternative_set (alternatives + 2, S_c, 5);
+  rc = marpa_r_alternatives_read (r, alternatives, 3,
+                                  MARPA_READ_SKIP_UNEXPECTED);
+  ok ((rc == 1), "unexpected tokens were skipped: %d of 3 accepted", rc);
+  ok ((marpa_r_error (r, NULL) == MARPA_ERR_NONE),
+      "skipped tokens do not set the error");
+  ok ((marpa_r_current_earleme (r) == 1),
+      "earleme is not completed without MARPA_READ_COMPLETE_EARLEME");
+  (marpa_r_earleme_complete (r) >= 0)
+    || fail ("marpa_r_earleme_complete", g);
+  ok ((marpa_r_is_exhausted (r) == 1),
+      "the accepted token completes the parse");
+  rc = ambiguity_metric (g, r);
+  ok ((rc > 1), "both tokens of the first batch were read: metric %d", rc);
+  marpa_r_unref (r);
+
+  /* Without the flag, an unexpected token is an error */
+  r = started_recce_new (g);
+  alternative_set (alternatives + 0, S_a, 1);
+  (marpa_r_alternatives_read (r, alternatives, 1, 0) == 1)
+    || fail ("marpa_r_alternatives_read", g);
+  (marpa_r_earleme_complete (r) >= 0)
+    || fail ("marpa_r_earleme_complete", g);
+  alternative_set (alternatives + 0, S_c, 3);
+  rc = marpa_r_alternatives_read (r, alternatives, 1, 0);
+  ok ((rc == -2
+       && marpa_r_error (r, NULL) == MARPA_ERR_UNEXPECTED_TOKEN_ID),
+      "unexpected token is an error without MARPA_READ_SKIP_UNEXPECTED");
+  marpa_r_unref (r);
+
+  /* Completing the earleme */
+  r = started_recce_new (g);
+  alternative_set (alternatives + 0, S_a, 1);
+  rc = marpa_r_alternatives_read (r, alternatives, 1,
+                                  MARPA_READ_COMPLETE_EARLEME);
+  ok ((rc == 1 && marpa_r_current_earleme (r) == 1),
+      "MARPA_READ_COMPLETE_EARLEME completes the earleme");
+  ok ((!is_exhausted_event (r)), "no exhausted event after one token");
+  alternative_set (alternatives + 0, S_b, 2);
+  rc = marpa_r_alternatives_read (r, alternatives, 1,
+                                  MARPA_READ_COMPLETE_EARLEME);
+  ok ((rc == 1 && marpa_r_current_earleme (r) == 2),
+      "second batch completes the second earleme");
+  ok ((is_exhausted_event (r)),
+      "events of the completed earleme are available");
+  rc = ambiguity_metric (g, r);
+  ok ((rc == 1), "batches read as single tokens parse: metric %d", rc);
+  marpa_r_unref (r);
+
+  /* Failure in the middle of a batch */
+  r = started_recce_new (g);
+  alternative_set (alternatives + 0, S_a, 1);
+  alternative_set (alternatives + 1, S_a, 1);
+  alternative_set (alternatives + 2, S_b, 2);
+  rc = marpa_r_alternatives_read (r, alternatives, 3,
+                                  MARPA_READ_SKIP_UNEXPECTED
+                                  | MARPA_READ_COMPLETE_EARLEME);
+  ok ((rc == -2
+       && marpa_r_error (r, NULL) == MARPA_ERR_DUPLICATE_TOKEN),
+      "duplicate token fails the batch, even when skipping unexpected tokens");
+  ok ((marpa_r_current_earleme (r) == 0),
+      "earleme is not completed after a failed batch");
+  ok ((marpa_r_furthest_earleme (r) == 1),
+      "token read before the failure is pending");
+  (marpa_r_earleme_complete (r) >= 0)
+    || fail ("marpa_r_earleme_complete", g);
+  ok ((marpa_r_terminal_is_expected (r, S_a) == 1
+       && marpa_r_terminal_is_expected (r, S_c) == 0),
+      "recognizer continues from the token read before the failure");
+  alternative_set (alternatives + 0, S_b, 2);
+  rc = marpa_r_alternatives_read (r, alternatives, 1,
+                                  MARPA_READ_COMPLETE_EARLEME);
+  ok ((rc == 1 && marpa_r_is_exhausted (r) == 1),
+      "recognizer reads again after a failed batch");
+  rc = ambiguity_metric (g, r);
+  ok ((rc == 1),
+      "token after the failure in the batch was not read: metric %d", rc);
+  marpa_r_unref (r);
+
+  /* A batch with no tokens */
+  r = started_recce_new (g);
+  rc = marpa_r_alternatives_read (r, NULL, 0, 0);
+  ok ((rc == 0 && marpa_r_error (r, NULL) == MARPA_ERR_NONE),
+      "an empty batch reads nothing");
+  marpa_r_unref (r);
+
+  marpa_g_unref (g);
+  return 0;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* An Earley set with more Earley items than fit in
+ * the packed YIM ordinal.
+ *
+ * The grammar is
+ *     seq ::= item*
+ *     item ::= a
+ *     item ::= b[k], for k in 0 .. B_COUNT-1
+ * At every earleme i before the last, we read an 'a' of length 1,
+ * and every b[k], with a length which ends it at the last earleme.
+ * The last Earley set then has an Earley item for every
+ * b[k] and every origin.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define B_COUNT 1000
+#define LAST_EARLEME 70
+
+static Marpa_Symbol_ID S_seq, S_item, S_a;
+static Marpa_Symbol_ID S_b[B_COUNT];
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Recognizer r;
+  Marpa_Symbol_ID rhs[1];
+  int earleme;
+  int k;
+  int rc;
+  int set_size;
+
+  plan (4);
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode =
+        marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+
+  ((S_seq = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_item = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  (marpa_g_sequence_new (g, S_seq, S_item, -1, 0, 0) >= 0)
+    || fail ("marpa_g_sequence_new", g);
+  rhs[0] = S_a;
+  (marpa_g_rule_new (g, S_item, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  for (k = 0; k < B_COUNT; k++)
+    {
+      ((S_b[k] = marpa_g_symbol_new (g)) >= 0)
+        || fail ("marpa_g_symbol_new", g);
+      rhs[0] = S_b[k];
+      (marpa_g_rule_new (g, S_item, rhs, 1) >= 0)
+        || fail ("marpa_g_rule_new", g);
+    }
+  (marpa_g_start_symbol_set (g, S_seq) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  marpa_r_earley_item_warning_threshold_set (r, 0);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+
+  rc = 0;
+  for (earleme = 0; earleme < LAST_EARLEME; earleme++)
+    {
+      (marpa_r_alternative (r, S_a, 1, 1) == MARPA_ERR_NONE)
+        || fail ("marpa_r_alternative", g);
+      for (k = 0; k < B_COUNT; k++)
+        {
+          (marpa_r_alternative (r, S_b[k], 1, LAST_EARLEME - earleme) ==
+           MARPA_ERR_NONE) || fail ("marpa_r_alternative", g);
+        }
+      rc = marpa_r_earleme_complete (r);
+      if (rc < 0)
+        break;
+    }
+  ok ((rc >= 0), "all earlemes completed");
+
+  set_size = _marpa_r_earley_set_size (r, LAST_EARLEME);
+  ok ((set_size >= B_COUNT * LAST_EARLEME),
+      "last Earley set has %d Earley items", set_size);
+
+  rc = _marpa_r_earley_set_trace (r, LAST_EARLEME);
+  ok ((rc == LAST_EARLEME), "_marpa_r_earley_set_trace() returned %d", rc);
+
+  rc = _marpa_r_earley_item_trace (r, set_size - 1);
+  ok ((rc >= 0), "last Earley item has AHM %d", rc);
+
+  marpa_r_unref (r);
+  marpa_g_unref (g);
+  return 0;
+}
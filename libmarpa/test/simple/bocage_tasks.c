@@ -0,0 +1,332 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Bocage setup tasks: marpa_r_bocage_executor_set().
+ *
+ * The grammar is
+ *     top ::= list
+ *     list ::= item list
+ *     list ::= item
+ *     item ::= a n
+ *     item ::= b
+ *     n ::=
+ * so that there are Leo items and nulling or-nodes.
+ * Every earleme of the input is either an |a|,
+ * or, ambiguously, both an |a| and a |b|.
+ * Bocages created with executors, with various task counts,
+ * must be the same, node for node, as the one created without.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define INPUT_LENGTH 40
+#define AMBIGUITY_MASK 0x2a6d
+#define THREAD_COUNT 4
+
+static Marpa_Symbol_ID S_top, S_list, S_item, S_a, S_b, S_n;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+/* An executor which runs the tasks one after another,
+ * in reverse order, and counts them.
+ */
+static void
+reverse_executor (void *executor_data, Marpa_Task_Function task,
+                  void *task_data, int task_count)
+{
+  int *const p_tasks_run = executor_data;
+  int task_ix;
+  for (task_ix = task_count - 1; task_ix >= 0; task_ix--)
+    {
+      (*task) (task_data, task_ix);
+      (*p_tasks_run)++;
+    }
+}
+
+/* An executor which runs the tasks in a pool of threads */
+struct pool_work
+{
+  pthread_mutex_t mutex;
+  Marpa_Task_Function task;
+  void *task_data;
+  int task_count;
+  int next_task_ix;
+};
+
+static void *
+pool_worker (void *arg)
+{
+  struct pool_work *const work = arg;
+  for (;;)
+    {
+      int task_ix;
+      pthread_mutex_lock (&work->mutex);
+      task_ix = work->next_task_ix++;
+      pthread_mutex_unlock (&work->mutex);
+      if (task_ix >= work->task_count)
+        break;
+      (*work->task) (work->task_data, task_ix);
+    }
+  return NULL;
+}
+
+static void
+thread_executor (void *executor_data, Marpa_Task_Function task,
+                 void *task_data, int task_count)
+{
+  pthread_t threads[THREAD_COUNT];
+  struct pool_work work;
+  int thread_ix;
+  pthread_mutex_init (&work.mutex, NULL);
+  work.task = task;
+  work.task_data = task_data;
+  work.task_count = task_count;
+  work.next_task_ix = 0;
+  for (thread_ix = 0; thread_ix < THREAD_COUNT; thread_ix++)
+    {
+      if (pthread_create (threads + thread_ix, NULL, pool_worker, &work))
+        {
+          printf ("pthread_create failed");
+          exit (1);
+        }
+    }
+  for (thread_ix = 0; thread_ix < THREAD_COUNT; thread_ix++)
+    pthread_join (threads[thread_ix], NULL);
+  pthread_mutex_destroy (&work.mutex);
+}
+
+/* Returns 1 if the bocages have the same or-nodes and and-nodes,
+ * with the same IDs, 0 otherwise.
+ */
+static int
+bocages_match (Marpa_Bocage b1, Marpa_Bocage b2)
+{
+  int or_node_id;
+  int and_node_id;
+  const int and_count = _marpa_b_and_node_count (b1);
+  if (_marpa_b_and_node_count (b2) != and_count)
+    return 0;
+  if (_marpa_b_top_or_node (b1) != _marpa_b_top_or_node (b2))
+    return 0;
+  if (marpa_b_ambiguity_metric (b1) != marpa_b_ambiguity_metric (b2))
+    return 0;
+  for (or_node_id = 0;; or_node_id++)
+    {
+      const int set = _marpa_b_or_node_set (b1, or_node_id);
+      if (_marpa_b_or_node_set (b2, or_node_id) != set)
+        return 0;
+      if (set < 0)
+        break;
+      if (_marpa_b_or_node_origin (b1, or_node_id) !=
+          _marpa_b_or_node_origin (b2, or_node_id)
+          || _marpa_b_or_node_irl (b1, or_node_id) !=
+          _marpa_b_or_node_irl (b2, or_node_id)
+          || _marpa_b_or_node_position (b1, or_node_id) !=
+          _marpa_b_or_node_position (b2, or_node_id)
+          || _marpa_b_or_node_first_and (b1, or_node_id) !=
+          _marpa_b_or_node_first_and (b2, or_node_id)
+          || _marpa_b_or_node_last_and (b1, or_node_id) !=
+          _marpa_b_or_node_last_and (b2, or_node_id))
+        return 0;
+    }
+  for (and_node_id = 0; and_node_id < and_count; and_node_id++)
+    {
+      int value1 = -1;
+      int value2 = -1;
+      if (_marpa_b_and_node_parent (b1, and_node_id) !=
+          _marpa_b_and_node_parent (b2, and_node_id)
+          || _marpa_b_and_node_predecessor (b1, and_node_id) !=
+          _marpa_b_and_node_predecessor (b2, and_node_id)
+          || _marpa_b_and_node_cause (b1, and_node_id) !=
+          _marpa_b_and_node_cause (b2, and_node_id)
+          || _marpa_b_and_node_symbol (b1, and_node_id) !=
+          _marpa_b_and_node_symbol (b2, and_node_id)
+          || _marpa_b_and_node_middle (b1, and_node_id) !=
+          _marpa_b_and_node_middle (b2, and_node_id)
+          || _marpa_b_and_node_token (b1, and_node_id, &value1) !=
+          _marpa_b_and_node_token (b2, and_node_id, &value2)
+          || value1 != value2)
+        return 0;
+    }
+  return or_node_id > 0;
+}
+
+static Marpa_Bocage
+bocage_new (Marpa_Grammar g, Marpa_Recognizer r, int earley_set)
+{
+  const Marpa_Bocage b = marpa_b_new (r, earley_set);
+  if (!b)
+    fail ("marpa_b_new", g);
+  return b;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Recognizer r;
+  Marpa_Bocage sequential_b;
+  Marpa_Symbol_ID rhs[2];
+  int tasks_run = 0;
+  int is_match = 1;
+  int task_count;
+  int earleme;
+  int rc;
+
+  plan (9);
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode = marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  (marpa_g_force_valued (g) >= 0) || fail ("marpa_g_force_valued", g);
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_list = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_item = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_b = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_n = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  rhs[0] = S_list;
+  (marpa_g_rule_new (g, S_top, rhs, 1) >= 0) || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_item;
+  rhs[1] = S_list;
+  (marpa_g_rule_new (g, S_list, rhs, 2) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  (marpa_g_rule_new (g, S_list, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_a;
+  rhs[1] = S_n;
+  (marpa_g_rule_new (g, S_item, rhs, 2) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_b;
+  (marpa_g_rule_new (g, S_item, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  (marpa_g_rule_new (g, S_n, rhs, 0) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  for (earleme = 0; earleme < INPUT_LENGTH; earleme++)
+    {
+      (marpa_r_alternative (r, S_a, 2 * earleme + 1, 1) == MARPA_ERR_NONE)
+        || fail ("marpa_r_alternative", g);
+      if (AMBIGUITY_MASK & (1 << (earleme % 16)))
+        (marpa_r_alternative (r, S_b, 2 * earleme + 2, 1) == MARPA_ERR_NONE)
+          || fail ("marpa_r_alternative", g);
+      (marpa_r_earleme_complete (r) >= 0)
+        || fail ("marpa_r_earleme_complete", g);
+    }
+
+  rc = marpa_r_bocage_executor_set (r, reverse_executor, &tasks_run, 0);
+  ok ((rc == -2 && marpa_r_error (r, NULL) == MARPA_ERR_INVALID_TASK_COUNT),
+      "a task count of 0 is not valid");
+
+  sequential_b = bocage_new (g, r, -1);
+  ok ((marpa_b_ambiguity_metric (sequential_b) > 1),
+      "bocage without an executor is ambiguous: %d and-nodes",
+      _marpa_b_and_node_count (sequential_b));
+
+  for (task_count = 1; task_count <= 5; task_count++)
+    {
+      Marpa_Bocage b;
+      (marpa_r_bocage_executor_set (r, reverse_executor, &tasks_run,
+                                    task_count) == task_count)
+        || fail ("marpa_r_bocage_executor_set", g);
+      b = bocage_new (g, r, -1);
+      if (!bocages_match (sequential_b, b))
+        is_match = 0;
+      marpa_b_unref (b);
+    }
+  ok (is_match, "bocages match for 1 to 5 tasks");
+  ok ((tasks_run == 3 * 15), "executor ran %d tasks", tasks_run);
+
+  {
+    Marpa_Bocage b;
+    tasks_run = 0;
+    marpa_r_bocage_executor_set (r, reverse_executor, &tasks_run, 1000);
+    b = bocage_new (g, r, -1);
+    ok (bocages_match (sequential_b, b),
+        "bocages match with more tasks than Earley sets");
+    ok ((tasks_run == 3 * (INPUT_LENGTH + 1)),
+        "one task per Earley set: %d tasks", tasks_run);
+    marpa_b_unref (b);
+  }
+
+  is_match = 1;
+  for (task_count = 2; task_count <= 16; task_count *= 2)
+    {
+      Marpa_Bocage b;
+      marpa_r_bocage_executor_set (r, thread_executor, NULL, task_count);
+      b = bocage_new (g, r, -1);
+      if (!bocages_match (sequential_b, b))
+        is_match = 0;
+      marpa_b_unref (b);
+    }
+  ok (is_match, "bocages match with %d threads", THREAD_COUNT);
+
+  {
+    Marpa_Bocage b1;
+    Marpa_Bocage b2;
+    marpa_r_bocage_executor_set (r, NULL, NULL, 1);
+    b1 = bocage_new (g, r, INPUT_LENGTH / 2);
+    marpa_r_bocage_executor_set (r, thread_executor, NULL, 3);
+    b2 = bocage_new (g, r, INPUT_LENGTH / 2);
+    ok (bocages_match (b1, b2),
+        "bocages match at Earley set %d", INPUT_LENGTH / 2);
+    marpa_b_unref (b1);
+    marpa_b_unref (b2);
+  }
+
+  tasks_run = 0;
+  marpa_r_bocage_executor_set (r, NULL, &tasks_run, 8);
+  {
+    Marpa_Bocage b = bocage_new (g, r, -1);
+    ok ((tasks_run == 0 && bocages_match (sequential_b, b)),
+        "a null executor restores the default");
+    marpa_b_unref (b);
+  }
+
+  marpa_b_unref (sequential_b);
+  marpa_r_unref (r);
+  marpa_g_unref (g);
+  return 0;
+}
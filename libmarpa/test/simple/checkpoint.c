@@ -0,0 +1,306 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Recognizer checkpoints: marpa_r_checkpoint() and marpa_r_restore().
+ *
+ * The grammar is
+ *     top ::= list
+ *     list ::= item list
+ *     list ::= item
+ *     item ::= a
+ *     item ::= b
+ * At every earleme, an |a| of length 1 and a |b| of length 2 are read,
+ * so that the parse is ambiguous, the right recursion creates Leo items,
+ * and, at every checkpoint, a |b| alternative is pending.
+ * A recognizer restored from a checkpoint must continue exactly
+ * as the original does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define INPUT_LENGTH 8
+#define CHECKPOINT_EARLEME 4
+#define SIGNATURE_MAX 4096
+
+static Marpa_Symbol_ID S_top, S_list, S_item, S_a, S_b;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+static Marpa_Grammar
+grammar_new (Marpa_Config * config, int is_left_recursive)
+{
+  Marpa_Grammar g;
+  Marpa_Symbol_ID rhs[2];
+  g = marpa_g_new (config);
+  if (!g)
+    {
+      Marpa_Error_Code errcode = marpa_c_error (config, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_list = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_item = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_b = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  rhs[0] = S_list;
+  (marpa_g_rule_new (g, S_top, rhs, 1) >= 0) || fail ("marpa_g_rule_new", g);
+  rhs[0] = is_left_recursive ? S_list : S_item;
+  rhs[1] = is_left_recursive ? S_item : S_list;
+  (marpa_g_rule_new (g, S_list, rhs, 2) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_item;
+  (marpa_g_rule_new (g, S_list, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_a;
+  (marpa_g_rule_new (g, S_item, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_b;
+  (marpa_g_rule_new (g, S_item, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  return g;
+}
+
+/* Reads the input from the current earleme up to |end_earleme| */
+static void
+read_input (Marpa_Grammar g, Marpa_Recognizer r, int end_earleme)
+{
+  int earleme;
+  for (earleme = marpa_r_current_earleme (r); earleme < end_earleme;
+       earleme++)
+    {
+      (marpa_r_alternative (r, S_a, 2 * earleme + 2, 1) == MARPA_ERR_NONE)
+        || fail ("marpa_r_alternative", g);
+      if (earleme + 2 <= INPUT_LENGTH)
+        (marpa_r_alternative (r, S_b, 2 * earleme + 3, 2) == MARPA_ERR_NONE)
+          || fail ("marpa_r_alternative", g);
+      (marpa_r_earleme_complete (r) >= 0)
+        || fail ("marpa_r_earleme_complete", g);
+    }
+}
+
+static int *
+signature_push (int *p, int *end, int value)
+{
+  if (p >= end)
+    {
+      printf ("bocage signature is too long");
+      exit (1);
+    }
+  *p = value;
+  return p + 1;
+}
+
+/* Writes the or-nodes and and-nodes of the bocage at |earley_set|,
+ * and the number of its parse trees,
+ * into |signature|.
+ * Returns the length of the signature,
+ * or 0 if there is no parse at |earley_set|.
+ */
+static int
+bocage_signature (Marpa_Grammar g, Marpa_Recognizer r, int earley_set,
+                  int *signature)
+{
+  int *p = signature;
+  int *const end = signature + SIGNATURE_MAX;
+  Marpa_Bocage b;
+  Marpa_Order o;
+  Marpa_Tree t;
+  Marpa_Or_Node_ID or_node_id;
+  Marpa_And_Node_ID and_node_id;
+  int and_node_count;
+  int tree_count = 0;
+
+  b = marpa_b_new (r, earley_set);
+  if (!b)
+    return 0;
+  p = signature_push (p, end, marpa_b_ambiguity_metric (b));
+  for (or_node_id = 0; _marpa_b_or_node_set (b, or_node_id) >= 0;
+       or_node_id++)
+    {
+      p = signature_push (p, end, _marpa_b_or_node_set (b, or_node_id));
+      p = signature_push (p, end, _marpa_b_or_node_origin (b, or_node_id));
+      p = signature_push (p, end, _marpa_b_or_node_irl (b, or_node_id));
+      p = signature_push (p, end, _marpa_b_or_node_position (b, or_node_id));
+      p = signature_push (p, end, _marpa_b_or_node_and_count (b, or_node_id));
+    }
+  and_node_count = _marpa_b_and_node_count (b);
+  p = signature_push (p, end, and_node_count);
+  for (and_node_id = 0; and_node_id < and_node_count; and_node_id++)
+    {
+      int value = -1;
+      p = signature_push (p, end, _marpa_b_and_node_cause (b, and_node_id));
+      p = signature_push (p, end,
+                          _marpa_b_and_node_predecessor (b, and_node_id));
+      p = signature_push (p, end, _marpa_b_and_node_middle (b, and_node_id));
+      p = signature_push (p, end, _marpa_b_and_node_symbol (b, and_node_id));
+      p = signature_push (p, end,
+                          _marpa_b_and_node_token (b, and_node_id, &value));
+      p = signature_push (p, end, value);
+    }
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  t = marpa_t_new (o);
+  if (!t)
+    fail ("marpa_t_new", g);
+  while (marpa_t_next (t) >= 0)
+    tree_count++;
+  p = signature_push (p, end, tree_count);
+  marpa_t_unref (t);
+  marpa_o_unref (o);
+  marpa_b_unref (b);
+  return (int) (p - signature);
+}
+
+static int
+signatures_match (Marpa_Grammar g, Marpa_Recognizer r1,
+                  Marpa_Recognizer r2, int earley_set)
+{
+  static int signature1[SIGNATURE_MAX];
+  static int signature2[SIGNATURE_MAX];
+  const int length1 = bocage_signature (g, r1, earley_set, signature1);
+  const int length2 = bocage_signature (g, r2, earley_set, signature2);
+  return length1 > 0 && length1 == length2
+    && memcmp (signature1, signature2, sizeof (int) * (size_t) length1) == 0;
+}
+
+static int
+earley_sets_match (Marpa_Recognizer r1, Marpa_Recognizer r2)
+{
+  int earley_set;
+  const int latest = marpa_r_latest_earley_set (r1);
+  if (marpa_r_latest_earley_set (r2) != latest)
+    return 0;
+  for (earley_set = 0; earley_set <= latest; earley_set++)
+    {
+      if (_marpa_r_earley_set_size (r1, earley_set) !=
+          _marpa_r_earley_set_size (r2, earley_set))
+        return 0;
+    }
+  return 1;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Grammar g_other;
+  Marpa_Recognizer r1;
+  Marpa_Recognizer r2;
+  Marpa_Recognizer r;
+  char *checkpoint;
+  char *copy;
+  int size;
+  int rc;
+
+  plan (12);
+
+  marpa_c_init (&marpa_configuration);
+  g = grammar_new (&marpa_configuration, 0);
+
+  r1 = marpa_r_new (g);
+  if (!r1)
+    fail ("marpa_r_new", g);
+  rc = marpa_r_checkpoint (r1, NULL, 0);
+  ok ((rc == -2 && marpa_g_error (g, NULL) == MARPA_ERR_RECCE_NOT_STARTED),
+      "marpa_r_checkpoint() fails before input is started");
+
+  (marpa_r_start_input (r1) >= 0) || fail ("marpa_r_start_input", g);
+  read_input (g, r1, CHECKPOINT_EARLEME);
+
+  size = marpa_r_checkpoint (r1, NULL, 0);
+  ok ((size > 0), "checkpoint size is %d bytes", size);
+  checkpoint = malloc ((size_t) size);
+  rc = marpa_r_checkpoint (r1, checkpoint, (size_t) size);
+  ok ((rc == size), "marpa_r_checkpoint() wrote %d bytes", rc);
+
+  r2 = marpa_r_restore (g, checkpoint, (size_t) size);
+  ok ((r2 != NULL), "checkpoint is restored");
+  if (!r2)
+    fail ("marpa_r_restore", g);
+
+  copy = malloc ((size_t) size);
+  rc = marpa_r_checkpoint (r2, copy, (size_t) size);
+  ok ((rc == size && memcmp (copy, checkpoint, (size_t) size) == 0),
+      "restored recognizer has the same checkpoint");
+
+  ok (signatures_match (g, r1, r2, CHECKPOINT_EARLEME),
+      "bocages at the checkpoint match");
+
+  /* Corrupt copies of the checkpoint */
+  memcpy (copy, checkpoint, (size_t) size);
+  copy[size / 2] ^= 1;
+  r = marpa_r_restore (g, copy, (size_t) size);
+  ok ((r == NULL
+       && marpa_g_error (g, NULL) == MARPA_ERR_INVALID_CHECKPOINT),
+      "corrupted checkpoint is rejected");
+  r = marpa_r_restore (g, checkpoint, (size_t) size - 1);
+  ok ((r == NULL
+       && marpa_g_error (g, NULL) == MARPA_ERR_INVALID_CHECKPOINT),
+      "truncated checkpoint is rejected");
+  free (copy);
+
+  /* A grammar with the same counts of everything,
+   * but different rules
+   */
+  g_other = grammar_new (&marpa_configuration, 1);
+  r = marpa_r_restore (g_other, checkpoint, (size_t) size);
+  ok ((r == NULL
+       && marpa_g_error (g_other, NULL) == MARPA_ERR_INVALID_CHECKPOINT),
+      "checkpoint is rejected by another grammar");
+  marpa_g_unref (g_other);
+
+  /* The restored recognizer does not refer to the checkpoint */
+  memset (checkpoint, 0, (size_t) size);
+  free (checkpoint);
+
+  read_input (g, r1, INPUT_LENGTH);
+  read_input (g, r2, INPUT_LENGTH);
+  ok (earley_sets_match (r1, r2),
+      "Earley sets match after the rest of the input: last has %d items",
+      _marpa_r_earley_set_size (r2, INPUT_LENGTH));
+  ok (signatures_match (g, r1, r2, INPUT_LENGTH),
+      "bocages at the end of input match");
+  ok (signatures_match (g, r1, r2, CHECKPOINT_EARLEME + 1),
+      "bocages after the checkpoint match");
+
+  marpa_r_unref (r1);
+  marpa_r_unref (r2);
+  marpa_g_unref (g);
+  return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* The chunk pool: marpa_c_chunk_pool_size_set(),
+ * marpa_chunk_pool_size() and marpa_chunk_pool_free().
+ *
+ * The grammar is
+ *     top ::= list
+ *     list ::= item list
+ *     list ::= item
+ *     item ::= a
+ *     item ::= b
+ * and many documents are parsed with it, one after another,
+ * as a server would.
+ * Each document is long enough to free more chunks than
+ * the pool will keep.
+ * That the chunks really are reused is checked with
+ * _marpa_chunk_pool_reuse_count(), the count of chunks taken
+ * from the pool instead of from malloc().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define POOL_SIZE (64 * 1024)
+#define DOCUMENT_LENGTH 300
+#define DOCUMENT_COUNT 100
+
+static Marpa_Symbol_ID S_top, S_list, S_item, S_a, S_b;
+
+struct thread_data
+{
+  Marpa_Grammar g;
+  size_t pool_size_before;
+  size_t pool_size_after_parse;
+  size_t pool_size_after_free;
+};
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+static Marpa_Grammar
+grammar_new (Marpa_Config * config)
+{
+  Marpa_Symbol_ID rhs[2];
+  Marpa_Grammar g = marpa_g_new (config);
+  if (!g)
+    {
+      printf ("marpa_g_new: error %d", marpa_c_error (config, NULL));
+      exit (1);
+    }
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_list = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_item = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_b = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  rhs[0] = S_list;
+  (marpa_g_rule_new (g, S_top, rhs, 1) >= 0) || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_item;
+  rhs[1] = S_list;
+  (marpa_g_rule_new (g, S_list, rhs, 2) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  (marpa_g_rule_new (g, S_list, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_a;
+  (marpa_g_rule_new (g, S_item, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_b;
+  (marpa_g_rule_new (g, S_item, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  return g;
+}
+
+/* Parses a document, in which the last two earlemes are
+ * ambiguous, and returns the number of parse trees.
+ */
+static int
+document_parse (Marpa_Grammar g)
+{
+  Marpa_Recognizer r;
+  Marpa_Bocage b;
+  Marpa_Order o;
+  Marpa_Tree t;
+  int earleme;
+  int count = 0;
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  for (earleme = 0; earleme < DOCUMENT_LENGTH; earleme++)
+    {
+      (marpa_r_alternative (r, S_a, 1, 1) == MARPA_ERR_NONE)
+        || fail ("marpa_r_alternative", g);
+      if (earleme >= DOCUMENT_LENGTH - 2)
+        (marpa_r_alternative (r, S_b, 1, 1) == MARPA_ERR_NONE)
+          || fail ("marpa_r_alternative", g);
+      (marpa_r_earleme_complete (r) >= 0)
+        || fail ("marpa_r_earleme_complete", g);
+    }
+  b = marpa_b_new (r, -1);
+  if (!b)
+    fail ("marpa_b_new", g);
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  t = marpa_t_new (o);
+  if (!t)
+    fail ("marpa_t_new", g);
+  while (marpa_t_next (t) >= 0)
+    count++;
+  marpa_t_unref (t);
+  marpa_o_unref (o);
+  marpa_b_unref (b);
+  marpa_r_unref (r);
+  return count;
+}
+
+static void *
+worker (void *arg)
+{
+  struct thread_data *data = arg;
+  data->pool_size_before = marpa_chunk_pool_size ();
+  document_parse (data->g);
+  data->pool_size_after_parse = marpa_chunk_pool_size ();
+  marpa_chunk_pool_free ();
+  data->pool_size_after_free = marpa_chunk_pool_size ();
+  return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  pthread_t thread;
+  struct thread_data data;
+  size_t max_pool_size = 0;
+  size_t pool_size;
+  size_t reuse_count;
+  int is_parse_ok = 1;
+  int reusing_document_count = 0;
+  int document;
+
+  marpa_c_init (&marpa_configuration);
+  if (!marpa_c_chunk_pool_size_set (&marpa_configuration, POOL_SIZE))
+    skip_all ("Libmarpa has no chunk pool");
+  plan (8);
+
+  g = grammar_new (&marpa_configuration);
+  ok ((document_parse (g) == 4), "document has 4 parses");
+  pool_size = marpa_chunk_pool_size ();
+  ok ((pool_size > 0), "%lu bytes of freed chunks are pooled",
+      (unsigned long) pool_size);
+
+  for (document = 0; document < DOCUMENT_COUNT; document++)
+    {
+      reuse_count = _marpa_chunk_pool_reuse_count ();
+      if (document_parse (g) != 4)
+        is_parse_ok = 0;
+      if (_marpa_chunk_pool_reuse_count () > reuse_count)
+        reusing_document_count++;
+      pool_size = marpa_chunk_pool_size ();
+      if (pool_size > max_pool_size)
+        max_pool_size = pool_size;
+    }
+  ok (is_parse_ok, "%d documents parsed with chunks from the pool",
+      DOCUMENT_COUNT);
+  ok ((reusing_document_count == DOCUMENT_COUNT),
+      "%d of %d documents took chunks from the pool",
+      reusing_document_count, DOCUMENT_COUNT);
+  ok ((max_pool_size <= POOL_SIZE),
+      "pool was never above its size: at most %lu bytes",
+      (unsigned long) max_pool_size);
+
+  (marpa_g_freeze (g) >= 0) || fail ("marpa_g_freeze", g);
+  data.g = g;
+  if (pthread_create (&thread, NULL, worker, &data))
+    {
+      perror ("pthread_create");
+      exit (1);
+    }
+  pthread_join (thread, NULL);
+  ok ((data.pool_size_before == 0 && data.pool_size_after_parse > 0
+       && data.pool_size_after_free == 0
+       && marpa_chunk_pool_size () == pool_size),
+      "another thread sharing the grammar has its own pool");
+  marpa_g_unref (g);
+
+  marpa_chunk_pool_free ();
+  ok ((marpa_chunk_pool_size () == 0), "marpa_chunk_pool_free() empties the pool");
+
+  marpa_c_init (&marpa_configuration);
+  g = grammar_new (&marpa_configuration);
+  reuse_count = _marpa_chunk_pool_reuse_count ();
+  document_parse (g);
+  marpa_g_unref (g);
+  ok ((marpa_chunk_pool_size () == 0
+       && _marpa_chunk_pool_reuse_count () == reuse_count),
+      "a grammar without a chunk pool size does not use the pool");
+  return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Grammar clones: marpa_g_clone().
+ *
+ * The grammar is
+ *     top ::= A+
+ *     A ::= a
+ * with a prediction event on A.
+ * Clones share its precomputation,
+ * but have their own event activation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define INPUT_LENGTH 3
+
+static Marpa_Symbol_ID S_top, S_A, S_a;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+/* Parses the input, and returns the number of events */
+static int
+parse (Marpa_Grammar g)
+{
+  Marpa_Recognizer r;
+  int earleme;
+  int event_count;
+
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  event_count = marpa_r_event_count (r);
+  for (earleme = 0; earleme < INPUT_LENGTH; earleme++)
+    {
+      (marpa_r_alternative (r, S_a, 1, 1) == MARPA_ERR_NONE)
+        || fail ("marpa_r_alternative", g);
+      (marpa_r_earleme_complete (r) >= 0)
+        || fail ("marpa_r_earleme_complete", g);
+      event_count += marpa_r_event_count (r);
+    }
+  marpa_r_unref (r);
+  return event_count;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Grammar clone;
+  Marpa_Grammar clone2;
+  Marpa_Symbol_ID rhs[1];
+  int event_count;
+  int rc;
+
+  plan (10);
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode =
+        marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_A = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  (marpa_g_sequence_new (g, S_top, S_A, -1, 1, 0) >= 0)
+    || fail ("marpa_g_sequence_new", g);
+  rhs[0] = S_a;
+  (marpa_g_rule_new (g, S_A, rhs, 1) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_symbol_is_prediction_event_set (g, S_A, 1) >= 0)
+    || fail ("marpa_g_symbol_is_prediction_event_set", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+
+  clone = marpa_g_clone (g);
+  ok ((clone == NULL && marpa_g_error (g, NULL) == MARPA_ERR_NOT_PRECOMPUTED),
+      "marpa_g_clone() fails before precomputation");
+
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  event_count = parse (g);
+
+  clone = marpa_g_clone (g);
+  ok ((clone != NULL && marpa_g_is_precomputed (clone) == 1
+       && marpa_g_is_frozen (clone) == 0),
+      "clone is precomputed, and not frozen");
+
+  rc = marpa_g_prediction_symbol_activate (g, S_A, 0);
+  ok ((rc == -2 && marpa_g_error (g, NULL) == MARPA_ERR_PRECOMPUTED),
+      "event activation still fails in the precomputed grammar");
+  ok ((marpa_g_error (clone, NULL) == MARPA_ERR_NONE),
+      "clone has its own error state");
+
+  rc = marpa_g_prediction_symbol_activate (clone, S_A, 0);
+  ok ((rc == 0 && parse (clone) == 0),
+      "prediction event deactivated in clone");
+  ok ((event_count > 0 && parse (g) == event_count),
+      "original grammar still has %d prediction events", event_count);
+
+  /* The clone keeps the shared precomputation alive */
+  marpa_g_unref (g);
+  clone2 = marpa_g_clone (clone);
+  ok ((clone2 != NULL && parse (clone2) == 0),
+      "clone of a clone inherits its event activation");
+  rc = marpa_g_prediction_symbol_activate (clone2, S_A, 1);
+  ok ((rc == 1 && parse (clone2) == event_count && parse (clone) == 0),
+      "prediction event reactivated in clone of a clone only");
+
+  marpa_g_unref (clone);
+  (marpa_g_freeze (clone2) >= 0) || fail ("marpa_g_freeze", clone2);
+  rc = marpa_g_prediction_symbol_activate (clone2, S_A, 0);
+  ok ((rc == -2
+       && marpa_g_is_frozen (clone2) == 1
+       && marpa_g_error (clone2, NULL) == MARPA_ERR_NONE),
+      "event activation fails in a frozen clone, without writing it");
+  ok ((parse (clone2) == event_count), "frozen clone still parses");
+
+  marpa_g_unref (clone2);
+  return 0;
+}
@@ -0,0 +1,425 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Valuing an unambiguous parse directly: marpa_r_value_unambiguous().
+ *
+ * The first grammar is a JSON-like grammar,
+ *     value ::= object | array | string | number
+ *     object ::= lbrace members rbrace
+ *     members ::= pair* separated by comma
+ *     pair ::= string colon value
+ *     array ::= lbracket elements rbracket
+ *     elements ::= value* separated by comma
+ * The second grammar is
+ *     top ::= list
+ *     list ::= item list
+ *     list ::= item
+ *     item ::= a n
+ *     item ::= n b
+ *     item ::= c
+ *     item ::= c n
+ *     n ::=
+ * so that there are Leo items, leading and trailing nulls,
+ * and, if a |c| is read, ambiguity.
+ * A valuator from marpa_r_value_unambiguous() must give
+ * the same steps as a valuator of the first tree of a new bocage,
+ * and must be created directly exactly when the parse is unambiguous.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define JSON_DEPTH 6
+#define LIST_LENGTH 40
+
+static Marpa_Symbol_ID S_value, S_object, S_members, S_pair, S_array,
+  S_elements, S_string, S_number, S_lbrace, S_rbrace, S_lbracket,
+  S_rbracket, S_comma, S_colon;
+static Marpa_Symbol_ID S_top, S_list, S_item, S_a, S_b, S_c, S_m, S_n;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+static Marpa_Grammar
+grammar_new (void)
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode = marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  (marpa_g_force_valued (g) >= 0) || fail ("marpa_g_force_valued", g);
+  return g;
+}
+
+static Marpa_Symbol_ID
+symbol_new (Marpa_Grammar g)
+{
+  const Marpa_Symbol_ID symbol_id = marpa_g_symbol_new (g);
+  (symbol_id >= 0) || fail ("marpa_g_symbol_new", g);
+  return symbol_id;
+}
+
+static void
+rule_new (Marpa_Grammar g, Marpa_Symbol_ID lhs, Marpa_Symbol_ID * rhs,
+          int length)
+{
+  (marpa_g_rule_new (g, lhs, rhs, length) >= 0)
+    || fail ("marpa_g_rule_new", g);
+}
+
+static void
+token_read (Marpa_Grammar g, Marpa_Recognizer r, Marpa_Symbol_ID token_id,
+            int value)
+{
+  (marpa_r_alternative (r, token_id, value, 1) == MARPA_ERR_NONE)
+    || fail ("marpa_r_alternative", g);
+  (marpa_r_earleme_complete (r) >= 0)
+    || fail ("marpa_r_earleme_complete", g);
+}
+
+/* Steps through |v| and returns a hash of its steps.
+ * The number of steps is put in |*p_step_count|.
+ */
+static unsigned long
+steps_hash (Marpa_Grammar g, Marpa_Value v, int *p_step_count)
+{
+  unsigned long hash = 0;
+  int step_count = 0;
+  for (;;)
+    {
+      const Marpa_Step_Type step_type = marpa_v_step (v);
+      if (step_type < 0)
+        fail ("marpa_v_step", g);
+      if (step_type == MARPA_STEP_INACTIVE)
+        break;
+      step_count++;
+      hash = hash * 31 + step_type;
+      switch (step_type)
+        {
+        case MARPA_STEP_RULE:
+          hash = hash * 31 + marpa_v_rule (v);
+          hash = hash * 31 + marpa_v_arg_0 (v);
+          hash = hash * 31 + marpa_v_arg_n (v);
+          hash = hash * 31 + marpa_v_rule_start_es_id (v);
+          hash = hash * 31 + marpa_v_es_id (v);
+          break;
+        case MARPA_STEP_TOKEN:
+          hash = hash * 31 + marpa_v_token (v);
+          hash = hash * 31 + marpa_v_token_value (v);
+          hash = hash * 31 + marpa_v_result (v);
+          hash = hash * 31 + marpa_v_token_start_es_id (v);
+          hash = hash * 31 + marpa_v_es_id (v);
+          break;
+        case MARPA_STEP_NULLING_SYMBOL:
+          hash = hash * 31 + marpa_v_symbol (v);
+          hash = hash * 31 + marpa_v_result (v);
+          hash = hash * 31 + marpa_v_es_id (v);
+          break;
+        }
+    }
+  *p_step_count = step_count;
+  return hash;
+}
+
+/* Returns 1 if a valuator from marpa_r_value_unambiguous() at
+ * |earley_set| gives the same steps as the valuator of the first
+ * tree of a new bocage, 0 otherwise.
+ * |*p_is_direct| is set to whether the valuator was created directly.
+ */
+static int
+values_match (Marpa_Grammar g, Marpa_Recognizer r, int earley_set,
+              int *p_is_direct)
+{
+  Marpa_Bocage b;
+  Marpa_Order o;
+  Marpa_Tree t;
+  Marpa_Value v;
+  unsigned long tree_hash, direct_hash;
+  int tree_step_count, direct_step_count;
+  b = marpa_b_new (r, earley_set);
+  if (!b)
+    fail ("marpa_b_new", g);
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  t = marpa_t_new (o);
+  if (!t)
+    fail ("marpa_t_new", g);
+  (marpa_t_next (t) >= 0) || fail ("marpa_t_next", g);
+  v = marpa_v_new (t);
+  if (!v)
+    fail ("marpa_v_new", g);
+  tree_hash = steps_hash (g, v, &tree_step_count);
+  marpa_v_unref (v);
+  marpa_t_unref (t);
+  marpa_o_unref (o);
+  marpa_b_unref (b);
+
+  v = marpa_r_value_unambiguous (r, earley_set);
+  if (!v)
+    fail ("marpa_r_value_unambiguous", g);
+  *p_is_direct = _marpa_v_is_direct (v);
+  direct_hash = steps_hash (g, v, &direct_step_count);
+  marpa_v_unref (v);
+  return tree_hash == direct_hash && tree_step_count == direct_step_count
+    && tree_step_count > 0;
+}
+
+static Marpa_Grammar
+json_grammar_new (void)
+{
+  const Marpa_Grammar g = grammar_new ();
+  Marpa_Symbol_ID rhs[3];
+  S_value = symbol_new (g);
+  S_object = symbol_new (g);
+  S_members = symbol_new (g);
+  S_pair = symbol_new (g);
+  S_array = symbol_new (g);
+  S_elements = symbol_new (g);
+  S_string = symbol_new (g);
+  S_number = symbol_new (g);
+  S_lbrace = symbol_new (g);
+  S_rbrace = symbol_new (g);
+  S_lbracket = symbol_new (g);
+  S_rbracket = symbol_new (g);
+  S_comma = symbol_new (g);
+  S_colon = symbol_new (g);
+  rhs[0] = S_object;
+  rule_new (g, S_value, rhs, 1);
+  rhs[0] = S_array;
+  rule_new (g, S_value, rhs, 1);
+  rhs[0] = S_string;
+  rule_new (g, S_value, rhs, 1);
+  rhs[0] = S_number;
+  rule_new (g, S_value, rhs, 1);
+  rhs[0] = S_lbrace;
+  rhs[1] = S_members;
+  rhs[2] = S_rbrace;
+  rule_new (g, S_object, rhs, 3);
+  (marpa_g_sequence_new
+   (g, S_members, S_pair, S_comma, 0, MARPA_PROPER_SEPARATION) >= 0)
+    || fail ("marpa_g_sequence_new", g);
+  rhs[0] = S_string;
+  rhs[1] = S_colon;
+  rhs[2] = S_value;
+  rule_new (g, S_pair, rhs, 3);
+  rhs[0] = S_lbracket;
+  rhs[1] = S_elements;
+  rhs[2] = S_rbracket;
+  rule_new (g, S_array, rhs, 3);
+  (marpa_g_sequence_new
+   (g, S_elements, S_value, S_comma, 0, MARPA_PROPER_SEPARATION) >= 0)
+    || fail ("marpa_g_sequence_new", g);
+  (marpa_g_start_symbol_set (g, S_value) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  return g;
+}
+
+/* Reads a JSON value nested |depth| deep.
+ * Token values count up from 1.
+ */
+static void
+json_read (Marpa_Grammar g, Marpa_Recognizer r, int depth, int *p_value)
+{
+  int i;
+  if (depth <= 0)
+    {
+      token_read (g, r, (*p_value % 2) ? S_string : S_number, *p_value);
+      (*p_value)++;
+      return;
+    }
+  if (depth % 2)
+    {
+      token_read (g, r, S_lbracket, (*p_value)++);
+      for (i = 0; i < depth; i++)
+        {
+          if (i)
+            token_read (g, r, S_comma, (*p_value)++);
+          json_read (g, r, i == 1 ? 0 : depth - 1, p_value);
+        }
+      token_read (g, r, S_rbracket, (*p_value)++);
+      return;
+    }
+  token_read (g, r, S_lbrace, (*p_value)++);
+  for (i = 0; i < depth - 2; i++)
+    {
+      if (i)
+        token_read (g, r, S_comma, (*p_value)++);
+      token_read (g, r, S_string, (*p_value)++);
+      token_read (g, r, S_colon, (*p_value)++);
+      json_read (g, r, depth - 1, p_value);
+    }
+  token_read (g, r, S_rbrace, (*p_value)++);
+}
+
+static Marpa_Grammar
+list_grammar_new (void)
+{
+  const Marpa_Grammar g = grammar_new ();
+  Marpa_Symbol_ID rhs[2];
+  S_top = symbol_new (g);
+  S_list = symbol_new (g);
+  S_item = symbol_new (g);
+  S_a = symbol_new (g);
+  S_b = symbol_new (g);
+  S_c = symbol_new (g);
+  S_n = symbol_new (g);
+  rhs[0] = S_list;
+  rule_new (g, S_top, rhs, 1);
+  rhs[0] = S_item;
+  rhs[1] = S_list;
+  rule_new (g, S_list, rhs, 2);
+  rule_new (g, S_list, rhs, 1);
+  rhs[0] = S_a;
+  rhs[1] = S_n;
+  rule_new (g, S_item, rhs, 2);
+  rhs[0] = S_n;
+  rhs[1] = S_b;
+  rule_new (g, S_item, rhs, 2);
+  rhs[0] = S_c;
+  rhs[1] = S_n;
+  rule_new (g, S_item, rhs, 1);
+  rule_new (g, S_item, rhs, 2);
+  rule_new (g, S_n, rhs, 0);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  return g;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Grammar g;
+  Marpa_Recognizer r;
+  Marpa_Value v;
+  int is_direct;
+  int is_match;
+  int value = 1;
+  int i;
+
+  plan (15);
+
+  g = json_grammar_new ();
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  v = marpa_r_value_unambiguous (r, -1);
+  ok ((!v && marpa_r_error (r, NULL) == MARPA_ERR_NO_PARSE),
+      "no parse before any input");
+  json_read (g, r, JSON_DEPTH, &value);
+  is_match = values_match (g, r, -1, &is_direct);
+  ok (is_direct, "JSON parse of %d tokens is valued directly", value - 1);
+  ok (is_match, "JSON parse has the same steps as its tree");
+  v = marpa_r_value_unambiguous (r, -2);
+  ok ((!v && marpa_r_error (r, NULL) == MARPA_ERR_INVALID_LOCATION),
+      "Earley set -2 is an invalid location");
+  v = marpa_r_value_unambiguous (r, marpa_r_latest_earley_set (r) + 1);
+  ok ((!v && marpa_r_error (r, NULL) == MARPA_ERR_INVALID_LOCATION),
+      "Earley set after the latest is an invalid location");
+  v = marpa_r_value_unambiguous (r, 1);
+  ok ((!v && marpa_r_error (r, NULL) == MARPA_ERR_NO_PARSE),
+      "no parse at Earley set 1");
+  marpa_r_unref (r);
+
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  token_read (g, r, S_lbracket, 1);
+  token_read (g, r, S_rbracket, 2);
+  is_match = values_match (g, r, -1, &is_direct);
+  ok ((is_direct && is_match), "empty array is valued directly");
+  marpa_r_unref (r);
+  marpa_g_unref (g);
+
+  g = list_grammar_new ();
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  for (i = 0; i < LIST_LENGTH; i++)
+    token_read (g, r, (i % 3) ? S_a : S_b, i + 1);
+  is_match = values_match (g, r, -1, &is_direct);
+  ok (is_direct, "list with Leo items and nulls is valued directly");
+  ok (is_match, "list has the same steps as its tree");
+  is_match = values_match (g, r, 1, &is_direct);
+  ok ((is_direct && is_match), "list of one item is valued directly");
+  token_read (g, r, S_c, LIST_LENGTH + 1);
+  is_match = values_match (g, r, -1, &is_direct);
+  ok (!is_direct, "ambiguous list is not valued directly");
+  ok (is_match, "ambiguous list has the same steps as its first tree");
+  marpa_r_unref (r);
+  marpa_g_unref (g);
+
+  g = grammar_new ();
+  S_top = symbol_new (g);
+  S_m = symbol_new (g);
+  S_c = symbol_new (g);
+  {
+    Marpa_Symbol_ID rhs[1];
+    rhs[0] = S_m;
+    rule_new (g, S_top, rhs, 1);
+    rhs[0] = S_c;
+    rule_new (g, S_m, rhs, 1);
+    rule_new (g, S_m, rhs, 0);
+  }
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  is_match = values_match (g, r, -1, &is_direct);
+  ok ((!is_direct && is_match),
+      "nulling parse is valued by way of a bocage");
+  token_read (g, r, S_c, 42);
+  is_match = values_match (g, r, -1, &is_direct);
+  ok ((is_direct && is_match), "one token parse is valued directly");
+  v = marpa_r_value_unambiguous (r, -1);
+  if (!v)
+    fail ("marpa_r_value_unambiguous", g);
+  marpa_r_unref (r);
+  marpa_g_unref (g);
+  ok ((marpa_v_step (v) == MARPA_STEP_TOKEN && marpa_v_token_value (v) == 42),
+      "valuator outlives its recognizer and grammar");
+  marpa_v_unref (v);
+
+  return 0;
+}
@@ -0,0 +1,376 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Lazy bocages: marpa_b_lazy_new().
+ *
+ * The first grammar is
+ *     top ::= list
+ *     list ::= item list
+ *     list ::= item
+ *     item ::= a n
+ *     item ::= b
+ *     n ::=
+ * so that there are Leo items and nulling or-nodes.
+ * Every earleme of its input is either an |a|,
+ * or, ambiguously, both an |a| and a |b|.
+ * The second grammar is
+ *     top ::= e
+ *     e ::= e plus e
+ *     e ::= a
+ * whose parses have a very large number of trees.
+ * A lazy bocage must produce the same trees, in the same order,
+ * as the bocage of marpa_b_new(), and once all of its and-nodes
+ * are created, each of its or-nodes must have the same and-nodes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define LIST_LENGTH 20
+#define AMBIGUITY_MASK 0x2a6d
+#define TERM_COUNT 30
+#define EXPRESSION_TREE_COUNT 20
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+static Marpa_Grammar
+grammar_new (void)
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode = marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  (marpa_g_force_valued (g) >= 0) || fail ("marpa_g_force_valued", g);
+  return g;
+}
+
+static Marpa_Symbol_ID
+symbol_new (Marpa_Grammar g)
+{
+  const Marpa_Symbol_ID symbol_id = marpa_g_symbol_new (g);
+  (symbol_id >= 0) || fail ("marpa_g_symbol_new", g);
+  return symbol_id;
+}
+
+static Marpa_Rule_ID
+rule_new (Marpa_Grammar g, Marpa_Symbol_ID lhs, Marpa_Symbol_ID * rhs,
+          int length)
+{
+  const Marpa_Rule_ID rule_id = marpa_g_rule_new (g, lhs, rhs, length);
+  (rule_id >= 0) || fail ("marpa_g_rule_new", g);
+  return rule_id;
+}
+
+static void
+token_read (Marpa_Grammar g, Marpa_Recognizer r, Marpa_Symbol_ID token_id,
+            int value)
+{
+  (marpa_r_alternative (r, token_id, value, 1) == MARPA_ERR_NONE)
+    || fail ("marpa_r_alternative", g);
+}
+
+static Marpa_Bocage
+bocage_new (Marpa_Grammar g, Marpa_Recognizer r, int is_lazy)
+{
+  const Marpa_Bocage b =
+    is_lazy ? marpa_b_lazy_new (r, -1) : marpa_b_new (r, -1);
+  if (!b)
+    fail (is_lazy ? "marpa_b_lazy_new" : "marpa_b_new", g);
+  return b;
+}
+
+/* Evaluates at most |max_trees| trees of |b|,
+ * ranked if |is_ranked|, and returns a hash of their steps.
+ * The number of trees is put in |*p_tree_count|.
+ */
+static unsigned long
+trees_hash (Marpa_Grammar g, Marpa_Bocage b, int is_ranked,
+            int high_rank_only, int max_trees, int *p_tree_count)
+{
+  Marpa_Order o;
+  Marpa_Tree t;
+  unsigned long hash = 0;
+  int tree_count = 0;
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  if (is_ranked)
+    {
+      (marpa_o_high_rank_only_set (o, high_rank_only) >= 0)
+        || fail ("marpa_o_high_rank_only_set", g);
+      (marpa_o_rank (o) >= 0) || fail ("marpa_o_rank", g);
+    }
+  t = marpa_t_new (o);
+  if (!t)
+    fail ("marpa_t_new", g);
+  while (tree_count < max_trees && marpa_t_next (t) >= 0)
+    {
+      const Marpa_Value v = marpa_v_new (t);
+      if (!v)
+        fail ("marpa_v_new", g);
+      tree_count++;
+      for (;;)
+        {
+          const Marpa_Step_Type step_type = marpa_v_step (v);
+          if (step_type < 0)
+            fail ("marpa_v_step", g);
+          if (step_type == MARPA_STEP_INACTIVE)
+            break;
+          hash = hash * 31 + step_type;
+          switch (step_type)
+            {
+            case MARPA_STEP_RULE:
+              hash = hash * 31 + marpa_v_rule (v);
+              hash = hash * 31 + marpa_v_arg_0 (v);
+              hash = hash * 31 + marpa_v_arg_n (v);
+              break;
+            case MARPA_STEP_TOKEN:
+              hash = hash * 31 + marpa_v_token (v);
+              hash = hash * 31 + marpa_v_token_value (v);
+              hash = hash * 31 + marpa_v_result (v);
+              break;
+            case MARPA_STEP_NULLING_SYMBOL:
+              hash = hash * 31 + marpa_v_symbol (v);
+              hash = hash * 31 + marpa_v_result (v);
+              break;
+            }
+        }
+      marpa_v_unref (v);
+    }
+  marpa_t_unref (t);
+  marpa_o_unref (o);
+  *p_tree_count = tree_count;
+  return hash;
+}
+
+/* Returns 1 if the or-nodes of the bocages have the same and-nodes,
+ * in the same order, 0 otherwise.
+ * And-node IDs are not compared, because a lazy bocage
+ * numbers its and-nodes in the order it creates them.
+ */
+static int
+bocages_match (Marpa_Bocage b1, Marpa_Bocage b2)
+{
+  int or_node_id;
+  if (_marpa_b_top_or_node (b1) != _marpa_b_top_or_node (b2))
+    return 0;
+  for (or_node_id = 0;; or_node_id++)
+    {
+      int and_ix;
+      const int first1 = _marpa_b_or_node_first_and (b1, or_node_id);
+      const int first2 = _marpa_b_or_node_first_and (b2, or_node_id);
+      const int and_count = _marpa_b_or_node_and_count (b1, or_node_id);
+      if (_marpa_b_or_node_and_count (b2, or_node_id) != and_count)
+        return 0;
+      if (and_count < 0)
+        break;
+      for (and_ix = 0; and_ix < and_count; and_ix++)
+        {
+          const int and1 = first1 + and_ix;
+          const int and2 = first2 + and_ix;
+          int value1 = -1;
+          int value2 = -1;
+          if (_marpa_b_and_node_parent (b1, and1) != or_node_id
+              || _marpa_b_and_node_parent (b2, and2) != or_node_id
+              || _marpa_b_and_node_predecessor (b1, and1) !=
+              _marpa_b_and_node_predecessor (b2, and2)
+              || _marpa_b_and_node_cause (b1, and1) !=
+              _marpa_b_and_node_cause (b2, and2)
+              || _marpa_b_and_node_symbol (b1, and1) !=
+              _marpa_b_and_node_symbol (b2, and2)
+              || _marpa_b_and_node_token (b1, and1, &value1) !=
+              _marpa_b_and_node_token (b2, and2, &value2)
+              || value1 != value2)
+            return 0;
+        }
+    }
+  return or_node_id > 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Grammar g;
+  Marpa_Recognizer r;
+  Marpa_Bocage eager_b;
+  Marpa_Bocage lazy_b;
+  Marpa_Symbol_ID S_top, S_list, S_item, S_a, S_b, S_n, S_e, S_plus;
+  Marpa_Symbol_ID rhs[3];
+  Marpa_Rule_ID R_item_b;
+  unsigned long eager_hash;
+  unsigned long lazy_hash;
+  int eager_tree_count;
+  int lazy_tree_count;
+  int eager_and_count;
+  int lazy_and_count;
+  int is_match;
+  int earleme;
+  int rc;
+
+  plan (12);
+
+  g = grammar_new ();
+  S_top = symbol_new (g);
+  S_list = symbol_new (g);
+  S_item = symbol_new (g);
+  S_a = symbol_new (g);
+  S_b = symbol_new (g);
+  S_n = symbol_new (g);
+  rhs[0] = S_list;
+  rule_new (g, S_top, rhs, 1);
+  rhs[0] = S_item;
+  rhs[1] = S_list;
+  rule_new (g, S_list, rhs, 2);
+  rule_new (g, S_list, rhs, 1);
+  rhs[0] = S_a;
+  rhs[1] = S_n;
+  rule_new (g, S_item, rhs, 2);
+  rhs[0] = S_b;
+  R_item_b = rule_new (g, S_item, rhs, 1);
+  rule_new (g, S_n, rhs, 0);
+  (marpa_g_rule_rank_set (g, R_item_b, 1) == 1)
+    || fail ("marpa_g_rule_rank_set", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  for (earleme = 0; earleme < LIST_LENGTH; earleme++)
+    {
+      token_read (g, r, S_a, 2 * earleme + 1);
+      if (AMBIGUITY_MASK & (1 << (earleme % 16)))
+        token_read (g, r, S_b, 2 * earleme + 2);
+      (marpa_r_earleme_complete (r) >= 0)
+        || fail ("marpa_r_earleme_complete", g);
+    }
+
+  eager_b = bocage_new (g, r, 0);
+  lazy_b = bocage_new (g, r, 1);
+  eager_hash = trees_hash (g, eager_b, 0, 0, 1 << 30, &eager_tree_count);
+  lazy_hash = trees_hash (g, lazy_b, 0, 0, 1 << 30, &lazy_tree_count);
+  ok ((eager_tree_count == lazy_tree_count && eager_hash == lazy_hash),
+      "list trees match: %d trees", lazy_tree_count);
+  eager_hash = trees_hash (g, eager_b, 1, 0, 1 << 30, &eager_tree_count);
+  lazy_hash = trees_hash (g, lazy_b, 1, 0, 1 << 30, &lazy_tree_count);
+  ok ((eager_tree_count == lazy_tree_count && eager_hash == lazy_hash),
+      "ranked list trees match: %d trees", lazy_tree_count);
+  eager_hash = trees_hash (g, eager_b, 1, 1, 1 << 30, &eager_tree_count);
+  lazy_hash = trees_hash (g, lazy_b, 1, 1, 1 << 30, &lazy_tree_count);
+  ok ((eager_tree_count == 1 && eager_tree_count == lazy_tree_count
+       && eager_hash == lazy_hash), "high rank only list trees match");
+  ok (bocages_match (eager_b, lazy_b), "list bocages match: %d and-nodes",
+      _marpa_b_and_node_count (lazy_b));
+  marpa_b_unref (lazy_b);
+  marpa_b_unref (eager_b);
+  marpa_r_unref (r);
+  marpa_g_unref (g);
+
+  g = grammar_new ();
+  S_top = symbol_new (g);
+  S_e = symbol_new (g);
+  S_plus = symbol_new (g);
+  S_a = symbol_new (g);
+  rhs[0] = S_e;
+  rule_new (g, S_top, rhs, 1);
+  rhs[1] = S_plus;
+  rhs[2] = S_e;
+  rule_new (g, S_e, rhs, 3);
+  rhs[0] = S_a;
+  rule_new (g, S_e, rhs, 1);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  for (earleme = 0; earleme < 2 * TERM_COUNT - 1; earleme++)
+    {
+      token_read (g, r, earleme % 2 ? S_plus : S_a, earleme + 1);
+      (marpa_r_earleme_complete (r) >= 0)
+        || fail ("marpa_r_earleme_complete", g);
+    }
+
+  eager_b = bocage_new (g, r, 0);
+  eager_and_count = _marpa_b_and_node_count (eager_b);
+  lazy_b = bocage_new (g, r, 1);
+  ok ((_marpa_b_and_node_count (lazy_b) == 0),
+      "lazy bocage starts with no and-nodes");
+  eager_hash =
+    trees_hash (g, eager_b, 0, 0, EXPRESSION_TREE_COUNT, &eager_tree_count);
+  lazy_hash =
+    trees_hash (g, lazy_b, 0, 0, EXPRESSION_TREE_COUNT, &lazy_tree_count);
+  ok ((lazy_tree_count == EXPRESSION_TREE_COUNT
+       && eager_tree_count == lazy_tree_count && eager_hash == lazy_hash),
+      "first %d expression trees match", EXPRESSION_TREE_COUNT);
+  lazy_and_count = _marpa_b_and_node_count (lazy_b);
+  ok ((lazy_and_count * 4 < eager_and_count),
+      "lazy bocage created %d of %d and-nodes",
+      lazy_and_count, eager_and_count);
+
+  rc = marpa_r_truncate (r, 1);
+  ok ((rc == -2
+       && marpa_g_error (g, NULL) == MARPA_ERR_RECCE_HAS_LAZY_BOCAGE),
+      "recognizer cannot be truncated under a lazy bocage");
+
+  ok ((marpa_b_ambiguity_metric (lazy_b) ==
+       marpa_b_ambiguity_metric (eager_b)
+       && _marpa_b_and_node_count (lazy_b) == eager_and_count),
+      "ambiguity metric creates all %d and-nodes", eager_and_count);
+  is_match = bocages_match (eager_b, lazy_b);
+  lazy_hash =
+    trees_hash (g, lazy_b, 0, 0, EXPRESSION_TREE_COUNT, &lazy_tree_count);
+  ok ((is_match && eager_hash == lazy_hash),
+      "expanded expression bocages match");
+  rc = marpa_r_truncate (r, 2 * TERM_COUNT - 3);
+  ok ((rc == 2), "recognizer can be truncated once all and-nodes exist");
+  marpa_b_unref (lazy_b);
+
+  lazy_b = bocage_new (g, r, 1);
+  marpa_b_unref (lazy_b);
+  ok ((marpa_r_truncate (r, 1) == 2 * TERM_COUNT - 4),
+      "recognizer can be truncated after a lazy bocage is unreferenced");
+
+  marpa_b_unref (eager_b);
+  marpa_r_unref (r);
+  marpa_g_unref (g);
+  return 0;
+}
@@ -156,6 +156,14 @@ const Marpa_Method_Error errspec[] = {
   { MARPA_ERR_TERMINAL_IS_LOCKED, "terminal locked" },
   { MARPA_ERR_NULLING_TERMINAL, "nulling terminal" },
   { MARPA_ERR_PRECOMPUTED, "grammar precomputed" },
+  { MARPA_ERR_GRAMMAR_IS_FROZEN, "grammar frozen" },
+  { MARPA_ERR_MEMORY_BUDGET_EXCEEDED, "recognizer memory budget exceeded" },
+  { MARPA_ERR_INVALID_SNAPSHOT, "invalid grammar snapshot" },
+  { MARPA_ERR_INVALID_CHECKPOINT, "invalid recognizer checkpoint" },
+  { MARPA_ERR_EARLEY_SET_IS_LIVE, "earley set is live" },
+  { MARPA_ERR_EARLEY_SET_RELEASED, "earley set released" },
+  { MARPA_ERR_INVALID_TASK_COUNT, "invalid task count" },
+  { MARPA_ERR_RECCE_HAS_LAZY_BOCAGE, "recce has lazy bocage" },
   { MARPA_ERR_SEQUENCE_LHS_NOT_UNIQUE, "sequence lhs not unique" },
   { MARPA_ERR_NOT_A_SEQUENCE, "not a sequence rule" },
   { MARPA_ERR_INVALID_RULE_ID, "invalid rule id" },
@@ -232,7 +240,8 @@ marpa_m_test_func(const char* name, ...)
   Marpa_Grammar g;
   Marpa_Recognizer r;
 
-  int args[MARPA_M_MAX_ARG];
+  /* wide enough for the pointer arguments */
+  intptr_t args[MARPA_M_MAX_ARG];
   char strtok_buf[32];
   char *curr_arg;
   int curr_arg_ix;
@@ -257,9 +266,9 @@ marpa_m_test_func(const char* name, ...)
     if (strcmp(curr_arg, "%s") == 0)        args[curr_arg_ix] = va_arg(va_args, Marpa_Symbol_ID);
     else if (strcmp(curr_arg, "%r") == 0)   args[curr_arg_ix] = va_arg(va_args, Marpa_Rule_ID);
     else if (strcmp(curr_arg, "%i") == 0)   args[curr_arg_ix] = va_arg(va_args, int);
-    else if (strcmp(curr_arg, "%ip") == 0)  args[curr_arg_ix] = va_arg(va_args, int *);
-    else if (strcmp(curr_arg, "%vpp") == 0) args[curr_arg_ix] = va_arg(va_args, void **);
-    else if (strcmp(curr_arg, "%vp") == 0)  args[curr_arg_ix] = va_arg(va_args, void *);
+    else if (strcmp(curr_arg, "%ip") == 0)  args[curr_arg_ix] = (intptr_t)va_arg(va_args, int *);
+    else if (strcmp(curr_arg, "%vpp") == 0) args[curr_arg_ix] = (intptr_t)va_arg(va_args, void **);
+    else if (strcmp(curr_arg, "%vp") == 0)  args[curr_arg_ix] = (intptr_t)va_arg(va_args, void *);
     else
     {
       printf("No variable yet for argument spec %s.\n", curr_arg);
@@ -341,3 +350,17 @@ marpa_m_test_func(const char* name, ...)
 
   va_end(va_args);
 }
+
+/* The memory charged so far against the budget of |r|.
+   Exits if it cannot be read. */
+size_t
+marpa_m_charged_bytes (Marpa_Recognizer r)
+{
+  Marpa_Memory_Stats stats;
+  if (marpa_r_memory_stats (r, &stats) < 0)
+    {
+      printf ("marpa_r_memory_stats returned %d\n", marpa_r_error (r, NULL));
+      exit (1);
+    }
+  return stats.t_charged_bytes;
+}
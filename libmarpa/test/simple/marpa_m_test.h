@@ -25,6 +25,7 @@
 #define MARPA_M_TEST_H 1
 
 #include <stdio.h>
+#include <stdint.h>
 #include "marpa.h"
 
 #include "tap/basic.h"
@@ -78,4 +79,8 @@ char *marpa_m_error_message (Marpa_Error_Code error_code);
 
 int marpa_m_test_func(const char* name, ...);
 
+/* Other helpers shared by the tests */
+
+size_t marpa_m_charged_bytes (Marpa_Recognizer r);
+
 #endif /* MARPA_M_TEST_H */
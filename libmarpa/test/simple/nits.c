@@ -145,7 +145,7 @@ main (int argc, char *argv[])
   Marpa_Grammar g;
   Marpa_Recognizer r;
 
-  plan(20);
+  plan(25);
 
   marpa_c_init (&marpa_configuration);
   g = marpa_g_simple_new(&marpa_configuration);
@@ -193,6 +193,54 @@ main (int argc, char *argv[])
   marpa_m_test("marpa_r_alternative", r, S_C1, 1, 1, MARPA_ERR_NONE);
   marpa_m_test("marpa_r_earleme_complete", r, 1);
 
+  {
+    Marpa_Memory_Stats stats;
+    rc = marpa_r_memory_stats (r, &stats);
+    ok ((rc == 1 && stats.t_earley_set_count == 2
+         && stats.t_earley_item_count > 0 && stats.t_earley_item_size > 0),
+        "marpa_r_memory_stats(): %d sets, %d items of %d bytes",
+        stats.t_earley_set_count, stats.t_earley_item_count,
+        stats.t_earley_item_size);
+  }
+
+  {
+    Marpa_Memory_Stats stats;
+    rc = marpa_r_memory_stats (r, &stats);
+    ok ((rc == 1 && stats.t_earley_set_count == 2
+         && stats.t_earley_item_count > 0
+         && stats.t_postdot_item_count > 0
+         && stats.t_obstack_bytes > 0 && stats.t_psl_bytes > 0),
+        "marpa_r_memory_stats(): %d items, %lu obstack bytes",
+        stats.t_earley_item_count, (unsigned long) stats.t_obstack_bytes);
+  }
+
+  {
+    /* a separate recce, so that the parse above is undisturbed */
+    Marpa_Recognizer r1 = marpa_r_new (g);
+    Marpa_Memory_Stats stats;
+    if (!r1)
+      fail("marpa_r_new", g);
+    if (marpa_r_start_input (r1) < 0)
+      fail("marpa_r_start_input", g);
+    marpa_r_memory_budget_set (r1, 1);
+    rc = marpa_r_alternative (r1, S_C1, 1, 1);
+    if (marpa_r_memory_stats (r1, &stats) < 0)
+      fail("marpa_r_memory_stats", g);
+    ok ((rc == MARPA_ERR_MEMORY_BUDGET_EXCEEDED
+         && marpa_r_error (r1, NULL) == MARPA_ERR_MEMORY_BUDGET_EXCEEDED
+         && stats.t_charged_bytes > marpa_r_memory_budget (r1)),
+        "marpa_r_alternative() over budget: %lu bytes used",
+        (unsigned long) stats.t_charged_bytes);
+    ok ((marpa_r_error (r, NULL) == MARPA_ERR_NONE
+         && marpa_g_error (g, NULL) == MARPA_ERR_MEMORY_BUDGET_EXCEEDED),
+        "budget failure is in its recce, and mirrored in the unfrozen grammar");
+    marpa_r_memory_budget_set (r1, 0);
+    rc = marpa_r_alternative (r1, S_C1, 1, 1);
+    ok ((rc == MARPA_ERR_NONE && marpa_r_earleme_complete (r1) >= 0),
+        "recce continues after its budget is lifted");
+    marpa_r_unref (r1);
+  }
+
   /* marpa_o_high_rank_only_* */
   Marpa_Bocage b = marpa_b_new(r, marpa_r_current_earleme(r));
   if(!b)
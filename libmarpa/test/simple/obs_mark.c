@@ -0,0 +1,176 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Obstack marks: marpa_obs_mark() and marpa_obs_release_to().
+ *
+ * Objects of many sizes are allocated so that they cross
+ * chunk boundaries, and the obstack is released back to marks
+ * taken at different points: at its start, in the middle of a chunk,
+ * and when the current chunk is full.
+ * The objects before the mark must be untouched,
+ * and reallocating after the release must reuse the cached chunks,
+ * so that the obstack does not grow.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "marpa_obs.h"
+
+#include "tap/basic.h"
+
+#define OBJECT_COUNT 2000
+#define CYCLE_COUNT 1000
+#define BIG_OBJECT_SIZE 20000
+
+/* The size of the |n|th object.
+ * The sizes are odd, so that alignment padding is needed.
+ */
+static size_t
+object_size (int n)
+{
+  return (size_t) (1 + (n * 37) % 211);
+}
+
+/* Allocates objects |first| to |last|-1 of the test sequence,
+ * each filled with the low byte of its number,
+ * and records them in |objects|.
+ */
+static void
+objects_alloc (struct marpa_obstack *obs, char **objects, int first, int last)
+{
+  int n;
+  for (n = first; n < last; n++)
+    {
+      const size_t size = object_size (n);
+      objects[n] = marpa_obs_new (obs, char, size);
+      memset (objects[n], n & 0xff, size);
+    }
+}
+
+/* Returns 1 if objects |first| to |last|-1 are untouched */
+static int
+objects_check (char **objects, int first, int last)
+{
+  int n;
+  for (n = first; n < last; n++)
+    {
+      const size_t size = object_size (n);
+      size_t i;
+      for (i = 0; i < size; i++)
+        if (objects[n][i] != (char) (n & 0xff))
+          return 0;
+    }
+  return 1;
+}
+
+int
+main (int argc, char *argv[])
+{
+  static char *objects[OBJECT_COUNT];
+  struct marpa_obstack_budget budget = { 0, 0 };
+  struct marpa_obstack *obs;
+  struct marpa_obstack_mark start_mark;
+  struct marpa_obstack_mark middle_mark;
+  struct marpa_obstack_mark full_mark;
+  size_t full_size;
+  size_t big_size;
+  double *aligned;
+  int is_cycle_ok = 1;
+  int cycle;
+
+  plan (12);
+
+  obs = marpa_obs_init;
+  marpa_obs_budget_attach (obs, &budget);
+  start_mark = marpa_obs_mark (obs);
+  objects_alloc (obs, objects, 0, OBJECT_COUNT);
+  full_size = marpa_obs_total_size (obs);
+  ok ((full_size > 10 * 4096),
+      "objects fill %lu bytes of chunks", (unsigned long) full_size);
+
+  marpa_obs_release_to (obs, start_mark);
+  ok ((obs->chunk == start_mark.chunk
+       && obs->next_free == start_mark.next_free
+       && obs->object_base == start_mark.next_free),
+      "release to the start mark returns to the first chunk");
+  ok ((marpa_obs_total_size (obs) == full_size && budget.used == full_size),
+      "released chunks stay in the cache");
+  objects_alloc (obs, objects, 0, OBJECT_COUNT);
+  ok ((marpa_obs_total_size (obs) == full_size && objects_check (objects, 0,
+                                                                  OBJECT_COUNT)),
+      "reallocation reuses the cached chunks");
+
+  /* A mark in the middle of a chunk */
+  marpa_obs_release_to (obs, start_mark);
+  objects_alloc (obs, objects, 0, OBJECT_COUNT / 2);
+  middle_mark = marpa_obs_mark (obs);
+  objects_alloc (obs, objects, OBJECT_COUNT / 2, OBJECT_COUNT);
+  for (cycle = 0; cycle < CYCLE_COUNT; cycle++)
+    {
+      const int last = OBJECT_COUNT / 2 + cycle % (OBJECT_COUNT / 2) + 1;
+      marpa_obs_release_to (obs, middle_mark);
+      if (!objects_check (objects, 0, OBJECT_COUNT / 2))
+        is_cycle_ok = 0;
+      objects_alloc (obs, objects, OBJECT_COUNT / 2, last);
+      if (!objects_check (objects, OBJECT_COUNT / 2, last))
+        is_cycle_ok = 0;
+    }
+  ok (is_cycle_ok, "%d release cycles keep the objects before the mark",
+      CYCLE_COUNT);
+  ok ((marpa_obs_total_size (obs) == full_size),
+      "release cycles do not grow the obstack");
+
+  /* A mark taken when the current chunk is full */
+  marpa_obs_release_to (obs, start_mark);
+  while (marpa_obstack_room (obs) > 0)
+    *marpa_obs_new (obs, char, 1) = 'a';
+  full_mark = marpa_obs_mark (obs);
+  *marpa_obs_new (obs, char, 1) = 'b';
+  ok ((obs->chunk != full_mark.chunk),
+      "allocation after a full chunk starts a new chunk");
+  marpa_obs_release_to (obs, full_mark);
+  ok ((obs->chunk == full_mark.chunk && marpa_obstack_room (obs) == 0),
+      "release to the end of a full chunk");
+  aligned = marpa_obs_new (obs, double, 1);
+  *aligned = 42.0;
+  ok (((size_t) aligned % ALIGNOF (double) == 0 && *aligned == 42.0),
+      "object after the release is aligned");
+
+  /* Chunks larger than the standard size are freed, not cached */
+  marpa_obs_release_to (obs, start_mark);
+  objects_alloc (obs, objects, 0, 10);
+  middle_mark = marpa_obs_mark (obs);
+  objects[10] = marpa_obs_new (obs, char, BIG_OBJECT_SIZE);
+  memset (objects[10], 0, BIG_OBJECT_SIZE);
+  big_size = marpa_obs_total_size (obs);
+  ok ((big_size > full_size && budget.used == big_size),
+      "a big object gets a chunk of its own");
+  marpa_obs_release_to (obs, middle_mark);
+  ok ((marpa_obs_total_size (obs) == full_size && budget.used == full_size),
+      "the big chunk is freed by the release");
+  ok (objects_check (objects, 0, 10),
+      "objects before the big one are untouched");
+
+  marpa_obs_free (obs);
+  return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Grammar snapshots: marpa_g_serialize() and marpa_g_load_mapped().
+ *
+ * The grammar is
+ *     top ::= pair+
+ *     pair ::= A a
+ *     A ::= a
+ *     A ::= a a
+ *     A ::=
+ * It is ambiguous, and has a nullable, a sequence
+ * and a prediction event on A.
+ * A grammar loaded from its snapshot must parse
+ * exactly as the original does.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define INPUT_LENGTH 4
+
+static Marpa_Symbol_ID S_top, S_pair, S_A, S_a;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+static Marpa_Grammar
+grammar_new (Marpa_Config * config)
+{
+  Marpa_Grammar g;
+  Marpa_Symbol_ID rhs[2];
+  g = marpa_g_new (config);
+  if (!g)
+    {
+      Marpa_Error_Code errcode = marpa_c_error (config, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_pair = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_A = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  (marpa_g_sequence_new (g, S_top, S_pair, -1, 1, 0) >= 0)
+    || fail ("marpa_g_sequence_new", g);
+  rhs[0] = S_A;
+  rhs[1] = S_a;
+  (marpa_g_rule_new (g, S_pair, rhs, 2) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_a;
+  rhs[1] = S_a;
+  (marpa_g_rule_new (g, S_A, rhs, 1) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_rule_new (g, S_A, rhs, 2) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_rule_new (g, S_A, rhs, 0) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_symbol_is_prediction_event_set (g, S_A, 1) >= 0)
+    || fail ("marpa_g_symbol_is_prediction_event_set", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  return g;
+}
+
+/* Parses the input, records the size of each Earley set
+ * and the number of prediction events,
+ * and returns the number of parse trees.
+ */
+static int
+parse (Marpa_Grammar g, int *set_sizes, int *event_count)
+{
+  Marpa_Recognizer r;
+  Marpa_Bocage b;
+  Marpa_Order o;
+  Marpa_Tree t;
+  int earleme;
+  int tree_count = 0;
+
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  *event_count = marpa_r_event_count (r);
+  for (earleme = 0; earleme < INPUT_LENGTH; earleme++)
+    {
+      (marpa_r_alternative (r, S_a, 1, 1) == MARPA_ERR_NONE)
+        || fail ("marpa_r_alternative", g);
+      (marpa_r_earleme_complete (r) >= 0)
+        || fail ("marpa_r_earleme_complete", g);
+      *event_count += marpa_r_event_count (r);
+    }
+  for (earleme = 0; earleme <= INPUT_LENGTH; earleme++)
+    {
+      set_sizes[earleme] = _marpa_r_earley_set_size (r, earleme);
+    }
+  b = marpa_b_new (r, -1);
+  if (!b)
+    fail ("marpa_b_new", g);
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  t = marpa_t_new (o);
+  if (!t)
+    fail ("marpa_t_new", g);
+  while (marpa_t_next (t) >= 0)
+    tree_count++;
+  marpa_t_unref (t);
+  marpa_o_unref (o);
+  marpa_b_unref (b);
+  marpa_r_unref (r);
+  return tree_count;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Grammar g_loaded;
+  char *snapshot;
+  char *copy;
+  int size;
+  int rc;
+  int set_sizes[INPUT_LENGTH + 1];
+  int loaded_set_sizes[INPUT_LENGTH + 1];
+  int event_count;
+  int loaded_event_count;
+  int tree_count;
+  int loaded_tree_count;
+
+  plan (11);
+
+  marpa_c_init (&marpa_configuration);
+  g = grammar_new (&marpa_configuration);
+
+  rc = marpa_g_serialize (g, NULL, 0);
+  ok ((rc == -2 && marpa_g_error (g, NULL) == MARPA_ERR_NOT_PRECOMPUTED),
+      "marpa_g_serialize() fails before precomputation");
+
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  tree_count = parse (g, set_sizes, &event_count);
+
+  size = marpa_g_serialize (g, NULL, 0);
+  ok ((size > 0), "snapshot size is %d bytes", size);
+
+  /* One extra byte, so that the snapshot can be loaded
+   * from an unaligned address
+   */
+  snapshot = malloc ((size_t) size + 1);
+  rc = marpa_g_serialize (g, snapshot + 1, (size_t) size);
+  ok ((rc == size), "marpa_g_serialize() wrote %d bytes", rc);
+  marpa_g_unref (g);
+
+  g_loaded =
+    marpa_g_load_mapped (&marpa_configuration, snapshot + 1, (size_t) size);
+  ok ((g_loaded != NULL && marpa_g_is_precomputed (g_loaded) == 1),
+      "loaded grammar is precomputed");
+  if (!g_loaded)
+    exit (1);
+
+  /* Corrupt copies of the snapshot */
+  copy = malloc ((size_t) size);
+  memcpy (copy, snapshot + 1, (size_t) size);
+  copy[size / 2] ^= 1;
+  g = marpa_g_load_mapped (&marpa_configuration, copy, (size_t) size);
+  ok ((g == NULL
+       && marpa_c_error (&marpa_configuration,
+                         NULL) == MARPA_ERR_INVALID_SNAPSHOT),
+      "corrupted snapshot is rejected");
+  g = marpa_g_load_mapped (&marpa_configuration, snapshot + 1,
+                           (size_t) size - 1);
+  ok ((g == NULL
+       && marpa_c_error (&marpa_configuration,
+                         NULL) == MARPA_ERR_INVALID_SNAPSHOT),
+      "truncated snapshot is rejected");
+  /* The major version follows the magic number in the header */
+  memcpy (copy, snapshot + 1, (size_t) size);
+  ((int *) copy)[1]++;
+  g = marpa_g_load_mapped (&marpa_configuration, copy, (size_t) size);
+  ok ((g == NULL
+       && marpa_c_error (&marpa_configuration,
+                         NULL) == MARPA_ERR_MAJOR_VERSION_MISMATCH),
+      "snapshot from another major version is rejected");
+  free (copy);
+
+  /* The loaded grammar does not refer to the snapshot */
+  memset (snapshot, 0, (size_t) size + 1);
+  free (snapshot);
+
+  loaded_tree_count = parse (g_loaded, loaded_set_sizes, &loaded_event_count);
+  ok ((memcmp (set_sizes, loaded_set_sizes, sizeof (set_sizes)) == 0),
+      "Earley sets of loaded grammar match: last has %d items",
+      loaded_set_sizes[INPUT_LENGTH]);
+  ok ((tree_count > 1 && loaded_tree_count == tree_count),
+      "loaded grammar has %d parse trees", loaded_tree_count);
+  ok ((event_count > 0 && loaded_event_count == event_count),
+      "loaded grammar has %d prediction events", loaded_event_count);
+
+  rc = marpa_g_serialize (g_loaded, NULL, 0);
+  ok ((rc == size), "loaded grammar can be serialized");
+
+  marpa_g_unref (g_loaded);
+  return 0;
+}
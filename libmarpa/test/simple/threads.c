@@ -0,0 +1,235 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Stress test for recognizers sharing a frozen grammar.
+ * Each thread creates, uses and destroys recognizers in a loop,
+ * and also fails to create bocages, so that the error paths
+ * are exercised in several threads at once.
+ * Intended to be run under ThreadSanitizer as well as normally.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define THREAD_COUNT 8
+#define ITERATION_COUNT 1000
+
+static Marpa_Symbol_ID S_top, S_a, S_b;
+
+struct thread_data
+{
+  Marpa_Grammar g;
+  int failures;
+  int exhausted_events;
+  int error_failures;
+};
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+/* Returns 1 if the parse of "a b" went as expected,
+ * 0 otherwise.
+ */
+static int
+parse_once (Marpa_Grammar g, struct thread_data *data)
+{
+  Marpa_Recognizer r;
+  Marpa_Event event;
+  int event_count;
+  int event_ix;
+
+  r = marpa_r_new (g);
+  if (!r)
+    return 0;
+  if (marpa_r_start_input (r) < 0)
+    goto FAILURE;
+  if (marpa_r_alternative (r, S_a, 1, 1) != MARPA_ERR_NONE)
+    goto FAILURE;
+  if (marpa_r_earleme_complete (r) < 0)
+    goto FAILURE;
+  if (marpa_r_alternative (r, S_b, 1, 1) != MARPA_ERR_NONE)
+    goto FAILURE;
+  event_count = marpa_r_earleme_complete (r);
+  if (event_count < 0)
+    goto FAILURE;
+  if (event_count != marpa_r_event_count (r))
+    goto FAILURE;
+  if (!marpa_r_is_exhausted (r))
+    goto FAILURE;
+  for (event_ix = 0; event_ix < event_count; event_ix++)
+    {
+      if (marpa_r_event (r, &event, event_ix) == MARPA_EVENT_EXHAUSTED)
+        data->exhausted_events++;
+    }
+  marpa_r_unref (r);
+  return 1;
+FAILURE:
+  marpa_r_unref (r);
+  return 0;
+}
+
+/* Returns 1 if each failed bocage creation
+ * reported the expected error in its recognizer,
+ * 0 otherwise.
+ */
+static int
+fail_bocages_once (Marpa_Grammar g)
+{
+  int result = 0;
+  Marpa_Recognizer r = marpa_r_new (g);
+  if (!r)
+    return 0;
+  if (marpa_b_new (r, 0) != NULL
+      || marpa_r_error (r, NULL) != MARPA_ERR_RECCE_NOT_STARTED)
+    goto DONE;
+  if (marpa_r_start_input (r) < 0)
+    goto DONE;
+  if (marpa_b_new (r, 0) != NULL
+      || marpa_r_error (r, NULL) != MARPA_ERR_NO_PARSE)
+    goto DONE;
+  if (marpa_b_new (r, 42) != NULL
+      || marpa_r_error (r, NULL) != MARPA_ERR_INVALID_LOCATION)
+    goto DONE;
+  result = 1;
+DONE:
+  marpa_r_unref (r);
+  return result;
+}
+
+static void *
+worker (void *arg)
+{
+  struct thread_data *data = arg;
+  int i;
+  for (i = 0; i < ITERATION_COUNT; i++)
+    {
+      if (!parse_once (data->g, data))
+        data->failures++;
+      if (!fail_bocages_once (data->g))
+        data->error_failures++;
+    }
+  return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Symbol_ID rhs[2];
+  pthread_t threads[THREAD_COUNT];
+  struct thread_data data[THREAD_COUNT];
+  int thread_ix;
+  int failures = 0;
+  int exhausted_events = 0;
+  int error_failures = 0;
+  int rc;
+
+  plan (8);
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode =
+        marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_b = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  rhs[0] = S_a;
+  rhs[1] = S_b;
+  (marpa_g_rule_new (g, S_top, rhs, 2) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+
+  rc = marpa_g_freeze (g);
+  ok ((rc == -2), "marpa_g_freeze fails before precomputation");
+  marpa_g_error_clear (g);
+
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+  rc = marpa_g_freeze (g);
+  ok ((rc == 1), "marpa_g_freeze returned %d", rc);
+  rc = marpa_g_is_frozen (g);
+  ok ((rc == 1), "marpa_g_is_frozen returned %d", rc);
+  rc = marpa_g_force_valued (g);
+  ok ((rc == -2 && marpa_g_error (g, NULL) == MARPA_ERR_NONE),
+      "marpa_g_force_valued fails on a frozen grammar, without writing it");
+
+  for (thread_ix = 0; thread_ix < THREAD_COUNT; thread_ix++)
+    {
+      data[thread_ix].g = g;
+      data[thread_ix].failures = 0;
+      data[thread_ix].exhausted_events = 0;
+      data[thread_ix].error_failures = 0;
+      if (pthread_create (&threads[thread_ix], NULL, worker, &data[thread_ix]))
+        {
+          perror ("pthread_create");
+          exit (1);
+        }
+    }
+  for (thread_ix = 0; thread_ix < THREAD_COUNT; thread_ix++)
+    {
+      pthread_join (threads[thread_ix], NULL);
+      failures += data[thread_ix].failures;
+      exhausted_events += data[thread_ix].exhausted_events;
+      error_failures += data[thread_ix].error_failures;
+    }
+
+  ok ((failures == 0), "%d threads parsed without failures: %d",
+      THREAD_COUNT, failures);
+  ok ((exhausted_events == THREAD_COUNT * ITERATION_COUNT),
+      "each recognizer saw its own exhaustion event: %d", exhausted_events);
+  ok ((error_failures == 0 && marpa_g_error (g, NULL) == MARPA_ERR_NONE),
+      "failed bocages reported their errors in their recognizers: %d",
+      error_failures);
+
+  {
+    Marpa_Recognizer r1 = marpa_r_new (g);
+    Marpa_Recognizer r2 = marpa_r_new (g);
+    (r1 && r2) || fail ("marpa_r_new", g);
+    (marpa_r_start_input (r2) >= 0) || fail ("marpa_r_start_input", g);
+    rc = marpa_r_earleme_complete (r1);
+    ok ((rc == -2
+         && marpa_r_error (r1, NULL) != MARPA_ERR_NONE
+         && marpa_r_error (r2, NULL) == MARPA_ERR_NONE
+         && marpa_g_error (g, NULL) == MARPA_ERR_NONE),
+        "recognizer error is kept out of the frozen grammar and its other recognizers");
+    marpa_r_unref (r1);
+    marpa_r_unref (r2);
+  }
+
+  marpa_g_unref (g);
+  return 0;
+}
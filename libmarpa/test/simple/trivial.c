@@ -190,14 +190,14 @@ main (int argc, char *argv[])
     int spurious_events = 0;
     int spurious_nulled_events = 0;
     int event_ix;
-    const int event_count = marpa_g_event_count (g);
+    const int event_count = marpa_r_event_count (r);
     int *nulled_symbols = calloc ((highest_symbol_id + 1), sizeof (int));
     if (!nulled_symbols) abort();
     ok ((event_count == 8), "event count at earleme 0 is %ld",
 	(long) event_count);
     for (event_ix = 0; event_ix < event_count; event_ix++)
       {
-	int event_type = marpa_g_event (g, &event, event_ix);
+	int event_type = marpa_r_event (r, &event, event_ix);
 	if (event_type == MARPA_EVENT_SYMBOL_NULLED)
 	  {
 	    const Marpa_Symbol_ID event_symbol_id = marpa_g_event_value(&event);
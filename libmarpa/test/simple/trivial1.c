@@ -246,6 +246,7 @@ main (int argc, char *argv[])
   /* terminals are locked after setting, so we recreate the grammar */
   marpa_g_unref(g);
   g = marpa_g_trivial_new(&marpa_configuration);
+  marpa_m_grammar_set(g);
 
   marpa_m_test("marpa_g_precompute", g, -2, MARPA_ERR_NO_START_SYMBOL);
 
@@ -302,6 +303,7 @@ main (int argc, char *argv[])
   /* recreate the grammar */
   marpa_g_unref(g);
   g = marpa_g_trivial_new(&marpa_configuration);
+  marpa_m_grammar_set(g);
 
   /* try to add a nulling sequence */
   marpa_m_test("marpa_g_sequence_new", g, S_top, S_B1, S_B2, 0, MARPA_PROPER_SEPARATION,
@@ -379,6 +381,7 @@ main (int argc, char *argv[])
   /* recreate the grammar to test event methods except nulled */
   marpa_g_unref(g);
   g = marpa_g_trivial_new(&marpa_configuration);
+  marpa_m_grammar_set(g);
 
   /* Events */
   /* test that attempts to create events, other than nulled events,
@@ -484,13 +487,13 @@ main (int argc, char *argv[])
       int prediction_events = 0;
       int completion_events = 0;
       int event_ix;
-      const int event_count = marpa_g_event_count (g);
+      const int event_count = marpa_r_event_count (r);
 
       is_int(1, event_count, "event count at earleme 0 is %ld", (long) event_count);
 
       for (event_ix = 0; event_ix < event_count; event_ix++)
       {
-        int event_type = marpa_g_event (g, &event, event_ix);
+        int event_type = marpa_r_event (r, &event, event_ix);
         if (event_type == MARPA_EVENT_SYMBOL_COMPLETED)
           completion_events++;
         else if (event_type == MARPA_EVENT_SYMBOL_PREDICTED)
@@ -0,0 +1,242 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Truncating a recognizer: marpa_r_truncate().
+ *
+ * The grammar is
+ *     top ::= list
+ *     list ::= item list
+ *     list ::= item
+ *     item ::= a
+ *     item ::= b
+ * so that the right recursion creates Leo items.
+ * Every earleme of the input is either an |a|,
+ * or, ambiguously, both an |a| and a |b|.
+ * A recognizer which reads a wrong suffix, is truncated,
+ * and then reads the right suffix, must end up the same as one
+ * which read the right input in the first place.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+#include "marpa_m_test.h"
+
+#define INPUT_LENGTH 12
+#define EDIT_EARLEME 5
+#define EDIT_COUNT 500
+
+static Marpa_Symbol_ID S_top, S_list, S_item, S_a, S_b;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+/* Reads the input from the current earleme up to |end_earleme|.
+ * The earlemes whose bits are set in |ambiguity_mask|
+ * have both an |a| and a |b|.
+ */
+static void
+read_input (Marpa_Grammar g, Marpa_Recognizer r, int end_earleme,
+            int ambiguity_mask)
+{
+  int earleme;
+  for (earleme = marpa_r_current_earleme (r); earleme < end_earleme;
+       earleme++)
+    {
+      (marpa_r_alternative (r, S_a, 1, 1) == MARPA_ERR_NONE)
+        || fail ("marpa_r_alternative", g);
+      if (ambiguity_mask & (1 << earleme))
+        (marpa_r_alternative (r, S_b, 1, 1) == MARPA_ERR_NONE)
+          || fail ("marpa_r_alternative", g);
+      (marpa_r_earleme_complete (r) >= 0)
+        || fail ("marpa_r_earleme_complete", g);
+    }
+}
+
+static int
+earley_sets_match (Marpa_Recognizer r1, Marpa_Recognizer r2)
+{
+  int earley_set;
+  const int latest = marpa_r_latest_earley_set (r1);
+  if (marpa_r_latest_earley_set (r2) != latest)
+    return 0;
+  for (earley_set = 0; earley_set <= latest; earley_set++)
+    {
+      if (_marpa_r_earley_set_size (r1, earley_set) !=
+          _marpa_r_earley_set_size (r2, earley_set))
+        return 0;
+    }
+  return 1;
+}
+
+/* The number of parse trees at the latest Earley set */
+static int
+tree_count (Marpa_Grammar g, Marpa_Recognizer r)
+{
+  Marpa_Bocage b;
+  Marpa_Order o;
+  Marpa_Tree t;
+  int count = 0;
+  b = marpa_b_new (r, -1);
+  if (!b)
+    fail ("marpa_b_new", g);
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  t = marpa_t_new (o);
+  if (!t)
+    fail ("marpa_t_new", g);
+  while (marpa_t_next (t) >= 0)
+    count++;
+  marpa_t_unref (t);
+  marpa_o_unref (o);
+  marpa_b_unref (b);
+  return count;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Recognizer r1;
+  Marpa_Recognizer r2;
+  Marpa_Symbol_ID rhs[2];
+  const int right_mask = 0x0a6;
+  const int wrong_mask = 0xf00;
+  size_t first_memory_used = 0;
+  size_t max_memory_used = 0;
+  int is_edit_ok = 1;
+  int edit;
+  int rc;
+
+  plan (11);
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode = marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_list = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_item = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_b = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  rhs[0] = S_list;
+  (marpa_g_rule_new (g, S_top, rhs, 1) >= 0) || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_item;
+  rhs[1] = S_list;
+  (marpa_g_rule_new (g, S_list, rhs, 2) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  (marpa_g_rule_new (g, S_list, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_a;
+  (marpa_g_rule_new (g, S_item, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_b;
+  (marpa_g_rule_new (g, S_item, rhs, 1) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+
+  r1 = marpa_r_new (g);
+  if (!r1)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r1) >= 0) || fail ("marpa_r_start_input", g);
+  read_input (g, r1, INPUT_LENGTH, right_mask);
+
+  r2 = marpa_r_new (g);
+  if (!r2)
+    fail ("marpa_r_new", g);
+  rc = marpa_r_truncate (r2, 0);
+  ok ((rc == -2 && marpa_g_error (g, NULL) == MARPA_ERR_RECCE_NOT_STARTED),
+      "marpa_r_truncate() fails before input is started");
+  (marpa_r_start_input (r2) >= 0) || fail ("marpa_r_start_input", g);
+  read_input (g, r2, EDIT_EARLEME, right_mask);
+  read_input (g, r2, INPUT_LENGTH, wrong_mask);
+  ok ((tree_count (g, r2) != tree_count (g, r1)),
+      "the wrong suffix is parsed differently");
+
+  rc = marpa_r_truncate (r2, INPUT_LENGTH + 1);
+  ok ((rc == -2
+       && marpa_g_error (g, NULL) == MARPA_ERR_NO_EARLEY_SET_AT_LOCATION),
+      "cannot truncate to an Earley set that does not exist");
+  rc = marpa_r_truncate (r2, -1);
+  ok ((rc == -2 && marpa_g_error (g, NULL) == MARPA_ERR_INVALID_LOCATION),
+      "cannot truncate to a negative Earley set");
+
+  rc = marpa_r_truncate (r2, EDIT_EARLEME);
+  ok ((rc == INPUT_LENGTH - EDIT_EARLEME),
+      "%d Earley sets were discarded", rc);
+  ok ((marpa_r_latest_earley_set (r2) == EDIT_EARLEME
+       && marpa_r_current_earleme (r2) == EDIT_EARLEME
+       && marpa_r_furthest_earleme (r2) == EDIT_EARLEME),
+      "truncated recognizer is at earleme %d", EDIT_EARLEME);
+  ok ((marpa_r_terminal_is_expected (r2, S_a) == 1),
+      "truncated recognizer expects its terminals again");
+
+  read_input (g, r2, INPUT_LENGTH, right_mask);
+  ok (earley_sets_match (r1, r2),
+      "Earley sets match after the right suffix: last has %d items",
+      _marpa_r_earley_set_size (r2, INPUT_LENGTH));
+  ok ((tree_count (g, r2) == tree_count (g, r1)),
+      "parses match after the right suffix: %d trees", tree_count (g, r1));
+
+  for (edit = 0; edit < EDIT_COUNT; edit++)
+    {
+      const int edit_earleme = 1 + edit % (INPUT_LENGTH - 1);
+      size_t memory_used;
+      if (marpa_r_truncate (r2, edit_earleme) !=
+          INPUT_LENGTH - edit_earleme)
+        is_edit_ok = 0;
+      read_input (g, r2, INPUT_LENGTH, edit % 2 ? right_mask : wrong_mask);
+      memory_used = marpa_m_charged_bytes (r2);
+      if (edit < 2 * INPUT_LENGTH)
+        first_memory_used =
+          memory_used > first_memory_used ? memory_used : first_memory_used;
+      else if (memory_used > max_memory_used)
+        max_memory_used = memory_used;
+    }
+  marpa_r_truncate (r2, 0);
+  read_input (g, r2, INPUT_LENGTH, right_mask);
+  ok ((is_edit_ok && earley_sets_match (r1, r2)),
+      "Earley sets match after %d edits", EDIT_COUNT);
+  ok ((max_memory_used <= first_memory_used),
+      "memory stayed bounded: %lu bytes in the first edits, at most %lu after",
+      (unsigned long) first_memory_used, (unsigned long) max_memory_used);
+
+  marpa_r_unref (r1);
+  marpa_r_unref (r2);
+  marpa_g_unref (g);
+  return 0;
+}
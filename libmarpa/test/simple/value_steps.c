@@ -0,0 +1,268 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Stepping a valuator in batches: marpa_v_steps().
+ *
+ * The grammar is
+ *     top ::= item*
+ *     item ::= a n
+ *     item ::= n b
+ *     n ::=
+ * with all symbols valued, so that there are token, rule
+ * and nulling symbol steps.
+ * The records written by marpa_v_steps() must be the same
+ * as the steps taken, one at a time, by marpa_v_step(),
+ * whatever the size of the batches.
+ * The result of every step is in the record's |t_arg_0|.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+
+#define INPUT_LENGTH 50
+#define MAX_STEPS 1000
+
+static Marpa_Symbol_ID S_top, S_item, S_a, S_b, S_n;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+static Marpa_Value
+value_new (Marpa_Grammar g, Marpa_Recognizer r)
+{
+  Marpa_Bocage b;
+  Marpa_Order o;
+  Marpa_Tree t;
+  Marpa_Value v;
+  b = marpa_b_new (r, -1);
+  if (!b)
+    fail ("marpa_b_new", g);
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  t = marpa_t_new (o);
+  if (!t)
+    fail ("marpa_t_new", g);
+  (marpa_t_next (t) >= 0) || fail ("marpa_t_next", g);
+  v = marpa_v_new (t);
+  if (!v)
+    fail ("marpa_v_new", g);
+  marpa_t_unref (t);
+  marpa_o_unref (o);
+  marpa_b_unref (b);
+  return v;
+}
+
+/* Steps through |v| one step at a time, recording the steps in
+ * |steps|.  Returns the number of steps.
+ */
+static int
+steps_by_one (Marpa_Grammar g, Marpa_Value v, Marpa_Step * steps)
+{
+  int step_count = 0;
+  for (;;)
+    {
+      const Marpa_Step_Type step_type = marpa_v_step (v);
+      Marpa_Step *const step = steps + step_count;
+      if (step_type < 0)
+        fail ("marpa_v_step", g);
+      if (step_type == MARPA_STEP_INACTIVE)
+        break;
+      if (step_count >= MAX_STEPS)
+        fail ("too many steps", g);
+      step->t_step_type = step_type;
+      step->t_id = -1;
+      step->t_value = -1;
+      if (step_type == MARPA_STEP_RULE)
+        step->t_id = marpa_v_rule (v);
+      if (step_type == MARPA_STEP_TOKEN
+          || step_type == MARPA_STEP_NULLING_SYMBOL)
+        step->t_id = marpa_v_token (v);
+      if (step_type == MARPA_STEP_TOKEN)
+        step->t_value = marpa_v_token_value (v);
+      step->t_arg_0 = marpa_v_result (v);
+      step->t_arg_n = marpa_v_arg_n (v);
+      step_count++;
+    }
+  return step_count;
+}
+
+/* Steps through |v| in batches of |batch_size|,
+ * and returns 1 if the records match the |expected_count| steps
+ * in |expected|, and the valuator's accessors match the
+ * last record of every batch.
+ */
+static int
+steps_match (Marpa_Grammar g, Marpa_Value v, int batch_size,
+             const Marpa_Step * expected, int expected_count)
+{
+  Marpa_Step steps[MAX_STEPS];
+  int step_count = 0;
+  for (;;)
+    {
+      int ix;
+      const Marpa_Step *last;
+      const int rc = marpa_v_steps (v, steps, batch_size);
+      if (rc < 0)
+        fail ("marpa_v_steps", g);
+      if (rc > batch_size || step_count + rc > expected_count)
+        return 0;
+      for (ix = 0; ix < rc; ix++)
+        {
+          const Marpa_Step *const step = steps + ix;
+          const Marpa_Step *const expected_step = expected + step_count + ix;
+          if (step->t_step_type != expected_step->t_step_type
+              || step->t_id != expected_step->t_id
+              || step->t_arg_0 != expected_step->t_arg_0
+              || step->t_arg_n != expected_step->t_arg_n
+              || step->t_value != expected_step->t_value)
+            return 0;
+        }
+      step_count += rc;
+      if (rc < batch_size)
+        break;
+      last = steps + rc - 1;
+      if (marpa_v_step_type (v) != last->t_step_type
+          || marpa_v_result (v) != last->t_arg_0
+          || marpa_v_arg_n (v) != last->t_arg_n)
+        return 0;
+    }
+  return step_count == expected_count
+    && marpa_v_step_type (v) == MARPA_STEP_INACTIVE
+    && marpa_v_steps (v, steps, batch_size) == 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Recognizer r;
+  Marpa_Value v;
+  Marpa_Symbol_ID rhs[2];
+  Marpa_Step expected[MAX_STEPS];
+  Marpa_Step steps[1];
+  int expected_count;
+  int earleme;
+  int rc;
+
+  plan (9);
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode = marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  (marpa_g_force_valued (g) >= 0) || fail ("marpa_g_force_valued", g);
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_item = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_b = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_n = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  (marpa_g_sequence_new (g, S_top, S_item, -1, 0, 0) >= 0)
+    || fail ("marpa_g_sequence_new", g);
+  rhs[0] = S_a;
+  rhs[1] = S_n;
+  (marpa_g_rule_new (g, S_item, rhs, 2) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  rhs[0] = S_n;
+  rhs[1] = S_b;
+  (marpa_g_rule_new (g, S_item, rhs, 2) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  (marpa_g_rule_new (g, S_n, rhs, 0) >= 0) || fail ("marpa_g_rule_new", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+
+  v = value_new (g, r);
+  rc = marpa_v_steps (v, steps, 1);
+  ok ((rc == 1 && steps[0].t_step_type == MARPA_STEP_NULLING_SYMBOL
+       && steps[0].t_id == S_top && steps[0].t_arg_0 == 0
+       && marpa_v_steps (v, steps, 1) == 0),
+      "nulling parse is a single nulling symbol step");
+  marpa_v_unref (v);
+
+  for (earleme = 0; earleme < INPUT_LENGTH; earleme++)
+    {
+      const Marpa_Symbol_ID token_id = earleme % 3 ? S_a : S_b;
+      (marpa_r_alternative (r, token_id, earleme + 1, 1) == MARPA_ERR_NONE)
+        || fail ("marpa_r_alternative", g);
+      (marpa_r_earleme_complete (r) >= 0)
+        || fail ("marpa_r_earleme_complete", g);
+    }
+
+  v = value_new (g, r);
+  expected_count = steps_by_one (g, v, expected);
+  ok ((expected_count > 3 * INPUT_LENGTH),
+      "marpa_v_step() took %d steps", expected_count);
+  rc = marpa_v_steps (v, NULL, 0);
+  ok ((rc == 0), "an inactive valuator takes no steps");
+  marpa_v_unref (v);
+
+  v = value_new (g, r);
+  rc = marpa_v_steps (v, NULL, 1);
+  ok ((rc == -2 && marpa_g_error (g, NULL) == MARPA_ERR_POINTER_ARG_NULL),
+      "marpa_v_steps() fails with a null array");
+  ok ((marpa_v_steps (v, NULL, 0) == 0
+       && marpa_v_step_type (v) == MARPA_STEP_INITIAL),
+      "a batch of zero steps takes no steps");
+  ok (steps_match (g, v, 1, expected, expected_count),
+      "batches of 1 step match");
+  marpa_v_unref (v);
+
+  v = value_new (g, r);
+  ok (steps_match (g, v, 7, expected, expected_count),
+      "batches of 7 steps match");
+  marpa_v_unref (v);
+
+  v = value_new (g, r);
+  ok (steps_match (g, v, MAX_STEPS, expected, expected_count),
+      "a batch of %d steps matches", MAX_STEPS);
+  marpa_v_unref (v);
+
+  v = marpa_r_value_unambiguous (r, -1);
+  if (!v)
+    fail ("marpa_r_value_unambiguous", g);
+  ok (steps_match (g, v, 7, expected, expected_count),
+      "batches of 7 steps from a direct valuator match");
+  marpa_v_unref (v);
+
+  marpa_r_unref (r);
+  marpa_g_unref (g);
+  return 0;
+}
@@ -0,0 +1,216 @@
+/*
+ * Copyright 2015 Jeffrey Kegler
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Releasing Earley sets: marpa_r_earliest_live_earley_set() and
+ * marpa_r_earley_sets_release().
+ *
+ * The grammar is
+ *     top ::= record+
+ *     record ::= a b
+ * A long stream of records is read,
+ * and the Earley sets are released at the end of every record.
+ * The recognizer must stay the same size,
+ * and the parse after the last release must be the released
+ * prefix, as a single token, followed by the records
+ * read since.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "marpa.h"
+
+#include "tap/basic.h"
+#include "marpa_m_test.h"
+
+#define RECORD_COUNT 2000
+#define PREFIX_VALUE 42
+
+static Marpa_Symbol_ID S_top, S_record, S_a, S_b;
+static Marpa_Rule_ID R_top, R_record;
+
+static int
+fail (const char *s, Marpa_Grammar g)
+{
+  const char *error_string;
+  Marpa_Error_Code errcode = marpa_g_error (g, &error_string);
+  printf ("%s returned %d: %s", s, errcode, error_string);
+  exit (1);
+}
+
+static void
+token_read (Marpa_Grammar g, Marpa_Recognizer r, Marpa_Symbol_ID token_id,
+            int value)
+{
+  (marpa_r_alternative (r, token_id, value, 1) == MARPA_ERR_NONE)
+    || fail ("marpa_r_alternative", g);
+  (marpa_r_earleme_complete (r) >= 0)
+    || fail ("marpa_r_earleme_complete", g);
+}
+
+/* Evaluates the parse at the latest Earley set.
+ * Returns the number of arguments of the |top| rule,
+ * and sets |*p_prefix_value| to the value of the
+ * token for the released prefix, or -1 if there is none.
+ */
+static int
+top_arg_count (Marpa_Grammar g, Marpa_Recognizer r, int *p_prefix_value)
+{
+  Marpa_Bocage b;
+  Marpa_Order o;
+  Marpa_Tree t;
+  Marpa_Value v;
+  int arg_count = -1;
+  *p_prefix_value = -1;
+  b = marpa_b_new (r, -1);
+  if (!b)
+    fail ("marpa_b_new", g);
+  o = marpa_o_new (b);
+  if (!o)
+    fail ("marpa_o_new", g);
+  t = marpa_t_new (o);
+  if (!t)
+    fail ("marpa_t_new", g);
+  (marpa_t_next (t) >= 0) || fail ("marpa_t_next", g);
+  v = marpa_v_new (t);
+  if (!v)
+    fail ("marpa_v_new", g);
+  for (;;)
+    {
+      const Marpa_Step_Type step_type = marpa_v_step (v);
+      if (step_type < 0)
+        fail ("marpa_v_step", g);
+      if (step_type == MARPA_STEP_INACTIVE)
+        break;
+      if (step_type == MARPA_STEP_TOKEN && marpa_v_token (v) == S_top)
+        *p_prefix_value = marpa_v_token_value (v);
+      if (step_type == MARPA_STEP_RULE && marpa_v_rule (v) == R_top)
+        arg_count = marpa_v_arg_n (v) - marpa_v_arg_0 (v) + 1;
+    }
+  marpa_v_unref (v);
+  marpa_t_unref (t);
+  marpa_o_unref (o);
+  marpa_b_unref (b);
+  return arg_count;
+}
+
+int
+main (int argc, char *argv[])
+{
+  Marpa_Config marpa_configuration;
+  Marpa_Grammar g;
+  Marpa_Recognizer r;
+  Marpa_Symbol_ID rhs[2];
+  size_t early_memory_used = 0;
+  size_t max_memory_used = 0;
+  int max_latest = 0;
+  int released_total = 0;
+  int is_release_ok = 1;
+  int record;
+  int rc;
+  int arg_count;
+  int prefix_value;
+
+  plan (11);
+
+  marpa_c_init (&marpa_configuration);
+  g = marpa_g_new (&marpa_configuration);
+  if (!g)
+    {
+      Marpa_Error_Code errcode = marpa_c_error (&marpa_configuration, NULL);
+      printf ("marpa_g_new: error %d", errcode);
+      exit (1);
+    }
+  (marpa_g_force_valued (g) >= 0) || fail ("marpa_g_force_valued", g);
+  ((S_top = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_record = marpa_g_symbol_new (g)) >= 0)
+    || fail ("marpa_g_symbol_new", g);
+  ((S_a = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((S_b = marpa_g_symbol_new (g)) >= 0) || fail ("marpa_g_symbol_new", g);
+  ((R_top = marpa_g_sequence_new (g, S_top, S_record, -1, 1, 0)) >= 0)
+    || fail ("marpa_g_sequence_new", g);
+  rhs[0] = S_a;
+  rhs[1] = S_b;
+  ((R_record = marpa_g_rule_new (g, S_record, rhs, 2)) >= 0)
+    || fail ("marpa_g_rule_new", g);
+  (marpa_g_start_symbol_set (g, S_top) >= 0)
+    || fail ("marpa_g_start_symbol_set", g);
+  (marpa_g_precompute (g) >= 0) || fail ("marpa_g_precompute", g);
+
+  r = marpa_r_new (g);
+  if (!r)
+    fail ("marpa_r_new", g);
+  rc = marpa_r_earliest_live_earley_set (r);
+  ok ((rc == -2 && marpa_g_error (g, NULL) == MARPA_ERR_RECCE_NOT_STARTED),
+      "marpa_r_earliest_live_earley_set() fails before input is started");
+  (marpa_r_start_input (r) >= 0) || fail ("marpa_r_start_input", g);
+  ok ((marpa_r_earley_sets_release (r, 0, PREFIX_VALUE) == 0),
+      "nothing is released at Earley set 0");
+
+  for (record = 0; record < RECORD_COUNT; record++)
+    {
+      int earliest_live;
+      size_t memory_used;
+      token_read (g, r, S_a, 2 * record + 1);
+      token_read (g, r, S_b, 2 * record + 2);
+      earliest_live = marpa_r_earliest_live_earley_set (r);
+      if (earliest_live != marpa_r_latest_earley_set (r))
+        is_release_ok = 0;
+      rc = marpa_r_earley_sets_release (r, earliest_live, PREFIX_VALUE);
+      if (rc != (earliest_live > 1 ? earliest_live - 1 : 0))
+        is_release_ok = 0;
+      released_total += rc;
+      if (marpa_r_latest_earley_set (r) > max_latest)
+        max_latest = marpa_r_latest_earley_set (r);
+      memory_used = marpa_m_charged_bytes (r);
+      if (record == 10)
+        early_memory_used = memory_used;
+      if (record > 10 && memory_used > max_memory_used)
+        max_memory_used = memory_used;
+    }
+  ok (is_release_ok,
+      "Earley sets released at the end of every record");
+  ok ((released_total == 2 * RECORD_COUNT - 1),
+      "%d Earley sets were released", released_total);
+  ok ((max_latest <= 3), "latest Earley set was never above %d", max_latest);
+  ok ((max_memory_used <= early_memory_used),
+      "memory stayed bounded: %lu bytes after 10 records, at most %lu after",
+      (unsigned long) early_memory_used, (unsigned long) max_memory_used);
+  ok ((marpa_r_current_earleme (r) == 1),
+      "earlemes are renumbered after the release");
+
+  token_read (g, r, S_a, 2 * record + 1);
+  ok ((marpa_r_earliest_live_earley_set (r) == 1),
+      "Earley set at the start of a record is live");
+  rc = marpa_r_earley_sets_release (r, 2, PREFIX_VALUE);
+  ok ((rc == -2 && marpa_g_error (g, NULL) == MARPA_ERR_EARLEY_SET_IS_LIVE),
+      "a live Earley set cannot be released");
+  token_read (g, r, S_b, 2 * record + 2);
+
+  arg_count = top_arg_count (g, r, &prefix_value);
+  ok ((arg_count == 2),
+      "top rule after the release has %d arguments", arg_count);
+  ok ((prefix_value == PREFIX_VALUE),
+      "released prefix has value %d", prefix_value);
+
+  marpa_r_unref (r);
+  marpa_g_unref (g);
+  return 0;
+}
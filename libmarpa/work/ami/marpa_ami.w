@@ -470,6 +470,25 @@ int marpa__default_debug_handler (const char *format, ...)
 # define alignof(type) (offsetof (struct { char __slot1; type __slot2; }, __slot2))
 #endif
 
+@*0 Atomic operations.
+Used for the reference counts of objects which
+may be shared between threads.
+The GNU atomic builtins are used where the compiler
+provides them, which it indicates by defining
+the memory order macros.
+Otherwise, these fall back to the plain,
+non-atomic, operations.
+The new value is returned.
+@<Atomic macros@> =
+
+#if defined(__ATOMIC_ACQ_REL)
+#define MARPA_ATOMIC_INCR(p) (__atomic_add_fetch((p), 1, __ATOMIC_RELAXED))
+#define MARPA_ATOMIC_DECR(p) (__atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL))
+#else
+#define MARPA_ATOMIC_INCR(p) (++*(p))
+#define MARPA_ATOMIC_DECR(p) (--*(p))
+#endif
+
 @** Internal typdefs.
 @<Internal typedefs@> =
 typedef unsigned int BITFIELD;
@@ -506,6 +525,7 @@ So I add such a comment.
 
 @<Debug macros@>
 @<Internal macros@>
+@<Atomic macros@>
 @<Internal typedefs@>
 
 @h
@@ -468,6 +468,7 @@ where C89 reserved names are not an issue.
 \li es: Earley set.  Used for clarity
 in a few places were
 \li g: Grammar.
+\li GSNAP: Grammar snapshot.
 \li IRL: Internal Rule.
 \li |_ix|, |_IX|, ix, IX: Index.  Often used as a suffix.
 \li JEARLEME: Used instead of |EARLEME| because C89 reserves
@@ -612,6 +613,7 @@ struct marpa_config {
      int t_is_ok;
      Marpa_Error_Code t_error;
      const char *t_error_string;
+     size_t t_chunk_pool_size;
 };
 typedef struct marpa_config Marpa_Config;
 
@@ -621,9 +623,39 @@ int marpa_c_init (Marpa_Config *config)
     config->t_is_ok = I_AM_OK;
     config->t_error = MARPA_ERR_NONE;
     config->t_error_string = NULL;
+    config->t_chunk_pool_size = 0;
     return 0;
 }
 
+@ The size of the chunk pool is kept in the grammar,
+so that the recognizers of a grammar shared between threads
+can put the pool of their own thread in use.
+@<Function definitions@> =
+int marpa_c_chunk_pool_size_set (Marpa_Config *config, size_t size)
+{
+    config->t_chunk_pool_size = size;
+    return marpa__obs_pool_reserve (size);
+}
+
+@ @<Function definitions@> =
+void marpa_chunk_pool_free (void)
+{
+    marpa__obs_pool_free ();
+}
+
+@ @<Function definitions@> =
+size_t marpa_chunk_pool_size (void)
+{
+    return marpa__obs_pool_size ();
+}
+
+@ For testing.
+@<Function definitions@> =
+size_t _marpa_chunk_pool_reuse_count (void)
+{
+    return marpa__obs_pool_reuse_count ();
+}
+
 @ @<Function definitions@> =
 Marpa_Error_Code marpa_c_error(Marpa_Config* config, const char** p_error_string)
 {
@@ -673,6 +705,9 @@ Marpa_Grammar marpa_g_new (Marpa_Config* configuration)
     @t}\comment{@>
     /* Set |t_is_ok| to a bad value, just in case */
     g->t_is_ok = 0;
+    Chunk_Pool_Size_of_G(g) =
+      configuration ? configuration->t_chunk_pool_size : 0;
+    marpa__obs_pool_reserve (Chunk_Pool_Size_of_G(g));
     @<Initialize grammar elements@>@;
     @t}\comment{@>
     /* Properly initialized, so set |t_is_ok| to its proper value */
@@ -697,9 +732,14 @@ PRIVATE
 void
 grammar_unref (GRAMMAR g)
 {
+  int new_ref_count;
   MARPA_ASSERT (g->t_ref_count > 0)
-  g->t_ref_count--;
-  if (g->t_ref_count <= 0)
+  if (G_is_Frozen(g)) {
+    new_ref_count = MARPA_ATOMIC_DECR(&g->t_ref_count);
+  } else {
+    new_ref_count = --g->t_ref_count;
+  }
+  if (new_ref_count <= 0)
     {
       grammar_free(g);
     }
@@ -714,7 +754,11 @@ PRIVATE GRAMMAR
 grammar_ref (GRAMMAR g)
 {
   MARPA_ASSERT(g->t_ref_count > 0)
-  g->t_ref_count++;
+  if (G_is_Frozen(g)) {
+    MARPA_ATOMIC_INCR(&g->t_ref_count);
+  } else {
+    g->t_ref_count++;
+  }
   return g;
 }
 Marpa_Grammar
@@ -725,7 +769,11 @@ marpa_g_ref (Marpa_Grammar g)
 PRIVATE
 void grammar_free(GRAMMAR g)
 {
-    @<Destroy grammar elements@>@;
+    if (G_is_Clone(g)) {
+        @<Destroy grammar clone elements@>@;
+    } else {
+        @<Destroy grammar elements@>@;
+    }
     my_free(g);
 }
 
@@ -965,6 +1013,146 @@ int marpa_g_is_precomputed(Marpa_Grammar g)
     return G_is_Precomputed(g);
 }
 
+@*0 Chunk pool size.
+The size of the chunk pool, from the configuration.
+Every constructor of a grammar or a recognizer
+puts the chunk pool of its thread in use,
+if it is not zero.
+@d Chunk_Pool_Size_of_G(g) ((g)->t_chunk_pool_size)
+@<Widely aligned grammar elements@> = size_t t_chunk_pool_size;
+
+@*0 Grammar is frozen?.
+A frozen grammar is a precomputed grammar
+which the application promises to share
+between threads.
+Once frozen, a grammar cannot be unfrozen,
+and no method will change it,
+except to change its reference count.
+The reference count of a frozen grammar
+is changed atomically,
+so that recognizers may be created and destroyed
+in several threads at once.
+@d G_is_Frozen(g) ((g)->t_is_frozen)
+@<Bit aligned grammar elements@> = BITFIELD t_is_frozen:1;
+@ @<Initialize grammar elements@> =
+g->t_is_frozen = 0;
+@ Freezing a frozen grammar is not an error.
+@<Function definitions@> =
+int marpa_g_freeze(Marpa_Grammar g)
+{
+   @<Return |-2| on failure@>@/
+    @<Fail if fatal error@>@;
+    @<Fail if not precomputed@>@;
+    G_is_Frozen(g) = 1;
+    return 1;
+}
+@ @<Function definitions@> =
+int marpa_g_is_frozen(Marpa_Grammar g)
+{
+   @<Return |-2| on failure@>@/
+    @<Fail if fatal error@>@;
+    return G_is_Frozen(g);
+}
+
+@*0 Grammar clones.
+A clone is a precomputed grammar which shares
+the results of precomputation with another grammar,
+its base grammar.
+Those results do not change once the grammar is precomputed,
+so that sharing them is safe.
+The clone has its own copy of the state which may change
+after precomputation:
+its reference count,
+its error state, its events,
+whether it is frozen,
+and the activation status of its events.
+The clone holds a reference to its base grammar,
+which keeps the shared results alive.
+\par
+The base grammar of a clone is never itself a clone ---
+the clone of a clone shares with the original base grammar.
+Recognizers never see the base grammar,
+only the clone.
+@d G_is_Clone(g) ((g)->t_base_grammar != NULL)
+@<Widely aligned grammar elements@> = struct marpa_g* t_base_grammar;
+@ @<Initialize grammar elements@> =
+g->t_base_grammar = NULL;
+
+@ The clone starts as a copy of the grammar structure,
+so that it shares every pointer to the results of precomputation.
+It inherits the activation status of the events in |g|,
+but none of its errors or events.
+@<Function definitions@> =
+Marpa_Grammar
+marpa_g_clone (Marpa_Grammar g)
+{
+  @<Return |NULL| on failure@>@;
+  GRAMMAR clone;
+  @<Fail if fatal error@>@;
+  @<Fail if not precomputed@>@;
+  clone = my_malloc (sizeof (struct marpa_g));
+  *clone = *g;
+  marpa__obs_pool_reserve (Chunk_Pool_Size_of_G (clone));
+  clone->t_base_grammar = grammar_ref (G_is_Clone (g) ? g->t_base_grammar : g);
+  clone->t_ref_count = 1;
+  clone->t_is_frozen = 0;
+  clone->t_error = MARPA_ERR_NONE;
+  clone->t_error_string = NULL;
+  MARPA_DSTACK_INIT (clone->t_events, GEV_Object, INITIAL_G_EVENTS_CAPACITY);
+  clone->t_xrl_tree = NULL;
+  clone->t_zwp_tree = NULL;
+  @t}\comment{@>
+  /* The clone's obstack holds only its copies
+    of the event activation vectors */
+  clone->t_obs = marpa_obs_init;
+  clone->t_lbv_xsyid_completion_event_starts_active =
+    bv_obs_clone (clone->t_obs, g->t_lbv_xsyid_completion_event_starts_active);
+  clone->t_lbv_xsyid_nulled_event_starts_active =
+    bv_obs_clone (clone->t_obs, g->t_lbv_xsyid_nulled_event_starts_active);
+  clone->t_lbv_xsyid_prediction_event_starts_active =
+    bv_obs_clone (clone->t_obs, g->t_lbv_xsyid_prediction_event_starts_active);
+  return clone;
+}
+
+@ Only the elements which the clone owns are destroyed.
+Everything else belongs to the base grammar.
+@<Destroy grammar clone elements@> =
+{
+  MARPA_DSTACK_DESTROY (g->t_events);
+  marpa_obs_free (g->t_obs);
+  grammar_unref (g->t_base_grammar);
+}
+
+@ In a grammar which is not a clone,
+the activation status of events can only be changed
+before precomputation.
+The activation status of the events in a clone
+is kept in its own boolean vectors,
+and can be changed until the clone is frozen.
+@<Function definitions@> =
+PRIVATE int
+clone_symbol_activate (GRAMMAR g, XSYID xsy_id, int reactivate,
+                       Bit_Vector lbv_is_event, Bit_Vector lbv_starts_active,
+                       Marpa_Error_Code not_event_error)
+{
+  @<Return |-2| on failure@>@;
+  switch (reactivate)
+    {
+    case 0:
+      lbv_bit_clear (lbv_starts_active, xsy_id);
+      return 0;
+    case 1:
+      if (!lbv_bit_test (lbv_is_event, xsy_id))
+        {
+          MARPA_ERROR (not_event_error);
+        }
+      lbv_bit_set (lbv_starts_active, xsy_id);
+      return 1;
+    }
+  MARPA_ERROR (MARPA_ERR_INVALID_BOOLEAN);
+  return failure_indicator;
+}
+
 @*0 Grammar has loop?.
 @<Bit aligned grammar elements@> = BITFIELD t_has_cycle:1;
 @ @<Initialize grammar elements@> =
@@ -1157,9 +1345,9 @@ marpa_obs_free(g->t_xrl_obs);
 Keeps constant integer lists with the same lifetime
 as the grammar.
 This arena is one of the grammar objects
-shared by all objects based on this grammar,
-something to be noted if grammars are ever to be shared
-by multiple threads.
+shared by all objects based on this grammar.
+It is written only during precomputation ---
+recognizers keep their own arenas.
 @<Widely aligned grammar elements@> =
 CILAR_Object t_cilar;
 @ @<Initialize grammar elements@> =
@@ -1380,6 +1568,7 @@ int marpa_g_force_valued( Marpa_Grammar g)
 {
     XSYID xsyid;
     @<Return |-2| on failure@>@;
+    @<Fail if frozen@>@;
     for (xsyid = 0; xsyid < XSY_Count_of_G(g); xsyid++) {
       const XSY xsy = XSY_by_ID(xsyid);
       if (!XSY_is_Valued(xsy) && XSY_is_Valued_Locked(xsy))
@@ -1411,6 +1600,7 @@ int marpa_g_symbol_is_valued_set(
 {
   XSY symbol;
   @<Return |-2| on failure@>@;
+    @<Fail if frozen@>@;
     @<Fail if |xsy_id| is malformed@>@;
     @<Soft fail if |xsy_id| does not exist@>@;
   symbol = XSY_by_ID (xsy_id);
@@ -1617,9 +1807,17 @@ marpa_g_completion_symbol_activate (Marpa_Grammar g,
 {
     @<Return |-2| on failure@>@;
     @<Fail if fatal error@>@;
-    @<Fail if precomputed@>@;
+    if (!G_is_Clone (g)) {
+      @<Fail if precomputed@>@;
+    }
+    @<Fail if frozen@>@;
     @<Fail if |xsy_id| is malformed@>@;
     @<Soft fail if |xsy_id| does not exist@>@;
+    if (G_is_Clone (g))
+      return clone_symbol_activate (g, xsy_id, reactivate,
+                                    g->t_lbv_xsyid_is_completion_event,
+                                    g->t_lbv_xsyid_completion_event_starts_active,
+                                    MARPA_ERR_SYMBOL_IS_NOT_COMPLETION_EVENT);
     switch (reactivate) {
     case 0:
         XSYID_Completion_Event_Starts_Active (xsy_id)
@@ -1690,9 +1888,17 @@ marpa_g_nulled_symbol_activate (Marpa_Grammar g,
 {
     @<Return |-2| on failure@>@;
     @<Fail if fatal error@>@;
-    @<Fail if precomputed@>@;
+    if (!G_is_Clone (g)) {
+      @<Fail if precomputed@>@;
+    }
+    @<Fail if frozen@>@;
     @<Fail if |xsy_id| is malformed@>@;
     @<Soft fail if |xsy_id| does not exist@>@;
+    if (G_is_Clone (g))
+      return clone_symbol_activate (g, xsy_id, reactivate,
+                                    g->t_lbv_xsyid_is_nulled_event,
+                                    g->t_lbv_xsyid_nulled_event_starts_active,
+                                    MARPA_ERR_SYMBOL_IS_NOT_NULLED_EVENT);
     switch (reactivate) {
     case 0:
         XSYID_Nulled_Event_Starts_Active (xsy_id)
@@ -1760,9 +1966,17 @@ marpa_g_prediction_symbol_activate (Marpa_Grammar g,
 {
     @<Return |-2| on failure@>@;
     @<Fail if fatal error@>@;
-    @<Fail if precomputed@>@;
+    if (!G_is_Clone (g)) {
+      @<Fail if precomputed@>@;
+    }
+    @<Fail if frozen@>@;
     @<Fail if |xsy_id| is malformed@>@;
     @<Soft fail if |xsy_id| does not exist@>@;
+    if (G_is_Clone (g))
+      return clone_symbol_activate (g, xsy_id, reactivate,
+                                    g->t_lbv_xsyid_is_prediction_event,
+                                    g->t_lbv_xsyid_prediction_event_starts_active,
+                                    MARPA_ERR_SYMBOL_IS_NOT_PREDICTION_EVENT);
     switch (reactivate) {
     case 0:
         XSYID_Prediction_Event_Starts_Active (xsy_id)
@@ -3250,11 +3464,8 @@ A large allocation may be required in the grammar, which
 thereafter would be wasted space.
 @<Reinitialize the CILAR@> =
 { cilar_buffer_reinit(&g->t_cilar); }
-@ {\bf To Do}: @^To Do@>
-Perhaps someday there should be a CILAR for each recognizer.
-This probably is an issue to be dealt with,
-when adding the ability
-to clone grammars.
+@ Each recognizer now has its own CILAR,
+so the grammar's CILAR is not written after precomputation.
 
 @** The grammar census.
 
@@ -4846,8 +5057,12 @@ involved exist.
 @ The space is allocated during precomputation.
 Because the grammar may be destroyed before precomputation,
 I test that |g->t_ahms| is non-zero.
+A trivial grammar has no AHMs,
+and its precomputation stops before they are counted,
+so the count is initialized here.
 @ @<Initialize grammar elements@> =
 g->t_ahms = NULL;
+AHM_Count_of_G(g) = 0;
 @ @<Destroy grammar elements@> =
      my_free(g->t_ahms);
 
@@ -5503,10 +5718,25 @@ with |S2| on its LHS.
 }
 
 @** Populating the predicted IRL CIL's in the AHM's.
+The predicted IRL's depend only on the postdot symbol,
+and many AHM's share a postdot symbol.
+The CIL is built once for each postdot symbol,
+and kept in |predicted_irl_cil_by_nsyid|,
+because building it scans a whole row of the prediction matrix.
+@ @<Declare variables for the internal grammar
+        memoizations@> =
+  CIL *predicted_irl_cil_by_nsyid;
 @ @<Populate the predicted IRL CIL's in the AHM's@> =
 {
   AHMID ahm_id;
+  NSYID nsyid;
   const int ahm_count = AHM_Count_of_G (g);
+  predicted_irl_cil_by_nsyid =
+    marpa_obs_new (obs_precompute, CIL, (size_t) nsy_count);
+  for (nsyid = 0; nsyid < nsy_count; nsyid++)
+    {
+      predicted_irl_cil_by_nsyid[nsyid] = NULL;
+    }
   for (ahm_id = 0; ahm_id < ahm_count; ahm_id++)
     {
       const AHM ahm = AHM_by_ID (ahm_id);
@@ -5518,9 +5748,15 @@ with |S2| on its LHS.
 	}
       else
 	{
+          if (!predicted_irl_cil_by_nsyid[postdot_nsyid])
+            {
+              predicted_irl_cil_by_nsyid[postdot_nsyid] =
+                cil_bv_add (&g->t_cilar,
+                            matrix_row (prediction_nsy_by_irl_matrix,
+                                        postdot_nsyid));
+            }
 	  Predicted_IRL_CIL_of_AHM (ahm) =
-	    cil_bv_add (&g->t_cilar,
-			matrix_row (prediction_nsy_by_irl_matrix, postdot_nsyid));
+            predicted_irl_cil_by_nsyid[postdot_nsyid];
 	  LHS_CIL_of_AHM (ahm) = LHS_CIL_of_NSYID(postdot_nsyid);
 	}
     }
@@ -5592,22 +5828,29 @@ with |S2| on its LHS.
     }
 }
 
-@ @<Populate the prediction and nulled symbol CILs@> =
+@ The completion and prediction CIL's of an AHM have
+at most one element each,
+so they are created directly.
+Only the nulled symbols need a boolean vector,
+and then only when the AHM has nulled symbols:
+clearing and scanning a vector as wide as the grammar's symbols,
+for each of the AHM's,
+makes the precomputation quadratic.
+@<Populate the prediction and nulled symbol CILs@> =
 {
   AHMID ahm_id;
   const int ahm_count_of_g = AHM_Count_of_G (g);
-  const LBV bv_completion_xsyid = bv_create (post_census_xsy_count);
-  const LBV bv_prediction_xsyid = bv_create (post_census_xsy_count);
   const LBV bv_nulled_xsyid = bv_create (post_census_xsy_count);
   const CILAR cilar = &g->t_cilar;
+  const CIL empty_cil = cil_empty (cilar);
   for (ahm_id = 0; ahm_id < ahm_count_of_g; ahm_id++)
     {
       const AHM ahm = AHM_by_ID (ahm_id);
       const NSYID postdot_nsyid = Postdot_NSYID_of_AHM (ahm);
       const IRL irl = IRL_of_AHM (ahm);
-      bv_clear (bv_completion_xsyid);
-      bv_clear (bv_prediction_xsyid);
-      bv_clear (bv_nulled_xsyid);
+      Completion_XSYIDs_of_AHM (ahm) = empty_cil;
+      Prediction_XSYIDs_of_AHM (ahm) = empty_cil;
+      Nulled_XSYIDs_of_AHM (ahm) = empty_cil;
         {
           int rhs_ix;
           int raw_position = Position_of_AHM (ahm);
@@ -5621,7 +5864,8 @@ with |S2| on its LHS.
                   if (XSY_is_Completion_Event (xsy))
                     {
                       const XSYID xsyid = ID_of_XSY (xsy);
-                      bv_bit_set (bv_completion_xsyid, xsyid);
+                      Completion_XSYIDs_of_AHM (ahm) =
+                        cil_singleton (cilar, xsyid);
                     }
                 }
             }
@@ -5629,8 +5873,11 @@ with |S2| on its LHS.
             {
               const XSY xsy = Source_XSY_of_NSYID (postdot_nsyid);
               const XSYID xsyid = ID_of_XSY (xsy);
-              bv_bit_set (bv_prediction_xsyid, xsyid);
+              Prediction_XSYIDs_of_AHM (ahm) = cil_singleton (cilar, xsyid);
             }
+          if (Null_Count_of_AHM (ahm) <= 0)
+            continue;
+          bv_clear (bv_nulled_xsyid);
           for (rhs_ix = raw_position - Null_Count_of_AHM (ahm);
                rhs_ix < raw_position; rhs_ix++)
             {
@@ -5646,15 +5893,9 @@ with |S2| on its LHS.
                   bv_bit_set (bv_nulled_xsyid, nulled_xsyid);
                 }
             }
+          Nulled_XSYIDs_of_AHM (ahm) = cil_bv_add (cilar, bv_nulled_xsyid);
         }
-      Completion_XSYIDs_of_AHM (ahm) =
-        cil_bv_add (cilar, bv_completion_xsyid);
-      Nulled_XSYIDs_of_AHM (ahm) = cil_bv_add (cilar, bv_nulled_xsyid);
-      Prediction_XSYIDs_of_AHM (ahm) =
-        cil_bv_add (cilar, bv_prediction_xsyid);
     }
-  bv_free (bv_completion_xsyid);
-  bv_free (bv_prediction_xsyid);
   bv_free (bv_nulled_xsyid);
 }
 
@@ -5674,13 +5915,28 @@ with |S2| on its LHS.
     }
 }
 
-@ @<Calculate AHM Event Group Sizes@> =
+@ An AHM's event group is the set of event AHM's
+which are Leo completions,
+and whose LHS is right-derived from the AHM's LHS.
+Usually there are few event AHM's, or none,
+so those which are Leo completions are listed first,
+and only the list is searched for each Leo completion.
+@<Calculate AHM Event Group Sizes@> =
 {
   const int ahm_count_of_g = AHM_Count_of_G (g);
+  AHMID *const event_leo_ahm_ids =
+    marpa_obs_new (obs_precompute, AHMID, (size_t) ahm_count_of_g);
+  int event_leo_ahm_count = 0;
   AHMID outer_ahm_id;
   for (outer_ahm_id = 0; outer_ahm_id < ahm_count_of_g; outer_ahm_id++)
     {
-      AHMID inner_ahm_id;
+      const AHM outer_ahm = AHM_by_ID (outer_ahm_id);
+      if (AHM_has_Event (outer_ahm) && AHM_is_Leo_Completion (outer_ahm))
+        event_leo_ahm_ids[event_leo_ahm_count++] = outer_ahm_id;
+    }
+  for (outer_ahm_id = 0; outer_ahm_id < ahm_count_of_g; outer_ahm_id++)
+    {
+      int event_leo_ix;
       const AHM outer_ahm = AHM_by_ID (outer_ahm_id);
       /* There is no test that |outer_ahm|
          is an event AHM.
@@ -5695,18 +5951,11 @@ with |S2| on its LHS.
                                    so we are done. */
        }
       outer_nsyid = LHSID_of_AHM (outer_ahm);
-      for (inner_ahm_id = 0; inner_ahm_id < ahm_count_of_g;
-           inner_ahm_id++)
+      for (event_leo_ix = 0; event_leo_ix < event_leo_ahm_count;
+           event_leo_ix++)
         {
-          NSYID inner_nsyid;
-          const AHM inner_ahm = AHM_by_ID (inner_ahm_id);
-          if (!AHM_has_Event (inner_ahm))
-            continue;           /* Not in the group, because it
-                                   is not an event AHM. */
-          if (!AHM_is_Leo_Completion(inner_ahm))
-            continue;           /* This AHM is not a Leo completion,
-                                   so we are done. */
-          inner_nsyid = LHSID_of_AHM (inner_ahm);
+          const AHM inner_ahm = AHM_by_ID (event_leo_ahm_ids[event_leo_ix]);
+          const NSYID inner_nsyid = LHSID_of_AHM (inner_ahm);
           if (matrix_bit_test (nsy_by_right_nsy_matrix,
                                outer_nsyid,
                                inner_nsyid))
@@ -5924,3617 +6173,7540 @@ directly by the AHM.  ZWA's triggered via predictions are called
 via predictions.
 They do {\bf not} include the ZWA's triggered directly by
 the AHM itself.
+Like the predictions,
+whether an AHM predicts a ZWA depends only on its postdot symbol.
+The IRL's whose first AHM has a ZWA are marked in a boolean vector,
+and each postdot symbol's row of the prediction matrix is intersected
+with it once,
+rather than each AHM's predictions being searched one by one.
+A grammar without ZWA's skips all of this.
 @<Find the indirect ZWA's for each AHM's@> =
+if (ZWA_Count_of_G (g) > 0)
 {
   AHMID ahm_id;
+  IRLID irlid;
+  NSYID nsyid;
   const int ahm_count_of_g = AHM_Count_of_G (g);
+  const Bit_Vector bv_irl_has_zwa = bv_obs_create (obs_precompute, irl_count);
+  const Bit_Vector bv_nsy_is_done = bv_obs_create (obs_precompute, nsy_count);
+  const Bit_Vector bv_nsy_predicts_zwa =
+    bv_obs_create (obs_precompute, nsy_count);
+  const Bit_Vector bv_scratch = bv_obs_create (obs_precompute, irl_count);
+  for (irlid = 0; irlid < irl_count; irlid++)
+    {
+      const AHM first_ahm = First_AHM_of_IRLID (irlid);
+      if (Count_of_CIL (ZWA_CIL_of_AHM (first_ahm)) > 0)
+        bv_bit_set (bv_irl_has_zwa, irlid);
+    }
   for (ahm_id = 0; ahm_id < ahm_count_of_g; ahm_id++)
     {
       const AHM ahm_to_populate = AHM_by_ID (ahm_id);
+      int min, max;
 
       @t}\comment{@>
       /* The ``predicts ZWA'' bit was
       initialized to assume no prediction */
-      const CIL prediction_cil = Predicted_IRL_CIL_of_AHM (ahm_to_populate);
-      const int prediction_count = Count_of_CIL (prediction_cil);
-
-      int cil_ix;
-      for (cil_ix = 0; cil_ix < prediction_count; cil_ix++)
+      nsyid = Postdot_NSYID_of_AHM (ahm_to_populate);
+      if (nsyid < 0)
+        continue;
+      if (!bv_bit_test_then_set (bv_nsy_is_done, nsyid))
         {
-          const IRLID prediction_irlid = Item_of_CIL (prediction_cil, cil_ix);
-          const AHM prediction_ahm_of_irl = First_AHM_of_IRLID(prediction_irlid);
-          const CIL zwaids_of_prediction = ZWA_CIL_of_AHM(prediction_ahm_of_irl);
-          if (Count_of_CIL (zwaids_of_prediction) > 0) {
-            AHM_predicts_ZWA(ahm_to_populate) = 1;
-            break;
-          }
+          bv_and (bv_scratch, bv_irl_has_zwa,
+                  matrix_row (prediction_nsy_by_irl_matrix, nsyid));
+          if (bv_scan (bv_scratch, 0, &min, &max))
+            bv_bit_set (bv_nsy_predicts_zwa, nsyid);
         }
+      if (bv_bit_test (bv_nsy_predicts_zwa, nsyid))
+        AHM_predicts_ZWA (ahm_to_populate) = 1;
     }
 }
 
-@** Recognizer (R, RECCE) code.
-@<Public incomplete structures@> =
-struct marpa_r;
-typedef struct marpa_r* Marpa_Recognizer;
-typedef Marpa_Recognizer Marpa_Recce;
-@ @<Private typedefs@> =
-typedef struct marpa_r* RECCE;
-@ @<Recognizer structure@> =
-struct marpa_r {
-    @<Widely aligned recognizer elements@>@;
-    @<Int aligned recognizer elements@>@;
-    @<Bit aligned recognizer elements@>@;
+@** Grammar snapshot (GSNAP) code.
+A grammar snapshot is a precomputed grammar,
+written out as a block of memory,
+from which another process can recreate the grammar
+without precomputing it again.
+Libmarpa does no file IO ---
+it is up to the application to store the snapshot
+and to read it back in,
+ideally by mapping the file into memory.
+\par
+The snapshot holds the results of precomputation:
+the XSY's, NSY's, XRL's, IRL's, AHM's and GZWA's,
+the grammar's boolean vectors,
+and the CIL's that these point to.
+Each object is written as an image of its structure,
+with its pointers zeroed.
+The pointers are written separately,
+as the ID's of the objects they point to,
+or as offsets into an area which holds the CIL's.
+Loading the snapshot is a copy of each image,
+followed by a pass which fixes up the pointers.
+Nothing is parsed.
+\par
+The images only make sense to a build of Libmarpa
+which lays out its structures in the same way.
+The snapshot header therefore records the
+Libmarpa version and the sizes of the structures,
+and a snapshot which does not match is rejected.
+A checksum guards against truncation and similar accidents.
+Beyond these checks,
+the contents of a snapshot are trusted.
+
+@ The snapshot header.
+All integers are in the native byte order,
+so that the magic number also catches a snapshot
+written with a different byte order.
+|0x4d47534e| is the ASCII for `MGSN'.
+@d GSNAP_MAGIC 0x4d47534e
+@<Private structures@> =
+struct s_gsnap_header {
+    int t_magic;
+    int t_major_version;
+    int t_minor_version;
+    int t_micro_version;
+    @t}\comment{@>
+    /* The layout of the images */
+    int t_sizeof_pointer;
+    int t_sizeof_xsy;
+    int t_sizeof_nsy;
+    int t_sizeof_xrl_base;
+    int t_sizeof_irl_base;
+    int t_sizeof_ahm;
+    int t_sizeof_gzwa;
+    int t_sizeof_lbw;
+    @t}\comment{@>
+    /* The size of the snapshot, in bytes,
+    and the checksum of everything after the header */
+    int t_size;
+    unsigned int t_checksum;
+    int t_xsy_count;
+    int t_nsy_count;
+    int t_xrl_count;
+    int t_irl_count;
+    int t_ahm_count;
+    int t_gzwa_count;
+    int t_cil_area_size;
+    XSYID t_start_xsy_id;
+    IRLID t_start_irl_id;
+    int t_external_size;
+    int t_max_rule_length;
+    Marpa_Rank t_default_rank;
+    int t_force_valued;
+    int t_symbol_instance_count;
+    int t_has_cycle;
 };
+typedef struct s_gsnap_header GSNAP_HEADER_Object;
 
-@ The grammar must not be deallocated for the life of the
-recognizer.
-In the event of an error creating the recognizer,
-|NULL| is returned.
+@ Initialize the parts of the header which must match
+for a snapshot to be loaded.
 @<Function definitions@> =
-Marpa_Recognizer marpa_r_new( Marpa_Grammar g )
-{
-    RECCE r;
-    int nsy_count;
-    int irl_count;
-    @<Return |NULL| on failure@>@;
-    @<Fail if not precomputed@>@;
-    nsy_count = NSY_Count_of_G(g);
-    irl_count = IRL_Count_of_G(g);
-    r = my_malloc(sizeof(struct marpa_r));
-    @<Initialize recognizer obstack@>@;
-    @<Initialize recognizer elements@>@;
-    @<Initialize dot PSAR@>@;
-    @<Initialize recognizer event variables@>@;
-    return r;
+PRIVATE void
+gsnap_header_init (GSNAP_HEADER_Object * header)
+{
+  header->t_magic = GSNAP_MAGIC;
+  header->t_major_version = marpa_major_version;
+  header->t_minor_version = marpa_minor_version;
+  header->t_micro_version = marpa_micro_version;
+  header->t_sizeof_pointer = (int) sizeof (void *);
+  header->t_sizeof_xsy = (int) sizeof (struct s_xsy);
+  header->t_sizeof_nsy = (int) sizeof (struct s_nsy);
+  header->t_sizeof_xrl_base = (int) offsetof (struct s_xrl, t_symbols);
+  header->t_sizeof_irl_base = (int) offsetof (IRL_Object, t_nsyid_array);
+  header->t_sizeof_ahm = (int) sizeof (struct s_ahm);
+  header->t_sizeof_gzwa = (int) sizeof (GZWA_Object);
+  header->t_sizeof_lbw = (int) sizeof (LBW);
 }
 
-@*0 Reference counting and destructors.
-@ @<Int aligned recognizer elements@>= int t_ref_count;
-@ @<Initialize recognizer elements@> =
-r->t_ref_count = 1;
-
-@ Decrement the recognizer reference count.
+@ @<Function definitions@> =
+PRIVATE int
+gsnap_header_is_compatible (const GSNAP_HEADER_Object * header)
+{
+  GSNAP_HEADER_Object expected;
+  gsnap_header_init (&expected);
+  return header->t_sizeof_pointer == expected.t_sizeof_pointer
+    && header->t_sizeof_xsy == expected.t_sizeof_xsy
+    && header->t_sizeof_nsy == expected.t_sizeof_nsy
+    && header->t_sizeof_xrl_base == expected.t_sizeof_xrl_base
+    && header->t_sizeof_irl_base == expected.t_sizeof_irl_base
+    && header->t_sizeof_ahm == expected.t_sizeof_ahm
+    && header->t_sizeof_gzwa == expected.t_sizeof_gzwa
+    && header->t_sizeof_lbw == expected.t_sizeof_lbw;
+}
+
+@ The checksum is the 32-bit FNV-1a hash.
+It is not cryptographic, and is not intended to be.
 @<Function definitions@> =
-PRIVATE void
-recce_unref (RECCE r)
+PRIVATE unsigned int
+gsnap_checksum (const unsigned char *p, size_t size)
 {
-  MARPA_ASSERT (r->t_ref_count > 0)
-  r->t_ref_count--;
-  if (r->t_ref_count <= 0)
+  unsigned int hash = 2166136261u;
+  while (size--)
     {
-      recce_free(r);
+      hash ^= *p++;
+      hash *= 16777619u;
     }
-}
-void
-marpa_r_unref (Marpa_Recognizer r)
-{
-   recce_unref(r);
+  return hash;
 }
 
-@ Increment the recognizer reference count.
-@<Function definitions@> =
-PRIVATE
-RECCE recce_ref (RECCE r)
-{
-  MARPA_ASSERT(r->t_ref_count > 0)
-  r->t_ref_count++;
-  return r;
-}
-Marpa_Recognizer
-marpa_r_ref (Marpa_Recognizer r)
-{
-   return recce_ref(r);
-}
+@ The layout of the snapshot is the header, followed by
+\li the images of the XSY's, NSY's, XRL's, IRL's, AHM's and GZWA's,
+in that order, each table in ID order;
+\li the boolean vectors;
+\li the links --- the pointers of the XSY's, NSY's, IRL's and AHM's,
+as ID's and CIL offsets;
+\li and, finally, the CIL area.
+\par
+The snapshot is written in two passes.
+In the first pass, the writer has no buffer,
+and only measures the snapshot.
+The CIL's are numbered in the first pass,
+by their offsets in the CIL area,
+and the second pass finds the same offsets.
+Since the CIL's of the grammar are unique,
+so are those of the snapshot.
+@<Private structures@> =
+struct s_gsnap_writer {
+    char* t_base;
+    size_t t_offset;
+    MARPA_AVL_TREE t_cil_tree;
+    MARPA_DSTACK_DECLARE(t_cil_stack);
+    int t_cil_area_size;
+};
+struct s_gsnap_cil {
+    CIL t_cil;
+    int t_offset;
+};
+typedef struct s_gsnap_cil GSNAP_CIL_Object;
+struct s_gsnap_reader {
+    const char* t_base;
+    size_t t_offset;
+    size_t t_size;
+};
+@ @<Private incomplete structures@> =
+struct s_gsnap_writer;
+struct s_gsnap_reader;
+@ @s GSNAP_WRITER int
+@s GSNAP_READER int
+@<Private typedefs@> =
+typedef struct s_gsnap_writer* GSNAP_WRITER;
+typedef struct s_gsnap_reader* GSNAP_READER;
 
 @ @<Function definitions@> =
-PRIVATE
-void recce_free(struct marpa_r *r)
+PRIVATE void
+gsnap_write (GSNAP_WRITER w, const void *data, size_t size)
 {
-    @<Unpack recognizer objects@>@;
-    @<Destroy recognizer elements@>@;
-    @<Destroy recognizer obstack@>@;
-    my_free( r);
+  if (w->t_base)
+    memcpy (w->t_base + w->t_offset, data, size);
+  w->t_offset += size;
 }
 
-@*0 Base objects.
-Initialized in |marpa_r_new|.
-@d G_of_R(r) ((r)->t_grammar)
-@<Widely aligned recognizer elements@> =
-    GRAMMAR t_grammar;
-@ @<Initialize recognizer elements@> =
+PRIVATE void
+gsnap_int_write (GSNAP_WRITER w, int value)
 {
-  G_of_R(r) = g;
-  grammar_ref(g);
+  gsnap_write (w, &value, sizeof (value));
 }
-@ @<Unpack recognizer objects@> =
-const GRAMMAR g = G_of_R(r);
-@ @<Destroy recognizer elements@> = grammar_unref(g);
-
-@*0 Input phase.
-The recognizer always is
-in a one of the following
-phases:
-@d R_BEFORE_INPUT 0x1
-@d R_DURING_INPUT 0x2
-@d R_AFTER_INPUT 0x3
-@<Bit aligned recognizer elements@> =
-   BITFIELD t_input_phase:2;
-@ @d Input_Phase_of_R(r) ((r)->t_input_phase)
-@ @<Initialize recognizer elements@> =
-    Input_Phase_of_R(r) = R_BEFORE_INPUT;
-
-@*0 Earley set container.
-@d First_YS_of_R(r) ((r)->t_first_earley_set)
-@s JEARLEME int
-@<Widely aligned recognizer elements@> =
-YS t_first_earley_set;
-YS t_latest_earley_set;
-JEARLEME t_current_earleme;
-@ @<Initialize recognizer elements@> =
-r->t_first_earley_set = NULL;
-r->t_latest_earley_set = NULL;
-r->t_current_earleme = -1;
 
-@*0 Current earleme.
-@d Latest_YS_of_R(r) ((r)->t_latest_earley_set)
-@d Current_Earleme_of_R(r) ((r)->t_current_earleme)
+@ Returns the offset of |cil| in the CIL area,
+numbering it if it is new.
+A |NULL| CIL is written as |-1|.
 @<Function definitions@> =
-Marpa_Earleme marpa_r_current_earleme(Marpa_Recognizer r)
+PRIVATE int
+gsnap_cil_offset (GSNAP_WRITER w, CIL cil)
 {
-  @<Unpack recognizer objects@>@;
-  if (_MARPA_UNLIKELY(Input_Phase_of_R(r) == R_BEFORE_INPUT)) {
-      MARPA_ERROR(MARPA_ERR_RECCE_NOT_STARTED);
-      return -1;
-  }
-  return Current_Earleme_of_R(r);
+  GSNAP_CIL_Object probe;
+  GSNAP_CIL_Object *gsnap_cil;
+  if (!cil)
+    return -1;
+  probe.t_cil = cil;
+  gsnap_cil = _marpa_avl_find (w->t_cil_tree, &probe);
+  if (!gsnap_cil)
+    {
+      gsnap_cil =
+        marpa_obs_new (MARPA_AVL_OBSTACK (w->t_cil_tree), GSNAP_CIL_Object, 1);
+      gsnap_cil->t_cil = cil;
+      gsnap_cil->t_offset = w->t_cil_area_size;
+      w->t_cil_area_size += Count_of_CIL (cil) + 1;
+      *MARPA_DSTACK_PUSH (w->t_cil_stack, CIL) = cil;
+      _marpa_avl_insert (w->t_cil_tree, gsnap_cil);
+    }
+  return gsnap_cil->t_offset;
 }
 
-@ The ``Earley set at the current earleme'' is always
-the latest YS, if it is defined.
-There may not be a YS at the current earleme.
-@d YS_at_Current_Earleme_of_R(r) ys_at_current_earleme(r)
-@<Function definitions@> =
-PRIVATE YS ys_at_current_earleme(RECCE r)
+@ @<Function definitions@> =
+PRIVATE_NOT_INLINE int
+gsnap_cil_cmp (const void *ap, const void *bp, void *param @,@, UNUSED)
 {
-    const YS latest = Latest_YS_of_R(r);
-    if (Earleme_of_YS(latest) == Current_Earleme_of_R(r)) return latest;
-    return NULL;
+  const GSNAP_CIL_Object *gsnap_cil_a = ap;
+  const GSNAP_CIL_Object *gsnap_cil_b = bp;
+  return cil_cmp (gsnap_cil_a->t_cil, gsnap_cil_b->t_cil, NULL);
 }
 
-@*0 Earley set warning threshold.
-@d DEFAULT_YIM_WARNING_THRESHOLD (100)
-@<Int aligned recognizer elements@> = int t_earley_item_warning_threshold;
-@ @<Initialize recognizer elements@> =
-r->t_earley_item_warning_threshold =
-    MAX (DEFAULT_YIM_WARNING_THRESHOLD, AHM_Count_of_G (g) * 3);
-@ @<Function definitions@> =
-int
-marpa_r_earley_item_warning_threshold (Marpa_Recognizer r)
+@ A |NULL| boolean vector is written as a bit count of |-1|.
+@<Function definitions@> =
+PRIVATE void
+gsnap_bv_write (GSNAP_WRITER w, Bit_Vector bv)
 {
-  return r->t_earley_item_warning_threshold;
+  if (!bv)
+    {
+      gsnap_int_write (w, -1);
+      return;
+    }
+  gsnap_int_write (w, (int) BV_BITS (bv));
+  gsnap_write (w, bv, BV_SIZE (bv) * sizeof (Bit_Vector_Word));
 }
 
-@ Returns true on success,
-false on failure.
+@ Write everything after the header.
 @<Function definitions@> =
-int
-marpa_r_earley_item_warning_threshold_set (Marpa_Recognizer r, int threshold)
+PRIVATE void
+gsnap_body_write (GRAMMAR g, GSNAP_WRITER w)
 {
-  const int new_threshold = threshold <= 0 ? YIM_FATAL_THRESHOLD : threshold;
-  r->t_earley_item_warning_threshold = new_threshold;
-  return new_threshold;
+  @<Write the snapshot images@>@;
+  @<Write the snapshot boolean vectors@>@;
+  @<Write the snapshot links@>@;
+  @<Write the snapshot CIL area@>@;
 }
 
-@*0 Furthest earleme.
-The ``furthest'' or highest-numbered earleme.
-This is the earleme of the last Earley set that contains anything.
-Marpa allows variable length tokens,
-so it needs to track how far out tokens might be found.
-No complete or predicted Earley item will be found after the current earleme.
-@d Furthest_Earleme_of_R(r) ((r)->t_furthest_earleme)
-@<Int aligned recognizer elements@> = JEARLEME t_furthest_earleme;
-@ @<Initialize recognizer elements@> = r->t_furthest_earleme = 0;
-@ @<Function definitions@> =
-unsigned int marpa_r_furthest_earleme(Marpa_Recognizer r)
-{ return (unsigned int)Furthest_Earleme_of_R(r); }
-
-@*0 Event variables.
-The count of unmasked XSY events.
-This count is used to protect recognizers that do not
-use events from their overhead.
-All these have to do is check the count against zero.
-There is no aggressive
-attempt to optimize on a more fine-grained
-basis --
-for recognizer which actually do use completion events,
-a few instructions per Earley item of overhead is
-considered reasonable.
-@ @<Widely aligned recognizer elements@> =
-Bit_Vector t_lbv_xsyid_completion_event_is_active;
-Bit_Vector t_lbv_xsyid_nulled_event_is_active;
-Bit_Vector t_lbv_xsyid_prediction_event_is_active;
-@ @<Int aligned recognizer elements@> =
-int t_active_event_count;
-@ @<Initialize recognizer event variables@> =
+@ The IRL's and XRL's are variable length,
+and only the part of each which is in use is written.
+@<Write the snapshot images@> =
+{
+  int ix;
+  for (ix = 0; ix < XSY_Count_of_G (g); ix++)
     {
-      NSYID xsy_count = XSY_Count_of_G (g);
-      r->t_lbv_xsyid_completion_event_is_active =
-        lbv_clone (r->t_obs, g->t_lbv_xsyid_completion_event_starts_active, xsy_count);
-      r->t_lbv_xsyid_nulled_event_is_active =
-        lbv_clone (r->t_obs, g->t_lbv_xsyid_nulled_event_starts_active, xsy_count);
-      r->t_lbv_xsyid_prediction_event_is_active =
-        lbv_clone (r->t_obs, g->t_lbv_xsyid_prediction_event_starts_active, xsy_count);
-      r->t_active_event_count =
-        bv_count ( g->t_lbv_xsyid_is_completion_event)
-        + bv_count ( g->t_lbv_xsyid_is_nulled_event)
-        + bv_count ( g->t_lbv_xsyid_is_prediction_event) ;
+      struct s_xsy image = *XSY_by_ID (ix);
+      Nulled_XSYIDs_of_XSY (&image) = NULL;
+      NSY_of_XSY (&image) = NULL;
+      Nulling_NSY_of_XSY (&image) = NULL;
+      gsnap_write (w, &image, sizeof (image));
+    }
+  for (ix = 0; ix < NSY_Count_of_G (g); ix++)
+    {
+      struct s_nsy image = *NSY_by_ID (ix);
+      LHS_CIL_of_NSY (&image) = NULL;
+      Source_XSY_of_NSY (&image) = NULL;
+      LHS_XRL_of_NSY (&image) = NULL;
+      gsnap_write (w, &image, sizeof (image));
+    }
+  for (ix = 0; ix < XRL_Count_of_G (g); ix++)
+    {
+      const XRL xrl = XRL_by_ID (ix);
+      gsnap_write (w, xrl,
+                   offsetof (struct s_xrl, t_symbols) +
+                   ((size_t) Length_of_XRL (xrl) +
+                    1) * sizeof (xrl->t_symbols[0]));
     }
+  for (ix = 0; ix < IRL_Count_of_G (g); ix++)
+    {
+      const IRL irl = IRL_by_ID (ix);
+      IRL_Object image;
+      memcpy (&image, irl, offsetof (IRL_Object, t_nsyid_array));
+      Source_XRL_of_IRL (&image) = NULL;
+      First_AHM_of_IRL (&image) = NULL;
+      gsnap_write (w, &image, offsetof (IRL_Object, t_nsyid_array));
+      gsnap_write (w, irl->t_nsyid_array,
+                   ((size_t) Length_of_IRL (irl) +
+                    1) * sizeof (irl->t_nsyid_array[0]));
+    }
+  for (ix = 0; ix < AHM_Count_of_G (g); ix++)
+    {
+      struct s_ahm image = *AHM_by_ID (ix);
+      IRL_of_AHM (&image) = NULL;
+      Predicted_IRL_CIL_of_AHM (&image) = NULL;
+      LHS_CIL_of_AHM (&image) = NULL;
+      ZWA_CIL_of_AHM (&image) = NULL;
+      Completion_XSYIDs_of_AHM (&image) = NULL;
+      Nulled_XSYIDs_of_AHM (&image) = NULL;
+      Prediction_XSYIDs_of_AHM (&image) = NULL;
+      XRL_of_AHM (&image) = NULL;
+      Event_AHMIDs_of_AHM (&image) = NULL;
+      gsnap_write (w, &image, sizeof (image));
+    }
+  for (ix = 0; ix < ZWA_Count_of_G (g); ix++)
+    {
+      gsnap_write (w, GZWA_by_ID (ix), sizeof (GZWA_Object));
+    }
+}
 
-@*0 Expected symbol boolean vector.
-A boolean vector by symbol ID,
-with the bits set if the symbol is expected
-at the current earleme.
-@<Widely aligned recognizer elements@> = Bit_Vector t_bv_nsyid_is_expected;
-@ @<Initialize recognizer elements@> =
-    r->t_bv_nsyid_is_expected = bv_obs_create( r->t_obs, nsy_count );
-@ Returns |-2| if there was a failure.
-The buffer is expected to be large enough to hold
-the result.
-This will be the case if the length of the buffer
-is greater than or equal to the number of symbols
-in the grammar.
-@<Function definitions@> =
-int marpa_r_terminals_expected(Marpa_Recognizer r, Marpa_Symbol_ID* buffer)
+@ @<Write the snapshot boolean vectors@> =
 {
-  @<Return |-2| on failure@>@;
-  @<Unpack recognizer objects@>@;
-  NSYID xsy_count;
-  Bit_Vector bv_terminals;
-  int min, max, start;
-  int next_buffer_ix = 0;
-
-  @<Fail if fatal error@>@;
-  @<Fail if recognizer not started@>@;
+  gsnap_bv_write (w, g->t_bv_nsyid_is_terminal);
+  gsnap_bv_write (w, g->t_lbv_xsyid_is_completion_event);
+  gsnap_bv_write (w, g->t_lbv_xsyid_completion_event_starts_active);
+  gsnap_bv_write (w, g->t_lbv_xsyid_is_nulled_event);
+  gsnap_bv_write (w, g->t_lbv_xsyid_nulled_event_starts_active);
+  gsnap_bv_write (w, g->t_lbv_xsyid_is_prediction_event);
+  gsnap_bv_write (w, g->t_lbv_xsyid_prediction_event_starts_active);
+}
 
-  xsy_count = XSY_Count_of_G (g);
-  bv_terminals = bv_create (xsy_count);
-  for (start = 0; bv_scan (r->t_bv_nsyid_is_expected, start, &min, &max);
-       start = max + 2)
+@ The links are written in the same order as the images.
+A |NULL| pointer to an object is written as the ID |-1|.
+@<Write the snapshot links@> =
+{
+  int ix;
+  for (ix = 0; ix < XSY_Count_of_G (g); ix++)
     {
-      NSYID nsyid;
-      for (nsyid = min; nsyid <= max; nsyid++)
-	{
-	  const XSY xsy = Source_XSY_of_NSYID (nsyid);
-	  bv_bit_set (bv_terminals, ID_of_XSY (xsy));
-	}
+      const XSY xsy = XSY_by_ID (ix);
+      const NSY nsy = NSY_of_XSY (xsy);
+      const NSY nulling_nsy = Nulling_NSY_of_XSY (xsy);
+      gsnap_int_write (w, gsnap_cil_offset (w, Nulled_XSYIDs_of_XSY (xsy)));
+      gsnap_int_write (w, nsy ? ID_of_NSY (nsy) : -1);
+      gsnap_int_write (w, nulling_nsy ? ID_of_NSY (nulling_nsy) : -1);
+    }
+  for (ix = 0; ix < NSY_Count_of_G (g); ix++)
+    {
+      const NSY nsy = NSY_by_ID (ix);
+      const XSY source_xsy = Source_XSY_of_NSY (nsy);
+      const XRL lhs_xrl = LHS_XRL_of_NSY (nsy);
+      gsnap_int_write (w, gsnap_cil_offset (w, LHS_CIL_of_NSY (nsy)));
+      gsnap_int_write (w, source_xsy ? ID_of_XSY (source_xsy) : -1);
+      gsnap_int_write (w, lhs_xrl ? ID_of_XRL (lhs_xrl) : -1);
+    }
+  for (ix = 0; ix < IRL_Count_of_G (g); ix++)
+    {
+      const IRL irl = IRL_by_ID (ix);
+      const XRL source_xrl = Source_XRL_of_IRL (irl);
+      const AHM first_ahm = First_AHM_of_IRL (irl);
+      gsnap_int_write (w, source_xrl ? ID_of_XRL (source_xrl) : -1);
+      gsnap_int_write (w, first_ahm ? (int) ID_of_AHM (first_ahm) : -1);
     }
-
-  for (start = 0; bv_scan (bv_terminals, start, &min, &max); start = max + 2)
+  for (ix = 0; ix < AHM_Count_of_G (g); ix++)
     {
-      XSYID xsyid;
-      for (xsyid = min; xsyid <= max; xsyid++)
-	{
-	  buffer[next_buffer_ix++] = xsyid;
-	}
+      const AHM ahm = AHM_by_ID (ix);
+      const XRL xrl = XRL_of_AHM (ahm);
+      gsnap_int_write (w, ID_of_IRL (IRL_of_AHM (ahm)));
+      gsnap_int_write (w, xrl ? ID_of_XRL (xrl) : -1);
+      gsnap_int_write (w,
+                       gsnap_cil_offset (w, Predicted_IRL_CIL_of_AHM (ahm)));
+      gsnap_int_write (w, gsnap_cil_offset (w, LHS_CIL_of_AHM (ahm)));
+      gsnap_int_write (w, gsnap_cil_offset (w, ZWA_CIL_of_AHM (ahm)));
+      gsnap_int_write (w,
+                       gsnap_cil_offset (w, Completion_XSYIDs_of_AHM (ahm)));
+      gsnap_int_write (w, gsnap_cil_offset (w, Nulled_XSYIDs_of_AHM (ahm)));
+      gsnap_int_write (w,
+                       gsnap_cil_offset (w, Prediction_XSYIDs_of_AHM (ahm)));
+      gsnap_int_write (w, gsnap_cil_offset (w, Event_AHMIDs_of_AHM (ahm)));
     }
-  bv_free (bv_terminals);
-  return next_buffer_ix;
 }
 
-@ @<Function definitions@> =
-int marpa_r_terminal_is_expected(Marpa_Recognizer r,
-Marpa_Symbol_ID xsy_id)
+@ @<Write the snapshot CIL area@> =
 {
-    @<Return |-2| on failure@>@;
-   @<Unpack recognizer objects@>@;
-   XSY xsy;
-   NSY nsy;
-    @<Fail if fatal error@>@;
-    @<Fail if recognizer not started@>@;
-    @<Fail if |xsy_id| is malformed@>@;
-    @<Fail if |xsy_id| does not exist@>@;
-    xsy = XSY_by_ID(xsy_id);
-    if (_MARPA_UNLIKELY(!XSY_is_Terminal(xsy))) {
-        return 0;
+  int cil_ix;
+  const int cil_count = MARPA_DSTACK_LENGTH (w->t_cil_stack);
+  for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
+    {
+      const CIL cil = *MARPA_DSTACK_INDEX (w->t_cil_stack, CIL, cil_ix);
+      gsnap_write (w, cil, Sizeof_CIL ((size_t) Count_of_CIL (cil)));
     }
-    nsy = NSY_of_XSY(xsy);
-    if (_MARPA_UNLIKELY(!nsy)) return 0; /* It may be an unused terminal */
-    return bv_bit_test (r->t_bv_nsyid_is_expected, ID_of_NSY(nsy));
 }
 
-@*0 Expected symbol is event?.
-A boolean vector by symbol ID,
-with the bits set if, when
-that symbol is an expected symbol,
-an event should be created.
-Here ``expected'' means ``expected as a terminal''.
-All expected symbols are predicted symbols,
-but the reverse is not true --
-predicted non-terminals are not ``expected'' symbols.
-@<Widely aligned recognizer elements@> = LBV t_nsy_expected_is_event;
-@ @<Initialize recognizer elements@> =
-  r->t_nsy_expected_is_event = lbv_obs_new0(r->t_obs, nsy_count);
-@ Returns |-2| if there was a failure.
+@ Returns the size of the snapshot in bytes, on success.
+If |buffer| is |NULL|, or |buffer_size| is less than the size
+of the snapshot, nothing is written,
+so that the application can call this method once
+to find the size, and again to write the snapshot.
 @<Function definitions@> =
 int
-marpa_r_expected_symbol_event_set (Marpa_Recognizer r, Marpa_Symbol_ID xsy_id,
-                                   int value)
+marpa_g_serialize (Marpa_Grammar g, void *buffer, size_t buffer_size)
 {
-    XSY xsy;
-    NSY nsy;
-    NSYID nsyid;
-    @<Return |-2| on failure@>@;
-    @<Unpack recognizer objects@>@;
-    @<Fail if fatal error@>@;
-    @<Fail if |xsy_id| is malformed@>@;
-    @<Soft fail if |xsy_id| does not exist@>@;
-    if (_MARPA_UNLIKELY (value < 0 || value > 1))
-      {
-        MARPA_ERROR (MARPA_ERR_INVALID_BOOLEAN);
-        return failure_indicator;
-      }
-    xsy = XSY_by_ID(xsy_id);
-    if (_MARPA_UNLIKELY(XSY_is_Nulling(xsy))) {
-      MARPA_ERROR (MARPA_ERR_SYMBOL_IS_NULLING);
-      return -2;
-    }
-    nsy = NSY_of_XSY(xsy);
-    if (_MARPA_UNLIKELY(!nsy)) {
-      MARPA_ERROR (MARPA_ERR_SYMBOL_IS_UNUSED);
-      return -2;
-    }
-    nsyid = ID_of_NSY(nsy);
-    if (value) {
-      lbv_bit_set(r->t_nsy_expected_is_event, nsyid);
-    } else {
-      lbv_bit_clear(r->t_nsy_expected_is_event, nsyid);
+  @<Return |-2| on failure@>@;
+  struct s_gsnap_writer writer;
+  int snapshot_size = failure_indicator;
+  @<Fail if fatal error@>@;
+  @<Fail if not precomputed@>@;
+  writer.t_cil_tree = _marpa_avl_create (gsnap_cil_cmp, NULL);
+  MARPA_DSTACK_INIT2 (writer.t_cil_stack, CIL);
+  writer.t_cil_area_size = 0;
+  writer.t_base = NULL;
+  writer.t_offset = sizeof (GSNAP_HEADER_Object);
+  gsnap_body_write (g, &writer);
+  if (_MARPA_UNLIKELY (writer.t_offset > INT_MAX))
+    {
+      MARPA_ERROR (MARPA_ERR_INVALID_SNAPSHOT);
+      goto CLEANUP;
     }
-    return value;
+  snapshot_size = (int) writer.t_offset;
+  if (buffer && buffer_size >= writer.t_offset)
+    {
+      writer.t_base = buffer;
+      writer.t_offset = sizeof (GSNAP_HEADER_Object);
+      gsnap_body_write (g, &writer);
+      @<Write the snapshot header@>@;
+    }
+  CLEANUP:;
+  _marpa_avl_destroy (writer.t_cil_tree);
+  MARPA_DSTACK_DESTROY (writer.t_cil_stack);
+  return snapshot_size;
+}
+
+@ @<Write the snapshot header@> =
+{
+  GSNAP_HEADER_Object header;
+  const size_t header_size = sizeof (header);
+  gsnap_header_init (&header);
+  header.t_size = snapshot_size;
+  header.t_checksum =
+    gsnap_checksum ((unsigned char *) buffer + header_size,
+                    (size_t) snapshot_size - header_size);
+  header.t_xsy_count = XSY_Count_of_G (g);
+  header.t_nsy_count = NSY_Count_of_G (g);
+  header.t_xrl_count = XRL_Count_of_G (g);
+  header.t_irl_count = IRL_Count_of_G (g);
+  header.t_ahm_count = AHM_Count_of_G (g);
+  header.t_gzwa_count = ZWA_Count_of_G (g);
+  header.t_cil_area_size = writer.t_cil_area_size;
+  header.t_start_xsy_id = g->t_start_xsy_id;
+  header.t_start_irl_id = g->t_start_irl ? ID_of_IRL (g->t_start_irl) : -1;
+  header.t_external_size = External_Size_of_G (g);
+  header.t_max_rule_length = g->t_max_rule_length;
+  header.t_default_rank = Default_Rank_of_G (g);
+  header.t_force_valued = g->t_force_valued;
+  header.t_symbol_instance_count = SYMI_Count_of_G (g);
+  header.t_has_cycle = g->t_has_cycle;
+  memcpy (buffer, &header, header_size);
+}
+
+@*0 Loading a snapshot.
+All reads from the snapshot are copies,
+so that the snapshot need not be aligned.
+A read which would run past the end of the snapshot fails.
+@<Function definitions@> =
+PRIVATE int
+gsnap_has (GSNAP_READER rd, size_t size)
+{
+  return size <= rd->t_size - rd->t_offset;
 }
 
-@*0 Deactivate symbol completed events.
-@ Allows a recognizer to deactivate and
-reactivate symbol completed events.
-A |boolean| value of 1 indicates reactivate,
-a boolean value of 0 indicates deactivate.
-To be reactivated, the symbol must have been
-set up for completion events in the grammar.
-Success occurs non-trivially
-if the bit can be set to the new value.
-Success occurs
-trivially if it was already set as specified.
-Any other result is a failure.
-On success, returns the new value.
-Returns |-2| if there was a failure.
+PRIVATE int
+gsnap_read (GSNAP_READER rd, void *data, size_t size)
+{
+  if (!gsnap_has (rd, size))
+    return 0;
+  memcpy (data, rd->t_base + rd->t_offset, size);
+  rd->t_offset += size;
+  return 1;
+}
+
+PRIVATE int
+gsnap_int_read (GSNAP_READER rd, int *p_value)
+{
+  return gsnap_read (rd, p_value, sizeof (*p_value));
+}
+
+@ Read an ID which must be either |-1|,
+or the ID of one of |count| objects.
 @<Function definitions@> =
-int
-marpa_r_completion_symbol_activate (Marpa_Recognizer r,
-                                    Marpa_Symbol_ID xsy_id, int reactivate)
+PRIVATE int
+gsnap_id_read (GSNAP_READER rd, int count, int *p_id)
 {
-    @<Return |-2| on failure@>@;
-    @<Unpack recognizer objects@>@;
-    @<Fail if fatal error@>@;
-    @<Fail if |xsy_id| is malformed@>@;
-    @<Soft fail if |xsy_id| does not exist@>@;
-    switch (reactivate) {
-    case 0:
-        if (lbv_bit_test(r->t_lbv_xsyid_completion_event_is_active, xsy_id)) {
-          lbv_bit_clear(r->t_lbv_xsyid_completion_event_is_active, xsy_id) ;
-          r->t_active_event_count--;
-        }
-        return 0;
-    case 1:
-        if (!lbv_bit_test(g->t_lbv_xsyid_is_completion_event, xsy_id)) {
-          /* An attempt to activate a completion event on a symbol which
-          was not set up for them. */
-          MARPA_ERROR (MARPA_ERR_SYMBOL_IS_NOT_COMPLETION_EVENT);
-        }
-        if (!lbv_bit_test(r->t_lbv_xsyid_completion_event_is_active, xsy_id)) {
-          lbv_bit_set(r->t_lbv_xsyid_completion_event_is_active, xsy_id) ;
-          r->t_active_event_count++;
-        }
-        return 1;
-    }
-    MARPA_ERROR (MARPA_ERR_INVALID_BOOLEAN);
-    return failure_indicator;
+  int id;
+  if (!gsnap_int_read (rd, &id))
+    return 0;
+  if (id < -1 || id >= count)
+    return 0;
+  *p_id = id;
+  return 1;
 }
 
-@*0 Deactivate and reactivate symbol nulled events.
-@ Allows a recognizer to deactivate and
-reactivate symbol nulled events.
-A |boolean| value of 1 indicates reactivate,
-a boolean value of 0 indicates deactivate.
-To be reactivated, the symbol must have been
-set up for nulled events in the grammar.
-Success occurs non-trivially
-if the bit can be set to the new value.
-Success occurs
-trivially if it was already set as specified.
-Any other result is a failure.
-On success, returns the new value.
-Returns |-2| if there was a failure.
+@ Read a CIL offset, and convert it to a CIL
+in the loaded CIL area.
 @<Function definitions@> =
-int
-marpa_r_nulled_symbol_activate (Marpa_Recognizer r, Marpa_Symbol_ID xsy_id,
-                                int reactivate)
+PRIVATE int
+gsnap_cil_read (GSNAP_READER rd, CIL cil_area, int cil_area_size,
+                CIL * p_cil)
 {
-    @<Return |-2| on failure@>@;
-    @<Unpack recognizer objects@>@;
-    @<Fail if fatal error@>@;
-    @<Fail if |xsy_id| is malformed@>@;
-    @<Soft fail if |xsy_id| does not exist@>@;
-    switch (reactivate) {
-    case 0:
-        if (lbv_bit_test(r->t_lbv_xsyid_nulled_event_is_active, xsy_id)) {
-          lbv_bit_clear(r->t_lbv_xsyid_nulled_event_is_active, xsy_id) ;
-          r->t_active_event_count--;
-        }
-        return 0;
-    case 1:
-        if (!lbv_bit_test(g->t_lbv_xsyid_is_nulled_event, xsy_id)) {
-          /* An attempt to activate a nulled event on a symbol which
-          was not set up for them. */
-          MARPA_ERROR (MARPA_ERR_SYMBOL_IS_NOT_NULLED_EVENT);
-        }
-        if (!lbv_bit_test(r->t_lbv_xsyid_nulled_event_is_active, xsy_id)) {
-          lbv_bit_set(r->t_lbv_xsyid_nulled_event_is_active, xsy_id) ;
-          r->t_active_event_count++;
-        }
-        return 1;
+  int offset;
+  CIL cil;
+  if (!gsnap_int_read (rd, &offset))
+    return 0;
+  if (offset == -1)
+    {
+      *p_cil = NULL;
+      return 1;
     }
-    MARPA_ERROR (MARPA_ERR_INVALID_BOOLEAN);
-    return failure_indicator;
+  if (offset < 0 || offset >= cil_area_size)
+    return 0;
+  cil = cil_area + offset;
+  if (Count_of_CIL (cil) < 0 || Count_of_CIL (cil) >= cil_area_size - offset)
+    return 0;
+  *p_cil = cil;
+  return 1;
 }
 
-@*0 Deactivate and reactivate symbol prediction events.
-@ Allows a recognizer to deactivate and
-reactivate symbol prediction events.
-A |boolean| value of 1 indicates reactivate,
-a boolean value of 0 indicates deactivate.
-To be reactivated, the symbol must have been
-set up for prediction events in the grammar.
-Success occurs non-trivially
-if the bit can be set to the new value.
-Success occurs
-trivially if it was already set as specified.
-Any other result is a failure.
-On success, returns the new value.
-Returns |-2| if there was a failure.
-@<Function definitions@> =
-int
-marpa_r_prediction_symbol_activate (Marpa_Recognizer r,
-                                    Marpa_Symbol_ID xsy_id, int reactivate)
+@ @<Function definitions@> =
+PRIVATE int
+gsnap_bv_read (GSNAP_READER rd, struct marpa_obstack *obs, Bit_Vector * p_bv)
 {
-    @<Return |-2| on failure@>@;
-    @<Unpack recognizer objects@>@;
-    @<Fail if fatal error@>@;
-    @<Fail if |xsy_id| is malformed@>@;
-    @<Soft fail if |xsy_id| does not exist@>@;
-    switch (reactivate) {
-    case 0:
-        if (lbv_bit_test(r->t_lbv_xsyid_prediction_event_is_active, xsy_id)) {
-          lbv_bit_clear(r->t_lbv_xsyid_prediction_event_is_active, xsy_id) ;
-          r->t_active_event_count--;
-        }
-        return 0;
-    case 1:
-        if (!lbv_bit_test(g->t_lbv_xsyid_is_prediction_event, xsy_id)) {
-          /* An attempt to activate a prediction event on a symbol which
-          was not set up for them. */
-          MARPA_ERROR (MARPA_ERR_SYMBOL_IS_NOT_PREDICTION_EVENT);
-        }
-        if (!lbv_bit_test(r->t_lbv_xsyid_prediction_event_is_active, xsy_id)) {
-          lbv_bit_set(r->t_lbv_xsyid_prediction_event_is_active, xsy_id) ;
-          r->t_active_event_count++;
-        }
-        return 1;
+  int bits;
+  Bit_Vector bv;
+  if (!gsnap_int_read (rd, &bits))
+    return 0;
+  if (bits == -1)
+    {
+      *p_bv = NULL;
+      return 1;
     }
-    MARPA_ERROR (MARPA_ERR_INVALID_BOOLEAN);
-    return failure_indicator;
+  if (bits < 0
+      || !gsnap_has (rd, bv_bits_to_size (bits) * sizeof (Bit_Vector_Word)))
+    return 0;
+  bv = bv_obs_create (obs, bits);
+  *p_bv = bv;
+  return gsnap_read (rd, bv, BV_SIZE (bv) * sizeof (Bit_Vector_Word));
 }
 
-@*0 Leo-related booleans.
-@*1 Turning Leo logic off and on.
-A trace flag, set if we are using Leo items.
-This flag is set by default.
-It has two uses.
-@ This flag is very useful for testing.
-Since Leo items do not affect function, only effiency,
-it is possible for the Leo logic to be broken or
-disabled without most tests noticiing.
-To make sure the Leo logic is intact,
-one of |libmarpa|'s tests runs one pass
-with Leo items off and another with Leo items on
-and compares them.
-@ This flag also allows the Leo logic
-to be turned off in certain cases in which the Leo logic
-actually slows things down.
-The Leo logic could be turned off if the user knows there is
-no right recursion, although the actual gain,
-would typically be small or not measurable.
-@ A real gain would occur in the case of highly ambiguous
-grammars, all or most of whose parses are actually evaluated.
-Since those Earley items eliminated by the Leo logic
-are actually recreated on an as-needed basis in the evaluation
-phase, in cases when most of the Earley items are needed
-for evaluation, the Leo logic would be eliminated Earley
-items only to have to add most of them later.
-In these cases,
-the Leo logic would impose a small overhead.
-@ The author's current view is that it is best
-to start by assuming that the Leo logic should
-be left on.
-In the rare event, that it turns out that the Leo
-logic is counter-productive,
-this flag can be used to test if turning the Leo
-logic off is helpful.
-@ It should be borne in mind that even when the Leo logic
-imposes a small cost in typical cases,
-it may act as a safeguard.
-The time complexity explosions prevented by Leo logic can
-easily mean the difference between an impractical computation
-and a practical one.
-In most applications, it is worth incurring an small
-overhead in the average case to prevent failures,
-even rare ones.
-@ There are two booleans.
-One is a flag that can be set and
-unset externally,
-indicating the application's intention to use Leo logic.
-An internal boolean tracks whether the Leo logic is
-actually enabled at any given point.
-@ The reason for having two booleans
-is that the Leo logic is only turned
-on once Earley set 0 is complete.
-While Earley set 0 is being processed the internal flag will always
-be unset, while the external flag may be set or unset, as the user
-decided.
-After Earley set 0 is complete, both booleans will have the same value.
-@ {\bf To Do}: @^To Do@>
-Now that the null parse is special-cased, one boolean may suffice.
-@<Bit aligned recognizer elements@> =
-BITFIELD t_use_leo_flag:1;
-BITFIELD t_is_using_leo:1;
-@ @<Initialize recognizer elements@> =
-r->t_use_leo_flag = 1;
-r->t_is_using_leo = 0;
-@ Returns 1 if the ``use Leo" flag is set,
-0 if not,
-and |-2| if there was an error.
+@ The snapshot is copied into the new grammar,
+so that the application may unmap it
+as soon as this method returns.
+The new grammar is precomputed, but not frozen.
+Events from the original precomputation are not kept.
 @<Function definitions@> =
-int _marpa_r_is_use_leo(Marpa_Recognizer  r)
-{
-   @<Unpack recognizer objects@>@;
-   @<Return |-2| on failure@>@;
-    @<Fail if fatal error@>@;
-    return r->t_use_leo_flag;
+Marpa_Grammar
+marpa_g_load_mapped (Marpa_Config * configuration,
+                     const void *snapshot, size_t snapshot_size)
+{
+  GSNAP_HEADER_Object header;
+  struct s_gsnap_reader reader;
+  Marpa_Error_Code error_code = MARPA_ERR_INVALID_SNAPSHOT;
+  CIL cil_area = NULL;
+  GRAMMAR g;
+  if (configuration && configuration->t_is_ok != I_AM_OK)
+    {
+      configuration->t_error = MARPA_ERR_I_AM_NOT_OK;
+      return NULL;
+    }
+  @<Check the snapshot header@>@;
+  g = marpa_g_new (configuration);
+  @<Load the snapshot CIL area@>@;
+  @<Load the snapshot scalars@>@;
+  @<Load the snapshot images@>@;
+  @<Load the snapshot boolean vectors@>@;
+  @<Load the snapshot links@>@;
+  @<Clear rule duplication tree@>@;
+  G_is_Precomputed (g) = 1;
+  return g;
+GRAMMAR_FAILURE:
+  grammar_free (g);
+FAILURE:
+  if (configuration)
+    configuration->t_error = error_code;
+  return NULL;
 }
-@ @<Function definitions@> =
-int _marpa_r_is_use_leo_set(
-Marpa_Recognizer r, int value)
+
+@ A mismatch of versions is reported with the
+same error codes as |marpa_check_version()|.
+@<Check the snapshot header@> =
 {
-   @<Unpack recognizer objects@>@;
-   @<Return |-2| on failure@>@/
-    @<Fail if fatal error@>@;
-    @<Fail if recognizer started@>@;
-    return r->t_use_leo_flag = value ? 1 : 0;
+  const size_t header_size = sizeof (header);
+  if (snapshot_size < header_size)
+    goto FAILURE;
+  memcpy (&header, snapshot, header_size);
+  if (header.t_magic != GSNAP_MAGIC)
+    goto FAILURE;
+  error_code =
+    marpa_check_version (header.t_major_version, header.t_minor_version,
+                         header.t_micro_version);
+  if (error_code != MARPA_ERR_NONE)
+    goto FAILURE;
+  error_code = MARPA_ERR_INVALID_SNAPSHOT;
+  if (!gsnap_header_is_compatible (&header))
+    goto FAILURE;
+  if (header.t_size < (int) header_size
+      || (size_t) header.t_size > snapshot_size)
+    goto FAILURE;
+  if (gsnap_checksum ((const unsigned char *) snapshot + header_size,
+                      (size_t) header.t_size - header_size)
+      != header.t_checksum)
+    goto FAILURE;
+  if (header.t_xsy_count < 0 || header.t_nsy_count < 0
+      || header.t_xrl_count < 0 || header.t_irl_count < 0
+      || header.t_ahm_count < 0 || header.t_gzwa_count < 0
+      || header.t_cil_area_size < 0
+      || header.t_cil_area_size >
+      (header.t_size - (int) header_size) / (int) sizeof (int))
+    goto FAILURE;
+  reader.t_base = snapshot;
+  reader.t_offset = header_size;
+  reader.t_size = (size_t) header.t_size;
+}
+
+@ The CIL area is at the end of the snapshot,
+and is loaded first, so that the CIL's are ready
+when the links are read.
+It is copied in one piece.
+Since it is not written after precomputation,
+the grammar's CILAR is not used.
+The size of the snapshot is adjusted so that
+reads of the rest of the snapshot
+cannot run into the CIL area.
+@<Load the snapshot CIL area@> =
+{
+  const size_t cil_area_bytes =
+    (size_t) header.t_cil_area_size * sizeof (int);
+  reader.t_size -= cil_area_bytes;
+  if (header.t_cil_area_size > 0)
+    {
+      cil_area = marpa_obs_new (g->t_obs, int, header.t_cil_area_size);
+      memcpy (cil_area, reader.t_base + reader.t_size, cil_area_bytes);
+    }
 }
 
-@*0 Predicted IRL boolean vector and stack.
-A boolean vector by IRL ID,
-used while building the Earley sets.
-It is set if an IRL has already been predicted,
-unset otherwise.
-@<Widely aligned recognizer elements@> =
-  Bit_Vector t_bv_irl_seen;
-  MARPA_DSTACK_DECLARE(t_irl_cil_stack);
-@ @<Initialize recognizer elements@> =
-  r->t_bv_irl_seen = bv_obs_create( r->t_obs, irl_count );
-  MARPA_DSTACK_INIT2(r->t_irl_cil_stack, CIL);
-@ @<Destroy recognizer elements@> =
-  MARPA_DSTACK_DESTROY(r->t_irl_cil_stack);
+@ @<Load the snapshot scalars@> =
+{
+  if (header.t_start_xsy_id < -1
+      || header.t_start_xsy_id >= header.t_xsy_count)
+    goto GRAMMAR_FAILURE;
+  g->t_start_xsy_id = header.t_start_xsy_id;
+  External_Size_of_G (g) = header.t_external_size;
+  g->t_max_rule_length = header.t_max_rule_length;
+  Default_Rank_of_G (g) = header.t_default_rank;
+  g->t_force_valued = header.t_force_valued;
+  SYMI_Count_of_G (g) = header.t_symbol_instance_count;
+  g->t_has_cycle = header.t_has_cycle ? 1 : 0;
+}
 
-@*1 Is the parser exhausted?.
-A parser is ``exhausted" if it cannot accept any more input.
-Both successful and failed parses can be ``exhausted".
-In many grammars,
-the parse is always exhausted as soon as it succeeds.
-And even if the parse is exhausted at a point
-where there is no good parse,
-there may be good parses at earlemes prior to the
-earleme at which the parse became exhausted.
-@d R_is_Exhausted(r) ((r)->t_is_exhausted)
-@<Bit aligned recognizer elements@> = BITFIELD t_is_exhausted:1;
-@ @<Initialize recognizer elements@> = r->t_is_exhausted = 0;
-@ @<Set |r| exhausted@> =
+@ The images are copied into objects allocated
+just as precomputation allocates them.
+@<Load the snapshot images@> =
 {
-  R_is_Exhausted (r) = 1;
-  Input_Phase_of_R (r) = R_AFTER_INPUT;
-  event_new (g, MARPA_EVENT_EXHAUSTED);
+  int ix;
+  for (ix = 0; ix < header.t_xsy_count; ix++)
+    {
+      const XSY xsy = marpa_obs_new (g->t_obs, struct s_xsy, 1);
+      if (!gsnap_read (&reader, xsy, sizeof (*xsy)))
+        goto GRAMMAR_FAILURE;
+      *MARPA_DSTACK_PUSH (g->t_xsy_stack, XSY) = xsy;
+    }
+  MARPA_DSTACK_INIT (g->t_nsy_stack, NSY, MAX (header.t_nsy_count, 1));
+  for (ix = 0; ix < header.t_nsy_count; ix++)
+    {
+      const NSY nsy = marpa_obs_new (g->t_obs, struct s_nsy, 1);
+      if (!gsnap_read (&reader, nsy, sizeof (*nsy)))
+        goto GRAMMAR_FAILURE;
+      *MARPA_DSTACK_PUSH (g->t_nsy_stack, NSY) = nsy;
+    }
+  for (ix = 0; ix < header.t_xrl_count; ix++)
+    {
+      struct s_xrl base;
+      const size_t base_size = offsetof (struct s_xrl, t_symbols);
+      size_t symbols_size;
+      XRL xrl;
+      if (!gsnap_read (&reader, &base, base_size)
+          || Length_of_XRL (&base) < 0)
+        goto GRAMMAR_FAILURE;
+      symbols_size =
+        ((size_t) Length_of_XRL (&base) + 1) * sizeof (base.t_symbols[0]);
+      if (!gsnap_has (&reader, symbols_size))
+        goto GRAMMAR_FAILURE;
+      xrl = marpa__obs_alloc (g->t_xrl_obs, base_size + symbols_size,
+                              ALIGNOF (XRL));
+      memcpy (xrl, &base, base_size);
+      gsnap_read (&reader, xrl->t_symbols, symbols_size);
+      *MARPA_DSTACK_PUSH (g->t_xrl_stack, XRL) = xrl;
+    }
+  MARPA_DSTACK_INIT (g->t_irl_stack, IRL, MAX (header.t_irl_count, 1));
+  for (ix = 0; ix < header.t_irl_count; ix++)
+    {
+      IRL_Object base;
+      const size_t base_size = offsetof (IRL_Object, t_nsyid_array);
+      size_t nsyids_size;
+      IRL irl;
+      if (!gsnap_read (&reader, &base, base_size)
+          || Length_of_IRL (&base) < 0)
+        goto GRAMMAR_FAILURE;
+      nsyids_size =
+        ((size_t) Length_of_IRL (&base) + 1) * sizeof (base.t_nsyid_array[0]);
+      if (!gsnap_has (&reader, nsyids_size))
+        goto GRAMMAR_FAILURE;
+      irl = marpa__obs_alloc (g->t_obs, base_size + nsyids_size,
+                              ALIGNOF (IRL_Object));
+      memcpy (irl, &base, base_size);
+      gsnap_read (&reader, irl->t_nsyid_array, nsyids_size);
+      *MARPA_DSTACK_PUSH (g->t_irl_stack, IRL) = irl;
+    }
+  if (header.t_ahm_count > 0)
+    {
+      const size_t ahms_size =
+        (size_t) header.t_ahm_count * sizeof (struct s_ahm);
+      if (!gsnap_has (&reader, ahms_size))
+        goto GRAMMAR_FAILURE;
+      g->t_ahms = marpa_new (struct s_ahm, header.t_ahm_count);
+      gsnap_read (&reader, g->t_ahms, ahms_size);
+    }
+  AHM_Count_of_G (g) = header.t_ahm_count;
+  for (ix = 0; ix < header.t_gzwa_count; ix++)
+    {
+      const GZWA gzwa = marpa_obs_new (g->t_obs, GZWA_Object, 1);
+      if (!gsnap_read (&reader, gzwa, sizeof (*gzwa)))
+        goto GRAMMAR_FAILURE;
+      *MARPA_DSTACK_PUSH (g->t_gzwa_stack, GZWA) = gzwa;
+    }
+  if (header.t_start_irl_id < -1
+      || header.t_start_irl_id >= header.t_irl_count)
+    goto GRAMMAR_FAILURE;
+  g->t_start_irl =
+    header.t_start_irl_id < 0 ? NULL : IRL_by_ID (header.t_start_irl_id);
+}
+
+@ @<Load the snapshot boolean vectors@> =
+{
+  if (!gsnap_bv_read (&reader, g->t_obs, &g->t_bv_nsyid_is_terminal)
+      || !gsnap_bv_read (&reader, g->t_obs,
+                         &g->t_lbv_xsyid_is_completion_event)
+      || !gsnap_bv_read (&reader, g->t_obs,
+                         &g->t_lbv_xsyid_completion_event_starts_active)
+      || !gsnap_bv_read (&reader, g->t_obs, &g->t_lbv_xsyid_is_nulled_event)
+      || !gsnap_bv_read (&reader, g->t_obs,
+                         &g->t_lbv_xsyid_nulled_event_starts_active)
+      || !gsnap_bv_read (&reader, g->t_obs,
+                         &g->t_lbv_xsyid_is_prediction_event)
+      || !gsnap_bv_read (&reader, g->t_obs,
+                         &g->t_lbv_xsyid_prediction_event_starts_active))
+    goto GRAMMAR_FAILURE;
+}
+
+@ Every ID is checked, so that a pointer
+cannot be fixed up to point outside its table.
+The links must end exactly where the CIL area begins.
+@<Load the snapshot links@> =
+{
+  int ix;
+  const int cil_area_size = header.t_cil_area_size;
+  for (ix = 0; ix < header.t_xsy_count; ix++)
+    {
+      const XSY xsy = XSY_by_ID (ix);
+      NSYID nsyid;
+      NSYID nulling_nsyid;
+      if (!gsnap_cil_read (&reader, cil_area, cil_area_size,
+                           &Nulled_XSYIDs_of_XSY (xsy))
+          || !gsnap_id_read (&reader, header.t_nsy_count, &nsyid)
+          || !gsnap_id_read (&reader, header.t_nsy_count, &nulling_nsyid))
+        goto GRAMMAR_FAILURE;
+      NSY_of_XSY (xsy) = nsyid < 0 ? NULL : NSY_by_ID (nsyid);
+      Nulling_NSY_of_XSY (xsy) =
+        nulling_nsyid < 0 ? NULL : NSY_by_ID (nulling_nsyid);
+    }
+  for (ix = 0; ix < header.t_nsy_count; ix++)
+    {
+      const NSY nsy = NSY_by_ID (ix);
+      XSYID source_xsyid;
+      XRLID lhs_xrlid;
+      if (!gsnap_cil_read (&reader, cil_area, cil_area_size,
+                           &LHS_CIL_of_NSY (nsy))
+          || !gsnap_id_read (&reader, header.t_xsy_count, &source_xsyid)
+          || !gsnap_id_read (&reader, header.t_xrl_count, &lhs_xrlid))
+        goto GRAMMAR_FAILURE;
+      Source_XSY_of_NSY (nsy) =
+        source_xsyid < 0 ? NULL : XSY_by_ID (source_xsyid);
+      LHS_XRL_of_NSY (nsy) = lhs_xrlid < 0 ? NULL : XRL_by_ID (lhs_xrlid);
+    }
+  for (ix = 0; ix < header.t_irl_count; ix++)
+    {
+      const IRL irl = IRL_by_ID (ix);
+      XRLID source_xrlid;
+      AHMID first_ahmid;
+      if (!gsnap_id_read (&reader, header.t_xrl_count, &source_xrlid)
+          || !gsnap_id_read (&reader, header.t_ahm_count, &first_ahmid))
+        goto GRAMMAR_FAILURE;
+      Source_XRL_of_IRL (irl) =
+        source_xrlid < 0 ? NULL : XRL_by_ID (source_xrlid);
+      First_AHM_of_IRL (irl) =
+        first_ahmid < 0 ? NULL : AHM_by_ID (first_ahmid);
+    }
+  for (ix = 0; ix < header.t_ahm_count; ix++)
+    {
+      const AHM ahm = AHM_by_ID (ix);
+      IRLID irlid;
+      XRLID xrlid;
+      if (!gsnap_id_read (&reader, header.t_irl_count, &irlid)
+          || irlid < 0
+          || !gsnap_id_read (&reader, header.t_xrl_count, &xrlid)
+          || !gsnap_cil_read (&reader, cil_area, cil_area_size,
+                              &Predicted_IRL_CIL_of_AHM (ahm))
+          || !gsnap_cil_read (&reader, cil_area, cil_area_size,
+                              &LHS_CIL_of_AHM (ahm))
+          || !gsnap_cil_read (&reader, cil_area, cil_area_size,
+                              &ZWA_CIL_of_AHM (ahm))
+          || !gsnap_cil_read (&reader, cil_area, cil_area_size,
+                              &Completion_XSYIDs_of_AHM (ahm))
+          || !gsnap_cil_read (&reader, cil_area, cil_area_size,
+                              &Nulled_XSYIDs_of_AHM (ahm))
+          || !gsnap_cil_read (&reader, cil_area, cil_area_size,
+                              &Prediction_XSYIDs_of_AHM (ahm))
+          || !gsnap_cil_read (&reader, cil_area, cil_area_size,
+                              &Event_AHMIDs_of_AHM (ahm)))
+        goto GRAMMAR_FAILURE;
+      IRL_of_AHM (ahm) = IRL_by_ID (irlid);
+      XRL_of_AHM (ahm) = xrlid < 0 ? NULL : XRL_by_ID (xrlid);
+    }
+  if (reader.t_offset != reader.t_size)
+    goto GRAMMAR_FAILURE;
 }
 
-@ Exhaustion is a boolean, not a phase.
-Once exhausted a parse stays exhausted,
-even though the phase may change.
+@** Recognizer (R, RECCE) code.
+@<Public incomplete structures@> =
+struct marpa_r;
+typedef struct marpa_r* Marpa_Recognizer;
+typedef Marpa_Recognizer Marpa_Recce;
+@ @<Private typedefs@> =
+typedef struct marpa_r* RECCE;
+@ @<Recognizer structure@> =
+struct marpa_r {
+    @<Widely aligned recognizer elements@>@;
+    @<Int aligned recognizer elements@>@;
+    @<Bit aligned recognizer elements@>@;
+};
+
+@ The grammar must not be deallocated for the life of the
+recognizer.
+In the event of an error creating the recognizer,
+|NULL| is returned.
 @<Function definitions@> =
-int marpa_r_is_exhausted(Marpa_Recognizer r)
+Marpa_Recognizer marpa_r_new( Marpa_Grammar g )
 {
-   @<Unpack recognizer objects@>@;
-   @<Return |-2| on failure@>@/
-    @<Fail if fatal error@>@;
-    return R_is_Exhausted(r);
+    RECCE r;
+    int nsy_count;
+    int irl_count;
+    @<Return |NULL| on failure@>@;
+    @<Fail if not precomputed@>@;
+    nsy_count = NSY_Count_of_G(g);
+    irl_count = IRL_Count_of_G(g);
+    marpa__obs_pool_reserve (Chunk_Pool_Size_of_G (g));
+    r = my_malloc(sizeof(struct marpa_r));
+    @<Initialize recognizer obstack@>@;
+    @<Initialize recognizer elements@>@;
+    @<Initialize dot PSAR@>@;
+    @<Attach the recognizer memory budget@>@;
+    ys_segment_open (r);
+    @<Initialize recognizer event variables@>@;
+    return r;
 }
 
-@*1 Is the parser consistent?
-A parser becomes inconsistent when
-YIM's or LIM's or ALT's are rejected.
-It can be made consistent again by calling
-|marpa_r_consistent()|.
-@d First_Inconsistent_YS_of_R(r) ((r)->t_first_inconsistent_ys)
-@d R_is_Consistent(r) ((r)->t_first_inconsistent_ys < 0)
-@<Int aligned recognizer elements@> = YSID t_first_inconsistent_ys;
-@ @<Initialize recognizer elements@> = r->t_first_inconsistent_ys = -1;
-
-@*0 The recognizer obstack.
-Create an obstack with the lifetime of the recognizer.
-This is a very efficient way of allocating memory which won't be
-resized and which will have the same lifetime as the recognizer.
-@<Widely aligned recognizer elements@> = struct marpa_obstack *t_obs;
-@ @<Initialize recognizer obstack@> = r->t_obs = marpa_obs_init;
-@ @<Destroy recognizer obstack@> = marpa_obs_free(r->t_obs);
-
-@*1 The ZWA Array.
-@d ID_of_ZWA(zwa) ((zwa)->t_id)
-@d Memo_YSID_of_ZWA(zwa) ((zwa)->t_memoized_ysid)
-@d Memo_Value_of_ZWA(zwa) ((zwa)->t_memoized_value)
-@d Default_Value_of_ZWA(zwa) ((zwa)->t_default_value)
-@<Private structures@> =
-struct s_r_zwa {
-    ZWAID t_id;
-    YSID t_memoized_ysid;
-    BITFIELD t_default_value:1;
-    BITFIELD t_memoized_value:1;
-};
-typedef struct s_r_zwa ZWA_Object;
-
-@ The grammar and recce ZWA counts are always the same.
-@d ZWA_Count_of_R(r) (ZWA_Count_of_G(G_of_R(r)))
-@d RZWA_by_ID(id) (&(r)->t_zwas[(zwaid)])
-@<Widely aligned recognizer elements@> =
-    ZWA t_zwas;
-@ @<Initialize recognizer elements@> =
-{
-    ZWAID zwaid;
-    const int zwa_count = ZWA_Count_of_R(r);
-    (r)->t_zwas = marpa_obs_new(r->t_obs, ZWA_Object, ZWA_Count_of_R(r));
-    for (zwaid = 0; zwaid < zwa_count; zwaid++) {
-        const GZWA gzwa = GZWA_by_ID(zwaid);
-        const ZWA zwa = RZWA_by_ID(zwaid);
-        ID_of_ZWA(zwa) = ID_of_GZWA(gzwa);
-        Default_Value_of_ZWA(zwa) = Default_Value_of_GZWA(gzwa);
-        Memo_Value_of_ZWA(zwa) = Default_Value_of_GZWA(gzwa);
-        Memo_YSID_of_ZWA(zwa) = -1;
-    }
-}
-
-@** Earlemes.
-In most parsers, the input is modeled as a token stream ---
-a sequence of tokens.
-In this model the idea of location is not complex.
-The first token is at location 0, the second at location 1,
-etc.
-@ Marpa allows ambiguous and variable length tokens, and requires
-a more flexible idea of location, with a unit of length.
-The unit of token length in Marpa is called an Earleme.
-The locations themselves are often called earlemes.
-@ |JEARLEME_THRESHOLD| is less than |INT_MAX| so that
-I can prevent overflow without getting fancy -- overflow
-by addition is impossible as long as earlemes are below
-the threshold.
-@ I considered defining earlemes as |long| or
-explicitly as 64-bit integers.
-But machines with 32-bit int's
-will in a not very long time
-become museum pieces.
-And in the meantime this
-definition of |JEARLEME_THRESHOLD| probably allows as large as
-parse as the memories on those machines will be
-able to handle.
-@d JEARLEME_THRESHOLD (INT_MAX/4)
-@<Public typedefs@> = typedef int Marpa_Earleme;
-@ @<Private typedefs@> = typedef Marpa_Earleme JEARLEME;
-
-@** Earley set (YS) code.
-@<Public typedefs@> = typedef int Marpa_Earley_Set_ID;
-@ @<Private typedefs@> = typedef Marpa_Earley_Set_ID YSID;
-@ @d Next_YS_of_YS(set) ((set)->t_next_earley_set)
-@d Postdot_SYM_Count_of_YS(set) ((set)->t_postdot_sym_count)
-@d First_PIM_of_YS_by_NSYID(set, nsyid) (first_pim_of_ys_by_nsyid((set), (nsyid)))
-@d PIM_NSY_P_of_YS_by_NSYID(set, nsyid) (pim_nsy_p_find((set), (nsyid)))
-@s YS int
-@<Private incomplete structures@> =
-struct s_earley_set;
-typedef struct s_earley_set *YS;
-typedef const struct s_earley_set *YS_Const;
-struct s_earley_set_key;
-typedef struct s_earley_set_key *YSK;
-@ @<Private structures@> =
-struct s_earley_set_key {
-    JEARLEME t_earleme;
-};
-typedef struct s_earley_set_key YSK_Object;
-@ @<Private structures@> =
-struct s_earley_set {
-    YSK_Object t_key;
-    union u_postdot_item** t_postdot_ary;
-    YS t_next_earley_set;
-    @<Widely aligned Earley set elements@>@;
-    int t_postdot_sym_count;
-    @<Int aligned Earley set elements@>@;
-};
-typedef struct s_earley_set YS_Object;
-
-@*0 Earley item container.
-@d YIM_Count_of_YS(set) ((set)->t_yim_count)
-@<Int aligned Earley set elements@> =
-int t_yim_count;
-@ @d YIMs_of_YS(set) ((set)->t_earley_items)
-@<Widely aligned Earley set elements@> =
-YIM* t_earley_items;
-
-@*0 Ordinal.
-The ordinal of the Earley set---
-its number in sequence.
-It is different from the earleme, because there may be
-gaps in the earleme sequence.
-There are never gaps in the sequence of ordinals.
-@d YS_Count_of_R(r) ((r)->t_earley_set_count)
-@d Ord_of_YS(set) ((set)->t_ordinal)
-@<Int aligned Earley set elements@> =
-    int t_ordinal;
-@ @d YS_Ord_is_Valid(r, ordinal)
-    ((ordinal) >= 0 && (ordinal) < YS_Count_of_R(r))
-@<Int aligned recognizer elements@> =
-int t_earley_set_count;
+@*0 Reference counting and destructors.
+@ @<Int aligned recognizer elements@>= int t_ref_count;
 @ @<Initialize recognizer elements@> =
-r->t_earley_set_count = 0;
-
-@*0 ID of Earley set.
-@d Earleme_of_YS(set) ((set)->t_key.t_earleme)
-
-@*0 Values of Earley set.
-To be used for the application to associate
-an integer and a pointer value
-of its choice with each Earley set.
-@d Value_of_YS(set) ((set)->t_value)
-@d PValue_of_YS(set) ((set)->t_pvalue)
-@<Int aligned Earley set elements@> =
-    int t_value;
-    void* t_pvalue;
-@ @<Initialize Earley set@> =
-   Value_of_YS(set) = -1;
-   PValue_of_YS(set) = NULL;
+r->t_ref_count = 1;
 
-@ @<Function definitions@> =
-int marpa_r_earley_set_value(Marpa_Recognizer r, Marpa_Earley_Set_ID set_id)
+@ Decrement the recognizer reference count.
+@<Function definitions@> =
+PRIVATE void
+recce_unref (RECCE r)
 {
-  @<Return |-2| on failure@>@;
-  YS earley_set;
-  @<Unpack recognizer objects@>@;
-  @<Fail if fatal error@>@;
-  @<Fail if recognizer not started@>@;
-  if (set_id < 0)
-    {
-      MARPA_ERROR (MARPA_ERR_INVALID_LOCATION);
-      return failure_indicator;
-    }
-  r_update_earley_sets (r);
-  if (!YS_Ord_is_Valid (r, set_id))
+  MARPA_ASSERT (r->t_ref_count > 0)
+  r->t_ref_count--;
+  if (r->t_ref_count <= 0)
     {
-      MARPA_ERROR(MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
-      return failure_indicator;
+      recce_free(r);
     }
-  earley_set = YS_of_R_by_Ord (r, set_id);
-  return Value_of_YS(earley_set);
 }
-
-@ @<Function definitions@> =
-int
-marpa_r_earley_set_values(Marpa_Recognizer r, Marpa_Earley_Set_ID set_id,
-  int* p_value, void** p_pvalue)
+void
+marpa_r_unref (Marpa_Recognizer r)
 {
-  @<Return |-2| on failure@>@;
-  YS earley_set;
-  @<Unpack recognizer objects@>@;
-  @<Fail if fatal error@>@;
-  @<Fail if recognizer not started@>@;
-  if (set_id < 0)
-    {
-      MARPA_ERROR (MARPA_ERR_INVALID_LOCATION);
-      return failure_indicator;
-    }
-  r_update_earley_sets (r);
-  if (!YS_Ord_is_Valid (r, set_id))
-    {
-      MARPA_ERROR(MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
-      return failure_indicator;
-    }
-  earley_set = YS_of_R_by_Ord (r, set_id);
-  if (p_value) *p_value = Value_of_YS(earley_set);
-  if (p_pvalue) *p_pvalue = PValue_of_YS(earley_set);
-  return 1;
+   recce_unref(r);
 }
 
-@ @<Function definitions@> =
-int marpa_r_latest_earley_set_value_set(Marpa_Recognizer r, int value)
+@ Increment the recognizer reference count.
+@<Function definitions@> =
+PRIVATE
+RECCE recce_ref (RECCE r)
 {
-  YS earley_set;
-  @<Return |-2| on failure@>@;
-  @<Unpack recognizer objects@>@;
-  @<Fail if fatal error@>@;
-  @<Fail if recognizer not started@>@;
-  earley_set = Latest_YS_of_R(r);
-  return Value_of_YS(earley_set) = value;
+  MARPA_ASSERT(r->t_ref_count > 0)
+  r->t_ref_count++;
+  return r;
 }
-
-@ @<Function definitions@> =
-int marpa_r_latest_earley_set_values_set(Marpa_Recognizer r, int value,
-  void* pvalue)
+Marpa_Recognizer
+marpa_r_ref (Marpa_Recognizer r)
 {
-  YS earley_set;
-  @<Return |-2| on failure@>@;
-  @<Unpack recognizer objects@>@;
-  @<Fail if fatal error@>@;
-  @<Fail if recognizer not started@>@;
-  earley_set = Latest_YS_of_R(r);
-  Value_of_YS(earley_set) = value;
-  PValue_of_YS(earley_set) = pvalue;
-  return 1;
+   return recce_ref(r);
 }
 
-@*0 Constructor.
-@<Function definitions@> =
-PRIVATE YS
-earley_set_new( RECCE r, JEARLEME id)
+@ @<Function definitions@> =
+PRIVATE
+void recce_free(struct marpa_r *r)
 {
-  YSK_Object key;
-  YS set;
-  set = marpa_obs_new (r->t_obs, YS_Object, 1);
-  key.t_earleme = id;
-  set->t_key = key;
-  set->t_postdot_ary = NULL;
-  set->t_postdot_sym_count = 0;
-  YIM_Count_of_YS(set) = 0;
-  set->t_ordinal = r->t_earley_set_count++;
-  YIMs_of_YS(set) = NULL;
-  Next_YS_of_YS(set) = NULL;
-  @<Initialize Earley set@>@/
-  return set;
+    @<Unpack recognizer objects@>@;
+    @<Destroy recognizer elements@>@;
+    @<Destroy Earley set segments@>@;
+    @<Destroy recognizer obstack@>@;
+    my_free( r);
 }
 
-@** Earley item (YIM) code.
-@ {\bf Optimization Principles:}
-\li Optimization should favor unambiguous grammars,
-but not heavily penalize ambiguous grammars.
-\li Optimization should favor mildly ambiguous grammars,
-but not heavily penalize very ambiguous grammars.
-\li Optimization should focus on saving space,
-perhaps even if at a slight cost in time.
-@ Space savings are important
-because in practical applications
-there can easily be many millions of
-Earley items and links.
-If there are 1M copies of a structure,
-each byte saved is a 1M saved.
-
-@ The solution arrived at is to optimize for Earley items
-with a single source, storing that source in the item
-itself.
-For Earley item with multiple sources, a special structure
-of linked lists is used.
-When a second source is added,
-the first source is copied into the lists,
-and its original space used for pointers to the linked
-lists.
-@ This solution is optimized both
-for the unambiguous case,
-and for adding the third and additional
-sources.
-The only awkwardness takes place
-when the second source is added, and the first one must
-be recopied to make way for pointers to the linked lists.
-@d LHS_NSYID_of_YIM(yim)
-  LHS_NSYID_of_AHM(AHM_of_YIM(yim))
-@ It might be slightly faster if this boolean is memoized in the Earley item
-when the Earley item is initialized.
-@d YIM_is_Completion(item)
-    (AHM_is_Completion(AHM_of_YIM(item)))
-@s Marpa_Earley_Item_ID int
-@<Public typedefs@> = typedef int Marpa_Earley_Item_ID;
-@ The ID of the Earley item is per-Earley-set, so that
-to uniquely specify the Earley item you must also specify
-the Earley set.
-@d YS_of_YIM(yim) ((yim)->t_key.t_set)
-@d YS_Ord_of_YIM(yim) (Ord_of_YS(YS_of_YIM(yim)))
-@d Ord_of_YIM(yim) ((yim)->t_ordinal)
-@d Earleme_of_YIM(yim) Earleme_of_YS(YS_of_YIM(yim))
-@d AHM_of_YIM(yim) ((yim)->t_key.t_ahm)
-@d AHMID_of_YIM(yim) ID_of_AHM(AHM_of_YIM(yim))
-@d Postdot_NSYID_of_YIM(yim) Postdot_NSYID_of_AHM(AHM_of_YIM(yim))
-@d IRL_of_YIM(yim) IRL_of_AHM(AHM_of_YIM(yim))
-@d IRLID_of_YIM(yim) ID_of_IRL(IRL_of_YIM(yim))
-@d Origin_Earleme_of_YIM(yim) (Earleme_of_YS(Origin_of_YIM(yim)))
-@d Origin_Ord_of_YIM(yim) (Ord_of_YS(Origin_of_YIM(yim)))
-@d Origin_of_YIM(yim) ((yim)->t_key.t_origin)
-@s YIM int
-@<Private incomplete structures@> =
-struct s_earley_item;
-typedef struct s_earley_item* YIM;
-typedef const struct s_earley_item* YIM_Const;
-struct s_earley_item_key;
-typedef struct s_earley_item_key* YIK;
-
-@ The layout matters a great deal, because there will be lots of them.
-I reduce the size of the YIM ordinal in order to save one word per
-YIM.
-I could widen it beyond the current count, but
-a limit of over 64,000 Earley items in a single Earley set
-should not be restrictive in practice.
-@d YIM_ORDINAL_WIDTH 16
-@d YIM_ORDINAL_CLAMP(x) (((1<<(YIM_ORDINAL_WIDTH))-1) & (x))
-@d YIM_FATAL_THRESHOLD ((1<<(YIM_ORDINAL_WIDTH))-2)
-@d YIM_is_Rejected(yim) ((yim)->t_is_rejected)
-@d YIM_is_Active(yim) ((yim)->t_is_active)
-@d YIM_was_Scanned(yim) ((yim)->t_was_scanned)
-@d YIM_was_Fusion(yim) ((yim)->t_was_fusion)
-@<Earley item structure@> =
-struct s_earley_item_key {
-     AHM t_ahm;
-     YS t_origin;
-     YS t_set;
-};
-typedef struct s_earley_item_key YIK_Object;
-struct s_earley_item {
-     YIK_Object t_key;
-     union u_source_container t_container;
-     BITFIELD t_ordinal:YIM_ORDINAL_WIDTH;
-    BITFIELD t_source_type:3;
-    BITFIELD t_is_rejected:1;
-    BITFIELD t_is_active:1;
-    BITFIELD t_was_scanned:1;
-    BITFIELD t_was_fusion:1;
-};
-typedef struct s_earley_item YIM_Object;
-
-@ Signed as opposed to the the way it is kept (unsigned, for portability,
-because it is a bitfield.  I may have to change this.
-@<Private typedefs@> =
-typedef int YIMID;
-
-@*0 Constructor.
-Find an Earley item object, creating it if it does not exist.
-Only in a few cases per parse (in Earley set 0),
-do we already
-know that the Earley item is unique in the set.
-These are not worth optimizing for.
-@<Function definitions@> =
-PRIVATE YIM earley_item_create(const RECCE r,
-    const YIK_Object key)
+@*0 Base objects.
+Initialized in |marpa_r_new|.
+@d G_of_R(r) ((r)->t_grammar)
+@<Widely aligned recognizer elements@> =
+    GRAMMAR t_grammar;
+@ @<Initialize recognizer elements@> =
 {
-  @<Return |NULL| on failure@>@;
-  @<Unpack recognizer objects@>@;
-  YIM new_item;
-  YIM* end_of_work_stack;
-  const YS set = key.t_set;
-  const int count = ++YIM_Count_of_YS(set);
-  @<Check count against Earley item thresholds@>@;
-  new_item = marpa_obs_new (r->t_obs, struct s_earley_item, 1);
-  new_item->t_key = key;
-  new_item->t_source_type = NO_SOURCE;
-  YIM_is_Rejected(new_item) = 0;
-  YIM_is_Active(new_item) = 1;
-  {
-    SRC unique_yim_src = SRC_of_YIM (new_item);
-    SRC_is_Rejected (unique_yim_src) = 0;
-    SRC_is_Active (unique_yim_src) = 1;
-  }
-  Ord_of_YIM(new_item) = YIM_ORDINAL_CLAMP((unsigned int)count - 1);
-  end_of_work_stack = WORK_YIM_PUSH(r);
-  *end_of_work_stack = new_item;
-  return new_item;
+  G_of_R(r) = g;
+  grammar_ref(g);
 }
+@ @<Unpack recognizer objects@> =
+const GRAMMAR g = G_of_R(r);
 
+@*0 The recognizer's error state.
+Each recognizer has its own error code,
+error string and ``OK'' flag,
+which are like those of the grammar.
+Errors in recognizer methods are recorded here,
+so that an error in one recognizer does not
+change the state of the other recognizers of its grammar.
+Until the grammar is frozen, the error is also recorded in
+the grammar, so that it is only once the grammar is frozen
+that |marpa_g_error| is not changed by the errors of its recognizers.
+@d IS_R_OK(r) ((r)->t_is_ok == I_AM_OK)
+@<Int aligned recognizer elements@> =
+int t_is_ok;
+Marpa_Error_Code t_error;
+@ @<Widely aligned recognizer elements@> =
+const char* t_error_string;
+@ @<Initialize recognizer elements@> =
+r->t_is_ok = I_AM_OK;
+r->t_error = MARPA_ERR_NONE;
+r->t_error_string = NULL;
 @ @<Function definitions@> =
-PRIVATE YIM
-earley_item_assign (const RECCE r, const YS set, const YS origin,
-                    const AHM ahm)
+Marpa_Error_Code marpa_r_error(Marpa_Recognizer r, const char** p_error_string)
 {
-  const GRAMMAR g = G_of_R (r);
-  YIK_Object key;
-  YIM yim;
-  PSL psl;
-  AHMID ahm_id = ID_of_AHM(ahm);
-  PSL *psl_owner = &Dot_PSL_of_YS (origin);
-  if (!*psl_owner)
-    {
-      psl_claim (psl_owner, Dot_PSAR_of_R(r));
-    }
-  psl = *psl_owner;
-  yim = PSL_Datum (psl, ahm_id);
-  if (yim
-      && Earleme_of_YIM (yim) == Earleme_of_YS (set)
-      && Earleme_of_YS (Origin_of_YIM (yim)) == Earleme_of_YS (origin))
-    {
-      return yim;
+    const Marpa_Error_Code error_code = r->t_error;
+    const char* error_string = r->t_error_string;
+    if (p_error_string) {
+       *p_error_string = error_string;
     }
-  key.t_origin = origin;
-  key.t_ahm = ahm;
-  key.t_set = set;
-  yim = earley_item_create (r, key);
-  PSL_Datum (psl, ahm_id) = yim;
-  return yim;
+    return error_code;
 }
+@ @<Destroy recognizer elements@> = grammar_unref(g);
 
-@ The fatal threshold always applies.
-The warning threshold does not count against items added by a Leo expansion.
-@<Check count against Earley item thresholds@> =
-if (count >= r->t_earley_item_warning_threshold)
-  {
-    if (_MARPA_UNLIKELY (count >= YIM_FATAL_THRESHOLD))
-      {                         /* Set the recognizer to a fatal error */
-        MARPA_FATAL (MARPA_ERR_YIM_COUNT);
-        return failure_indicator;
-      }
-      int_event_new (g, MARPA_EVENT_EARLEY_ITEM_THRESHOLD, count);
-  }
+@*0 Input phase.
+The recognizer always is
+in a one of the following
+phases:
+@d R_BEFORE_INPUT 0x1
+@d R_DURING_INPUT 0x2
+@d R_AFTER_INPUT 0x3
+@<Bit aligned recognizer elements@> =
+   BITFIELD t_input_phase:2;
+@ @d Input_Phase_of_R(r) ((r)->t_input_phase)
+@ @<Initialize recognizer elements@> =
+    Input_Phase_of_R(r) = R_BEFORE_INPUT;
 
-@*0 Destructor.
-No destructor.  All earley item elements are either owned by other objects.
-The Earley item itself is on the obstack.
+@*0 Earley set container.
+@d First_YS_of_R(r) ((r)->t_first_earley_set)
+@s JEARLEME int
+@<Widely aligned recognizer elements@> =
+YS t_first_earley_set;
+YS t_latest_earley_set;
+JEARLEME t_current_earleme;
+@ @<Initialize recognizer elements@> =
+r->t_first_earley_set = NULL;
+r->t_latest_earley_set = NULL;
+r->t_current_earleme = -1;
 
-@*0 Source of the Earley item.
-@d NO_SOURCE (0U)
-@d SOURCE_IS_TOKEN (1U)
-@d SOURCE_IS_COMPLETION (2U)
-@d SOURCE_IS_LEO (3U)
-@d SOURCE_IS_AMBIGUOUS (4U)
-@d Source_Type_of_YIM(item) ((item)->t_source_type)
-@d Earley_Item_has_No_Source(item) ((item)->t_source_type == NO_SOURCE)
-@d Earley_Item_has_Token_Source(item) ((item)->t_source_type == SOURCE_IS_TOKEN)
-@d Earley_Item_has_Complete_Source(item) ((item)->t_source_type == SOURCE_IS_COMPLETION)
-@d Earley_Item_has_Leo_Source(item) ((item)->t_source_type == SOURCE_IS_LEO)
-@d Earley_Item_is_Ambiguous(item) ((item)->t_source_type == SOURCE_IS_AMBIGUOUS)
+@*0 Current earleme.
+@d Latest_YS_of_R(r) ((r)->t_latest_earley_set)
+@d Current_Earleme_of_R(r) ((r)->t_current_earleme)
+@<Function definitions@> =
+Marpa_Earleme marpa_r_current_earleme(Marpa_Recognizer r)
+{
+  if (_MARPA_UNLIKELY(Input_Phase_of_R(r) == R_BEFORE_INPUT)) {
+      MARPA_R_ERROR(MARPA_ERR_RECCE_NOT_STARTED);
+      return -1;
+  }
+  return Current_Earleme_of_R(r);
+}
 
-@ Not inline, because not used in critical paths.
-This is for creating error messages.
+@ The ``Earley set at the current earleme'' is always
+the latest YS, if it is defined.
+There may not be a YS at the current earleme.
+@d YS_at_Current_Earleme_of_R(r) ys_at_current_earleme(r)
 @<Function definitions@> =
-PRIVATE_NOT_INLINE Marpa_Error_Code invalid_source_type_code(unsigned int type)
+PRIVATE YS ys_at_current_earleme(RECCE r)
 {
-     switch (type) {
-    case NO_SOURCE:
-        return MARPA_ERR_SOURCE_TYPE_IS_NONE;
-    case SOURCE_IS_TOKEN:
-        return MARPA_ERR_SOURCE_TYPE_IS_TOKEN;
-    case SOURCE_IS_COMPLETION:
-        return MARPA_ERR_SOURCE_TYPE_IS_COMPLETION;
-    case SOURCE_IS_LEO:
-        return MARPA_ERR_SOURCE_TYPE_IS_LEO;
-    case SOURCE_IS_AMBIGUOUS:
-        return MARPA_ERR_SOURCE_TYPE_IS_AMBIGUOUS;
-     }
-     return MARPA_ERR_SOURCE_TYPE_IS_UNKNOWN;
+    const YS latest = Latest_YS_of_R(r);
+    if (Earleme_of_YS(latest) == Current_Earleme_of_R(r)) return latest;
+    return NULL;
 }
 
-@** Earley index (YIX) code.
-Postdot items are of two kinds: Earley indexes
-and Leo items.
-The payload of an Earley index is simple:
-a pointer to an Earley item.
-The other elements of the YIX are overhead to
-support the chain of postdot items for
-a postdot symbol.
-@d Next_PIM_of_YIX(yix) ((yix)->t_next)
-@d YIM_of_YIX(yix) ((yix)->t_earley_item)
-@d Postdot_NSYID_of_YIX(yix) ((yix)->t_postdot_nsyid)
-@<Private incomplete structures@> =
-struct s_earley_ix;
-typedef struct s_earley_ix* YIX;
-union u_postdot_item;
-@ @<Private structures@> =
-struct s_earley_ix {
-     union u_postdot_item* t_next;
-     NSYID t_postdot_nsyid;
-     YIM t_earley_item; // Never NULL if this is an index item
-};
-typedef struct s_earley_ix YIX_Object;
+@*0 Earley set warning threshold.
+@d DEFAULT_YIM_WARNING_THRESHOLD (100)
+@<Int aligned recognizer elements@> = int t_earley_item_warning_threshold;
+@ @<Initialize recognizer elements@> =
+r->t_earley_item_warning_threshold =
+    MAX (DEFAULT_YIM_WARNING_THRESHOLD, AHM_Count_of_G (g) * 3);
+@ @<Function definitions@> =
+int
+marpa_r_earley_item_warning_threshold (Marpa_Recognizer r)
+{
+  return r->t_earley_item_warning_threshold;
+}
 
-@** Leo item (LIM) code.
-Leo items originate from the ``transition items" of Joop Leo's 1991 paper.
-They are set up so their first fields are identical to those of
-the Earley item indexes,
-so that they can be linked together in the same chain.
-Because the Earley index is at the beginning of each Leo item,
-LIMs can be treated as a kind of YIX.
-@d YIX_of_LIM(lim) ((YIX)(lim))
-@ Both Earley indexes and Leo items are
-postdot items, so that Leo items also require
-the fields to maintain the chain of postdot items.
-For this reason, Leo items contain an Earley index,
-but one
-with a |NULL| Earley item pointer.
-@d Postdot_NSYID_of_LIM(leo) (Postdot_NSYID_of_YIX(YIX_of_LIM(leo)))
-@d Next_PIM_of_LIM(leo) (Next_PIM_of_YIX(YIX_of_LIM(leo)))
-@d Origin_of_LIM(leo) ((leo)->t_origin)
-@d Top_AHM_of_LIM(leo) ((leo)->t_top_ahm)
-@d Trailhead_AHM_of_LIM(leo) ((leo)->t_trailhead_ahm)
-@d Predecessor_LIM_of_LIM(leo) ((leo)->t_predecessor)
-@d Trailhead_YIM_of_LIM(leo) ((leo)->t_base)
-@d YS_of_LIM(leo) ((leo)->t_set)
-@d Earleme_of_LIM(lim) Earleme_of_YS(YS_of_LIM(lim))
-@d LIM_is_Rejected(lim) ((lim)->t_is_rejected)
-@d LIM_is_Active(lim) ((lim)->t_is_active)
-@<Private incomplete structures@> =
-struct s_leo_item;
-typedef struct s_leo_item* LIM;
-@ @<Private structures@> =
-struct s_leo_item {
-     YIX_Object t_earley_ix;
-    @<Widely aligned LIM elements@>@;
-     YS t_origin;
-     AHM t_top_ahm;
-     AHM t_trailhead_ahm;
-     LIM t_predecessor;
-     YIM t_base;
-     YS t_set;
-     BITFIELD t_is_rejected:1;
-     BITFIELD t_is_active:1;
-};
-typedef struct s_leo_item LIM_Object;
+@ Returns true on success,
+false on failure.
+@<Function definitions@> =
+int
+marpa_r_earley_item_warning_threshold_set (Marpa_Recognizer r, int threshold)
+{
+  const int new_threshold = threshold <= 0 ? YIM_FATAL_THRESHOLD : threshold;
+  r->t_earley_item_warning_threshold = new_threshold;
+  return new_threshold;
+}
 
-@ @d CIL_of_LIM(lim) ((lim)->t_cil)
-@<Widely aligned LIM elements@> =
-    CIL t_cil;
+@*0 Furthest earleme.
+The ``furthest'' or highest-numbered earleme.
+This is the earleme of the last Earley set that contains anything.
+Marpa allows variable length tokens,
+so it needs to track how far out tokens might be found.
+No complete or predicted Earley item will be found after the current earleme.
+@d Furthest_Earleme_of_R(r) ((r)->t_furthest_earleme)
+@<Int aligned recognizer elements@> = JEARLEME t_furthest_earleme;
+@ @<Initialize recognizer elements@> = r->t_furthest_earleme = 0;
+@ @<Function definitions@> =
+unsigned int marpa_r_furthest_earleme(Marpa_Recognizer r)
+{ return (unsigned int)Furthest_Earleme_of_R(r); }
 
-@** Postdot item (PIM) code.
-Postdot items are entries in an index,
-by postdot symbol, of both the Earley items and the Leo items
-for each Earley set.
-@d LIM_of_PIM(pim) ((LIM)(pim))
-@d YIX_of_PIM(pim) ((YIX)(pim))
-@d Postdot_NSYID_of_PIM(pim) (Postdot_NSYID_of_YIX(YIX_of_PIM(pim)))
-@d YIM_of_PIM(pim) (YIM_of_YIX(YIX_of_PIM(pim)))
-@d Next_PIM_of_PIM(pim) (Next_PIM_of_YIX(YIX_of_PIM(pim)))
+@*0 Event variables.
+The count of unmasked XSY events.
+This count is used to protect recognizers that do not
+use events from their overhead.
+All these have to do is check the count against zero.
+There is no aggressive
+attempt to optimize on a more fine-grained
+basis --
+for recognizer which actually do use completion events,
+a few instructions per Earley item of overhead is
+considered reasonable.
+@ @<Widely aligned recognizer elements@> =
+Bit_Vector t_lbv_xsyid_completion_event_is_active;
+Bit_Vector t_lbv_xsyid_nulled_event_is_active;
+Bit_Vector t_lbv_xsyid_prediction_event_is_active;
+@ @<Int aligned recognizer elements@> =
+int t_active_event_count;
+@ @<Initialize recognizer event variables@> =
+    {
+      NSYID xsy_count = XSY_Count_of_G (g);
+      r->t_lbv_xsyid_completion_event_is_active =
+        lbv_clone (r->t_obs, g->t_lbv_xsyid_completion_event_starts_active, xsy_count);
+      r->t_lbv_xsyid_nulled_event_is_active =
+        lbv_clone (r->t_obs, g->t_lbv_xsyid_nulled_event_starts_active, xsy_count);
+      r->t_lbv_xsyid_prediction_event_is_active =
+        lbv_clone (r->t_obs, g->t_lbv_xsyid_prediction_event_starts_active, xsy_count);
+      r->t_active_event_count =
+        bv_count ( g->t_lbv_xsyid_is_completion_event)
+        + bv_count ( g->t_lbv_xsyid_is_nulled_event)
+        + bv_count ( g->t_lbv_xsyid_is_prediction_event) ;
+    }
 
-@ |PIM_of_LIM| assumes that PIM is in fact a LIM.
-|PIM_is_LIM| is available to check this.
-@d PIM_of_LIM(pim) ((PIM)(pim))
-@d PIM_is_LIM(pim) (YIM_of_YIX(YIX_of_PIM(pim)) == NULL)
-@s PIM int
-@<Private structures@> =
-union u_postdot_item {
-    LIM_Object t_leo;
-    YIX_Object t_earley;
-};
-typedef union u_postdot_item PIM_Object;
-typedef union u_postdot_item* PIM;
+@*0 The recognizer event queue.
+Events generated by the recognizer are kept in the recognizer,
+not in the grammar.
+The grammar's event stack is written only
+by the grammar methods, all of which run before
+or during precomputation.
+After precomputation, therefore,
+no recognizer writes its events to the grammar,
+and any number of recognizers
+can share the same grammar without contending
+for its event stack.
+@ The recognizer event queue uses the same
+event objects as the grammar event stack.
+Like the grammar event stack, its memory is that of the
+high water mark.
+@d R_EVENT_COUNT(r) MARPA_DSTACK_LENGTH ((r)->t_events)
+@<Widely aligned recognizer elements@> =
+MARPA_DSTACK_DECLARE(t_events);
+@
+@d INITIAL_R_EVENTS_CAPACITY (1024/sizeof(int))
+@<Initialize recognizer elements@> =
+MARPA_DSTACK_INIT(r->t_events, GEV_Object, INITIAL_R_EVENTS_CAPACITY);
+@ @<Destroy recognizer elements@> = MARPA_DSTACK_DESTROY(r->t_events);
 
-@ This function searches for the
-first postdot item for an Earley set
-and a symbol ID.
-If successful, it
-returns that postdot item.
-If it fails, it returns |NULL|.
-@<Function definitions@> =
-PRIVATE PIM*
-pim_nsy_p_find (YS set, NSYID nsyid)
+@ As with the grammar events,
+callers must be careful.
+A pointer to the new event is returned,
+but it must be written to before another event
+is added.
+@d R_EVENTS_CLEAR(r) MARPA_DSTACK_CLEAR((r)->t_events)
+@d R_EVENT_PUSH(r) MARPA_DSTACK_PUSH((r)->t_events, GEV_Object)
+@ @<Function definitions@> =
+PRIVATE
+void r_event_new(RECCE r, int type)
 {
-  int lo = 0;
-  int hi = Postdot_SYM_Count_of_YS(set) - 1;
-  PIM* postdot_array = set->t_postdot_ary;
-  while (hi >= lo) { // A binary search
-       int trial = lo+(hi-lo)/2; // guards against overflow
-       PIM trial_pim = postdot_array[trial];
-       NSYID trial_nsyid = Postdot_NSYID_of_PIM(trial_pim);
-       if (trial_nsyid == nsyid) return postdot_array+trial;
-       if (trial_nsyid < nsyid) {
-           lo = trial+1;
-       } else {
-           hi = trial-1;
-       }
+    @t}\comment{@>
+  /* may change base of dstack */
+  GEV end_of_stack = R_EVENT_PUSH(r);
+  end_of_stack->t_type = type;
+  end_of_stack->t_value = 0;
+}
+@ @<Function definitions@> =
+PRIVATE
+void r_int_event_new(RECCE r, int type, int value)
+{
+    @t}\comment{@>
+  /* may change base of dstack */
+  GEV end_of_stack = R_EVENT_PUSH(r);
+  end_of_stack->t_type = type;
+  end_of_stack->t_value =  value;
+}
+
+@ @<Function definitions@> =
+Marpa_Event_Type
+marpa_r_event (Marpa_Recognizer r, Marpa_Event* public_event,
+               int ix)
+{
+  @<Return |-2| on failure@>@;
+  MARPA_DSTACK events = &r->t_events;
+  GEV internal_event;
+  int type;
+
+  if (ix < 0) {
+    MARPA_R_ERROR(MARPA_ERR_EVENT_IX_NEGATIVE);
+    return failure_indicator;
   }
-  return NULL;
+  if (ix >= MARPA_DSTACK_LENGTH (*events)) {
+    MARPA_R_ERROR(MARPA_ERR_EVENT_IX_OOB);
+    return failure_indicator;
+  }
+  internal_event = MARPA_DSTACK_INDEX (*events, GEV_Object, ix);
+  type = internal_event->t_type;
+  public_event->t_type = type;
+  public_event->t_value = internal_event->t_value;
+  return type;
 }
+
 @ @<Function definitions@> =
-PRIVATE PIM first_pim_of_ys_by_nsyid(YS set, NSYID nsyid)
+int
+marpa_r_event_count (Marpa_Recognizer r)
 {
-   PIM* pim_nsy_p = pim_nsy_p_find(set, nsyid);
-   return pim_nsy_p ? *pim_nsy_p : NULL;
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  @<Fail if recognizer has a fatal error@>@;
+  return R_EVENT_COUNT(r);
 }
 
-@** Source objects.
-Nothing internally distinguishes the various source objects
-by type.
-It is assumed that their type will be known from
-the context in which they are used.
-@*0 The relationship between Leo items and ambiguity.
-The relationship between Leo items and ambiguous sources bears
-some explaining.
-Leo sources must be unique, but only when their predecessor's
-Earley set is considered.
-That is, for every pairing of Earley item and Earley set,
-there is only one Leo source in that Earley item
-with a predecessor in that Earley set.
-But there may be other sources (both Leo and non-Leo),
-a long as their predecessors
-are in different Earley sets.
-@ One way to look at these Leo ambiguities is as different
-``factorings" of the Earley item.
-Call the last (or transition) symbol of an Earley item
-its ``cause".
-An Earley item will often have both a predecessor and a cause,
-and these can ``factor", or divide up, the distance between
-an Earley item's origin and its current set in different ways.
-@ The Earley item can have only one origin,
-and only one transition symbol.
-But that transition symbol does not have to start at the origin
-and can start anywhere between the origin and the current
-set of the Earley item.
-For example, for an Earley item at earleme 14, with its origin at 10,
-there may be no predecessor,
-in which case the ``cause" starts at 10.
-Or there may be a predecessor, in which case
-the ``cause" may start at earlemes 11, 12 or 13.
-This different divisions between the (possibly null) predecessor
-and the ``cause" are ``factorings" of the Earley item.
-@ Each factoring may have its own Leo source.
-At those earlemes without a Leo source, there may be any number
-of non-Leo sources.
-@*0 Optimization.
-There will be a lot of these structures in a long
-parse, so space optimization gets an unusual amount of
-attention in the source links.
-@d Next_SRCL_of_SRCL(link) ((link)->t_next)
-@ @<Private typedefs@> =
-struct s_source;
-typedef struct s_source* SRC;
-typedef const struct s_source* SRC_Const;
-@ @<Source object structure@>=
-struct s_token_source {
-    NSYID t_nsyid;
+@*0 Expected symbol boolean vector.
+A boolean vector by symbol ID,
+with the bits set if the symbol is expected
+at the current earleme.
+@<Widely aligned recognizer elements@> = Bit_Vector t_bv_nsyid_is_expected;
+@ @<Initialize recognizer elements@> =
+    r->t_bv_nsyid_is_expected = bv_obs_create( r->t_obs, nsy_count );
+@ Returns |-2| if there was a failure.
+The buffer is expected to be large enough to hold
+the result.
+This will be the case if the length of the buffer
+is greater than or equal to the number of symbols
+in the grammar.
+@<Function definitions@> =
+int marpa_r_terminals_expected(Marpa_Recognizer r, Marpa_Symbol_ID* buffer)
+{
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  NSYID xsy_count;
+  Bit_Vector bv_terminals;
+  int min, max, start;
+  int next_buffer_ix = 0;
+
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail if recognizer not started@>@;
+
+  xsy_count = XSY_Count_of_G (g);
+  bv_terminals = bv_create (xsy_count);
+  for (start = 0; bv_scan (r->t_bv_nsyid_is_expected, start, &min, &max);
+       start = max + 2)
+    {
+      NSYID nsyid;
+      for (nsyid = min; nsyid <= max; nsyid++)
+	{
+	  const XSY xsy = Source_XSY_of_NSYID (nsyid);
+	  bv_bit_set (bv_terminals, ID_of_XSY (xsy));
+	}
+    }
+
+  for (start = 0; bv_scan (bv_terminals, start, &min, &max); start = max + 2)
+    {
+      XSYID xsyid;
+      for (xsyid = min; xsyid <= max; xsyid++)
+	{
+	  buffer[next_buffer_ix++] = xsyid;
+	}
+    }
+  bv_free (bv_terminals);
+  return next_buffer_ix;
+}
+
+@ @<Function definitions@> =
+int marpa_r_terminal_is_expected(Marpa_Recognizer r,
+Marpa_Symbol_ID xsy_id)
+{
+    @<Return |-2| on failure@>@;
+   @<Unpack recognizer objects@>@;
+   XSY xsy;
+   NSY nsy;
+    @<Fail if recognizer has a fatal error@>@;
+    @<Fail if recognizer not started@>@;
+    @<Fail recognizer if |xsy_id| is malformed@>@;
+    @<Fail recognizer if |xsy_id| does not exist@>@;
+    xsy = XSY_by_ID(xsy_id);
+    if (_MARPA_UNLIKELY(!XSY_is_Terminal(xsy))) {
+        return 0;
+    }
+    nsy = NSY_of_XSY(xsy);
+    if (_MARPA_UNLIKELY(!nsy)) return 0; /* It may be an unused terminal */
+    return bv_bit_test (r->t_bv_nsyid_is_expected, ID_of_NSY(nsy));
+}
+
+@*0 Expected symbol is event?.
+A boolean vector by symbol ID,
+with the bits set if, when
+that symbol is an expected symbol,
+an event should be created.
+Here ``expected'' means ``expected as a terminal''.
+All expected symbols are predicted symbols,
+but the reverse is not true --
+predicted non-terminals are not ``expected'' symbols.
+@<Widely aligned recognizer elements@> = LBV t_nsy_expected_is_event;
+@ @<Initialize recognizer elements@> =
+  r->t_nsy_expected_is_event = lbv_obs_new0(r->t_obs, nsy_count);
+@ Returns |-2| if there was a failure.
+@<Function definitions@> =
+int
+marpa_r_expected_symbol_event_set (Marpa_Recognizer r, Marpa_Symbol_ID xsy_id,
+                                   int value)
+{
+    XSY xsy;
+    NSY nsy;
+    NSYID nsyid;
+    @<Return |-2| on failure@>@;
+    @<Unpack recognizer objects@>@;
+    @<Fail if recognizer has a fatal error@>@;
+    @<Fail recognizer if |xsy_id| is malformed@>@;
+    @<Soft fail recognizer if |xsy_id| does not exist@>@;
+    if (_MARPA_UNLIKELY (value < 0 || value > 1))
+      {
+        MARPA_R_ERROR (MARPA_ERR_INVALID_BOOLEAN);
+        return failure_indicator;
+      }
+    xsy = XSY_by_ID(xsy_id);
+    if (_MARPA_UNLIKELY(XSY_is_Nulling(xsy))) {
+      MARPA_R_ERROR (MARPA_ERR_SYMBOL_IS_NULLING);
+      return -2;
+    }
+    nsy = NSY_of_XSY(xsy);
+    if (_MARPA_UNLIKELY(!nsy)) {
+      MARPA_R_ERROR (MARPA_ERR_SYMBOL_IS_UNUSED);
+      return -2;
+    }
+    nsyid = ID_of_NSY(nsy);
+    if (value) {
+      lbv_bit_set(r->t_nsy_expected_is_event, nsyid);
+    } else {
+      lbv_bit_clear(r->t_nsy_expected_is_event, nsyid);
+    }
+    return value;
+}
+
+@*0 Deactivate symbol completed events.
+@ Allows a recognizer to deactivate and
+reactivate symbol completed events.
+A |boolean| value of 1 indicates reactivate,
+a boolean value of 0 indicates deactivate.
+To be reactivated, the symbol must have been
+set up for completion events in the grammar.
+Success occurs non-trivially
+if the bit can be set to the new value.
+Success occurs
+trivially if it was already set as specified.
+Any other result is a failure.
+On success, returns the new value.
+Returns |-2| if there was a failure.
+@<Function definitions@> =
+int
+marpa_r_completion_symbol_activate (Marpa_Recognizer r,
+                                    Marpa_Symbol_ID xsy_id, int reactivate)
+{
+    @<Return |-2| on failure@>@;
+    @<Unpack recognizer objects@>@;
+    @<Fail if recognizer has a fatal error@>@;
+    @<Fail recognizer if |xsy_id| is malformed@>@;
+    @<Soft fail recognizer if |xsy_id| does not exist@>@;
+    switch (reactivate) {
+    case 0:
+        if (lbv_bit_test(r->t_lbv_xsyid_completion_event_is_active, xsy_id)) {
+          lbv_bit_clear(r->t_lbv_xsyid_completion_event_is_active, xsy_id) ;
+          r->t_active_event_count--;
+        }
+        return 0;
+    case 1:
+        if (!lbv_bit_test(g->t_lbv_xsyid_is_completion_event, xsy_id)) {
+          /* An attempt to activate a completion event on a symbol which
+          was not set up for them. */
+          MARPA_R_ERROR (MARPA_ERR_SYMBOL_IS_NOT_COMPLETION_EVENT);
+        }
+        if (!lbv_bit_test(r->t_lbv_xsyid_completion_event_is_active, xsy_id)) {
+          lbv_bit_set(r->t_lbv_xsyid_completion_event_is_active, xsy_id) ;
+          r->t_active_event_count++;
+        }
+        return 1;
+    }
+    MARPA_R_ERROR (MARPA_ERR_INVALID_BOOLEAN);
+    return failure_indicator;
+}
+
+@*0 Deactivate and reactivate symbol nulled events.
+@ Allows a recognizer to deactivate and
+reactivate symbol nulled events.
+A |boolean| value of 1 indicates reactivate,
+a boolean value of 0 indicates deactivate.
+To be reactivated, the symbol must have been
+set up for nulled events in the grammar.
+Success occurs non-trivially
+if the bit can be set to the new value.
+Success occurs
+trivially if it was already set as specified.
+Any other result is a failure.
+On success, returns the new value.
+Returns |-2| if there was a failure.
+@<Function definitions@> =
+int
+marpa_r_nulled_symbol_activate (Marpa_Recognizer r, Marpa_Symbol_ID xsy_id,
+                                int reactivate)
+{
+    @<Return |-2| on failure@>@;
+    @<Unpack recognizer objects@>@;
+    @<Fail if recognizer has a fatal error@>@;
+    @<Fail recognizer if |xsy_id| is malformed@>@;
+    @<Soft fail recognizer if |xsy_id| does not exist@>@;
+    switch (reactivate) {
+    case 0:
+        if (lbv_bit_test(r->t_lbv_xsyid_nulled_event_is_active, xsy_id)) {
+          lbv_bit_clear(r->t_lbv_xsyid_nulled_event_is_active, xsy_id) ;
+          r->t_active_event_count--;
+        }
+        return 0;
+    case 1:
+        if (!lbv_bit_test(g->t_lbv_xsyid_is_nulled_event, xsy_id)) {
+          /* An attempt to activate a nulled event on a symbol which
+          was not set up for them. */
+          MARPA_R_ERROR (MARPA_ERR_SYMBOL_IS_NOT_NULLED_EVENT);
+        }
+        if (!lbv_bit_test(r->t_lbv_xsyid_nulled_event_is_active, xsy_id)) {
+          lbv_bit_set(r->t_lbv_xsyid_nulled_event_is_active, xsy_id) ;
+          r->t_active_event_count++;
+        }
+        return 1;
+    }
+    MARPA_R_ERROR (MARPA_ERR_INVALID_BOOLEAN);
+    return failure_indicator;
+}
+
+@*0 Deactivate and reactivate symbol prediction events.
+@ Allows a recognizer to deactivate and
+reactivate symbol prediction events.
+A |boolean| value of 1 indicates reactivate,
+a boolean value of 0 indicates deactivate.
+To be reactivated, the symbol must have been
+set up for prediction events in the grammar.
+Success occurs non-trivially
+if the bit can be set to the new value.
+Success occurs
+trivially if it was already set as specified.
+Any other result is a failure.
+On success, returns the new value.
+Returns |-2| if there was a failure.
+@<Function definitions@> =
+int
+marpa_r_prediction_symbol_activate (Marpa_Recognizer r,
+                                    Marpa_Symbol_ID xsy_id, int reactivate)
+{
+    @<Return |-2| on failure@>@;
+    @<Unpack recognizer objects@>@;
+    @<Fail if recognizer has a fatal error@>@;
+    @<Fail recognizer if |xsy_id| is malformed@>@;
+    @<Soft fail recognizer if |xsy_id| does not exist@>@;
+    switch (reactivate) {
+    case 0:
+        if (lbv_bit_test(r->t_lbv_xsyid_prediction_event_is_active, xsy_id)) {
+          lbv_bit_clear(r->t_lbv_xsyid_prediction_event_is_active, xsy_id) ;
+          r->t_active_event_count--;
+        }
+        return 0;
+    case 1:
+        if (!lbv_bit_test(g->t_lbv_xsyid_is_prediction_event, xsy_id)) {
+          /* An attempt to activate a prediction event on a symbol which
+          was not set up for them. */
+          MARPA_R_ERROR (MARPA_ERR_SYMBOL_IS_NOT_PREDICTION_EVENT);
+        }
+        if (!lbv_bit_test(r->t_lbv_xsyid_prediction_event_is_active, xsy_id)) {
+          lbv_bit_set(r->t_lbv_xsyid_prediction_event_is_active, xsy_id) ;
+          r->t_active_event_count++;
+        }
+        return 1;
+    }
+    MARPA_R_ERROR (MARPA_ERR_INVALID_BOOLEAN);
+    return failure_indicator;
+}
+
+@*0 Leo-related booleans.
+@*1 Turning Leo logic off and on.
+A trace flag, set if we are using Leo items.
+This flag is set by default.
+It has two uses.
+@ This flag is very useful for testing.
+Since Leo items do not affect function, only effiency,
+it is possible for the Leo logic to be broken or
+disabled without most tests noticiing.
+To make sure the Leo logic is intact,
+one of |libmarpa|'s tests runs one pass
+with Leo items off and another with Leo items on
+and compares them.
+@ This flag also allows the Leo logic
+to be turned off in certain cases in which the Leo logic
+actually slows things down.
+The Leo logic could be turned off if the user knows there is
+no right recursion, although the actual gain,
+would typically be small or not measurable.
+@ A real gain would occur in the case of highly ambiguous
+grammars, all or most of whose parses are actually evaluated.
+Since those Earley items eliminated by the Leo logic
+are actually recreated on an as-needed basis in the evaluation
+phase, in cases when most of the Earley items are needed
+for evaluation, the Leo logic would be eliminated Earley
+items only to have to add most of them later.
+In these cases,
+the Leo logic would impose a small overhead.
+@ The author's current view is that it is best
+to start by assuming that the Leo logic should
+be left on.
+In the rare event, that it turns out that the Leo
+logic is counter-productive,
+this flag can be used to test if turning the Leo
+logic off is helpful.
+@ It should be borne in mind that even when the Leo logic
+imposes a small cost in typical cases,
+it may act as a safeguard.
+The time complexity explosions prevented by Leo logic can
+easily mean the difference between an impractical computation
+and a practical one.
+In most applications, it is worth incurring an small
+overhead in the average case to prevent failures,
+even rare ones.
+@ There are two booleans.
+One is a flag that can be set and
+unset externally,
+indicating the application's intention to use Leo logic.
+An internal boolean tracks whether the Leo logic is
+actually enabled at any given point.
+@ The reason for having two booleans
+is that the Leo logic is only turned
+on once Earley set 0 is complete.
+While Earley set 0 is being processed the internal flag will always
+be unset, while the external flag may be set or unset, as the user
+decided.
+After Earley set 0 is complete, both booleans will have the same value.
+@ {\bf To Do}: @^To Do@>
+Now that the null parse is special-cased, one boolean may suffice.
+@<Bit aligned recognizer elements@> =
+BITFIELD t_use_leo_flag:1;
+BITFIELD t_is_using_leo:1;
+@ @<Initialize recognizer elements@> =
+r->t_use_leo_flag = 1;
+r->t_is_using_leo = 0;
+@ Returns 1 if the ``use Leo" flag is set,
+0 if not,
+and |-2| if there was an error.
+@<Function definitions@> =
+int _marpa_r_is_use_leo(Marpa_Recognizer  r)
+{
+   @<Unpack recognizer objects@>@;
+   @<Return |-2| on failure@>@;
+    @<Fail if recognizer has a fatal error@>@;
+    return r->t_use_leo_flag;
+}
+@ @<Function definitions@> =
+int _marpa_r_is_use_leo_set(
+Marpa_Recognizer r, int value)
+{
+   @<Unpack recognizer objects@>@;
+   @<Return |-2| on failure@>@/
+    @<Fail if recognizer has a fatal error@>@;
+    @<Fail if recognizer started@>@;
+    return r->t_use_leo_flag = value ? 1 : 0;
+}
+
+@*0 Predicted IRL boolean vector and stack.
+A boolean vector by IRL ID,
+used while building the Earley sets.
+It is set if an IRL has already been predicted,
+unset otherwise.
+@<Widely aligned recognizer elements@> =
+  Bit_Vector t_bv_irl_seen;
+  MARPA_DSTACK_DECLARE(t_irl_cil_stack);
+@ @<Initialize recognizer elements@> =
+  r->t_bv_irl_seen = bv_obs_create( r->t_obs, irl_count );
+  MARPA_DSTACK_INIT2(r->t_irl_cil_stack, CIL);
+@ @<Destroy recognizer elements@> =
+  MARPA_DSTACK_DESTROY(r->t_irl_cil_stack);
+
+@*1 Is the parser exhausted?.
+A parser is ``exhausted" if it cannot accept any more input.
+Both successful and failed parses can be ``exhausted".
+In many grammars,
+the parse is always exhausted as soon as it succeeds.
+And even if the parse is exhausted at a point
+where there is no good parse,
+there may be good parses at earlemes prior to the
+earleme at which the parse became exhausted.
+@d R_is_Exhausted(r) ((r)->t_is_exhausted)
+@<Bit aligned recognizer elements@> = BITFIELD t_is_exhausted:1;
+@ @<Initialize recognizer elements@> = r->t_is_exhausted = 0;
+@ @<Set |r| exhausted@> =
+{
+  R_is_Exhausted (r) = 1;
+  Input_Phase_of_R (r) = R_AFTER_INPUT;
+  r_event_new (r, MARPA_EVENT_EXHAUSTED);
+}
+
+@ Exhaustion is a boolean, not a phase.
+Once exhausted a parse stays exhausted,
+even though the phase may change.
+@<Function definitions@> =
+int marpa_r_is_exhausted(Marpa_Recognizer r)
+{
+   @<Unpack recognizer objects@>@;
+   @<Return |-2| on failure@>@/
+    @<Fail if recognizer has a fatal error@>@;
+    return R_is_Exhausted(r);
+}
+
+@*1 Is the parser consistent?
+A parser becomes inconsistent when
+YIM's or LIM's or ALT's are rejected.
+It can be made consistent again by calling
+|marpa_r_consistent()|.
+@d First_Inconsistent_YS_of_R(r) ((r)->t_first_inconsistent_ys)
+@d R_is_Consistent(r) ((r)->t_first_inconsistent_ys < 0)
+@<Int aligned recognizer elements@> = YSID t_first_inconsistent_ys;
+@ @<Initialize recognizer elements@> = r->t_first_inconsistent_ys = -1;
+
+@*0 The recognizer obstack.
+Create an obstack with the lifetime of the recognizer.
+This is a very efficient way of allocating memory which won't be
+resized and which will have the same lifetime as the recognizer.
+@<Widely aligned recognizer elements@> = struct marpa_obstack *t_obs;
+@ @<Initialize recognizer obstack@> = r->t_obs = marpa_obs_init;
+@ @<Destroy recognizer obstack@> = marpa_obs_free(r->t_obs);
+
+@*0 The Earley set segments.
+The Earley sets,
+and the Earley items, source links and postdot items
+that belong to them,
+are not kept on the recognizer obstack,
+but on an obstack of their own, |t_ys_obs|.
+That obstack is replaced by a new one whenever Earley sets are
+released, so that each obstack,
+or {\bf segment}, holds the data of a run of consecutive Earley sets.
+A segment is freed once all of its Earley sets have been released.
+@ Earley set 0 is never released.
+A new segment is opened as soon as Earley set 0 is complete,
+so that the first segment holds Earley set 0 alone.
+The exception is a recognizer restored from a checkpoint,
+whose first segment holds all of the restored Earley sets.
+@d YS_Segment_Count_of_R(r) MARPA_DSTACK_LENGTH((r)->t_ys_segment_stack)
+@d YS_Segment_of_R_by_Ix(r, ix)
+  MARPA_DSTACK_INDEX((r)->t_ys_segment_stack, YS_SEGMENT_Object, (ix))
+@<Private structures@> =
+struct s_ys_segment {
+    struct marpa_obstack *t_obs;
+    YSID t_first_ysid;
+};
+typedef struct s_ys_segment YS_SEGMENT_Object;
+@ @<Widely aligned recognizer elements@> =
+struct marpa_obstack *t_ys_obs;
+MARPA_DSTACK_DECLARE(t_ys_segment_stack);
+@ @<Initialize recognizer elements@> =
+r->t_ys_obs = NULL;
+MARPA_DSTACK_INIT (r->t_ys_segment_stack, YS_SEGMENT_Object, 4);
+@ The segments are destroyed after the other recognizer elements,
+some of which point into the Earley sets.
+@<Destroy Earley set segments@> =
+{
+  int segment_ix;
+  for (segment_ix = 0; segment_ix < YS_Segment_Count_of_R (r); segment_ix++)
+    {
+      marpa_obs_free (YS_Segment_of_R_by_Ix (r, segment_ix)->t_obs);
+    }
+  MARPA_DSTACK_DESTROY (r->t_ys_segment_stack);
+}
+
+@ Open a new segment, for the Earley sets from the next one on.
+Its memory is charged to the recognizer's memory budget.
+@<Function definitions@> =
+PRIVATE void
+ys_segment_open (RECCE r)
+{
+  YS_SEGMENT_Object *const segment =
+    MARPA_DSTACK_PUSH (r->t_ys_segment_stack, YS_SEGMENT_Object);
+  segment->t_obs = r->t_ys_obs = marpa_obs_init;
+  segment->t_first_ysid = YS_Count_of_R (r);
+  marpa_obs_budget_attach (r->t_ys_obs, &r->t_memory_budget);
+}
+
+@ The total size of the segments, for the recognizer statistics.
+@<Function definitions@> =
+PRIVATE size_t
+ys_segments_total_size (RECCE r)
+{
+  int segment_ix;
+  size_t total = 0;
+  for (segment_ix = 0; segment_ix < YS_Segment_Count_of_R (r); segment_ix++)
+    {
+      total += marpa_obs_total_size (YS_Segment_of_R_by_Ix (r, segment_ix)->t_obs);
+    }
+  return total;
+}
+
+@ Each Earley set marks the point in its segment at which
+its data begins.
+Releasing the segment to that mark discards the Earley set,
+and all later Earley sets in the segment,
+while keeping the memory for reuse.
+The data of the Earley sets restored from a checkpoint is
+not allocated in Earley set order,
+so those Earley sets have no mark.
+@d Obs_Mark_of_YS(set) ((set)->t_obs_mark)
+@d YS_has_Obs_Mark(set) (Obs_Mark_of_YS(set).chunk != NULL)
+@<Widely aligned Earley set elements@> =
+struct marpa_obstack_mark t_obs_mark;
+
+@*0 The recognizer constant integer list arena.
+The recognizer keeps its own CILAR,
+for the integer lists that it creates while parsing.
+The grammar's CILAR is not written after precomputation,
+which allows recognizers to share a frozen grammar
+across threads.
+The CILs in the recognizer's CILAR have the lifetime
+of the recognizer.
+@<Widely aligned recognizer elements@> =
+CILAR_Object t_cilar;
+@ @<Initialize recognizer elements@> =
+cilar_init(&(r)->t_cilar);
+@ @<Destroy recognizer elements@> =
+cilar_destroy(&(r)->t_cilar);
+
+@*1 The ZWA Array.
+@d ID_of_ZWA(zwa) ((zwa)->t_id)
+@d Memo_YSID_of_ZWA(zwa) ((zwa)->t_memoized_ysid)
+@d Memo_Value_of_ZWA(zwa) ((zwa)->t_memoized_value)
+@d Default_Value_of_ZWA(zwa) ((zwa)->t_default_value)
+@<Private structures@> =
+struct s_r_zwa {
+    ZWAID t_id;
+    YSID t_memoized_ysid;
+    BITFIELD t_default_value:1;
+    BITFIELD t_memoized_value:1;
+};
+typedef struct s_r_zwa ZWA_Object;
+
+@ The grammar and recce ZWA counts are always the same.
+@d ZWA_Count_of_R(r) (ZWA_Count_of_G(G_of_R(r)))
+@d RZWA_by_ID(id) (&(r)->t_zwas[(zwaid)])
+@<Widely aligned recognizer elements@> =
+    ZWA t_zwas;
+@ @<Initialize recognizer elements@> =
+{
+    ZWAID zwaid;
+    const int zwa_count = ZWA_Count_of_R(r);
+    (r)->t_zwas = marpa_obs_new(r->t_obs, ZWA_Object, ZWA_Count_of_R(r));
+    for (zwaid = 0; zwaid < zwa_count; zwaid++) {
+        const GZWA gzwa = GZWA_by_ID(zwaid);
+        const ZWA zwa = RZWA_by_ID(zwaid);
+        ID_of_ZWA(zwa) = ID_of_GZWA(gzwa);
+        Default_Value_of_ZWA(zwa) = Default_Value_of_GZWA(gzwa);
+        Memo_Value_of_ZWA(zwa) = Default_Value_of_GZWA(gzwa);
+        Memo_YSID_of_ZWA(zwa) = -1;
+    }
+}
+
+@** Earlemes.
+In most parsers, the input is modeled as a token stream ---
+a sequence of tokens.
+In this model the idea of location is not complex.
+The first token is at location 0, the second at location 1,
+etc.
+@ Marpa allows ambiguous and variable length tokens, and requires
+a more flexible idea of location, with a unit of length.
+The unit of token length in Marpa is called an Earleme.
+The locations themselves are often called earlemes.
+@ |JEARLEME_THRESHOLD| is less than |INT_MAX| so that
+I can prevent overflow without getting fancy -- overflow
+by addition is impossible as long as earlemes are below
+the threshold.
+@ I considered defining earlemes as |long| or
+explicitly as 64-bit integers.
+But machines with 32-bit int's
+will in a not very long time
+become museum pieces.
+And in the meantime this
+definition of |JEARLEME_THRESHOLD| probably allows as large as
+parse as the memories on those machines will be
+able to handle.
+@d JEARLEME_THRESHOLD (INT_MAX/4)
+@<Public typedefs@> = typedef int Marpa_Earleme;
+@ @<Private typedefs@> = typedef Marpa_Earleme JEARLEME;
+
+@** Earley set (YS) code.
+@<Public typedefs@> = typedef int Marpa_Earley_Set_ID;
+@ @<Private typedefs@> = typedef Marpa_Earley_Set_ID YSID;
+@ @d Next_YS_of_YS(set) ((set)->t_next_earley_set)
+@d Postdot_SYM_Count_of_YS(set) ((set)->t_postdot_sym_count)
+@d First_PIM_of_YS_by_NSYID(set, nsyid) (first_pim_of_ys_by_nsyid((set), (nsyid)))
+@d PIM_NSY_P_of_YS_by_NSYID(set, nsyid) (pim_nsy_p_find((set), (nsyid)))
+@s YS int
+@<Private incomplete structures@> =
+struct s_earley_set;
+typedef struct s_earley_set *YS;
+typedef const struct s_earley_set *YS_Const;
+struct s_earley_set_key;
+typedef struct s_earley_set_key *YSK;
+@ @<Private structures@> =
+struct s_earley_set_key {
+    JEARLEME t_earleme;
+};
+typedef struct s_earley_set_key YSK_Object;
+@ @<Private structures@> =
+struct s_earley_set {
+    YSK_Object t_key;
+    union u_postdot_item** t_postdot_ary;
+    LBW* t_postdot_index;
+    YS t_next_earley_set;
+    @<Widely aligned Earley set elements@>@;
+    int t_postdot_sym_count;
+    @<Int aligned Earley set elements@>@;
+};
+typedef struct s_earley_set YS_Object;
+
+@*0 Earley item container.
+@d YIM_Count_of_YS(set) ((set)->t_yim_count)
+@<Int aligned Earley set elements@> =
+int t_yim_count;
+@ @d YIMs_of_YS(set) ((set)->t_earley_items)
+@<Widely aligned Earley set elements@> =
+YIM* t_earley_items;
+
+@*0 Ordinal.
+The ordinal of the Earley set---
+its number in sequence.
+It is different from the earleme, because there may be
+gaps in the earleme sequence.
+There are never gaps in the sequence of ordinals.
+@d YS_Count_of_R(r) ((r)->t_earley_set_count)
+@d Ord_of_YS(set) ((set)->t_ordinal)
+@<Int aligned Earley set elements@> =
+    int t_ordinal;
+@ @d YS_Ord_is_Valid(r, ordinal)
+    ((ordinal) >= 0 && (ordinal) < YS_Count_of_R(r))
+@<Int aligned recognizer elements@> =
+int t_earley_set_count;
+@ @<Initialize recognizer elements@> =
+r->t_earley_set_count = 0;
+
+@*0 ID of Earley set.
+@d Earleme_of_YS(set) ((set)->t_key.t_earleme)
+
+@*0 Values of Earley set.
+To be used for the application to associate
+an integer and a pointer value
+of its choice with each Earley set.
+@d Value_of_YS(set) ((set)->t_value)
+@d PValue_of_YS(set) ((set)->t_pvalue)
+@<Int aligned Earley set elements@> =
+    int t_value;
+    void* t_pvalue;
+@ @<Initialize Earley set@> =
+   Value_of_YS(set) = -1;
+   PValue_of_YS(set) = NULL;
+
+@ @<Function definitions@> =
+int marpa_r_earley_set_value(Marpa_Recognizer r, Marpa_Earley_Set_ID set_id)
+{
+  @<Return |-2| on failure@>@;
+  YS earley_set;
+  @<Unpack recognizer objects@>@;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail if recognizer not started@>@;
+  if (set_id < 0)
+    {
+      MARPA_R_ERROR (MARPA_ERR_INVALID_LOCATION);
+      return failure_indicator;
+    }
+  r_update_earley_sets (r);
+  if (!YS_Ord_is_Valid (r, set_id))
+    {
+      MARPA_R_ERROR(MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
+      return failure_indicator;
+    }
+  earley_set = YS_of_R_by_Ord (r, set_id);
+  return Value_of_YS(earley_set);
+}
+
+@ @<Function definitions@> =
+int
+marpa_r_earley_set_values(Marpa_Recognizer r, Marpa_Earley_Set_ID set_id,
+  int* p_value, void** p_pvalue)
+{
+  @<Return |-2| on failure@>@;
+  YS earley_set;
+  @<Unpack recognizer objects@>@;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail if recognizer not started@>@;
+  if (set_id < 0)
+    {
+      MARPA_R_ERROR (MARPA_ERR_INVALID_LOCATION);
+      return failure_indicator;
+    }
+  r_update_earley_sets (r);
+  if (!YS_Ord_is_Valid (r, set_id))
+    {
+      MARPA_R_ERROR(MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
+      return failure_indicator;
+    }
+  earley_set = YS_of_R_by_Ord (r, set_id);
+  if (p_value) *p_value = Value_of_YS(earley_set);
+  if (p_pvalue) *p_pvalue = PValue_of_YS(earley_set);
+  return 1;
+}
+
+@ @<Function definitions@> =
+int marpa_r_latest_earley_set_value_set(Marpa_Recognizer r, int value)
+{
+  YS earley_set;
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail if recognizer not started@>@;
+  earley_set = Latest_YS_of_R(r);
+  return Value_of_YS(earley_set) = value;
+}
+
+@ @<Function definitions@> =
+int marpa_r_latest_earley_set_values_set(Marpa_Recognizer r, int value,
+  void* pvalue)
+{
+  YS earley_set;
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail if recognizer not started@>@;
+  earley_set = Latest_YS_of_R(r);
+  Value_of_YS(earley_set) = value;
+  PValue_of_YS(earley_set) = pvalue;
+  return 1;
+}
+
+@*0 Constructor.
+@<Function definitions@> =
+PRIVATE YS
+earley_set_new( RECCE r, JEARLEME id)
+{
+  YSK_Object key;
+  const struct marpa_obstack_mark obs_mark = marpa_obs_mark (r->t_ys_obs);
+  YS set;
+  set = marpa_obs_new (r->t_ys_obs, YS_Object, 1);
+  Obs_Mark_of_YS(set) = obs_mark;
+  key.t_earleme = id;
+  set->t_key = key;
+  set->t_postdot_ary = NULL;
+  set->t_postdot_index = NULL;
+  set->t_postdot_sym_count = 0;
+  YIM_Count_of_YS(set) = 0;
+  set->t_ordinal = r->t_earley_set_count++;
+  YIMs_of_YS(set) = NULL;
+  Next_YS_of_YS(set) = NULL;
+  @<Initialize Earley set@>@/
+  @<Add |set| to the Earley set stack, if compact@>@;
+  return set;
+}
+
+@** Earley item (YIM) code.
+@ {\bf Optimization Principles:}
+\li Optimization should favor unambiguous grammars,
+but not heavily penalize ambiguous grammars.
+\li Optimization should favor mildly ambiguous grammars,
+but not heavily penalize very ambiguous grammars.
+\li Optimization should focus on saving space,
+perhaps even if at a slight cost in time.
+@ Space savings are important
+because in practical applications
+there can easily be many millions of
+Earley items and links.
+If there are 1M copies of a structure,
+each byte saved is a 1M saved.
+
+@ The solution arrived at is to optimize for Earley items
+with a single source, storing that source in the item
+itself.
+For Earley item with multiple sources, a special structure
+of linked lists is used.
+When a second source is added,
+the first source is copied into the lists,
+and its original space used for pointers to the linked
+lists.
+@ This solution is optimized both
+for the unambiguous case,
+and for adding the third and additional
+sources.
+The only awkwardness takes place
+when the second source is added, and the first one must
+be recopied to make way for pointers to the linked lists.
+@d LHS_NSYID_of_YIM(yim)
+  LHS_NSYID_of_AHM(AHM_of_YIM(yim))
+@ It might be slightly faster if this boolean is memoized in the Earley item
+when the Earley item is initialized.
+@d YIM_is_Completion(item)
+    (AHM_is_Completion(AHM_of_YIM(item)))
+@s Marpa_Earley_Item_ID int
+@<Public typedefs@> = typedef int Marpa_Earley_Item_ID;
+@ The ID of the Earley item is per-Earley-set, so that
+to uniquely specify the Earley item you must also specify
+the Earley set.
+The accessors for the key of the Earley item
+depend on its layout, and are defined with it.
+@d Ord_of_YIM(yim) (yim_ordinal(yim))
+@d Earleme_of_YIM(yim) Earleme_of_YS(YS_of_YIM(yim))
+@d Postdot_NSYID_of_YIM(yim) Postdot_NSYID_of_AHM(AHM_of_YIM(yim))
+@d IRL_of_YIM(yim) IRL_of_AHM(AHM_of_YIM(yim))
+@d IRLID_of_YIM(yim) ID_of_IRL(IRL_of_YIM(yim))
+@d Origin_Earleme_of_YIM(yim) (Earleme_of_YS(Origin_of_YIM(yim)))
+@s YIM int
+@<Private incomplete structures@> =
+struct s_earley_item;
+typedef struct s_earley_item* YIM;
+typedef const struct s_earley_item* YIM_Const;
+struct s_earley_item_key;
+typedef struct s_earley_item_key* YIK;
+
+@ The layout matters a great deal, because there will be lots of them.
+I reduce the size of the YIM ordinal in order to save one word per
+YIM.
+Over 64,000 Earley items in a single Earley set
+is rare, but it does happen with highly ambiguous grammars
+and long inputs.
+The Earley items beyond that point are given
+a wide ordinal, which is kept outside the packed bitfield.
+@d YIM_ORDINAL_WIDTH 16
+@d YIM_ORDINAL_OVERFLOW ((1<<(YIM_ORDINAL_WIDTH))-1)
+@d YIM_FATAL_THRESHOLD (INT_MAX/4)
+@d YIM_is_Rejected(yim) ((yim)->t_is_rejected)
+@d YIM_is_Active(yim) ((yim)->t_is_active)
+@d YIM_was_Scanned(yim) ((yim)->t_was_scanned)
+@d YIM_was_Fusion(yim) ((yim)->t_was_fusion)
+@<Earley item structure@> =
+struct s_earley_item_key {
+     AHM t_ahm;
+     YS t_origin;
+     YS t_set;
+};
+typedef struct s_earley_item_key YIK_Object;
+#if MARPA_COMPACT_YIM
+@<Compact Earley item structure@>@;
+#else
+struct s_earley_item {
+     YIK_Object t_key;
+     union u_source_container t_container;
+     BITFIELD t_ordinal:YIM_ORDINAL_WIDTH;
+    BITFIELD t_source_type:3;
+    BITFIELD t_is_rejected:1;
+    BITFIELD t_is_active:1;
+    BITFIELD t_was_scanned:1;
+    BITFIELD t_was_fusion:1;
+};
+#define YS_of_YIM(yim) ((yim)->t_key.t_set)
+#define YS_Ord_of_YIM(yim) (Ord_of_YS(YS_of_YIM(yim)))
+#define AHM_of_YIM(yim) ((yim)->t_key.t_ahm)
+#define AHMID_of_YIM(yim) ID_of_AHM(AHM_of_YIM(yim))
+#define Origin_of_YIM(yim) ((yim)->t_key.t_origin)
+#define Origin_Ord_of_YIM(yim) (Ord_of_YS(Origin_of_YIM(yim)))
+#endif
+typedef struct s_earley_item YIM_Object;
+@<Wide Earley item structure@>@;
+
+@*0 Wide Earley item ordinals.
+An Earley item whose ordinal does not fit in
+the packed ordinal bitfield is allocated with a trailing
+|int| to hold its ordinal,
+and its packed ordinal is set to |YIM_ORDINAL_OVERFLOW|.
+The trailing |int| is at a fixed offset from the start
+of the Earley item,
+so no side table is needed to find it.
+Earley sets small enough to need no wide ordinals pay only a
+comparison on each lookup of an ordinal.
+@d Wide_Ord_of_YIM(yim) (((struct s_earley_item_wide*)(yim))->t_ordinal)
+@<Wide Earley item structure@> =
+struct s_earley_item_wide {
+     YIM_Object t_yim;
+     int t_ordinal;
+};
+
+@ @<Function definitions@> =
+PRIVATE int yim_ordinal(YIM yim)
+{
+  const int ordinal = (int) yim->t_ordinal;
+  if (_MARPA_LIKELY (ordinal != YIM_ORDINAL_OVERFLOW))
+    return ordinal;
+  return Wide_Ord_of_YIM (yim);
+}
+
+@ @<Allocate |new_item| with ordinal |count-1|@> =
+{
+  const int ordinal = count - 1;
+  if (_MARPA_LIKELY (ordinal < YIM_ORDINAL_OVERFLOW))
+    {
+      new_item = marpa_obs_new (r->t_ys_obs, struct s_earley_item, 1);
+      /* Masked, so that the compiler can see it fits the bitfield */
+      new_item->t_ordinal = (unsigned int) ordinal & YIM_ORDINAL_OVERFLOW;
+    }
+  else
+    {
+      struct s_earley_item_wide *const wide_item =
+        marpa_obs_new (r->t_ys_obs, struct s_earley_item_wide, 1);
+      new_item = &wide_item->t_yim;
+      new_item->t_ordinal = YIM_ORDINAL_OVERFLOW;
+      wide_item->t_ordinal = ordinal;
+    }
+}
+
+@*0 The compact Earley item.
+When |MARPA_COMPACT_YIM| is defined to be non-zero,
+the key of an Earley item is kept as
+32-bit integers: the AHM ID, and the ordinals of the origin
+and current Earley sets.
+On machines with 64-bit pointers, this
+halves the size of the key.
+The bitfields are moved up so that they fill
+the rest of the key's last 64-bit word.
+@ The price is an extra indirection in recovering the
+AHM and the Earley sets.
+The AHM is found from the grammar, which must be in scope
+as |g|, and
+the Earley sets from the recognizer's Earley set stack,
+which must be in scope as |r|.
+Ordinals are enough to compare items, and where the
+code only needs ordinals, it uses them directly.
+@<Compact Earley item structure@> =
+struct s_earley_item_compact_key {
+     AHMID t_ahmid;
+     YSID t_origin_ord;
+     YSID t_set_ord;
+};
+struct s_earley_item {
+     struct s_earley_item_compact_key t_key;
+     BITFIELD t_ordinal:YIM_ORDINAL_WIDTH;
+    BITFIELD t_source_type:3;
+    BITFIELD t_is_rejected:1;
+    BITFIELD t_is_active:1;
+    BITFIELD t_was_scanned:1;
+    BITFIELD t_was_fusion:1;
+     union u_source_container t_container;
+};
+#define YS_Ord_of_YIM(yim) ((yim)->t_key.t_set_ord)
+#define YS_of_YIM(yim) (YS_of_R_by_Ord(r, YS_Ord_of_YIM(yim)))
+#define AHMID_of_YIM(yim) ((yim)->t_key.t_ahmid)
+#define AHM_of_YIM(yim) (AHM_by_ID(AHMID_of_YIM(yim)))
+#define Origin_Ord_of_YIM(yim) ((yim)->t_key.t_origin_ord)
+#define Origin_of_YIM(yim) (YS_of_R_by_Ord(r, Origin_Ord_of_YIM(yim)))
+
+@ In the compact layout,
+the key is converted when the Earley item is created.
+@<Set the key of |new_item|@> =
+#if MARPA_COMPACT_YIM
+  new_item->t_key.t_ahmid = ID_of_AHM (key.t_ahm);
+  new_item->t_key.t_origin_ord = Ord_of_YS (key.t_origin);
+  new_item->t_key.t_set_ord = Ord_of_YS (key.t_set);
+#else
+  new_item->t_key = key;
+#endif
+
+@ The compact layout finds Earley sets by ordinal
+while the parse is still in progress,
+so the recognizer's Earley set stack must be kept current
+as each Earley set is created,
+instead of being brought up to date on demand.
+@<Add |set| to the Earley set stack, if compact@> =
+#if MARPA_COMPACT_YIM
+{
+  YS *end_of_stack;
+  if (!MARPA_DSTACK_IS_INITIALIZED (r->t_earley_set_stack))
+    MARPA_DSTACK_INIT (r->t_earley_set_stack, YS, 1024);
+  end_of_stack = MARPA_DSTACK_PUSH (r->t_earley_set_stack, YS);
+  *end_of_stack = set;
+}
+#endif
+
+@ Signed as opposed to the the way it is kept (unsigned, for portability,
+because it is a bitfield.  I may have to change this.
+@<Private typedefs@> =
+typedef int YIMID;
+
+@*0 Constructor.
+Find an Earley item object, creating it if it does not exist.
+Only in a few cases per parse (in Earley set 0),
+do we already
+know that the Earley item is unique in the set.
+These are not worth optimizing for.
+@<Function definitions@> =
+PRIVATE YIM earley_item_create(const RECCE r,
+    const YIK_Object key)
+{
+  @<Return |NULL| on failure@>@;
+  const GRAMMAR g @,@, UNUSED = G_of_R (r);
+  YIM new_item;
+  YIM* end_of_work_stack;
+  const YS set = key.t_set;
+  const int count = ++YIM_Count_of_YS(set);
+  @<Check count against Earley item thresholds@>@;
+  @<Allocate |new_item| with ordinal |count-1|@>@;
+  @<Set the key of |new_item|@>@;
+  YIM_Count_of_R(r)++;
+  new_item->t_source_type = NO_SOURCE;
+  YIM_is_Rejected(new_item) = 0;
+  YIM_is_Active(new_item) = 1;
+  {
+    SRC unique_yim_src = SRC_of_YIM (new_item);
+    SRC_is_Rejected (unique_yim_src) = 0;
+    SRC_is_Active (unique_yim_src) = 1;
+  }
+  end_of_work_stack = WORK_YIM_PUSH(r);
+  *end_of_work_stack = new_item;
+  return new_item;
+}
+
+@ @<Function definitions@> =
+PRIVATE YIM
+earley_item_assign (const RECCE r, const YS set, const YS origin,
+                    const AHM ahm)
+{
+  const GRAMMAR g = G_of_R (r);
+  YIK_Object key;
+  YIM yim;
+  PSL psl;
+  AHMID ahm_id = ID_of_AHM(ahm);
+  PSL *psl_owner = &Dot_PSL_of_YS (origin);
+  if (!*psl_owner)
+    {
+      psl_claim (psl_owner, Dot_PSAR_of_R(r));
+    }
+  psl = *psl_owner;
+  yim = PSL_Datum (psl, ahm_id);
+  if (yim
+      && YS_Ord_of_YIM (yim) == Ord_of_YS (set)
+      && Origin_Ord_of_YIM (yim) == Ord_of_YS (origin))
+    {
+      return yim;
+    }
+  key.t_origin = origin;
+  key.t_ahm = ahm;
+  key.t_set = set;
+  yim = earley_item_create (r, key);
+  PSL_Datum (psl, ahm_id) = yim;
+  return yim;
+}
+
+@ The fatal threshold always applies.
+The warning threshold does not count against items added by a Leo expansion.
+@<Check count against Earley item thresholds@> =
+if (count >= r->t_earley_item_warning_threshold)
+  {
+    if (_MARPA_UNLIKELY (count >= YIM_FATAL_THRESHOLD))
+      {                         /* Set the recognizer to a fatal error */
+        MARPA_R_FATAL (MARPA_ERR_YIM_COUNT);
+        return failure_indicator;
+      }
+      r_int_event_new (r, MARPA_EVENT_EARLEY_ITEM_THRESHOLD, count);
+  }
+
+@*0 Destructor.
+No destructor.  All earley item elements are either owned by other objects.
+The Earley item itself is on the obstack.
+
+@*0 Earley item memory statistics.
+The count of Earley items is kept for the whole recognizer,
+so that the memory statistics do not need to
+traverse the Earley sets.
+@d YIM_Count_of_R(r) ((r)->t_earley_item_count)
+@<Int aligned recognizer elements@> =
+int t_earley_item_count;
+@ @<Initialize recognizer elements@> =
+r->t_earley_item_count = 0;
+
+@*0 Recognizer statistics.
+The counts are maintained as the objects are created,
+and the memory of each subsystem is either maintained
+the same way, or is available directly from its allocator.
+|marpa_r_memory_stats| is therefore cheap enough to call
+after every earleme.
+@ The postdot arrays and indexes are allocated on the Earley set segments,
+so their bytes are also counted in the obstack total.
+They are reported separately because they are
+the part of the obstack that grows with the count of postdot
+symbols.
+@d LIM_Count_of_R(r) ((r)->t_leo_item_count)
+@d PIM_Count_of_R(r) ((r)->t_postdot_item_count)
+@d SRCL_Count_of_R(r) ((r)->t_source_link_count)
+@<Widely aligned recognizer elements@> =
+size_t t_postdot_array_bytes;
+@ @<Int aligned recognizer elements@> =
+int t_leo_item_count;
+int t_postdot_item_count;
+int t_source_link_count;
+@ @<Initialize recognizer elements@> =
+r->t_postdot_array_bytes = 0;
+r->t_leo_item_count = 0;
+r->t_postdot_item_count = 0;
+r->t_source_link_count = 0;
+
+@ @<Public structures@> =
+struct marpa_memory_stats {
+     size_t t_obstack_bytes;
+     size_t t_psl_bytes;
+     size_t t_alternative_bytes;
+     size_t t_completion_stack_bytes;
+     size_t t_postdot_array_bytes;
+     size_t t_charged_bytes;
+     int t_earley_item_size;
+     int t_earley_set_count;
+     int t_earley_item_count;
+     int t_leo_item_count;
+     int t_postdot_item_count;
+     int t_source_link_count;
+};
+typedef struct marpa_memory_stats Marpa_Memory_Stats;
+
+@ Returns 1 on success and |-2| on failure.
+The size of an Earley item depends on whether this
+is a compact build, and reporting it
+makes it easy to compare the two layouts.
+@<Function definitions@> =
+int
+marpa_r_memory_stats (Marpa_Recognizer r, Marpa_Memory_Stats* stats)
+{
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  int bucket_ix;
+  size_t alternative_capacity = 0;
+  @<Fail if recognizer has a fatal error@>@;
+  if (_MARPA_UNLIKELY (!stats))
+    {
+      MARPA_R_ERROR (MARPA_ERR_POINTER_ARG_NULL);
+      return failure_indicator;
+    }
+  for (bucket_ix = 0; bucket_ix < ALT_BUCKET_COUNT; bucket_ix++)
+    {
+      alternative_capacity +=
+        (size_t) MARPA_DSTACK_CAPACITY (r->t_alternative_buckets[bucket_ix]);
+    }
+  stats->t_obstack_bytes =
+    marpa_obs_total_size (r->t_obs) + ys_segments_total_size (r)
+    + marpa_obs_total_size (r->t_cilar.t_obs);
+  if (r->t_prediction_memo_tree)
+    stats->t_obstack_bytes +=
+      marpa_obs_total_size (MARPA_AVL_OBSTACK (r->t_prediction_memo_tree));
+  stats->t_psl_bytes = Dot_PSAR_of_R (r)->t_obs
+    ? marpa_obs_total_size (Dot_PSAR_of_R (r)->t_obs) : 0;
+  stats->t_alternative_bytes = alternative_capacity * sizeof (ALT_Object);
+  stats->t_completion_stack_bytes =
+    (size_t) MARPA_DSTACK_CAPACITY (r->t_completion_stack) * sizeof (YIM);
+  stats->t_postdot_array_bytes = r->t_postdot_array_bytes;
+  stats->t_charged_bytes = r->t_memory_budget.used;
+  stats->t_earley_item_size = (int) sizeof (YIM_Object);
+  stats->t_earley_set_count = YS_Count_of_R (r);
+  stats->t_earley_item_count = YIM_Count_of_R (r);
+  stats->t_leo_item_count = LIM_Count_of_R (r);
+  stats->t_postdot_item_count = PIM_Count_of_R (r);
+  stats->t_source_link_count = SRCL_Count_of_R (r);
+  return 1;
+}
+
+@*0 The recognizer memory budget.
+An application may set a limit on the memory used by a recognizer,
+so that one pathological input cannot exhaust the memory
+of a process which is running many recognizers.
+The budget is charged by the allocators of
+the recognizer's obstacks and of its PSLs,
+which between them allocate almost all of a recognizer's memory.
+@ An allocation cannot fail in the middle of an earleme without
+leaving the recognizer inconsistent,
+and unwinding each of the many allocations in the recognizer
+would cost time on every allocation,
+so the allocators only keep count.
+The budget is enforced when an application adds input:
+once the budget is exceeded,
+|marpa_r_alternative|, |marpa_r_alternatives_read| and
+|marpa_r_earleme_complete| fail
+with |MARPA_ERR_MEMORY_BUDGET_EXCEEDED|.
+The recognizer is left consistent,
+so that its application may query it, create a bocage from it,
+or raise its budget and continue.
+Since the check is made between earlemes,
+the budget may be exceeded by the memory needed for one earleme.
+@d R_is_Over_Budget(r)
+  ((r)->t_memory_budget.limit
+    && (r)->t_memory_budget.used > (r)->t_memory_budget.limit)
+@<Widely aligned recognizer elements@> =
+struct marpa_obstack_budget t_memory_budget;
+@ @<Attach the recognizer memory budget@> =
+{
+  struct marpa_obstack_budget *const budget = &r->t_memory_budget;
+  budget->limit = 0;
+  budget->used = 0;
+  marpa_obs_budget_attach (r->t_obs, budget);
+  marpa_obs_budget_attach (r->t_cilar.t_obs, budget);
+  if (Dot_PSAR_of_R (r)->t_obs)
+    marpa_obs_budget_attach (Dot_PSAR_of_R (r)->t_obs, budget);
+}
+
+@ @<Fail if recognizer memory budget exceeded@> =
+if (_MARPA_UNLIKELY (R_is_Over_Budget (r)))
+  {
+    MARPA_R_ERROR (MARPA_ERR_MEMORY_BUDGET_EXCEEDED);
+    return failure_indicator;
+  }
+
+@ A budget of zero means no limit, and is the default.
+Returns 1 on success, |-2| on failure.
+@<Function definitions@> =
+int
+marpa_r_memory_budget_set (Marpa_Recognizer r, size_t bytes)
+{
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  @<Fail if recognizer has a fatal error@>@;
+  r->t_memory_budget.limit = bytes;
+  return 1;
+}
+
+@ @<Function definitions@> =
+size_t
+marpa_r_memory_budget (Marpa_Recognizer r)
+{
+  return r->t_memory_budget.limit;
+}
+
+@*0 Source of the Earley item.
+@d NO_SOURCE (0U)
+@d SOURCE_IS_TOKEN (1U)
+@d SOURCE_IS_COMPLETION (2U)
+@d SOURCE_IS_LEO (3U)
+@d SOURCE_IS_AMBIGUOUS (4U)
+@d Source_Type_of_YIM(item) ((item)->t_source_type)
+@d Earley_Item_has_No_Source(item) ((item)->t_source_type == NO_SOURCE)
+@d Earley_Item_has_Token_Source(item) ((item)->t_source_type == SOURCE_IS_TOKEN)
+@d Earley_Item_has_Complete_Source(item) ((item)->t_source_type == SOURCE_IS_COMPLETION)
+@d Earley_Item_has_Leo_Source(item) ((item)->t_source_type == SOURCE_IS_LEO)
+@d Earley_Item_is_Ambiguous(item) ((item)->t_source_type == SOURCE_IS_AMBIGUOUS)
+
+@ Not inline, because not used in critical paths.
+This is for creating error messages.
+@<Function definitions@> =
+PRIVATE_NOT_INLINE Marpa_Error_Code invalid_source_type_code(unsigned int type)
+{
+     switch (type) {
+    case NO_SOURCE:
+        return MARPA_ERR_SOURCE_TYPE_IS_NONE;
+    case SOURCE_IS_TOKEN:
+        return MARPA_ERR_SOURCE_TYPE_IS_TOKEN;
+    case SOURCE_IS_COMPLETION:
+        return MARPA_ERR_SOURCE_TYPE_IS_COMPLETION;
+    case SOURCE_IS_LEO:
+        return MARPA_ERR_SOURCE_TYPE_IS_LEO;
+    case SOURCE_IS_AMBIGUOUS:
+        return MARPA_ERR_SOURCE_TYPE_IS_AMBIGUOUS;
+     }
+     return MARPA_ERR_SOURCE_TYPE_IS_UNKNOWN;
+}
+
+@** Earley index (YIX) code.
+Postdot items are of two kinds: Earley indexes
+and Leo items.
+The payload of an Earley index is simple:
+a pointer to an Earley item.
+The other elements of the YIX are overhead to
+support the chain of postdot items for
+a postdot symbol.
+@d Next_PIM_of_YIX(yix) ((yix)->t_next)
+@d YIM_of_YIX(yix) ((yix)->t_earley_item)
+@d Postdot_NSYID_of_YIX(yix) ((yix)->t_postdot_nsyid)
+@<Private incomplete structures@> =
+struct s_earley_ix;
+typedef struct s_earley_ix* YIX;
+union u_postdot_item;
+@ @<Private structures@> =
+struct s_earley_ix {
+     union u_postdot_item* t_next;
+     NSYID t_postdot_nsyid;
+     YIM t_earley_item; // Never NULL if this is an index item
+};
+typedef struct s_earley_ix YIX_Object;
+
+@** Leo item (LIM) code.
+Leo items originate from the ``transition items" of Joop Leo's 1991 paper.
+They are set up so their first fields are identical to those of
+the Earley item indexes,
+so that they can be linked together in the same chain.
+Because the Earley index is at the beginning of each Leo item,
+LIMs can be treated as a kind of YIX.
+@d YIX_of_LIM(lim) ((YIX)(lim))
+@ Both Earley indexes and Leo items are
+postdot items, so that Leo items also require
+the fields to maintain the chain of postdot items.
+For this reason, Leo items contain an Earley index,
+but one
+with a |NULL| Earley item pointer.
+@d Postdot_NSYID_of_LIM(leo) (Postdot_NSYID_of_YIX(YIX_of_LIM(leo)))
+@d Next_PIM_of_LIM(leo) (Next_PIM_of_YIX(YIX_of_LIM(leo)))
+@d Origin_of_LIM(leo) ((leo)->t_origin)
+@d Top_AHM_of_LIM(leo) ((leo)->t_top_ahm)
+@d Trailhead_AHM_of_LIM(leo) ((leo)->t_trailhead_ahm)
+@d Predecessor_LIM_of_LIM(leo) ((leo)->t_predecessor)
+@d Trailhead_YIM_of_LIM(leo) ((leo)->t_base)
+@d YS_of_LIM(leo) ((leo)->t_set)
+@d Earleme_of_LIM(lim) Earleme_of_YS(YS_of_LIM(lim))
+@d LIM_is_Rejected(lim) ((lim)->t_is_rejected)
+@d LIM_is_Active(lim) ((lim)->t_is_active)
+@<Private incomplete structures@> =
+struct s_leo_item;
+typedef struct s_leo_item* LIM;
+@ @<Private structures@> =
+struct s_leo_item {
+     YIX_Object t_earley_ix;
+    @<Widely aligned LIM elements@>@;
+     YS t_origin;
+     AHM t_top_ahm;
+     AHM t_trailhead_ahm;
+     LIM t_predecessor;
+     YIM t_base;
+     YS t_set;
+     BITFIELD t_is_rejected:1;
+     BITFIELD t_is_active:1;
+};
+typedef struct s_leo_item LIM_Object;
+
+@ @d CIL_of_LIM(lim) ((lim)->t_cil)
+@<Widely aligned LIM elements@> =
+    CIL t_cil;
+
+@** Postdot item (PIM) code.
+Postdot items are entries in an index,
+by postdot symbol, of both the Earley items and the Leo items
+for each Earley set.
+@d LIM_of_PIM(pim) ((LIM)(pim))
+@d YIX_of_PIM(pim) ((YIX)(pim))
+@d Postdot_NSYID_of_PIM(pim) (Postdot_NSYID_of_YIX(YIX_of_PIM(pim)))
+@d YIM_of_PIM(pim) (YIM_of_YIX(YIX_of_PIM(pim)))
+@d Next_PIM_of_PIM(pim) (Next_PIM_of_YIX(YIX_of_PIM(pim)))
+
+@ |PIM_of_LIM| assumes that PIM is in fact a LIM.
+|PIM_is_LIM| is available to check this.
+@d PIM_of_LIM(pim) ((PIM)(pim))
+@d PIM_is_LIM(pim) (YIM_of_YIX(YIX_of_PIM(pim)) == NULL)
+@s PIM int
+@<Private structures@> =
+union u_postdot_item {
+    LIM_Object t_leo;
+    YIX_Object t_earley;
+};
+typedef union u_postdot_item PIM_Object;
+typedef union u_postdot_item* PIM;
+
+@ This function searches for the
+first postdot item for an Earley set
+and a symbol ID.
+If successful, it
+returns that postdot item.
+If it fails, it returns |NULL|.
+If the Earley set has a postdot index,
+the lookup is direct.
+Otherwise it is a binary search of the postdot array.
+@<Function definitions@> =
+PRIVATE PIM*
+pim_nsy_p_find (YS set, NSYID nsyid)
+{
+  int lo = 0;
+  int hi = Postdot_SYM_Count_of_YS(set) - 1;
+  PIM* postdot_array = set->t_postdot_ary;
+  const LBW* const postdot_index = set->t_postdot_index;
+  if (postdot_index) {
+      @<Find |nsyid| using the postdot index@>@;
+  }
+  while (hi >= lo) { // A binary search
+       int trial = lo+(hi-lo)/2; // guards against overflow
+       PIM trial_pim = postdot_array[trial];
+       NSYID trial_nsyid = Postdot_NSYID_of_PIM(trial_pim);
+       if (trial_nsyid == nsyid) return postdot_array+trial;
+       if (trial_nsyid < nsyid) {
+           lo = trial+1;
+       } else {
+           hi = trial-1;
+       }
+  }
+  return NULL;
+}
+@*0 The postdot index.
+The postdot index is an optional alternative to
+the binary search of the postdot array.
+It is a rank directory:
+for every word of a boolean vector by NSYID,
+it contains the word itself,
+followed by the count of the postdot symbols in
+all the previous words.
+A symbol's postdot items, if it has any,
+are at the entry in the postdot array given by the count for its word,
+plus the count of the bits below it in the word.
+The word and its count are adjacent,
+so that a lookup usually touches a single cache line of the index.
+@ The index costs two words for every |lbv_wordbits| NSYs
+in each Earley set, which is why it is optional.
+For grammars with many NSYs, and Earley sets with many postdot
+symbols, it saves the binary search
+on every token scanned and every completion.
+@d Postdot_Index_Size_of_NSY_Count(nsy_count)
+  (lbv_bits_to_size(nsy_count) * 2)
+@<Find |nsyid| using the postdot index@> =
+{
+  const LBW *const entry = postdot_index + ((LBW) nsyid / lbv_wordbits) * 2;
+  const LBW bit = lbv_b ((LBW) nsyid);
+  if (!(entry[0] & bit))
+    return NULL;
+  return postdot_array + entry[1] + lbw_popcount (entry[0] & (bit - 1));
+}
+
+@ Whether the recognizer builds postdot indexes is controlled
+by a flag, which can only be changed before input starts.
+By default, the flag is off.
+@<Bit aligned recognizer elements@> =
+BITFIELD t_use_postdot_index:1;
+@ @<Initialize recognizer elements@> =
+r->t_use_postdot_index = 0;
+@ Returns 1 if the ``use postdot index" flag is set,
+0 if not,
+and |-2| if there was an error.
+@<Function definitions@> =
+int _marpa_r_is_use_postdot_index(Marpa_Recognizer  r)
+{
+   @<Unpack recognizer objects@>@;
+   @<Return |-2| on failure@>@;
+    @<Fail if recognizer has a fatal error@>@;
+    return r->t_use_postdot_index;
+}
+@ @<Function definitions@> =
+int _marpa_r_is_use_postdot_index_set(
+Marpa_Recognizer r, int value)
+{
+   @<Unpack recognizer objects@>@;
+   @<Return |-2| on failure@>@/
+    @<Fail if recognizer has a fatal error@>@;
+    @<Fail if recognizer started@>@;
+    return r->t_use_postdot_index = value ? 1 : 0;
+}
+
+@ @<Function definitions@> =
+PRIVATE PIM first_pim_of_ys_by_nsyid(YS set, NSYID nsyid)
+{
+   PIM* pim_nsy_p = pim_nsy_p_find(set, nsyid);
+   return pim_nsy_p ? *pim_nsy_p : NULL;
+}
+
+@** Source objects.
+Nothing internally distinguishes the various source objects
+by type.
+It is assumed that their type will be known from
+the context in which they are used.
+@*0 The relationship between Leo items and ambiguity.
+The relationship between Leo items and ambiguous sources bears
+some explaining.
+Leo sources must be unique, but only when their predecessor's
+Earley set is considered.
+That is, for every pairing of Earley item and Earley set,
+there is only one Leo source in that Earley item
+with a predecessor in that Earley set.
+But there may be other sources (both Leo and non-Leo),
+a long as their predecessors
+are in different Earley sets.
+@ One way to look at these Leo ambiguities is as different
+``factorings" of the Earley item.
+Call the last (or transition) symbol of an Earley item
+its ``cause".
+An Earley item will often have both a predecessor and a cause,
+and these can ``factor", or divide up, the distance between
+an Earley item's origin and its current set in different ways.
+@ The Earley item can have only one origin,
+and only one transition symbol.
+But that transition symbol does not have to start at the origin
+and can start anywhere between the origin and the current
+set of the Earley item.
+For example, for an Earley item at earleme 14, with its origin at 10,
+there may be no predecessor,
+in which case the ``cause" starts at 10.
+Or there may be a predecessor, in which case
+the ``cause" may start at earlemes 11, 12 or 13.
+This different divisions between the (possibly null) predecessor
+and the ``cause" are ``factorings" of the Earley item.
+@ Each factoring may have its own Leo source.
+At those earlemes without a Leo source, there may be any number
+of non-Leo sources.
+@*0 Optimization.
+There will be a lot of these structures in a long
+parse, so space optimization gets an unusual amount of
+attention in the source links.
+@d Next_SRCL_of_SRCL(link) ((link)->t_next)
+@ @<Private typedefs@> =
+struct s_source;
+typedef struct s_source* SRC;
+typedef const struct s_source* SRC_Const;
+@ @<Source object structure@>=
+struct s_token_source {
+    NSYID t_nsyid;
+    int t_value;
+};
+
+@ {\bf To Do}: @^To Do@>
+There are a lot of these and some tricks to reduce the
+space used can be justified.
+@<Source object structure@>=
+struct s_source {
+     void * t_predecessor;
+     union {
+         void * t_completion;
+         struct s_token_source t_token;
+     } t_cause;
+     BITFIELD t_is_rejected:1;
+     BITFIELD t_is_active:1;
+     /* A type field could go here */
+};
+
+@ @<Private typedefs@> =
+struct s_source_link;
+typedef struct s_source_link* SRCL;
+@ @<Source object structure@>=
+struct s_source_link {
+    SRCL t_next;
+    struct s_source t_source;
+};
+typedef struct s_source_link SRCL_Object;
+
+@ @<Source object structure@>=
+struct s_ambiguous_source {
+    SRCL t_leo;
+    SRCL t_token;
+    SRCL t_completion;
+};
+
+@ @<Source object structure@>=
+union u_source_container {
+    struct s_ambiguous_source t_ambiguous;
+    struct s_source_link t_unique;
+};
+
+@
+@d Source_of_SRCL(link) ((link)->t_source)
+@d SRC_of_SRCL(link) (&Source_of_SRCL(link))
+@d SRCL_of_YIM(yim) (&(yim)->t_container.t_unique)
+@d Source_of_YIM(yim) ((yim)->t_container.t_unique.t_source)
+@d SRC_of_YIM(yim) (&Source_of_YIM(yim))
+@d Predecessor_of_Source(srcd) ((srcd).t_predecessor)
+@d Predecessor_of_SRC(source) Predecessor_of_Source(*(source))
+@d Predecessor_of_YIM(item) Predecessor_of_Source(Source_of_YIM(item))
+@d Predecessor_of_SRCL(link) Predecessor_of_Source(Source_of_SRCL(link))
+@d LIM_of_SRCL(link) ((LIM)Predecessor_of_SRCL(link))
+@d Cause_of_Source(srcd) ((srcd).t_cause.t_completion)
+@d Cause_of_SRC(source) Cause_of_Source(*(source))
+@d Cause_of_YIM(item) Cause_of_Source(Source_of_YIM(item))
+@d Cause_of_SRCL(link) Cause_of_Source(Source_of_SRCL(link))
+@d TOK_of_Source(srcd) ((srcd).t_cause.t_token)
+@d TOK_of_SRC(source) TOK_of_Source(*(source))
+@d TOK_of_YIM(yim) TOK_of_Source(Source_of_YIM(yim))
+@d TOK_of_SRCL(link) TOK_of_Source(Source_of_SRCL(link))
+@d NSYID_of_Source(srcd) ((srcd).t_cause.t_token.t_nsyid)
+@d NSYID_of_SRC(source) NSYID_of_Source(*(source))
+@d NSYID_of_YIM(yim) NSYID_of_Source(Source_of_YIM(yim))
+@d NSYID_of_SRCL(link) NSYID_of_Source(Source_of_SRCL(link))
+@d Value_of_Source(srcd) ((srcd).t_cause.t_token.t_value)
+@d Value_of_SRC(source) Value_of_Source(*(source))
+@d Value_of_SRCL(link) Value_of_Source(Source_of_SRCL(link))
+
+@d SRC_is_Active(src) ((src)->t_is_active)
+@d SRC_is_Rejected(src) ((src)->t_is_rejected)
+@d SRCL_is_Active(link) ((link)->t_source.t_is_active)
+@d SRCL_is_Rejected(link) ((link)->t_source.t_is_rejected)
+
+@ @d Cause_AHMID_of_SRCL(srcl)
+    AHMID_of_YIM((YIM)Cause_of_SRCL(srcl))
+@d Leo_Transition_NSYID_of_SRCL(leo_source_link)
+    Postdot_NSYID_of_LIM(LIM_of_SRCL(leo_source_link))
+
+@ Macros for setting and finding the first |SRCL|'s of each type.
+@d LV_First_Completion_SRCL_of_YIM(item) ((item)->t_container.t_ambiguous.t_completion)
+@d First_Completion_SRCL_of_YIM(item)
+  ( Source_Type_of_YIM(item) == SOURCE_IS_COMPLETION ? (SRCL)SRCL_of_YIM(item) :
+  Source_Type_of_YIM(item) == SOURCE_IS_AMBIGUOUS ?
+    LV_First_Completion_SRCL_of_YIM(item) : NULL)
+
+@d LV_First_Token_SRCL_of_YIM(item) ((item)->t_container.t_ambiguous.t_token)
+@d First_Token_SRCL_of_YIM(item)
+  ( Source_Type_of_YIM(item) == SOURCE_IS_TOKEN ? (SRCL)SRCL_of_YIM(item) :
+  Source_Type_of_YIM(item) == SOURCE_IS_AMBIGUOUS ?
+    LV_First_Token_SRCL_of_YIM(item) : NULL)
+
+@d LV_First_Leo_SRCL_of_YIM(item) ((item)->t_container.t_ambiguous.t_leo)
+@d First_Leo_SRCL_of_YIM(item)
+  ( Source_Type_of_YIM(item) == SOURCE_IS_LEO ? (SRCL)SRCL_of_YIM(item) :
+  Source_Type_of_YIM(item) == SOURCE_IS_AMBIGUOUS ?
+    LV_First_Leo_SRCL_of_YIM(item) : NULL)
+
+@ Creates unique (that is, not ambiguous) SRCL's.
+@<Function definitions@> =
+PRIVATE
+SRCL unique_srcl_new( const RECCE r)
+{
+  const SRCL new_srcl = marpa_obs_new (r->t_ys_obs, SRCL_Object, 1);
+  SRCL_Count_of_R(r)++;
+  SRCL_is_Rejected(new_srcl) = 0;
+  SRCL_is_Active(new_srcl) = 1;
+  return new_srcl;
+}
+
+@ @<Function definitions@> = PRIVATE
+void
+tkn_link_add (RECCE r,
+                YIM item,
+                YIM predecessor,
+                ALT alternative)
+{
+  SRCL new_link;
+  unsigned int previous_source_type = Source_Type_of_YIM (item);
+  if (previous_source_type == NO_SOURCE)
+    {
+      const SRCL source_link = SRCL_of_YIM(item);
+      Source_Type_of_YIM (item) = SOURCE_IS_TOKEN;
+      Predecessor_of_SRCL(source_link) = predecessor;
+      NSYID_of_SRCL(source_link) = NSYID_of_ALT(alternative);
+      Value_of_SRCL(source_link) = Value_of_ALT(alternative);
+      Next_SRCL_of_SRCL(source_link) = NULL;
+      return;
+    }
+  if (previous_source_type != SOURCE_IS_AMBIGUOUS)
+    { // If the sourcing is not already ambiguous, make it so
+      earley_item_ambiguate (r, item);
+    }
+  new_link = unique_srcl_new (r);
+  new_link->t_next = LV_First_Token_SRCL_of_YIM (item);
+  new_link->t_source.t_predecessor = predecessor;
+  NSYID_of_Source(new_link->t_source) = NSYID_of_ALT(alternative);
+  Value_of_Source(new_link->t_source) = Value_of_ALT(alternative);
+  LV_First_Token_SRCL_of_YIM (item) = new_link;
+}
+
+@ @<Function definitions@> =
+PRIVATE
+void
+completion_link_add (RECCE r,
+                YIM item,
+                YIM predecessor,
+                YIM cause)
+{
+  SRCL new_link;
+  unsigned int previous_source_type = Source_Type_of_YIM (item);
+  if (previous_source_type == NO_SOURCE)
+    {
+      const SRCL source_link = SRCL_of_YIM(item);
+      Source_Type_of_YIM (item) = SOURCE_IS_COMPLETION;
+      Predecessor_of_SRCL(source_link) = predecessor;
+      Cause_of_SRCL(source_link) = cause;
+      Next_SRCL_of_SRCL(source_link) = NULL;
+      return;
+    }
+  if (previous_source_type != SOURCE_IS_AMBIGUOUS)
+    { // If the sourcing is not already ambiguous, make it so
+      earley_item_ambiguate (r, item);
+    }
+  new_link = unique_srcl_new (r);
+  new_link->t_next = LV_First_Completion_SRCL_of_YIM (item);
+  new_link->t_source.t_predecessor = predecessor;
+  Cause_of_Source(new_link->t_source) = cause;
+  LV_First_Completion_SRCL_of_YIM (item) = new_link;
+}
+
+@ @<Function definitions@> =
+PRIVATE void
+leo_link_add (RECCE r,
+                YIM item,
+                LIM predecessor,
+                YIM cause)
+{
+  SRCL new_link;
+  unsigned int previous_source_type = Source_Type_of_YIM (item);
+  if (previous_source_type == NO_SOURCE)
+    {
+      const SRCL source_link = SRCL_of_YIM(item);
+      Source_Type_of_YIM (item) = SOURCE_IS_LEO;
+      Predecessor_of_SRCL(source_link) = predecessor;
+      Cause_of_SRCL(source_link) = cause;
+      Next_SRCL_of_SRCL(source_link) = NULL;
+      return;
+    }
+  if (previous_source_type != SOURCE_IS_AMBIGUOUS)
+    { // If the sourcing is not already ambiguous, make it so
+      earley_item_ambiguate (r, item);
+    }
+  new_link = unique_srcl_new (r);
+  new_link->t_next = LV_First_Leo_SRCL_of_YIM (item);
+  new_link->t_source.t_predecessor = predecessor;
+  Cause_of_Source(new_link->t_source) = cause;
+  LV_First_Leo_SRCL_of_YIM(item) = new_link;
+}
+
+@ {\bf Convert an Earley item to an ambiguous one.}
+|earley_item_ambiguate|
+assumes it is called when there is exactly one source.
+In other words, is assumes that the Earley item
+is not unsourced,
+and that it is not already ambiguous.
+Ambiguous sources should have more than one source,
+and
+|earley_item_ambiguate|
+is assuming that a new source will be added as followup.
+@
+Inlining |earley_item_ambiguate| might help in some
+circumstance, but at this point
+|earley_item_ambiguate| is not marked |inline|.
+|earley_item_ambiguate|
+is not short,
+it is referenced in several places,
+it is only called for ambiguous Earley items,
+and even for these it is only called when the
+Earley item first becomes ambiguous.
+@<Function definitions@> =
+PRIVATE_NOT_INLINE
+void earley_item_ambiguate (struct marpa_r * r, YIM item)
+{
+  unsigned int previous_source_type = Source_Type_of_YIM (item);
+  Source_Type_of_YIM (item) = SOURCE_IS_AMBIGUOUS;
+  switch (previous_source_type)
+    {
+    case SOURCE_IS_TOKEN: @<Ambiguate token source@>@;
+      return;
+    case SOURCE_IS_COMPLETION: @<Ambiguate completion source@>@;
+      return;
+    case SOURCE_IS_LEO: @<Ambiguate Leo source@>@;
+      return;
+    }
+}
+
+@ @<Ambiguate token source@> = {
+  SRCL new_link = marpa_obs_new (r->t_ys_obs, SRCL_Object, 1);
+  SRCL_Count_of_R(r)++;
+  *new_link = *SRCL_of_YIM(item);
+  LV_First_Leo_SRCL_of_YIM (item) = NULL;
+  LV_First_Completion_SRCL_of_YIM (item) = NULL;
+  LV_First_Token_SRCL_of_YIM (item) = new_link;
+}
+
+@ @<Ambiguate completion source@> = {
+  SRCL new_link = marpa_obs_new (r->t_ys_obs, SRCL_Object, 1);
+  SRCL_Count_of_R(r)++;
+  *new_link = *SRCL_of_YIM(item);
+  LV_First_Leo_SRCL_of_YIM (item) = NULL;
+  LV_First_Completion_SRCL_of_YIM (item) = new_link;
+  LV_First_Token_SRCL_of_YIM (item) = NULL;
+}
+
+@ @<Ambiguate Leo source@> = {
+  SRCL new_link = marpa_obs_new (r->t_ys_obs, SRCL_Object, 1);
+  SRCL_Count_of_R(r)++;
+  *new_link = *SRCL_of_YIM(item);
+  LV_First_Leo_SRCL_of_YIM (item) = new_link;
+  LV_First_Completion_SRCL_of_YIM (item) = NULL;
+  LV_First_Token_SRCL_of_YIM (item) = NULL;
+}
+
+@** Alternative tokens (ALT) code.
+Because Marpa allows more than one token at every
+earleme, Marpa's tokens are also called ``alternatives".
+@<Private incomplete structures@> =
+struct s_alternative;
+typedef struct s_alternative* ALT;
+typedef const struct s_alternative* ALT_Const;
+@
+@d NSYID_of_ALT(alt) ((alt)->t_nsyid)
+@d Value_of_ALT(alt) ((alt)->t_value)
+@d ALT_is_Valued(alt) ((alt)->t_is_valued)
+@d Start_YS_of_ALT(alt) ((alt)->t_start_earley_set)
+@d Start_Earleme_of_ALT(alt) Earleme_of_YS(Start_YS_of_ALT(alt))
+@d End_Earleme_of_ALT(alt) ((alt)->t_end_earleme)
+@<Private structures@> =
+struct s_alternative {
+    YS t_start_earley_set;
+    JEARLEME t_end_earleme;
+    NSYID t_nsyid;
     int t_value;
+    BITFIELD t_is_valued:1;
+};
+typedef struct s_alternative ALT_Object;
+
+@ The pending alternatives are kept in a ring of buckets,
+indexed by their end earleme, modulo the number of buckets.
+Most alternatives are short, so that in the usual case
+each bucket holds the alternatives for a single end earleme.
+The alternatives ending at the current earleme are then
+all in one bucket,
+and a new alternative need only be compared against those
+with the same end earleme.
+Long alternatives may share a bucket with shorter ones.
+This costs some efficiency, but not correctness,
+and it keeps the size of the ring fixed.
+@ Each bucket is a stack, sorted so that
+the alternatives with the lowest end earleme are on top.
+Because earlemes are processed in numerical order,
+when the alternatives for an earleme are popped,
+they will always be on top of their bucket.
+@d ALT_BUCKET_COUNT 64
+@d ALT_Bucket_of_R(r, earleme) ((r)->t_alternative_buckets+((earleme) & (ALT_BUCKET_COUNT-1)))
+@d ALT_Count_of_R(r) ((r)->t_alternative_count)
+@<Widely aligned recognizer elements@> =
+struct marpa_dstack_s t_alternative_buckets[ALT_BUCKET_COUNT];
+@ @<Int aligned recognizer elements@> =
+int t_alternative_count;
+@ The buckets are not allocated until they are used.
+Their storage is on the recognizer obstack,
+so that a recognizer does not do a |malloc()| for each
+of its buckets,
+and so that the buckets are freed with the obstack.
+@<Initialize recognizer elements@> =
+{
+  int bucket_ix;
+  for (bucket_ix = 0; bucket_ix < ALT_BUCKET_COUNT; bucket_ix++)
+    {
+      MARPA_DSTACK_SAFE (r->t_alternative_buckets[bucket_ix]);
+    }
+  ALT_Count_of_R(r) = 0;
+}
+
+@ A full bucket is grown by copying it to new storage,
+twice as large, on the recognizer obstack.
+The old storage is not reused,
+but the buckets only grow to the largest number
+of alternatives pending at one end earleme,
+so that the waste is not more than the size of the
+buckets.
+The |MARPA_DSTACK| macros are used for everything else,
+but a bucket must never be grown by |MARPA_DSTACK_PUSH|,
+which would |realloc()| obstack memory.
+@d ALT_BUCKET_INITIAL_CAPACITY 4
+@<Function definitions@> =
+PRIVATE_NOT_INLINE void
+alternative_bucket_grow (RECCE r, MARPA_DSTACK bucket)
+{
+  const int old_capacity = MARPA_DSTACK_CAPACITY (*bucket);
+  const int new_capacity =
+    old_capacity > 0 ? old_capacity * 2 : ALT_BUCKET_INITIAL_CAPACITY;
+  ALT_Object *const new_base =
+    marpa_obs_new (r->t_obs, ALT_Object, new_capacity);
+  if (MARPA_DSTACK_LENGTH (*bucket) > 0)
+    {
+      memcpy (new_base, MARPA_DSTACK_BASE (*bucket, ALT_Object),
+              sizeof (ALT_Object) * (size_t) MARPA_DSTACK_LENGTH (*bucket));
+    }
+  bucket->t_base = new_base;
+  bucket->t_capacity = new_capacity;
+}
+
+@ This functions returns the index in |bucket| at which to insert a new
+alternative, or -1 if the new alternative is a duplicate.
+(Duplicate alternatives should not be inserted.)
+A duplicate will have the same end earleme,
+and therefore will be in the same bucket.
+@ A variation of binary search.
+@<Function definitions@> =
+PRIVATE int
+alternative_insertion_point (MARPA_DSTACK bucket, ALT new_alternative)
+{
+  ALT alternative;
+  int hi = MARPA_DSTACK_LENGTH(*bucket) - 1;
+  int lo = 0;
+  int trial;
+  // Special case when zero alternatives.
+  if (hi < 0)
+    return 0;
+  alternative = MARPA_DSTACK_BASE(*bucket, ALT_Object);
+  for (;;)
+    {
+      int outcome;
+      trial = lo + (hi - lo) / 2;
+      outcome = alternative_cmp (new_alternative, alternative+trial);
+      if (outcome == 0)
+        return -1;
+      if (outcome > 0)
+        {
+          lo = trial + 1;
+        }
+      else
+        {
+          hi = trial - 1;
+        }
+      if (hi < lo)
+        return outcome > 0 ? trial + 1 : trial;
+    }
+}
+
+@ This is the comparison function for sorting alternatives
+within a bucket.
+Each bucket acts as a stack, with the alternatives
+ending at the lowest numbered earleme on top of the stack.
+This allows alternatives to be popped off the stack as the
+earlemes are processed in numerical order.
+@ So that the bucket can act as a stack,
+the end earleme of the alternatives must be the major key,
+and must sort in reverse order.
+Of the remaining two keys,
+the more minor key is the start earleme, because that way its slightly
+costlier evaluation can sometimes be avoided.
+@<Function definitions@> =
+PRIVATE int alternative_cmp(const ALT_Const a, const ALT_Const b)
+{
+     int subkey = End_Earleme_of_ALT(b) - End_Earleme_of_ALT(a);
+     if (subkey) return subkey;
+     subkey = NSYID_of_ALT(a) - NSYID_of_ALT(b);
+     if (subkey) return subkey;
+     return Start_Earleme_of_ALT(a) - Start_Earleme_of_ALT(b);
+}
+
+@ This function returns the top alternative of the bucket
+for |earleme|,
+if it ends at |earleme|.
+Otherwise it returns |NULL|.
+@<Function definitions@> =
+PRIVATE ALT alternative_top(RECCE r, JEARLEME earleme)
+{
+  const MARPA_DSTACK bucket = ALT_Bucket_of_R(r, earleme);
+  const ALT top_of_bucket = MARPA_DSTACK_TOP (*bucket, ALT_Object);
+  if (!top_of_bucket) return NULL;
+  if (earleme != End_Earleme_of_ALT (top_of_bucket)) return NULL;
+  return top_of_bucket;
+}
+
+@ This function pops an alternative from the bucket for |earleme|,
+if it matches
+the earleme argument.
+If no alternative has its end earleme at the
+earleme argument, |NULL| is returned.
+The data pointed to by the return value may be overwritten when
+new alternatives are added, so it must be used before the next
+call that adds data to the alternatives.
+@<Function definitions@> =
+PRIVATE ALT alternative_pop(RECCE r, JEARLEME earleme)
+{
+  const MARPA_DSTACK bucket = ALT_Bucket_of_R(r, earleme);
+  if (!alternative_top(r, earleme)) return NULL;
+  ALT_Count_of_R(r)--;
+  return MARPA_DSTACK_POP (*bucket, ALT_Object);
+}
+
+@ This function inserts an alternative into its bucket,
+in sorted order,
+if the alternative is not a duplicate.
+It returns -1 if the alternative is a duplicate,
+and the insertion point (which must be zero or more) otherwise.
+Only the alternatives in the same bucket
+are shifted.
+@<Function definitions@> =
+PRIVATE int alternative_insert(RECCE r, ALT new_alternative)
+{
+  ALT end_of_stack, base_of_stack;
+  const MARPA_DSTACK bucket =
+    ALT_Bucket_of_R(r, End_Earleme_of_ALT(new_alternative));
+  int ix;
+  int insertion_point = alternative_insertion_point (bucket, new_alternative);
+  if (insertion_point < 0)
+    return insertion_point;
+  if (_MARPA_UNLIKELY
+      (MARPA_DSTACK_LENGTH (*bucket) >= MARPA_DSTACK_CAPACITY (*bucket)))
+    {
+      alternative_bucket_grow (r, bucket);
+    }
+  end_of_stack = MARPA_DSTACK_PUSH(*bucket, ALT_Object);
+  base_of_stack = MARPA_DSTACK_BASE(*bucket, ALT_Object);
+   for (ix = end_of_stack-base_of_stack; ix > insertion_point; ix--) {
+       base_of_stack[ix] = base_of_stack[ix-1];
+   }
+   base_of_stack[insertion_point] = *new_alternative;
+   ALT_Count_of_R(r)++;
+   return insertion_point;
+}
+
+@** Starting recognizer input.
+@<Function definitions@> = int marpa_r_start_input(Marpa_Recognizer r)
+{
+    int return_value = 1;
+    YS set0;
+    YIK_Object key;
+
+    IRL start_irl;
+    AHM start_ahm;
+
+  @<Unpack recognizer objects@>@;
+  @<Return |-2| on failure@>@;
+
+  @<Fail if recognizer started@>@;
+  {
+    @<Declare |marpa_r_start_input| locals@>@;
+    Current_Earleme_of_R(r) = 0;
+    @<Set up terminal-related boolean vectors@>@;
+    R_EVENTS_CLEAR(r);
+
+    set0 = earley_set_new(r, 0);
+    Latest_YS_of_R(r) = set0;
+    First_YS_of_R(r) = set0;
+
+    if (G_is_Trivial(g)) {
+        return_value += trigger_trivial_events(r);
+        @<Set |r| exhausted@>@;
+        goto CLEANUP;
+    }
+    Input_Phase_of_R(r) = R_DURING_INPUT;
+    psar_reset(Dot_PSAR_of_R(r));
+    @<Allocate recognizer containers@>@;
+    @<Initialize Earley item work stacks@>@;
+
+    start_irl = g->t_start_irl;
+    start_ahm = First_AHM_of_IRL(start_irl);
+
+    @t}\comment{@>
+    /* These will stay constant in every YIM added in this method */
+    key.t_origin = set0;
+    key.t_set = set0;
+
+    key.t_ahm = start_ahm;
+    earley_item_create(r, key);
+
+    bv_clear (r->t_bv_irl_seen);
+    bv_bit_set (r->t_bv_irl_seen, ID_of_IRL(start_irl));
+    MARPA_DSTACK_CLEAR(r->t_irl_cil_stack);
+    *MARPA_DSTACK_PUSH(r->t_irl_cil_stack, CIL) = LHS_CIL_of_AHM(start_ahm);
+
+    while (1)
+      {
+        const CIL* const p_cil = MARPA_DSTACK_POP (r->t_irl_cil_stack, CIL);
+        if (!p_cil)
+          break;
+        {
+          int cil_ix;
+          const CIL this_cil = *p_cil;
+          const int prediction_count = Count_of_CIL (this_cil);
+          for (cil_ix = 0; cil_ix < prediction_count; cil_ix++)
+            {
+              const IRLID prediction_irlid = Item_of_CIL (this_cil, cil_ix);
+              if (!bv_bit_test_then_set (r->t_bv_irl_seen, prediction_irlid))
+                {
+                  const IRL prediction_irl = IRL_by_ID (prediction_irlid);
+                  const AHM prediction_ahm = First_AHM_of_IRL (prediction_irl);
+                  @t}\comment{@>
+                  /* If any of the assertions fail, do not add this AHM to
+                  the YS, or look at anything predicted by it. */
+                  if (!evaluate_zwas(r, 0, prediction_ahm)) continue;
+                  key.t_ahm = prediction_ahm;
+                  earley_item_create (r, key);
+                  *MARPA_DSTACK_PUSH(r->t_irl_cil_stack, CIL)
+                    = LHS_CIL_of_AHM(prediction_ahm);
+                }
+            }
+        }
+      }
+
+    postdot_items_create(r, set0);
+    earley_set_update_items(r, set0);
+    ys_segment_open(r);
+    r->t_is_using_leo = r->t_use_leo_flag;
+    trigger_events(r);
+    CLEANUP: ;
+  }
+  return return_value;
+}
+
+@ @<Function definitions@> =
+PRIVATE
+int evaluate_zwas(RECCE r, YSID ysid, AHM ahm)
+{
+  int cil_ix;
+  const CIL zwa_cil = ZWA_CIL_of_AHM(ahm);
+  const int cil_count = Count_of_CIL (zwa_cil);
+  for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
+  {
+     int value;
+     const ZWAID zwaid = Item_of_CIL (zwa_cil, cil_ix);
+     const ZWA zwa = RZWA_by_ID(zwaid);
+      @t}\comment{@>
+      /* Use the memoized value, if it is for this YS */
+     MARPA_OFF_DEBUG3("At %s, evaluating assertion %ld", STRLOC, (long)zwaid);
+     if (Memo_YSID_of_ZWA(zwa) == ysid) {
+         if (Memo_Value_of_ZWA(zwa)) continue;
+         MARPA_OFF_DEBUG3("At %s: returning 0 for assertion %ld", STRLOC, (long)zwaid);
+         return 0;
+     }
+
+      @t}\comment{@>
+      /* Calculate the value (currently always the default)
+      and memoize it */
+     value = Memo_Value_of_ZWA(zwa) = Default_Value_of_ZWA(zwa);
+     Memo_YSID_of_ZWA(zwa) = ysid;
+
+      @t}\comment{@>
+      /* If the assertion fails we are done
+      Otherwise, continue to check assertions.
+      */
+     if (!value) {
+       MARPA_OFF_DEBUG3("At %s: returning 0 for assertion %ld", STRLOC, (long)zwaid);
+       return 0;
+     }
+
+     MARPA_OFF_DEBUG3("At %s: value is 1 for assertion %ld", STRLOC, (long)zwaid);
+  }
+  return 1;
+}
+
+
+@ @<Declare |marpa_r_start_input| locals@> =
+    const NSYID nsy_count = NSY_Count_of_G(g);
+    const NSYID xsy_count = XSY_Count_of_G(g);
+
+@** Read a token alternative.
+The ordinary semantics of a parser generator is a token-stream
+semantics.
+The input is a sequence of $n$ tokens.
+Every token is of length 1.
+The tokens fill the locations from 0 to $n-1$.
+The first token goes into location 0,
+the next into location 1,
+and so on up to location $n-1$.
+@ In Marpa terms, a token-stream
+corresponds to reading exactly one token alternative at every location.
+In Marpa, the input locations are also called earlemes.
+@ Marpa allows other models of the input besides the token stream model.
+Tokens may be ambiguous -- that is, more than one token may occur
+at any location.
+Tokens vary in length -- tokens may be of any length greater than
+or equal to one.
+This means tokens can span multiple earlemes.
+As a consequence,
+there may be no tokens at some earlemes.
+@*0 Boolean vectors to track terminals.
+A number of boolean vectors are used to track
+the valued status of terminal symbols.
+Whether a symbol is a terminal or not cannot
+be changed by the recognizer,
+but some symbols are ``value unlocked'' and
+will be set to valued or unvalued the first
+time they are encountered.
+@<Widely aligned recognizer elements@> =
+  LBV t_valued_terminal;
+  LBV t_unvalued_terminal;
+  LBV t_valued;
+  LBV t_unvalued;
+  LBV t_valued_locked;
+
+@ @<Set up terminal-related boolean vectors@> =
+{
+  XSYID xsy_id;
+  r->t_valued_terminal = lbv_obs_new0 (r->t_obs, xsy_count);
+  r->t_unvalued_terminal = lbv_obs_new0 (r->t_obs, xsy_count);
+  r->t_valued = lbv_obs_new0 (r->t_obs, xsy_count);
+  r->t_unvalued = lbv_obs_new0 (r->t_obs, xsy_count);
+  r->t_valued_locked = lbv_obs_new0 (r->t_obs, xsy_count);
+  for (xsy_id = 0; xsy_id < xsy_count; xsy_id++)
+    {
+      const XSY xsy = XSY_by_ID (xsy_id);
+      if (XSY_is_Valued_Locked (xsy))
+        {
+          lbv_bit_set (r->t_valued_locked, xsy_id);
+        }
+      if (XSY_is_Valued (xsy))
+        {
+          lbv_bit_set (r->t_valued, xsy_id);
+          if (XSY_is_Terminal (xsy))
+            {
+              lbv_bit_set (r->t_valued_terminal, xsy_id);
+            }
+        }
+      else
+        {
+          lbv_bit_set (r->t_unvalued, xsy_id);
+          if (XSY_is_Terminal (xsy))
+            {
+              lbv_bit_set (r->t_unvalued_terminal, xsy_id);
+            }
+        }
+    }
+}
+
+@ |marpa_r_alternative|, by enforcing a limit on token length and on
+the furthest location, indirectly enforces a limit on the
+number of earley sets and the maximum earleme location.
+If tokens ending at location $n$ cannot be scanned, then clearly
+the parse can
+never reach location $n$.
+@<Function definitions@> =
+Marpa_Earleme marpa_r_alternative(
+    Marpa_Recognizer r,
+    Marpa_Symbol_ID tkn_xsy_id,
+    int value,
+    int length)
+{
+    @<Fail if recognizer cannot read alternatives@>@;
+    return alternative_read(r, tkn_xsy_id, value, length, 0);
+}
+
+@ These checks depend only on the state of the recognizer,
+and not on the token,
+so that they only need to be done once for a batch
+of alternatives.
+@<Fail if recognizer cannot read alternatives@> =
+    if (_MARPA_UNLIKELY (!R_is_Consistent (r)))
+      {
+        MARPA_R_ERROR (MARPA_ERR_RECCE_IS_INCONSISTENT);
+        return MARPA_ERR_RECCE_IS_INCONSISTENT;
+      }
+    if (_MARPA_UNLIKELY (Input_Phase_of_R (r) != R_DURING_INPUT))
+      {
+        MARPA_R_ERROR (MARPA_ERR_RECCE_NOT_ACCEPTING_INPUT);
+        return MARPA_ERR_RECCE_NOT_ACCEPTING_INPUT;
+      }
+    if (_MARPA_UNLIKELY (R_is_Over_Budget (r)))
+      {
+        MARPA_R_ERROR (MARPA_ERR_MEMORY_BUDGET_EXCEEDED);
+        return MARPA_ERR_MEMORY_BUDGET_EXCEEDED;
+      }
+
+@ The same checks, for a caller whose failure return value
+is not an error code.
+Returns |MARPA_ERR_NONE| if the recognizer can read alternatives.
+Otherwise, sets the error and returns its code.
+@<Function definitions@> =
+PRIVATE int
+alternatives_read_check(RECCE r)
+{
+    @<Fail if recognizer cannot read alternatives@>@;
+    return MARPA_ERR_NONE;
+}
+
+@ Read one alternative,
+once the recognizer has been checked.
+On success, returns |MARPA_ERR_NONE|.
+On failure, sets the error and returns its code.
+An unexpected token is not an error if |MARPA_READ_SKIP_UNEXPECTED|
+is set in |flags|,
+and |MARPA_ERR_UNEXPECTED_TOKEN_ID| is returned
+without setting the error.
+@<Function definitions@> =
+PRIVATE int
+alternative_read(RECCE r,
+    XSYID tkn_xsy_id,
+    int value,
+    int length,
+    int flags)
+{
+    @<Unpack recognizer objects@>@;
+    YS current_earley_set;
+    const JEARLEME current_earleme = Current_Earleme_of_R (r);
+    JEARLEME target_earleme;
+    NSYID tkn_nsyid;
+    if (_MARPA_UNLIKELY (XSYID_is_Malformed(tkn_xsy_id)))
+      {
+        MARPA_R_ERROR (MARPA_ERR_INVALID_SYMBOL_ID);
+        return MARPA_ERR_INVALID_SYMBOL_ID;
+      }
+    if (_MARPA_UNLIKELY (!XSYID_of_G_Exists(tkn_xsy_id)))
+      {
+        MARPA_R_ERROR (MARPA_ERR_NO_SUCH_SYMBOL_ID);
+        return MARPA_ERR_NO_SUCH_SYMBOL_ID;
+      }
+    @<|marpa_alternative| initial check for failure conditions@>@;
+    @<Set |current_earley_set|, failing if token is unexpected@>@;
+    @<Set |target_earleme| or fail@>@;
+    @<Insert alternative into stack, failing if token is duplicate@>@;
+    return MARPA_ERR_NONE;
+}
+
+@*0 Reading a batch of alternatives.
+|marpa_r_alternatives_read| reads an array of alternatives,
+all starting at the current earleme,
+and optionally completes the earleme.
+It is equivalent to a series of calls to |marpa_r_alternative|,
+but checks the recognizer only once,
+so that an application, or a wrapper,
+can cross into Libmarpa once per earleme, instead of once
+per token.
+@<Public defines@> =
+#define MARPA_READ_COMPLETE_EARLEME @| @[0x1@]@/
+#define MARPA_READ_SKIP_UNEXPECTED @| @[0x2@]@/
+@ @<Public structures@> =
+struct marpa_alternative {
+     Marpa_Symbol_ID t_token_id;
+     int t_value;
+     int t_length;
 };
+typedef struct marpa_alternative Marpa_Alternative;
+
+@ Alternatives are read in order.
+If |MARPA_READ_SKIP_UNEXPECTED| is set,
+alternatives which fail with |MARPA_ERR_UNEXPECTED_TOKEN_ID|
+are skipped.
+A skipped alternative is not an error, and the error code is left as is.
+The number of alternatives skipped is |count| less the return value.
+Any other failure stops the read,
+leaving the alternatives already read in place,
+just as a failed call to |marpa_r_alternative| would.
+If |MARPA_READ_COMPLETE_EARLEME| is set,
+and all the alternatives were read or skipped,
+the earleme is then completed.
+On success, the number of alternatives accepted is returned.
+@<Function definitions@> =
+int marpa_r_alternatives_read(
+    Marpa_Recognizer r,
+    const Marpa_Alternative* alternatives,
+    int count,
+    int flags)
+{
+    @<Return |-2| on failure@>@;
+    int alternative_ix;
+    int accepted_count = 0;
+    if (_MARPA_UNLIKELY (alternatives_read_check (r) != MARPA_ERR_NONE))
+      return failure_indicator;
+    if (_MARPA_UNLIKELY (count > 0 && !alternatives))
+      {
+        MARPA_R_ERROR (MARPA_ERR_POINTER_ARG_NULL);
+        return failure_indicator;
+      }
+    for (alternative_ix = 0; alternative_ix < count; alternative_ix++)
+      {
+        const Marpa_Alternative *const alternative =
+          alternatives + alternative_ix;
+        const int error_code = alternative_read (r, alternative->t_token_id,
+                                                 alternative->t_value,
+                                                 alternative->t_length,
+                                                 flags);
+        if (_MARPA_LIKELY (error_code == MARPA_ERR_NONE))
+          {
+            accepted_count++;
+            continue;
+          }
+        if (error_code == MARPA_ERR_UNEXPECTED_TOKEN_ID
+            && (flags & MARPA_READ_SKIP_UNEXPECTED))
+          continue;
+        return failure_indicator;
+      }
+    if (flags & MARPA_READ_COMPLETE_EARLEME)
+      {
+        if (marpa_r_earleme_complete (r) < 0)
+          return failure_indicator;
+      }
+    return accepted_count;
+}
+
+@ @<|marpa_alternative| initial check for failure conditions@> = {
+    const XSY_Const tkn = XSY_by_ID(tkn_xsy_id);
+    if (length <= 0) {
+        MARPA_R_ERROR(MARPA_ERR_TOKEN_LENGTH_LE_ZERO);
+        return MARPA_ERR_TOKEN_LENGTH_LE_ZERO;
+    }
+    if (length >= JEARLEME_THRESHOLD) {
+        MARPA_R_ERROR(MARPA_ERR_TOKEN_TOO_LONG);
+        return MARPA_ERR_TOKEN_TOO_LONG;
+    }
+    if (value && _MARPA_UNLIKELY(!lbv_bit_test(r->t_valued_terminal, tkn_xsy_id)))
+    {
+      if (!XSY_is_Terminal(tkn)) {
+          MARPA_R_ERROR(MARPA_ERR_TOKEN_IS_NOT_TERMINAL);
+          return MARPA_ERR_TOKEN_IS_NOT_TERMINAL;
+      }
+      if (lbv_bit_test(r->t_valued_locked, tkn_xsy_id)) {
+          MARPA_R_ERROR(MARPA_ERR_SYMBOL_VALUED_CONFLICT);
+          return MARPA_ERR_SYMBOL_VALUED_CONFLICT;
+      }
+      lbv_bit_set(r->t_valued_locked, tkn_xsy_id);
+      lbv_bit_set(r->t_valued_terminal, tkn_xsy_id);
+      lbv_bit_set(r->t_valued, tkn_xsy_id);
+    }
+    if (!value && _MARPA_UNLIKELY(!lbv_bit_test(r->t_unvalued_terminal, tkn_xsy_id)))
+    {
+      if (!XSY_is_Terminal(tkn)) {
+          MARPA_R_ERROR(MARPA_ERR_TOKEN_IS_NOT_TERMINAL);
+          return MARPA_ERR_TOKEN_IS_NOT_TERMINAL;
+      }
+      if (lbv_bit_test(r->t_valued_locked, tkn_xsy_id)) {
+          MARPA_R_ERROR(MARPA_ERR_SYMBOL_VALUED_CONFLICT);
+          return MARPA_ERR_SYMBOL_VALUED_CONFLICT;
+      }
+      lbv_bit_set(r->t_valued_locked, tkn_xsy_id);
+      lbv_bit_set(r->t_unvalued_terminal, tkn_xsy_id);
+      lbv_bit_set(r->t_unvalued, tkn_xsy_id);
+    }
+}
+
+@ @<Set |target_earleme| or fail@> = {
+    target_earleme = current_earleme + length;
+    if (target_earleme >= JEARLEME_THRESHOLD) {
+        MARPA_R_ERROR(MARPA_ERR_PARSE_TOO_LONG);
+        return MARPA_ERR_PARSE_TOO_LONG;
+    }
+}
+
+@ If no postdot item is found at the current Earley set for this
+item, the token ID is unexpected, and |soft_failure| is returned.
+The application can treat this as a fatal error.
+The application can also use this as a mechanism to test alternatives,
+in which case, returning |soft_failure| is a perfectly normal data path.
+This last is part of an important technique:
+``Ruby Slippers" parsing.
+@ Another case of an ``unexpected'' token is an inaccessible one.
+(A terminal must be productive but can be inaccessible.)
+Inaccessible tokens will not have an NSY and,
+since they don't derive from the start symbol,
+are always unexpected.
+@<Set |current_earley_set|, failing if token is unexpected@> =
+{
+  NSY tkn_nsy = NSY_by_XSYID (tkn_xsy_id);
+  if (_MARPA_UNLIKELY (!tkn_nsy))
+    {
+      MARPA_R_ERROR (MARPA_ERR_INACCESSIBLE_TOKEN);
+      return MARPA_ERR_INACCESSIBLE_TOKEN;
+    }
+  tkn_nsyid = ID_of_NSY (tkn_nsy);
+  current_earley_set = YS_at_Current_Earleme_of_R (r);
+  if (!current_earley_set)
+    {
+      MARPA_R_ERROR (MARPA_ERR_NO_TOKEN_EXPECTED_HERE);
+      return MARPA_ERR_NO_TOKEN_EXPECTED_HERE;
+    }
+  if (!First_PIM_of_YS_by_NSYID (current_earley_set, tkn_nsyid))
+    {
+      if (!(flags & MARPA_READ_SKIP_UNEXPECTED))
+        MARPA_R_ERROR (MARPA_ERR_UNEXPECTED_TOKEN_ID);
+      return MARPA_ERR_UNEXPECTED_TOKEN_ID;
+    }
+}
+
+@ Insert an alternative into the alternatives stack,
+detecting if we are attempting to add the same token twice.
+Two tokens are considered the same if
+\li they have the same token ID, and
+\li they have the same length, and
+\li they have the same origin.
+Because $|origin|+|token_length| = |current_earleme|$,
+Two tokens at the same current earleme are the same if they
+have the same token ID and origin.
+By the same equation,
+two tokens at the same current earleme are the same if they
+have the same token ID and token length.
+It is up to the higher layers to determine if rejection
+of a duplicate token is a fatal error.
+The Earley sets and items will not have been
+altered by the attempt.
+@<Insert alternative into stack, failing if token is duplicate@> =
+{
+  ALT_Object alternative_object; /* This is safe on the stack,
+  because |alternative_insert()| will copy it if it is actually
+  going to be used */
+  const ALT alternative = &alternative_object;
+  NSYID_of_ALT (alternative) = tkn_nsyid;
+  Value_of_ALT (alternative) = value;
+  ALT_is_Valued(alternative) = value ? 1 : 0;
+  if (Furthest_Earleme_of_R (r) < target_earleme)
+    Furthest_Earleme_of_R (r) = target_earleme;
+  alternative->t_start_earley_set = current_earley_set;
+  End_Earleme_of_ALT(alternative) = target_earleme;
+  if (alternative_insert (r, alternative) < 0)
+    {
+      MARPA_R_ERROR (MARPA_ERR_DUPLICATE_TOKEN);
+      return MARPA_ERR_DUPLICATE_TOKEN;
+    }
+}
+
+@** Complete an Earley set.
+In the Aycock-Horspool variation of Earley's algorithm,
+the two main phases are scanning and completion.
+This section is devoted to the logic for completion.
+@d Work_YIMs_of_R(r) MARPA_DSTACK_BASE((r)->t_yim_work_stack, YIM)
+@d Work_YIM_Count_of_R(r) MARPA_DSTACK_LENGTH((r)->t_yim_work_stack)
+@d WORK_YIMS_CLEAR(r) MARPA_DSTACK_CLEAR((r)->t_yim_work_stack)
+@d WORK_YIM_PUSH(r) MARPA_DSTACK_PUSH((r)->t_yim_work_stack, YIM)
+@d WORK_YIM_ITEM(r, ix) (*MARPA_DSTACK_INDEX((r)->t_yim_work_stack, YIM, ix))
+@<Widely aligned recognizer elements@> = MARPA_DSTACK_DECLARE(t_yim_work_stack);
+@ @<Initialize recognizer elements@> = MARPA_DSTACK_SAFE(r->t_yim_work_stack);
+@ @<Initialize Earley item work stacks@> =
+{
+  if (!MARPA_DSTACK_IS_INITIALIZED (r->t_yim_work_stack))
+    {
+      MARPA_DSTACK_INIT2 (r->t_yim_work_stack, YIM);
+    }
+}
+@ @<Destroy recognizer elements@> = MARPA_DSTACK_DESTROY(r->t_yim_work_stack);
+
+@ The completion stack is initialized to a very high-ball estimate of the
+number of completions per Earley set.
+It will grow if needed.
+Large stacks may needed for very ambiguous grammars.
+@<Widely aligned recognizer elements@> = MARPA_DSTACK_DECLARE(t_completion_stack);
+@ @<Initialize recognizer elements@> = MARPA_DSTACK_SAFE(r->t_completion_stack);
+@ @<Initialize Earley item work stacks@> =
+{
+  if (!MARPA_DSTACK_IS_INITIALIZED (r->t_completion_stack))
+    {
+      MARPA_DSTACK_INIT2 (r->t_completion_stack, YIM);
+    }
+}
+@ @<Destroy recognizer elements@> = MARPA_DSTACK_DESTROY(r->t_completion_stack);
+
+@ @<Widely aligned recognizer elements@> = MARPA_DSTACK_DECLARE(t_earley_set_stack);
+@ @<Initialize recognizer elements@> = MARPA_DSTACK_SAFE(r->t_earley_set_stack);
+@ @<Destroy recognizer elements@> = MARPA_DSTACK_DESTROY(r->t_earley_set_stack);
+
+@ This function returns the number of terminals expected on success.
+On failure, it returns |-2|.
+If the completion of the earleme left the parse exhausted, 0 is
+returned.
+@
+If the completion of the earleme left the parse exhausted, 0 is returned.
+The converse is not true -- when tokens may be longer than one earleme,
+zero may be returned even if the parse is not exhausted.
+In those alternative input models, it is possible that no terminals are
+expected at the current earleme, but other terminals might be expected
+at later earlemes.
+That means that the parse can be continued ---
+it is not exhausted.
+In those alternative input models,
+if the distinction between zero terminals expected and an
+exhausted parse is significant to the higher layers,
+they must explicitly check the phase whenever this function
+returns zero.
+@<Function definitions@> =
+int
+marpa_r_earleme_complete(Marpa_Recognizer r)
+{
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  YIM* cause_p;
+  YS current_earley_set;
+  JEARLEME current_earleme;
+
+    @t}\comment{@>
+  /* Initialized to -2 just in case.
+    Should be set before returning;
+   */
+  JEARLEME return_value = -2;
+
+  @<Fail if recognizer not accepting input@>@;
+  if (_MARPA_UNLIKELY(!R_is_Consistent(r))) {
+      MARPA_R_ERROR(MARPA_ERR_RECCE_IS_INCONSISTENT);
+      return failure_indicator;
+  }
+  @<Fail if recognizer memory budget exceeded@>@;
+
+  {
+    int count_of_expected_terminals;
+    R_EVENTS_CLEAR(r);
+    psar_dealloc(Dot_PSAR_of_R(r));
+    bv_clear (r->t_bv_nsyid_is_expected);
+    bv_clear (r->t_bv_irl_seen);
+    @<Initialize |current_earleme|@>@;
+    @<Return 0 if no alternatives@>@;
+    @<Initialize |current_earley_set|@>@;
+    @<Scan from the alternative stack@>@;
+    @<Pre-populate the completion stack@>@;
+    while ((cause_p = MARPA_DSTACK_POP(r->t_completion_stack, YIM))) {
+      YIM cause = *cause_p;
+        @<Add new Earley items for |cause|@>@;
+    }
+    @<Add predictions to |current_earley_set|@>@;
+    postdot_items_create(r, current_earley_set);
+
+    @t}\comment{@>
+      /* If no terminals are expected, and there are no Earley items in
+           uncompleted Earley sets, we can make no further progress.
+           The parse is ``exhausted". */
+    count_of_expected_terminals = bv_count (r->t_bv_nsyid_is_expected);
+    if (count_of_expected_terminals <= 0
+       && ALT_Count_of_R(r) <= 0)
+      {
+        @<Set |r| exhausted@>@;
+      }
+    earley_set_update_items(r, current_earley_set);
+    if (r->t_active_event_count > 0) {
+        trigger_events(r);
+    }
+    return_value = R_EVENT_COUNT(r);
+    CLEANUP: ;
+  }
+  return return_value;
+}
+
+@ |marpa_r_earleme_complete| is called once per earleme,
+which for a character-per-token lexer means once for
+every character of input.
+It therefore does no allocation of its own ---
+its scratch space is kept in the recognizer.
+@<Initialize |current_earleme|@> = {
+  current_earleme = ++(Current_Earleme_of_R(r));
+  if (current_earleme > Furthest_Earleme_of_R (r))
+    {
+        @<Set |r| exhausted@>@;
+        MARPA_R_ERROR(MARPA_ERR_PARSE_EXHAUSTED);
+        return_value = failure_indicator;
+        goto CLEANUP;
+     }
+}
+
+@ Create a new Earley set.  We know that it does not
+exist.
+@<Initialize |current_earley_set|@> = {
+    current_earley_set = earley_set_new (r, current_earleme);
+    Next_YS_of_YS(Latest_YS_of_R(r)) = current_earley_set;
+    Latest_YS_of_R(r) = current_earley_set;
+}
+
+@ If there are no alternatives for this earleme
+return 0 without creating an
+Earley set.
+The return value means success, with no events.
+@<Return 0 if no alternatives@> = {
+  if (!alternative_top (r, current_earleme))
+    {
+      return_value = 0;
+      goto CLEANUP;
+    }
+}
+
+@ @<Scan from the alternative stack@> =
+{
+  ALT alternative;
+    @t}\comment{@>
+    /* |alternative_pop()| does not return inactive alternatives */
+  while ((alternative = alternative_pop (r, current_earleme)))
+    @<Scan an Earley item from alternative@>@;
+}
+
+@ The consequences of ignoring Leo items here is that a right
+recursion is always fully expanded when the cause of the Leo
+trailhead is a terminal.
+That's usually desireable, because a terminal at the bottom of the
+Leo trail is usually a sign that this is the trail that will be
+used in the parse.
+@ But there are exceptions.  These can occur in input models with
+ambiguous terminals, and when LHS terminals are used.
+These cases are not considered in the complexity claims,
+and as of this writing are not important in practical terms.
+@<Scan an Earley item from alternative@> =
+{
+  YS start_earley_set = Start_YS_of_ALT (alternative);
+  PIM pim = First_PIM_of_YS_by_NSYID (start_earley_set,
+    NSYID_of_ALT(alternative));
+  for (; pim; pim = Next_PIM_of_PIM (pim))
+    {
+      @t}\comment{@>
+      /* Ignore Leo items when scanning */
+      const YIM predecessor = YIM_of_PIM (pim);
+      if (predecessor && YIM_is_Active(predecessor))
+	{
+	  const AHM predecessor_ahm = AHM_of_YIM (predecessor);
+	  const AHM scanned_ahm = Next_AHM_of_AHM (predecessor_ahm);
+	  @<Create the earley items for |scanned_ahm|@>@;
+	}
+    }
+}
+
+@ @<Create the earley items for |scanned_ahm|@> =
+{
+  const YIM scanned_earley_item = earley_item_assign (r,
+						      current_earley_set,
+						      Origin_of_YIM
+						      (predecessor),
+						      scanned_ahm);
+  YIM_was_Scanned(scanned_earley_item) = 1;
+  tkn_link_add (r, scanned_earley_item, predecessor, alternative);
+}
+
+@ At this point we know that only scanned items newly added
+are on the YIM working stack.
+Since they are newly added, and would not have been added
+if they were not active, we know that the YIM's on the working stack
+are all active.
+@<Pre-populate the completion stack@> = {
+    @t}\comment{@>
+    /* We know that no new items are added to the stack in this scope */
+    YIM* work_earley_items = MARPA_DSTACK_BASE (r->t_yim_work_stack, YIM );
+    int no_of_work_earley_items = MARPA_DSTACK_LENGTH (r->t_yim_work_stack );
+    int ix;
+    MARPA_DSTACK_CLEAR(r->t_completion_stack);
+    for (ix = 0;
+         ix < no_of_work_earley_items;
+         ix++) {
+        YIM earley_item = work_earley_items[ix];
+        YIM* end_of_stack;
+        if (!YIM_is_Completion (earley_item))
+          continue;
+        end_of_stack = MARPA_DSTACK_PUSH (r->t_completion_stack, YIM);
+        *end_of_stack = earley_item;
+      }
+    }
+
+@ For the current completion cause,
+add those Earley items it ``causes".
+@<Add new Earley items for |cause|@> =
+{
+  if (YIM_is_Active(cause) && YIM_is_Completion(cause))
+    {
+      NSYID complete_nsyid = LHS_NSYID_of_YIM(cause);
+      const YS middle = Origin_of_YIM (cause);
+      @<Add new Earley items for |complete_nsyid| and |cause|@>@;
+    }
+}
 
-@ {\bf To Do}: @^To Do@>
-There are a lot of these and some tricks to reduce the
-space used can be justified.
-@<Source object structure@>=
-struct s_source {
-     void * t_predecessor;
-     union {
-         void * t_completion;
-         struct s_token_source t_token;
-     } t_cause;
-     BITFIELD t_is_rejected:1;
-     BITFIELD t_is_active:1;
-     /* A type field could go here */
-};
+@ @<Add new Earley items for |complete_nsyid| and |cause|@> =
+{
+  PIM postdot_item;
+  for (postdot_item = First_PIM_of_YS_by_NSYID (middle, complete_nsyid);
+       postdot_item; postdot_item = Next_PIM_of_PIM (postdot_item))
+    {
+      const YIM predecessor = YIM_of_PIM (postdot_item);
+      if (!predecessor) {
+           @t}\comment\hskip 1em{@>
+           /* A Leo item */
+           const LIM leo_item = LIM_of_PIM (postdot_item);
 
-@ @<Private typedefs@> =
-struct s_source_link;
-typedef struct s_source_link* SRCL;
-@ @<Source object structure@>=
-struct s_source_link {
-    SRCL t_next;
-    struct s_source t_source;
-};
-typedef struct s_source_link SRCL_Object;
+           @t}\comment\hskip 1em{@>
+           /* A Leo item */
+           /* If the Leo item is not active, look at the other
+           item in the PIM, which might be active.  (There should be
+           exactly one other item, and it might be active if the LIM
+           was inactive because of its predecessor, but had
+           an active Leo trailhead */
+           if (!LIM_is_Active(leo_item)) goto NEXT_PIM;
 
-@ @<Source object structure@>=
-struct s_ambiguous_source {
-    SRCL t_leo;
-    SRCL t_token;
-    SRCL t_completion;
-};
+           @<Add effect of |leo_item|@>@;
 
-@ @<Source object structure@>=
-union u_source_container {
-    struct s_ambiguous_source t_ambiguous;
-    struct s_source_link t_unique;
-};
+           @t}\comment\hskip 1em{@>
+           /* When I encounter an active Leo item,
+           I skip everything else for this postdot symbol */
+          goto LAST_PIM;
+      } else {
+            @t}\comment\hskip 1em{@>
+            /* Not a Leo item */
+            if (!YIM_is_Active(predecessor)) continue;
 
-@
-@d Source_of_SRCL(link) ((link)->t_source)
-@d SRC_of_SRCL(link) (&Source_of_SRCL(link))
-@d SRCL_of_YIM(yim) (&(yim)->t_container.t_unique)
-@d Source_of_YIM(yim) ((yim)->t_container.t_unique.t_source)
-@d SRC_of_YIM(yim) (&Source_of_YIM(yim))
-@d Predecessor_of_Source(srcd) ((srcd).t_predecessor)
-@d Predecessor_of_SRC(source) Predecessor_of_Source(*(source))
-@d Predecessor_of_YIM(item) Predecessor_of_Source(Source_of_YIM(item))
-@d Predecessor_of_SRCL(link) Predecessor_of_Source(Source_of_SRCL(link))
-@d LIM_of_SRCL(link) ((LIM)Predecessor_of_SRCL(link))
-@d Cause_of_Source(srcd) ((srcd).t_cause.t_completion)
-@d Cause_of_SRC(source) Cause_of_Source(*(source))
-@d Cause_of_YIM(item) Cause_of_Source(Source_of_YIM(item))
-@d Cause_of_SRCL(link) Cause_of_Source(Source_of_SRCL(link))
-@d TOK_of_Source(srcd) ((srcd).t_cause.t_token)
-@d TOK_of_SRC(source) TOK_of_Source(*(source))
-@d TOK_of_YIM(yim) TOK_of_Source(Source_of_YIM(yim))
-@d TOK_of_SRCL(link) TOK_of_Source(Source_of_SRCL(link))
-@d NSYID_of_Source(srcd) ((srcd).t_cause.t_token.t_nsyid)
-@d NSYID_of_SRC(source) NSYID_of_Source(*(source))
-@d NSYID_of_YIM(yim) NSYID_of_Source(Source_of_YIM(yim))
-@d NSYID_of_SRCL(link) NSYID_of_Source(Source_of_SRCL(link))
-@d Value_of_Source(srcd) ((srcd).t_cause.t_token.t_value)
-@d Value_of_SRC(source) Value_of_Source(*(source))
-@d Value_of_SRCL(link) Value_of_Source(Source_of_SRCL(link))
+            @t}\comment\hskip 1em{@>
+            /* If we are here, both cause and predecessor are active */
+            @<Add |effect_ahm| for non-Leo |predecessor|@>@;
+        }
+        NEXT_PIM: ;
+    }
+    LAST_PIM: ;
+}
 
-@d SRC_is_Active(src) ((src)->t_is_active)
-@d SRC_is_Rejected(src) ((src)->t_is_rejected)
-@d SRCL_is_Active(link) ((link)->t_source.t_is_active)
-@d SRCL_is_Rejected(link) ((link)->t_source.t_is_rejected)
+@ @<Add |effect_ahm| for non-Leo |predecessor|@> =
+{
+   const AHM predecessor_ahm = AHM_of_YIM(predecessor);
+   const AHM effect_ahm = Next_AHM_of_AHM(predecessor_ahm);
+   const YS origin = Origin_of_YIM(predecessor);
+   const YIM effect = earley_item_assign(r, current_earley_set,
+        origin, effect_ahm);
+   YIM_was_Fusion(effect) = 1;
+   if (Earley_Item_has_No_Source(effect)) {
+       @t}\comment{@>
+       /* If it has no source, then it is new */
+       if (YIM_is_Completion(effect)) {
+           @<Push |effect| onto completion stack@>@;
+       }
+   }
+   completion_link_add(r, effect, predecessor, cause);
+}
 
-@ @d Cause_AHMID_of_SRCL(srcl)
-    AHMID_of_YIM((YIM)Cause_of_SRCL(srcl))
-@d Leo_Transition_NSYID_of_SRCL(leo_source_link)
-    Postdot_NSYID_of_LIM(LIM_of_SRCL(leo_source_link))
+@ The context must make sure any YIM pushed on the stack is
+active.
+@<Push |effect| onto completion stack@> = {
+    YIM* end_of_stack = MARPA_DSTACK_PUSH (r->t_completion_stack, YIM);
+    *end_of_stack = effect;
+}
 
-@ Macros for setting and finding the first |SRCL|'s of each type.
-@d LV_First_Completion_SRCL_of_YIM(item) ((item)->t_container.t_ambiguous.t_completion)
-@d First_Completion_SRCL_of_YIM(item)
-  ( Source_Type_of_YIM(item) == SOURCE_IS_COMPLETION ? (SRCL)SRCL_of_YIM(item) :
-  Source_Type_of_YIM(item) == SOURCE_IS_AMBIGUOUS ?
-    LV_First_Completion_SRCL_of_YIM(item) : NULL)
+@ If we are here, |leo_item| is active.
+@<Add effect of |leo_item|@> = {
+    const YS origin = Origin_of_LIM (leo_item);
+    const AHM effect_ahm = Top_AHM_of_LIM (leo_item);
+    const YIM effect = earley_item_assign (r, current_earley_set,
+                                 origin, effect_ahm);
+    YIM_was_Fusion(effect) = 1;
+    if (Earley_Item_has_No_Source (effect))
+      {
+        @t}\comment{@>
+        /* If it has no source, then it is new */
+        @<Push |effect| onto completion stack@>@;
+      }
+    leo_link_add (r, effect, leo_item, cause);
+}
 
-@d LV_First_Token_SRCL_of_YIM(item) ((item)->t_container.t_ambiguous.t_token)
-@d First_Token_SRCL_of_YIM(item)
-  ( Source_Type_of_YIM(item) == SOURCE_IS_TOKEN ? (SRCL)SRCL_of_YIM(item) :
-  Source_Type_of_YIM(item) == SOURCE_IS_AMBIGUOUS ?
-    LV_First_Token_SRCL_of_YIM(item) : NULL)
+@ @<Add predictions to |current_earley_set|@> =
+{
+  if (r->t_use_prediction_memo)
+    @<Add predictions to |current_earley_set| from the prediction memo@>@;
+  else
+    @<Add predictions to |current_earley_set| item by item@>@;
+}
 
-@d LV_First_Leo_SRCL_of_YIM(item) ((item)->t_container.t_ambiguous.t_leo)
-@d First_Leo_SRCL_of_YIM(item)
-  ( Source_Type_of_YIM(item) == SOURCE_IS_LEO ? (SRCL)SRCL_of_YIM(item) :
-  Source_Type_of_YIM(item) == SOURCE_IS_AMBIGUOUS ?
-    LV_First_Leo_SRCL_of_YIM(item) : NULL)
+@ @<Add predictions to |current_earley_set| item by item@> =
+{
+  int ix;
+  const int no_of_work_earley_items =
+    MARPA_DSTACK_LENGTH (r->t_yim_work_stack);
+  for (ix = 0; ix < no_of_work_earley_items; ix++)
+    {
+      YIM earley_item = WORK_YIM_ITEM (r, ix);
 
-@ Creates unique (that is, not ambiguous) SRCL's.
+      int cil_ix;
+      const AHM ahm = AHM_of_YIM (earley_item);
+      const CIL prediction_cil = Predicted_IRL_CIL_of_AHM (ahm);
+      const int prediction_count = Count_of_CIL (prediction_cil);
+      for (cil_ix = 0; cil_ix < prediction_count; cil_ix++)
+	{
+	  const IRLID prediction_irlid = Item_of_CIL (prediction_cil, cil_ix);
+	  const IRL prediction_irl = IRL_by_ID (prediction_irlid);
+	  const AHM prediction_ahm = First_AHM_of_IRL (prediction_irl);
+	  earley_item_assign (r, current_earley_set, current_earley_set,
+			      prediction_ahm);
+	}
+
+    }
+}
+
+@*1 The prediction memo.
+The predictions in an Earley set are determined by
+the set of AHMs in it which predict.
+In practical grammars,
+the same sets of predicting AHMs recur
+from one Earley set to the next,
+much as the same states recur in an LR(0) automaton.
+The prediction memo remembers, for every set of predicting AHMs
+seen so far,
+the union of the IRLs that they predict.
+When the set of predicting AHMs has been seen before,
+the predictions are added to the Earley set in a single pass,
+without the duplicates that the item-by-item method must
+find and discard through the PSL.
+@ Both the key and the predictions of a memo entry are kept
+as CILs in the recognizer's CILAR.
+The key is the sorted list of the IDs of the predicting AHMs,
+and the predictions are the sorted list of predicted IRL IDs.
+@d Key_of_PMEMO(pmemo) ((pmemo)->t_key)
+@d Predictions_of_PMEMO(pmemo) ((pmemo)->t_predictions)
+@<Private structures@> =
+struct s_prediction_memo {
+    CIL t_key;
+    CIL t_predictions;
+};
+typedef struct s_prediction_memo PMEMO_Object;
+@ @<Private incomplete structures@> =
+struct s_prediction_memo;
+@ @s PMEMO int
+@<Private typedefs@> =
+typedef struct s_prediction_memo* PMEMO;
+typedef const struct s_prediction_memo* PMEMO_Const;
+
+@ The memo tree and its boolean vectors are created
+the first time they are needed.
+The vector by AHM ID is kept all clear between Earley sets.
+Only the bits of the AHMs in the key are set while it is built,
+and they are cleared afterwards,
+so that the cost is proportional to the number of Earley items,
+and not to the size of the grammar.
+The vector by IRL ID is used only on a miss.
+@<Widely aligned recognizer elements@> =
+  MARPA_AVL_TREE t_prediction_memo_tree;
+  Bit_Vector t_bv_ahm_predicts;
+  Bit_Vector t_bv_irl_predicted;
+@ @<Initialize recognizer elements@> =
+  r->t_prediction_memo_tree = NULL;
+  r->t_bv_ahm_predicts = NULL;
+  r->t_bv_irl_predicted = NULL;
+@ @<Destroy recognizer elements@> =
+  if (r->t_prediction_memo_tree)
+    _marpa_avl_destroy (r->t_prediction_memo_tree);
+
+@ Whether the recognizer uses the prediction memo is controlled
+by a flag, which can only be changed before input starts.
+By default, the flag is off.
+It does not pay off everywhere.
+With |test/bench/predict_bench.c|, in earlemes per second,
+item by item versus with the memo,
+10 levels: 236825 versus 260211;
+50 levels, the default: 56918 versus 59231;
+200 levels: 18292 versus 16877.
+At 50 levels, the difference between runs is as large as the
+difference between the two.
+The memo is worth turning on when the Earley sets are small,
+and the same few AHMs predict in many of them.
+When the Earley sets are large, the cost of the Earley items
+themselves swamps what the memo saves.
+The predictions are added to each Earley set in order by IRL ID,
+instead of in the order in which they are found,
+so that while the Earley sets are the same,
+the order of the Earley items in them is not.
+@<Bit aligned recognizer elements@> =
+BITFIELD t_use_prediction_memo:1;
+@ @<Initialize recognizer elements@> =
+r->t_use_prediction_memo = 0;
+@ Returns 1 if the ``use prediction memo" flag is set,
+0 if not,
+and |-2| if there was an error.
 @<Function definitions@> =
-PRIVATE
-SRCL unique_srcl_new( struct marpa_obstack* t_obs)
+int _marpa_r_is_use_prediction_memo(Marpa_Recognizer  r)
 {
-  const SRCL new_srcl = marpa_obs_new (t_obs, SRCL_Object, 1);
-  SRCL_is_Rejected(new_srcl) = 0;
-  SRCL_is_Active(new_srcl) = 1;
-  return new_srcl;
+   @<Unpack recognizer objects@>@;
+   @<Return |-2| on failure@>@;
+    @<Fail if recognizer has a fatal error@>@;
+    return r->t_use_prediction_memo;
+}
+@ @<Function definitions@> =
+int _marpa_r_is_use_prediction_memo_set(
+Marpa_Recognizer r, int value)
+{
+   @<Unpack recognizer objects@>@;
+   @<Return |-2| on failure@>@/
+    @<Fail if recognizer has a fatal error@>@;
+    @<Fail if recognizer started@>@;
+    return r->t_use_prediction_memo = value ? 1 : 0;
 }
 
-@ @<Function definitions@> = PRIVATE
-void
-tkn_link_add (RECCE r,
-                YIM item,
-                YIM predecessor,
-                ALT alternative)
+@ Only predictions have the current Earley set as their origin,
+and the predictions from the memo are distinct,
+so every one of them is a new Earley item.
+They are created directly, without the PSL lookup
+of |earley_item_assign|.
+No later lookup needs the PSL entries that lookup would
+have left ---
+a prediction's AHM is never the AHM of a scanned or fused
+Earley item.
+@<Add predictions to |current_earley_set| from the prediction memo@> =
 {
-  SRCL new_link;
-  unsigned int previous_source_type = Source_Type_of_YIM (item);
-  if (previous_source_type == NO_SOURCE)
+  int ix;
+  int cil_ix;
+  YIK_Object key;
+  CIL prediction_cil;
+  int prediction_count;
+  const int no_of_work_earley_items =
+    MARPA_DSTACK_LENGTH (r->t_yim_work_stack);
+  if (!r->t_prediction_memo_tree)
     {
-      const SRCL source_link = SRCL_of_YIM(item);
-      Source_Type_of_YIM (item) = SOURCE_IS_TOKEN;
-      Predecessor_of_SRCL(source_link) = predecessor;
-      NSYID_of_SRCL(source_link) = NSYID_of_ALT(alternative);
-      Value_of_SRCL(source_link) = Value_of_ALT(alternative);
-      Next_SRCL_of_SRCL(source_link) = NULL;
-      return;
-    }
-  if (previous_source_type != SOURCE_IS_AMBIGUOUS)
-    { // If the sourcing is not already ambiguous, make it so
-      earley_item_ambiguate (r, item);
+      r->t_prediction_memo_tree = _marpa_avl_create (pmemo_cmp, NULL);
+      marpa_obs_budget_attach (MARPA_AVL_OBSTACK
+                               (r->t_prediction_memo_tree),
+                               &r->t_memory_budget);
+      r->t_bv_ahm_predicts = bv_obs_create (r->t_obs, AHM_Count_of_G (g));
+      r->t_bv_irl_predicted = bv_obs_create (r->t_obs, IRL_Count_of_G (g));
+    }
+  cil_buffer_clear (&r->t_cilar);
+  for (ix = 0; ix < no_of_work_earley_items; ix++)
+    {
+      const AHM ahm = AHM_of_YIM (WORK_YIM_ITEM (r, ix));
+      const int ahm_id = (int) ID_of_AHM (ahm);
+      if (Count_of_CIL (Predicted_IRL_CIL_of_AHM (ahm)) > 0
+          && !bv_bit_test_then_set (r->t_bv_ahm_predicts, ahm_id))
+        cil_buffer_push (&r->t_cilar, ahm_id);
+    }
+  prediction_cil = predictions_by_memo (r);
+  prediction_count = Count_of_CIL (prediction_cil);
+  key.t_origin = current_earley_set;
+  key.t_set = current_earley_set;
+  for (cil_ix = 0; cil_ix < prediction_count; cil_ix++)
+    {
+      const IRLID prediction_irlid = Item_of_CIL (prediction_cil, cil_ix);
+      const IRL prediction_irl = IRL_by_ID (prediction_irlid);
+      key.t_ahm = First_AHM_of_IRL (prediction_irl);
+      earley_item_create (r, key);
+    }
+}
+
+@ Find the predictions for the predicting AHMs in the CILAR buffer,
+adding them to the memo if they are not there already.
+The AHM IDs are in the order in which they were found,
+and their bits are still set in the vector of predicting AHMs.
+Usually there are only a few of them,
+so they are cleared one by one,
+and sorted by insertion.
+An Earley set with a single predicting AHM,
+the usual case in practical grammars,
+needs no memo:
+its predictions are those of the AHM,
+which are already sorted and distinct.
+The key is only added to the CILAR on a miss.
+@<Function definitions@> =
+PRIVATE CIL
+predictions_by_memo (const RECCE r)
+{
+  const GRAMMAR g = G_of_R (r);
+  const CILAR cilar = &r->t_cilar;
+  const MARPA_AVL_TREE memo_tree = r->t_prediction_memo_tree;
+  const Bit_Vector bv_irl_predicted = r->t_bv_irl_predicted;
+  PMEMO_Object probe;
+  PMEMO pmemo;
+  int key_ix;
+  int key_count;
+  CIL key = MARPA_DSTACK_BASE (cilar->t_buffer, int);
+  key_count = Count_of_CIL (key);
+  for (key_ix = 0; key_ix < key_count; key_ix++)
+    {
+      const int ahm_id = Item_of_CIL (key, key_ix);
+      int sorted_ix = key_ix;
+      bv_bit_clear (r->t_bv_ahm_predicts, ahm_id);
+      while (sorted_ix > 0 && Item_of_CIL (key, sorted_ix - 1) > ahm_id)
+        {
+          Item_of_CIL (key, sorted_ix) = Item_of_CIL (key, sorted_ix - 1);
+          sorted_ix--;
+        }
+      Item_of_CIL (key, sorted_ix) = ahm_id;
+    }
+  if (key_count == 1)
+    return Predicted_IRL_CIL_of_AHM (AHM_by_ID (Item_of_CIL (key, 0)));
+  Key_of_PMEMO (&probe) = key;
+  pmemo = _marpa_avl_find (memo_tree, &probe);
+  if (pmemo)
+    return Predictions_of_PMEMO (pmemo);
+  key = cil_buffer_add (cilar);
+  bv_clear (bv_irl_predicted);
+  for (key_ix = 0; key_ix < key_count; key_ix++)
+    {
+      int cil_ix;
+      const AHM ahm = AHM_by_ID (Item_of_CIL (key, key_ix));
+      const CIL prediction_cil = Predicted_IRL_CIL_of_AHM (ahm);
+      const int prediction_count = Count_of_CIL (prediction_cil);
+      for (cil_ix = 0; cil_ix < prediction_count; cil_ix++)
+        {
+          bv_bit_set (bv_irl_predicted, Item_of_CIL (prediction_cil, cil_ix));
+        }
     }
-  new_link = unique_srcl_new (r->t_obs);
-  new_link->t_next = LV_First_Token_SRCL_of_YIM (item);
-  new_link->t_source.t_predecessor = predecessor;
-  NSYID_of_Source(new_link->t_source) = NSYID_of_ALT(alternative);
-  Value_of_Source(new_link->t_source) = Value_of_ALT(alternative);
-  LV_First_Token_SRCL_of_YIM (item) = new_link;
+  pmemo = marpa_obs_new (MARPA_AVL_OBSTACK (memo_tree), PMEMO_Object, 1);
+  Key_of_PMEMO (pmemo) = key;
+  Predictions_of_PMEMO (pmemo) = cil_bv_add (cilar, bv_irl_predicted);
+  _marpa_avl_insert (memo_tree, pmemo);
+  return Predictions_of_PMEMO (pmemo);
 }
 
 @ @<Function definitions@> =
-PRIVATE
-void
-completion_link_add (RECCE r,
-                YIM item,
-                YIM predecessor,
-                YIM cause)
+PRIVATE_NOT_INLINE int
+pmemo_cmp (const void *ap, const void *bp, void *param @,@, UNUSED)
 {
-  SRCL new_link;
-  unsigned int previous_source_type = Source_Type_of_YIM (item);
-  if (previous_source_type == NO_SOURCE)
-    {
-      const SRCL source_link = SRCL_of_YIM(item);
-      Source_Type_of_YIM (item) = SOURCE_IS_COMPLETION;
-      Predecessor_of_SRCL(source_link) = predecessor;
-      Cause_of_SRCL(source_link) = cause;
-      Next_SRCL_of_SRCL(source_link) = NULL;
-      return;
-    }
-  if (previous_source_type != SOURCE_IS_AMBIGUOUS)
-    { // If the sourcing is not already ambiguous, make it so
-      earley_item_ambiguate (r, item);
-    }
-  new_link = unique_srcl_new (r->t_obs);
-  new_link->t_next = LV_First_Completion_SRCL_of_YIM (item);
-  new_link->t_source.t_predecessor = predecessor;
-  Cause_of_Source(new_link->t_source) = cause;
-  LV_First_Completion_SRCL_of_YIM (item) = new_link;
+  const PMEMO_Const pmemo_a = ap;
+  const PMEMO_Const pmemo_b = bp;
+  return cil_cmp (Key_of_PMEMO (pmemo_a), Key_of_PMEMO (pmemo_b), NULL);
 }
 
-@ @<Function definitions@> =
-PRIVATE void
-leo_link_add (RECCE r,
-                YIM item,
-                LIM predecessor,
-                YIM cause)
+@ The event trigger vectors are scratch space for
+|trigger_events()|.
+Many recognizers never use events, so they are
+not created until first needed.
+Once created, they are kept for the life of the recognizer,
+and cleared before each use.
+@<Widely aligned recognizer elements@> =
+  Bit_Vector t_bv_completion_event_trigger;
+  Bit_Vector t_bv_nulled_event_trigger;
+  Bit_Vector t_bv_prediction_event_trigger;
+  Bit_Vector t_bv_ahm_event_trigger;
+@ @<Initialize recognizer elements@> =
+  r->t_bv_completion_event_trigger = NULL;
+  r->t_bv_nulled_event_trigger = NULL;
+  r->t_bv_prediction_event_trigger = NULL;
+  r->t_bv_ahm_event_trigger = NULL;
+@ @<Set up the event trigger vectors@> =
 {
-  SRCL new_link;
-  unsigned int previous_source_type = Source_Type_of_YIM (item);
-  if (previous_source_type == NO_SOURCE)
+  if (r->t_bv_ahm_event_trigger)
     {
-      const SRCL source_link = SRCL_of_YIM(item);
-      Source_Type_of_YIM (item) = SOURCE_IS_LEO;
-      Predecessor_of_SRCL(source_link) = predecessor;
-      Cause_of_SRCL(source_link) = cause;
-      Next_SRCL_of_SRCL(source_link) = NULL;
-      return;
+      bv_clear (r->t_bv_completion_event_trigger);
+      bv_clear (r->t_bv_nulled_event_trigger);
+      bv_clear (r->t_bv_prediction_event_trigger);
+      bv_clear (r->t_bv_ahm_event_trigger);
     }
-  if (previous_source_type != SOURCE_IS_AMBIGUOUS)
-    { // If the sourcing is not already ambiguous, make it so
-      earley_item_ambiguate (r, item);
+  else
+    {
+      const XSYID xsy_count = XSY_Count_of_G (g);
+      const int ahm_count = AHM_Count_of_G (g);
+      r->t_bv_completion_event_trigger = bv_obs_create (r->t_obs, xsy_count);
+      r->t_bv_nulled_event_trigger = bv_obs_create (r->t_obs, xsy_count);
+      r->t_bv_prediction_event_trigger = bv_obs_create (r->t_obs, xsy_count);
+      r->t_bv_ahm_event_trigger = bv_obs_create (r->t_obs, ahm_count);
     }
-  new_link = unique_srcl_new (r->t_obs);
-  new_link->t_next = LV_First_Leo_SRCL_of_YIM (item);
-  new_link->t_source.t_predecessor = predecessor;
-  Cause_of_Source(new_link->t_source) = cause;
-  LV_First_Leo_SRCL_of_YIM(item) = new_link;
 }
 
-@ {\bf Convert an Earley item to an ambiguous one.}
-|earley_item_ambiguate|
-assumes it is called when there is exactly one source.
-In other words, is assumes that the Earley item
-is not unsourced,
-and that it is not already ambiguous.
-Ambiguous sources should have more than one source,
-and
-|earley_item_ambiguate|
-is assuming that a new source will be added as followup.
-@
-Inlining |earley_item_ambiguate| might help in some
-circumstance, but at this point
-|earley_item_ambiguate| is not marked |inline|.
-|earley_item_ambiguate|
-is not short,
-it is referenced in several places,
-it is only called for ambiguous Earley items,
-and even for these it is only called when the
-Earley item first becomes ambiguous.
-@<Function definitions@> =
-PRIVATE_NOT_INLINE
-void earley_item_ambiguate (struct marpa_r * r, YIM item)
+@ @<Function definitions@> =
+PRIVATE void trigger_events(RECCE r)
 {
-  unsigned int previous_source_type = Source_Type_of_YIM (item);
-  Source_Type_of_YIM (item) = SOURCE_IS_AMBIGUOUS;
-  switch (previous_source_type)
+  const GRAMMAR g = G_of_R (r);
+  const YS current_earley_set = Latest_YS_of_R (r);
+  int min, max, start;
+  int yim_ix;
+  const YIM *yims = YIMs_of_YS (current_earley_set);
+  Bit_Vector bv_completion_event_trigger;
+  Bit_Vector bv_nulled_event_trigger;
+  Bit_Vector bv_prediction_event_trigger;
+  Bit_Vector bv_ahm_event_trigger;
+  const int working_earley_item_count = YIM_Count_of_YS (current_earley_set);
+  @<Set up the event trigger vectors@>@;
+  bv_completion_event_trigger = r->t_bv_completion_event_trigger;
+  bv_nulled_event_trigger = r->t_bv_nulled_event_trigger;
+  bv_prediction_event_trigger = r->t_bv_prediction_event_trigger;
+  bv_ahm_event_trigger = r->t_bv_ahm_event_trigger;
+  for (yim_ix = 0; yim_ix < working_earley_item_count; yim_ix++)
     {
-    case SOURCE_IS_TOKEN: @<Ambiguate token source@>@;
-      return;
-    case SOURCE_IS_COMPLETION: @<Ambiguate completion source@>@;
-      return;
-    case SOURCE_IS_LEO: @<Ambiguate Leo source@>@;
-      return;
+      const YIM yim = yims[yim_ix];
+      const AHM root_ahm = AHM_of_YIM (yim);
+      if (AHM_has_Event (root_ahm))
+        {                       /* Note that we go on to look at the Leo path, even if
+                                   the top AHM is not an event AHM */
+          bv_bit_set (bv_ahm_event_trigger, ID_of_AHM(root_ahm));
+        }
+      {
+        /* Now do the NSYs for any Leo links */
+        const SRCL first_leo_source_link = First_Leo_SRCL_of_YIM (yim);
+        SRCL setup_source_link;
+        for (setup_source_link = first_leo_source_link; setup_source_link;
+             setup_source_link = Next_SRCL_of_SRCL (setup_source_link))
+          {
+            int cil_ix;
+            const LIM lim = LIM_of_SRCL (setup_source_link);
+            const CIL event_ahmids = CIL_of_LIM (lim);
+            const int event_ahm_count = Count_of_CIL (event_ahmids);
+            for (cil_ix = 0; cil_ix < event_ahm_count; cil_ix++)
+              {
+                const NSYID leo_path_ahmid =
+                  Item_of_CIL (event_ahmids, cil_ix);
+                bv_bit_set (bv_ahm_event_trigger, leo_path_ahmid);
+                /* No need to test if AHM is an event AHM --
+                   all paths in the LIM's CIL will be */
+              }
+          }
+      }
     }
-}
-
-@ @<Ambiguate token source@> = {
-  SRCL new_link = marpa_obs_new (r->t_obs, SRCL_Object, 1);
-  *new_link = *SRCL_of_YIM(item);
-  LV_First_Leo_SRCL_of_YIM (item) = NULL;
-  LV_First_Completion_SRCL_of_YIM (item) = NULL;
-  LV_First_Token_SRCL_of_YIM (item) = new_link;
-}
-
-@ @<Ambiguate completion source@> = {
-  SRCL new_link = marpa_obs_new (r->t_obs, SRCL_Object, 1);
-  *new_link = *SRCL_of_YIM(item);
-  LV_First_Leo_SRCL_of_YIM (item) = NULL;
-  LV_First_Completion_SRCL_of_YIM (item) = new_link;
-  LV_First_Token_SRCL_of_YIM (item) = NULL;
-}
-
-@ @<Ambiguate Leo source@> = {
-  SRCL new_link = marpa_obs_new (r->t_obs, SRCL_Object, 1);
-  *new_link = *SRCL_of_YIM(item);
-  LV_First_Leo_SRCL_of_YIM (item) = new_link;
-  LV_First_Completion_SRCL_of_YIM (item) = NULL;
-  LV_First_Token_SRCL_of_YIM (item) = NULL;
-}
 
-@** Alternative tokens (ALT) code.
-Because Marpa allows more than one token at every
-earleme, Marpa's tokens are also called ``alternatives".
-@<Private incomplete structures@> =
-struct s_alternative;
-typedef struct s_alternative* ALT;
-typedef const struct s_alternative* ALT_Const;
-@
-@d NSYID_of_ALT(alt) ((alt)->t_nsyid)
-@d Value_of_ALT(alt) ((alt)->t_value)
-@d ALT_is_Valued(alt) ((alt)->t_is_valued)
-@d Start_YS_of_ALT(alt) ((alt)->t_start_earley_set)
-@d Start_Earleme_of_ALT(alt) Earleme_of_YS(Start_YS_of_ALT(alt))
-@d End_Earleme_of_ALT(alt) ((alt)->t_end_earleme)
-@<Private structures@> =
-struct s_alternative {
-    YS t_start_earley_set;
-    JEARLEME t_end_earleme;
-    NSYID t_nsyid;
-    int t_value;
-    BITFIELD t_is_valued:1;
-};
-typedef struct s_alternative ALT_Object;
+  for (start = 0; bv_scan (bv_ahm_event_trigger, start, &min, &max);
+       start = max + 2)
+    {
+      XSYID event_ahmid;
+      for (event_ahmid = (NSYID) min; event_ahmid <= (NSYID) max;
+           event_ahmid++)
+        {
+          int cil_ix;
+          const AHM event_ahm = AHM_by_ID(event_ahmid);
+          {
+            const CIL completion_xsyids =
+              Completion_XSYIDs_of_AHM (event_ahm);
+            const int event_xsy_count = Count_of_CIL (completion_xsyids);
+            for (cil_ix = 0; cil_ix < event_xsy_count; cil_ix++)
+              {
+                XSYID event_xsyid = Item_of_CIL (completion_xsyids, cil_ix);
+                bv_bit_set (bv_completion_event_trigger, event_xsyid);
+              }
+          }
+          {
+            const CIL nulled_xsyids = Nulled_XSYIDs_of_AHM (event_ahm);
+            const int event_xsy_count = Count_of_CIL (nulled_xsyids);
+            for (cil_ix = 0; cil_ix < event_xsy_count; cil_ix++)
+              {
+                XSYID event_xsyid = Item_of_CIL (nulled_xsyids, cil_ix);
+                bv_bit_set (bv_nulled_event_trigger, event_xsyid);
+              }
+          }
+          {
+            const CIL prediction_xsyids =
+              Prediction_XSYIDs_of_AHM (event_ahm);
+            const int event_xsy_count = Count_of_CIL (prediction_xsyids);
+            for (cil_ix = 0; cil_ix < event_xsy_count; cil_ix++)
+              {
+                XSYID event_xsyid = Item_of_CIL (prediction_xsyids, cil_ix);
+                bv_bit_set (bv_prediction_event_trigger, event_xsyid);
+              }
+          }
+        }
+    }
 
-@ @<Widely aligned recognizer elements@> =
-MARPA_DSTACK_DECLARE(t_alternatives);
-@
-@<Initialize recognizer elements@> =
-MARPA_DSTACK_INIT2(r->t_alternatives, ALT_Object);
-@ @<Destroy recognizer elements@> = MARPA_DSTACK_DESTROY(r->t_alternatives);
+  if (Ord_of_YS (current_earley_set) <= 0)
+    {
+      /* Because we special-case null parses, looking
+        at the Earley items of the first Earley
+        does not give us all the nulled symbols at
+        earleme 0.  If the parse can turn out to be zero length,
+        all nullables derived from the start symbol
+        (including itself) will be nulled,
+        and therefore all of them
+        should be null events at earleme 0. */
+      int cil_ix;
+      const XSY start_xsy = XSY_by_ID(g->t_start_xsy_id);
+      const CIL nulled_xsyids = Nulled_XSYIDs_of_XSY (start_xsy);
+      const int cil_count = Count_of_CIL (nulled_xsyids);
+      for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
+        {
+          const XSYID nulled_xsyid = Item_of_CIL (nulled_xsyids, cil_ix);
+          bv_bit_set (bv_nulled_event_trigger, nulled_xsyid);
+        }
+    }
 
-@ This functions returns the index at which to insert a new
-alternative, or -1 if the new alternative is a duplicate.
-(Duplicate alternatives should not be inserted.)
-@ A variation of binary search.
-@<Function definitions@> =
-PRIVATE int
-alternative_insertion_point (RECCE r, ALT new_alternative)
-{
-  MARPA_DSTACK alternatives = &r->t_alternatives;
-  ALT alternative;
-  int hi = MARPA_DSTACK_LENGTH(*alternatives) - 1;
-  int lo = 0;
-  int trial;
-  // Special case when zero alternatives.
-  if (hi < 0)
-    return 0;
-  alternative = MARPA_DSTACK_BASE(*alternatives, ALT_Object);
-  for (;;)
+  for (start = 0; bv_scan (bv_completion_event_trigger, start, &min, &max);
+       start = max + 2)
+    {
+      XSYID event_xsyid;
+      for (event_xsyid = min; event_xsyid <= max;
+           event_xsyid++)
+        {
+          if (lbv_bit_test
+              (r->t_lbv_xsyid_completion_event_is_active, event_xsyid))
+            {
+              r_int_event_new (r, MARPA_EVENT_SYMBOL_COMPLETED, event_xsyid);
+            }
+        }
+    }
+  for (start = 0; bv_scan (bv_nulled_event_trigger, start, &min, &max);
+       start = max + 2)
     {
-      int outcome;
-      trial = lo + (hi - lo) / 2;
-      outcome = alternative_cmp (new_alternative, alternative+trial);
-      if (outcome == 0)
-        return -1;
-      if (outcome > 0)
+      XSYID event_xsyid;
+      for (event_xsyid = min; event_xsyid <= max;
+           event_xsyid++)
         {
-          lo = trial + 1;
+          if (lbv_bit_test
+              (r->t_lbv_xsyid_nulled_event_is_active, event_xsyid))
+            {
+              r_int_event_new (r, MARPA_EVENT_SYMBOL_NULLED, event_xsyid);
+            }
+
         }
-      else
+    }
+  for (start = 0; bv_scan (bv_prediction_event_trigger, start, &min, &max);
+       start = max + 2)
+    {
+      XSYID event_xsyid;
+      for (event_xsyid = (NSYID) min; event_xsyid <= (NSYID) max;
+           event_xsyid++)
         {
-          hi = trial - 1;
+          if (lbv_bit_test
+              (r->t_lbv_xsyid_prediction_event_is_active, event_xsyid))
+            {
+              r_int_event_new (r, MARPA_EVENT_SYMBOL_PREDICTED, event_xsyid);
+            }
         }
-      if (hi < lo)
-        return outcome > 0 ? trial + 1 : trial;
     }
 }
 
-@ This is the comparison function for sorting alternatives.
-The alternatives array also acts as a stack, with the alternatives
-ending at the lowest numbered earleme on top of the stack.
-This allows alternatives to be popped off the stack as the
-earlemes are processed in numerical order.
-@ So that the alternatives array can act as a stack,
-the end earleme of the alternatives must be the major key,
-and must sort in reverse order.
-Of the remaining two keys,
-the more minor key is the start earleme, because that way its slightly
-costlier evaluation can sometimes be avoided.
+@ Trigger events for trivial grammars.
+A trivial grammar is one which only accepts
+the null string.
+
+This code takes no special measure to ensure
+that the order of nulled events is the
+same as in the non-trivial case.
+No guarantee of the order should be documented.
 @<Function definitions@> =
-PRIVATE int alternative_cmp(const ALT_Const a, const ALT_Const b)
+PRIVATE int trigger_trivial_events(RECCE r)
 {
-     int subkey = End_Earleme_of_ALT(b) - End_Earleme_of_ALT(a);
-     if (subkey) return subkey;
-     subkey = NSYID_of_ALT(a) - NSYID_of_ALT(b);
-     if (subkey) return subkey;
-     return Start_Earleme_of_ALT(a) - Start_Earleme_of_ALT(b);
+  int cil_ix;
+  int event_count = 0;
+  GRAMMAR g = G_of_R(r);
+  const XSY start_xsy = XSY_by_ID (g->t_start_xsy_id);
+  const CIL nulled_xsyids = Nulled_XSYIDs_of_XSY (start_xsy);
+  const int cil_count = Count_of_CIL (nulled_xsyids);
+  for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
+    {
+      const XSYID nulled_xsyid = Item_of_CIL (nulled_xsyids, cil_ix);
+      if (lbv_bit_test(r->t_lbv_xsyid_nulled_event_is_active, nulled_xsyid)) {
+        r_int_event_new (r, MARPA_EVENT_SYMBOL_NULLED, nulled_xsyid);
+        event_count++;
+      }
+    }
+    return event_count;
 }
 
-@ This function pops an alternative from the stack, if it matches
-the earleme argument.
-If no alternative on the stack has its end earleme at the
-earleme argument, |NULL| is returned.
-The data pointed to by the return value may be overwritten when
-new alternatives are added, so it must be used before the next
-call that adds data to the alternatives stack.
+@ This is called again, by |marpa_r_clean|, for an Earley set that
+already has its array of Earley items.
+By then, the segment may not be the one that the Earley set is in,
+so the old array is reused.
 @<Function definitions@> =
-PRIVATE ALT alternative_pop(RECCE r, JEARLEME earleme)
+PRIVATE void earley_set_update_items(RECCE r, YS set)
 {
-  MARPA_DSTACK alternatives = &r->t_alternatives;
-  ALT end_of_stack = MARPA_DSTACK_TOP (*alternatives, ALT_Object);
-
-  if (!end_of_stack) return NULL;
-
-  @t}\comment{@>/* Stop looking if the next alternative is at
-  a later earleme.  We do {\bf not} test for earlier earlemes,
-  because we call |alternative_pop()| for each successive |earleme|
-  in integer order.
-  */
-  if (earleme < End_Earleme_of_ALT (end_of_stack))
-    return NULL;
-
-  return MARPA_DSTACK_POP (*alternatives, ALT_Object);
+    YIM* working_earley_items;
+    YIM* finished_earley_items;
+    int working_earley_item_count;
+    int i;
+    if (!YIMs_of_YS(set))
+      YIMs_of_YS(set) = marpa_obs_new(r->t_ys_obs, YIM, YIM_Count_of_YS(set));
+    finished_earley_items = YIMs_of_YS(set);
+    /* We know that no new earley items will be added in this scope */
+    working_earley_items = Work_YIMs_of_R(r);
+    working_earley_item_count = Work_YIM_Count_of_R(r);
+    for (i = 0; i < working_earley_item_count; i++) {
+         YIM earley_item = working_earley_items[i];
+         int ordinal = Ord_of_YIM(earley_item);
+         finished_earley_items[ordinal] = earley_item;
+    }
+    WORK_YIMS_CLEAR(r);
 }
 
-@ This function inserts an alternative into the stack,
-in sorted order,
-if the alternative is not a duplicate.
-It returns -1 if the alternative is a duplicate,
-and the insertion point (which must be zero or more) otherwise.
-@ {\bf To Do}: @^To Do@>
-I wonder if this would not have been better implemented as a
-linked list.
+@ This function is called exactly once during a normal parse --
+at the end, when it is time for a bocage to be created.
+It is also called by trace and debugging methods.
+It must be used carefully since it takes $O(\log n)$ time,
+where $n$ is the number of Earley sets.
+If called after every Earley set, it would make Marpa
+$O(n \log n)$ in the best case.
+@d P_YS_of_R_by_Ord(r, ord) MARPA_DSTACK_INDEX((r)->t_earley_set_stack, YS, (ord))
+@d YS_of_R_by_Ord(r, ord) (*P_YS_of_R_by_Ord((r), (ord)))
 @<Function definitions@> =
-PRIVATE int alternative_insert(RECCE r, ALT new_alternative)
+PRIVATE void r_update_earley_sets(RECCE r)
 {
-  ALT end_of_stack, base_of_stack;
-  MARPA_DSTACK alternatives = &r->t_alternatives;
-  int ix;
-  int insertion_point = alternative_insertion_point (r, new_alternative);
-  if (insertion_point < 0)
-    return insertion_point;
-    @t}\comment{@>
-  /* may change base */
-  end_of_stack = MARPA_DSTACK_PUSH(*alternatives, ALT_Object);
-    @t}\comment{@>
-  /* base will not change after this */
-  base_of_stack = MARPA_DSTACK_BASE(*alternatives, ALT_Object);
-   for (ix = end_of_stack-base_of_stack; ix > insertion_point; ix--) {
-       base_of_stack[ix] = base_of_stack[ix-1];
-   }
-   base_of_stack[insertion_point] = *new_alternative;
-   return insertion_point;
+    YS set;
+    YS first_unstacked_earley_set;
+    if (!MARPA_DSTACK_IS_INITIALIZED(r->t_earley_set_stack)) {
+        first_unstacked_earley_set = First_YS_of_R(r);
+        MARPA_DSTACK_INIT (r->t_earley_set_stack, YS,
+                 MAX (1024, YS_Count_of_R(r)));
+    } else {
+         YS* end_of_stack = MARPA_DSTACK_TOP(r->t_earley_set_stack, YS);
+         first_unstacked_earley_set = Next_YS_of_YS(*end_of_stack);
+    }
+    for (set = first_unstacked_earley_set; set; set = Next_YS_of_YS(set)) {
+          YS* end_of_stack = MARPA_DSTACK_PUSH(r->t_earley_set_stack, YS);
+          (*end_of_stack) = set;
+    }
 }
 
-@** Starting recognizer input.
-@<Function definitions@> = int marpa_r_start_input(Marpa_Recognizer r)
-{
-    int return_value = 1;
-    YS set0;
-    YIK_Object key;
-
-    IRL start_irl;
-    AHM start_ahm;
+@** Create the postdot items.
 
-  @<Unpack recognizer objects@>@;
-  @<Return |-2| on failure@>@;
+@*0 About Leo items and unit rules.
 
-  @<Fail if recognizer started@>@;
-  {
-    @<Declare |marpa_r_start_input| locals@>@;
-    Current_Earleme_of_R(r) = 0;
-    @<Set up terminal-related boolean vectors@>@;
-    G_EVENTS_CLEAR(g);
+@ Much of the logic in the code is required to allow the Leo logic
+to handle unit rules in right recursions.
+Right recursions that involve only unit rules might be overlooked --
+they are either finite in length (limited by the number of symbols
+in the grammar) or involve cycles.
+Either way, they could reasonably be ignored.
+@ But a right recursion often takes place through multiple rules,
+and in practical cases following
+an important and lengthy right recursion,
+one with many non-unit rules,
+may require following short stretches of
+unit rules.
+@ If a unit rule is the base item of a Leo item,
+it must be a prediction.  This is because the base
+item will have a dot position that is penultimate --
+at the dot location just before the final one.
+In a unit rule this is the beginning of the rule.
+@ Unit rules have a special issue when it comes to creating
+Leo items.
+Every Leo item, if it is to be useful
+and continue the recursion,
+needs to find a Leo predecessor.
+In the text that follows, recording the predecessor
+data in an Leo item is called ``populating'' that item.
+@
+The Leo predecessor of a unit rule Leo base item
+will be in the same Earley set that we are working on,
+and since this is the same Earley set for which
+we are creating Leo items,
+it may not have been built yet.
+Worse, it may be part of a cycle.
+To solve this problem, the code that follows builds
+LIM chains --
+chains of LIM's which require the next one
+on the chain to be populated.
+Every LIM on a LIM chain will have a base rule
+which is a unit rule and a prediction.
+@ A chain ends
+\li when it results in a cycle,
+in which case the right recursion will not followed further.
+\li when a LIM is found which is not a unit
+rule, because that LIM's predecessor will be in a previous
+Earley set, and its information will be available.
+\li when it find a unit rule LIM which is populated,
+perhaps by a run through a previous LIM chain.
 
-    set0 = earley_set_new(r, 0);
-    Latest_YS_of_R(r) = set0;
-    First_YS_of_R(r) = set0;
+@*0 Code.
 
-    if (G_is_Trivial(g)) {
-        return_value += trigger_trivial_events(r);
-        @<Set |r| exhausted@>@;
-        goto CLEANUP;
+@ This function inserts regular and Leo postdot items into
+the postdot list.
+Not inlined, because of its size, and because it is used
+twice -- once in initializing the Earley set 0,
+and once for completing later Earley sets.
+Earley set 0 is very much a special case, and it
+might be a good idea to have
+separate code to handle it,
+in which case both could be inlined.
+@ Leo items are not created for Earley set 0.
+Originally this was to avoid dealing with the null productions
+that might be in Earley set 0.
+These have been eliminated with the special-casing of the
+null parse.
+But Leo items are always optional,
+and may not be worth it for Earley set 0.
+@ {\bf Further Research}: @^Further Research@>
+Another look at the degree and kind
+of memoization here is in order
+now that I use Leo items only in cases of
+an actual right recursion.
+This may require running benchmarks.
+@ The |bv_ok_for_chain| bit vector is scratch space
+for the LIM chains.
+It is kept in the recognizer, rather than
+being created and destroyed for every Earley set,
+and it is completely rewritten before each use,
+so that it never needs to be cleared.
+@<Widely aligned recognizer elements@> =
+  Bit_Vector t_bv_lim_symbols;
+  Bit_Vector t_bv_pim_symbols;
+  Bit_Vector t_bv_ok_for_chain;
+  void** t_pim_workarea;
+@ @<Allocate recognizer containers@> =
+  r->t_bv_lim_symbols = bv_obs_create(r->t_obs, nsy_count);
+  r->t_bv_pim_symbols = bv_obs_create(r->t_obs, nsy_count);
+  r->t_bv_ok_for_chain = bv_obs_create(r->t_obs, nsy_count);
+  r->t_pim_workarea = marpa_obs_new(r->t_obs, void*, nsy_count);
+@ @<Reinitialize containers used in PIM setup@> =
+  bv_clear(r->t_bv_lim_symbols);
+  bv_clear(r->t_bv_pim_symbols);
+@ @<Function definitions@> =
+PRIVATE_NOT_INLINE void
+postdot_items_create (RECCE r,
+  const YS current_earley_set)
+{
+  @<Unpack recognizer objects@>@;
+  const Bit_Vector bv_ok_for_chain = r->t_bv_ok_for_chain;
+    @<Reinitialize containers used in PIM setup@>@;
+    @<Start YIXes in PIM workarea@>@;
+    if (r->t_is_using_leo) {
+        @<Start LIMs in PIM workarea@>@;
+        @<Add predecessors to LIMs@>@;
     }
-    Input_Phase_of_R(r) = R_DURING_INPUT;
-    psar_reset(Dot_PSAR_of_R(r));
-    @<Allocate recognizer containers@>@;
-    @<Initialize Earley item work stacks@>@;
-
-    start_irl = g->t_start_irl;
-    start_ahm = First_AHM_of_IRL(start_irl);
-
-    @t}\comment{@>
-    /* These will stay constant in every YIM added in this method */
-    key.t_origin = set0;
-    key.t_set = set0;
+    @<Copy PIM workarea to postdot item array@>@;
+    bv_and(r->t_bv_nsyid_is_expected, r->t_bv_pim_symbols, g->t_bv_nsyid_is_terminal);
+}
 
-    key.t_ahm = start_ahm;
-    earley_item_create(r, key);
+@ This code creates the Earley indexes in the PIM workarea.
+At this point there are no Leo items.
+@<Start YIXes in PIM workarea@> = {
+    /* No new Earley items are created in this scope */
+    YIM* work_earley_items = MARPA_DSTACK_BASE (r->t_yim_work_stack, YIM );
+    int no_of_work_earley_items = MARPA_DSTACK_LENGTH (r->t_yim_work_stack );
+    int ix;
+    for (ix = 0;
+         ix < no_of_work_earley_items;
+         ix++)
+     {
+        YIM earley_item = work_earley_items[ix];
+      AHM ahm = AHM_of_YIM (earley_item);
+      const NSYID postdot_nsyid = Postdot_NSYID_of_AHM(ahm);
+      if (postdot_nsyid < 0) continue;
+        {
+          PIM old_pim = NULL;
+          PIM new_pim;
 
-    bv_clear (r->t_bv_irl_seen);
-    bv_bit_set (r->t_bv_irl_seen, ID_of_IRL(start_irl));
-    MARPA_DSTACK_CLEAR(r->t_irl_cil_stack);
-    *MARPA_DSTACK_PUSH(r->t_irl_cil_stack, CIL) = LHS_CIL_of_AHM(start_ahm);
+	  /* Need to be aligned for a PIM */
+          new_pim = marpa__obs_alloc(r->t_ys_obs,
+            sizeof(YIX_Object), ALIGNOF(PIM_Object));
+          PIM_Count_of_R(r)++;
 
-    while (1)
-      {
-        const CIL* const p_cil = MARPA_DSTACK_POP (r->t_irl_cil_stack, CIL);
-        if (!p_cil)
-          break;
-        {
-          int cil_ix;
-          const CIL this_cil = *p_cil;
-          const int prediction_count = Count_of_CIL (this_cil);
-          for (cil_ix = 0; cil_ix < prediction_count; cil_ix++)
-            {
-              const IRLID prediction_irlid = Item_of_CIL (this_cil, cil_ix);
-              if (!bv_bit_test_then_set (r->t_bv_irl_seen, prediction_irlid))
-                {
-                  const IRL prediction_irl = IRL_by_ID (prediction_irlid);
-                  const AHM prediction_ahm = First_AHM_of_IRL (prediction_irl);
-                  @t}\comment{@>
-                  /* If any of the assertions fail, do not add this AHM to
-                  the YS, or look at anything predicted by it. */
-                  if (!evaluate_zwas(r, 0, prediction_ahm)) continue;
-                  key.t_ahm = prediction_ahm;
-                  earley_item_create (r, key);
-                  *MARPA_DSTACK_PUSH(r->t_irl_cil_stack, CIL)
-                    = LHS_CIL_of_AHM(prediction_ahm);
-                }
-            }
+          Postdot_NSYID_of_PIM(new_pim) = postdot_nsyid;
+          YIM_of_PIM(new_pim) = earley_item;
+          if (bv_bit_test(r->t_bv_pim_symbols, postdot_nsyid))
+              old_pim = r->t_pim_workarea[postdot_nsyid];
+          Next_PIM_of_PIM(new_pim) = old_pim;
+          if (!old_pim) current_earley_set->t_postdot_sym_count++;
+          r->t_pim_workarea[postdot_nsyid] = new_pim;
+          bv_bit_set(r->t_bv_pim_symbols, postdot_nsyid);
         }
-      }
-
-    postdot_items_create(r, bv_ok_for_chain, set0);
-    earley_set_update_items(r, set0);
-    r->t_is_using_leo = r->t_use_leo_flag;
-    trigger_events(r);
-    CLEANUP: ;
-    @<Destroy |marpa_r_start_input| locals@>@;
-  }
-  return return_value;
+    }
 }
 
-@ @<Function definitions@> =
-PRIVATE
-int evaluate_zwas(RECCE r, YSID ysid, AHM ahm)
+@ This code creates the Earley indexes in the PIM workarea.
+The Leo items do not contain predecessors or have the
+predecessor-dependent information set at this point.
+@ The origin and predecessor will be filled in later,
+when the predecessor is known.
+The origin is set to |NULL|,
+and that will be used as an indicator that the fields
+of this
+Leo item have not been fully populated.
+@d LIM_is_Populated(leo) (Origin_of_LIM(leo) != NULL)
+@<Start LIMs in PIM workarea@> =
 {
-  int cil_ix;
-  const CIL zwa_cil = ZWA_CIL_of_AHM(ahm);
-  const int cil_count = Count_of_CIL (zwa_cil);
-  for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
-  {
-     int value;
-     const ZWAID zwaid = Item_of_CIL (zwa_cil, cil_ix);
-     const ZWA zwa = RZWA_by_ID(zwaid);
-      @t}\comment{@>
-      /* Use the memoized value, if it is for this YS */
-     MARPA_OFF_DEBUG3("At %s, evaluating assertion %ld", STRLOC, (long)zwaid);
-     if (Memo_YSID_of_ZWA(zwa) == ysid) {
-         if (Memo_Value_of_ZWA(zwa)) continue;
-         MARPA_OFF_DEBUG3("At %s: returning 0 for assertion %ld", STRLOC, (long)zwaid);
-         return 0;
-     }
-
-      @t}\comment{@>
-      /* Calculate the value (currently always the default)
-      and memoize it */
-     value = Memo_Value_of_ZWA(zwa) = Default_Value_of_ZWA(zwa);
-     Memo_YSID_of_ZWA(zwa) = ysid;
-
-      @t}\comment{@>
-      /* If the assertion fails we are done
-      Otherwise, continue to check assertions.
-      */
-     if (!value) {
-       MARPA_OFF_DEBUG3("At %s: returning 0 for assertion %ld", STRLOC, (long)zwaid);
-       return 0;
-     }
+  int min, max, start;
+  for (start = 0; bv_scan (r->t_bv_pim_symbols, start, &min, &max);
+       start = max + 2)
+    {
+      NSYID nsyid;
+      for (nsyid = (NSYID) min; nsyid <= (NSYID) max; nsyid++)
+	{
+	  const PIM this_pim = r->t_pim_workarea[nsyid];
+	  if (Next_PIM_of_PIM (this_pim))
+	    goto NEXT_NSYID;
+                /* Do not create a Leo item if there is more
+                   than one YIX */
+          {
+	    const YIM leo_base = YIM_of_PIM (this_pim);
+	    AHM potential_leo_penult_ahm = NULL;
+		const AHM leo_base_ahm = AHM_of_YIM (leo_base);
+		const IRL leo_base_irl = IRL_of_AHM (leo_base_ahm);
 
-     MARPA_OFF_DEBUG3("At %s: value is 1 for assertion %ld", STRLOC, (long)zwaid);
-  }
-  return 1;
+		if (!IRL_is_Leo (leo_base_irl))
+		  goto NEXT_NSYID;
+		potential_leo_penult_ahm = leo_base_ahm;
+            MARPA_ASSERT((int)potential_leo_penult_ahm);
+	    {
+	      const AHM trailhead_ahm =
+		Next_AHM_of_AHM (potential_leo_penult_ahm);
+	      if (AHM_is_Leo_Completion (trailhead_ahm))
+		{
+		  @<Create a new, unpopulated, LIM@>@;
+		}
+	    }
+	  }
+	NEXT_NSYID:;
+	}
+    }
 }
 
+@ The Top AHM of the new LIM is temporarily used
+to memoize
+the value of the AHM to-state for the LIM's
+base YIM.
+That may become its actual value,
+once it is populated.
+@<Create a new, unpopulated, LIM@> = {
+    LIM new_lim;
+    new_lim = marpa_obs_new(r->t_ys_obs, LIM_Object, 1);
+    LIM_Count_of_R(r)++;
+    PIM_Count_of_R(r)++;
+    LIM_is_Active(new_lim) = 1;
+    LIM_is_Rejected(new_lim) = 1;
+    Postdot_NSYID_of_LIM(new_lim) = nsyid;
+    YIM_of_PIM(new_lim) = NULL;
+    Predecessor_LIM_of_LIM(new_lim) = NULL;
+    Origin_of_LIM(new_lim) = NULL;
+    CIL_of_LIM(new_lim) = NULL;
+    Top_AHM_of_LIM(new_lim) = trailhead_ahm;
+    Trailhead_AHM_of_LIM(new_lim) = trailhead_ahm;
+    Trailhead_YIM_of_LIM(new_lim) = leo_base;
+    YS_of_LIM(new_lim) = current_earley_set;
+    Next_PIM_of_LIM(new_lim) = this_pim;
+    r->t_pim_workarea[nsyid] = new_lim;
+    bv_bit_set(r->t_bv_lim_symbols, nsyid);
+}
 
-@ @<Declare |marpa_r_start_input| locals@> =
-    const NSYID nsy_count = NSY_Count_of_G(g);
-    const NSYID xsy_count = XSY_Count_of_G(g);
-    Bit_Vector bv_ok_for_chain = bv_create(nsy_count);
-@ @<Destroy |marpa_r_start_input| locals@> =
-    bv_free(bv_ok_for_chain);
-
-@** Read a token alternative.
-The ordinary semantics of a parser generator is a token-stream
-semantics.
-The input is a sequence of $n$ tokens.
-Every token is of length 1.
-The tokens fill the locations from 0 to $n-1$.
-The first token goes into location 0,
-the next into location 1,
-and so on up to location $n-1$.
-@ In Marpa terms, a token-stream
-corresponds to reading exactly one token alternative at every location.
-In Marpa, the input locations are also called earlemes.
-@ Marpa allows other models of the input besides the token stream model.
-Tokens may be ambiguous -- that is, more than one token may occur
-at any location.
-Tokens vary in length -- tokens may be of any length greater than
-or equal to one.
-This means tokens can span multiple earlemes.
-As a consequence,
-there may be no tokens at some earlemes.
-@*0 Boolean vectors to track terminals.
-A number of boolean vectors are used to track
-the valued status of terminal symbols.
-Whether a symbol is a terminal or not cannot
-be changed by the recognizer,
-but some symbols are ``value unlocked'' and
-will be set to valued or unvalued the first
-time they are encountered.
-@<Widely aligned recognizer elements@> =
-  LBV t_valued_terminal;
-  LBV t_unvalued_terminal;
-  LBV t_valued;
-  LBV t_unvalued;
-  LBV t_valued_locked;
+@ This code fully populates the data in the LIMs.
+It determines the Leo predecessors of the LIMs, if any,
+then populates that datum and the predecessor-dependent
+data.
+@ The algorithm is fast, if not a model of simplicity.
+The LIMs are processed in an outer loop in order by
+symbol ID, as well as in an inner loop which processes
+predecessor chains from bottom to top.
+It is very much possible that the
+same LIM will be encountered twice,
+once in each loop.
+The code always checks to see if a LIM is
+already populated,
+before populating it.
+@ The outer loop ensures that all LIMs are eventually
+populated.  It uses the PIM workarea, guided by
+a boolean vector which indicates the LIM's.
+@ It is possible for a LIM to be encountered which may have a predecessor,
+but which cannot be immediately populated.
+This is because predecessors link the LIMs in chains, and such chains
+must be populated in order.
+Any ``links" in the chain of LIMs which are in previous Earley sets
+will already be populated.
+But a chain of LIMs may all be in the current Earley set, the
+one we are currently processing.
+In this case, there is a chicken-and-egg issue, which is
+resolved by arranging those LIMs in chain link order,
+and processing them in that order.
+This is the business of the inner loop.
+@ When a LIM is encountered which cannot be populated immediately,
+its chain is followed and copied into |t_lim_chain|, which is in
+effect a stack.  The chain ends when it reaches
+a LIM which can be populated immediately.
+@ A special case is when the LIM chain cycles back to the LIM
+which started the chain.
+When this happens, the LIM chain is terminated.
+The bottom of such a chain
+(which, since it is a cycle, is also the top)
+is populated with a predecessor of
+|NULL| and appropriate predecessor-dependent data.
+@ {\bf Theorem}: The number of links
+in a LIM chain is never more than the number
+of symbols in the grammar.
+{\bf Proof}: A LIM chain consists of the predecessors of LIMs,
+all of which are in the same Earley set.
+A LIM is uniquely determined by a duple of Earley set and transition symbol.
+This means, in a single Earley set, there is at most one LIM per symbol.
+{\bf QED}.
+@ {\bf Complexity}: Time complexity is $O(n)$, where $n$ is the number
+of LIMs.  This can be shown as follows:
+\li The outer loop processes each LIM exactly once.
+\li A LIM is never put onto a LIM chain if it is already populated.
+\li A LIM is never taken off a LIM chain without being populated.
+\li Based on the previous two observations, we know that a LIM will
+be put onto a LIM chain at most once.
+\li Ignoring the inner loop processing, the amount of processing done for each
+LIM in the outer loop LIM is $O(1)$.
+\li The amount of processing done for each LIM
+in the inner loop is $O(1)$.
+\li Total processing for all $n$ LIMs is therefore $n(O(1)+O(1))=O(n)$.
+@ The |bv_ok_for_chain| is a vector of bits by symbol ID.
+A bit is set if there is a LIM for that symbol ID that is OK for addition
+to the LIM chain.
+To be OK for addition to the LIM chain, the postdot item for the symbol
+ID must
+\li In fact actually be a Leo item (LIM).
+\li Must not have been populated.
+\li Must not have already been added to a LIM chain for this
+Earley set.\par
+@<Add predecessors to LIMs@> = {
+  int min, max, start;
 
-@ @<Set up terminal-related boolean vectors@> =
-{
-  XSYID xsy_id;
-  r->t_valued_terminal = lbv_obs_new0 (r->t_obs, xsy_count);
-  r->t_unvalued_terminal = lbv_obs_new0 (r->t_obs, xsy_count);
-  r->t_valued = lbv_obs_new0 (r->t_obs, xsy_count);
-  r->t_unvalued = lbv_obs_new0 (r->t_obs, xsy_count);
-  r->t_valued_locked = lbv_obs_new0 (r->t_obs, xsy_count);
-  for (xsy_id = 0; xsy_id < xsy_count; xsy_id++)
-    {
-      const XSY xsy = XSY_by_ID (xsy_id);
-      if (XSY_is_Valued_Locked (xsy))
-        {
-          lbv_bit_set (r->t_valued_locked, xsy_id);
-        }
-      if (XSY_is_Valued (xsy))
+  bv_copy(bv_ok_for_chain, r->t_bv_lim_symbols);
+  for (start = 0; bv_scan (r->t_bv_lim_symbols, start, &min, &max);
+       start = max + 2)
+    { /* This is the outer loop.  It loops over the symbols IDs,
+          visiting only the symbols with LIMs. */
+      NSYID main_loop_nsyid;
+      for (main_loop_nsyid = (NSYID) min;
+          main_loop_nsyid <= (NSYID) max;
+          main_loop_nsyid++)
         {
-          lbv_bit_set (r->t_valued, xsy_id);
-          if (XSY_is_Terminal (xsy))
-            {
-              lbv_bit_set (r->t_valued_terminal, xsy_id);
+          LIM predecessor_lim;
+          LIM lim_to_process = r->t_pim_workarea[main_loop_nsyid];
+          if (LIM_is_Populated(lim_to_process)) continue; /* LIM may
+              have already been populated in the LIM chain loop */
+            @<Find predecessor LIM of unpopulated LIM@>@;
+            if (predecessor_lim && LIM_is_Populated(predecessor_lim)) {
+                @<Populate |lim_to_process| from |predecessor_lim|@>@;
+                continue;
             }
-        }
-      else
-        {
-          lbv_bit_set (r->t_unvalued, xsy_id);
-          if (XSY_is_Terminal (xsy))
-            {
-              lbv_bit_set (r->t_unvalued_terminal, xsy_id);
+            if (!predecessor_lim) { /* If there is no predecessor LIM to
+               populate, we know that we should populate from the base
+               Earley item */
+               @<Populate |lim_to_process| from its base Earley item@>@;
+               continue;
             }
+           @<Create and populate a LIM chain@>@;
         }
     }
 }
 
-@ |marpa_r_alternative|, by enforcing a limit on token length and on
-the furthest location, indirectly enforces a limit on the
-number of earley sets and the maximum earleme location.
-If tokens ending at location $n$ cannot be scanned, then clearly
-the parse can
-never reach location $n$.
-@<Function definitions@> =
-Marpa_Earleme marpa_r_alternative(
-    Marpa_Recognizer r,
-    Marpa_Symbol_ID tkn_xsy_id,
-    int value,
-    int length)
+@ Find the predecessor LIM from the PIM workarea.
+If the predecessor
+starts at the current Earley set, I need to look in
+the PIM workarea.
+Otherwise the PIM item array by symbol is already
+set up and I can find it there.
+@ The LHS of the completed rule and of the applicable rule
+in the base item will be the same, because the two rules
+are the same.
+Given the |main_loop_symbol_id| we can look up either the
+appropriate rule in the base Earley item's AHM,
+or the Leo completion's AHM.
+It is most convenient to find the LHS of the completed
+rule as the
+only possible Leo LHS of the Leo completion's AHM.
+The AHM for the Leo completion is guaranteed
+to have only one rule.
+The base Earley item's AHM can have multiple
+rules, and in its list of rules there can
+be transitions to Leo
+completions via several different symbols.
+The code is used for unpopulated LIMs.
+In a populated LIM, this will not necessarily be the case.
+@<Find predecessor LIM of unpopulated LIM@> =
 {
-    @<Unpack recognizer objects@>@;
-    YS current_earley_set;
-    const JEARLEME current_earleme = Current_Earleme_of_R (r);
-    JEARLEME target_earleme;
-    NSYID tkn_nsyid;
-    if (_MARPA_UNLIKELY (!R_is_Consistent (r)))
-      {
-        MARPA_ERROR (MARPA_ERR_RECCE_IS_INCONSISTENT);
-        return MARPA_ERR_RECCE_IS_INCONSISTENT;
-      }
-    if (_MARPA_UNLIKELY (Input_Phase_of_R (r) != R_DURING_INPUT))
-      {
-        MARPA_ERROR (MARPA_ERR_RECCE_NOT_ACCEPTING_INPUT);
-        return MARPA_ERR_RECCE_NOT_ACCEPTING_INPUT;
-      }
-    if (_MARPA_UNLIKELY (XSYID_is_Malformed(tkn_xsy_id)))
-      {
-        MARPA_ERROR (MARPA_ERR_INVALID_SYMBOL_ID);
-        return MARPA_ERR_INVALID_SYMBOL_ID;
-      }
-    if (_MARPA_UNLIKELY (!XSYID_of_G_Exists(tkn_xsy_id)))
-      {
-        MARPA_ERROR (MARPA_ERR_NO_SUCH_SYMBOL_ID);
-        return MARPA_ERR_NO_SUCH_SYMBOL_ID;
-      }
-    @<|marpa_alternative| initial check for failure conditions@>@;
-    @<Set |current_earley_set|, failing if token is unexpected@>@;
-    @<Set |target_earleme| or fail@>@;
-    @<Insert alternative into stack, failing if token is duplicate@>@;
-    return MARPA_ERR_NONE;
-}
-
-@ @<|marpa_alternative| initial check for failure conditions@> = {
-    const XSY_Const tkn = XSY_by_ID(tkn_xsy_id);
-    if (length <= 0) {
-        MARPA_ERROR(MARPA_ERR_TOKEN_LENGTH_LE_ZERO);
-        return MARPA_ERR_TOKEN_LENGTH_LE_ZERO;
-    }
-    if (length >= JEARLEME_THRESHOLD) {
-        MARPA_ERROR(MARPA_ERR_TOKEN_TOO_LONG);
-        return MARPA_ERR_TOKEN_TOO_LONG;
+  const YIM base_yim = Trailhead_YIM_of_LIM (lim_to_process);
+  const YS predecessor_set = Origin_of_YIM (base_yim);
+  const AHM trailhead_ahm = Trailhead_AHM_of_LIM (lim_to_process);
+  const NSYID predecessor_transition_nsyid =
+    LHSID_of_AHM (trailhead_ahm);
+  PIM predecessor_pim;
+  if (Ord_of_YS (predecessor_set) < Ord_of_YS (current_earley_set))
+    {
+      predecessor_pim
+	=
+	First_PIM_of_YS_by_NSYID (predecessor_set,
+				  predecessor_transition_nsyid);
     }
-    if (value && _MARPA_UNLIKELY(!lbv_bit_test(r->t_valued_terminal, tkn_xsy_id)))
+  else
     {
-      if (!XSY_is_Terminal(tkn)) {
-          MARPA_ERROR(MARPA_ERR_TOKEN_IS_NOT_TERMINAL);
-          return MARPA_ERR_TOKEN_IS_NOT_TERMINAL;
-      }
-      if (lbv_bit_test(r->t_valued_locked, tkn_xsy_id)) {
-          MARPA_ERROR(MARPA_ERR_SYMBOL_VALUED_CONFLICT);
-          return MARPA_ERR_SYMBOL_VALUED_CONFLICT;
-      }
-      lbv_bit_set(r->t_valued_locked, tkn_xsy_id);
-      lbv_bit_set(r->t_valued_terminal, tkn_xsy_id);
-      lbv_bit_set(r->t_valued, tkn_xsy_id);
+      predecessor_pim = r->t_pim_workarea[predecessor_transition_nsyid];
     }
-    if (!value && _MARPA_UNLIKELY(!lbv_bit_test(r->t_unvalued_terminal, tkn_xsy_id)))
+  predecessor_lim =
+    PIM_is_LIM (predecessor_pim) ? LIM_of_PIM (predecessor_pim) : NULL;
+}
+
+@ @<Widely aligned recognizer elements@> =
+  void** t_lim_chain;
+@ @<Allocate recognizer containers@> =
+  r->t_lim_chain = marpa_obs_new(r->t_obs, void*, 2*nsy_count);
+@ @<Create and populate a LIM chain@> = {
+  int lim_chain_ix;
+  @<Create a LIM chain@>@;
+  @<Populate the LIMs in the LIM chain@>@;
+}
+
+@ At this point we know that
+\li |lim_to_process != NULL|
+\li |lim_to_process| is not populated
+\li |predecessor_lim != NULL|
+\li |predecessor_lim| is not populated
+@ Cycles can occur in the LIM chain.  They are broken by refusing to
+put the same LIM on LIM chain twice.  Since a LIM chain links are one-to-one,
+ensuring that the LIM on the bottom of the chain is never added to the LIM
+chain is enough to enforce this.
+@ When I am about to add a LIM twice to the LIM chain, instead I break the
+chain at that point.  The top of chain will then have no LIM predecessor,
+instead of being part of a cycle.  Since the LIM information is always optional,
+and in that case would be useless, breaking the chain in this way causes no
+problems.
+@<Create a LIM chain@> =
+{
+  NSYID postdot_nsyid_of_lim_to_process
+    = Postdot_NSYID_of_LIM (lim_to_process);
+  lim_chain_ix = 0;
+  r->t_lim_chain[lim_chain_ix++] = LIM_of_PIM (lim_to_process);
+  bv_bit_clear (bv_ok_for_chain,
+                postdot_nsyid_of_lim_to_process);
+  /* Make sure this LIM
+     is not added to a LIM chain again for this Earley set */
+  while (1)
     {
-      if (!XSY_is_Terminal(tkn)) {
-          MARPA_ERROR(MARPA_ERR_TOKEN_IS_NOT_TERMINAL);
-          return MARPA_ERR_TOKEN_IS_NOT_TERMINAL;
-      }
-      if (lbv_bit_test(r->t_valued_locked, tkn_xsy_id)) {
-          MARPA_ERROR(MARPA_ERR_SYMBOL_VALUED_CONFLICT);
-          return MARPA_ERR_SYMBOL_VALUED_CONFLICT;
-      }
-      lbv_bit_set(r->t_valued_locked, tkn_xsy_id);
-      lbv_bit_set(r->t_unvalued_terminal, tkn_xsy_id);
-      lbv_bit_set(r->t_unvalued, tkn_xsy_id);
+    @t}\comment{@>
+      /* I know at this point that
+       |predecessor_lim| is unpopulated, so I also know that
+       |lim_to_process| is unpopulated.  This means I also know that
+       |lim_to_process| is in the current Earley set, because all LIMs
+       in previous Earley sets are already
+       populated.
+       */
+      lim_to_process = predecessor_lim;
+      postdot_nsyid_of_lim_to_process = Postdot_NSYID_of_LIM (lim_to_process);
+      if (!bv_bit_test
+          (bv_ok_for_chain, postdot_nsyid_of_lim_to_process))
+        {
+          /* If I am about to add a previously added LIM to the LIM chain, I
+             break the LIM chain at this point.
+             The predecessor LIM has not yet been changed,
+             so that it is still appropriate for
+             the LIM at the top of the chain.  */
+          break;
+        }
+
+      @<Find predecessor LIM of unpopulated LIM@>@;
+
+      r->t_lim_chain[lim_chain_ix++] = LIM_of_PIM (lim_to_process);
+      /* |lim_to_process| is not populated, as shown above */
+
+      bv_bit_clear (bv_ok_for_chain,
+                    postdot_nsyid_of_lim_to_process);
+      /* Make sure this LIM
+         is not added to a LIM chain again for this Earley set */
+    @t}\comment{@>
+        /* |predecesssor_lim = NULL|,
+       so that we are forced to break the LIM chain before it */
+      if (!predecessor_lim)
+        break;
+      if (LIM_is_Populated (predecessor_lim))
+        break;
+      /* |predecesssor_lim| is populated, so that if we
+         break before |predecessor_lim|, we are ready to populate the entire LIM
+         chain. */
     }
 }
 
-@ @<Set |target_earleme| or fail@> = {
-    target_earleme = current_earleme + length;
-    if (target_earleme >= JEARLEME_THRESHOLD) {
-        MARPA_ERROR(MARPA_ERR_PARSE_TOO_LONG);
-        return MARPA_ERR_PARSE_TOO_LONG;
+@ @<Populate the LIMs in the LIM chain@> =
+for (lim_chain_ix--; lim_chain_ix >= 0; lim_chain_ix--) {
+    lim_to_process = r->t_lim_chain[lim_chain_ix];
+    if (predecessor_lim && LIM_is_Populated(predecessor_lim)) {
+        @<Populate |lim_to_process| from |predecessor_lim|@>@;
+    } else {
+        @<Populate |lim_to_process| from its base Earley item@>@;
     }
+    predecessor_lim = lim_to_process;
 }
 
-@ If no postdot item is found at the current Earley set for this
-item, the token ID is unexpected, and |soft_failure| is returned.
-The application can treat this as a fatal error.
-The application can also use this as a mechanism to test alternatives,
-in which case, returning |soft_failure| is a perfectly normal data path.
-This last is part of an important technique:
-``Ruby Slippers" parsing.
-@ Another case of an ``unexpected'' token is an inaccessible one.
-(A terminal must be productive but can be inaccessible.)
-Inaccessible tokens will not have an NSY and,
-since they don't derive from the start symbol,
-are always unexpected.
-@<Set |current_earley_set|, failing if token is unexpected@> =
+@ This code is optimized for cases where there are no events,
+or the lists of AHM IDs is "at closure".
+These are the most frequent and worst case scenarios.
+The new remaining "worst case" is a recursive series of AHM ID's
+which stabilizes short of closure.
+Secondary optimzations ensure this is fairly cheap as well.
+@<Populate |lim_to_process| from |predecessor_lim|@> =
 {
-  NSY tkn_nsy = NSY_by_XSYID (tkn_xsy_id);
-  if (_MARPA_UNLIKELY (!tkn_nsy))
-    {
-      MARPA_ERROR (MARPA_ERR_INACCESSIBLE_TOKEN);
-      return MARPA_ERR_INACCESSIBLE_TOKEN;
+  const AHM new_top_ahm = Top_AHM_of_LIM (predecessor_lim);
+  const CIL predecessor_cil = CIL_of_LIM (predecessor_lim);
+    @t}\comment{@>
+  /* Initialize to be just the predcessor's list of AHM IDs.
+       Overwrite if we need to add another. */
+  CIL_of_LIM (lim_to_process) = predecessor_cil;
+  Predecessor_LIM_of_LIM (lim_to_process) = predecessor_lim;
+  Origin_of_LIM (lim_to_process) = Origin_of_LIM (predecessor_lim);
+  if (Event_Group_Size_of_AHM (new_top_ahm) > Count_of_CIL (predecessor_cil))
+    {                           /* Might we need to add another AHM ID? */
+      const AHM trailhead_ahm = Trailhead_AHM_of_LIM(lim_to_process);
+      const CIL trailhead_ahm_event_ahmids =
+        Event_AHMIDs_of_AHM (trailhead_ahm);
+      if (Count_of_CIL (trailhead_ahm_event_ahmids))
+        {
+          CIL new_cil = cil_merge_one (&r->t_cilar, predecessor_cil,
+                                       Item_of_CIL
+                                       (trailhead_ahm_event_ahmids, 0));
+          if (new_cil)
+            {
+              CIL_of_LIM (lim_to_process) = new_cil;
+            }
+        }
     }
-  tkn_nsyid = ID_of_NSY (tkn_nsy);
-  current_earley_set = YS_at_Current_Earleme_of_R (r);
-  if (!current_earley_set)
-    {
-      MARPA_ERROR (MARPA_ERR_NO_TOKEN_EXPECTED_HERE);
-      return MARPA_ERR_NO_TOKEN_EXPECTED_HERE;
+  Top_AHM_of_LIM (lim_to_process) = new_top_ahm;
+}
+
+@ If we have reached this code, either we do not have a predecessor
+LIM, or we have one which is useless for populating |lim_to_process|.
+If a predecessor LIM is not itself populated, it will be useless
+for populating its successor.
+An unpopulated predecessor LIM
+may occur when there is a predecessor LIM
+which proved impossible to populate because it is part of a cycle.
+@ The predecessor LIM and the top AHM to-state were initialized
+to the appropriate values for this case,
+and do not need to be changed.
+The predecessor LIM was initialized to |NULL|.
+of the base YIM.
+@<Populate |lim_to_process| from its base Earley item@> = {
+  const AHM trailhead_ahm = Trailhead_AHM_of_LIM(lim_to_process);
+  const YIM base_yim = Trailhead_YIM_of_LIM(lim_to_process);
+  Origin_of_LIM (lim_to_process) = Origin_of_YIM (base_yim);
+  CIL_of_LIM(lim_to_process) = Event_AHMIDs_of_AHM(trailhead_ahm);
+}
+
+@ @<Copy PIM workarea to postdot item array@> = {
+    PIM *postdot_array
+        = current_earley_set->t_postdot_ary
+        = marpa_obs_new (r->t_ys_obs, PIM, current_earley_set->t_postdot_sym_count );
+    int min, max, start;
+    int postdot_array_ix = 0;
+    r->t_postdot_array_bytes +=
+      sizeof (PIM) * (size_t) current_earley_set->t_postdot_sym_count;
+    for (start = 0; bv_scan (r->t_bv_pim_symbols, start, &min, &max); start = max + 2) {
+        NSYID nsyid;
+        for (nsyid = min; nsyid <= max; nsyid++) {
+            PIM this_pim = r->t_pim_workarea[nsyid];
+            if (lbv_bit_test(r->t_nsy_expected_is_event, nsyid)) {
+              XSY xsy = Source_XSY_of_NSYID(nsyid);
+              r_int_event_new (r, MARPA_EVENT_SYMBOL_EXPECTED, ID_of_XSY(xsy));
+            }
+            if (this_pim) postdot_array[postdot_array_ix++] = this_pim;
+        }
     }
-  if (!First_PIM_of_YS_by_NSYID (current_earley_set, tkn_nsyid))
-    {
-      MARPA_ERROR (MARPA_ERR_UNEXPECTED_TOKEN_ID);
-      return MARPA_ERR_UNEXPECTED_TOKEN_ID;
+    if (r->t_use_postdot_index) {
+        postdot_index_create(r, current_earley_set);
     }
 }
 
-@ Insert an alternative into the alternatives stack,
-detecting if we are attempting to add the same token twice.
-Two tokens are considered the same if
-\li they have the same token ID, and
-\li they have the same length, and
-\li they have the same origin.
-Because $|origin|+|token_length| = |current_earleme|$,
-Two tokens at the same current earleme are the same if they
-have the same token ID and origin.
-By the same equation,
-two tokens at the same current earleme are the same if they
-have the same token ID and token length.
-It is up to the higher layers to determine if rejection
-of a duplicate token is a fatal error.
-The Earley sets and items will not have been
-altered by the attempt.
-@<Insert alternative into stack, failing if token is duplicate@> =
+@ The index is built from the postdot array,
+so that the ranks agree with the
+postdot array's order, which is by NSYID.
+It is also used to rebuild the indexes of a restored
+recognizer.
+@<Function definitions@> =
+PRIVATE void
+postdot_index_create (RECCE r, YS set)
 {
-  ALT_Object alternative_object; /* This is safe on the stack,
-  because |alternative_insert()| will copy it if it is actually
-  going to be used */
-  const ALT alternative = &alternative_object;
-  NSYID_of_ALT (alternative) = tkn_nsyid;
-  Value_of_ALT (alternative) = value;
-  ALT_is_Valued(alternative) = value ? 1 : 0;
-  if (Furthest_Earleme_of_R (r) < target_earleme)
-    Furthest_Earleme_of_R (r) = target_earleme;
-  alternative->t_start_earley_set = current_earley_set;
-  End_Earleme_of_ALT(alternative) = target_earleme;
-  if (alternative_insert (r, alternative) < 0)
-    {
-      MARPA_ERROR (MARPA_ERR_DUPLICATE_TOKEN);
-      return MARPA_ERR_DUPLICATE_TOKEN;
-    }
+  @<Unpack recognizer objects@>@;
+  const int index_size =
+    Postdot_Index_Size_of_NSY_Count (NSY_Count_of_G (g));
+  set->t_postdot_index = marpa_obs_new (r->t_ys_obs, LBW, index_size);
+  r->t_postdot_array_bytes += sizeof (LBW) * (size_t) index_size;
+  postdot_index_fill (r, set);
 }
 
-@** Complete an Earley set.
-In the Aycock-Horspool variation of Earley's algorithm,
-the two main phases are scanning and completion.
-This section is devoted to the logic for completion.
-@d Work_YIMs_of_R(r) MARPA_DSTACK_BASE((r)->t_yim_work_stack, YIM)
-@d Work_YIM_Count_of_R(r) MARPA_DSTACK_LENGTH((r)->t_yim_work_stack)
-@d WORK_YIMS_CLEAR(r) MARPA_DSTACK_CLEAR((r)->t_yim_work_stack)
-@d WORK_YIM_PUSH(r) MARPA_DSTACK_PUSH((r)->t_yim_work_stack, YIM)
-@d WORK_YIM_ITEM(r, ix) (*MARPA_DSTACK_INDEX((r)->t_yim_work_stack, YIM, ix))
-@<Widely aligned recognizer elements@> = MARPA_DSTACK_DECLARE(t_yim_work_stack);
-@ @<Initialize recognizer elements@> = MARPA_DSTACK_SAFE(r->t_yim_work_stack);
-@ @<Initialize Earley item work stacks@> =
+@ Fill in the postdot index of |set| from its postdot array.
+This is done in place when postdot items are removed
+from the array,
+as happens when Earley sets are released.
+@<Function definitions@> =
+PRIVATE void
+postdot_index_fill (RECCE r, YS set)
 {
-  if (!MARPA_DSTACK_IS_INITIALIZED (r->t_yim_work_stack))
+  @<Unpack recognizer objects@>@;
+  const int nsy_count = NSY_Count_of_G (g);
+  const int index_size = Postdot_Index_Size_of_NSY_Count (nsy_count);
+  PIM *const postdot_array = set->t_postdot_ary;
+  const int postdot_sym_count = Postdot_SYM_Count_of_YS (set);
+  LBW *const postdot_index = set->t_postdot_index;
+  int word_ix;
+  int postdot_array_ix;
+  LBW rank = 0;
+  for (word_ix = 0; word_ix < index_size; word_ix += 2)
+    postdot_index[word_ix] = 0;
+  for (postdot_array_ix = 0; postdot_array_ix < postdot_sym_count;
+       postdot_array_ix++)
     {
-      MARPA_DSTACK_INIT2 (r->t_yim_work_stack, YIM);
+      const NSYID nsyid =
+        Postdot_NSYID_of_PIM (postdot_array[postdot_array_ix]);
+      postdot_index[((LBW) nsyid / lbv_wordbits) * 2] |= lbv_b ((LBW) nsyid);
     }
-}
-@ @<Destroy recognizer elements@> = MARPA_DSTACK_DESTROY(r->t_yim_work_stack);
-
-@ The completion stack is initialized to a very high-ball estimate of the
-number of completions per Earley set.
-It will grow if needed.
-Large stacks may needed for very ambiguous grammars.
-@<Widely aligned recognizer elements@> = MARPA_DSTACK_DECLARE(t_completion_stack);
-@ @<Initialize recognizer elements@> = MARPA_DSTACK_SAFE(r->t_completion_stack);
-@ @<Initialize Earley item work stacks@> =
-{
-  if (!MARPA_DSTACK_IS_INITIALIZED (r->t_completion_stack))
+  for (word_ix = 0; word_ix < index_size; word_ix += 2)
     {
-      MARPA_DSTACK_INIT2 (r->t_completion_stack, YIM);
+      postdot_index[word_ix + 1] = rank;
+      rank += (LBW) lbw_popcount (postdot_index[word_ix]);
     }
 }
-@ @<Destroy recognizer elements@> = MARPA_DSTACK_DESTROY(r->t_completion_stack);
 
-@ @<Widely aligned recognizer elements@> = MARPA_DSTACK_DECLARE(t_earley_set_stack);
-@ @<Initialize recognizer elements@> = MARPA_DSTACK_SAFE(r->t_earley_set_stack);
-@ @<Destroy recognizer elements@> = MARPA_DSTACK_DESTROY(r->t_earley_set_stack);
 
-@ This function returns the number of terminals expected on success.
-On failure, it returns |-2|.
-If the completion of the earleme left the parse exhausted, 0 is
-returned.
-@
-If the completion of the earleme left the parse exhausted, 0 is returned.
-The converse is not true -- when tokens may be longer than one earleme,
-zero may be returned even if the parse is not exhausted.
-In those alternative input models, it is possible that no terminals are
-expected at the current earleme, but other terminals might be expected
-at later earlemes.
-That means that the parse can be continued ---
-it is not exhausted.
-In those alternative input models,
-if the distinction between zero terminals expected and an
-exhausted parse is significant to the higher layers,
-they must explicitly check the phase whenever this function
-returns zero.
+@** Rejecting Earley items.
+@ Notes for making the recognizer consistent after rejecting tokens:
+\li Clear all events.  Document that you should poll events before any
+rejections.
+\li Reset the vector of expected terminals.
+\li Re-determine if the parse is exhausted.
+\li What about postdot items?  If a LIM is now rejected, I should look
+at the YIM/PIM, I think, because it was {\bf not} necessarily rejected.
+
+@ Various notes about revision:
+\li I need to make sure that the reading of alternatives
+and the rejection of rules and terminals cannot be mixed.
+Rejected must be made, and revision complete, before any
+alternatives can be attempted.
+Or, in other words, attempting to reject a rule or terminal
+once an alternative has been read must be a fatal error.
 @<Function definitions@> =
-int
-marpa_r_earleme_complete(Marpa_Recognizer r)
+Marpa_Earleme
+marpa_r_clean(Marpa_Recognizer r)
 {
   @<Return |-2| on failure@>@;
   @<Unpack recognizer objects@>@;
-  YIM* cause_p;
-  YS current_earley_set;
-  JEARLEME current_earleme;
+  YSID ysid_to_clean;
+
+    @t}\comment{@>
+  const YS current_ys = Latest_YS_of_R (r);
+  const YSID current_ys_id = Ord_of_YS(current_ys);
+
+  int count_of_expected_terminals;
+  @<Declare |marpa_r_clean| locals@>@;
+
+    @t}\comment{@>
+  /* Initialized to -2 just in case.
+    Should be set before returning;
+   */
+  const JEARLEME return_value = -2;
+
+  @<Fail if recognizer not accepting input@>@;
+
+  R_EVENTS_CLEAR(r);
+
+  @t}\comment{@>
+  /* Return success if recognizer is already consistent */
+  if (R_is_Consistent(r)) return 0;
+
+  @<Fail if recognizer has a lazy bocage@>@;
 
     @t}\comment{@>
-  /* Initialized to -2 just in case.
-    Should be set before returning;
-   */
-  JEARLEME return_value = -2;
+    /* Note this makes revision $O(n \log n)$.  I could do better
+       for constant "look-behind", but it does not seem worth the
+       bother */
+  earley_set_update_items(r, current_ys);
 
-  @<Fail if recognizer not accepting input@>@;
-  if (_MARPA_UNLIKELY(!R_is_Consistent(r))) {
-      MARPA_ERROR(MARPA_ERR_RECCE_IS_INCONSISTENT);
-      return failure_indicator;
+  for (ysid_to_clean = First_Inconsistent_YS_of_R(r);
+        ysid_to_clean <= current_ys_id;
+        ysid_to_clean++) {
+      @<Clean Earley set |ysid_to_clean|@>@;
   }
 
-  {
-    int count_of_expected_terminals;
-    @<Declare |marpa_r_earleme_complete| locals@>@;
-    G_EVENTS_CLEAR(g);
-    psar_dealloc(Dot_PSAR_of_R(r));
-    bv_clear (r->t_bv_nsyid_is_expected);
-    bv_clear (r->t_bv_irl_seen);
-    @<Initialize |current_earleme|@>@;
-    @<Return 0 if no alternatives@>@;
-    @<Initialize |current_earley_set|@>@;
-    @<Scan from the alternative stack@>@;
-    @<Pre-populate the completion stack@>@;
-    while ((cause_p = MARPA_DSTACK_POP(r->t_completion_stack, YIM))) {
-      YIM cause = *cause_p;
-        @<Add new Earley items for |cause|@>@;
-    }
-    @<Add predictions to |current_earley_set|@>@;
-    postdot_items_create(r, bv_ok_for_chain, current_earley_set);
+  @t}\comment{@>
+  /* All Earley sets are now consistent */
 
-    @t}\comment{@>
-      /* If no terminals are expected, and there are no Earley items in
-           uncompleted Earley sets, we can make no further progress.
-           The parse is ``exhausted". */
+    @<Clean pending alternatives@>@;
+
+    bv_clear (r->t_bv_nsyid_is_expected);
+    @<Clean expected terminals@>@;
     count_of_expected_terminals = bv_count (r->t_bv_nsyid_is_expected);
     if (count_of_expected_terminals <= 0
-       && MARPA_DSTACK_LENGTH (r->t_alternatives ) <= 0)
+       && ALT_Count_of_R(r) <= 0)
       {
         @<Set |r| exhausted@>@;
       }
-    earley_set_update_items(r, current_earley_set);
-    if (r->t_active_event_count > 0) {
-        trigger_events(r);
-    }
-    return_value = G_EVENT_COUNT(g);
-    CLEANUP: ;
-    @<Destroy |marpa_r_earleme_complete| locals@>@;
-  }
+
+  First_Inconsistent_YS_of_R(r) = -1;
+  /* CLEANUP: ; -- not used at the moment */
+    @<Destroy |marpa_r_clean| locals@>@;
   return return_value;
 }
 
-@ Currently, |earleme_complete_obs| is only used for completion events,
-and so should only be initialized if they are in use.
-But I expect to use it for other purposes.
-@<Declare |marpa_r_earleme_complete| locals@> =
-    const NSYID nsy_count = NSY_Count_of_G(g);
-    Bit_Vector bv_ok_for_chain = bv_create(nsy_count);
-    struct marpa_obstack* const earleme_complete_obs = marpa_obs_init;
-@ @<Destroy |marpa_r_earleme_complete| locals@> =
-    bv_free(bv_ok_for_chain);
-    marpa_obs_free( earleme_complete_obs );
-
-@ @<Initialize |current_earleme|@> = {
-  current_earleme = ++(Current_Earleme_of_R(r));
-  if (current_earleme > Furthest_Earleme_of_R (r))
-    {
-        @<Set |r| exhausted@>@;
-        MARPA_ERROR(MARPA_ERR_PARSE_EXHAUSTED);
-        return_value = failure_indicator;
-        goto CLEANUP;
-     }
-}
+@ @<Declare |marpa_r_clean| locals@> =
 
-@ Create a new Earley set.  We know that it does not
-exist.
-@<Initialize |current_earley_set|@> = {
-    current_earley_set = earley_set_new (r, current_earleme);
-    Next_YS_of_YS(Latest_YS_of_R(r)) = current_earley_set;
-    Latest_YS_of_R(r) = current_earley_set;
-}
+@t}\comment{@>
+/* An obstack whose lifetime is that of the external method */
+struct marpa_obstack* const method_obstack = marpa_obs_init;
 
-@ If there are no alternatives for this earleme
-return 0 without creating an
-Earley set.
-The return value means success, with no events.
-@<Return 0 if no alternatives@> = {
-  ALT end_of_stack = MARPA_DSTACK_TOP (r->t_alternatives, ALT_Object);
-  if (!end_of_stack || current_earleme != End_Earleme_of_ALT (end_of_stack))
-    {
-      return_value = 0;
-      goto CLEANUP;
-    }
-}
+YIMID *prediction_by_irl =
+  marpa_obs_new (method_obstack, YIMID, IRL_Count_of_G (g));
 
-@ @<Scan from the alternative stack@> =
+@ @<Destroy |marpa_r_clean| locals@> =
 {
-  ALT alternative;
-    @t}\comment{@>
-    /* |alternative_pop()| does not return inactive alternatives */
-  while ((alternative = alternative_pop (r, current_earleme)))
-    @<Scan an Earley item from alternative@>@;
+  marpa_obs_free(method_obstack);
 }
 
-@ The consequences of ignoring Leo items here is that a right
-recursion is always fully expanded when the cause of the Leo
-trailhead is a terminal.
-That's usually desireable, because a terminal at the bottom of the
-Leo trail is usually a sign that this is the trail that will be
-used in the parse.
-@ But there are exceptions.  These can occur in input models with
-ambiguous terminals, and when LHS terminals are used.
-These cases are not considered in the complexity claims,
-and as of this writing are not important in practical terms.
-@<Scan an Earley item from alternative@> =
+@ @<Clean Earley set |ysid_to_clean|@> =
 {
-  YS start_earley_set = Start_YS_of_ALT (alternative);
-  PIM pim = First_PIM_of_YS_by_NSYID (start_earley_set,
-    NSYID_of_ALT(alternative));
-  for (; pim; pim = Next_PIM_of_PIM (pim))
-    {
-      @t}\comment{@>
-      /* Ignore Leo items when scanning */
-      const YIM predecessor = YIM_of_PIM (pim);
-      if (predecessor && YIM_is_Active(predecessor))
-	{
-	  const AHM predecessor_ahm = AHM_of_YIM (predecessor);
-	  const AHM scanned_ahm = Next_AHM_of_AHM (predecessor_ahm);
-	  @<Create the earley items for |scanned_ahm|@>@;
-	}
-    }
+  const YS ys_to_clean = YS_of_R_by_Ord (r, ysid_to_clean);
+  const YIM *yims_to_clean = YIMs_of_YS (ys_to_clean);
+  const int yim_to_clean_count = YIM_Count_of_YS (ys_to_clean);
+  Bit_Matrix acceptance_matrix = matrix_obs_create (method_obstack,
+    yim_to_clean_count,
+    yim_to_clean_count);
+  @<Map prediction rules to YIM ordinals in array@>@;
+  @<First revision pass over |ys_to_clean|@>@;
+  transitive_closure(acceptance_matrix);
+  @<Mark accepted YIM's@>@;
+  @<Mark un-accepted YIM's rejected@>@;
+  @<Mark accepted SRCL's@>@;
+  @<Mark rejected LIM's@>@;
 }
 
-@ @<Create the earley items for |scanned_ahm|@> =
+@ Rules not used in this YS
+do not need to be initialized because they
+will never be referred to.
+@<Map prediction rules to YIM ordinals in array@> =
 {
-  const YIM scanned_earley_item = earley_item_assign (r,
-						      current_earley_set,
-						      Origin_of_YIM
-						      (predecessor),
-						      scanned_ahm);
-  YIM_was_Scanned(scanned_earley_item) = 1;
-  tkn_link_add (r, scanned_earley_item, predecessor, alternative);
-}
+    int yim_ix = yim_to_clean_count - 1;
+    YIM yim = yims_to_clean[yim_ix];
 
-@ At this point we know that only scanned items newly added
-are on the YIM working stack.
-Since they are newly added, and would not have been added
-if they were not active, we know that the YIM's on the working stack
-are all active.
-@<Pre-populate the completion stack@> = {
     @t}\comment{@>
-    /* We know that no new items are added to the stack in this scope */
-    YIM* work_earley_items = MARPA_DSTACK_BASE (r->t_yim_work_stack, YIM );
-    int no_of_work_earley_items = MARPA_DSTACK_LENGTH (r->t_yim_work_stack );
-    int ix;
-    MARPA_DSTACK_CLEAR(r->t_completion_stack);
-    for (ix = 0;
-         ix < no_of_work_earley_items;
-         ix++) {
-        YIM earley_item = work_earley_items[ix];
-        YIM* end_of_stack;
-        if (!YIM_is_Completion (earley_item))
-          continue;
-        end_of_stack = MARPA_DSTACK_PUSH (r->t_completion_stack, YIM);
-        *end_of_stack = earley_item;
-      }
-    }
-
-@ For the current completion cause,
-add those Earley items it ``causes".
-@<Add new Earley items for |cause|@> =
-{
-  if (YIM_is_Active(cause) && YIM_is_Completion(cause))
-    {
-      NSYID complete_nsyid = LHS_NSYID_of_YIM(cause);
-      const YS middle = Origin_of_YIM (cause);
-      @<Add new Earley items for |complete_nsyid| and |cause|@>@;
+    /* Assumes that predictions are last in the YS.
+    There will always be a non-prediction to end the loop,
+    because there is always a scanned or an initial YIM.
+    */
+    while (YIM_was_Predicted(yim)) {
+      prediction_by_irl[IRLID_of_YIM(yim)] = yim_ix;
+      yim = yims_to_clean[--yim_ix];
     }
 }
 
-@ @<Add new Earley items for |complete_nsyid| and |cause|@> =
-{
-  PIM postdot_item;
-  for (postdot_item = First_PIM_of_YS_by_NSYID (middle, complete_nsyid);
-       postdot_item; postdot_item = Next_PIM_of_PIM (postdot_item))
-    {
-      const YIM predecessor = YIM_of_PIM (postdot_item);
-      if (!predecessor) {
-           @t}\comment\hskip 1em{@>
-           /* A Leo item */
-           const LIM leo_item = LIM_of_PIM (postdot_item);
-
-           @t}\comment\hskip 1em{@>
-           /* A Leo item */
-           /* If the Leo item is not active, look at the other
-           item in the PIM, which might be active.  (There should be
-           exactly one other item, and it might be active if the LIM
-           was inactive because of its predecessor, but had
-           an active Leo trailhead */
-           if (!LIM_is_Active(leo_item)) goto NEXT_PIM;
-
-           @<Add effect of |leo_item|@>@;
-
-           @t}\comment\hskip 1em{@>
-           /* When I encounter an active Leo item,
-           I skip everything else for this postdot symbol */
-          goto LAST_PIM;
-      } else {
-            @t}\comment\hskip 1em{@>
-            /* Not a Leo item */
-            if (!YIM_is_Active(predecessor)) continue;
+@ @<First revision pass over |ys_to_clean|@> = {
+    int yim_to_clean_ix;
+    for (yim_to_clean_ix = 0;
+         yim_to_clean_ix < yim_to_clean_count;
+         yim_to_clean_ix++)
+      {
+        const YIM yim_to_clean = yims_to_clean[yim_to_clean_ix];
 
-            @t}\comment\hskip 1em{@>
-            /* If we are here, both cause and predecessor are active */
-            @<Add |effect_ahm| for non-Leo |predecessor|@>@;
-        }
-        NEXT_PIM: ;
-    }
-    LAST_PIM: ;
-}
+        @t}\comment{@>
+        /* The initial YIM is always active and can {\bf never}
+        be rejected. */
+        MARPA_ASSERT (!YIM_is_Initial(yim_to_clean) ||
+            (YIM_is_Active(yim_to_clean) && !YIM_is_Rejected(yim_to_clean)));
 
-@ @<Add |effect_ahm| for non-Leo |predecessor|@> =
-{
-   const AHM predecessor_ahm = AHM_of_YIM(predecessor);
-   const AHM effect_ahm = Next_AHM_of_AHM(predecessor_ahm);
-   const YS origin = Origin_of_YIM(predecessor);
-   const YIM effect = earley_item_assign(r, current_earley_set,
-        origin, effect_ahm);
-   YIM_was_Fusion(effect) = 1;
-   if (Earley_Item_has_No_Source(effect)) {
-       @t}\comment{@>
-       /* If it has no source, then it is new */
-       if (YIM_is_Completion(effect)) {
-           @<Push |effect| onto completion stack@>@;
-       }
-   }
-   completion_link_add(r, effect, predecessor, cause);
-}
+        @t}\comment{@>
+        /* Non-initial YIM's are inactive until proven active. */
+        if (!YIM_is_Initial(yim_to_clean)) YIM_is_Active(yim_to_clean) = 0;
 
-@ The context must make sure any YIM pushed on the stack is
-active.
-@<Push |effect| onto completion stack@> = {
-    YIM* end_of_stack = MARPA_DSTACK_PUSH (r->t_completion_stack, YIM);
-    *end_of_stack = effect;
-}
+        @t}\comment{@>
+        /* If a YIM is rejected, which at this point means that it
+        was directly rejected, that is the end of the story.
+        We don't use it to update
+        the acceptance matrix.  */
+        if (YIM_is_Rejected(yim_to_clean)) continue;
 
-@ If we are here, |leo_item| is active.
-@<Add effect of |leo_item|@> = {
-    const YS origin = Origin_of_LIM (leo_item);
-    const AHM effect_ahm = Top_AHM_of_LIM (leo_item);
-    const YIM effect = earley_item_assign (r, current_earley_set,
-                                 origin, effect_ahm);
-    YIM_was_Fusion(effect) = 1;
-    if (Earley_Item_has_No_Source (effect))
-      {
         @t}\comment{@>
-        /* If it has no source, then it is new */
-        @<Push |effect| onto completion stack@>@;
+        /* Add un-rejected predictions to acceptance matrix. */
+        @<Add predictions from |yim_to_clean| to acceptance matrix@>@;
+
+        @t}\comment{@>
+        /* YIM's may have both scanned and fusion links.
+        Change the following so it looks at both kinds of link
+        for all YIM's. */
+
       }
-    leo_link_add (r, effect, leo_item, cause);
 }
 
-@ @<Add predictions to |current_earley_set|@> =
+@ @<Add predictions from |yim_to_clean| to acceptance matrix@> =
 {
-  int ix;
-  const int no_of_work_earley_items =
-    MARPA_DSTACK_LENGTH (r->t_yim_work_stack);
-  for (ix = 0; ix < no_of_work_earley_items; ix++)
+  const NSYID postdot_nsyid = Postdot_NSYID_of_YIM (yim_to_clean);
+  if (postdot_nsyid >= 0)
     {
-      YIM earley_item = WORK_YIM_ITEM (r, ix);
-
       int cil_ix;
-      const AHM ahm = AHM_of_YIM (earley_item);
-      const CIL prediction_cil = Predicted_IRL_CIL_of_AHM (ahm);
-      const int prediction_count = Count_of_CIL (prediction_cil);
-      for (cil_ix = 0; cil_ix < prediction_count; cil_ix++)
+      const CIL lhs_cil = LHS_CIL_of_NSYID (postdot_nsyid);
+      const int cil_count = Count_of_CIL (lhs_cil);
+      for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
 	{
-	  const IRLID prediction_irlid = Item_of_CIL (prediction_cil, cil_ix);
-	  const IRL prediction_irl = IRL_by_ID (prediction_irlid);
-	  const AHM prediction_ahm = First_AHM_of_IRL (prediction_irl);
-	  earley_item_assign (r, current_earley_set, current_earley_set,
-			      prediction_ahm);
+	  const IRLID irlid = Item_of_CIL (lhs_cil, cil_ix);
+	  const int predicted_yim_ix = prediction_by_irl[irlid];
+          const YIM predicted_yim = yims_to_clean[predicted_yim_ix];
+          if (YIM_is_Rejected(predicted_yim)) continue;
+	  matrix_bit_set (acceptance_matrix, yim_to_clean_ix,
+			  predicted_yim_ix);
 	}
-
     }
 }
 
-@ @<Function definitions@> =
-PRIVATE void trigger_events(RECCE r)
-{
-  const GRAMMAR g = G_of_R (r);
-  const YS current_earley_set = Latest_YS_of_R (r);
-  int min, max, start;
-  int yim_ix;
-  struct marpa_obstack *const trigger_events_obs = marpa_obs_init;
-  const YIM *yims = YIMs_of_YS (current_earley_set);
-  const XSYID xsy_count = XSY_Count_of_G (g);
-  const int ahm_count = AHM_Count_of_G (g);
-  Bit_Vector bv_completion_event_trigger =
-    bv_obs_create (trigger_events_obs, xsy_count);
-  Bit_Vector bv_nulled_event_trigger =
-    bv_obs_create (trigger_events_obs, xsy_count);
-  Bit_Vector bv_prediction_event_trigger =
-    bv_obs_create (trigger_events_obs, xsy_count);
-  Bit_Vector bv_ahm_event_trigger =
-    bv_obs_create (trigger_events_obs, ahm_count);
-  const int working_earley_item_count = YIM_Count_of_YS (current_earley_set);
-  for (yim_ix = 0; yim_ix < working_earley_item_count; yim_ix++)
-    {
-      const YIM yim = yims[yim_ix];
-      const AHM root_ahm = AHM_of_YIM (yim);
-      if (AHM_has_Event (root_ahm))
-        {                       /* Note that we go on to look at the Leo path, even if
-                                   the top AHM is not an event AHM */
-          bv_bit_set (bv_ahm_event_trigger, ID_of_AHM(root_ahm));
-        }
-      {
-        /* Now do the NSYs for any Leo links */
-        const SRCL first_leo_source_link = First_Leo_SRCL_of_YIM (yim);
-        SRCL setup_source_link;
-        for (setup_source_link = first_leo_source_link; setup_source_link;
-             setup_source_link = Next_SRCL_of_SRCL (setup_source_link))
-          {
-            int cil_ix;
-            const LIM lim = LIM_of_SRCL (setup_source_link);
-            const CIL event_ahmids = CIL_of_LIM (lim);
-            const int event_ahm_count = Count_of_CIL (event_ahmids);
-            for (cil_ix = 0; cil_ix < event_ahm_count; cil_ix++)
-              {
-                const NSYID leo_path_ahmid =
-                  Item_of_CIL (event_ahmids, cil_ix);
-                bv_bit_set (bv_ahm_event_trigger, leo_path_ahmid);
-                /* No need to test if AHM is an event AHM --
-                   all paths in the LIM's CIL will be */
-              }
-          }
-      }
-    }
-
-  for (start = 0; bv_scan (bv_ahm_event_trigger, start, &min, &max);
-       start = max + 2)
-    {
-      XSYID event_ahmid;
-      for (event_ahmid = (NSYID) min; event_ahmid <= (NSYID) max;
-           event_ahmid++)
-        {
-          int cil_ix;
-          const AHM event_ahm = AHM_by_ID(event_ahmid);
-          {
-            const CIL completion_xsyids =
-              Completion_XSYIDs_of_AHM (event_ahm);
-            const int event_xsy_count = Count_of_CIL (completion_xsyids);
-            for (cil_ix = 0; cil_ix < event_xsy_count; cil_ix++)
-              {
-                XSYID event_xsyid = Item_of_CIL (completion_xsyids, cil_ix);
-                bv_bit_set (bv_completion_event_trigger, event_xsyid);
-              }
-          }
-          {
-            const CIL nulled_xsyids = Nulled_XSYIDs_of_AHM (event_ahm);
-            const int event_xsy_count = Count_of_CIL (nulled_xsyids);
-            for (cil_ix = 0; cil_ix < event_xsy_count; cil_ix++)
-              {
-                XSYID event_xsyid = Item_of_CIL (nulled_xsyids, cil_ix);
-                bv_bit_set (bv_nulled_event_trigger, event_xsyid);
-              }
-          }
-          {
-            const CIL prediction_xsyids =
-              Prediction_XSYIDs_of_AHM (event_ahm);
-            const int event_xsy_count = Count_of_CIL (prediction_xsyids);
-            for (cil_ix = 0; cil_ix < event_xsy_count; cil_ix++)
-              {
-                XSYID event_xsyid = Item_of_CIL (prediction_xsyids, cil_ix);
-                bv_bit_set (bv_prediction_event_trigger, event_xsyid);
-              }
-          }
-        }
-    }
-
-  if (Ord_of_YS (current_earley_set) <= 0)
-    {
-      /* Because we special-case null parses, looking
-        at the Earley items of the first Earley
-        does not give us all the nulled symbols at
-        earleme 0.  If the parse can turn out to be zero length,
-        all nullables derived from the start symbol
-        (including itself) will be nulled,
-        and therefore all of them
-        should be null events at earleme 0. */
-      int cil_ix;
-      const XSY start_xsy = XSY_by_ID(g->t_start_xsy_id);
-      const CIL nulled_xsyids = Nulled_XSYIDs_of_XSY (start_xsy);
-      const int cil_count = Count_of_CIL (nulled_xsyids);
-      for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
-        {
-          const XSYID nulled_xsyid = Item_of_CIL (nulled_xsyids, cil_ix);
-          bv_bit_set (bv_nulled_event_trigger, nulled_xsyid);
-        }
-    }
+@ Mark YIM's not active if not scanned.
+If scanned, we can make a preliminary determination whether
+it is accepted based on
+the absence direct rejection and the presence of
+at least one unrejected token link.
+(A scanned YIM may have fusion links.)
+If this preliminary determination indicates that the
+scanned YIM is active, we mark it that way.
+@ We need the preliminary indication, because when we
+compute the accepted YIM's from
+the transition closure of acceptances, we need a set of YIM's
+as a starting point.
+In Earley set 0, the initial YIM is the starting point,
+but in all later sets, the scanned YIM's are the starting
+points.
+We know that
+every unrejected YIM will trace back, in its YS,
+to either the initial YIM or
+an unrejected token SRCL in an unrejected scanned YIM.
+@ A scanned YIM may have only rejected token SRCL's,
+but an accepted fusion SRCL.
+In effect, after the rejections, it is now a purely fusion
+YIM.
+We do not use
+such a now-purely-fusion, no-longer-scanned YIM as a
+starting point.
+We know this is safe, since
+in order to be accepted, every YIM must trace back to
+an unrejected YIM with unrejected token SRCL's,
+or to the initial YIM.
+@ If not rejected, scan SRCL's.
+For each SRCL, reject if predecessor or cause if rejected;
+otherwise, record as a dependency on cause.
+Add dependencies to acceptance matrix.
+If any dependency was recorded, also add any direct
+predictions of un-rejected YIM's.
 
-  for (start = 0; bv_scan (bv_completion_event_trigger, start, &min, &max);
-       start = max + 2)
-    {
-      XSYID event_xsyid;
-      for (event_xsyid = min; event_xsyid <= max;
-           event_xsyid++)
-        {
-          if (lbv_bit_test
-              (r->t_lbv_xsyid_completion_event_is_active, event_xsyid))
-            {
-              int_event_new (g, MARPA_EVENT_SYMBOL_COMPLETED, event_xsyid);
-            }
-        }
-    }
-  for (start = 0; bv_scan (bv_nulled_event_trigger, start, &min, &max);
-       start = max + 2)
-    {
-      XSYID event_xsyid;
-      for (event_xsyid = min; event_xsyid <= max;
-           event_xsyid++)
-        {
-          if (lbv_bit_test
-              (r->t_lbv_xsyid_nulled_event_is_active, event_xsyid))
-            {
-              int_event_new (g, MARPA_EVENT_SYMBOL_NULLED, event_xsyid);
-            }
+@ For every scanned or initial YIM in transitive closure,
+mark the to-YIM's of the dependency active.
+Mark all others rejected.
+@<Mark accepted YIM's@> = {
+    int cause_yim_ix;
+    for (cause_yim_ix = 0; cause_yim_ix < yim_to_clean_count; cause_yim_ix++) {
+      const YIM cause_yim = yims_to_clean[cause_yim_ix];
 
-        }
-    }
-  for (start = 0; bv_scan (bv_prediction_event_trigger, start, &min, &max);
-       start = max + 2)
-    {
-      XSYID event_xsyid;
-      for (event_xsyid = (NSYID) min; event_xsyid <= (NSYID) max;
-           event_xsyid++)
-        {
-          if (lbv_bit_test
-              (r->t_lbv_xsyid_prediction_event_is_active, event_xsyid))
-            {
-              int_event_new (g, MARPA_EVENT_SYMBOL_PREDICTED, event_xsyid);
-            }
-        }
-    }
-  marpa_obs_free (trigger_events_obs);
-}
+      @t}\comment{@>
+      /* We only need look at the indirect effects of
+      initial and scanned YIM's, because they are the indirect
+      cause of all other YIM's in the YS. */
+      if (!YIM_is_Initial(cause_yim) &&
+        !YIM_was_Scanned(cause_yim)) break;
 
-@ Trigger events for trivial grammars.
-A trivial grammar is one which only accepts
-the null string.
+      @t}\comment{@>
+      /* an indirect cause YIM may have been directly
+      rejected, if which cause we do not use it, but keep
+      looking for other indirect causes. */
+      if (YIM_is_Rejected(cause_yim)) continue;
 
-This code takes no special measure to ensure
-that the order of nulled events is the
-same as in the non-trivial case.
-No guarantee of the order should be documented.
-@<Function definitions@> =
-PRIVATE int trigger_trivial_events(RECCE r)
-{
-  int cil_ix;
-  int event_count = 0;
-  GRAMMAR g = G_of_R(r);
-  const XSY start_xsy = XSY_by_ID (g->t_start_xsy_id);
-  const CIL nulled_xsyids = Nulled_XSYIDs_of_XSY (start_xsy);
-  const int cil_count = Count_of_CIL (nulled_xsyids);
-  for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
-    {
-      const XSYID nulled_xsyid = Item_of_CIL (nulled_xsyids, cil_ix);
-      if (lbv_bit_test(r->t_lbv_xsyid_nulled_event_is_active, nulled_xsyid)) {
-        int_event_new (g, MARPA_EVENT_SYMBOL_NULLED, nulled_xsyid);
-        event_count++;
+      {
+        const Bit_Vector bv_yims_to_accept
+          = matrix_row (acceptance_matrix, cause_yim_ix);
+        int min, max, start;
+        for (start = 0; bv_scan (bv_yims_to_accept, start, &min, &max);
+             start = max + 2)
+          {
+            int yim_to_accept_ix;
+            for (yim_to_accept_ix = min;
+                 yim_to_accept_ix <= max; yim_to_accept_ix++)
+              {
+                const YIM yim_to_accept = yims_to_clean[yim_to_accept_ix];
+                YIM_is_Active (yim_to_accept) = 1;
+              }
+          }
       }
     }
-    return event_count;
 }
 
-@ @<Function definitions@> =
-PRIVATE void earley_set_update_items(RECCE r, YS set)
-{
-    YIM* working_earley_items;
-    YIM* finished_earley_items;
-    int working_earley_item_count;
-    int i;
-    YIMs_of_YS(set) = marpa_obs_new(r->t_obs, YIM, YIM_Count_of_YS(set));
-    finished_earley_items = YIMs_of_YS(set);
-    /* We know that no new earley items will be added in this scope */
-    working_earley_items = Work_YIMs_of_R(r);
-    working_earley_item_count = Work_YIM_Count_of_R(r);
-    for (i = 0; i < working_earley_item_count; i++) {
-         YIM earley_item = working_earley_items[i];
-         int ordinal = Ord_of_YIM(earley_item);
-         finished_earley_items[ordinal] = earley_item;
+@ This pass is probably not necessary, because I should be checking
+the active boolean from here on.
+But it restores the "consistent" state where a YIM is either rejected
+or accepted.
+@<Mark un-accepted YIM's rejected@> = {
+    int yim_ix;
+    for (yim_ix = 0; yim_ix < yim_to_clean_count; yim_ix++) {
+      const YIM yim = yims_to_clean[yim_ix];
+      if (!YIM_is_Active(yim)) continue;
+      YIM_is_Rejected(yim) = 1;
     }
-    WORK_YIMS_CLEAR(r);
 }
 
-@ This function is called exactly once during a normal parse --
-at the end, when it is time for a bocage to be created.
-It is also called by trace and debugging methods.
-It must be used carefully since it takes $O(\log n)$ time,
-where $n$ is the number of Earley sets.
-If called after every Earley set, it would make Marpa
-$O(n \log n)$ in the best case.
-@d P_YS_of_R_by_Ord(r, ord) MARPA_DSTACK_INDEX((r)->t_earley_set_stack, YS, (ord))
-@d YS_of_R_by_Ord(r, ord) (*P_YS_of_R_by_Ord((r), (ord)))
-@<Function definitions@> =
-PRIVATE void r_update_earley_sets(RECCE r)
+@ {\bf To Do}: @^To Do@>
+Deferred while we are only dealing with YS 0.
+@ We now have a full census of accepted and rejected YIM's.
+Use this to go back over SRCL's.
+These will all be resolveable one way or the other.
+@<Mark accepted SRCL's@> = {}
+
+@ Mark LIM's as accepted or rejected, based on
+their predecessors and trailhead YIM's.
+@<Mark rejected LIM's@> =
 {
-    YS set;
-    YS first_unstacked_earley_set;
-    if (!MARPA_DSTACK_IS_INITIALIZED(r->t_earley_set_stack)) {
-        first_unstacked_earley_set = First_YS_of_R(r);
-        MARPA_DSTACK_INIT (r->t_earley_set_stack, YS,
-                 MAX (1024, YS_Count_of_R(r)));
-    } else {
-         YS* end_of_stack = MARPA_DSTACK_TOP(r->t_earley_set_stack, YS);
-         first_unstacked_earley_set = Next_YS_of_YS(*end_of_stack);
-    }
-    for (set = first_unstacked_earley_set; set; set = Next_YS_of_YS(set)) {
-          YS* end_of_stack = MARPA_DSTACK_PUSH(r->t_earley_set_stack, YS);
-          (*end_of_stack) = set;
-    }
-}
+  int postdot_sym_ix;
+  const int postdot_sym_count = Postdot_SYM_Count_of_YS(ys_to_clean);
+  const PIM* postdot_array = ys_to_clean->t_postdot_ary;
 
-@** Create the postdot items.
+  @t}\comment{@>
+  /* For every postdot symbol */
+  for (postdot_sym_ix = 0; postdot_sym_ix < postdot_sym_count; postdot_sym_ix++) {
+      @t}\comment{@>
+      /* If there is a LIM, there will be only one,
+      and it will be the first PIM. */
+     const PIM first_pim = postdot_array[postdot_sym_ix];
+     if (PIM_is_LIM(first_pim)) {
+         const LIM lim = LIM_of_PIM(first_pim);
 
-@*0 About Leo items and unit rules.
+         @t}\comment{@>
+         /* Reject LIM by default */
+         LIM_is_Rejected(lim) = 1;
+         LIM_is_Active(lim) = 0;
 
-@ Much of the logic in the code is required to allow the Leo logic
-to handle unit rules in right recursions.
-Right recursions that involve only unit rules might be overlooked --
-they are either finite in length (limited by the number of symbols
-in the grammar) or involve cycles.
-Either way, they could reasonably be ignored.
-@ But a right recursion often takes place through multiple rules,
-and in practical cases following
-an important and lengthy right recursion,
-one with many non-unit rules,
-may require following short stretches of
-unit rules.
-@ If a unit rule is the base item of a Leo item,
-it must be a prediction.  This is because the base
-item will have a dot position that is penultimate --
-at the dot location just before the final one.
-In a unit rule this is the beginning of the rule.
-@ Unit rules have a special issue when it comes to creating
-Leo items.
-Every Leo item, if it is to be useful
-and continue the recursion,
-needs to find a Leo predecessor.
-In the text that follows, recording the predecessor
-data in an Leo item is called ``populating'' that item.
-@
-The Leo predecessor of a unit rule Leo base item
-will be in the same Earley set that we are working on,
-and since this is the same Earley set for which
-we are creating Leo items,
-it may not have been built yet.
-Worse, it may be part of a cycle.
-To solve this problem, the code that follows builds
-LIM chains --
-chains of LIM's which require the next one
-on the chain to be populated.
-Every LIM on a LIM chain will have a base rule
-which is a unit rule and a prediction.
-@ A chain ends
-\li when it results in a cycle,
-in which case the right recursion will not followed further.
-\li when a LIM is found which is not a unit
-rule, because that LIM's predecessor will be in a previous
-Earley set, and its information will be available.
-\li when it find a unit rule LIM which is populated,
-perhaps by a run through a previous LIM chain.
+         @t}\comment{@>
+         /* Reject, because the base-to YIM is not active */
+         if (!YIM_is_Active(Trailhead_YIM_of_LIM(lim))) continue;
+         {
+           const LIM predecessor_lim = Predecessor_LIM_of_LIM(lim);
+           @t}\comment{@>
+           /* Reject, because the predecessor LIM exists and is not active */
+           if (predecessor_lim && !LIM_is_Active(predecessor_lim)) continue;
+         }
 
-@*0 Code.
+         @t}\comment{@>
+         /* No reason found to reject, so accept this LIM */
+         LIM_is_Rejected(lim) = 0;
+         LIM_is_Active(lim) = 1;
+     }
+  }
+}
+
+@ For all pending alternatives, determine if
+they have unrejected predecessors.
+If not, remove them from their bucket.
+Readjust furthest earleme.
+Note that moving the furthest earleme may
+change the parse to exhausted state.
+@<Clean pending alternatives@> = {
+    int bucket_ix;
+    JEARLEME furthest_earleme = Current_Earleme_of_R(r);
+    for (bucket_ix = 0; bucket_ix < ALT_BUCKET_COUNT; bucket_ix++)
+      {
+        const MARPA_DSTACK bucket = r->t_alternative_buckets + bucket_ix;
+        const int no_of_alternatives = MARPA_DSTACK_LENGTH (*bucket);
+        int old_alt_ix;
+        @t}\comment{@>
+        /* |empty_alt_ix| is the empty slot, into which the next acceptable alternative
+        should be copied. */
+        int empty_alt_ix = 0;
+        for (old_alt_ix = 0; old_alt_ix < no_of_alternatives; old_alt_ix++)
+          {
+            const ALT alternative =
+              MARPA_DSTACK_INDEX (*bucket, ALT_Object, old_alt_ix);
+            if (!alternative_is_acceptable (alternative))
+              continue;
+            if (End_Earleme_of_ALT (alternative) > furthest_earleme)
+              furthest_earleme = End_Earleme_of_ALT (alternative);
+            if (empty_alt_ix < old_alt_ix)
+              *MARPA_DSTACK_INDEX (*bucket, ALT_Object, empty_alt_ix) =
+                *alternative;
+            empty_alt_ix++;
+          }
+        ALT_Count_of_R(r) -= no_of_alternatives - empty_alt_ix;
+        @t}\comment{@>
+        /* |empty_alt_ix| points to the first available slot, so it is now the same
+        as the new stack length */
+        MARPA_DSTACK_COUNT_SET (*bucket, empty_alt_ix);
+      }
+    Furthest_Earleme_of_R(r) = furthest_earleme;
+}
 
-@ This function inserts regular and Leo postdot items into
-the postdot list.
-Not inlined, because of its size, and because it is used
-twice -- once in initializing the Earley set 0,
-and once for completing later Earley sets.
-Earley set 0 is very much a special case, and it
-might be a good idea to have
-separate code to handle it,
-in which case both could be inlined.
-@ Leo items are not created for Earley set 0.
-Originally this was to avoid dealing with the null productions
-that might be in Earley set 0.
-These have been eliminated with the special-casing of the
-null parse.
-But Leo items are always optional,
-and may not be worth it for Earley set 0.
-@ {\bf Further Research}: @^Further Research@>
-Another look at the degree and kind
-of memoization here is in order
-now that I use Leo items only in cases of
-an actual right recursion.
-This may require running benchmarks.
-@ @<Widely aligned recognizer elements@> =
-  Bit_Vector t_bv_lim_symbols;
-  Bit_Vector t_bv_pim_symbols;
-  void** t_pim_workarea;
-@ @<Allocate recognizer containers@> =
-  r->t_bv_lim_symbols = bv_obs_create(r->t_obs, nsy_count);
-  r->t_bv_pim_symbols = bv_obs_create(r->t_obs, nsy_count);
-  r->t_pim_workarea = marpa_obs_new(r->t_obs, void*, nsy_count);
-@ @<Reinitialize containers used in PIM setup@> =
-  bv_clear(r->t_bv_lim_symbols);
-  bv_clear(r->t_bv_pim_symbols);
 @ @<Function definitions@> =
-PRIVATE_NOT_INLINE void
-postdot_items_create (RECCE r,
-  Bit_Vector bv_ok_for_chain,
-  const YS current_earley_set)
+PRIVATE int alternative_is_acceptable(ALT alternative)
+{
+  PIM pim;
+  const NSYID token_symbol_id = NSYID_of_ALT(alternative);
+  const YS start_ys = Start_YS_of_ALT(alternative);
+  for (pim= First_PIM_of_YS_by_NSYID(start_ys, token_symbol_id);
+      pim;
+      pim = Next_PIM_of_PIM(pim))
+  {
+      YIM predecessor_yim = YIM_of_PIM(pim);
+
+      @t}\comment{@>
+      /* If the trailhead PIM is non-active, the LIM will not
+      be active, so we don't bother looking at the LIM.
+      Instead we will wait for the source, which will be next
+      in the list of PIM's */
+      if (!predecessor_yim) continue;
+
+      /* We have an active predecessor, so this alternative is
+      OK. Move on to look at the next alterntive */
+      if (YIM_is_Active(predecessor_yim)) return 1;
+  }
+  return 0;
+}
+
+@ @<Clean expected terminals@> = {}
+
+@** Recognizer zero-width assertion code.
+@<Function definitions@> =
+int
+marpa_r_zwa_default_set(Marpa_Recognizer r,
+    Marpa_Assertion_ID zwaid,
+    int default_value)
 {
+  @<Return |-2| on failure@>@;
   @<Unpack recognizer objects@>@;
-    @<Reinitialize containers used in PIM setup@>@;
-    @<Start YIXes in PIM workarea@>@;
-    if (r->t_is_using_leo) {
-        @<Start LIMs in PIM workarea@>@;
-        @<Add predecessors to LIMs@>@;
-    }
-    @<Copy PIM workarea to postdot item array@>@;
-    bv_and(r->t_bv_nsyid_is_expected, r->t_bv_pim_symbols, g->t_bv_nsyid_is_terminal);
+  ZWA zwa;
+  int old_default_value;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail recognizer if |zwaid| is malformed@>@;
+  @<Fail recognizer if |zwaid| does not exist@>@;
+    if (_MARPA_UNLIKELY (default_value < 0 || default_value > 1))
+      {
+        MARPA_R_ERROR (MARPA_ERR_INVALID_BOOLEAN);
+        return failure_indicator;
+      }
+    zwa = RZWA_by_ID(zwaid);
+    old_default_value = Default_Value_of_ZWA(zwa);
+    Default_Value_of_ZWA(zwa) = default_value ? 1 : 0;
+    return old_default_value;
 }
 
-@ This code creates the Earley indexes in the PIM workarea.
-At this point there are no Leo items.
-@<Start YIXes in PIM workarea@> = {
-    /* No new Earley items are created in this scope */
-    YIM* work_earley_items = MARPA_DSTACK_BASE (r->t_yim_work_stack, YIM );
-    int no_of_work_earley_items = MARPA_DSTACK_LENGTH (r->t_yim_work_stack );
-    int ix;
-    for (ix = 0;
-         ix < no_of_work_earley_items;
-         ix++)
-     {
-        YIM earley_item = work_earley_items[ix];
-      AHM ahm = AHM_of_YIM (earley_item);
-      const NSYID postdot_nsyid = Postdot_NSYID_of_AHM(ahm);
-      if (postdot_nsyid < 0) continue;
-        {
-          PIM old_pim = NULL;
-          PIM new_pim;
-
-	  /* Need to be aligned for a PIM */
-          new_pim = marpa__obs_alloc(r->t_obs,
-            sizeof(YIX_Object), ALIGNOF(PIM_Object));
+@ @<Function definitions@> =
+int
+marpa_r_zwa_default(Marpa_Recognizer r,
+    Marpa_Assertion_ID zwaid)
+{
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  ZWA zwa;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail recognizer if |zwaid| is malformed@>@;
+  @<Fail recognizer if |zwaid| does not exist@>@;
+  zwa = RZWA_by_ID(zwaid);
+  return Default_Value_of_ZWA(zwa);
+}
 
-          Postdot_NSYID_of_PIM(new_pim) = postdot_nsyid;
-          YIM_of_PIM(new_pim) = earley_item;
-          if (bv_bit_test(r->t_bv_pim_symbols, postdot_nsyid))
-              old_pim = r->t_pim_workarea[postdot_nsyid];
-          Next_PIM_of_PIM(new_pim) = old_pim;
-          if (!old_pim) current_earley_set->t_postdot_sym_count++;
-          r->t_pim_workarea[postdot_nsyid] = new_pim;
-          bv_bit_set(r->t_bv_pim_symbols, postdot_nsyid);
-        }
-    }
+@** Earley set release code.
+In a long parse, most of the Earley sets are usually
+of no further use.
+Take, for example, a stream of records,
+parsed as one long sequence.
+Once a record is complete,
+the recognizer never again looks inside it.
+The Earley sets of such a record can be released,
+so that a recognizer can read an unbounded input
+in bounded memory.
+
+@ The recognizer looks back at an Earley set for three reasons.
+A completion looks for postdot items in the origin
+of the completed Earley item.
+A pending alternative is scanned from its start Earley set.
+And the bocage follows source links back from the end
+of the parse.
+The first two are needed to continue the parse.
+The third is needed only to evaluate it.
+
+@ Earley set 0 holds the predictions of the start rule,
+and is the origin of every parse.
+It is never released.
+Every other Earley set is {\bf live}
+if the recognizer may still look back at it
+for one of the first two reasons.
+The live Earley sets are found by a closure.
+The latest Earley set is live,
+as is the start Earley set of every pending alternative.
+If an Earley set is live,
+then the origins of its postdot items are live,
+and so are the Earley sets of their predecessors.
+
+@ When the Earley sets before a set $k$ are released,
+the source links into them are broken.
+An Earley item which is not a prediction, and not in Earley set 0,
+and all of whose sources are broken, is {\bf cut} ---
+its derivation can no longer be followed.
+The application is expected to have evaluated
+the parse up to $k$ before releasing it,
+so that a cut Earley item stands for part
+of an already evaluated prefix.
+A completion source whose cause is cut
+becomes a token source,
+with the LHS of the cause as its token
+and a value given by the application.
+Other broken sources are removed.
+After the release, the Earley sets from $k$ on are
+renumbered to follow Earley set 0,
+and their earlemes are shifted down,
+so that Earley set $k$ is at earleme 1.
+Without this,
+the earlemes of a long-running recognizer would
+eventually overflow.
+
+@d YSID_is_Released(ysid, k) ((ysid) > 0 && (ysid) < (k))
+@d YIM_is_Cut(yim) (YS_Ord_of_YIM(yim) > 0
+  && Earley_Item_has_No_Source(yim) && !YIM_was_Predicted(yim))
+@<Function definitions@> =
+PRIVATE void
+ysid_live_mark (Bit_Vector bv_ysid_is_live, MARPA_DSTACK live_stack,
+                YSID ysid)
+{
+  if (ysid <= 0)
+    return;
+  if (bv_bit_test_then_set (bv_ysid_is_live, ysid))
+    return;
+  *MARPA_DSTACK_PUSH (*live_stack, YSID) = ysid;
 }
 
-@ This code creates the Earley indexes in the PIM workarea.
-The Leo items do not contain predecessors or have the
-predecessor-dependent information set at this point.
-@ The origin and predecessor will be filled in later,
-when the predecessor is known.
-The origin is set to |NULL|,
-and that will be used as an indicator that the fields
-of this
-Leo item have not been fully populated.
-@d LIM_is_Populated(leo) (Origin_of_LIM(leo) != NULL)
-@<Start LIMs in PIM workarea@> =
+@ @<Function definitions@> =
+PRIVATE void
+lim_live_mark (Bit_Vector bv_ysid_is_live, MARPA_DSTACK live_stack, LIM lim)
 {
-  int min, max, start;
-  for (start = 0; bv_scan (r->t_bv_pim_symbols, start, &min, &max);
-       start = max + 2)
+  for (; lim; lim = Predecessor_LIM_of_LIM (lim))
     {
-      NSYID nsyid;
-      for (nsyid = (NSYID) min; nsyid <= (NSYID) max; nsyid++)
-	{
-	  const PIM this_pim = r->t_pim_workarea[nsyid];
-	  if (Next_PIM_of_PIM (this_pim))
-	    goto NEXT_NSYID;
-                /* Do not create a Leo item if there is more
-                   than one YIX */
-          {
-	    const YIM leo_base = YIM_of_PIM (this_pim);
-	    AHM potential_leo_penult_ahm = NULL;
-		const AHM leo_base_ahm = AHM_of_YIM (leo_base);
-		const IRL leo_base_irl = IRL_of_AHM (leo_base_ahm);
-
-		if (!IRL_is_Leo (leo_base_irl))
-		  goto NEXT_NSYID;
-		potential_leo_penult_ahm = leo_base_ahm;
-            MARPA_ASSERT((int)potential_leo_penult_ahm);
-	    {
-	      const AHM trailhead_ahm =
-		Next_AHM_of_AHM (potential_leo_penult_ahm);
-	      if (AHM_is_Leo_Completion (trailhead_ahm))
-		{
-		  @<Create a new, unpopulated, LIM@>@;
-		}
-	    }
-	  }
-	NEXT_NSYID:;
-	}
+      const YS origin = Origin_of_LIM (lim);
+      ysid_live_mark (bv_ysid_is_live, live_stack, Ord_of_YS (YS_of_LIM (lim)));
+      if (origin)
+        ysid_live_mark (bv_ysid_is_live, live_stack, Ord_of_YS (origin));
     }
 }
 
-@ The Top AHM of the new LIM is temporarily used
-to memoize
-the value of the AHM to-state for the LIM's
-base YIM.
-That may become its actual value,
-once it is populated.
-@<Create a new, unpopulated, LIM@> = {
-    LIM new_lim;
-    new_lim = marpa_obs_new(r->t_obs, LIM_Object, 1);
-    LIM_is_Active(new_lim) = 1;
-    LIM_is_Rejected(new_lim) = 1;
-    Postdot_NSYID_of_LIM(new_lim) = nsyid;
-    YIM_of_PIM(new_lim) = NULL;
-    Predecessor_LIM_of_LIM(new_lim) = NULL;
-    Origin_of_LIM(new_lim) = NULL;
-    CIL_of_LIM(new_lim) = NULL;
-    Top_AHM_of_LIM(new_lim) = trailhead_ahm;
-    Trailhead_AHM_of_LIM(new_lim) = trailhead_ahm;
-    Trailhead_YIM_of_LIM(new_lim) = leo_base;
-    YS_of_LIM(new_lim) = current_earley_set;
-    Next_PIM_of_LIM(new_lim) = this_pim;
-    r->t_pim_workarea[nsyid] = new_lim;
-    bv_bit_set(r->t_bv_lim_symbols, nsyid);
+@ @<Function definitions@> =
+PRIVATE void
+yim_live_mark (Bit_Vector bv_ysid_is_live, MARPA_DSTACK live_stack, YIM yim)
+{
+  SRCL source_link;
+  ysid_live_mark (bv_ysid_is_live, live_stack, Origin_Ord_of_YIM (yim));
+  for (source_link = First_Token_SRCL_of_YIM (yim); source_link;
+       source_link = Next_SRCL_of_SRCL (source_link))
+    {
+      const YIM predecessor = Predecessor_of_SRCL (source_link);
+      if (predecessor)
+        ysid_live_mark (bv_ysid_is_live, live_stack,
+                        YS_Ord_of_YIM (predecessor));
+    }
+  for (source_link = First_Completion_SRCL_of_YIM (yim); source_link;
+       source_link = Next_SRCL_of_SRCL (source_link))
+    {
+      const YIM predecessor = Predecessor_of_SRCL (source_link);
+      if (predecessor)
+        ysid_live_mark (bv_ysid_is_live, live_stack,
+                        YS_Ord_of_YIM (predecessor));
+    }
+  for (source_link = First_Leo_SRCL_of_YIM (yim); source_link;
+       source_link = Next_SRCL_of_SRCL (source_link))
+    lim_live_mark (bv_ysid_is_live, live_stack, LIM_of_SRCL (source_link));
 }
 
-@ This code fully populates the data in the LIMs.
-It determines the Leo predecessors of the LIMs, if any,
-then populates that datum and the predecessor-dependent
-data.
-@ The algorithm is fast, if not a model of simplicity.
-The LIMs are processed in an outer loop in order by
-symbol ID, as well as in an inner loop which processes
-predecessor chains from bottom to top.
-It is very much possible that the
-same LIM will be encountered twice,
-once in each loop.
-The code always checks to see if a LIM is
-already populated,
-before populating it.
-@ The outer loop ensures that all LIMs are eventually
-populated.  It uses the PIM workarea, guided by
-a boolean vector which indicates the LIM's.
-@ It is possible for a LIM to be encountered which may have a predecessor,
-but which cannot be immediately populated.
-This is because predecessors link the LIMs in chains, and such chains
-must be populated in order.
-Any ``links" in the chain of LIMs which are in previous Earley sets
-will already be populated.
-But a chain of LIMs may all be in the current Earley set, the
-one we are currently processing.
-In this case, there is a chicken-and-egg issue, which is
-resolved by arranging those LIMs in chain link order,
-and processing them in that order.
-This is the business of the inner loop.
-@ When a LIM is encountered which cannot be populated immediately,
-its chain is followed and copied into |t_lim_chain|, which is in
-effect a stack.  The chain ends when it reaches
-a LIM which can be populated immediately.
-@ A special case is when the LIM chain cycles back to the LIM
-which started the chain.
-When this happens, the LIM chain is terminated.
-The bottom of such a chain
-(which, since it is a cycle, is also the top)
-is populated with a predecessor of
-|NULL| and appropriate predecessor-dependent data.
-@ {\bf Theorem}: The number of links
-in a LIM chain is never more than the number
-of symbols in the grammar.
-{\bf Proof}: A LIM chain consists of the predecessors of LIMs,
-all of which are in the same Earley set.
-A LIM is uniquely determined by a duple of Earley set and transition symbol.
-This means, in a single Earley set, there is at most one LIM per symbol.
-{\bf QED}.
-@ {\bf Complexity}: Time complexity is $O(n)$, where $n$ is the number
-of LIMs.  This can be shown as follows:
-\li The outer loop processes each LIM exactly once.
-\li A LIM is never put onto a LIM chain if it is already populated.
-\li A LIM is never taken off a LIM chain without being populated.
-\li Based on the previous two observations, we know that a LIM will
-be put onto a LIM chain at most once.
-\li Ignoring the inner loop processing, the amount of processing done for each
-LIM in the outer loop LIM is $O(1)$.
-\li The amount of processing done for each LIM
-in the inner loop is $O(1)$.
-\li Total processing for all $n$ LIMs is therefore $n(O(1)+O(1))=O(n)$.
-@ The |bv_ok_for_chain| is a vector of bits by symbol ID.
-A bit is set if there is a LIM for that symbol ID that is OK for addition
-to the LIM chain.
-To be OK for addition to the LIM chain, the postdot item for the symbol
-ID must
-\li In fact actually be a Leo item (LIM).
-\li Must not have been populated.
-\li Must not have already been added to a LIM chain for this
-Earley set.\par
-@<Add predecessors to LIMs@> = {
-  int min, max, start;
-
-  bv_copy(bv_ok_for_chain, r->t_bv_lim_symbols);
-  for (start = 0; bv_scan (r->t_bv_lim_symbols, start, &min, &max);
-       start = max + 2)
-    { /* This is the outer loop.  It loops over the symbols IDs,
-          visiting only the symbols with LIMs. */
-      NSYID main_loop_nsyid;
-      for (main_loop_nsyid = (NSYID) min;
-          main_loop_nsyid <= (NSYID) max;
-          main_loop_nsyid++)
+@ Returns the earliest live Earley set.
+If the latest Earley set is 0 or 1, that is returned.
+@<Function definitions@> =
+PRIVATE YSID
+earliest_live_ysid (RECCE r)
+{
+  const YSID latest_ysid = Ord_of_YS (Latest_YS_of_R (r));
+  YSID earliest_ysid = latest_ysid;
+  Bit_Vector bv_ysid_is_live;
+  MARPA_DSTACK_DECLARE (live_stack);
+  YSID *p_ysid;
+  int bucket_ix;
+  if (latest_ysid <= 1)
+    return latest_ysid;
+  bv_ysid_is_live = bv_create (YS_Count_of_R (r));
+  MARPA_DSTACK_INIT (live_stack, YSID, 1024);
+  ysid_live_mark (bv_ysid_is_live, &live_stack, latest_ysid);
+  for (bucket_ix = 0; bucket_ix < ALT_BUCKET_COUNT; bucket_ix++)
+    {
+      const MARPA_DSTACK bucket = r->t_alternative_buckets + bucket_ix;
+      int alternative_ix;
+      for (alternative_ix = 0; alternative_ix < MARPA_DSTACK_LENGTH (*bucket);
+           alternative_ix++)
         {
-          LIM predecessor_lim;
-          LIM lim_to_process = r->t_pim_workarea[main_loop_nsyid];
-          if (LIM_is_Populated(lim_to_process)) continue; /* LIM may
-              have already been populated in the LIM chain loop */
-            @<Find predecessor LIM of unpopulated LIM@>@;
-            if (predecessor_lim && LIM_is_Populated(predecessor_lim)) {
-                @<Populate |lim_to_process| from |predecessor_lim|@>@;
-                continue;
-            }
-            if (!predecessor_lim) { /* If there is no predecessor LIM to
-               populate, we know that we should populate from the base
-               Earley item */
-               @<Populate |lim_to_process| from its base Earley item@>@;
-               continue;
+          const ALT alternative =
+            MARPA_DSTACK_INDEX (*bucket, ALT_Object, alternative_ix);
+          ysid_live_mark (bv_ysid_is_live, &live_stack,
+                          Ord_of_YS (Start_YS_of_ALT (alternative)));
+        }
+    }
+  while ((p_ysid = MARPA_DSTACK_POP (live_stack, YSID)))
+    {
+      const YSID ysid = *p_ysid;
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      int postdot_ix;
+      if (ysid < earliest_ysid)
+        earliest_ysid = ysid;
+      for (postdot_ix = 0; postdot_ix < Postdot_SYM_Count_of_YS (set);
+           postdot_ix++)
+        {
+          PIM pim;
+          for (pim = set->t_postdot_ary[postdot_ix]; pim;
+               pim = Next_PIM_of_PIM (pim))
+            {
+              if (PIM_is_LIM (pim))
+                {
+                  lim_live_mark (bv_ysid_is_live, &live_stack,
+                                 LIM_of_PIM (pim));
+                  continue;
+                }
+              yim_live_mark (bv_ysid_is_live, &live_stack, YIM_of_PIM (pim));
             }
-           @<Create and populate a LIM chain@>@;
         }
     }
+  MARPA_DSTACK_DESTROY (live_stack);
+  bv_free (bv_ysid_is_live);
+  return earliest_ysid;
 }
 
-@ Find the predecessor LIM from the PIM workarea.
-If the predecessor
-starts at the current Earley set, I need to look in
-the PIM workarea.
-Otherwise the PIM item array by symbol is already
-set up and I can find it there.
-@ The LHS of the completed rule and of the applicable rule
-in the base item will be the same, because the two rules
-are the same.
-Given the |main_loop_symbol_id| we can look up either the
-appropriate rule in the base Earley item's AHM,
-or the Leo completion's AHM.
-It is most convenient to find the LHS of the completed
-rule as the
-only possible Leo LHS of the Leo completion's AHM.
-The AHM for the Leo completion is guaranteed
-to have only one rule.
-The base Earley item's AHM can have multiple
-rules, and in its list of rules there can
-be transitions to Leo
-completions via several different symbols.
-The code is used for unpopulated LIMs.
-In a populated LIM, this will not necessarily be the case.
-@<Find predecessor LIM of unpopulated LIM@> =
+@ @<Function definitions@> =
+Marpa_Earley_Set_ID
+marpa_r_earliest_live_earley_set (Marpa_Recognizer r)
 {
-  const YIM base_yim = Trailhead_YIM_of_LIM (lim_to_process);
-  const YS predecessor_set = Origin_of_YIM (base_yim);
-  const AHM trailhead_ahm = Trailhead_AHM_of_LIM (lim_to_process);
-  const NSYID predecessor_transition_nsyid =
-    LHSID_of_AHM (trailhead_ahm);
-  PIM predecessor_pim;
-  if (Ord_of_YS (predecessor_set) < Ord_of_YS (current_earley_set))
-    {
-      predecessor_pim
-	=
-	First_PIM_of_YS_by_NSYID (predecessor_set,
-				  predecessor_transition_nsyid);
-    }
-  else
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail if recognizer not started@>@;
+  r_update_earley_sets (r);
+  return earliest_live_ysid (r);
+}
+
+@ An Earley item is released if it is in a released Earley set,
+or has its origin in one.
+An Earley item is broken if it is released or cut.
+@<Function definitions@> =
+PRIVATE int
+yim_is_released (RECCE r @,@, UNUSED, YIM yim, YSID k)
+{
+  return YSID_is_Released (YS_Ord_of_YIM (yim), k)
+    || YSID_is_Released (Origin_Ord_of_YIM (yim), k);
+}
+
+PRIVATE int
+yim_is_broken (RECCE r, YIM yim, YSID k)
+{
+  const GRAMMAR g @,@, UNUSED = G_of_R (r);
+  return yim_is_released (r, yim, k) || YIM_is_Cut (yim);
+}
+
+@ A Leo item is broken if any Leo item in its chain of predecessors
+looks back into a released Earley set,
+or has a broken trailhead.
+@<Function definitions@> =
+PRIVATE int
+lim_is_broken (RECCE r, LIM lim, YSID k)
+{
+  for (; lim; lim = Predecessor_LIM_of_LIM (lim))
     {
-      predecessor_pim = r->t_pim_workarea[predecessor_transition_nsyid];
+      const YS origin = Origin_of_LIM (lim);
+      if (YSID_is_Released (Ord_of_YS (YS_of_LIM (lim)), k))
+        return 1;
+      if (origin && YSID_is_Released (Ord_of_YS (origin), k))
+        return 1;
+      if (yim_is_broken (r, Trailhead_YIM_of_LIM (lim), k))
+        return 1;
     }
-  predecessor_lim =
-    PIM_is_LIM (predecessor_pim) ? LIM_of_PIM (predecessor_pim) : NULL;
+  return 0;
 }
 
-@ @<Widely aligned recognizer elements@> =
-  void** t_lim_chain;
-@ @<Allocate recognizer containers@> =
-  r->t_lim_chain = marpa_obs_new(r->t_obs, void*, 2*nsy_count);
-@ @<Create and populate a LIM chain@> = {
-  int lim_chain_ix;
-  @<Create a LIM chain@>@;
-  @<Populate the LIMs in the LIM chain@>@;
+@ Remove or convert the broken sources of |yim|.
+Returns 1 if anything was changed, 0 otherwise.
+@<Function definitions@> =
+PRIVATE int
+yim_sources_release (RECCE r, YIM yim, YSID k, int value)
+{
+  const GRAMMAR g @,@, UNUSED = G_of_R (r);
+  switch (Source_Type_of_YIM (yim))
+    {
+    case SOURCE_IS_TOKEN:
+      {
+        const YIM predecessor = Predecessor_of_YIM (yim);
+        if (predecessor && yim_is_broken (r, predecessor, k))
+          break;
+        return 0;
+      }
+    case SOURCE_IS_COMPLETION:
+      {
+        const YIM predecessor = Predecessor_of_YIM (yim);
+        const YIM cause = Cause_of_YIM (yim);
+        if (predecessor && yim_is_broken (r, predecessor, k))
+          break;
+        if (yim_is_released (r, cause, k))
+          break;
+        if (YIM_is_Cut (cause))
+          {
+            const NSYID nsyid = LHS_NSYID_of_YIM (cause);
+            Source_Type_of_YIM (yim) = SOURCE_IS_TOKEN;
+            NSYID_of_YIM (yim) = nsyid;
+            Value_of_Source (Source_of_YIM (yim)) = value;
+            return 1;
+          }
+        return 0;
+      }
+    case SOURCE_IS_LEO:
+      {
+        if (lim_is_broken (r, (LIM) Predecessor_of_YIM (yim), k))
+          break;
+        if (yim_is_broken (r, Cause_of_YIM (yim), k))
+          break;
+        return 0;
+      }
+    case SOURCE_IS_AMBIGUOUS:
+      return ambiguous_sources_release (r, yim, k, value);
+    default:
+      return 0;
+    }
+  Source_Type_of_YIM (yim) = NO_SOURCE;
+  return 1;
 }
 
-@ At this point we know that
-\li |lim_to_process != NULL|
-\li |lim_to_process| is not populated
-\li |predecessor_lim != NULL|
-\li |predecessor_lim| is not populated
-@ Cycles can occur in the LIM chain.  They are broken by refusing to
-put the same LIM on LIM chain twice.  Since a LIM chain links are one-to-one,
-ensuring that the LIM on the bottom of the chain is never added to the LIM
-chain is enough to enforce this.
-@ When I am about to add a LIM twice to the LIM chain, instead I break the
-chain at that point.  The top of chain will then have no LIM predecessor,
-instead of being part of a cycle.  Since the LIM information is always optional,
-and in that case would be useless, breaking the chain in this way causes no
-problems.
-@<Create a LIM chain@> =
-{
-  NSYID postdot_nsyid_of_lim_to_process
-    = Postdot_NSYID_of_LIM (lim_to_process);
-  lim_chain_ix = 0;
-  r->t_lim_chain[lim_chain_ix++] = LIM_of_PIM (lim_to_process);
-  bv_bit_clear (bv_ok_for_chain,
-                postdot_nsyid_of_lim_to_process);
-  /* Make sure this LIM
-     is not added to a LIM chain again for this Earley set */
-  while (1)
+@ A converted completion link is moved to the token links,
+unless it duplicates one already there.
+The source link counts are not kept up to date here ---
+they are recounted after the release.
+@<Function definitions@> =
+PRIVATE int
+ambiguous_sources_release (RECCE r, YIM yim, YSID k, int value)
+{
+  const GRAMMAR g @,@, UNUSED = G_of_R (r);
+  int is_changed = 0;
+  SRCL *p_link;
+  SRCL link;
+  p_link = &LV_First_Token_SRCL_of_YIM (yim);
+  while ((link = *p_link))
     {
-    @t}\comment{@>
-      /* I know at this point that
-       |predecessor_lim| is unpopulated, so I also know that
-       |lim_to_process| is unpopulated.  This means I also know that
-       |lim_to_process| is in the current Earley set, because all LIMs
-       in previous Earley sets are already
-       populated.
-       */
-      lim_to_process = predecessor_lim;
-      postdot_nsyid_of_lim_to_process = Postdot_NSYID_of_LIM (lim_to_process);
-      if (!bv_bit_test
-          (bv_ok_for_chain, postdot_nsyid_of_lim_to_process))
+      const YIM predecessor = Predecessor_of_SRCL (link);
+      if (predecessor && yim_is_broken (r, predecessor, k))
         {
-          /* If I am about to add a previously added LIM to the LIM chain, I
-             break the LIM chain at this point.
-             The predecessor LIM has not yet been changed,
-             so that it is still appropriate for
-             the LIM at the top of the chain.  */
-          break;
+          *p_link = Next_SRCL_of_SRCL (link);
+          is_changed = 1;
+          continue;
         }
+      p_link = &Next_SRCL_of_SRCL (link);
+    }
+  p_link = &LV_First_Leo_SRCL_of_YIM (yim);
+  while ((link = *p_link))
+    {
+      if (lim_is_broken (r, LIM_of_SRCL (link), k)
+          || yim_is_broken (r, Cause_of_SRCL (link), k))
+        {
+          *p_link = Next_SRCL_of_SRCL (link);
+          is_changed = 1;
+          continue;
+        }
+      p_link = &Next_SRCL_of_SRCL (link);
+    }
+  p_link = &LV_First_Completion_SRCL_of_YIM (yim);
+  while ((link = *p_link))
+    {
+      const YIM predecessor = Predecessor_of_SRCL (link);
+      const YIM cause = Cause_of_SRCL (link);
+      if ((predecessor && yim_is_broken (r, predecessor, k))
+          || yim_is_released (r, cause, k))
+        {
+          *p_link = Next_SRCL_of_SRCL (link);
+          is_changed = 1;
+          continue;
+        }
+      if (YIM_is_Cut (cause))
+        {
+          const NSYID nsyid = LHS_NSYID_of_YIM (cause);
+          SRCL token_link;
+          *p_link = Next_SRCL_of_SRCL (link);
+          is_changed = 1;
+          for (token_link = LV_First_Token_SRCL_of_YIM (yim); token_link;
+               token_link = Next_SRCL_of_SRCL (token_link))
+            {
+              if (Predecessor_of_SRCL (token_link) == predecessor
+                  && NSYID_of_SRCL (token_link) == nsyid)
+                break;
+            }
+          if (token_link)
+            continue;
+          NSYID_of_SRCL (link) = nsyid;
+          Value_of_SRCL (link) = value;
+          Next_SRCL_of_SRCL (link) = LV_First_Token_SRCL_of_YIM (yim);
+          LV_First_Token_SRCL_of_YIM (yim) = link;
+          continue;
+        }
+      p_link = &Next_SRCL_of_SRCL (link);
+    }
+  if (!LV_First_Token_SRCL_of_YIM (yim)
+      && !LV_First_Completion_SRCL_of_YIM (yim)
+      && !LV_First_Leo_SRCL_of_YIM (yim))
+    Source_Type_of_YIM (yim) = NO_SOURCE;
+  return is_changed;
+}
 
-      @<Find predecessor LIM of unpopulated LIM@>@;
-
-      r->t_lim_chain[lim_chain_ix++] = LIM_of_PIM (lim_to_process);
-      /* |lim_to_process| is not populated, as shown above */
+@ Since Earley items are only ever removed,
+an Earley item's new ordinal is never greater than its old one,
+and an Earley item never needs to become wide.
+@<Function definitions@> =
+PRIVATE void
+yim_ordinal_set (YIM yim, int ordinal)
+{
+  if (ordinal < YIM_ORDINAL_OVERFLOW)
+    {
+      /* Masked, so that the compiler can see it fits the bitfield */
+      yim->t_ordinal = (unsigned int) ordinal & YIM_ORDINAL_OVERFLOW;
+      return;
+    }
+  Wide_Ord_of_YIM (yim) = ordinal;
+}
 
-      bv_bit_clear (bv_ok_for_chain,
-                    postdot_nsyid_of_lim_to_process);
-      /* Make sure this LIM
-         is not added to a LIM chain again for this Earley set */
-    @t}\comment{@>
-        /* |predecesssor_lim = NULL|,
-       so that we are forced to break the LIM chain before it */
-      if (!predecessor_lim)
-        break;
-      if (LIM_is_Populated (predecessor_lim))
-        break;
-      /* |predecesssor_lim| is populated, so that if we
-         break before |predecessor_lim|, we are ready to populate the entire LIM
-         chain. */
+@ Releases the Earley sets from 1 up to, but not including,
+|set_id|.
+Returns the number of Earley sets released,
+which is also the amount by which the Earley set IDs
+of the kept Earley sets are reduced.
+@<Function definitions@> =
+int
+marpa_r_earley_sets_release (Marpa_Recognizer r,
+                             Marpa_Earley_Set_ID set_id, int value)
+{
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  YSID shift;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail if recognizer not started@>@;
+  @<Fail if recognizer has a lazy bocage@>@;
+  if (_MARPA_UNLIKELY (!R_is_Consistent (r)))
+    {
+      MARPA_R_ERROR (MARPA_ERR_RECCE_IS_INCONSISTENT);
+      return failure_indicator;
+    }
+  if (_MARPA_UNLIKELY (set_id < 0))
+    {
+      MARPA_R_ERROR (MARPA_ERR_INVALID_LOCATION);
+      return failure_indicator;
+    }
+  r_update_earley_sets (r);
+  if (_MARPA_UNLIKELY (!YS_Ord_is_Valid (r, set_id)))
+    {
+      MARPA_R_ERROR (MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
+      return failure_indicator;
+    }
+  if (set_id <= 1)
+    return 0;
+  if (_MARPA_UNLIKELY (set_id > earliest_live_ysid (r)))
+    {
+      MARPA_R_ERROR (MARPA_ERR_EARLEY_SET_IS_LIVE);
+      return failure_indicator;
     }
+  shift = set_id - 1;
+  psar_reset (Dot_PSAR_of_R (r));
+  @<Break the source links into the released Earley sets@>@;
+  @<Remove the released postdot items@>@;
+  @<Remove the released Earley items@>@;
+  @<Shift the earlemes of the kept Earley sets@>@;
+  @<Renumber the kept Earley sets@>@;
+  @<Recount the Earley set statistics@>@;
+  @<Clear trace Earley set dependent data@>@;
+  @<Clear progress report in |r|@>@;
+  @<Free the segments of the released Earley sets@>@;
+  return shift;
 }
 
-@ @<Populate the LIMs in the LIM chain@> =
-for (lim_chain_ix--; lim_chain_ix >= 0; lim_chain_ix--) {
-    lim_to_process = r->t_lim_chain[lim_chain_ix];
-    if (predecessor_lim && LIM_is_Populated(predecessor_lim)) {
-        @<Populate |lim_to_process| from |predecessor_lim|@>@;
-    } else {
-        @<Populate |lim_to_process| from its base Earley item@>@;
+@ Breaking a source can cut an Earley item,
+which breaks the sources in turn of the Earley items
+that it is a source of.
+Those are never in an earlier Earley set,
+so the Earley sets are done in order,
+and each Earley set is repeated until nothing changes.
+@<Break the source links into the released Earley sets@> =
+{
+  YSID ysid;
+  for (ysid = set_id; ysid < YS_Count_of_R (r); ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      YIM *const yims = YIMs_of_YS (set);
+      const int yim_count = YIM_Count_of_YS (set);
+      int is_changed;
+      do
+        {
+          int yim_ix;
+          is_changed = 0;
+          for (yim_ix = 0; yim_ix < yim_count; yim_ix++)
+            {
+              const YIM yim = yims[yim_ix];
+              if (yim_is_released (r, yim, set_id))
+                continue;
+              is_changed |= yim_sources_release (r, yim, set_id, value);
+            }
+        }
+      while (is_changed);
     }
-    predecessor_lim = lim_to_process;
 }
 
-@ This code is optimized for cases where there are no events,
-or the lists of AHM IDs is "at closure".
-These are the most frequent and worst case scenarios.
-The new remaining "worst case" is a recursive series of AHM ID's
-which stabilizes short of closure.
-Secondary optimzations ensure this is fairly cheap as well.
-@<Populate |lim_to_process| from |predecessor_lim|@> =
+@ @<Remove the released postdot items@> =
 {
-  const AHM new_top_ahm = Top_AHM_of_LIM (predecessor_lim);
-  const CIL predecessor_cil = CIL_of_LIM (predecessor_lim);
-    @t}\comment{@>
-  /* Initialize to be just the predcessor's list of AHM IDs.
-       Overwrite if we need to add another. */
-  CIL_of_LIM (lim_to_process) = predecessor_cil;
-  Predecessor_LIM_of_LIM (lim_to_process) = predecessor_lim;
-  Origin_of_LIM (lim_to_process) = Origin_of_LIM (predecessor_lim);
-  if (Event_Group_Size_of_AHM (new_top_ahm) > Count_of_CIL (predecessor_cil))
-    {                           /* Might we need to add another AHM ID? */
-      const AHM trailhead_ahm = Trailhead_AHM_of_LIM(lim_to_process);
-      const CIL trailhead_ahm_event_ahmids =
-        Event_AHMIDs_of_AHM (trailhead_ahm);
-      if (Count_of_CIL (trailhead_ahm_event_ahmids))
+  YSID ysid;
+  for (ysid = set_id; ysid < YS_Count_of_R (r); ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      PIM *const postdot_array = set->t_postdot_ary;
+      const int postdot_sym_count = Postdot_SYM_Count_of_YS (set);
+      int old_ix;
+      int new_ix = 0;
+      for (old_ix = 0; old_ix < postdot_sym_count; old_ix++)
         {
-          CIL new_cil = cil_merge_one (&g->t_cilar, predecessor_cil,
-                                       Item_of_CIL
-                                       (trailhead_ahm_event_ahmids, 0));
-          if (new_cil)
+          PIM *p_pim = postdot_array + old_ix;
+          PIM pim;
+          while ((pim = *p_pim))
             {
-              CIL_of_LIM (lim_to_process) = new_cil;
+              const int is_released = PIM_is_LIM (pim)
+                ? lim_is_broken (r, LIM_of_PIM (pim), set_id)
+                : yim_is_released (r, YIM_of_PIM (pim), set_id);
+              if (is_released)
+                {
+                  *p_pim = Next_PIM_of_PIM (pim);
+                  continue;
+                }
+              p_pim = &Next_PIM_of_PIM (pim);
             }
+          if (postdot_array[old_ix])
+            postdot_array[new_ix++] = postdot_array[old_ix];
         }
+      Postdot_SYM_Count_of_YS (set) = new_ix;
+      if (set->t_postdot_index)
+        postdot_index_fill (r, set);
     }
-  Top_AHM_of_LIM (lim_to_process) = new_top_ahm;
 }
 
-@ If we have reached this code, either we do not have a predecessor
-LIM, or we have one which is useless for populating |lim_to_process|.
-If a predecessor LIM is not itself populated, it will be useless
-for populating its successor.
-An unpopulated predecessor LIM
-may occur when there is a predecessor LIM
-which proved impossible to populate because it is part of a cycle.
-@ The predecessor LIM and the top AHM to-state were initialized
-to the appropriate values for this case,
-and do not need to be changed.
-The predecessor LIM was initialized to |NULL|.
-of the base YIM.
-@<Populate |lim_to_process| from its base Earley item@> = {
-  const AHM trailhead_ahm = Trailhead_AHM_of_LIM(lim_to_process);
-  const YIM base_yim = Trailhead_YIM_of_LIM(lim_to_process);
-  Origin_of_LIM (lim_to_process) = Origin_of_YIM (base_yim);
-  CIL_of_LIM(lim_to_process) = Event_AHMIDs_of_AHM(trailhead_ahm);
+@ @<Remove the released Earley items@> =
+{
+  YSID ysid;
+  for (ysid = set_id; ysid < YS_Count_of_R (r); ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      YIM *const yims = YIMs_of_YS (set);
+      const int yim_count = YIM_Count_of_YS (set);
+      int old_ix;
+      int new_ix = 0;
+      for (old_ix = 0; old_ix < yim_count; old_ix++)
+        {
+          const YIM yim = yims[old_ix];
+          if (yim_is_released (r, yim, set_id))
+            continue;
+          yim_ordinal_set (yim, new_ix);
+          yims[new_ix++] = yim;
+        }
+      YIM_Count_of_YS (set) = new_ix;
+    }
 }
 
-@ @<Copy PIM workarea to postdot item array@> = {
-    PIM *postdot_array
-        = current_earley_set->t_postdot_ary
-        = marpa_obs_new (r->t_obs, PIM, current_earley_set->t_postdot_sym_count );
-    int min, max, start;
-    int postdot_array_ix = 0;
-    for (start = 0; bv_scan (r->t_bv_pim_symbols, start, &min, &max); start = max + 2) {
-        NSYID nsyid;
-        for (nsyid = min; nsyid <= max; nsyid++) {
-            PIM this_pim = r->t_pim_workarea[nsyid];
-            if (lbv_bit_test(r->t_nsy_expected_is_event, nsyid)) {
-              XSY xsy = Source_XSY_of_NSYID(nsyid);
-              int_event_new (g, MARPA_EVENT_SYMBOL_EXPECTED, ID_of_XSY(xsy));
-            }
-            if (this_pim) postdot_array[postdot_array_ix++] = this_pim;
+@ @<Shift the earlemes of the kept Earley sets@> =
+{
+  const JEARLEME earleme_shift =
+    Earleme_of_YS (YS_of_R_by_Ord (r, set_id)) - 1;
+  YSID ysid;
+  for (ysid = set_id; ysid < YS_Count_of_R (r); ysid++)
+    Earleme_of_YS (YS_of_R_by_Ord (r, ysid)) -= earleme_shift;
+  Current_Earleme_of_R (r) -= earleme_shift;
+  Furthest_Earleme_of_R (r) -= earleme_shift;
+  @<Shift the end earlemes of the pending alternatives@>@;
+}
+
+@ The alternatives are bucketed by their end earleme,
+so they are put back into the buckets after
+their end earlemes are changed.
+@<Shift the end earlemes of the pending alternatives@> =
+{
+  const int alternative_count = ALT_Count_of_R (r);
+  if (alternative_count > 0)
+    {
+      ALT_Object *const alternatives =
+        my_malloc (sizeof (ALT_Object) * (size_t) alternative_count);
+      int bucket_ix;
+      int alternative_ix = 0;
+      for (bucket_ix = 0; bucket_ix < ALT_BUCKET_COUNT; bucket_ix++)
+        {
+          const MARPA_DSTACK bucket = r->t_alternative_buckets + bucket_ix;
+          int ix;
+          for (ix = 0; ix < MARPA_DSTACK_LENGTH (*bucket); ix++)
+            alternatives[alternative_ix++] =
+              *MARPA_DSTACK_INDEX (*bucket, ALT_Object, ix);
+          MARPA_DSTACK_CLEAR (*bucket);
         }
+      ALT_Count_of_R (r) = 0;
+      for (alternative_ix = 0; alternative_ix < alternative_count;
+           alternative_ix++)
+        {
+          End_Earleme_of_ALT (alternatives + alternative_ix) -= earleme_shift;
+          alternative_insert (r, alternatives + alternative_ix);
+        }
+      my_free (alternatives);
     }
 }
 
+@ @<Renumber the kept Earley sets@> =
+{
+  const YSID ys_count = YS_Count_of_R (r);
+  YS *const sets = MARPA_DSTACK_BASE (r->t_earley_set_stack, YS);
+  YSID ysid;
+  for (ysid = set_id; ysid < ys_count; ysid++)
+    {
+      const YS set = sets[ysid];
+      @<Renumber the Earley items of |set|@>@;
+      Ord_of_YS (set) = ysid - shift;
+      sets[ysid - shift] = set;
+    }
+  Next_YS_of_YS (sets[0]) = sets[1];
+  MARPA_DSTACK_COUNT_SET (r->t_earley_set_stack, ys_count - shift);
+  YS_Count_of_R (r) = ys_count - shift;
+  @<Renumber the memoized Earley sets of the ZWAs@>@;
+}
 
-@** Rejecting Earley items.
-@ Notes for making the recognizer consistent after rejecting tokens:
-\li Clear all events.  Document that you should poll events before any
-rejections.
-\li Reset the vector of expected terminals.
-\li Re-determine if the parse is exhausted.
-\li What about postdot items?  If a LIM is now rejected, I should look
-at the YIM/PIM, I think, because it was {\bf not} necessarily rejected.
+@ In the compact layout,
+the Earley items hold the ordinals of their Earley sets.
+@<Renumber the Earley items of |set|@> =
+#if MARPA_COMPACT_YIM
+{
+  YIM *const yims = YIMs_of_YS (set);
+  const int yim_count = YIM_Count_of_YS (set);
+  int yim_ix;
+  for (yim_ix = 0; yim_ix < yim_count; yim_ix++)
+    {
+      const YIM yim = yims[yim_ix];
+      yim->t_key.t_set_ord -= shift;
+      if (yim->t_key.t_origin_ord > 0)
+        yim->t_key.t_origin_ord -= shift;
+    }
+}
+#endif
 
-@ Various notes about revision:
-\li I need to make sure that the reading of alternatives
-and the rejection of rules and terminals cannot be mixed.
-Rejected must be made, and revision complete, before any
-alternatives can be attempted.
-Or, in other words, attempting to reject a rule or terminal
-once an alternative has been read must be a fatal error.
+@ @<Renumber the memoized Earley sets of the ZWAs@> =
+{
+  ZWAID zwaid;
+  const int zwa_count = ZWA_Count_of_R (r);
+  for (zwaid = 0; zwaid < zwa_count; zwaid++)
+    {
+      const ZWA zwa = RZWA_by_ID (zwaid);
+      const YSID memo_ysid = Memo_YSID_of_ZWA (zwa);
+      if (YSID_is_Released (memo_ysid, set_id))
+        Memo_YSID_of_ZWA (zwa) = -1;
+      else if (memo_ysid >= set_id)
+        Memo_YSID_of_ZWA (zwa) = memo_ysid - shift;
+    }
+}
+
+@ After a release,
+the counts are of the objects in the kept Earley sets.
+@<Recount the Earley set statistics@> =
+{
+  const int index_size = Postdot_Index_Size_of_NSY_Count (NSY_Count_of_G (g));
+  YSID ysid;
+  YIM_Count_of_R (r) = 0;
+  PIM_Count_of_R (r) = 0;
+  LIM_Count_of_R (r) = 0;
+  SRCL_Count_of_R (r) = 0;
+  r->t_postdot_array_bytes = 0;
+  for (ysid = 0; ysid < YS_Count_of_R (r); ysid++)
+    {
+      const YS counted_set = YS_of_R_by_Ord (r, ysid);
+      YIM *const yims = YIMs_of_YS (counted_set);
+      const int yim_count = YIM_Count_of_YS (counted_set);
+      int yim_ix;
+      int postdot_ix;
+      YIM_Count_of_R (r) += yim_count;
+      r->t_postdot_array_bytes +=
+        sizeof (PIM) * (size_t) Postdot_SYM_Count_of_YS (counted_set);
+      if (counted_set->t_postdot_index)
+        r->t_postdot_array_bytes += sizeof (LBW) * (size_t) index_size;
+      for (postdot_ix = 0;
+           postdot_ix < Postdot_SYM_Count_of_YS (counted_set); postdot_ix++)
+        {
+          PIM pim;
+          for (pim = counted_set->t_postdot_ary[postdot_ix]; pim;
+               pim = Next_PIM_of_PIM (pim))
+            {
+              PIM_Count_of_R (r)++;
+              if (PIM_is_LIM (pim))
+                LIM_Count_of_R (r)++;
+            }
+        }
+      for (yim_ix = 0; yim_ix < yim_count; yim_ix++)
+        {
+          const YIM yim = yims[yim_ix];
+          SRCL source_link;
+          if (Source_Type_of_YIM (yim) != SOURCE_IS_AMBIGUOUS)
+            continue;
+          for (source_link = LV_First_Token_SRCL_of_YIM (yim); source_link;
+               source_link = Next_SRCL_of_SRCL (source_link))
+            SRCL_Count_of_R (r)++;
+          for (source_link = LV_First_Completion_SRCL_of_YIM (yim);
+               source_link; source_link = Next_SRCL_of_SRCL (source_link))
+            SRCL_Count_of_R (r)++;
+          for (source_link = LV_First_Leo_SRCL_of_YIM (yim); source_link;
+               source_link = Next_SRCL_of_SRCL (source_link))
+            SRCL_Count_of_R (r)++;
+        }
+    }
+}
+
+@ A segment is freed if all of its Earley sets were released.
+Earley set 0 is always in the first segment,
+which is never freed.
+The last segment is always kept,
+and a new segment is opened for the Earley sets
+that follow the release,
+so that the next release does not have to keep
+the kept Earley sets of this one.
+@<Free the segments of the released Earley sets@> =
+{
+  const int segment_count = YS_Segment_Count_of_R (r);
+  int segment_ix;
+  int kept_segment_count = 1;
+  for (segment_ix = 1; segment_ix < segment_count; segment_ix++)
+    {
+      YS_SEGMENT_Object *const segment = YS_Segment_of_R_by_Ix (r, segment_ix);
+      const YSID next_first_ysid = segment_ix + 1 < segment_count
+        ? YS_Segment_of_R_by_Ix (r, segment_ix + 1)->t_first_ysid : INT_MAX;
+      if (next_first_ysid <= set_id)
+        {
+          r->t_memory_budget.used -= marpa_obs_total_size (segment->t_obs);
+          marpa_obs_free (segment->t_obs);
+          continue;
+        }
+      segment->t_first_ysid =
+        segment->t_first_ysid < set_id ? 1 : segment->t_first_ysid - shift;
+      *YS_Segment_of_R_by_Ix (r, kept_segment_count++) = *segment;
+    }
+  MARPA_DSTACK_COUNT_SET (r->t_ys_segment_stack, kept_segment_count);
+  ys_segment_open (r);
+}
+
+@** Recognizer truncation code.
+An editor reparses its buffer after every change,
+but the Earley sets before the first changed earleme
+are the same as before the change.
+Truncating the recognizer back to the last of those Earley sets,
+and reading only the input after it,
+makes the cost of a reparse proportional to the length of
+the changed suffix, instead of to the length of the whole buffer.
+\par
+Nothing in an Earley set depends on a later one,
+so truncation only needs to discard the later Earley sets,
+and to restore the per-recognizer state which was
+current when Earley set |set_id| was completed.
+One exception is the tokens.
+A token which starts at or before |set_id|,
+and ends after the last Earley set,
+is still pending, and is kept.
+But a token which starts before |set_id|,
+and which was already read into one of
+the discarded Earley sets, is lost.
+The application should truncate at a point where no
+token crosses |set_id|,
+or read such tokens again itself.
+\par
+The memory of the discarded Earley sets is released
+back to their segments,
+so that an editor which truncates after every change
+reuses the same memory for each reparse.
 @<Function definitions@> =
-Marpa_Earleme
-marpa_r_clean(Marpa_Recognizer r)
+int
+marpa_r_truncate (Marpa_Recognizer r, Marpa_Earley_Set_ID set_id)
 {
   @<Return |-2| on failure@>@;
   @<Unpack recognizer objects@>@;
-  YSID ysid_to_clean;
-
-    @t}\comment{@>
-  const YS current_ys = Latest_YS_of_R (r);
-  const YSID current_ys_id = Ord_of_YS(current_ys);
-
-  int count_of_expected_terminals;
-  @<Declare |marpa_r_clean| locals@>@;
-
-    @t}\comment{@>
-  /* Initialized to -2 just in case.
-    Should be set before returning;
-   */
-  const JEARLEME return_value = -2;
-
-  @<Fail if recognizer not accepting input@>@;
-
-  G_EVENTS_CLEAR(g);
-
-  @t}\comment{@>
-  /* Return success if recognizer is already consistent */
-  if (R_is_Consistent(r)) return 0;
-
-    @t}\comment{@>
-    /* Note this makes revision $O(n \log n)$.  I could do better
-       for constant "look-behind", but it does not seem worth the
-       bother */
-  earley_set_update_items(r, current_ys);
-
-  for (ysid_to_clean = First_Inconsistent_YS_of_R(r);
-        ysid_to_clean <= current_ys_id;
-        ysid_to_clean++) {
-      @<Clean Earley set |ysid_to_clean|@>@;
-  }
-
-  @t}\comment{@>
-  /* All Earley sets are now consistent */
-
-    @<Clean pending alternatives@>@;
-
-    bv_clear (r->t_bv_nsyid_is_expected);
-    @<Clean expected terminals@>@;
-    count_of_expected_terminals = bv_count (r->t_bv_nsyid_is_expected);
-    if (count_of_expected_terminals <= 0
-       && MARPA_DSTACK_LENGTH (r->t_alternatives ) <= 0)
-      {
-        @<Set |r| exhausted@>@;
-      }
-
-  First_Inconsistent_YS_of_R(r) = -1;
-  /* CLEANUP: ; -- not used at the moment */
-    @<Destroy |marpa_r_clean| locals@>@;
-  return return_value;
+  YS set;
+  YS first_discarded_set;
+  int discarded_count;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail if recognizer not started@>@;
+  @<Fail if recognizer has a lazy bocage@>@;
+  if (_MARPA_UNLIKELY (!R_is_Consistent (r)))
+    {
+      MARPA_R_ERROR (MARPA_ERR_RECCE_IS_INCONSISTENT);
+      return failure_indicator;
+    }
+  if (_MARPA_UNLIKELY (set_id < 0))
+    {
+      MARPA_R_ERROR (MARPA_ERR_INVALID_LOCATION);
+      return failure_indicator;
+    }
+  r_update_earley_sets (r);
+  if (_MARPA_UNLIKELY (!YS_Ord_is_Valid (r, set_id)))
+    {
+      MARPA_R_ERROR (MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
+      return failure_indicator;
+    }
+  set = YS_of_R_by_Ord (r, set_id);
+  first_discarded_set = Next_YS_of_YS (set);
+  discarded_count = YS_Count_of_R (r) - 1 - set_id;
+  R_EVENTS_CLEAR (r);
+  psar_reset (Dot_PSAR_of_R (r));
+  @<Discard the Earley sets after |set|@>@;
+  @<Discard the pending alternatives which start after |set|@>@;
+  @<Recount the Earley set statistics@>@;
+  @<Restore the expected terminals of |set|@>@;
+  @<Clear trace Earley set dependent data@>@;
+  @<Clear progress report in |r|@>@;
+  if (first_discarded_set)
+    @<Free the memory of the discarded Earley sets@>@;
+  return discarded_count;
 }
 
-@ @<Declare |marpa_r_clean| locals@> =
-
-@t}\comment{@>
-/* An obstack whose lifetime is that of the external method */
-struct marpa_obstack* const method_obstack = marpa_obs_init;
-
-YIMID *prediction_by_irl =
-  marpa_obs_new (method_obstack, YIMID, IRL_Count_of_G (g));
-
-@ @<Destroy |marpa_r_clean| locals@> =
+@ @<Discard the Earley sets after |set|@> =
 {
-  marpa_obs_free(method_obstack);
+  ZWAID zwaid;
+  const int zwa_count = ZWA_Count_of_R (r);
+  Next_YS_of_YS (set) = NULL;
+  Latest_YS_of_R (r) = set;
+  MARPA_DSTACK_COUNT_SET (r->t_earley_set_stack, set_id + 1);
+  YS_Count_of_R (r) = set_id + 1;
+  for (zwaid = 0; zwaid < zwa_count; zwaid++)
+    {
+      const ZWA zwa = RZWA_by_ID (zwaid);
+      if (Memo_YSID_of_ZWA (zwa) > set_id)
+        Memo_YSID_of_ZWA (zwa) = -1;
+    }
 }
 
-@ @<Clean Earley set |ysid_to_clean|@> =
+@ The alternatives within a bucket are kept in sorted order,
+which removing alternatives does not change.
+The furthest earleme is the end of the furthest of the
+alternatives that are kept.
+@<Discard the pending alternatives which start after |set|@> =
 {
-  const YS ys_to_clean = YS_of_R_by_Ord (r, ysid_to_clean);
-  const YIM *yims_to_clean = YIMs_of_YS (ys_to_clean);
-  const int yim_to_clean_count = YIM_Count_of_YS (ys_to_clean);
-  Bit_Matrix acceptance_matrix = matrix_obs_create (method_obstack,
-    yim_to_clean_count,
-    yim_to_clean_count);
-  @<Map prediction rules to YIM ordinals in array@>@;
-  @<First revision pass over |ys_to_clean|@>@;
-  transitive_closure(acceptance_matrix);
-  @<Mark accepted YIM's@>@;
-  @<Mark un-accepted YIM's rejected@>@;
-  @<Mark accepted SRCL's@>@;
-  @<Mark rejected LIM's@>@;
+  int bucket_ix;
+  JEARLEME furthest_earleme = Earleme_of_YS (set);
+  for (bucket_ix = 0; bucket_ix < ALT_BUCKET_COUNT; bucket_ix++)
+    {
+      const MARPA_DSTACK bucket = r->t_alternative_buckets + bucket_ix;
+      const int alternative_count = MARPA_DSTACK_LENGTH (*bucket);
+      int old_ix;
+      int new_ix = 0;
+      for (old_ix = 0; old_ix < alternative_count; old_ix++)
+        {
+          const ALT alternative =
+            MARPA_DSTACK_INDEX (*bucket, ALT_Object, old_ix);
+          if (Ord_of_YS (Start_YS_of_ALT (alternative)) > set_id)
+            continue;
+          if (End_Earleme_of_ALT (alternative) > furthest_earleme)
+            furthest_earleme = End_Earleme_of_ALT (alternative);
+          *MARPA_DSTACK_INDEX (*bucket, ALT_Object, new_ix++) = *alternative;
+        }
+      if (new_ix < alternative_count)
+        {
+          ALT_Count_of_R (r) -= alternative_count - new_ix;
+          MARPA_DSTACK_COUNT_SET (*bucket, new_ix);
+        }
+    }
+  Current_Earleme_of_R (r) = Earleme_of_YS (set);
+  Furthest_Earleme_of_R (r) = furthest_earleme;
+}
+
+@ The expected terminals are those of the postdot items of |set|,
+and the recognizer is exhausted if there are none of them
+and no tokens are pending,
+just as it was when |set| was completed.
+Exhaustion, here, is an exception to the rule that
+once a recognizer is exhausted it stays exhausted.
+No exhaustion event is generated ---
+the application has already seen it,
+when |set| was completed.
+@<Restore the expected terminals of |set|@> =
+{
+  PIM *const postdot_array = set->t_postdot_ary;
+  const int postdot_sym_count = Postdot_SYM_Count_of_YS (set);
+  int postdot_ix;
+  bv_clear (r->t_bv_nsyid_is_expected);
+  for (postdot_ix = 0; postdot_ix < postdot_sym_count; postdot_ix++)
+    {
+      const NSYID nsyid = Postdot_NSYID_of_PIM (postdot_array[postdot_ix]);
+      if (bv_bit_test (g->t_bv_nsyid_is_terminal, nsyid))
+        bv_bit_set (r->t_bv_nsyid_is_expected, nsyid);
+    }
+  R_is_Exhausted (r) = bv_count (r->t_bv_nsyid_is_expected) <= 0
+    && ALT_Count_of_R (r) <= 0;
+  Input_Phase_of_R (r) = R_is_Exhausted (r) ? R_AFTER_INPUT : R_DURING_INPUT;
+}
+
+@ All of the data of an Earley set is allocated while it is
+the latest Earley set,
+on the segment which is current at that time.
+So the segments after the one holding the first discarded
+Earley set hold only discarded Earley sets, and are freed.
+The segment holding the first discarded Earley set
+is released to its mark,
+and becomes the current segment again.
+If the first discarded Earley set has no mark,
+its segment is kept whole,
+and a new segment is opened for the Earley sets after |set|.
+@<Free the memory of the discarded Earley sets@> =
+{
+  const YSID first_discarded_ysid = set_id + 1;
+  int segment_count = YS_Segment_Count_of_R (r);
+  YS_SEGMENT_Object *segment;
+  while (segment_count > 1)
+    {
+      segment = YS_Segment_of_R_by_Ix (r, segment_count - 1);
+      if (segment->t_first_ysid <= first_discarded_ysid)
+        break;
+      r->t_memory_budget.used -= marpa_obs_total_size (segment->t_obs);
+      marpa_obs_free (segment->t_obs);
+      segment_count--;
+    }
+  MARPA_DSTACK_COUNT_SET (r->t_ys_segment_stack, segment_count);
+  segment = YS_Segment_of_R_by_Ix (r, segment_count - 1);
+  if (YS_has_Obs_Mark (first_discarded_set))
+    {
+      marpa_obs_release_to (segment->t_obs,
+                            Obs_Mark_of_YS (first_discarded_set));
+      r->t_ys_obs = segment->t_obs;
+    }
+  else
+    ys_segment_open (r);
 }
 
-@ Rules not used in this YS
-do not need to be initialized because they
-will never be referred to.
-@<Map prediction rules to YIM ordinals in array@> =
-{
-    int yim_ix = yim_to_clean_count - 1;
-    YIM yim = yims_to_clean[yim_ix];
-
+@** Recognizer checkpoint (RCHK) code.
+A recognizer checkpoint is the state of a recognizer,
+written out as a block of memory,
+from which a new recognizer can be created
+to continue the parse.
+As with grammar snapshots,
+Libmarpa does no file IO.
+\par
+The Earley sets, and the Earley items, postdot items,
+Leo items and source links within them,
+point at each other.
+In the checkpoint, these pointers are replaced with ordinals.
+An Earley set is written as its ordinal,
+an Earley item as the ordinal of its Earley set
+and its ordinal within that set,
+and a Leo item as the ordinal of its Earley set
+and its postdot symbol.
+A Leo item is always the first postdot item
+for its symbol,
+so that its Earley set and its symbol are enough to find it.
+Grammar objects are written as their ID's.
+No structure is written as an image,
+so that, unlike a snapshot,
+a checkpoint does not depend on the layout of the structures.
+\par
+Only the state which determines the rest of the parse
+is written.
+The events, the work areas,
+and the caches, such as the prediction memo,
+are not.
+Nor are the pointer values of the Earley sets
+and the memory budget,
+which are for the application to set again
+if it needs them.
+\par
+The checkpoint is written and read with the writer
+and reader of the grammar snapshots.
+
+@ The checkpoint header.
+The grammar of the recognizer is identified
+by the counts of its objects,
+and by a fingerprint of its IRL's.
+|0x4d52434b| is the ASCII for `MRCK'.
+@d RCHK_MAGIC 0x4d52434b
+@<Private structures@> =
+struct s_rchk_header {
+    int t_magic;
+    int t_major_version;
+    int t_minor_version;
+    int t_micro_version;
     @t}\comment{@>
-    /* Assumes that predictions are last in the YS.
-    There will always be a non-prediction to end the loop,
-    because there is always a scanned or an initial YIM.
-    */
-    while (YIM_was_Predicted(yim)) {
-      prediction_by_irl[IRLID_of_YIM(yim)] = yim_ix;
-      yim = yims_to_clean[--yim_ix];
+    /* The size of the checkpoint, in bytes,
+    and the checksum of everything after the header */
+    int t_size;
+    unsigned int t_checksum;
+    int t_xsy_count;
+    int t_nsy_count;
+    int t_irl_count;
+    int t_ahm_count;
+    int t_gzwa_count;
+    unsigned int t_grammar_fingerprint;
+};
+typedef struct s_rchk_header RCHK_HEADER_Object;
+
+@ Initialize the parts of the header which must match
+for a checkpoint to be restored.
+@<Function definitions@> =
+PRIVATE void
+rchk_header_init (GRAMMAR g, RCHK_HEADER_Object * header)
+{
+  header->t_magic = RCHK_MAGIC;
+  header->t_major_version = marpa_major_version;
+  header->t_minor_version = marpa_minor_version;
+  header->t_micro_version = marpa_micro_version;
+  header->t_size = 0;
+  header->t_checksum = 0;
+  header->t_xsy_count = XSY_Count_of_G (g);
+  header->t_nsy_count = NSY_Count_of_G (g);
+  header->t_irl_count = IRL_Count_of_G (g);
+  header->t_ahm_count = AHM_Count_of_G (g);
+  header->t_gzwa_count = ZWA_Count_of_G (g);
+  header->t_grammar_fingerprint = rchk_grammar_fingerprint (g);
+}
+
+@ The fingerprint combines the checksums
+of the symbols of each IRL.
+@<Function definitions@> =
+PRIVATE unsigned int
+rchk_grammar_fingerprint (GRAMMAR g)
+{
+  unsigned int fingerprint = 2166136261u;
+  IRLID irl_id;
+  for (irl_id = 0; irl_id < IRL_Count_of_G (g); irl_id++)
+    {
+      const IRL irl = IRL_by_ID (irl_id);
+      fingerprint ^=
+        gsnap_checksum ((const unsigned char *) irl->t_nsyid_array,
+                        ((size_t) Length_of_IRL (irl) +
+                         1) * sizeof (irl->t_nsyid_array[0]));
+      fingerprint *= 16777619u;
     }
+  return fingerprint;
 }
 
-@ @<First revision pass over |ys_to_clean|@> = {
-    int yim_to_clean_ix;
-    for (yim_to_clean_ix = 0;
-         yim_to_clean_ix < yim_to_clean_count;
-         yim_to_clean_ix++)
-      {
-        const YIM yim_to_clean = yims_to_clean[yim_to_clean_ix];
-
-        @t}\comment{@>
-        /* The initial YIM is always active and can {\bf never}
-        be rejected. */
-        MARPA_ASSERT (!YIM_is_Initial(yim_to_clean) ||
-            (YIM_is_Active(yim_to_clean) && !YIM_is_Rejected(yim_to_clean)));
-
-        @t}\comment{@>
-        /* Non-initial YIM's are inactive until proven active. */
-        if (!YIM_is_Initial(yim_to_clean)) YIM_is_Active(yim_to_clean) = 0;
-
-        @t}\comment{@>
-        /* If a YIM is rejected, which at this point means that it
-        was directly rejected, that is the end of the story.
-        We don't use it to update
-        the acceptance matrix.  */
-        if (YIM_is_Rejected(yim_to_clean)) continue;
-
-        @t}\comment{@>
-        /* Add un-rejected predictions to acceptance matrix. */
-        @<Add predictions from |yim_to_clean| to acceptance matrix@>@;
-
-        @t}\comment{@>
-        /* YIM's may have both scanned and fusion links.
-        Change the following so it looks at both kinds of link
-        for all YIM's. */
+@ References to Earley sets, Earley items and Leo items.
+A |NULL| reference is written as |-1|,
+in each of its integers.
+@<Function definitions@> =
+PRIVATE void
+rchk_ys_write (GSNAP_WRITER w, YS set)
+{
+  gsnap_int_write (w, set ? Ord_of_YS (set) : -1);
+}
 
-      }
+PRIVATE void
+rchk_yim_write (GSNAP_WRITER w, YIM yim)
+{
+  if (!yim)
+    {
+      gsnap_int_write (w, -1);
+      gsnap_int_write (w, -1);
+      return;
+    }
+  gsnap_int_write (w, YS_Ord_of_YIM (yim));
+  gsnap_int_write (w, Ord_of_YIM (yim));
 }
 
-@ @<Add predictions from |yim_to_clean| to acceptance matrix@> =
+PRIVATE void
+rchk_lim_write (GSNAP_WRITER w, LIM lim)
 {
-  const NSYID postdot_nsyid = Postdot_NSYID_of_YIM (yim_to_clean);
-  if (postdot_nsyid >= 0)
+  if (!lim)
     {
-      int cil_ix;
-      const CIL lhs_cil = LHS_CIL_of_NSYID (postdot_nsyid);
-      const int cil_count = Count_of_CIL (lhs_cil);
-      for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
-	{
-	  const IRLID irlid = Item_of_CIL (lhs_cil, cil_ix);
-	  const int predicted_yim_ix = prediction_by_irl[irlid];
-          const YIM predicted_yim = yims_to_clean[predicted_yim_ix];
-          if (YIM_is_Rejected(predicted_yim)) continue;
-	  matrix_bit_set (acceptance_matrix, yim_to_clean_ix,
-			  predicted_yim_ix);
-	}
+      gsnap_int_write (w, -1);
+      gsnap_int_write (w, -1);
+      return;
     }
+  gsnap_int_write (w, Ord_of_YS (YS_of_LIM (lim)));
+  gsnap_int_write (w, Postdot_NSYID_of_LIM (lim));
 }
 
-@ Mark YIM's not active if not scanned.
-If scanned, we can make a preliminary determination whether
-it is accepted based on
-the absence direct rejection and the presence of
-at least one unrejected token link.
-(A scanned YIM may have fusion links.)
-If this preliminary determination indicates that the
-scanned YIM is active, we mark it that way.
-@ We need the preliminary indication, because when we
-compute the accepted YIM's from
-the transition closure of acceptances, we need a set of YIM's
-as a starting point.
-In Earley set 0, the initial YIM is the starting point,
-but in all later sets, the scanned YIM's are the starting
-points.
-We know that
-every unrejected YIM will trace back, in its YS,
-to either the initial YIM or
-an unrejected token SRCL in an unrejected scanned YIM.
-@ A scanned YIM may have only rejected token SRCL's,
-but an accepted fusion SRCL.
-In effect, after the rejections, it is now a purely fusion
-YIM.
-We do not use
-such a now-purely-fusion, no-longer-scanned YIM as a
-starting point.
-We know this is safe, since
-in order to be accepted, every YIM must trace back to
-an unrejected YIM with unrejected token SRCL's,
-or to the initial YIM.
-@ If not rejected, scan SRCL's.
-For each SRCL, reject if predecessor or cause if rejected;
-otherwise, record as a dependency on cause.
-Add dependencies to acceptance matrix.
-If any dependency was recorded, also add any direct
-predictions of un-rejected YIM's.
+@ Boolean vectors are written as their words,
+without the hidden words of a |Bit_Vector|.
+A |NULL| CIL is written as a count of |-1|.
+@<Function definitions@> =
+PRIVATE void
+rchk_lbv_write (GSNAP_WRITER w, LBV lbv, int bits)
+{
+  gsnap_write (w, lbv, sizeof (LBW) * (size_t) lbv_bits_to_size (bits));
+}
 
-@ For every scanned or initial YIM in transitive closure,
-mark the to-YIM's of the dependency active.
-Mark all others rejected.
-@<Mark accepted YIM's@> = {
-    int cause_yim_ix;
-    for (cause_yim_ix = 0; cause_yim_ix < yim_to_clean_count; cause_yim_ix++) {
-      const YIM cause_yim = yims_to_clean[cause_yim_ix];
+PRIVATE void
+rchk_cil_write (GSNAP_WRITER w, CIL cil)
+{
+  int cil_ix;
+  int cil_count;
+  if (!cil)
+    {
+      gsnap_int_write (w, -1);
+      return;
+    }
+  cil_count = Count_of_CIL (cil);
+  gsnap_int_write (w, cil_count);
+  for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
+    gsnap_int_write (w, Item_of_CIL (cil, cil_ix));
+}
+
+@ The layout of the checkpoint is the header, followed by
+\li the scalars of the recognizer;
+\li its boolean vectors;
+\li its ZWA's;
+\li the Earley sets, each with its Earley items;
+\li the postdot items of each Earley set;
+\li the Leo items;
+\li the source links of each Earley item;
+\li and, finally, the pending token alternatives.
+\par
+Everything which points to an Earley item
+comes after all the Earley items,
+and everything which points to a Leo item
+comes after all the postdot items,
+so that every reference can be resolved as it is read.
+As with the snapshot,
+the checkpoint is written in two passes,
+the first of which only measures it.
+@<Function definitions@> =
+PRIVATE void
+rchk_body_write (RECCE r, GSNAP_WRITER w)
+{
+  @<Unpack recognizer objects@>@;
+  const int xsy_count = XSY_Count_of_G (g);
+  const int nsy_count = NSY_Count_of_G (g);
+  const int set_count = YS_Count_of_R (r);
+  @<Write the checkpoint scalars@>@;
+  @<Write the checkpoint boolean vectors@>@;
+  @<Write the checkpoint ZWAs@>@;
+  @<Write the checkpoint Earley sets@>@;
+  @<Write the checkpoint postdot items@>@;
+  @<Write the checkpoint Leo items@>@;
+  @<Write the checkpoint source links@>@;
+  @<Write the checkpoint alternatives@>@;
+}
+
+@ @<Write the checkpoint scalars@> =
+{
+  gsnap_int_write (w, Input_Phase_of_R (r));
+  gsnap_int_write (w, R_is_Exhausted (r));
+  gsnap_int_write (w, r->t_use_leo_flag);
+  gsnap_int_write (w, r->t_is_using_leo);
+  gsnap_int_write (w, r->t_use_postdot_index);
+  gsnap_int_write (w, r->t_use_prediction_memo);
+  gsnap_int_write (w, Current_Earleme_of_R (r));
+  gsnap_int_write (w, Furthest_Earleme_of_R (r));
+  gsnap_int_write (w, r->t_earley_item_warning_threshold);
+  gsnap_int_write (w, r->t_active_event_count);
+}
+
+@ @<Write the checkpoint boolean vectors@> =
+{
+  rchk_lbv_write (w, r->t_lbv_xsyid_completion_event_is_active, xsy_count);
+  rchk_lbv_write (w, r->t_lbv_xsyid_nulled_event_is_active, xsy_count);
+  rchk_lbv_write (w, r->t_lbv_xsyid_prediction_event_is_active, xsy_count);
+  rchk_lbv_write (w, r->t_nsy_expected_is_event, nsy_count);
+  rchk_lbv_write (w, r->t_bv_nsyid_is_expected, nsy_count);
+  rchk_lbv_write (w, r->t_valued_terminal, xsy_count);
+  rchk_lbv_write (w, r->t_unvalued_terminal, xsy_count);
+  rchk_lbv_write (w, r->t_valued, xsy_count);
+  rchk_lbv_write (w, r->t_unvalued, xsy_count);
+  rchk_lbv_write (w, r->t_valued_locked, xsy_count);
+}
+
+@ @<Write the checkpoint ZWAs@> =
+{
+  ZWAID zwaid;
+  for (zwaid = 0; zwaid < ZWA_Count_of_R (r); zwaid++)
+    {
+      const ZWA zwa = RZWA_by_ID (zwaid);
+      gsnap_int_write (w, Default_Value_of_ZWA (zwa));
+      gsnap_int_write (w, Memo_Value_of_ZWA (zwa));
+      gsnap_int_write (w, Memo_YSID_of_ZWA (zwa));
+    }
+}
+
+@ The Earley items of each set are written in the order of
+their ordinals,
+so that the Earley items of the restored set
+are given the same ordinals.
+The flags of an Earley item are packed into an |int|.
+Its source type is written with its source links.
+@d RCHK_YIM_IS_REJECTED 0x1
+@d RCHK_YIM_IS_ACTIVE 0x2
+@d RCHK_YIM_WAS_SCANNED 0x4
+@d RCHK_YIM_WAS_FUSION 0x8
+@<Write the checkpoint Earley sets@> =
+{
+  int ysid;
+  gsnap_int_write (w, set_count);
+  for (ysid = 0; ysid < set_count; ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      const YIM *const yims = YIMs_of_YS (set);
+      const int yim_count = YIM_Count_of_YS (set);
+      int yim_ix;
+      gsnap_int_write (w, Earleme_of_YS (set));
+      gsnap_int_write (w, Value_of_YS (set));
+      gsnap_int_write (w, yim_count);
+      for (yim_ix = 0; yim_ix < yim_count; yim_ix++)
+        {
+          const YIM yim = yims[yim_ix];
+          gsnap_int_write (w, (int) AHMID_of_YIM (yim));
+          gsnap_int_write (w, Origin_Ord_of_YIM (yim));
+          gsnap_int_write (w,
+                           (YIM_is_Rejected (yim) ? RCHK_YIM_IS_REJECTED : 0)
+                           | (YIM_is_Active (yim) ? RCHK_YIM_IS_ACTIVE : 0)
+                           | (YIM_was_Scanned (yim) ? RCHK_YIM_WAS_SCANNED : 0)
+                           | (YIM_was_Fusion (yim) ? RCHK_YIM_WAS_FUSION : 0));
+        }
+    }
+}
 
-      @t}\comment{@>
-      /* We only need look at the indirect effects of
-      initial and scanned YIM's, because they are the indirect
-      cause of all other YIM's in the YS. */
-      if (!YIM_is_Initial(cause_yim) &&
-        !YIM_was_Scanned(cause_yim)) break;
+@ The postdot items of each Earley set are written
+in the order of its postdot array,
+as the postdot symbol and the length of its chain of postdot items,
+followed by an entry for each postdot item in the chain.
+The entry for an Earley index is the ordinal of its Earley item.
+The entry for a Leo item is |-1|.
+@<Write the checkpoint postdot items@> =
+{
+  int ysid;
+  for (ysid = 0; ysid < set_count; ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      const int postdot_sym_count = Postdot_SYM_Count_of_YS (set);
+      int postdot_ix;
+      gsnap_int_write (w, postdot_sym_count);
+      for (postdot_ix = 0; postdot_ix < postdot_sym_count; postdot_ix++)
+        {
+          const PIM first_pim = set->t_postdot_ary[postdot_ix];
+          PIM pim;
+          int pim_count = 0;
+          for (pim = first_pim; pim; pim = Next_PIM_of_PIM (pim))
+            pim_count++;
+          gsnap_int_write (w, Postdot_NSYID_of_PIM (first_pim));
+          gsnap_int_write (w, pim_count);
+          for (pim = first_pim; pim; pim = Next_PIM_of_PIM (pim))
+            {
+              const YIM yim = YIM_of_PIM (pim);
+              gsnap_int_write (w, yim ? Ord_of_YIM (yim) : -1);
+            }
+        }
+    }
+}
 
-      @t}\comment{@>
-      /* an indirect cause YIM may have been directly
-      rejected, if which cause we do not use it, but keep
-      looking for other indirect causes. */
-      if (YIM_is_Rejected(cause_yim)) continue;
+@ The Leo items are written in the order in which
+they occur in the postdot items.
+@d RCHK_LIM_IS_REJECTED 0x1
+@d RCHK_LIM_IS_ACTIVE 0x2
+@<Write the checkpoint Leo items@> =
+{
+  int ysid;
+  for (ysid = 0; ysid < set_count; ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      int postdot_ix;
+      for (postdot_ix = 0; postdot_ix < Postdot_SYM_Count_of_YS (set);
+           postdot_ix++)
+        {
+          PIM pim;
+          for (pim = set->t_postdot_ary[postdot_ix]; pim;
+               pim = Next_PIM_of_PIM (pim))
+            {
+              LIM lim;
+              if (!PIM_is_LIM (pim))
+                continue;
+              lim = LIM_of_PIM (pim);
+              rchk_ys_write (w, Origin_of_LIM (lim));
+              gsnap_int_write (w, (int) ID_of_AHM (Top_AHM_of_LIM (lim)));
+              gsnap_int_write (w,
+                               (int) ID_of_AHM (Trailhead_AHM_of_LIM (lim)));
+              rchk_yim_write (w, Trailhead_YIM_of_LIM (lim));
+              rchk_lim_write (w, Predecessor_LIM_of_LIM (lim));
+              rchk_cil_write (w, CIL_of_LIM (lim));
+              gsnap_int_write (w,
+                               (LIM_is_Rejected (lim) ?
+                                RCHK_LIM_IS_REJECTED : 0) |
+                               (LIM_is_Active (lim) ? RCHK_LIM_IS_ACTIVE :
+                                0));
+            }
+        }
+    }
+}
 
-      {
-        const Bit_Vector bv_yims_to_accept
-          = matrix_row (acceptance_matrix, cause_yim_ix);
-        int min, max, start;
-        for (start = 0; bv_scan (bv_yims_to_accept, start, &min, &max);
-             start = max + 2)
-          {
-            int yim_to_accept_ix;
-            for (yim_to_accept_ix = min;
-                 yim_to_accept_ix <= max; yim_to_accept_ix++)
-              {
-                const YIM yim_to_accept = yims_to_clean[yim_to_accept_ix];
-                YIM_is_Active (yim_to_accept) = 1;
-              }
-          }
-      }
+@ The source links of each Earley item are written
+after its source type.
+An Earley item with a single source has a single link.
+An ambiguous Earley item has three lists of links,
+for its Leo, token and completion sources,
+each written as its length, followed by its links.
+The order of the links is kept,
+so that the bocages of the restored recognizer
+are the same, and in the same order,
+as those of the original.
+@<Write the checkpoint source links@> =
+{
+  int ysid;
+  for (ysid = 0; ysid < set_count; ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      const YIM *const yims = YIMs_of_YS (set);
+      int yim_ix;
+      for (yim_ix = 0; yim_ix < YIM_Count_of_YS (set); yim_ix++)
+        {
+          const YIM yim = yims[yim_ix];
+          const unsigned int source_type = Source_Type_of_YIM (yim);
+          gsnap_int_write (w, (int) source_type);
+          switch (source_type)
+            {
+            case SOURCE_IS_TOKEN:
+            case SOURCE_IS_COMPLETION:
+            case SOURCE_IS_LEO:
+              rchk_srcl_write (w, source_type, SRCL_of_YIM (yim));
+              break;
+            case SOURCE_IS_AMBIGUOUS:
+              rchk_srcl_list_write (w, SOURCE_IS_LEO,
+                                    LV_First_Leo_SRCL_of_YIM (yim));
+              rchk_srcl_list_write (w, SOURCE_IS_TOKEN,
+                                    LV_First_Token_SRCL_of_YIM (yim));
+              rchk_srcl_list_write (w, SOURCE_IS_COMPLETION,
+                                    LV_First_Completion_SRCL_of_YIM (yim));
+              break;
+            }
+        }
     }
 }
 
-@ This pass is probably not necessary, because I should be checking
-the active boolean from here on.
-But it restores the "consistent" state where a YIM is either rejected
-or accepted.
-@<Mark un-accepted YIM's rejected@> = {
-    int yim_ix;
-    for (yim_ix = 0; yim_ix < yim_to_clean_count; yim_ix++) {
-      const YIM yim = yims_to_clean[yim_ix];
-      if (!YIM_is_Active(yim)) continue;
-      YIM_is_Rejected(yim) = 1;
+@ @d RCHK_SRC_IS_REJECTED 0x1
+@d RCHK_SRC_IS_ACTIVE 0x2
+@<Function definitions@> =
+PRIVATE void
+rchk_srcl_write (GSNAP_WRITER w, unsigned int source_type, SRCL srcl)
+{
+  switch (source_type)
+    {
+    case SOURCE_IS_TOKEN:
+      rchk_yim_write (w, Predecessor_of_SRCL (srcl));
+      gsnap_int_write (w, NSYID_of_SRCL (srcl));
+      gsnap_int_write (w, Value_of_SRCL (srcl));
+      break;
+    case SOURCE_IS_COMPLETION:
+      rchk_yim_write (w, Predecessor_of_SRCL (srcl));
+      rchk_yim_write (w, Cause_of_SRCL (srcl));
+      break;
+    case SOURCE_IS_LEO:
+      rchk_lim_write (w, LIM_of_SRCL (srcl));
+      rchk_yim_write (w, Cause_of_SRCL (srcl));
+      break;
     }
+  gsnap_int_write (w,
+                   (SRCL_is_Rejected (srcl) ? RCHK_SRC_IS_REJECTED : 0)
+                   | (SRCL_is_Active (srcl) ? RCHK_SRC_IS_ACTIVE : 0));
 }
 
-@ {\bf To Do}: @^To Do@>
-Deferred while we are only dealing with YS 0.
-@ We now have a full census of accepted and rejected YIM's.
-Use this to go back over SRCL's.
-These will all be resolveable one way or the other.
-@<Mark accepted SRCL's@> = {}
+PRIVATE void
+rchk_srcl_list_write (GSNAP_WRITER w, unsigned int source_type,
+                      SRCL first_srcl)
+{
+  SRCL srcl;
+  int srcl_count = 0;
+  for (srcl = first_srcl; srcl; srcl = Next_SRCL_of_SRCL (srcl))
+    srcl_count++;
+  gsnap_int_write (w, srcl_count);
+  for (srcl = first_srcl; srcl; srcl = Next_SRCL_of_SRCL (srcl))
+    rchk_srcl_write (w, source_type, srcl);
+}
 
-@ Mark LIM's as accepted or rejected, based on
-their predecessors and trailhead YIM's.
-@<Mark rejected LIM's@> =
+@ The pending alternatives are written bucket by bucket.
+They are sorted again as they are restored.
+@<Write the checkpoint alternatives@> =
 {
-  int postdot_sym_ix;
-  const int postdot_sym_count = Postdot_SYM_Count_of_YS(ys_to_clean);
-  const PIM* postdot_array = ys_to_clean->t_postdot_ary;
+  int bucket_ix;
+  gsnap_int_write (w, ALT_Count_of_R (r));
+  for (bucket_ix = 0; bucket_ix < ALT_BUCKET_COUNT; bucket_ix++)
+    {
+      const MARPA_DSTACK bucket = r->t_alternative_buckets + bucket_ix;
+      int alternative_ix;
+      for (alternative_ix = 0; alternative_ix < MARPA_DSTACK_LENGTH (*bucket);
+           alternative_ix++)
+        {
+          const ALT alternative =
+            MARPA_DSTACK_INDEX (*bucket, ALT_Object, alternative_ix);
+          rchk_ys_write (w, Start_YS_of_ALT (alternative));
+          gsnap_int_write (w, End_Earleme_of_ALT (alternative));
+          gsnap_int_write (w, NSYID_of_ALT (alternative));
+          gsnap_int_write (w, Value_of_ALT (alternative));
+          gsnap_int_write (w, ALT_is_Valued (alternative));
+        }
+    }
+}
 
-  @t}\comment{@>
-  /* For every postdot symbol */
-  for (postdot_sym_ix = 0; postdot_sym_ix < postdot_sym_count; postdot_sym_ix++) {
-      @t}\comment{@>
-      /* If there is a LIM, there will be only one,
-      and it will be the first PIM. */
-     const PIM first_pim = postdot_array[postdot_sym_ix];
-     if (PIM_is_LIM(first_pim)) {
-         const LIM lim = LIM_of_PIM(first_pim);
+@ Returns the size of the checkpoint in bytes, on success.
+If |buffer| is |NULL|, or |buffer_size| is less than the size
+of the checkpoint, nothing is written.
+An inconsistent recognizer cannot be checkpointed,
+so that the checkpoint never needs to record
+the progress of a revision.
+@<Function definitions@> =
+int
+marpa_r_checkpoint (Marpa_Recognizer r, void *buffer, size_t buffer_size)
+{
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  struct s_gsnap_writer writer;
+  int checkpoint_size;
+  @<Fail if recognizer has a fatal error@>@;
+  @<Fail if recognizer not started@>@;
+  if (_MARPA_UNLIKELY (!R_is_Consistent (r)))
+    {
+      MARPA_R_ERROR (MARPA_ERR_RECCE_IS_INCONSISTENT);
+      return failure_indicator;
+    }
+  r_update_earley_sets (r);
+  writer.t_cil_tree = NULL;
+  MARPA_DSTACK_SAFE (writer.t_cil_stack);
+  writer.t_cil_area_size = 0;
+  writer.t_base = NULL;
+  writer.t_offset = sizeof (RCHK_HEADER_Object);
+  rchk_body_write (r, &writer);
+  if (_MARPA_UNLIKELY (writer.t_offset > INT_MAX))
+    {
+      MARPA_R_ERROR (MARPA_ERR_INVALID_CHECKPOINT);
+      return failure_indicator;
+    }
+  checkpoint_size = (int) writer.t_offset;
+  if (buffer && buffer_size >= writer.t_offset)
+    {
+      writer.t_base = buffer;
+      writer.t_offset = sizeof (RCHK_HEADER_Object);
+      rchk_body_write (r, &writer);
+      @<Write the checkpoint header@>@;
+    }
+  return checkpoint_size;
+}
 
-         @t}\comment{@>
-         /* Reject LIM by default */
-         LIM_is_Rejected(lim) = 1;
-         LIM_is_Active(lim) = 0;
+@ @<Write the checkpoint header@> =
+{
+  RCHK_HEADER_Object header;
+  const size_t header_size = sizeof (header);
+  rchk_header_init (g, &header);
+  header.t_size = checkpoint_size;
+  header.t_checksum =
+    gsnap_checksum ((unsigned char *) buffer + header_size,
+                    (size_t) checkpoint_size - header_size);
+  memcpy (buffer, &header, header_size);
+}
 
-         @t}\comment{@>
-         /* Reject, because the base-to YIM is not active */
-         if (!YIM_is_Active(Trailhead_YIM_of_LIM(lim))) continue;
-         {
-           const LIM predecessor_lim = Predecessor_LIM_of_LIM(lim);
-           @t}\comment{@>
-           /* Reject, because the predecessor LIM exists and is not active */
-           if (predecessor_lim && !LIM_is_Active(predecessor_lim)) continue;
-         }
+@*0 Restoring a checkpoint.
+Every reference read from a checkpoint is checked,
+so that one which is out of range fails the restore,
+instead of becoming a wild pointer.
+@<Function definitions@> =
+PRIVATE int
+rchk_ys_read (RECCE r, GSNAP_READER rd, YS * p_set)
+{
+  int ysid;
+  if (!gsnap_int_read (rd, &ysid))
+    return 0;
+  if (ysid == -1)
+    {
+      *p_set = NULL;
+      return 1;
+    }
+  if (!YS_Ord_is_Valid (r, ysid))
+    return 0;
+  *p_set = YS_of_R_by_Ord (r, ysid);
+  return 1;
+}
+
+PRIVATE int
+rchk_yim_read (RECCE r, GSNAP_READER rd, YIM * p_yim)
+{
+  YS set;
+  int yim_ix;
+  if (!rchk_ys_read (r, rd, &set) || !gsnap_int_read (rd, &yim_ix))
+    return 0;
+  if (!set)
+    {
+      *p_yim = NULL;
+      return yim_ix == -1;
+    }
+  if (yim_ix < 0 || yim_ix >= YIM_Count_of_YS (set))
+    return 0;
+  *p_yim = YIMs_of_YS (set)[yim_ix];
+  return 1;
+}
+
+PRIVATE int
+rchk_lim_read (RECCE r, GSNAP_READER rd, LIM * p_lim)
+{
+  @<Unpack recognizer objects@>@;
+  YS set;
+  int nsyid;
+  PIM pim;
+  if (!rchk_ys_read (r, rd, &set) || !gsnap_int_read (rd, &nsyid))
+    return 0;
+  if (!set)
+    {
+      *p_lim = NULL;
+      return nsyid == -1;
+    }
+  if (nsyid < 0 || nsyid >= NSY_Count_of_G (g))
+    return 0;
+  pim = First_PIM_of_YS_by_NSYID (set, nsyid);
+  if (!pim || !PIM_is_LIM (pim))
+    return 0;
+  *p_lim = LIM_of_PIM (pim);
+  return 1;
+}
 
-         @t}\comment{@>
-         /* No reason found to reject, so accept this LIM */
-         LIM_is_Rejected(lim) = 0;
-         LIM_is_Active(lim) = 1;
-     }
-  }
+@ The CIL's of the Leo items are added
+to the recognizer's CILAR.
+@<Function definitions@> =
+PRIVATE int
+rchk_lbv_read (GSNAP_READER rd, LBV lbv, int bits)
+{
+  return gsnap_read (rd, lbv, sizeof (LBW) * (size_t) lbv_bits_to_size (bits));
 }
 
-@ For all pending alternatives, determine if
-they have unrejected predecessors.
-If not, remove them from the stack.
-Readjust furthest earleme.
-Note that moving the furthest earleme may
-change the parse to exhausted state.
-@<Clean pending alternatives@> = {
-    int old_alt_ix;
-    int no_of_alternatives = MARPA_DSTACK_LENGTH (r->t_alternatives );
-
-   @t}\comment{@>
-   /* Increment |old_alt_ix| until it is one past the initial run
-   of accept-able alternatives.  If there were none, this leaves
-   |old_alt_ix| at 0.  If all alternatives were acceptable, this
-   leaves |old_alt_ix| at |no_of_alternatives|. */
-    for (old_alt_ix = 0;
-         old_alt_ix < no_of_alternatives;
-         old_alt_ix++)
-   {
-        const ALT alternative = MARPA_DSTACK_INDEX(
-          r->t_alternatives, ALT_Object, old_alt_ix);
-        if (!alternative_is_acceptable(alternative)) break;
+PRIVATE int
+rchk_cil_read (RECCE r, GSNAP_READER rd, CIL * p_cil)
+{
+  @<Unpack recognizer objects@>@;
+  int cil_count;
+  int cil_ix;
+  if (!gsnap_int_read (rd, &cil_count))
+    return 0;
+  if (cil_count == -1)
+    {
+      *p_cil = NULL;
+      return 1;
     }
+  if (cil_count < 0 || !gsnap_has (rd, (size_t) cil_count * sizeof (int)))
+    return 0;
+  cil_buffer_clear (&r->t_cilar);
+  for (cil_ix = 0; cil_ix < cil_count; cil_ix++)
+    {
+      int ahmid;
+      if (!gsnap_id_read (rd, AHM_Count_of_G (g), &ahmid) || ahmid < 0)
+        return 0;
+      cil_buffer_push (&r->t_cilar, ahmid);
+    }
+  *p_cil = cil_buffer_add (&r->t_cilar);
+  return 1;
+}
 
-    @t}\comment{@>
-    /* If we found an un-acceptable alternative, we need to adjust the alterntives
-    stack.  First we shorten the alternatives stack, copying acceptable alternatives
-    to newly emptied slots in the stack until there are no gaps left. */
-    if (old_alt_ix < no_of_alternatives) {
-        @t}\comment{@>
-        /* |empty_alt_ix| is the empty slot, into which the next acceptable alternative
-        should be copied. */
-        int empty_alt_ix = old_alt_ix;
-        for (old_alt_ix++; old_alt_ix < no_of_alternatives; old_alt_ix++)
-          {
-            const ALT alternative = MARPA_DSTACK_INDEX(
-              r->t_alternatives, ALT_Object, old_alt_ix);
-            if (!alternative_is_acceptable(alternative)) continue;
-            *MARPA_DSTACK_INDEX(r->t_alternatives, ALT_Object, empty_alt_ix)
-              = *alternative;
-            empty_alt_ix++;
-          }
-
-      @t}\comment{@>
-      /* |empty_alt_ix| points to the first available slot, so it is now the same
-      as the new stack length */
-      MARPA_DSTACK_COUNT_SET(r->t_alternatives, empty_alt_ix);
-
-      if (empty_alt_ix) {
-        Furthest_Earleme_of_R(r) = Earleme_of_YS(current_ys);
-      } else {
-        const ALT furthest_alternative
-          = MARPA_DSTACK_INDEX(r->t_alternatives, ALT_Object, 0);
-        Furthest_Earleme_of_R(r) = End_Earleme_of_ALT(furthest_alternative);
+@ @<Function definitions@> =
+PRIVATE int
+rchk_srcl_read (RECCE r, GSNAP_READER rd, unsigned int source_type,
+                SRCL srcl)
+{
+  @<Unpack recognizer objects@>@;
+  int flags;
+  switch (source_type)
+    {
+    case SOURCE_IS_TOKEN:
+      {
+        YIM predecessor;
+        int nsyid;
+        int value;
+        if (!rchk_yim_read (r, rd, &predecessor)
+            || !gsnap_int_read (rd, &nsyid) || !gsnap_int_read (rd, &value))
+          return 0;
+        if (nsyid < 0 || nsyid >= NSY_Count_of_G (g))
+          return 0;
+        Predecessor_of_SRCL (srcl) = predecessor;
+        NSYID_of_SRCL (srcl) = nsyid;
+        Value_of_SRCL (srcl) = value;
       }
-
+      break;
+    case SOURCE_IS_COMPLETION:
+      {
+        YIM predecessor;
+        YIM cause;
+        if (!rchk_yim_read (r, rd, &predecessor)
+            || !rchk_yim_read (r, rd, &cause) || !cause)
+          return 0;
+        Predecessor_of_SRCL (srcl) = predecessor;
+        Cause_of_SRCL (srcl) = cause;
+      }
+      break;
+    case SOURCE_IS_LEO:
+      {
+        LIM predecessor;
+        YIM cause;
+        if (!rchk_lim_read (r, rd, &predecessor) || !predecessor
+            || !rchk_yim_read (r, rd, &cause) || !cause)
+          return 0;
+        Predecessor_of_SRCL (srcl) = predecessor;
+        Cause_of_SRCL (srcl) = cause;
+      }
+      break;
     }
+  if (!gsnap_int_read (rd, &flags))
+    return 0;
+  SRCL_is_Rejected (srcl) = (flags & RCHK_SRC_IS_REJECTED) != 0;
+  SRCL_is_Active (srcl) = (flags & RCHK_SRC_IS_ACTIVE) != 0;
+  Next_SRCL_of_SRCL (srcl) = NULL;
+  return 1;
+}
 
+@ The links of a list are allocated as |unique_srcl_new|
+and |earley_item_ambiguate| allocate them,
+so that the restored recognizer's count of source links
+agrees with the original's.
+@<Function definitions@> =
+PRIVATE int
+rchk_srcl_list_read (RECCE r, GSNAP_READER rd, unsigned int source_type,
+                     SRCL * p_first_srcl)
+{
+  SRCL *p_next_srcl = p_first_srcl;
+  int srcl_count;
+  int srcl_ix;
+  *p_first_srcl = NULL;
+  if (!gsnap_int_read (rd, &srcl_count) || srcl_count < 0)
+    return 0;
+  for (srcl_ix = 0; srcl_ix < srcl_count; srcl_ix++)
+    {
+      const SRCL srcl = marpa_obs_new (r->t_ys_obs, SRCL_Object, 1);
+      SRCL_Count_of_R (r)++;
+      if (!rchk_srcl_read (r, rd, source_type, srcl))
+        return 0;
+      *p_next_srcl = srcl;
+      p_next_srcl = &Next_SRCL_of_SRCL (srcl);
+    }
+  return 1;
 }
 
-@ @<Function definitions@> =
-PRIVATE int alternative_is_acceptable(ALT alternative)
+@ The checkpoint is copied into the new recognizer,
+so that the application may free it
+as soon as this method returns.
+The recognizer is created by |marpa_r_new|,
+and is then set up as |marpa_r_start_input| would
+set it up, before its state is read from the checkpoint.
+@<Function definitions@> =
+Marpa_Recognizer
+marpa_r_restore (Marpa_Grammar g, const void *checkpoint,
+                 size_t checkpoint_size)
 {
-  PIM pim;
-  const NSYID token_symbol_id = NSYID_of_ALT(alternative);
-  const YS start_ys = Start_YS_of_ALT(alternative);
-  for (pim= First_PIM_of_YS_by_NSYID(start_ys, token_symbol_id);
-      pim;
-      pim = Next_PIM_of_PIM(pim))
+  @<Return |NULL| on failure@>@;
+  RCHK_HEADER_Object header;
+  struct s_gsnap_reader reader;
+  GSNAP_READER const rd = &reader;
+  RECCE r;
+  @<Fail if fatal error@>@;
+  @<Fail if not precomputed@>@;
+  @<Check the checkpoint header@>@;
+  r = marpa_r_new (g);
+  if (!r)
+    return failure_indicator;
   {
-      YIM predecessor_yim = YIM_of_PIM(pim);
+    const XSYID xsy_count = XSY_Count_of_G (g);
+    const NSYID nsy_count = NSY_Count_of_G (g);
+    @<Restore the checkpoint scalars@>@;
+    @<Prepare the restored recognizer@>@;
+    @<Restore the checkpoint boolean vectors@>@;
+    @<Restore the checkpoint ZWAs@>@;
+    @<Restore the checkpoint Earley sets@>@;
+    @<Restore the checkpoint postdot items@>@;
+    @<Restore the checkpoint Leo items@>@;
+    @<Restore the checkpoint source links@>@;
+    @<Restore the checkpoint alternatives@>@;
+    if (rd->t_offset != rd->t_size)
+      goto RECCE_FAILURE;
+    @<Create the postdot indexes of the restored recognizer@>@;
+    ys_segment_open (r);
+  }
+  R_EVENTS_CLEAR (r);
+  return r;
+RECCE_FAILURE:
+  recce_unref (r);
+CHECKPOINT_FAILURE:
+  MARPA_ERROR (MARPA_ERR_INVALID_CHECKPOINT);
+  return failure_indicator;
+}
+
+@ A mismatch of versions is reported with the
+same error codes as |marpa_check_version()|.
+@<Check the checkpoint header@> =
+{
+  RCHK_HEADER_Object expected;
+  const size_t header_size = sizeof (header);
+  Marpa_Error_Code error_code;
+  if (checkpoint_size < header_size)
+    goto CHECKPOINT_FAILURE;
+  memcpy (&header, checkpoint, header_size);
+  if (header.t_magic != RCHK_MAGIC)
+    goto CHECKPOINT_FAILURE;
+  error_code =
+    marpa_check_version (header.t_major_version, header.t_minor_version,
+                         header.t_micro_version);
+  if (error_code != MARPA_ERR_NONE)
+    {
+      MARPA_ERROR (error_code);
+      return failure_indicator;
+    }
+  if (header.t_size < (int) header_size
+      || (size_t) header.t_size > checkpoint_size)
+    goto CHECKPOINT_FAILURE;
+  if (gsnap_checksum ((const unsigned char *) checkpoint + header_size,
+                      (size_t) header.t_size - header_size)
+      != header.t_checksum)
+    goto CHECKPOINT_FAILURE;
+  rchk_header_init (g, &expected);
+  if (header.t_xsy_count != expected.t_xsy_count
+      || header.t_nsy_count != expected.t_nsy_count
+      || header.t_irl_count != expected.t_irl_count
+      || header.t_ahm_count != expected.t_ahm_count
+      || header.t_gzwa_count != expected.t_gzwa_count
+      || header.t_grammar_fingerprint != expected.t_grammar_fingerprint)
+    goto CHECKPOINT_FAILURE;
+  reader.t_base = checkpoint;
+  reader.t_offset = header_size;
+  reader.t_size = (size_t) header.t_size;
+}
+
+@ @<Restore the checkpoint scalars@> =
+{
+  int input_phase;
+  int is_exhausted;
+  int use_leo_flag;
+  int is_using_leo;
+  int use_postdot_index;
+  int use_prediction_memo;
+  int current_earleme;
+  int furthest_earleme;
+  int earley_item_warning_threshold;
+  int active_event_count;
+  if (!gsnap_int_read (rd, &input_phase)
+      || !gsnap_int_read (rd, &is_exhausted)
+      || !gsnap_int_read (rd, &use_leo_flag)
+      || !gsnap_int_read (rd, &is_using_leo)
+      || !gsnap_int_read (rd, &use_postdot_index)
+      || !gsnap_int_read (rd, &use_prediction_memo)
+      || !gsnap_int_read (rd, &current_earleme)
+      || !gsnap_int_read (rd, &furthest_earleme)
+      || !gsnap_int_read (rd, &earley_item_warning_threshold)
+      || !gsnap_int_read (rd, &active_event_count))
+    goto RECCE_FAILURE;
+  if ((input_phase != R_DURING_INPUT && input_phase != R_AFTER_INPUT)
+      || current_earleme < 0 || furthest_earleme < 0
+      || earley_item_warning_threshold <= 0 || active_event_count < 0)
+    goto RECCE_FAILURE;
+  /* Masked, so that the compiler can see it fits the bitfield */
+  Input_Phase_of_R (r) = (unsigned int) input_phase & 0x3u;
+  R_is_Exhausted (r) = is_exhausted ? 1 : 0;
+  r->t_use_leo_flag = use_leo_flag ? 1 : 0;
+  r->t_is_using_leo = is_using_leo ? 1 : 0;
+  r->t_use_postdot_index = use_postdot_index ? 1 : 0;
+  r->t_use_prediction_memo = use_prediction_memo ? 1 : 0;
+  Current_Earleme_of_R (r) = current_earleme;
+  Furthest_Earleme_of_R (r) = furthest_earleme;
+  r->t_earley_item_warning_threshold = earley_item_warning_threshold;
+  r->t_active_event_count = active_event_count;
+}
+
+@ @<Prepare the restored recognizer@> =
+{
+  @<Set up terminal-related boolean vectors@>@;
+  if (!G_is_Trivial (g))
+    {
+      psar_reset (Dot_PSAR_of_R (r));
+      @<Allocate recognizer containers@>@;
+    }
+  @<Initialize Earley item work stacks@>@;
+}
 
-      @t}\comment{@>
-      /* If the trailhead PIM is non-active, the LIM will not
-      be active, so we don't bother looking at the LIM.
-      Instead we will wait for the source, which will be next
-      in the list of PIM's */
-      if (!predecessor_yim) continue;
+@ @<Restore the checkpoint boolean vectors@> =
+{
+  if (!rchk_lbv_read
+      (rd, r->t_lbv_xsyid_completion_event_is_active, xsy_count)
+      || !rchk_lbv_read (rd, r->t_lbv_xsyid_nulled_event_is_active,
+                         xsy_count)
+      || !rchk_lbv_read (rd, r->t_lbv_xsyid_prediction_event_is_active,
+                         xsy_count)
+      || !rchk_lbv_read (rd, r->t_nsy_expected_is_event, nsy_count)
+      || !rchk_lbv_read (rd, r->t_bv_nsyid_is_expected, nsy_count)
+      || !rchk_lbv_read (rd, r->t_valued_terminal, xsy_count)
+      || !rchk_lbv_read (rd, r->t_unvalued_terminal, xsy_count)
+      || !rchk_lbv_read (rd, r->t_valued, xsy_count)
+      || !rchk_lbv_read (rd, r->t_unvalued, xsy_count)
+      || !rchk_lbv_read (rd, r->t_valued_locked, xsy_count))
+    goto RECCE_FAILURE;
+}
 
-      /* We have an active predecessor, so this alternative is
-      OK. Move on to look at the next alterntive */
-      if (YIM_is_Active(predecessor_yim)) return 1;
-  }
-  return 0;
+@ @<Restore the checkpoint ZWAs@> =
+{
+  ZWAID zwaid;
+  for (zwaid = 0; zwaid < ZWA_Count_of_R (r); zwaid++)
+    {
+      const ZWA zwa = RZWA_by_ID (zwaid);
+      int default_value;
+      int memo_value;
+      int memo_ysid;
+      if (!gsnap_int_read (rd, &default_value)
+          || !gsnap_int_read (rd, &memo_value)
+          || !gsnap_int_read (rd, &memo_ysid))
+        goto RECCE_FAILURE;
+      Default_Value_of_ZWA (zwa) = default_value ? 1 : 0;
+      Memo_Value_of_ZWA (zwa) = memo_value ? 1 : 0;
+      Memo_YSID_of_ZWA (zwa) = memo_ysid;
+    }
+}
+
+@ The Earley items are created with |earley_item_create|,
+in the order of their ordinals,
+so that each is given its original ordinal.
+The Earley sets are put on the Earley set stack as they
+are created, so that the origins of the Earley items
+can be found by ordinal.
+@<Restore the checkpoint Earley sets@> =
+{
+  int set_count;
+  int ysid;
+  YS previous_set = NULL;
+  if (!gsnap_int_read (rd, &set_count) || set_count < 1)
+    goto RECCE_FAILURE;
+  for (ysid = 0; ysid < set_count; ysid++)
+    {
+      int earleme;
+      int value;
+      int yim_count;
+      int yim_ix;
+      YS set;
+      if (!gsnap_int_read (rd, &earleme)
+          || !gsnap_int_read (rd, &value)
+          || !gsnap_int_read (rd, &yim_count))
+        goto RECCE_FAILURE;
+      if (previous_set ? earleme <= Earleme_of_YS (previous_set) : earleme != 0)
+        goto RECCE_FAILURE;
+      if (yim_count < 0
+          || !gsnap_has (rd, (size_t) yim_count * 3 * sizeof (int)))
+        goto RECCE_FAILURE;
+      set = earley_set_new (r, earleme);
+      Obs_Mark_of_YS (set).chunk = NULL;
+      Value_of_YS (set) = value;
+      if (previous_set)
+        Next_YS_of_YS (previous_set) = set;
+      else
+        First_YS_of_R (r) = set;
+      Latest_YS_of_R (r) = set;
+      r_update_earley_sets (r);
+      for (yim_ix = 0; yim_ix < yim_count; yim_ix++)
+        {
+          int ahmid;
+          int origin_ysid;
+          int flags;
+          YIK_Object key;
+          YIM yim;
+          if (!gsnap_int_read (rd, &ahmid)
+              || !gsnap_int_read (rd, &origin_ysid)
+              || !gsnap_int_read (rd, &flags))
+            goto RECCE_FAILURE;
+          if (ahmid < 0 || ahmid >= AHM_Count_of_G (g)
+              || origin_ysid < 0 || origin_ysid > ysid)
+            goto RECCE_FAILURE;
+          key.t_ahm = AHM_by_ID (ahmid);
+          key.t_origin = YS_of_R_by_Ord (r, origin_ysid);
+          key.t_set = set;
+          yim = earley_item_create (r, key);
+          if (!yim)
+            goto RECCE_FAILURE;
+          YIM_is_Rejected (yim) = (flags & RCHK_YIM_IS_REJECTED) != 0;
+          YIM_is_Active (yim) = (flags & RCHK_YIM_IS_ACTIVE) != 0;
+          YIM_was_Scanned (yim) = (flags & RCHK_YIM_WAS_SCANNED) != 0;
+          YIM_was_Fusion (yim) = (flags & RCHK_YIM_WAS_FUSION) != 0;
+        }
+      earley_set_update_items (r, set);
+      previous_set = set;
+    }
+  if (Current_Earleme_of_R (r) < Earleme_of_YS (Latest_YS_of_R (r)))
+    goto RECCE_FAILURE;
 }
 
-@ @<Clean expected terminals@> = {}
+@ The postdot symbols of each Earley set must be in
+increasing order,
+because the postdot array is searched by symbol.
+@<Restore the checkpoint postdot items@> =
+{
+  int ysid;
+  for (ysid = 0; ysid < YS_Count_of_R (r); ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      int postdot_sym_count;
+      int postdot_ix;
+      NSYID previous_nsyid = -1;
+      if (!gsnap_int_read (rd, &postdot_sym_count)
+          || postdot_sym_count < 0 || postdot_sym_count > nsy_count)
+        goto RECCE_FAILURE;
+      Postdot_SYM_Count_of_YS (set) = postdot_sym_count;
+      set->t_postdot_ary = marpa_obs_new (r->t_ys_obs, PIM, postdot_sym_count);
+      r->t_postdot_array_bytes += sizeof (PIM) * (size_t) postdot_sym_count;
+      for (postdot_ix = 0; postdot_ix < postdot_sym_count; postdot_ix++)
+        {
+          PIM *p_next_pim = set->t_postdot_ary + postdot_ix;
+          int nsyid;
+          int pim_count;
+          int pim_ix;
+          if (!gsnap_int_read (rd, &nsyid) || !gsnap_int_read (rd, &pim_count))
+            goto RECCE_FAILURE;
+          if (nsyid <= previous_nsyid || nsyid >= nsy_count || pim_count < 1)
+            goto RECCE_FAILURE;
+          previous_nsyid = nsyid;
+          for (pim_ix = 0; pim_ix < pim_count; pim_ix++)
+            {
+              int yim_ix;
+              PIM pim;
+              if (!gsnap_int_read (rd, &yim_ix))
+                goto RECCE_FAILURE;
+              if (yim_ix == -1)
+                {
+                  pim = (PIM) marpa_obs_new (r->t_ys_obs, LIM_Object, 1);
+                  LIM_Count_of_R (r)++;
+                  YIM_of_PIM (pim) = NULL;
+                }
+              else
+                {
+                  if (yim_ix < 0 || yim_ix >= YIM_Count_of_YS (set))
+                    goto RECCE_FAILURE;
+                  pim = marpa__obs_alloc (r->t_ys_obs,
+                                          sizeof (YIX_Object),
+                                          ALIGNOF (PIM_Object));
+                  YIM_of_PIM (pim) = YIMs_of_YS (set)[yim_ix];
+                }
+              PIM_Count_of_R (r)++;
+              Postdot_NSYID_of_PIM (pim) = nsyid;
+              Next_PIM_of_PIM (pim) = NULL;
+              *p_next_pim = pim;
+              p_next_pim = &Next_PIM_of_PIM (pim);
+            }
+        }
+    }
+}
 
-@** Recognizer zero-width assertion code.
-@<Function definitions@> =
-int
-marpa_r_zwa_default_set(Marpa_Recognizer r,
-    Marpa_Assertion_ID zwaid,
-    int default_value)
+@ @<Restore the checkpoint Leo items@> =
 {
-  @<Return |-2| on failure@>@;
-  @<Unpack recognizer objects@>@;
-  ZWA zwa;
-  int old_default_value;
-  @<Fail if fatal error@>@;
-  @<Fail if |zwaid| is malformed@>@;
-  @<Fail if |zwaid| does not exist@>@;
-    if (_MARPA_UNLIKELY (default_value < 0 || default_value > 1))
-      {
-        MARPA_ERROR (MARPA_ERR_INVALID_BOOLEAN);
-        return failure_indicator;
-      }
-    zwa = RZWA_by_ID(zwaid);
-    old_default_value = Default_Value_of_ZWA(zwa);
-    Default_Value_of_ZWA(zwa) = default_value ? 1 : 0;
-    return old_default_value;
+  int ysid;
+  for (ysid = 0; ysid < YS_Count_of_R (r); ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      int postdot_ix;
+      for (postdot_ix = 0; postdot_ix < Postdot_SYM_Count_of_YS (set);
+           postdot_ix++)
+        {
+          PIM pim;
+          for (pim = set->t_postdot_ary[postdot_ix]; pim;
+               pim = Next_PIM_of_PIM (pim))
+            {
+              LIM lim;
+              YS origin;
+              int top_ahmid;
+              int trailhead_ahmid;
+              YIM base;
+              LIM predecessor;
+              CIL cil;
+              int flags;
+              if (!PIM_is_LIM (pim))
+                continue;
+              lim = LIM_of_PIM (pim);
+              if (!rchk_ys_read (r, rd, &origin)
+                  || !gsnap_id_read (rd, AHM_Count_of_G (g), &top_ahmid)
+                  || !gsnap_id_read (rd, AHM_Count_of_G (g), &trailhead_ahmid)
+                  || !rchk_yim_read (r, rd, &base)
+                  || !rchk_lim_read (r, rd, &predecessor)
+                  || !rchk_cil_read (r, rd, &cil)
+                  || !gsnap_int_read (rd, &flags))
+                goto RECCE_FAILURE;
+              if (top_ahmid < 0 || trailhead_ahmid < 0 || !base)
+                goto RECCE_FAILURE;
+              YS_of_LIM (lim) = set;
+              Origin_of_LIM (lim) = origin;
+              Top_AHM_of_LIM (lim) = AHM_by_ID (top_ahmid);
+              Trailhead_AHM_of_LIM (lim) = AHM_by_ID (trailhead_ahmid);
+              Trailhead_YIM_of_LIM (lim) = base;
+              Predecessor_LIM_of_LIM (lim) = predecessor;
+              CIL_of_LIM (lim) = cil;
+              LIM_is_Rejected (lim) = (flags & RCHK_LIM_IS_REJECTED) != 0;
+              LIM_is_Active (lim) = (flags & RCHK_LIM_IS_ACTIVE) != 0;
+            }
+        }
+    }
 }
 
-@ @<Function definitions@> =
-int
-marpa_r_zwa_default(Marpa_Recognizer r,
-    Marpa_Assertion_ID zwaid)
+@ @<Restore the checkpoint source links@> =
 {
-  @<Return |-2| on failure@>@;
-  @<Unpack recognizer objects@>@;
-  ZWA zwa;
-  @<Fail if fatal error@>@;
-  @<Fail if |zwaid| is malformed@>@;
-  @<Fail if |zwaid| does not exist@>@;
-  zwa = RZWA_by_ID(zwaid);
-  return Default_Value_of_ZWA(zwa);
+  int ysid;
+  for (ysid = 0; ysid < YS_Count_of_R (r); ysid++)
+    {
+      const YS set = YS_of_R_by_Ord (r, ysid);
+      const YIM *const yims = YIMs_of_YS (set);
+      int yim_ix;
+      for (yim_ix = 0; yim_ix < YIM_Count_of_YS (set); yim_ix++)
+        {
+          const YIM yim = yims[yim_ix];
+          int source_type;
+          if (!gsnap_int_read (rd, &source_type))
+            goto RECCE_FAILURE;
+          switch (source_type)
+            {
+            case NO_SOURCE:
+              break;
+            case SOURCE_IS_TOKEN:
+            case SOURCE_IS_COMPLETION:
+            case SOURCE_IS_LEO:
+              if (!rchk_srcl_read (r, rd, (unsigned int) source_type,
+                                   SRCL_of_YIM (yim)))
+                goto RECCE_FAILURE;
+              break;
+            case SOURCE_IS_AMBIGUOUS:
+              if (!rchk_srcl_list_read (r, rd, SOURCE_IS_LEO,
+                                        &LV_First_Leo_SRCL_of_YIM (yim))
+                  || !rchk_srcl_list_read (r, rd, SOURCE_IS_TOKEN,
+                                           &LV_First_Token_SRCL_of_YIM (yim))
+                  || !rchk_srcl_list_read (r, rd, SOURCE_IS_COMPLETION,
+                                           &LV_First_Completion_SRCL_of_YIM
+                                           (yim)))
+                goto RECCE_FAILURE;
+              break;
+            default:
+              goto RECCE_FAILURE;
+            }
+          /* Masked, so that the compiler can see it fits the bitfield */
+          Source_Type_of_YIM (yim) = (unsigned int) source_type & 0x7u;
+        }
+    }
+}
+
+@ A pending alternative always ends after the current earleme.
+@<Restore the checkpoint alternatives@> =
+{
+  int alternative_count;
+  int alternative_ix;
+  if (!gsnap_int_read (rd, &alternative_count) || alternative_count < 0)
+    goto RECCE_FAILURE;
+  for (alternative_ix = 0; alternative_ix < alternative_count;
+       alternative_ix++)
+    {
+      ALT_Object alternative;
+      YS start_earley_set;
+      int end_earleme;
+      int nsyid;
+      int value;
+      int is_valued;
+      if (!rchk_ys_read (r, rd, &start_earley_set)
+          || !gsnap_int_read (rd, &end_earleme)
+          || !gsnap_int_read (rd, &nsyid)
+          || !gsnap_int_read (rd, &value)
+          || !gsnap_int_read (rd, &is_valued))
+        goto RECCE_FAILURE;
+      if (!start_earley_set || end_earleme <= Current_Earleme_of_R (r)
+          || nsyid < 0 || nsyid >= nsy_count)
+        goto RECCE_FAILURE;
+      Start_YS_of_ALT (&alternative) = start_earley_set;
+      End_Earleme_of_ALT (&alternative) = end_earleme;
+      NSYID_of_ALT (&alternative) = nsyid;
+      Value_of_ALT (&alternative) = value;
+      ALT_is_Valued (&alternative) = is_valued ? 1 : 0;
+      if (alternative_insert (r, &alternative) < 0)
+        goto RECCE_FAILURE;
+    }
+}
+
+@ The postdot indexes are created last,
+since until the postdot arrays are complete,
+the Leo items are found by binary search.
+@<Create the postdot indexes of the restored recognizer@> =
+{
+  if (r->t_use_postdot_index)
+    {
+      int ysid;
+      for (ysid = 0; ysid < YS_Count_of_R (r); ysid++)
+        postdot_index_create (r, YS_of_R_by_Ord (r, ysid));
+    }
 }
 
 @** Progress report code.
@@ -9597,17 +13769,17 @@ int marpa_r_progress_report_start(
   @<Return |-2| on failure@>@;
   YS earley_set;
   @<Unpack recognizer objects@>@;
-  @<Fail if fatal error@>@;
+  @<Fail if recognizer has a fatal error@>@;
   @<Fail if recognizer not started@>@;
   if (set_id < 0)
     {
-      MARPA_ERROR (MARPA_ERR_INVALID_LOCATION);
+      MARPA_R_ERROR (MARPA_ERR_INVALID_LOCATION);
       return failure_indicator;
     }
   r_update_earley_sets (r);
   if (!YS_Ord_is_Valid (r, set_id))
     {
-      MARPA_ERROR(MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
+      MARPA_R_ERROR(MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
       return failure_indicator;
     }
   earley_set = YS_of_R_by_Ord (r, set_id);
@@ -9640,7 +13812,7 @@ int marpa_r_progress_report_reset( Marpa_Recognizer r)
   @<Return |-2| on failure@>@;
   MARPA_AVL_TRAV traverser = r->t_progress_report_traverser;
   @<Unpack recognizer objects@>@;
-  @<Fail if fatal error@>@;
+  @<Fail if recognizer has a fatal error@>@;
   @<Fail if recognizer not started@>@;
   @<Fail if no |traverser|@>@;
   _marpa_avl_t_reset(traverser);
@@ -9722,7 +13894,6 @@ progress_report_item_insert(MARPA_AVL_TREE report_tree,
 int marpa_r_progress_report_finish(Marpa_Recognizer r) {
   const int success = 1;
   @<Return |-2| on failure@>@;
-  @<Unpack recognizer objects@>@;
   const MARPA_AVL_TRAV traverser = r->t_progress_report_traverser;
   @<Fail if recognizer not started@>@;
   @<Fail if no |traverser|@>@;
@@ -9738,17 +13909,17 @@ Marpa_Rule_ID marpa_r_progress_item(
   PROGRESS report_item;
   MARPA_AVL_TRAV traverser;
   @<Unpack recognizer objects@>@;
-  @<Fail if fatal error@>@;
+  @<Fail if recognizer has a fatal error@>@;
   @<Fail if recognizer not started@>@;
   traverser = r->t_progress_report_traverser;
   if (_MARPA_UNLIKELY(!position || !origin)) {
-      MARPA_ERROR (MARPA_ERR_POINTER_ARG_NULL);
+      MARPA_R_ERROR (MARPA_ERR_POINTER_ARG_NULL);
       return failure_indicator;
   }
   @<Fail if no |traverser|@>@;
   report_item = _marpa_avl_t_next(traverser);
   if (!report_item) {
-      MARPA_ERROR(MARPA_ERR_PROGRESS_REPORT_EXHAUSTED);
+      MARPA_R_ERROR(MARPA_ERR_PROGRESS_REPORT_EXHAUSTED);
       return -1;
   }
   *position = Position_of_PROGRESS(report_item);
@@ -9760,7 +13931,7 @@ Marpa_Rule_ID marpa_r_progress_item(
 {
   if (!traverser)
     {
-      MARPA_ERROR (MARPA_ERR_PROGRESS_REPORT_NOT_STARTED);
+      MARPA_R_ERROR (MARPA_ERR_PROGRESS_REPORT_NOT_STARTED);
       return failure_indicator;
     }
 }
@@ -10018,6 +14189,11 @@ I need to decide where to look at this.
         @t}\comment{@>/* rejected YIM's are never put on the ur-node stack */
         const YIM parent_earley_item = YIM_of_UR(ur_node);
         MARPA_ASSERT(!YIM_was_Predicted(parent_earley_item))@;
+        @t}\comment{@>
+        /* A cut YIM was derived only from
+        Earley sets which have been released */
+        if (_MARPA_UNLIKELY(YIM_is_Cut(parent_earley_item)))
+            goto SOURCE_RELEASED;
         @<Push child Earley items from token sources@>@;
         @<Push child Earley items from completion sources@>@;
         @<Push child Earley items from Leo sources@>@;
@@ -10070,7 +14246,7 @@ PRIVATE int psi_test_and_set(
       if (!predecessor_earley_item) continue;
       if (YIM_was_Predicted (predecessor_earley_item))
 	{
-	  Set_boolean_in_PSI_for_initial_nulls (per_ys_data,
+	  Set_boolean_in_PSI_for_initial_nulls (g, per_ys_data,
 						predecessor_earley_item);
 	  continue;
 	}
@@ -10084,7 +14260,8 @@ We don't need to stack the prediction, because it can have
 no other descendants.
 @<Function definitions@> =
 PRIVATE void
-Set_boolean_in_PSI_for_initial_nulls (struct s_bocage_setup_per_ys *per_ys_data,
+Set_boolean_in_PSI_for_initial_nulls (GRAMMAR g,
+  struct s_bocage_setup_per_ys *per_ys_data,
   YIM yim)
 {
   const AHM ahm = AHM_of_YIM(yim);
@@ -10107,7 +14284,7 @@ Set_boolean_in_PSI_for_initial_nulls (struct s_bocage_setup_per_ys *per_ys_data,
       if (!predecessor_earley_item) continue;
       if (YIM_was_Predicted (predecessor_earley_item))
 	{
-	  Set_boolean_in_PSI_for_initial_nulls (per_ys_data,
+	  Set_boolean_in_PSI_for_initial_nulls (g, per_ys_data,
 						predecessor_earley_item);
 	  continue;
 	}
@@ -10138,7 +14315,7 @@ Set_boolean_in_PSI_for_initial_nulls (struct s_bocage_setup_per_ys *per_ys_data,
 	  const YIM leo_base_yim = Trailhead_YIM_of_LIM (leo_predecessor);
 	  if (YIM_was_Predicted (leo_base_yim))
 	    {
-	      Set_boolean_in_PSI_for_initial_nulls (per_ys_data,
+	      Set_boolean_in_PSI_for_initial_nulls (g, per_ys_data,
 						    leo_base_yim);
 	    }
 	  else
@@ -10164,7 +14341,7 @@ typedef Marpa_Or_Node_ID ORID;
 union u_or_node;
 typedef union u_or_node* OR;
 @ The type is contained in same word as the position is
-for final or-nodes.
+for draft or-nodes.
 @s OR int
 Position is |DUMMY_OR_NODE| for dummy or-nodes,
 and less than or equal to |MAX_TOKEN_OR_NODE|
@@ -10181,43 +14358,34 @@ Position is the dot position.
 @d NULLING_TOKEN_OR_NODE -3
 @d UNVALUED_TOKEN_OR_NODE -4
 @d OR_is_Token(or) (Type_of_OR(or) <= MAX_TOKEN_OR_NODE)
-@d Position_of_OR(or) ((or)->t_final.t_position)
-@d Type_of_OR(or) ((or)->t_final.t_position)
-@d IRL_of_OR(or) ((or)->t_final.t_irl)
+@d Position_of_OR(or) ((or)->t_draft.t_position)
+@d Type_of_OR(or) ((or)->t_draft.t_position)
+@d IRL_of_OR(or) ((or)->t_draft.t_irl)
 @d IRLID_of_OR(or) ID_of_IRL(IRL_of_OR(or))
-@d Origin_Ord_of_OR(or) ((or)->t_final.t_start_set_ordinal)
-@d ID_of_OR(or) ((or)->t_final.t_id)
+@d Origin_Ord_of_OR(or) ((or)->t_draft.t_start_set_ordinal)
+@d ID_of_OR(or) ((or)->t_draft.t_id)
 @d YS_Ord_of_OR(or) ((or)->t_draft.t_end_set_ordinal)
 @d DANDs_of_OR(or) ((or)->t_draft.t_draft_and_node)
-@d First_ANDID_of_OR(or) ((or)->t_final.t_first_and_node_id)
-@d AND_Count_of_OR(or) ((or)->t_final.t_and_node_count)
 @ C89 guarantees that common initial sequences
 may be accessed via different members of a union.
 @<Or-node common initial sequence@> =
 int t_position;
 
-@ @<Or-node less common initial sequence@> =
+@ The or-node objects exist only while the bocage
+is being set up.
+The bocage keeps its final or-nodes in the arrays
+described below.
+@<Private structures@> =
+struct s_draft_or_node
+{
   @<Or-node common initial sequence@>@;
   int t_end_set_ordinal;
   int t_start_set_ordinal;
   ORID t_id;
   IRL t_irl;
-
-@ @<Private structures@> =
-struct s_draft_or_node
-{
-    @<Or-node less common initial sequence@>@;
   DAND t_draft_and_node;
 };
 
-@ @<Private structures@> =
-struct s_final_or_node
-{
-    @<Or-node less common initial sequence@>@;
-    int t_first_and_node_id;
-    int t_and_node_count;
-};
-
 @ @<Private structures@> =
 struct s_valued_token_or_node
 {
@@ -10232,7 +14400,6 @@ struct s_valued_token_or_node
 @<Private structures@> =
 union u_or_node {
     struct s_draft_or_node t_draft;
-    struct s_final_or_node t_final;
     struct s_valued_token_or_node t_token;
 };
 typedef union u_or_node OR_Object;
@@ -10241,39 +14408,85 @@ typedef union u_or_node OR_Object;
 static const int dummy_or_node_type = DUMMY_OR_NODE;
 static const OR dummy_or_node = (OR)&dummy_or_node_type;
 
-@ @d ORs_of_B(b) ((b)->t_or_nodes)
+@ The final or-nodes of the bocage are kept
+as a structure of arrays, indexed by or-node ID.
+Tree iteration, ordering and evaluation
+mostly look at one or two of the fields of
+many or-nodes,
+and arrays keep those fields together.
+|ORs_of_B| is the array of or-node objects,
+and is only used while the bocage is being set up.
+@d ORs_of_B(b) ((b)->t_or_nodes)
 @d OR_of_B_by_ID(b, id) (ORs_of_B(b)[(id)])
 @d OR_Count_of_B(b) ((b)->t_or_node_count)
-@d OR_Capacity_of_B(b) ((b)->t_or_node_capacity)
-@d ANDs_of_B(b) ((b)->t_and_nodes)
 @d AND_Count_of_B(b) ((b)->t_and_node_count)
 @d Top_ORID_of_B(b) ((b)->t_top_or_node_id)
+@d Origin_Ord_of_ORID(b, id) ((b)->t_or_origins[(id)])
+@d YS_Ord_of_ORID(b, id) ((b)->t_or_ends[(id)])
+@d IRLID_of_ORID(b, id) ((b)->t_or_irlids[(id)])
+@d IRL_of_ORID(b, id) IRL_by_ID(IRLID_of_ORID((b), (id)))
+@d Position_of_ORID(b, id) ((b)->t_or_positions[(id)])
+@d First_ANDID_of_ORID(b, id) ((b)->t_or_first_andids[(id)])
+@d AND_Count_of_ORID(b, id) ((b)->t_or_and_counts[(id)])
 @<Widely aligned bocage elements@> =
 OR* t_or_nodes;
-AND t_and_nodes;
+YSID* t_or_origins;
+YSID* t_or_ends;
+IRLID* t_or_irlids;
+int* t_or_positions;
+ANDID* t_or_first_andids;
+int* t_or_and_counts;
 @ @<Int aligned bocage elements@> =
-int t_or_node_capacity;
 int t_or_node_count;
 int t_and_node_count;
 ORID t_top_or_node_id;
 
 @ @<Initialize bocage elements@> =
 ORs_of_B(b) = NULL;
+b->t_or_origins = NULL;
+b->t_or_ends = NULL;
+b->t_or_irlids = NULL;
+b->t_or_positions = NULL;
+b->t_or_first_andids = NULL;
+b->t_or_and_counts = NULL;
 OR_Count_of_B(b) = 0;
-ANDs_of_B(b) = NULL;
 AND_Count_of_B(b) = 0;
 Top_ORID_of_B(b) = -1;
 
 @ @<Destroy bocage elements, main phase@> =
 {
-  OR* or_nodes = ORs_of_B (b);
-  AND and_nodes = ANDs_of_B (b);
-
   grammar_unref (G_of_B(b));
-  my_free (or_nodes);
+  my_free (ORs_of_B (b));
   ORs_of_B (b) = NULL;
-  my_free (and_nodes);
-  ANDs_of_B (b) = NULL;
+  my_free (b->t_or_origins);
+  b->t_or_origins = NULL;
+  my_free (b->t_or_ends);
+  b->t_or_ends = NULL;
+  my_free (b->t_or_irlids);
+  b->t_or_irlids = NULL;
+  my_free (b->t_or_positions);
+  b->t_or_positions = NULL;
+  my_free (b->t_or_first_andids);
+  b->t_or_first_andids = NULL;
+  my_free (b->t_or_and_counts);
+  b->t_or_and_counts = NULL;
+}
+
+@ Allocate the arrays for the final or-nodes.
+The or-node objects are set up first,
+and copied into these arrays
+when the final and-nodes are created.
+@<Function definitions@> =
+PRIVATE void
+bocage_or_nodes_new (BOCAGE b, int or_node_count)
+{
+  OR_Count_of_B (b) = or_node_count;
+  b->t_or_origins = marpa_new (YSID, or_node_count);
+  b->t_or_ends = marpa_new (YSID, or_node_count);
+  b->t_or_irlids = marpa_new (IRLID, or_node_count);
+  b->t_or_positions = marpa_new (int, or_node_count);
+  b->t_or_first_andids = marpa_new (ANDID, or_node_count);
+  b->t_or_and_counts = marpa_new (int, or_node_count);
 }
 
 @ @d G_of_B(b) ((b)->t_grammar)
@@ -10287,30 +14500,153 @@ Top_ORID_of_B(b) = -1;
 }
 
 @*0 Create the or-nodes.
+The or-nodes and draft and-nodes are created by
+{\it bocage setup tasks}.
+Each task works on a contiguous range of Earley sets,
+and keeps its own list of the or-nodes it creates,
+in order of creation.
+In the usual case, there is only one task,
+and its range is all of the Earley sets.
+@<Private structures@> =
+struct s_bocage_setup_task {
+    struct s_bocage_setup_per_ys* t_per_ys_data;
+    struct marpa_obstack* t_setup_obs;
+    OR* t_or_nodes;
+    YSID* t_psl_ysids;
+    int* t_first_or_ix_by_ys;
+    struct s_bocage_lazy* t_lazy;
+    int t_or_node_count;
+    int t_or_node_capacity;
+    YSID t_first_ysid;
+    YSID t_end_ysid;
+    ORID t_first_or_node_id;
+    ANDID t_first_and_node_id;
+    int t_and_node_count;
+    BITFIELD t_is_ambiguous:1;
+};
+
+@ The or-nodes and the draft and-nodes
+are allocated on |setup_obs|.
+@<Function definitions@> =
+PRIVATE void
+bocage_setup_task_init (struct s_bocage_setup_task *task,
+  struct s_bocage_setup_per_ys *per_ys_data,
+  struct marpa_obstack *setup_obs,
+  YSID first_ysid, YSID end_ysid, int item_count)
+{
+  task->t_per_ys_data = per_ys_data;
+  task->t_setup_obs = setup_obs;
+  task->t_or_node_capacity = item_count > 0 ? item_count : 1;
+  task->t_or_nodes = NULL;
+  task->t_psl_ysids = NULL;
+  task->t_first_or_ix_by_ys = NULL;
+  task->t_lazy = NULL;
+  task->t_or_node_count = 0;
+  task->t_first_ysid = first_ysid;
+  task->t_end_ysid = end_ysid;
+  task->t_first_or_node_id = 0;
+  task->t_first_and_node_id = 0;
+  task->t_and_node_count = 0;
+  task->t_is_ambiguous = 0;
+}
+
+@ A single task creates the or-nodes and the draft and-nodes
+of each Earley set in one pass.
+Since the task's range starts at the first Earley set,
+the or-node IDs it assigns are final.
 @<Create the or-nodes for all earley sets@> =
 {
+  struct s_bocage_setup_task task_object;
+  struct s_bocage_setup_task *const task = &task_object;
+  bocage_setup_task_init (task, per_ys_data, bocage_setup_obs,
+                          0, earley_set_count_of_r,
+                          count_of_earley_items_in_parse);
+  task->t_or_nodes = marpa_new (OR, task->t_or_node_capacity);
+  bocage_setup_earley_sets (b, r, task, 1, 1);
+  ORs_of_B (b) = marpa_renew (OR, task->t_or_nodes, task->t_or_node_count);
+  bocage_or_nodes_new (b, task->t_or_node_count);
+}
+
+@ Create the or-nodes, or the draft and-nodes, or both,
+for the Earley sets in the range of |task|.
+The draft and-nodes of an Earley set use the or-nodes
+of earlier Earley sets,
+so that when they are created in a separate pass,
+the or-nodes for all Earley sets up to the end of
+the range must already exist.
+@<Function definitions@> =
+PRIVATE void
+bocage_setup_earley_sets (BOCAGE b, RECCE r,
+  struct s_bocage_setup_task *task,
+  int creates_or_nodes, int creates_draft_and_nodes)
+{
+  const GRAMMAR g = G_of_B (b);
+  struct s_bocage_setup_per_ys *const per_ys_data = task->t_per_ys_data;
+  struct marpa_obstack *const bocage_setup_obs = task->t_setup_obs;
   PSAR_Object or_per_ys_arena;
   const PSAR or_psar = &or_per_ys_arena;
   int work_earley_set_ordinal;
-  OR_Capacity_of_B(b) = count_of_earley_items_in_parse;
-  ORs_of_B (b) = marpa_new (OR, OR_Capacity_of_B(b));
   psar_init (or_psar, SYMI_Count_of_G (g));
-  for (work_earley_set_ordinal = 0;
-      work_earley_set_ordinal < earley_set_count_of_r;
+  for (work_earley_set_ordinal = task->t_first_ysid;
+      work_earley_set_ordinal < task->t_end_ysid;
       work_earley_set_ordinal++)
   {
       const YS_Const earley_set = YS_of_R_by_Ord (r, work_earley_set_ordinal);
     YIM* const yims_of_ys = YIMs_of_YS(earley_set);
     const int item_count = YIM_Count_of_YS (earley_set);
-      PSL this_earley_set_psl;
+    int* const first_or_ix_by_ys = task->t_first_or_ix_by_ys;
       psar_dealloc(or_psar);
-      this_earley_set_psl
-        = psl_claim_by_es(or_psar, per_ys_data, work_earley_set_ordinal);
-    @<Create the or-nodes for |work_earley_set_ordinal|@>@;
-    @<Create draft and-nodes for |work_earley_set_ordinal|@>@;
+      if (creates_or_nodes) {
+          const PSL this_earley_set_psl
+            = psl_claim_by_es(or_psar, per_ys_data, work_earley_set_ordinal);
+          if (first_or_ix_by_ys) {
+              first_or_ix_by_ys[work_earley_set_ordinal - task->t_first_ysid]
+                = task->t_or_node_count;
+          }
+        @<Create the or-nodes for |work_earley_set_ordinal|@>@;
+        if (task->t_lazy) {
+          @<Find the contributors for |work_earley_set_ordinal|@>@;
+        }
+      } else {
+        @<Restore the or-node PSLs for |work_earley_set_ordinal|@>@;
+      }
+      if (creates_draft_and_nodes) {
+        @<Create draft and-nodes for |work_earley_set_ordinal|@>@;
+      }
+  }
+  if (creates_or_nodes && task->t_first_or_ix_by_ys) {
+      task->t_first_or_ix_by_ys[task->t_end_ysid - task->t_first_ysid]
+        = task->t_or_node_count;
   }
   psar_destroy (or_psar);
-  ORs_of_B(b) = marpa_renew (OR, ORs_of_B(b), OR_Count_of_B(b));
+}
+
+@ When the draft and-nodes are created in a separate pass,
+the PSLs which mapped origin and symbol instance to or-node
+when the or-nodes were created are gone.
+They are rebuilt by repeating, in order of creation,
+the PSL assignments made for the or-nodes of
+|work_earley_set_ordinal|.
+Where the same PSL datum was assigned more than once,
+the last assignment wins, as it did before.
+The symbol instance of an or-node is determined by its
+rule and position.
+The PSL is not always that of the or-node's origin,
+so it was recorded when the or-node was created.
+@<Restore the or-node PSLs for |work_earley_set_ordinal|@> =
+{
+  const int ys_offset = work_earley_set_ordinal - task->t_first_ysid;
+  const int end_or_ix = first_or_ix_by_ys[ys_offset + 1];
+  int or_ix;
+  for (or_ix = first_or_ix_by_ys[ys_offset]; or_ix < end_or_ix; or_ix++)
+    {
+      const OR or_node = task->t_or_nodes[or_ix];
+      const PSL or_psl =
+        psl_claim_by_es (or_psar, per_ys_data, task->t_psl_ysids[or_ix]);
+      const SYMI symbol_instance =
+        SYMI_of_IRL (IRL_of_OR (or_node)) + Position_of_OR (or_node) - 1;
+      PSL_Datum (or_psl, symbol_instance) = or_node;
+    }
 }
 
 @ @<Create the or-nodes for |work_earley_set_ordinal|@> =
@@ -10373,7 +14709,7 @@ MARPA_ASSERT(ahm_symbol_instance < SYMI_Count_of_G(g))@;
       if (!or_node || YS_Ord_of_OR(or_node) != work_earley_set_ordinal)
         {
           const IRL irl = IRL_of_AHM(ahm);
-          or_node = last_or_node = or_node_new(b);
+          or_node = last_or_node = or_node_new(task, work_origin_ordinal);
           PSL_Datum (or_psl, ahm_symbol_instance) = last_or_node;
           Origin_Ord_of_OR(or_node) = Origin_Ord_of_YIM(work_earley_item);
           YS_Ord_of_OR(or_node) = work_earley_set_ordinal;
@@ -10385,20 +14721,29 @@ MARPA_ASSERT(ahm_symbol_instance < SYMI_Count_of_G(g))@;
     }
 }
 
-@ @<Function definitions@> =
-PRIVATE OR or_node_new(BOCAGE b)
+@ The ID of a new or-node is its index in the list of |task|.
+It is final only if |task| is the first task.
+|psl_ysid| is the Earley set whose PSL will hold the new or-node.
+It is recorded if the task will need to rebuild its PSLs.
+@<Function definitions@> =
+PRIVATE OR or_node_new(struct s_bocage_setup_task* task, YSID psl_ysid)
 {
-  const int or_node_id = OR_Count_of_B (b)++;
-  const OR new_or_node = (OR)marpa_obs_new (OBS_of_B(b), OR_Object, 1);
-  ID_of_OR(new_or_node) = or_node_id;
+  const int or_node_ix = task->t_or_node_count++;
+  const OR new_or_node = (OR)marpa_obs_new (task->t_setup_obs, OR_Object, 1);
+  ID_of_OR(new_or_node) = or_node_ix;
   DANDs_of_OR(new_or_node) = NULL;
-  if (_MARPA_UNLIKELY(or_node_id >= OR_Capacity_of_B(b)))
+  if (_MARPA_UNLIKELY(or_node_ix >= task->t_or_node_capacity))
     {
-      OR_Capacity_of_B(b) *= 2;
-      ORs_of_B (b) =
-        marpa_renew (OR, ORs_of_B(b), OR_Capacity_of_B(b));
-    }
-  OR_of_B_by_ID(b,or_node_id) = new_or_node;
+      task->t_or_node_capacity *= 2;
+      task->t_or_nodes =
+        marpa_renew (OR, task->t_or_nodes, task->t_or_node_capacity);
+      if (task->t_psl_ysids)
+        task->t_psl_ysids =
+          marpa_renew (YSID, task->t_psl_ysids, task->t_or_node_capacity);
+    }
+  task->t_or_nodes[or_node_ix] = new_or_node;
+  if (task->t_psl_ysids)
+    task->t_psl_ysids[or_node_ix] = psl_ysid;
   return new_or_node;
 }
 
@@ -10431,7 +14776,7 @@ and this is the case if |Position_of_OR(or_node) == 0|.
                 const OR predecessor = rhs_ix ? last_or_node : NULL;
                 const OR cause = Nulling_OR_by_NSYID( RHSID_of_IRL (irl, rhs_ix ) );
                 or_node = PSL_Datum (or_psl, symbol_instance)
-                  = last_or_node = or_node_new(b);
+                  = last_or_node = or_node_new(task, work_origin_ordinal);
                 Origin_Ord_of_OR (or_node) = work_origin_ordinal;
                 YS_Ord_of_OR (or_node) = work_earley_set_ordinal;
                 IRL_of_OR (or_node) = irl;
@@ -10494,7 +14839,8 @@ corresponds to the Leo predecessor.
       or_node = PSL_Datum (leo_psl, symbol_instance_of_path_ahm);
       if (!or_node || YS_Ord_of_OR(or_node) != work_earley_set_ordinal)
         {
-          last_or_node = or_node_new(b);
+          last_or_node =
+            or_node_new(task, ordinal_of_set_of_this_leo_item);
           PSL_Datum (leo_psl, symbol_instance_of_path_ahm) = or_node =
               last_or_node;
           Origin_Ord_of_OR(or_node) = ordinal_of_set_of_this_leo_item;
@@ -10527,7 +14873,8 @@ or-nodes follow a completion.
           const OR cause = Nulling_OR_by_NSYID( RHSID_of_IRL (path_irl, rhs_ix ) );
           MARPA_ASSERT (symbol_instance < Length_of_IRL (path_irl)) @;
           MARPA_ASSERT (symbol_instance >= 0) @;
-          or_node = last_or_node = or_node_new(b);
+          or_node = last_or_node =
+            or_node_new(task, work_earley_set_ordinal);
           PSL_Datum (this_earley_set_psl, symbol_instance) = or_node;
           Origin_Ord_of_OR (or_node) = ordinal_of_set_of_this_leo_item;
           YS_Ord_of_OR (or_node) = work_earley_set_ordinal;
@@ -10879,14 +15226,14 @@ and are not traversed when traversing or-nodes by ID.
       OR new_token_or_node;
       const NSYID token_nsyid = NSYID_of_SRCL (tkn_source_link);
       const YIM predecessor_earley_item = Predecessor_of_SRCL (tkn_source_link);
-      const OR dand_predecessor = safe_or_from_yim (per_ys_data,
+      const OR dand_predecessor = safe_or_from_yim (g, per_ys_data,
 					      predecessor_earley_item);
       if (NSYID_is_Valued_in_B (b, token_nsyid))
 	{
           @t}\comment{@>
 	  /* I probably can and should use a smaller allocation,
           sized just for a token or-node */
-	  new_token_or_node = (OR) marpa_obs_new (OBS_of_B (b), OR_Object, 1);
+	  new_token_or_node = (OR) marpa_obs_new (bocage_setup_obs, OR_Object, 1);
 	  Type_of_OR (new_token_or_node) = VALUED_TOKEN_OR_NODE;
 	  NSYID_of_OR (new_token_or_node) = token_nsyid;
 	  Value_of_OR (new_token_or_node) = Value_of_SRCL (tkn_source_link);
@@ -10905,6 +15252,7 @@ an or-node exists.
 @<Function definitions@> =
 PRIVATE
 OR safe_or_from_yim(
+  GRAMMAR g,
   struct s_bocage_setup_per_ys* per_ys_data,
   YIM yim)
 {
@@ -10924,7 +15272,7 @@ OR safe_or_from_yim(
       const AHM cause_ahm = AHM_of_YIM (cause_earley_item);
       const SYMI cause_symbol_instance =
 	SYMI_of_Completed_IRL (IRL_of_AHM (cause_ahm));
-      OR dand_predecessor = safe_or_from_yim (per_ys_data,
+      OR dand_predecessor = safe_or_from_yim (g, per_ys_data,
 					      predecessor_earley_item);
       const OR dand_cause =
 	or_by_origin_and_symi (per_ys_data, middle_ordinal,
@@ -10937,11 +15285,15 @@ OR safe_or_from_yim(
 @ The need for this count is a vestige of duplicate checking.
 Now that duplicates no longer occur,
 the whole process probably can and should be simplified.
-@<Count draft and-nodes@> =
+Counts the draft and-nodes of the or-nodes
+from |first_or_node_id| up to, but not including, |end_or_node_id|.
+@<Function definitions@> =
+PRIVATE int
+draft_and_node_count (BOCAGE b, ORID first_or_node_id, ORID end_or_node_id)
 {
-  const int or_node_count_of_b = OR_Count_of_B (b);
-  int or_node_id = 0;
-  while (or_node_id < or_node_count_of_b)
+  int unique_draft_and_node_count = 0;
+  int or_node_id = first_or_node_id;
+  while (or_node_id < end_or_node_id)
     {
       const OR work_or_node = OR_of_B_by_ID (b, or_node_id);
       DAND dand = DANDs_of_OR (work_or_node);
@@ -10952,6 +15304,7 @@ the whole process probably can and should be simplified.
 	}
       or_node_id++;
     }
+  return unique_draft_and_node_count;
 }
 
 @** And-node (AND) code.
@@ -10968,58 +15321,193 @@ typedef int Marpa_And_Node_ID;
 @ @<Private typedefs@> =
 typedef Marpa_And_Node_ID ANDID;
 
-@ @s AND int
-@<Private incomplete structures@> =
-struct s_and_node;
-typedef struct s_and_node* AND;
-@
-@d OR_of_AND(and) ((and)->t_current)
-@d Predecessor_OR_of_AND(and) ((and)->t_predecessor)
-@d Cause_OR_of_AND(and) ((and)->t_cause)
-@<Private structures@> =
-struct s_and_node {
-    OR t_current;
-    OR t_predecessor;
-    OR t_cause;
-};
-typedef struct s_and_node AND_Object;
+@ Like the final or-nodes,
+the and-nodes are kept as a structure of arrays,
+indexed by and-node ID.
+The and-nodes of an or-node are contiguous,
+so that the parent or-node of an and-node
+is not kept.
+If the cause of an and-node is a token,
+its symbol is the token's NSYID, and
+its cause is the token's value.
+Otherwise, its symbol is |-1|
+and its cause is the ID of the cause or-node.
+The predecessor is |-1| if there is none.
+@d Predecessor_ORID_of_ANDID(b, id) ((b)->t_and_predecessors[(id)])
+@d Cause_ORID_of_ANDID(b, id) ((b)->t_and_causes[(id)])
+@d Token_Value_of_ANDID(b, id) ((b)->t_and_causes[(id)])
+@d NSYID_of_ANDID(b, id) ((b)->t_and_symbols[(id)])
+@d ANDID_is_Token(b, id) (NSYID_of_ANDID((b), (id)) >= 0)
+@<Widely aligned bocage elements@> =
+ORID* t_and_predecessors;
+int* t_and_causes;
+NSYID* t_and_symbols;
+@ @<Initialize bocage elements@> =
+b->t_and_predecessors = NULL;
+b->t_and_causes = NULL;
+b->t_and_symbols = NULL;
+@ @<Destroy bocage elements, main phase@> =
+{
+  my_free (b->t_and_predecessors);
+  b->t_and_predecessors = NULL;
+  my_free (b->t_and_causes);
+  b->t_and_causes = NULL;
+  my_free (b->t_and_symbols);
+  b->t_and_symbols = NULL;
+}
+
+@ @<Function definitions@> =
+PRIVATE void
+bocage_and_nodes_new (BOCAGE b, int and_node_count)
+{
+  AND_Count_of_B (b) = and_node_count;
+  b->t_and_predecessors = marpa_new (ORID, and_node_count);
+  b->t_and_causes = marpa_new (int, and_node_count);
+  b->t_and_symbols = marpa_new (NSYID, and_node_count);
+}
+
+@ The type of a token cause is not kept.
+It is determined by its symbol, in the same way
+as when its token or-node was created.
+@<Function definitions@> =
+PRIVATE int
+and_node_token_type (BOCAGE b, ANDID and_node_id)
+{
+  const GRAMMAR g = G_of_B (b);
+  const NSYID nsyid = NSYID_of_ANDID (b, and_node_id);
+  if (NSY_is_Nulling (NSY_by_ID (nsyid)))
+    return NULLING_TOKEN_OR_NODE;
+  if (NSYID_is_Valued_in_B (b, nsyid))
+    return VALUED_TOKEN_OR_NODE;
+  return UNVALUED_TOKEN_OR_NODE;
+}
+
+@ Returns the ID of the parent or-node of an and-node.
+The first and-node IDs of the or-nodes are in ascending order,
+so that the parent is the last or-node whose first and-node ID
+is not greater than |and_node_id|.
+Or-nodes without and-nodes share their first and-node ID
+with the or-node which follows them,
+and never precede the parent.
+In a lazy bocage, the and-nodes are created in the order
+the or-nodes are expanded,
+so that the parent is searched for.
+@<Function definitions@> =
+PRIVATE ORID
+and_node_parent (BOCAGE b, ANDID and_node_id)
+{
+  ORID lo = 0;
+  ORID hi = OR_Count_of_B (b) - 1;
+  if (B_is_Lazy (b))
+    {
+      ORID or_node_id;
+      for (or_node_id = 0; or_node_id <= hi; or_node_id++)
+        {
+          const ANDID first_and_node_id = First_ANDID_of_ORID (b, or_node_id);
+          if (first_and_node_id <= and_node_id
+              && and_node_id <
+              first_and_node_id + AND_Count_of_ORID (b, or_node_id))
+            return or_node_id;
+        }
+      return -1;
+    }
+  while (lo < hi)
+    {
+      const ORID mid = lo + (hi - lo + 1) / 2;
+      if (First_ANDID_of_ORID (b, mid) <= and_node_id)
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+  return lo;
+}
 
 @ @<Create the final and-nodes for all earley sets@> =
 {
-  int unique_draft_and_node_count = 0;
-  @<Count draft and-nodes@>@;
-  @<Create the final and-node array@>@;
-}
-
-@ @<Create the final and-node array@> =
+  const int unique_draft_and_node_count =
+    draft_and_node_count (b, 0, OR_Count_of_B (b));
+  bocage_and_nodes_new (b, unique_draft_and_node_count);
+  if (final_and_nodes_create (b, 0, OR_Count_of_B (b), 0))
+    Ambiguity_Metric_of_B (b) = 2;
+}
+
+@ Create the final or-nodes
+from |first_or_node_id| up to, but not including, |end_or_node_id|,
+and their final and-nodes,
+in the arrays of |b|,
+starting at |first_and_node_id|.
+The space for them must already be allocated.
+Returns 1 if any of the or-nodes has more than one and-node,
+0 otherwise.
+@<Function definitions@> =
+PRIVATE int
+final_and_nodes_create (BOCAGE b, ORID first_or_node_id,
+  ORID end_or_node_id, ANDID first_and_node_id)
 {
-  const int or_count_of_b = OR_Count_of_B (b);
   int or_node_id;
-  int and_node_id = 0;
-  const AND ands_of_b = ANDs_of_B (b) =
-    marpa_new (AND_Object, unique_draft_and_node_count);
-  for (or_node_id = 0; or_node_id < or_count_of_b; or_node_id++)
+  int and_node_id = first_and_node_id;
+  int is_ambiguous = 0;
+  for (or_node_id = first_or_node_id; or_node_id < end_or_node_id;
+       or_node_id++)
     {
-      int and_count_of_parent_or = 0;
       const OR or_node = OR_of_B_by_ID (b, or_node_id);
-      DAND dand = DANDs_of_OR (or_node);
-      First_ANDID_of_OR (or_node) = and_node_id;
-      while (dand)
-	{
-	  const OR cause_or_node = Cause_OR_of_DAND (dand);
-	  const AND and_node = ands_of_b + and_node_id;
-	  OR_of_AND (and_node) = or_node;
-	  Predecessor_OR_of_AND (and_node) = Predecessor_OR_of_DAND (dand);
-	  Cause_OR_of_AND (and_node) = cause_or_node;
-	  and_node_id++;
-	  and_count_of_parent_or++;
-	  dand = Next_DAND_of_DAND (dand);
-	}
-      AND_Count_of_OR (or_node) = and_count_of_parent_or;
-      if (and_count_of_parent_or > 1) Ambiguity_Metric_of_B (b) = 2;
+      int and_count_of_parent_or;
+      final_or_node_set (b, or_node);
+      and_count_of_parent_or =
+        final_and_nodes_of_or_create (b, or_node, and_node_id);
+      and_node_id += and_count_of_parent_or;
+      if (and_count_of_parent_or > 1) is_ambiguous = 1;
+    }
+  return is_ambiguous;
+}
+
+@ Copy |or_node| into the or-node arrays of |b|.
+@<Function definitions@> =
+PRIVATE void
+final_or_node_set (BOCAGE b, OR or_node)
+{
+  const ORID or_node_id = ID_of_OR (or_node);
+  Origin_Ord_of_ORID (b, or_node_id) = Origin_Ord_of_OR (or_node);
+  YS_Ord_of_ORID (b, or_node_id) = YS_Ord_of_OR (or_node);
+  IRLID_of_ORID (b, or_node_id) = IRLID_of_OR (or_node);
+  Position_of_ORID (b, or_node_id) = Position_of_OR (or_node);
+}
+
+@ Create the final and-nodes of |or_node|
+from its draft and-nodes,
+starting at |first_and_node_id|.
+Returns the number of and-nodes created.
+@<Function definitions@> =
+PRIVATE int
+final_and_nodes_of_or_create (BOCAGE b, OR or_node, ANDID first_and_node_id)
+{
+  const ORID or_node_id = ID_of_OR (or_node);
+  ANDID and_node_id = first_and_node_id;
+  DAND dand = DANDs_of_OR (or_node);
+  First_ANDID_of_ORID (b, or_node_id) = first_and_node_id;
+  while (dand)
+    {
+      const OR predecessor_or_node = Predecessor_OR_of_DAND (dand);
+      const OR cause_or_node = Cause_OR_of_DAND (dand);
+      Predecessor_ORID_of_ANDID (b, and_node_id) =
+        predecessor_or_node ? ID_of_OR (predecessor_or_node) : -1;
+      if (OR_is_Token (cause_or_node))
+        {
+          NSYID_of_ANDID (b, and_node_id) = NSYID_of_OR (cause_or_node);
+          Token_Value_of_ANDID (b, and_node_id) =
+            Type_of_OR (cause_or_node) == VALUED_TOKEN_OR_NODE ?
+            Value_of_OR (cause_or_node) : 0;
+        }
+      else
+        {
+          NSYID_of_ANDID (b, and_node_id) = -1;
+          Cause_ORID_of_ANDID (b, and_node_id) = ID_of_OR (cause_or_node);
+        }
+      and_node_id++;
+      dand = Next_DAND_of_DAND (dand);
     }
-  AND_Count_of_B (b) = and_node_id;
-  MARPA_ASSERT (and_node_id == unique_draft_and_node_count);
+  AND_Count_of_ORID (b, or_node_id) = and_node_id - first_and_node_id;
+  return and_node_id - first_and_node_id;
 }
 
 
@@ -11057,13 +15545,26 @@ marpa_obs_free(OBS_of_B(b));
 @<Function definitions@> =
 Marpa_Bocage marpa_b_new(Marpa_Recognizer r,
     Marpa_Earley_Set_ID ordinal_arg)
+{
+  return bocage_new (r, ordinal_arg, 0);
+}
+
+@ Errors in the construction of a bocage are reported
+in its recognizer,
+so that bocages of a frozen grammar may be
+created in several threads at once.
+If |is_lazy| is set, only the or-nodes are created here.
+The and-nodes of each or-node are created when they are needed.
+@<Function definitions@> =
+PRIVATE BOCAGE
+bocage_new (RECCE r, YSID ordinal_arg, int is_lazy)
 {
     @<Return |NULL| on failure@>@;
     @<Declare bocage locals@>@;
-    @<Fail if fatal error@>@;
+    @<Fail if recognizer has a fatal error@>@;
     if (_MARPA_UNLIKELY( ordinal_arg <= -2 ))
     {
-        MARPA_ERROR(MARPA_ERR_INVALID_LOCATION);
+        MARPA_R_ERROR(MARPA_ERR_INVALID_LOCATION);
         return failure_indicator;
     }
 
@@ -11097,19 +15598,289 @@ Marpa_Bocage marpa_b_new(Marpa_Recognizer r,
     bocage_setup_obs = marpa_obs_init;
     @<Allocate bocage setup working data@>@;
     @<Populate the PSI data@>@;
-    @<Create the or-nodes for all earley sets@>@;
-    @<Create the final and-nodes for all earley sets@>@;
-    @<Set top or node id in |b|@>;
+    if (is_lazy) {
+        @<Create the or-nodes of a lazy bocage@>@;
+        @<Set top or node id in |b|@>;
+        return b;
+    }
+    if (Bocage_Executor_of_R (r)) {
+        @<Create the bocage nodes with the executor@>@;
+    } else {
+        @<Create the or-nodes for all earley sets@>@;
+        @<Create the final and-nodes for all earley sets@>@;
+        @<Set top or node id in |b|@>;
+    }
+    my_free (ORs_of_B (b));
+    ORs_of_B (b) = NULL;
     marpa_obs_free(bocage_setup_obs);
     return b;
+    SOURCE_RELEASED: ;
+          MARPA_R_ERROR(MARPA_ERR_EARLEY_SET_RELEASED);
+          goto FAILURE;
     NO_PARSE: ;
-          MARPA_ERROR(MARPA_ERR_NO_PARSE);
+          MARPA_R_ERROR(MARPA_ERR_NO_PARSE);
+    FAILURE: ;
+    if (bocage_setup_obs) {
+        marpa_obs_free(bocage_setup_obs);
+    }
     if (b) {
         @<Destroy bocage elements, all phases@>;
     }
     return NULL;
 }
 
+@*0 Bocage setup with an executor.
+An application may have the setup of the bocage
+divided into tasks,
+which it runs using an {\it executor} of its own.
+An executor is a function which
+runs the tasks, possibly in parallel,
+and returns when all of them are done.
+Libmarpa itself does not create threads.
+@<Public typedefs@> =
+typedef void (*Marpa_Task_Function) (void *task_data, int task_ix);
+typedef void (*Marpa_Executor) (void *executor_data,
+    Marpa_Task_Function task, void *task_data, int task_count);
+@ @d Bocage_Executor_of_R(r) ((r)->t_bocage_executor)
+@d Bocage_Executor_Data_of_R(r) ((r)->t_bocage_executor_data)
+@d Bocage_Task_Count_of_R(r) ((r)->t_bocage_task_count)
+@<Widely aligned recognizer elements@> =
+Marpa_Executor t_bocage_executor;
+void *t_bocage_executor_data;
+@ @<Int aligned recognizer elements@> = int t_bocage_task_count;
+@ @<Initialize recognizer elements@> =
+Bocage_Executor_of_R (r) = NULL;
+Bocage_Executor_Data_of_R (r) = NULL;
+Bocage_Task_Count_of_R (r) = 1;
+
+@ A null |executor| restores the default,
+in which the bocage is set up without tasks.
+Returns |task_count| on success, |-2| on failure.
+@<Function definitions@> =
+int
+marpa_r_bocage_executor_set (Marpa_Recognizer r,
+  Marpa_Executor executor, void *executor_data, int task_count)
+{
+  @<Return |-2| on failure@>@;
+  @<Unpack recognizer objects@>@;
+  @<Fail if recognizer has a fatal error@>@;
+  if (_MARPA_UNLIKELY (task_count < 1))
+    {
+      MARPA_R_ERROR (MARPA_ERR_INVALID_TASK_COUNT);
+      return failure_indicator;
+    }
+  Bocage_Executor_of_R (r) = executor;
+  Bocage_Executor_Data_of_R (r) = executor_data;
+  Bocage_Task_Count_of_R (r) = task_count;
+  return task_count;
+}
+
+@ When the setup is divided into tasks,
+each task has a setup obstack of its own,
+on which its or-nodes are allocated.
+The setup obstacks of the tasks are freed
+once the final or-nodes and and-nodes have been created,
+and the ID of the top or-node has been found.
+
+@ The setup is done in three phases,
+with a call to the executor for each.
+In the first phase, the tasks create their or-nodes.
+The or-nodes are then numbered,
+in order of task.
+Since the ranges of the tasks are in the order of
+the Earley sets,
+and each task creates its or-nodes
+in the same order as the sequential setup,
+every or-node gets the same ID that the sequential setup
+would have given it.
+In the second phase, the tasks renumber their or-nodes,
+create their draft and-nodes, and count them.
+The and-nodes are then numbered in the same way,
+and in the third phase the tasks create their final and-nodes.
+The result is the same bocage as the sequential setup creates.
+@d BOCAGE_SETUP_OR_PHASE 1
+@d BOCAGE_SETUP_DAND_PHASE 2
+@d BOCAGE_SETUP_AND_PHASE 3
+@<Private structures@> =
+struct s_bocage_setup {
+    BOCAGE t_bocage;
+    RECCE t_recce;
+    struct s_bocage_setup_per_ys* t_per_ys_data;
+    struct s_bocage_setup_task* t_tasks;
+    int t_phase;
+};
+
+@ @<Create the bocage nodes with the executor@> =
+{
+  struct s_bocage_setup setup;
+  const Marpa_Executor executor = Bocage_Executor_of_R (r);
+  void *const executor_data = Bocage_Executor_Data_of_R (r);
+  const int task_count =
+    Bocage_Task_Count_of_R (r) < earley_set_count_of_r ?
+    Bocage_Task_Count_of_R (r) : earley_set_count_of_r;
+  struct s_bocage_setup_task *const tasks =
+    marpa_obs_new (bocage_setup_obs, struct s_bocage_setup_task,
+                   task_count);
+  int task_ix;
+  setup.t_bocage = b;
+  setup.t_recce = r;
+  setup.t_per_ys_data = per_ys_data;
+  setup.t_tasks = tasks;
+  @<Divide the Earley sets among the setup tasks@>@;
+  setup.t_phase = BOCAGE_SETUP_OR_PHASE;
+  (*executor) (executor_data, bocage_setup_task_run, &setup, task_count);
+  @<Number the or-nodes of the setup tasks@>@;
+  setup.t_phase = BOCAGE_SETUP_DAND_PHASE;
+  (*executor) (executor_data, bocage_setup_task_run, &setup, task_count);
+  @<Number the and-nodes of the setup tasks@>@;
+  setup.t_phase = BOCAGE_SETUP_AND_PHASE;
+  (*executor) (executor_data, bocage_setup_task_run, &setup, task_count);
+  @<Set top or node id in |b|@>;
+  for (task_ix = 0; task_ix < task_count; task_ix++)
+    {
+      if (tasks[task_ix].t_is_ambiguous)
+        Ambiguity_Metric_of_B (b) = 2;
+      marpa_obs_free (tasks[task_ix].t_setup_obs);
+    }
+}
+
+@ The Earley sets are divided into contiguous ranges,
+one per task,
+so that each range has about the same number of Earley items.
+@<Divide the Earley sets among the setup tasks@> =
+{
+  int ysid;
+  int first_ysid = 0;
+  int item_count = 0;
+  int items_so_far = 0;
+  task_ix = 0;
+  for (ysid = 0; ysid < earley_set_count_of_r; ysid++)
+    {
+      const int ys_item_count = YIM_Count_of_YS (YS_of_R_by_Ord (r, ysid));
+      item_count += ys_item_count;
+      items_so_far += ys_item_count;
+      if (task_ix < task_count - 1
+          && (double) items_so_far * task_count >=
+          (double) count_of_earley_items_in_parse * (task_ix + 1))
+        {
+          bocage_setup_task_init (tasks + task_ix, per_ys_data,
+                                  marpa_obs_init, first_ysid, ysid + 1,
+                                  item_count);
+          task_ix++;
+          first_ysid = ysid + 1;
+          item_count = 0;
+        }
+    }
+  for (; task_ix < task_count; task_ix++)
+    {
+      bocage_setup_task_init (tasks + task_ix, per_ys_data,
+                              marpa_obs_init, first_ysid,
+                              earley_set_count_of_r, item_count);
+      first_ysid = earley_set_count_of_r;
+      item_count = 0;
+    }
+}
+
+@ @<Number the or-nodes of the setup tasks@> =
+{
+  int or_node_count = 0;
+  for (task_ix = 0; task_ix < task_count; task_ix++)
+    {
+      tasks[task_ix].t_first_or_node_id = or_node_count;
+      or_node_count += tasks[task_ix].t_or_node_count;
+    }
+  ORs_of_B (b) = marpa_new (OR, or_node_count);
+  bocage_or_nodes_new (b, or_node_count);
+}
+
+@ @<Number the and-nodes of the setup tasks@> =
+{
+  int and_node_count = 0;
+  for (task_ix = 0; task_ix < task_count; task_ix++)
+    {
+      tasks[task_ix].t_first_and_node_id = and_node_count;
+      and_node_count += tasks[task_ix].t_and_node_count;
+    }
+  bocage_and_nodes_new (b, and_node_count);
+}
+
+@ This is the task function passed to the executor.
+Different tasks share no data that any of them change,
+except the PSI data,
+where each task changes only the entries
+for the Earley sets in its own range.
+@<Function definitions@> =
+PRIVATE void
+bocage_setup_task_run (void *setup_data, int task_ix)
+{
+  struct s_bocage_setup *const setup = setup_data;
+  const BOCAGE b = setup->t_bocage;
+  struct s_bocage_setup_task *const task = setup->t_tasks + task_ix;
+  switch (setup->t_phase)
+    {
+    case BOCAGE_SETUP_OR_PHASE:
+      @<Create the or-nodes of |task|@>@;
+      break;
+    case BOCAGE_SETUP_DAND_PHASE:
+      @<Create the draft and-nodes of |task|@>@;
+      break;
+    case BOCAGE_SETUP_AND_PHASE:
+      task->t_is_ambiguous =
+        final_and_nodes_create (b, task->t_first_or_node_id,
+                                task->t_first_or_node_id +
+                                task->t_or_node_count,
+                                task->t_first_and_node_id) ? 1 : 0;
+      break;
+    }
+}
+
+@ The PSLs are per task, so each task has its own copy
+of the per-Earley-set data.
+The copies share the PSI data.
+A task needs the data only for Earley sets up to the
+end of its range.
+@<Create the or-nodes of |task|@> =
+{
+  const RECCE r = setup->t_recce;
+  const int ys_count = task->t_end_ysid - task->t_first_ysid;
+  struct s_bocage_setup_per_ys *const per_ys_data =
+    marpa_obs_new (task->t_setup_obs, struct s_bocage_setup_per_ys,
+                   task->t_end_ysid);
+  int ysid;
+  for (ysid = 0; ysid < task->t_end_ysid; ysid++)
+    {
+      per_ys_data[ysid] = setup->t_per_ys_data[ysid];
+      per_ys_data[ysid].t_or_psl = NULL;
+    }
+  task->t_per_ys_data = per_ys_data;
+  task->t_first_or_ix_by_ys =
+    marpa_obs_new (task->t_setup_obs, int, ys_count + 1);
+  task->t_or_nodes = marpa_new (OR, task->t_or_node_capacity);
+  task->t_psl_ysids = marpa_new (YSID, task->t_or_node_capacity);
+  bocage_setup_earley_sets (b, r, task, 1, 0);
+}
+
+@ @<Create the draft and-nodes of |task|@> =
+{
+  const RECCE r = setup->t_recce;
+  const ORID first_or_node_id = task->t_first_or_node_id;
+  int or_ix;
+  bocage_setup_earley_sets (b, r, task, 0, 1);
+  for (or_ix = 0; or_ix < task->t_or_node_count; or_ix++)
+    {
+      const OR or_node = task->t_or_nodes[or_ix];
+      ID_of_OR (or_node) = first_or_node_id + or_ix;
+      OR_of_B_by_ID (b, first_or_node_id + or_ix) = or_node;
+    }
+  my_free (task->t_or_nodes);
+  task->t_or_nodes = NULL;
+  my_free (task->t_psl_ysids);
+  task->t_psl_ysids = NULL;
+  task->t_and_node_count =
+    draft_and_node_count (b, first_or_node_id,
+                          first_or_node_id + task->t_or_node_count);
+}
+
 @ @d Valued_BV_of_B(b) ((b)->t_valued_bv)
 @d Valued_Locked_BV_of_B(b) ((b)->t_valued_locked_bv)
 @d XSYID_is_Valued_in_B(b, xsyid)
@@ -11153,98 +15924,561 @@ struct s_bocage_setup_per_ys* per_ys_data = NULL;
 
 @ @<Set |end_of_parse_earley_set| and |end_of_parse_earleme|@> =
 {
-  if (ordinal_arg == -1)
+  if (ordinal_arg == -1)
+    {
+      end_of_parse_earley_set = YS_at_Current_Earleme_of_R (r);
+    }
+  else
+    {                           /* |ordinal_arg| != -1 */
+      if (!YS_Ord_is_Valid (r, ordinal_arg))
+        {
+          MARPA_R_ERROR(MARPA_ERR_INVALID_LOCATION);
+          return failure_indicator;
+        }
+      end_of_parse_earley_set = YS_of_R_by_Ord (r, ordinal_arg);
+    }
+
+  if (!end_of_parse_earley_set)
+    goto NO_PARSE;
+  end_of_parse_earleme = Earleme_of_YS (end_of_parse_earley_set);
+}
+
+@
+@<Allocate bocage setup working data@>=
+{
+  int earley_set_ordinal;
+  int earley_set_count = YS_Count_of_R (r);
+  count_of_earley_items_in_parse = 0;
+  per_ys_data = marpa_obs_new (
+    bocage_setup_obs, struct s_bocage_setup_per_ys, earley_set_count);
+  for (earley_set_ordinal = 0; earley_set_ordinal < earley_set_count;
+       earley_set_ordinal++)
+    {
+      const YS_Const earley_set = YS_of_R_by_Ord (r, earley_set_ordinal);
+      const int item_count = YIM_Count_of_YS (earley_set);
+      count_of_earley_items_in_parse += item_count;
+      {
+        int item_ordinal;
+        struct s_bocage_setup_per_ys *per_ys = per_ys_data + earley_set_ordinal;
+        per_ys->t_or_node_by_item =
+          marpa_obs_new (bocage_setup_obs, OR, item_count);
+        per_ys->t_or_psl = NULL;
+        per_ys->t_and_psl = NULL;
+        for (item_ordinal = 0; item_ordinal < item_count; item_ordinal++)
+          {
+            OR_by_PSI (per_ys_data, earley_set_ordinal, item_ordinal) = NULL;
+          }
+      }
+  }
+}
+
+@ Predicted AHFA states can be skipped since they
+contain no completions.
+Note that AHFA state 0 is not marked as a predicted AHFA state,
+even though it can contain a predicted AHM.
+@ The search for the start Earley item is done once
+per parse ---
+$O(s)$, where $s$ is the size of the end of parse Earley set.
+This makes it very hard to justify any precomputations to
+help the search, because if they have to be done once per
+Earley set, that is a $O(\wsize \cdot s')$ overhead,
+where $\wsize$ is the length of the input, and where
+$s'$ is the average size of an Earley set.
+It is hard to believe that for practical grammars
+that $O(\wsize \cdot s') <= O(s)$, which
+is what it would take for any per-Earley set overhead
+to make sense.
+@<Find |start_yim|@> =
+{
+    int yim_ix;
+    YIM* const earley_items = YIMs_of_YS(end_of_parse_earley_set);
+    const IRL start_irl = g->t_start_irl;
+    const IRLID sought_irl_id = ID_of_IRL(start_irl);
+    const int earley_item_count = YIM_Count_of_YS(end_of_parse_earley_set);
+    for (yim_ix = 0; yim_ix < earley_item_count; yim_ix++) {
+        const YIM earley_item = earley_items[yim_ix];
+        if (Origin_Earleme_of_YIM(earley_item) > 0) continue; // Not a start YIM
+        if (YIM_was_Predicted(earley_item)) continue;
+        {
+           const AHM ahm = AHM_of_YIM(earley_item);
+           if (IRLID_of_AHM(ahm) == sought_irl_id) {
+                start_yim = earley_item;
+                      break;
+            }
+        }
+    }
+}
+
+@ @<Set top or node id in |b|@> =
+{
+  const YSID end_of_parse_ordinal = Ord_of_YS (end_of_parse_earley_set);
+  const int start_earley_item_ordinal = Ord_of_YIM (start_yim);
+  const OR root_or_node =
+    OR_by_PSI(per_ys_data, end_of_parse_ordinal, start_earley_item_ordinal);
+  Top_ORID_of_B (b) = ID_of_OR (root_or_node);
+}
+
+@*0 Lazy bocages.
+A lazy bocage creates all of its or-nodes when it is created,
+but creates the and-nodes of an or-node
+only when they are first needed ---
+usually, when a tree iterator first visits the or-node.
+An application which wants only the first parse
+of an ambiguous input
+then creates only the and-nodes which that parse needs.
+\par
+The or-nodes are needed up front,
+because they are numbered in order of creation,
+and the and-nodes of one Earley set
+refer to or-nodes of many others.
+The draft and-nodes are created, as in the eager bocage,
+by running through the source links of the Earley items,
+but only for the Earley items which contribute to the
+or-node being expanded.
+The Earley items are processed in the same order as in an
+eager bocage, and with the same PSL data, so that
+a lazy bocage, once expanded, is the same as an eager one,
+down to the order of the and-nodes of each or-node.
+Only the and-node IDs differ.
+@ An Earley item adds draft and-nodes to its main or-node,
+and, if it has Leo sources,
+to the or-nodes on its Leo paths.
+Whether it adds them, and which ones it adds,
+can depend on the draft and-nodes
+which the Earley items before it have already added to those
+or-nodes.
+So the or-nodes of each Earley set are joined into
+{\it components},
+where two or-nodes are in the same component if an
+Earley item may add draft and-nodes to both of them.
+The first time an or-node is expanded,
+all the Earley items which contribute to its component
+are processed, in order.
+Each component, therefore, is the unit of memoization:
+an Earley item is never processed twice.
+\par
+While a lazy bocage has unexpanded or-nodes,
+it keeps its setup data, and
+it uses the Earley sets of its recognizer.
+It holds a reference to the recognizer,
+and the recognizer must not change its Earley sets.
+Once every or-node has been expanded,
+the setup data is freed and the reference is released.
+@d Lazy_of_B(b) ((b)->t_lazy)
+@d B_is_Lazy(b) ((b)->t_is_lazy)
+@d OR_is_Expanded_in_B(b, id) (AND_Count_of_ORID((b), (id)) >= 0)
+@<Private incomplete structures@> =
+struct s_bocage_lazy;
+@ @<Widely aligned bocage elements@> =
+struct s_bocage_lazy* t_lazy;
+@ @<Bit aligned bocage elements@> =
+BITFIELD t_is_lazy:1;
+@ @<Initialize bocage elements@> =
+Lazy_of_B(b) = NULL;
+B_is_Lazy(b) = 0;
+@ @<Destroy bocage elements, main phase@> =
+bocage_lazy_free (b);
+
+@ The or-nodes, and the PSL data needed to restore the PSLs of
+an Earley set, are kept in the setup task.
+|t_or_node_roots| is the union-find forest of the components.
+Once the or-nodes are created, it is flattened,
+so that each entry is the ID of the root or-node of the component.
+|t_contributors| are the Earley items which contribute to the
+components, grouped by component and in order within each group.
+@<Private structures@> =
+struct s_bocage_lazy {
+    RECCE t_recce;
+    struct marpa_obstack* t_setup_obs;
+    struct s_bocage_setup_per_ys* t_per_ys_data;
+    ORID* t_or_node_roots;
+    YIM* t_contributors;
+    ORID* t_contributor_or_node_ids;
+    int* t_first_contributor_ix_by_root;
+    Bit_Vector t_component_is_expanded;
+    struct s_bocage_setup_task t_task;
+    PSAR t_or_psar;
+    int t_or_node_root_count;
+    int t_contributor_count;
+    int t_contributor_capacity;
+    int t_unexpanded_or_node_count;
+    int t_and_node_capacity;
+    YSID t_psl_ysid;
+};
+
+@ The count of the lazy bocages
+which still use the Earley sets of a recognizer.
+@d Lazy_Bocage_Count_of_R(r) ((r)->t_lazy_bocage_count)
+@<Int aligned recognizer elements@> = int t_lazy_bocage_count;
+@ @<Initialize recognizer elements@> =
+Lazy_Bocage_Count_of_R(r) = 0;
+@ @<Fail if recognizer has a lazy bocage@> =
+if (_MARPA_UNLIKELY (Lazy_Bocage_Count_of_R (r) > 0))
+  {
+    MARPA_R_ERROR (MARPA_ERR_RECCE_HAS_LAZY_BOCAGE);
+    return failure_indicator;
+  }
+
+@ @<Function definitions@> =
+Marpa_Bocage marpa_b_lazy_new(Marpa_Recognizer r,
+    Marpa_Earley_Set_ID ordinal_arg)
+{
+  return bocage_new (r, ordinal_arg, 1);
+}
+
+@ The or-nodes are created in a single task,
+as in the default setup,
+but the PSL data is recorded, as the setup tasks of an executor
+record it.
+The bocage executor of the recognizer, if any, is not used.
+@<Create the or-nodes of a lazy bocage@> =
+{
+  struct s_bocage_lazy *const lazy = my_malloc (sizeof (*lazy));
+  struct s_bocage_setup_task *const task = &lazy->t_task;
+  lazy->t_recce = r;
+  lazy->t_setup_obs = bocage_setup_obs;
+  lazy->t_per_ys_data = per_ys_data;
+  lazy->t_or_node_roots = NULL;
+  lazy->t_or_node_root_count = 0;
+  lazy->t_contributor_count = 0;
+  lazy->t_contributor_capacity = 1024;
+  lazy->t_contributors = marpa_new (YIM, lazy->t_contributor_capacity);
+  lazy->t_contributor_or_node_ids =
+    marpa_new (ORID, lazy->t_contributor_capacity);
+  lazy->t_psl_ysid = -1;
+  bocage_setup_task_init (task, per_ys_data, bocage_setup_obs,
+                          0, earley_set_count_of_r,
+                          count_of_earley_items_in_parse);
+  task->t_lazy = lazy;
+  task->t_first_or_ix_by_ys =
+    marpa_obs_new (bocage_setup_obs, int, earley_set_count_of_r + 1);
+  task->t_or_nodes = marpa_new (OR, task->t_or_node_capacity);
+  task->t_psl_ysids = marpa_new (YSID, task->t_or_node_capacity);
+  bocage_setup_earley_sets (b, r, task, 1, 0);
+  bocage_or_nodes_new (b, task->t_or_node_count);
+  lazy_or_node_roots_extend (lazy, task->t_or_node_count);
+  @<Group the contributors of the lazy bocage by component@>@;
+  {
+    int or_node_id;
+    for (or_node_id = 0; or_node_id < task->t_or_node_count; or_node_id++)
+      {
+        final_or_node_set (b, task->t_or_nodes[or_node_id]);
+        First_ANDID_of_ORID (b, or_node_id) = -1;
+        AND_Count_of_ORID (b, or_node_id) = -1;
+      }
+  }
+  lazy->t_unexpanded_or_node_count = task->t_or_node_count;
+  lazy->t_and_node_capacity = task->t_or_node_count;
+  bocage_and_nodes_new (b, lazy->t_and_node_capacity);
+  AND_Count_of_B (b) = 0;
+  lazy->t_or_psar = my_malloc (sizeof (PSAR_Object));
+  psar_init (lazy->t_or_psar, SYMI_Count_of_G (g));
+  Lazy_of_B (b) = lazy;
+  B_is_Lazy (b) = 1;
+  recce_ref (r);
+  Lazy_Bocage_Count_of_R (r)++;
+}
+
+@ This is done after the or-nodes of |work_earley_set_ordinal|
+are created,
+when the PSLs are those that the draft and-nodes
+of an eager bocage are created with.
+The main or-node of an Earley item is the one its
+token and completion sources add draft and-nodes to.
+Earley items without one never add draft and-nodes.
+@<Find the contributors for |work_earley_set_ordinal|@> =
+{
+  struct s_bocage_lazy *const lazy = task->t_lazy;
+  int item_ordinal;
+  lazy_or_node_roots_extend (lazy, task->t_or_node_count);
+  for (item_ordinal = 0; item_ordinal < item_count; item_ordinal++)
+    {
+      const YIM work_earley_item = yims_of_ys[item_ordinal];
+      const int work_symbol_instance =
+        SYMI_of_AHM (AHM_of_YIM (work_earley_item));
+      const int work_origin_ordinal =
+        Ord_of_YS (Origin_of_YIM (work_earley_item));
+      OR work_proper_or_node;
+      if (!OR_by_PSI (per_ys_data, work_earley_set_ordinal, item_ordinal))
+        continue;
+      if (work_symbol_instance < 0)
+        continue;
+      work_proper_or_node = or_by_origin_and_symi (per_ys_data,
+        work_origin_ordinal, work_symbol_instance);
+      lazy_contributor_add (lazy, work_earley_item,
+                            ID_of_OR (work_proper_or_node));
+      @<Join the Leo path or-nodes of |work_earley_item|@>@;
+    }
+}
+
+@ The Leo paths are followed as in
+|@<Add draft and-nodes for chain starting with |leo_predecessor|@>|.
+The top or-node of a Leo path is the main or-node.
+@<Join the Leo path or-nodes of |work_earley_item|@> =
+{
+  SRCL source_link;
+  for (source_link = First_Leo_SRCL_of_YIM (work_earley_item);
+       source_link; source_link = Next_SRCL_of_SRCL (source_link))
+    {
+      LIM path_leo_item = LIM_of_SRCL (source_link);
+      if (!SRCL_is_Active (source_link))
+        continue;
+      while (path_leo_item && Predecessor_LIM_of_LIM (path_leo_item))
+        {
+          const YIM base_earley_item = Trailhead_YIM_of_LIM (path_leo_item);
+          IRL path_irl;
+          OR path_or_node;
+          @<Use Leo base data to set |path_or_node|@>@;
+          lazy_or_nodes_join (lazy, ID_of_OR (path_or_node),
+                              ID_of_OR (work_proper_or_node));
+          path_leo_item = Predecessor_LIM_of_LIM (path_leo_item);
+        }
+    }
+}
+
+@ @<Function definitions@> =
+PRIVATE void
+lazy_contributor_add (struct s_bocage_lazy *lazy, YIM yim, ORID or_node_id)
+{
+  const int contributor_ix = lazy->t_contributor_count++;
+  if (_MARPA_UNLIKELY (contributor_ix >= lazy->t_contributor_capacity))
+    {
+      lazy->t_contributor_capacity *= 2;
+      lazy->t_contributors =
+        marpa_renew (YIM, lazy->t_contributors,
+                     lazy->t_contributor_capacity);
+      lazy->t_contributor_or_node_ids =
+        marpa_renew (ORID, lazy->t_contributor_or_node_ids,
+                     lazy->t_contributor_capacity);
+    }
+  lazy->t_contributors[contributor_ix] = yim;
+  lazy->t_contributor_or_node_ids[contributor_ix] = or_node_id;
+}
+
+@ Each new or-node starts in a component of its own.
+@<Function definitions@> =
+PRIVATE void
+lazy_or_node_roots_extend (struct s_bocage_lazy *lazy, int or_node_count)
+{
+  ORID or_node_id;
+  if (or_node_count <= lazy->t_or_node_root_count)
+    return;
+  lazy->t_or_node_roots =
+    marpa_renew (ORID, lazy->t_or_node_roots, or_node_count);
+  for (or_node_id = lazy->t_or_node_root_count; or_node_id < or_node_count;
+       or_node_id++)
+    lazy->t_or_node_roots[or_node_id] = or_node_id;
+  lazy->t_or_node_root_count = or_node_count;
+}
+
+@ @<Function definitions@> =
+PRIVATE ORID
+lazy_or_node_root (struct s_bocage_lazy *lazy, ORID or_node_id)
+{
+  ORID *const roots = lazy->t_or_node_roots;
+  while (roots[or_node_id] != or_node_id)
+    {
+      roots[or_node_id] = roots[roots[or_node_id]];
+      or_node_id = roots[or_node_id];
+    }
+  return or_node_id;
+}
+
+@ The root of a component is its lowest or-node ID.
+@<Function definitions@> =
+PRIVATE void
+lazy_or_nodes_join (struct s_bocage_lazy *lazy, ORID or_node_a, ORID or_node_b)
+{
+  const ORID root_a = lazy_or_node_root (lazy, or_node_a);
+  const ORID root_b = lazy_or_node_root (lazy, or_node_b);
+  if (root_a < root_b)
+    lazy->t_or_node_roots[root_b] = root_a;
+  else
+    lazy->t_or_node_roots[root_a] = root_b;
+}
+
+@ The contributors were found in order of Earley set and item,
+and a counting sort keeps that order within each component.
+@<Group the contributors of the lazy bocage by component@> =
+{
+  const int or_node_count = task->t_or_node_count;
+  const int contributor_count = lazy->t_contributor_count;
+  YIM *const contributors = marpa_new (YIM, contributor_count + 1);
+  int *const first_contributor_ix_by_root =
+    marpa_new (int, or_node_count + 1);
+  ORID or_node_id;
+  int contributor_ix;
+  for (or_node_id = 0; or_node_id < or_node_count; or_node_id++)
+    {
+      lazy->t_or_node_roots[or_node_id] =
+        lazy_or_node_root (lazy, or_node_id);
+      first_contributor_ix_by_root[or_node_id] = 0;
+    }
+  first_contributor_ix_by_root[or_node_count] = 0;
+  for (contributor_ix = 0; contributor_ix < contributor_count;
+       contributor_ix++)
+    {
+      const ORID root =
+        lazy->t_or_node_roots[lazy->
+                              t_contributor_or_node_ids[contributor_ix]];
+      first_contributor_ix_by_root[root + 1]++;
+    }
+  for (or_node_id = 0; or_node_id < or_node_count; or_node_id++)
+    first_contributor_ix_by_root[or_node_id + 1] +=
+      first_contributor_ix_by_root[or_node_id];
+  for (contributor_ix = 0; contributor_ix < contributor_count;
+       contributor_ix++)
+    {
+      const ORID root =
+        lazy->t_or_node_roots[lazy->
+                              t_contributor_or_node_ids[contributor_ix]];
+      contributors[first_contributor_ix_by_root[root]++] =
+        lazy->t_contributors[contributor_ix];
+    }
+  for (or_node_id = or_node_count; or_node_id > 0; or_node_id--)
+    first_contributor_ix_by_root[or_node_id] =
+      first_contributor_ix_by_root[or_node_id - 1];
+  first_contributor_ix_by_root[0] = 0;
+  my_free (lazy->t_contributors);
+  my_free (lazy->t_contributor_or_node_ids);
+  lazy->t_contributor_or_node_ids = NULL;
+  lazy->t_contributors = contributors;
+  lazy->t_first_contributor_ix_by_root = first_contributor_ix_by_root;
+  lazy->t_component_is_expanded = bv_create (or_node_count);
+}
+
+@ Expand an or-node of a lazy bocage,
+creating its final and-nodes.
+@<Function definitions@> =
+PRIVATE void
+or_node_expand (BOCAGE b, ORID or_node_id)
+{
+  struct s_bocage_lazy *const lazy = Lazy_of_B (b);
+  const ORID root_or_node_id = lazy->t_or_node_roots[or_node_id];
+  MARPA_ASSERT (!OR_is_Expanded_in_B (b, or_node_id))@;
+  if (!bv_bit_test_then_set (lazy->t_component_is_expanded, root_or_node_id))
     {
-      end_of_parse_earley_set = YS_at_Current_Earleme_of_R (r);
+      @<Create the draft and-nodes of the component of |root_or_node_id|@>@;
+    }
+  @<Create the final and-nodes of lazy |or_node_id|@>@;
+  lazy->t_unexpanded_or_node_count--;
+  if (lazy->t_unexpanded_or_node_count <= 0)
+    bocage_lazy_free (b);
+}
+
+@ All the or-nodes of a component are in the same Earley set.
+The PSLs of that Earley set are restored,
+unless they are already loaded.
+In the compact layout, an Earley item finds its origin
+through the recognizer.
+@<Create the draft and-nodes of the component of |root_or_node_id|@> =
+{
+  const GRAMMAR g = G_of_B (b);
+  const RECCE r @,@, UNUSED = lazy->t_recce;
+  struct s_bocage_setup_per_ys *const per_ys_data = lazy->t_per_ys_data;
+  struct marpa_obstack *const bocage_setup_obs = lazy->t_setup_obs;
+  struct s_bocage_setup_task *const task = &lazy->t_task;
+  const PSAR or_psar = lazy->t_or_psar;
+  int *const first_or_ix_by_ys = task->t_first_or_ix_by_ys;
+  const YSID work_earley_set_ordinal = YS_Ord_of_ORID (b, root_or_node_id);
+  const int end_contributor_ix =
+    lazy->t_first_contributor_ix_by_root[root_or_node_id + 1];
+  int contributor_ix =
+    lazy->t_first_contributor_ix_by_root[root_or_node_id];
+  if (contributor_ix < end_contributor_ix
+      && lazy->t_psl_ysid != work_earley_set_ordinal)
+    {
+      psar_dealloc (or_psar);
+      @<Restore the or-node PSLs for |work_earley_set_ordinal|@>@;
+      lazy->t_psl_ysid = work_earley_set_ordinal;
     }
-  else
-    {                           /* |ordinal_arg| != -1 */
-      if (!YS_Ord_is_Valid (r, ordinal_arg))
+  for (; contributor_ix < end_contributor_ix; contributor_ix++)
+    {
+      const YIM work_earley_item = lazy->t_contributors[contributor_ix];
+      const int work_origin_ordinal =
+        Ord_of_YS (Origin_of_YIM (work_earley_item));
+      OR or_node = set_or_from_yim (per_ys_data, work_earley_item);
+      @<Reset |or_node| to proper predecessor@>@;
+      if (or_node)
         {
-          MARPA_ERROR(MARPA_ERR_INVALID_LOCATION);
-          return failure_indicator;
+          @<Create draft and-nodes for |or_node|@>@;
         }
-      end_of_parse_earley_set = YS_of_R_by_Ord (r, ordinal_arg);
     }
-
-  if (!end_of_parse_earley_set)
-    goto NO_PARSE;
-  end_of_parse_earleme = Earleme_of_YS (end_of_parse_earley_set);
 }
 
-@
-@<Allocate bocage setup working data@>=
+@ The and-nodes are appended to the and-node arrays of |b|,
+which grow as needed.
+@<Create the final and-nodes of lazy |or_node_id|@> =
 {
-  int earley_set_ordinal;
-  int earley_set_count = YS_Count_of_R (r);
-  count_of_earley_items_in_parse = 0;
-  per_ys_data = marpa_obs_new (
-    bocage_setup_obs, struct s_bocage_setup_per_ys, earley_set_count);
-  for (earley_set_ordinal = 0; earley_set_ordinal < earley_set_count;
-       earley_set_ordinal++)
+  const OR or_node = lazy->t_task.t_or_nodes[or_node_id];
+  const ANDID first_and_node_id = AND_Count_of_B (b);
+  int and_count_of_or = 0;
+  DAND dand;
+  for (dand = DANDs_of_OR (or_node); dand; dand = Next_DAND_of_DAND (dand))
+    and_count_of_or++;
+  if (first_and_node_id + and_count_of_or > lazy->t_and_node_capacity)
     {
-      const YS_Const earley_set = YS_of_R_by_Ord (r, earley_set_ordinal);
-      const int item_count = YIM_Count_of_YS (earley_set);
-      count_of_earley_items_in_parse += item_count;
-      {
-        int item_ordinal;
-        struct s_bocage_setup_per_ys *per_ys = per_ys_data + earley_set_ordinal;
-        per_ys->t_or_node_by_item =
-          marpa_obs_new (bocage_setup_obs, OR, item_count);
-        per_ys->t_or_psl = NULL;
-        per_ys->t_and_psl = NULL;
-        for (item_ordinal = 0; item_ordinal < item_count; item_ordinal++)
-          {
-            OR_by_PSI (per_ys_data, earley_set_ordinal, item_ordinal) = NULL;
-          }
-      }
-  }
+      int capacity = lazy->t_and_node_capacity * 2;
+      if (capacity < first_and_node_id + and_count_of_or)
+        capacity = first_and_node_id + and_count_of_or;
+      lazy->t_and_node_capacity = capacity;
+      b->t_and_predecessors =
+        marpa_renew (ORID, b->t_and_predecessors, capacity);
+      b->t_and_causes = marpa_renew (int, b->t_and_causes, capacity);
+      b->t_and_symbols = marpa_renew (NSYID, b->t_and_symbols, capacity);
+    }
+  final_and_nodes_of_or_create (b, or_node, first_and_node_id);
+  AND_Count_of_B (b) = first_and_node_id + and_count_of_or;
+  if (and_count_of_or > 1)
+    Ambiguity_Metric_of_B (b) = 2;
 }
 
-@ Predicted AHFA states can be skipped since they
-contain no completions.
-Note that AHFA state 0 is not marked as a predicted AHFA state,
-even though it can contain a predicted AHM.
-@ The search for the start Earley item is done once
-per parse ---
-$O(s)$, where $s$ is the size of the end of parse Earley set.
-This makes it very hard to justify any precomputations to
-help the search, because if they have to be done once per
-Earley set, that is a $O(\wsize \cdot s')$ overhead,
-where $\wsize$ is the length of the input, and where
-$s'$ is the average size of an Earley set.
-It is hard to believe that for practical grammars
-that $O(\wsize \cdot s') <= O(s)$, which
-is what it would take for any per-Earley set overhead
-to make sense.
-@<Find |start_yim|@> =
+@ Expand every or-node of |b| which is not yet expanded.
+This is needed for the properties of the bocage as a whole,
+such as its ambiguity metric.
+@<Function definitions@> =
+PRIVATE void
+bocage_expand (BOCAGE b)
 {
-    int yim_ix;
-    YIM* const earley_items = YIMs_of_YS(end_of_parse_earley_set);
-    const IRL start_irl = g->t_start_irl;
-    const IRLID sought_irl_id = ID_of_IRL(start_irl);
-    const int earley_item_count = YIM_Count_of_YS(end_of_parse_earley_set);
-    for (yim_ix = 0; yim_ix < earley_item_count; yim_ix++) {
-        const YIM earley_item = earley_items[yim_ix];
-        if (Origin_Earleme_of_YIM(earley_item) > 0) continue; // Not a start YIM
-        if (YIM_was_Predicted(earley_item)) continue;
-        {
-           const AHM ahm = AHM_of_YIM(earley_item);
-           if (IRLID_of_AHM(ahm) == sought_irl_id) {
-                start_yim = earley_item;
-                      break;
-            }
-        }
+  const int or_node_count = OR_Count_of_B (b);
+  ORID or_node_id;
+  if (!Lazy_of_B (b))
+    return;
+  for (or_node_id = 0; or_node_id < or_node_count; or_node_id++)
+    {
+      if (!OR_is_Expanded_in_B (b, or_node_id))
+        or_node_expand (b, or_node_id);
     }
 }
 
-@ @<Set top or node id in |b|@> =
+@ Free the setup data of a lazy bocage,
+and release its recognizer.
+The PSAR must be destroyed before the setup obstack,
+which holds the owners of its PSLs.
+This function is safe to call for a bocage which
+is not lazy.
+@<Function definitions@> =
+PRIVATE void
+bocage_lazy_free (BOCAGE b)
 {
-  const YSID end_of_parse_ordinal = Ord_of_YS (end_of_parse_earley_set);
-  const int start_earley_item_ordinal = Ord_of_YIM (start_yim);
-  const OR root_or_node =
-    OR_by_PSI(per_ys_data, end_of_parse_ordinal, start_earley_item_ordinal);
-  Top_ORID_of_B (b) = ID_of_OR (root_or_node);
+  struct s_bocage_lazy *const lazy = Lazy_of_B (b);
+  RECCE r;
+  if (!lazy)
+    return;
+  r = lazy->t_recce;
+  psar_destroy (lazy->t_or_psar);
+  my_free (lazy->t_or_psar);
+  my_free (lazy->t_task.t_or_nodes);
+  my_free (lazy->t_task.t_psl_ysids);
+  my_free (lazy->t_or_node_roots);
+  my_free (lazy->t_contributors);
+  my_free (lazy->t_first_contributor_ix_by_root);
+  bv_free (lazy->t_component_is_expanded);
+  marpa_obs_free (lazy->t_setup_obs);
+  my_free (lazy);
+  Lazy_of_B (b) = NULL;
+  Lazy_Bocage_Count_of_R (r)--;
+  recce_unref (r);
 }
 
 @*0 Top or-node.
@@ -11274,6 +16508,7 @@ int marpa_b_ambiguity_metric(Marpa_Bocage b)
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
+  bocage_expand (b);
   return Ambiguity_Metric_of_B(b);
 }
 
@@ -11443,6 +16678,7 @@ marpa_o_ref (Marpa_Order o)
 PRIVATE void order_free(ORDER o)
 {
   @<Unpack order objects@>@;
+  bv_free (Ranked_BV_of_O (o));
   bocage_unref(b);
   marpa_obs_free(OBS_of_O(o));
   my_free( o);
@@ -11467,9 +16703,10 @@ int marpa_o_ambiguity_metric(Marpa_Order o)
   @<Unpack order objects@>@;
   const int old_ambiguity_metric_of_o
     = Ambiguity_Metric_of_O(o);
-  const int ambiguity_metric_of_b
-    = (Ambiguity_Metric_of_B(b) <= 1 ? 1 : 2);
+  int ambiguity_metric_of_b;
   @<Fail if fatal error@>@;
+  bocage_expand (b);
+  ambiguity_metric_of_b = (Ambiguity_Metric_of_B(b) <= 1 ? 1 : 2);
   O_is_Frozen(o) = 1;
   if (old_ambiguity_metric_of_o >= 0)
     return old_ambiguity_metric_of_o;
@@ -11491,7 +16728,6 @@ and that we are using the high rank order.
 @<Compute ambiguity metric of ordering by high rank@> =
 {
     ANDID ** const and_node_orderings = o->t_and_node_orderings;
-    const AND and_nodes = ANDs_of_B (b);
     ORID* top_of_stack;
     const ORID root_or_id = Top_ORID_of_B (b);
     FSTACK_DECLARE(or_node_stack, ORID)@;
@@ -11507,9 +16743,11 @@ and that we are using the high rank order.
     while ((top_of_stack = FSTACK_POP (or_node_stack)))
     {
       const ORID or_id = *top_of_stack;
-      const OR or_node = OR_of_B_by_ID (b, or_id);
-      ANDID *ordering = and_node_orderings[or_id];
-      int and_count = ordering ? ordering[0] : AND_Count_of_OR (or_node);
+      ANDID *ordering;
+      int and_count;
+      order_or_node_expand (o, or_id);
+      ordering = and_node_orderings[or_id];
+      and_count = ordering ? ordering[0] : AND_Count_of_ORID (b, or_id);
       if (and_count > 1)
         {
           /* If there the and-node count is
@@ -11521,21 +16759,18 @@ and that we are using the high rank order.
           // ... and we are done
         }
       {
-        const ANDID and_id = ordering ? ordering[1] : First_ANDID_of_OR (or_node);
-        const AND and_node = and_nodes + and_id;
-        const OR predecessor_or = Predecessor_OR_of_AND (and_node);
-        const OR cause_or = Cause_OR_of_AND (and_node);
-        if (predecessor_or)
+        const ANDID and_id = ordering ? ordering[1] : First_ANDID_of_ORID (b, or_id);
+        const ORID predecessor_or_id = Predecessor_ORID_of_ANDID (b, and_id);
+        if (predecessor_or_id >= 0)
           {
-            const ORID predecessor_or_id = ID_of_OR (predecessor_or);
             if (!bv_bit_test_then_set (bv_orid_was_stacked, predecessor_or_id))
               {
                 *(FSTACK_PUSH (or_node_stack)) = predecessor_or_id;
               }
           }
-        if (cause_or && !OR_is_Token(cause_or))
+        if (!ANDID_is_Token (b, and_id))
           {
-            const ORID cause_or_id = ID_of_OR (cause_or);
+            const ORID cause_or_id = Cause_ORID_of_ANDID (b, and_id);
             if (!bv_bit_test_then_set (bv_orid_was_stacked, cause_or_id))
               {
                 *(FSTACK_PUSH (or_node_stack)) = cause_or_id;
@@ -11652,6 +16887,10 @@ int marpa_o_rank( Marpa_Order o)
       return failure_indicator;
     }
   @<Initialize |obs| and |and_node_orderings|@>@;
+  if (B_is_Lazy (b)) {
+    @<Rank the or-nodes of a lazy bocage as they are expanded@>@;
+    return 1;
+  }
   if (High_Rank_Count_of_O (o)) {
     @<Sort bocage for "high rank only"@>@;
   } else {
@@ -11668,25 +16907,23 @@ int marpa_o_rank( Marpa_Order o)
 
 @ @<Sort bocage for "high rank only"@> =
 {
-  const AND and_nodes = ANDs_of_B (b);
   const int or_node_count_of_b = OR_Count_of_B (b);
   int or_node_id = 0;
 
   while (or_node_id < or_node_count_of_b)
     {
-      const OR work_or_node = OR_of_B_by_ID(b, or_node_id);
-      const ANDID and_count_of_or = AND_Count_of_OR (work_or_node);
-        @<Sort |work_or_node| for "high rank only"@>@;
+      const ANDID and_count_of_or = AND_Count_of_ORID (b, or_node_id);
+        @<Sort |or_node_id| for "high rank only"@>@;
       or_node_id++;
     }
 }
 
-@ @<Sort |work_or_node| for "high rank only"@> =
+@ @<Sort |or_node_id| for "high rank only"@> =
 {
   if (and_count_of_or > 1)
     {
       int high_rank_so_far = INT_MIN;
-      const ANDID first_and_node_id = First_ANDID_of_OR (work_or_node);
+      const ANDID first_and_node_id = First_ANDID_of_ORID (b, or_node_id);
       const ANDID last_and_node_id =
         (first_and_node_id + and_count_of_or) - 1;
       ANDID *const order_base =
@@ -11699,9 +16936,8 @@ int marpa_o_rank( Marpa_Order o)
       for (and_node_id = first_and_node_id; and_node_id <= last_and_node_id;
            and_node_id++)
         {
-          const AND and_node = and_nodes + and_node_id;
           int and_node_rank;
-          @<Set |and_node_rank| from |and_node|@>@;
+          @<Set |and_node_rank| from |and_node_id|@>@;
           if (and_node_rank > high_rank_so_far)
             {
               order = order_base + 1;
@@ -11711,7 +16947,7 @@ int marpa_o_rank( Marpa_Order o)
             *order++ = and_node_id;
         }
       {
-        int final_count = (order - order_base) - 1;
+        int final_count = (int) (order - order_base) - 1;
         *order_base = final_count;
         marpa_obs_confirm_fast (obs, (int)sizeof (ANDID) * (final_count + 1));
         and_node_orderings[or_node_id] = marpa_obs_finish (obs);
@@ -11719,20 +16955,19 @@ int marpa_o_rank( Marpa_Order o)
     }
 }
 
-@ @<Set |and_node_rank| from |and_node|@> =
+@ @<Set |and_node_rank| from |and_node_id|@> =
 {
-    const OR cause_or = Cause_OR_of_AND (and_node);
-    if (OR_is_Token(cause_or)) {
-       const NSYID nsy_id = NSYID_of_OR(cause_or);
+    if (ANDID_is_Token (b, and_node_id)) {
+       const NSYID nsy_id = NSYID_of_ANDID (b, and_node_id);
        and_node_rank = Rank_of_NSY(NSY_by_ID(nsy_id));
     } else {
-       and_node_rank = Rank_of_IRL(IRL_of_OR(cause_or));
+       const ORID cause_or_id = Cause_ORID_of_ANDID (b, and_node_id);
+       and_node_rank = Rank_of_IRL(IRL_of_ORID(b, cause_or_id));
     }
 }
 
 @ @<Sort bocage for "rank by rule"@> =
 {
-  const AND and_nodes = ANDs_of_B (b);
   const int or_node_count_of_b = OR_Count_of_B (b);
   const int and_node_count_of_b = AND_Count_of_B (b);
   int or_node_id = 0;
@@ -11740,16 +16975,16 @@ int marpa_o_rank( Marpa_Order o)
   int and_node_id;
   for (and_node_id = 0; and_node_id < and_node_count_of_b; and_node_id++)
     {
-      const AND and_node = and_nodes + and_node_id;
       int and_node_rank;
-      @<Set |and_node_rank| from |and_node|@>@;
+      @<Set |and_node_rank| from |and_node_id|@>@;
       rank_by_and_id[and_node_id] = and_node_rank;
     }
   while (or_node_id < or_node_count_of_b)
     {
-      const OR work_or_node = OR_of_B_by_ID(b, or_node_id);
-      const ANDID and_count_of_or = AND_Count_of_OR (work_or_node);
-        @<Sort |work_or_node| for "rank by rule"@>@;
+      const ANDID and_count_of_or = AND_Count_of_ORID (b, or_node_id);
+      const int *const and_node_ranks =
+        rank_by_and_id + First_ANDID_of_ORID (b, or_node_id);
+        @<Sort |or_node_id| for "rank by rule"@>@;
       or_node_id++;
     }
    my_free(rank_by_and_id);
@@ -11759,6 +16994,8 @@ int marpa_o_rank( Marpa_Order o)
 $O(n^2)$.
 The average case (and the root mean square case) in practice
 will be small number, and this is probably optimal in those terms.
+|and_node_ranks| are the ranks of the and-nodes of |or_node_id|,
+by their index within the or-node.
 Note that none of my complexity claims includes the ranking of
 ambiguous parses -- that is ``extra''.
 \par
@@ -11775,11 +17012,11 @@ and in that sense the space is ``free''.
 And third, computationally, pre-computing
 the and-node ranks is fast and easy, so I am gaining real speed
 and code-size savings in exchange for the space.
-@<Sort |work_or_node| for "rank by rule"@> =
+@<Sort |or_node_id| for "rank by rule"@> =
 {
   if (and_count_of_or > 1)
     {
-      const ANDID first_and_node_id = First_ANDID_of_OR (work_or_node);
+      const ANDID first_and_node_id = First_ANDID_of_ORID (b, or_node_id);
       ANDID *const order_base =
         marpa_obs_new (obs, ANDID, and_count_of_or + 1);
       ANDID *order = order_base + 1;
@@ -11795,8 +17032,8 @@ and code-size savings in exchange for the space.
           int pre_insertion_ix = nodes_inserted_so_far - 1;
           while (pre_insertion_ix >= 0)
             {
-              if (rank_by_and_id[new_and_node_id] <=
-                  rank_by_and_id[order[pre_insertion_ix]])
+              if (and_node_ranks[nodes_inserted_so_far] <=
+                  and_node_ranks[order[pre_insertion_ix] - first_and_node_id])
                 break;
               order[pre_insertion_ix + 1] = order[pre_insertion_ix];
               pre_insertion_ix--;
@@ -11806,31 +17043,100 @@ and code-size savings in exchange for the space.
     }
 }
 
-@ @<Initialize |obs| and |and_node_orderings|@> =
+@ The orderings are indexed by or-node ID.
+@<Initialize |obs| and |and_node_orderings|@> =
 {
-  int and_id;
-  const int and_count_of_r = AND_Count_of_B (b);
+  ORID or_id;
+  const int or_count_of_b = OR_Count_of_B (b);
   obs = OBS_of_O (o) = marpa_obs_init;
   o->t_and_node_orderings =
     and_node_orderings =
-    marpa_obs_new (obs, ANDID*, and_count_of_r);
-  for (and_id = 0; and_id < and_count_of_r; and_id++)
+    marpa_obs_new (obs, ANDID*, or_count_of_b);
+  for (or_id = 0; or_id < or_count_of_b; or_id++)
+    {
+      and_node_orderings[or_id] = (ANDID *) NULL;
+    }
+}
+
+@ The or-nodes of a lazy bocage are ranked
+the first time their and-nodes are needed,
+using the obstack of the ordering.
+@d Ranked_BV_of_O(o) ((o)->t_or_node_is_ranked)
+@<Widely aligned order elements@> =
+    Bit_Vector t_or_node_is_ranked;
+@ @<Pre-initialize order elements@> =
+    Ranked_BV_of_O(o) = NULL;
+@ @<Rank the or-nodes of a lazy bocage as they are expanded@> =
+{
+  Ranked_BV_of_O (o) = bv_create (OR_Count_of_B (b));
+  O_is_Frozen (o) = 1;
+}
+
+@ Rank one or-node of a lazy bocage.
+Returns 1 if the or-node was given an ordering, 0 otherwise.
+@<Function definitions@> =
+PRIVATE int
+or_node_rank (ORDER o, ORID or_node_id)
+{
+  const BOCAGE b = B_of_O (o);
+  const GRAMMAR g = G_of_B (b);
+  ANDID **const and_node_orderings = o->t_and_node_orderings;
+  struct marpa_obstack *const obs = OBS_of_O (o);
+  const ANDID and_count_of_or = AND_Count_of_ORID (b, or_node_id);
+  int bocage_was_reordered = 0;
+  if (High_Rank_Count_of_O (o))
+    {
+      @<Sort |or_node_id| for "high rank only"@>@;
+      return bocage_was_reordered;
+    }
+  if (and_count_of_or > 1)
     {
-      and_node_orderings[and_id] = (ANDID *) NULL;
+      int *const and_node_ranks = marpa_new (int, and_count_of_or);
+      int and_ix;
+      for (and_ix = 0; and_ix < and_count_of_or; and_ix++)
+        {
+          const ANDID and_node_id =
+            First_ANDID_of_ORID (b, or_node_id) + and_ix;
+          int and_node_rank;
+          @<Set |and_node_rank| from |and_node_id|@>@;
+          and_node_ranks[and_ix] = and_node_rank;
+        }
+      @<Sort |or_node_id| for "rank by rule"@>@;
+      my_free (and_node_ranks);
     }
+  return bocage_was_reordered;
+}
+
+@ Make sure that the and-nodes of |or_node_id| exist,
+and, if |o| ranks a lazy bocage, that they are ranked.
+Every use of the and-nodes of an or-node by an ordering,
+or by a tree, is preceded by a call to this function.
+For a bocage which is not lazy,
+it does nothing.
+@<Function definitions@> =
+PRIVATE void
+order_or_node_expand (ORDER o, ORID or_node_id)
+{
+  const BOCAGE b = B_of_O (o);
+  if (_MARPA_UNLIKELY (!OR_is_Expanded_in_B (b, or_node_id)))
+    or_node_expand (b, or_node_id);
+  if (_MARPA_UNLIKELY (Ranked_BV_of_O (o) != NULL)
+      && !bv_bit_test_then_set (Ranked_BV_of_O (o), or_node_id))
+    or_node_rank (o, or_node_id);
 }
 
 @
 Check that |ix| is the index of a valid and-node
-in |or_node|.
+in the or-node |or_node_id|.
 @<Function definitions@> =
-PRIVATE ANDID and_order_ix_is_valid(ORDER o, OR or_node, int ix)
+PRIVATE ANDID and_order_ix_is_valid(ORDER o, ORID or_node_id, int ix)
 {
-  if (ix >= AND_Count_of_OR (or_node)) return 0;
+  const BOCAGE b = B_of_O (o);
+  order_or_node_expand (o, or_node_id);
+  if (ix >= AND_Count_of_ORID (b, or_node_id)) return 0;
   if (!O_is_Default(o))
     {
       ANDID ** const and_node_orderings = o->t_and_node_orderings;
-      ORID or_node_id = ID_of_OR(or_node);
       ANDID *ordering = and_node_orderings[or_node_id];
       if (ordering)
         {
@@ -11845,35 +17151,33 @@ PRIVATE ANDID and_order_ix_is_valid(ORDER o, OR or_node, int ix)
 It is up to the caller to ensure that |ix|
 is valid.
 @<Function definitions@> =
-PRIVATE ANDID and_order_get(ORDER o, OR or_node, int ix)
+PRIVATE ANDID and_order_get(ORDER o, ORID or_node_id, int ix)
 {
   if (!O_is_Default(o))
     {
       ANDID ** const and_node_orderings = o->t_and_node_orderings;
-      ORID or_node_id = ID_of_OR (or_node);
       ANDID *ordering = and_node_orderings[or_node_id];
       if (ordering)
         return ordering[1 + ix];
     }
-  return First_ANDID_of_OR (or_node) + ix;
+  return First_ANDID_of_ORID (B_of_O (o), or_node_id) + ix;
 }
 
 @ @<Function definitions@> =
 Marpa_And_Node_ID _marpa_o_and_order_get(Marpa_Order o,
     Marpa_Or_Node_ID or_node_id, int ix)
 {
-    OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack order objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
+  @<Fail if |b| has no or-nodes@>@;
   if (ix < 0) {
       MARPA_ERROR(MARPA_ERR_ANDIX_NEGATIVE);
       return failure_indicator;
   }
-    if (!and_order_ix_is_valid(o, or_node, ix)) return -1;
-    return and_order_get(o, or_node, ix);
+    if (!and_order_ix_is_valid(o, or_node_id, ix)) return -1;
+    return and_order_get(o, or_node_id, ix);
 }
 
 @** Parse tree (T, TREE) code.
@@ -11954,7 +17258,9 @@ Marpa_Tree marpa_t_new(Marpa_Order o)
     return t;
 }
 
-@ @<Initialize tree elements@> =
+@ An or-node is on the nook stack at most once,
+so that the stacks are sized by the or-node count.
+@<Initialize tree elements@> =
 {
   t->t_parse_count = 0;
   if (O_is_Nulling (o))
@@ -11966,12 +17272,11 @@ Marpa_Tree marpa_t_new(Marpa_Order o)
     }
   else
     {
-      const int and_count = AND_Count_of_B (b);
       const int or_count = OR_Count_of_B (b);
       T_is_Nulling (t) = 0;
       t->t_or_node_in_use = bv_create (or_count);
-      FSTACK_INIT (t->t_nook_stack, NOOK_Object, and_count);
-      FSTACK_INIT (t->t_nook_worklist, int, and_count);
+      FSTACK_INIT (t->t_nook_stack, NOOK_Object, or_count);
+      FSTACK_INIT (t->t_nook_worklist, int, or_count);
     }
 }
 
@@ -12106,7 +17411,6 @@ int marpa_t_next(Marpa_Tree t)
     }
 
     while (1) {
-      const AND ands_of_b = ANDs_of_B(b);
       if (is_first_tree_attempt) {
          is_first_tree_attempt = 0;
          @<Initialize the tree iterator@>@;
@@ -12162,17 +17466,16 @@ PRIVATE void tree_or_node_release(TREE tree, ORID or_node_id)
 @<Initialize the tree iterator@> =
 {
   ORID root_or_id = Top_ORID_of_B (b);
-  OR root_or_node = OR_of_B_by_ID (b, root_or_id);
   NOOK nook;
   /* Due to skipping, it is possible for even
     the top or-node to have no valid choices,
     in which case there is no parse */
   const int choice = 0;
-  if (!and_order_ix_is_valid(o, root_or_node, choice))
+  if (!and_order_ix_is_valid(o, root_or_id, choice))
     goto TREE_IS_EXHAUSTED;
   nook = FSTACK_PUSH (t->t_nook_stack);
   tree_or_node_try(t, root_or_id); /* Empty stack, so cannot fail */
-  OR_of_NOOK (nook) = root_or_node;
+  ORID_of_NOOK (nook) = root_or_id;
   Choice_of_NOOK (nook) = choice;
   Parent_of_NOOK (nook) = -1;
   NOOK_Cause_is_Expanded (nook) = 0;
@@ -12186,14 +17489,14 @@ If there is one, set it to the next choice.
 Otherwise, the tree is exhausted.
 @<Start a new iteration of the tree@> = {
     while (1) {
-        OR iteration_candidate_or_node;
+        ORID iteration_candidate_or_node_id;
         const NOOK iteration_candidate = FSTACK_TOP(t->t_nook_stack, NOOK_Object);
         int choice;
         if (!iteration_candidate) break;
-        iteration_candidate_or_node = OR_of_NOOK(iteration_candidate);
+        iteration_candidate_or_node_id = ORID_of_NOOK(iteration_candidate);
         choice = Choice_of_NOOK(iteration_candidate) + 1;
         MARPA_ASSERT(choice > 0);
-        if (and_order_ix_is_valid(o, iteration_candidate_or_node, choice)) {
+        if (and_order_ix_is_valid(o, iteration_candidate_or_node_id, choice)) {
             /* We have found a nook we can iterate.
                 Set the new choice,
                 dirty the child bits in the current working nook,
@@ -12219,7 +17522,7 @@ Otherwise, the tree is exhausted.
             }
 
             /* Continue with the next item on the stack */
-            tree_or_node_release(t, ID_of_OR(iteration_candidate_or_node));
+            tree_or_node_release(t, iteration_candidate_or_node_id);
             FSTACK_POP(t->t_nook_stack);
         }
     }
@@ -12241,26 +17544,23 @@ Otherwise, the tree is exhausted.
         NOOKID* p_work_nook_id;
         NOOK work_nook;
         ANDID work_and_node_id;
-        AND work_and_node;
-        OR work_or_node;
-        OR child_or_node = NULL;
+        ORID work_or_node_id;
+        ORID child_or_node_id = -1;
         int choice;
         int child_is_cause = 0;
         int child_is_predecessor = 0;
         if (FSTACK_LENGTH(t->t_nook_worklist) <= 0) { goto TREE_IS_FINISHED; }
         p_work_nook_id = FSTACK_TOP(t->t_nook_worklist, NOOKID);
         work_nook = NOOK_of_TREE_by_IX(t, *p_work_nook_id);
-        work_or_node = OR_of_NOOK(work_nook);
-        work_and_node_id = and_order_get(o, work_or_node, Choice_of_NOOK(work_nook));
-        work_and_node = ands_of_b + work_and_node_id;
+        work_or_node_id = ORID_of_NOOK(work_nook);
+        work_and_node_id = and_order_get(o, work_or_node_id, Choice_of_NOOK(work_nook));
         do
           {
             if (!NOOK_Cause_is_Expanded (work_nook))
               {
-                const OR cause_or_node = Cause_OR_of_AND (work_and_node);
-                if (!OR_is_Token (cause_or_node))
+                if (!ANDID_is_Token (b, work_and_node_id))
                   {
-                    child_or_node = cause_or_node;
+                    child_or_node_id = Cause_ORID_of_ANDID (b, work_and_node_id);
                     child_is_cause = 1;
                     break;
                   }
@@ -12268,8 +17568,9 @@ Otherwise, the tree is exhausted.
             NOOK_Cause_is_Expanded (work_nook) = 1;
             if (!NOOK_Predecessor_is_Expanded (work_nook))
               {
-                child_or_node = Predecessor_OR_of_AND (work_and_node);
-                if (child_or_node)
+                child_or_node_id =
+                  Predecessor_ORID_of_ANDID (b, work_and_node_id);
+                if (child_or_node_id >= 0)
                   {
                     child_is_predecessor = 1;
                     break;
@@ -12280,9 +17581,9 @@ Otherwise, the tree is exhausted.
             goto NEXT_NOOK_ON_WORKLIST;
           }
         while (0);
-        if (!tree_or_node_try(t, ID_of_OR(child_or_node))) goto NEXT_TREE;
+        if (!tree_or_node_try(t, child_or_node_id)) goto NEXT_TREE;
         choice = 0;
-        if (!and_order_ix_is_valid(o, child_or_node, choice)) goto NEXT_TREE;
+        if (!and_order_ix_is_valid(o, child_or_node_id, choice)) goto NEXT_TREE;
         @<Add new nook to tree@>;
         NEXT_NOOK_ON_WORKLIST: ;
     }
@@ -12296,7 +17597,7 @@ Otherwise, the tree is exhausted.
   *(FSTACK_PUSH (t->t_nook_worklist)) = new_nook_id;
   Parent_of_NOOK (new_nook) = *p_work_nook_id;
   Choice_of_NOOK (new_nook) = choice;
-  OR_of_NOOK (new_nook) = child_or_node;
+  ORID_of_NOOK (new_nook) = child_or_node_id;
   NOOK_Cause_is_Expanded (new_nook) = 0;
   if ((NOOK_is_Cause (new_nook) = Boolean (child_is_cause)))
     {
@@ -12342,7 +17643,7 @@ typedef Marpa_Nook_ID NOOKID;
 @<Private incomplete structures@> =
 struct s_nook;
 typedef struct s_nook* NOOK;
-@ @d OR_of_NOOK(nook) ((nook)->t_or_node)
+@ @d ORID_of_NOOK(nook) ((nook)->t_or_node_id)
 @d Choice_of_NOOK(nook) ((nook)->t_choice)
 @d Parent_of_NOOK(nook) ((nook)->t_parent)
 @d NOOK_Cause_is_Expanded(nook) ((nook)->t_is_cause_ready)
@@ -12352,7 +17653,7 @@ typedef struct s_nook* NOOK;
 @s NOOK_Object int
 @<NOOK structure@> =
 struct s_nook {
-    OR t_or_node;
+    ORID t_or_node_id;
     int t_choice;
     NOOKID t_parent;
     BITFIELD t_is_cause_ready:1;
@@ -12395,13 +17696,18 @@ of symbols in the
 original (or "virtual") rules.
 This enables libmarpa to make the rewriting of
 the grammar invisible to the semantics.
+A valuator created with |marpa_r_value_unambiguous|
+has no tree.
+It steps through its own stack of direct nooks instead.
 @d Next_Value_Type_of_V(val) ((val)->t_next_value_type)
 @d V_is_Active(val) (Next_Value_Type_of_V(val) != MARPA_STEP_INACTIVE)
 @d T_of_V(v) ((v)->t_tree)
+@d G_of_V(v) ((v)->t_grammar)
 @ @<VALUE structure@> =
 struct s_value {
     struct marpa_value public;
     Marpa_Tree t_tree;
+    GRAMMAR t_grammar;
     @<Widely aligned value elements@>@;
     @<Int aligned value elements@>@;
     int t_token_type;
@@ -12535,39 +17841,487 @@ stack reallocations is $O(1)$.
     }
 }
 
-@*0 Valuator constructor.
+@*0 Valuator constructor.
+@<Function definitions@> =
+Marpa_Value marpa_v_new(Marpa_Tree t)
+{
+    @<Return |NULL| on failure@>@;
+    @<Unpack tree objects@>;
+    @<Fail if fatal error@>@;
+    if (t->t_parse_count <= 0) {
+      MARPA_ERROR(MARPA_ERR_BEFORE_FIRST_TREE);
+      return NULL;
+    }
+    if (!T_is_Exhausted (t))
+      {
+        const XSYID xsy_count = XSY_Count_of_G (g);
+        struct marpa_obstack* const obstack = marpa_obs_init;
+        const VALUE v = marpa_obs_new (obstack, struct s_value, 1);
+        const LBV valued_bv = Valued_BV_of_B (b);
+        const LBV valued_locked_bv = Valued_Locked_BV_of_B (b);
+        v->t_obs = obstack;
+        Step_Type_of_V (v) = Next_Value_Type_of_V (v) = MARPA_STEP_INITIAL;
+        @<Initialize value elements@>@;
+        tree_pause (t);
+        T_of_V(v) = t;
+        if (T_is_Nulling(o)) {
+          V_is_Nulling(v) = 1;
+        } else {
+          const int minimum_stack_size = (8192 / sizeof (int));
+          const int initial_stack_size =
+            MAX (Size_of_TREE (t) / 1024, minimum_stack_size);
+          MARPA_DSTACK_INIT (VStack_of_V (v), int, initial_stack_size);
+        }
+        return (Marpa_Value)v;
+      }
+    MARPA_ERROR(MARPA_ERR_TREE_EXHAUSTED);
+    return NULL;
+}
+
+@*0 Valuing an unambiguous parse directly.
+When a parse is unambiguous,
+each of its or-nodes has exactly one and-node,
+and the bocage, the order and the tree
+all describe the one parse tree.
+|marpa_r_value_unambiguous| creates a valuator for that tree
+straight from the Earley sets,
+without creating any of them.
+It walks the source links down from the start Earley item,
+and, for every or-node that the tree would contain,
+records the data that the evaluation steps read.
+These records are the {\it direct nooks}.
+They are kept in the order of the nooks of the tree,
+so that a valuator of direct nooks steps through
+exactly the same steps as a valuator of the tree.
+@ The walk reproduces the or-nodes made by the bocage.
+Each Earley item has a chain of or-nodes:
+its main or-node, if it has one,
+followed by one or-node for each of its leading nulls.
+Predictions have no main or-node,
+and only predictions with leading nulls have or-nodes at all.
+A Leo source stands in for a Leo path,
+and each Leo path item below the top one
+has a chain of or-nodes like that of an Earley item.
+@ If an Earley item in the walk has other than exactly one
+active source,
+the walk is abandoned and the valuator is created by way
+of a bocage, an order and a tree,
+exactly as the application would have done.
+So are nulling parses,
+and everything which is an error for the bocage,
+so that the errors are reported as they always were.
+@<Private incomplete structures@> =
+struct s_direct_nook;
+typedef struct s_direct_nook* DNOOK;
+@ @d IRL_of_DNOOK(dnook) ((dnook)->t_irl)
+@d Position_of_DNOOK(dnook) ((dnook)->t_position)
+@d Origin_Ord_of_DNOOK(dnook) ((dnook)->t_start_set_ordinal)
+@d YS_Ord_of_DNOOK(dnook) ((dnook)->t_end_set_ordinal)
+@d Token_NSYID_of_DNOOK(dnook) ((dnook)->t_token_nsyid)
+@d Token_Type_of_DNOOK(dnook) ((dnook)->t_token_type)
+@d Token_Value_of_DNOOK(dnook) ((dnook)->t_token_value)
+@d Token_Start_of_DNOOK(dnook) ((dnook)->t_token_start_set_ordinal)
+@s DNOOK_Object int
+@<Private structures@> =
+struct s_direct_nook {
+    IRL t_irl;
+    int t_position;
+    YSID t_start_set_ordinal;
+    YSID t_end_set_ordinal;
+    NSYID t_token_nsyid;
+    int t_token_type;
+    int t_token_value;
+    YSID t_token_start_set_ordinal;
+};
+typedef struct s_direct_nook DNOOK_Object;
+
+@ A valuator has either a tree or direct nooks.
+@d DNOOKs_of_V(v) ((v)->t_direct_nooks)
+@d DNOOK_of_V_by_IX(v, ix)
+  MARPA_DSTACK_INDEX(DNOOKs_of_V(v), DNOOK_Object, (ix))
+@d Size_of_V(v) (T_of_V(v) ? Size_of_TREE(T_of_V(v))
+  : MARPA_DSTACK_LENGTH(DNOOKs_of_V(v)))
+@<Widely aligned value elements@> =
+    MARPA_DSTACK_DECLARE(t_direct_nooks);
+@ @<Initialize value elements@> =
+    MARPA_DSTACK_SAFE(DNOOKs_of_V(v));
+@ @<Destroy value elements@> =
+{
+    if (MARPA_DSTACK_IS_INITIALIZED(DNOOKs_of_V(v)))
+    {
+        MARPA_DSTACK_DESTROY(DNOOKs_of_V(v));
+    }
+}
+
+@ @<Function definitions@> =
+Marpa_Value
+marpa_r_value_unambiguous (Marpa_Recognizer r,
+    Marpa_Earley_Set_ID ordinal_arg)
+{
+    @<Return |NULL| on failure@>@;
+    const GRAMMAR g = G_of_R(r);
+    YS end_of_parse_earley_set;
+    JEARLEME end_of_parse_earleme;
+    YIM start_yim = NULL;
+    VALUE v;
+    @<Fail if recognizer has a fatal error@>@;
+    if (_MARPA_UNLIKELY( ordinal_arg <= -2 ))
+    {
+        MARPA_R_ERROR(MARPA_ERR_INVALID_LOCATION);
+        return failure_indicator;
+    }
+    @<Fail if recognizer not started@>@;
+    if (G_is_Trivial(g)) goto NOT_DIRECT;
+    r_update_earley_sets(r);
+    @<Set |end_of_parse_earley_set| and |end_of_parse_earleme|@>@;
+    if (end_of_parse_earleme == 0) goto NOT_DIRECT;
+    @<Find |start_yim|@>@;
+    if (!start_yim) goto NOT_DIRECT;
+    v = direct_value_new (r, start_yim);
+    if (v) return (Marpa_Value)v;
+    NO_PARSE: ;
+    NOT_DIRECT: ;
+    return (Marpa_Value)bocage_value_new (r, ordinal_arg);
+}
+
+@ Create the valuator of the first tree of a new bocage,
+with the default order.
+The valuator holds the only references to the other objects,
+so that they go away with it.
+@<Function definitions@> =
+PRIVATE VALUE
+bocage_value_new (RECCE r, YSID ordinal_arg)
+{
+  VALUE v = NULL;
+  ORDER o;
+  TREE t = NULL;
+  const BOCAGE b = marpa_b_new (r, ordinal_arg);
+  if (!b)
+    return NULL;
+  o = marpa_o_new (b);
+  if (o)
+    t = marpa_t_new (o);
+  if (t && marpa_t_next (t) >= 0)
+    v = (VALUE) marpa_v_new (t);
+  if (t)
+    tree_unref (t);
+  if (o)
+    order_unref (o);
+  bocage_unref (b);
+  return v;
+}
+
+@ Returns |NULL| if the parse is not unambiguous.
+@<Function definitions@> =
+PRIVATE VALUE
+direct_value_new (RECCE r, YIM start_yim)
+{
+  const GRAMMAR g = G_of_R (r);
+  const XSYID xsy_count = XSY_Count_of_G (g);
+  const LBV valued_bv = r->t_valued;
+  const LBV valued_locked_bv = r->t_valued_locked;
+  struct marpa_obstack *const obstack = marpa_obs_init;
+  const VALUE v = marpa_obs_new (obstack, struct s_value, 1);
+  v->t_obs = obstack;
+  Step_Type_of_V (v) = Next_Value_Type_of_V (v) = MARPA_STEP_INITIAL;
+  @<Initialize value elements@>@;
+  T_of_V (v) = NULL;
+  MARPA_DSTACK_INIT (DNOOKs_of_V (v), DNOOK_Object, 1024);
+  if (!direct_nooks_create (v, r, start_yim))
+    {
+      value_free (v);
+      return NULL;
+    }
+  {
+    const int minimum_stack_size = (8192 / sizeof (int));
+    const int initial_stack_size =
+      MAX (Size_of_V (v) / 1024, minimum_stack_size);
+    MARPA_DSTACK_INIT (VStack_of_V (v), int, initial_stack_size);
+  }
+  return v;
+}
+
+@ The work stack holds the or-nodes still to be recorded.
+Each is the or-node at |t_chain_ix| in a chain of or-nodes.
+For the chain of an Earley item, |t_yim| is that Earley item,
+and |t_leo_level| is $-1$.
+For the chain of a Leo path item,
+|t_lim_ix| is the index of its LIM on the LIM stack,
+|t_leo_level| is its distance from the bottom of the Leo path,
+and |t_yim| is the cause of the Leo source.
+@<Private structures@> =
+struct s_direct_work {
+    AHM t_ahm;
+    YIM t_yim;
+    YSID t_start_set_ordinal;
+    YSID t_end_set_ordinal;
+    int t_chain_ix;
+    int t_lim_ix;
+    int t_leo_level;
+};
+
+@ The tree is traversed with the cause before the predecessor,
+and each or-node before both,
+so that the predecessor is pushed onto the work stack first.
+@<Function definitions@> =
+PRIVATE int
+direct_nooks_create (VALUE v, RECCE r, YIM start_yim)
+{
+  const GRAMMAR g = G_of_R (r);
+  struct s_direct_work *work;
+  MARPA_DSTACK_DECLARE (work_stack);
+  MARPA_DSTACK_DECLARE (lim_stack);
+  MARPA_DSTACK_INIT (work_stack, struct s_direct_work, 1024);
+  MARPA_DSTACK_INIT (lim_stack, LIM, 64);
+  direct_work_of_yim (g,
+                      MARPA_DSTACK_PUSH (work_stack, struct s_direct_work),
+                      start_yim);
+  while ((work = MARPA_DSTACK_POP (work_stack, struct s_direct_work)))
+    {
+      @t}\comment{@>
+      /* A copy, because the pushes below may overwrite |*work| */
+      const struct s_direct_work this_work = *work;
+      const DNOOK dnook = MARPA_DSTACK_PUSH (DNOOKs_of_V (v), DNOOK_Object);
+      const AHM ahm = this_work.t_ahm;
+      const IRL irl = IRL_of_AHM (ahm);
+      const SYMI main_symbol_instance = SYMI_of_AHM (ahm);
+      const int null_ix =
+        this_work.t_chain_ix - (main_symbol_instance >= 0 ? 1 : 0);
+      IRL_of_DNOOK (dnook) = irl;
+      Origin_Ord_of_DNOOK (dnook) = this_work.t_start_set_ordinal;
+      YS_Ord_of_DNOOK (dnook) = this_work.t_end_set_ordinal;
+      Token_NSYID_of_DNOOK (dnook) = -1;
+      Token_Type_of_DNOOK (dnook) = DUMMY_OR_NODE;
+      Token_Value_of_DNOOK (dnook) = -1;
+      Token_Start_of_DNOOK (dnook) = -1;
+      if (null_ix >= 0)
+        {
+          @<Set |dnook| from a nulling or-node@>@;
+          continue;
+        }
+      Position_of_DNOOK (dnook) =
+        main_symbol_instance - SYMI_of_IRL (irl) + 1;
+      if (this_work.t_leo_level >= 0)
+        {
+          @<Set |dnook| from a Leo path or-node@>@;
+          continue;
+        }
+      @<Set |dnook| from the source of its Earley item@>@;
+    }
+  MARPA_DSTACK_DESTROY (work_stack);
+  MARPA_DSTACK_DESTROY (lim_stack);
+  return 1;
+  NOT_UNAMBIGUOUS: ;
+  MARPA_DSTACK_DESTROY (work_stack);
+  MARPA_DSTACK_DESTROY (lim_stack);
+  return 0;
+}
+
+@ The or-node of a leading null has the null as its token,
+and the or-node before it in the chain, if any,
+as its predecessor.
+@<Set |dnook| from a nulling or-node@> =
+{
+  const SYMI symbol_instance =
+    (main_symbol_instance >= 0 ? main_symbol_instance + 1 : SYMI_of_IRL (irl))
+    + null_ix;
+  const int rhs_ix = symbol_instance - SYMI_of_IRL (irl);
+  Position_of_DNOOK (dnook) = rhs_ix + 1;
+  Token_NSYID_of_DNOOK (dnook) = RHSID_of_IRL (irl, rhs_ix);
+  Token_Type_of_DNOOK (dnook) = NULLING_TOKEN_OR_NODE;
+  if (this_work.t_chain_ix > 0)
+    {
+      struct s_direct_work *const predecessor_work =
+        MARPA_DSTACK_PUSH (work_stack, struct s_direct_work);
+      *predecessor_work = this_work;
+      predecessor_work->t_chain_ix--;
+    }
+}
+
+@ @<Set |dnook| from the source of its Earley item@> =
+{
+  const YIM work_earley_item = this_work.t_yim;
+  SRCL source_link = NULL;
+  unsigned int source_type = NO_SOURCE;
+  int source_count = 0;
+  SRCL link;
+  for (link = First_Token_SRCL_of_YIM (work_earley_item); link;
+       link = Next_SRCL_of_SRCL (link))
+    {
+      if (!SRCL_is_Active (link)) continue;
+      source_count++;
+      source_link = link;
+      source_type = SOURCE_IS_TOKEN;
+    }
+  for (link = First_Completion_SRCL_of_YIM (work_earley_item); link;
+       link = Next_SRCL_of_SRCL (link))
+    {
+      if (!SRCL_is_Active (link)) continue;
+      source_count++;
+      source_link = link;
+      source_type = SOURCE_IS_COMPLETION;
+    }
+  for (link = First_Leo_SRCL_of_YIM (work_earley_item); link;
+       link = Next_SRCL_of_SRCL (link))
+    {
+      if (!SRCL_is_Active (link)) continue;
+      source_count++;
+      source_link = link;
+      source_type = SOURCE_IS_LEO;
+    }
+  if (source_count != 1)
+    goto NOT_UNAMBIGUOUS;
+  switch (source_type)
+    {
+    case SOURCE_IS_TOKEN:
+      @<Set |dnook| from a token source@>@;
+      break;
+    case SOURCE_IS_COMPLETION:
+      {
+        const YIM predecessor = Predecessor_of_SRCL (source_link);
+        if (predecessor && YIM_has_OR_Nodes (predecessor))
+          direct_work_of_yim (g, MARPA_DSTACK_PUSH
+                              (work_stack, struct s_direct_work),
+                              predecessor);
+        direct_work_of_yim (g, MARPA_DSTACK_PUSH
+                            (work_stack, struct s_direct_work),
+                            Cause_of_SRCL (source_link));
+      }
+      break;
+    default:
+      @<Set |dnook| from a Leo source@>@;
+    }
+}
+
+@ The token type is determined in the same way as
+for the and-nodes of a bocage.
+@<Set |dnook| from a token source@> =
+{
+  const NSYID token_nsyid = NSYID_of_SRCL (source_link);
+  const YIM predecessor = Predecessor_of_SRCL (source_link);
+  Token_NSYID_of_DNOOK (dnook) = token_nsyid;
+  Token_Type_of_DNOOK (dnook) =
+    NSY_is_Nulling (NSY_by_ID (token_nsyid)) ? NULLING_TOKEN_OR_NODE
+    : lbv_bit_test (r->t_valued, Source_XSYID_of_NSYID (token_nsyid)) ?
+    VALUED_TOKEN_OR_NODE : UNVALUED_TOKEN_OR_NODE;
+  Token_Value_of_DNOOK (dnook) = Value_of_SRCL (source_link);
+  Token_Start_of_DNOOK (dnook) = this_work.t_start_set_ordinal;
+  if (predecessor && YIM_has_OR_Nodes (predecessor))
+    {
+      Token_Start_of_DNOOK (dnook) = YS_Ord_of_YIM (predecessor);
+      direct_work_of_yim (g,
+                          MARPA_DSTACK_PUSH (work_stack, struct s_direct_work),
+                          predecessor);
+    }
+}
+
+@ The LIMs of the Leo path are put on the LIM stack,
+from the bottom of the path up.
+The Earley item is the top of the Leo path.
+Its cause is the Leo path item just below it or,
+if there is none,
+the cause of the Leo source.
+@<Set |dnook| from a Leo source@> =
+{
+  const int first_lim_ix = MARPA_DSTACK_LENGTH (lim_stack);
+  int top_lim_ix;
+  LIM lim;
+  for (lim = LIM_of_SRCL (source_link); lim;
+       lim = Predecessor_LIM_of_LIM (lim))
+    {
+      *MARPA_DSTACK_PUSH (lim_stack, LIM) = lim;
+    }
+  top_lim_ix = MARPA_DSTACK_LENGTH (lim_stack) - 1;
+  if (top_lim_ix < first_lim_ix)
+    goto NOT_UNAMBIGUOUS;
+  {
+    const LIM top_lim = *MARPA_DSTACK_INDEX (lim_stack, LIM, top_lim_ix);
+    const YIM base_earley_item = Trailhead_YIM_of_LIM (top_lim);
+    if (YIM_has_OR_Nodes (base_earley_item))
+      direct_work_of_yim (g,
+                          MARPA_DSTACK_PUSH (work_stack, struct s_direct_work),
+                          base_earley_item);
+  }
+  if (top_lim_ix > first_lim_ix)
+    direct_work_of_leo_path_item (MARPA_DSTACK_PUSH
+                                  (work_stack, struct s_direct_work),
+                                  &lim_stack, top_lim_ix - 1,
+                                  top_lim_ix - 1 - first_lim_ix,
+                                  Cause_of_SRCL (source_link),
+                                  this_work.t_end_set_ordinal);
+  else
+    direct_work_of_yim (g,
+                        MARPA_DSTACK_PUSH (work_stack, struct s_direct_work),
+                        Cause_of_SRCL (source_link));
+}
+
+@ A Leo path item has the base of its LIM as its predecessor.
+Its cause is the Leo path item below it or,
+for the bottom item,
+the cause of the Leo source.
+@<Set |dnook| from a Leo path or-node@> =
+{
+  const LIM path_lim =
+    *MARPA_DSTACK_INDEX (lim_stack, LIM, this_work.t_lim_ix);
+  const YIM base_earley_item = Trailhead_YIM_of_LIM (path_lim);
+  if (YIM_has_OR_Nodes (base_earley_item))
+    direct_work_of_yim (g,
+                        MARPA_DSTACK_PUSH (work_stack, struct s_direct_work),
+                        base_earley_item);
+  if (this_work.t_leo_level > 0)
+    direct_work_of_leo_path_item (MARPA_DSTACK_PUSH
+                                  (work_stack, struct s_direct_work),
+                                  &lim_stack, this_work.t_lim_ix - 1,
+                                  this_work.t_leo_level - 1,
+                                  this_work.t_yim,
+                                  this_work.t_end_set_ordinal);
+  else
+    direct_work_of_yim (g,
+                        MARPA_DSTACK_PUSH (work_stack, struct s_direct_work),
+                        this_work.t_yim);
+}
+
+@ An Earley item has or-nodes unless its chain is empty,
+as it is for a prediction without leading nulls.
+The grammar is passed in because, in the compact layout,
+an Earley item finds its AHM through the grammar.
+@d YIM_has_OR_Nodes(yim) (SYMI_of_AHM(AHM_of_YIM(yim)) >= 0
+  || Null_Count_of_AHM(AHM_of_YIM(yim)) > 0)
 @<Function definitions@> =
-Marpa_Value marpa_v_new(Marpa_Tree t)
+PRIVATE void
+direct_work_of_yim (GRAMMAR g @,@, UNUSED, struct s_direct_work *work,
+  YIM yim)
 {
-    @<Return |NULL| on failure@>@;
-    @<Unpack tree objects@>;
-    @<Fail if fatal error@>@;
-    if (t->t_parse_count <= 0) {
-      MARPA_ERROR(MARPA_ERR_BEFORE_FIRST_TREE);
-      return NULL;
-    }
-    if (!T_is_Exhausted (t))
-      {
-        const XSYID xsy_count = XSY_Count_of_G (g);
-        struct marpa_obstack* const obstack = marpa_obs_init;
-        const VALUE v = marpa_obs_new (obstack, struct s_value, 1);
-        v->t_obs = obstack;
-        Step_Type_of_V (v) = Next_Value_Type_of_V (v) = MARPA_STEP_INITIAL;
-        @<Initialize value elements@>@;
-        tree_pause (t);
-        T_of_V(v) = t;
-        if (T_is_Nulling(o)) {
-          V_is_Nulling(v) = 1;
-        } else {
-          const int minimum_stack_size = (8192 / sizeof (int));
-          const int initial_stack_size =
-            MAX (Size_of_TREE (t) / 1024, minimum_stack_size);
-          MARPA_DSTACK_INIT (VStack_of_V (v), int, initial_stack_size);
-        }
-        return (Marpa_Value)v;
-      }
-    MARPA_ERROR(MARPA_ERR_TREE_EXHAUSTED);
-    return NULL;
+  const AHM ahm = AHM_of_YIM (yim);
+  work->t_ahm = ahm;
+  work->t_yim = yim;
+  work->t_start_set_ordinal = Origin_Ord_of_YIM (yim);
+  work->t_end_set_ordinal = YS_Ord_of_YIM (yim);
+  work->t_chain_ix =
+    (SYMI_of_AHM (ahm) >= 0 ? 1 : 0) + Null_Count_of_AHM (ahm) - 1;
+  work->t_lim_ix = -1;
+  work->t_leo_level = -1;
+}
+
+@ The Leo path item of a LIM starts at the Earley set
+of the LIM above it,
+and ends where the Leo source does.
+@<Function definitions@> =
+PRIVATE void
+direct_work_of_leo_path_item (struct s_direct_work *work,
+  MARPA_DSTACK lim_stack, int lim_ix, int leo_level,
+  YIM leo_cause, YSID end_set_ordinal)
+{
+  const LIM path_lim = *MARPA_DSTACK_INDEX (*lim_stack, LIM, lim_ix);
+  const LIM higher_lim = *MARPA_DSTACK_INDEX (*lim_stack, LIM, lim_ix + 1);
+  const AHM ahm = Trailhead_AHM_of_LIM (path_lim);
+  work->t_ahm = ahm;
+  work->t_yim = leo_cause;
+  work->t_start_set_ordinal = Ord_of_YS (YS_of_LIM (higher_lim));
+  work->t_end_set_ordinal = end_set_ordinal;
+  work->t_chain_ix = Null_Count_of_AHM (ahm);
+  work->t_lim_ix = lim_ix;
+  work->t_leo_level = leo_level;
 }
 
 @*0 Reference counting and destructors.
@@ -12612,14 +18366,22 @@ marpa_v_ref (Marpa_Value v)
 @ @<Function definitions@> =
 PRIVATE void value_free(VALUE v)
 {
-    tree_unpause(T_of_V(v));
+    if (T_of_V(v)) {
+        tree_unpause(T_of_V(v));
+    }
+    grammar_unref(G_of_V(v));
     @<Destroy value elements@>@;
     @<Destroy value obstack@>@;
 }
 
-@ @<Unpack value objects@> =
-    TREE t = T_of_V(v);
-    @<Unpack tree objects@>@;
+@ @<Initialize value elements@> =
+    G_of_V(v) = g;
+    grammar_ref(g);
+
+@ Only the evaluation steps need the tree,
+and a valuator may not have one.
+@<Unpack value objects@> =
+    const GRAMMAR g = G_of_V(v);
 
 @*0 Valuator is nulling?.
 Is this valuator for a nulling parse?
@@ -12672,6 +18434,18 @@ Marpa_Nook_ID _marpa_v_nook(Marpa_Value public_v)
     return NOOK_of_V(v);
 }
 
+@ Returns 1 if the valuator was created directly
+from the Earley sets, 0 if it has a tree.
+@<Function definitions@> =
+int _marpa_v_is_direct(Marpa_Value public_v)
+{
+    @<Return |-2| on failure@>@;
+    const VALUE v = (VALUE)public_v;
+    @<Unpack value objects@>@;
+    @<Fail if fatal error@>@;
+    return T_of_V(v) ? 0 : 1;
+}
+
 @*0 Symbol valued status.
 @ @d XSY_is_Valued_BV_of_V(v) ((v)->t_xsy_is_valued)
 @ @d XRL_is_Valued_BV_of_V(v) ((v)->t_xrl_is_valued)
@@ -12683,9 +18457,9 @@ Marpa_Nook_ID _marpa_v_nook(Marpa_Value public_v)
 
 @ @<Initialize value elements@> =
 {
-  XSY_is_Valued_BV_of_V (v) = lbv_clone (v->t_obs, Valued_BV_of_B (b), xsy_count);
+  XSY_is_Valued_BV_of_V (v) = lbv_clone (v->t_obs, valued_bv, xsy_count);
   Valued_Locked_BV_of_V (v) =
-    lbv_clone (v->t_obs, Valued_Locked_BV_of_B (b), xsy_count);
+    lbv_clone (v->t_obs, valued_locked_bv, xsy_count);
 }
 
 
@@ -12831,8 +18605,16 @@ typedef int Marpa_Step_Type;
 @<Function definitions@> =
 Marpa_Step_Type marpa_v_step(Marpa_Value public_v)
 {
-    @<Return |-2| on failure@>@;
     const VALUE v = (VALUE)public_v;
+    return value_step(v);
+}
+
+@ The body of |marpa_v_step| is shared with
+|marpa_v_steps|, which calls it once per step.
+@<Function definitions@> =
+PRIVATE Marpa_Step_Type value_step(VALUE v)
+{
+    @<Return |-2| on failure@>@;
 
     if (V_is_Nulling(v)) {
       @<Unpack value objects@>@;
@@ -12896,6 +18678,95 @@ Marpa_Step_Type marpa_v_step(Marpa_Value public_v)
     return Step_Type_of_V(v) = MARPA_STEP_INACTIVE;
 }
 
+@*0 Stepping the valuator in batches.
+|marpa_v_steps| takes up to |max| steps at once,
+writing a compact record of each into an array
+supplied by the caller.
+This lets an application, or a wrapper,
+cross into Libmarpa once per batch of steps, instead of once
+per step.
+@<Public structures@> =
+struct marpa_step {
+     Marpa_Step_Type t_step_type;
+     int t_id;
+     int t_arg_0;
+     int t_arg_n;
+     int t_value;
+};
+typedef struct marpa_step Marpa_Step;
+
+@ For every step type, the result goes into stack location |t_arg_0|.
+For a rule step, this is the location of the first argument.
+For a token or nulling symbol step, it is the same as |t_arg_n|,
+which is what |marpa_v_result| returns, and not what
+|marpa_v_arg_0| returns.
+|t_id| is the rule ID for a rule step,
+and the symbol ID for a token or nulling symbol step.
+|t_value| is the token value for a token step,
+and $-1$ otherwise.
+The batch stops early only when the valuator becomes
+inactive, so that a return of less than |max| means
+that valuation is finished.
+A return of the steps taken so far would break this,
+so a step which fails fails the batch,
+and the steps before it in the batch are lost.
+This is not a loss in practice:
+once the valuator is created,
+|value_step| has no failures of its own,
+and a step type it does not know means that
+the valuator is broken.
+The public fields of the valuator describe the last step taken,
+as they would after a call to |marpa_v_step|.
+@<Function definitions@> =
+int marpa_v_steps(Marpa_Value public_v, Marpa_Step* steps, int max)
+{
+    @<Return |-2| on failure@>@;
+    const VALUE v = (VALUE)public_v;
+    @<Unpack value objects@>@;
+    int step_count = 0;
+    if (_MARPA_UNLIKELY (max > 0 && !steps))
+      {
+        MARPA_ERROR (MARPA_ERR_POINTER_ARG_NULL);
+        return failure_indicator;
+      }
+    while (step_count < max)
+      {
+        Marpa_Step *const step = steps + step_count;
+        const Marpa_Step_Type step_type = value_step (v);
+        switch (step_type)
+          {
+          case MARPA_STEP_RULE:
+            step->t_id = RULEID_of_V (v);
+            step->t_arg_0 = Result_of_V (v);
+            step->t_value = -1;
+            break;
+          case MARPA_STEP_TOKEN:
+            step->t_id = XSYID_of_V (v);
+            step->t_arg_0 = Result_of_V (v);
+            step->t_value = Token_Value_of_V (v);
+            break;
+          case MARPA_STEP_NULLING_SYMBOL:
+            step->t_id = XSYID_of_V (v);
+            step->t_arg_0 = Result_of_V (v);
+            step->t_value = -1;
+            break;
+          case MARPA_STEP_TRACE:
+            step->t_id = -1;
+            step->t_arg_0 = Arg_0_of_V (v);
+            step->t_value = -1;
+            break;
+          case MARPA_STEP_INACTIVE:
+            return step_count;
+          default:
+            return failure_indicator;
+          }
+        step->t_step_type = step_type;
+        step->t_arg_n = Arg_N_of_V (v);
+        step_count++;
+      }
+    return step_count;
+}
+
 @ A rule is valued if and only if its LHS is a
 valued symbol.  All the symbol values have been
 locked at this point, so we can memoize the value
@@ -12943,8 +18814,6 @@ for the rule.
 
 @ @<Perform evaluation steps@> =
 {
-    AND and_nodes;
-
     @t}\comment{@>
     /* flag to indicate whether the arguments of
        a rule should be popped off the stack.  Coming
@@ -12953,16 +18822,22 @@ for the rule.
     int pop_arguments = 1;
     @<Unpack value objects@>@;
     @<Fail if fatal error@>@;
-    and_nodes = ANDs_of_B(B_of_O(o));
 
     if (NOOK_of_V(v) < 0) {
-        NOOK_of_V(v) = Size_of_TREE(t);
+        NOOK_of_V(v) = Size_of_V(v);
     }
 
     while (1)
       {
-        OR or;
         IRL nook_irl;
+        int nook_position;
+        YSID nook_origin;
+        @t}\comment{@>
+        /* -1 if the cause is not a token */
+        NSYID token_nsyid;
+        int cause_or_node_type;
+        int token_value = -1;
+        YSID token_start = -1;
         Token_Value_of_V (v) = -1;
         RULEID_of_V (v) = -1;
         NOOK_of_V (v)--;
@@ -12978,61 +18853,56 @@ for the rule.
             Arg_N_of_V (v) = Arg_0_of_V (v);
             pop_arguments = 0;
           }
+        if (T_of_V (v))
           {
-            ANDID and_node_id;
-            AND and_node;
-            int cause_or_node_type;
-            OR cause_or_node;
-            const NOOK nook = NOOK_of_TREE_by_IX (t, NOOK_of_V (v));
-            const int choice = Choice_of_NOOK (nook);
-            or = OR_of_NOOK (nook);
-            YS_ID_of_V (v) = YS_Ord_of_OR (or);
-            and_node_id = and_order_get (o, or, choice);
-            and_node = and_nodes + and_node_id;
-            cause_or_node = Cause_OR_of_AND (and_node);
-            cause_or_node_type = Type_of_OR (cause_or_node);
-            switch (cause_or_node_type)
-              {
-              case VALUED_TOKEN_OR_NODE:
-                Token_Type_of_V (v) = cause_or_node_type;
-                Arg_0_of_V (v) = ++Arg_N_of_V (v);
+            @<Set the nook data from the tree@>@;
+          }
+        else
+          {
+            @<Set the nook data from the direct nook@>@;
+          }
+        switch (cause_or_node_type)
+          {
+          case VALUED_TOKEN_OR_NODE:
+            Token_Type_of_V (v) = cause_or_node_type;
+            Arg_0_of_V (v) = ++Arg_N_of_V (v);
+            XSYID_of_V (v) =
+              ID_of_XSY (Source_XSY_of_NSYID (token_nsyid));
+            Token_Start_of_V (v) = token_start;
+            Token_Value_of_V (v) = token_value;
+            break;
+          case NULLING_TOKEN_OR_NODE:
+            Token_Type_of_V (v) = cause_or_node_type;
+            Arg_0_of_V (v) = ++Arg_N_of_V (v);
+            {
+              const XSY source_xsy = Source_XSY_of_NSYID (token_nsyid);
+              const XSYID source_xsy_id = ID_of_XSY (source_xsy);
+              if (bv_bit_test (XSY_is_Valued_BV_of_V (v), source_xsy_id))
                 {
-                  const OR predecessor = Predecessor_OR_of_AND (and_node);
-                  XSYID_of_V (v) =
-                    ID_of_XSY (Source_XSY_of_NSYID (NSYID_of_OR (cause_or_node)));
-                  Token_Start_of_V (v) =
-                    predecessor ? YS_Ord_of_OR (predecessor) : Origin_Ord_of_OR (or);
-                  Token_Value_of_V (v) = Value_of_OR (cause_or_node);
+                  XSYID_of_V (v) = source_xsy_id;
+                  Token_Start_of_V (v) = YS_ID_of_V (v);
                 }
-
-                break;
-              case NULLING_TOKEN_OR_NODE:
-                Token_Type_of_V (v) = cause_or_node_type;
-                Arg_0_of_V (v) = ++Arg_N_of_V (v);
+              else
                 {
-                  const XSY source_xsy =
-                    Source_XSY_of_NSYID (NSYID_of_OR (cause_or_node));
-                  const XSYID source_xsy_id = ID_of_XSY (source_xsy);
-                  if (bv_bit_test (XSY_is_Valued_BV_of_V (v), source_xsy_id))
-                    {
-                      XSYID_of_V (v) = source_xsy_id;
-                      Token_Start_of_V (v) = YS_ID_of_V (v);
-                    }
-                  else
-                    {
-                      Token_Type_of_V (v) = DUMMY_OR_NODE;
-                      /* |DUMMY_OR_NODE| indicates arbitrary semantics for
-                         this token */
-                    }
+                  Token_Type_of_V (v) = DUMMY_OR_NODE;
+                  /* |DUMMY_OR_NODE| indicates arbitrary semantics for
+                     this token */
                 }
+            }
 
-                break;
-              default:
-                Token_Type_of_V (v) = DUMMY_OR_NODE;
-              }
+            break;
+          default:
+            Token_Type_of_V (v) = DUMMY_OR_NODE;
+          }
+        @t}\comment{@>
+        /* A token for a virtual symbol stands in for
+        a derivation from released Earley sets,
+        and counts as one real symbol of its rule */
+        if (token_nsyid >= 0 && !NSYID_is_Semantic (token_nsyid))
+          {
+            *MARPA_DSTACK_PUSH (VStack_of_V (v), int) = 1;
           }
-        nook_irl = IRL_of_OR (or);
-        if (Position_of_OR (or) == Length_of_IRL (nook_irl))
+        if (nook_position == Length_of_IRL (nook_irl))
           {
             int virtual_rhs = IRL_has_Virtual_RHS (nook_irl);
             int virtual_lhs = IRL_has_Virtual_LHS (nook_irl);
@@ -13071,7 +18941,7 @@ for the rule.
                   if (lbv_bit_test (XRL_is_Valued_BV_of_V (v), original_rule_id))
                     {
                       RULEID_of_V (v) = original_rule_id;
-                      Rule_Start_of_V (v) = Origin_Ord_of_OR (or);
+                      Rule_Start_of_V (v) = nook_origin;
                     }
                 }
 
@@ -13086,6 +18956,44 @@ for the rule.
       }
 }
 
+@ @<Set the nook data from the tree@> =
+{
+  const TREE t = T_of_V (v);
+  const ORDER o = O_of_T (t);
+  const BOCAGE b = B_of_O (o);
+  const NOOK nook = NOOK_of_TREE_by_IX (t, NOOK_of_V (v));
+  const ORID or_node_id = ORID_of_NOOK (nook);
+  const ANDID and_node_id = and_order_get (o, or_node_id, Choice_of_NOOK (nook));
+  YS_ID_of_V (v) = YS_Ord_of_ORID (b, or_node_id);
+  nook_irl = IRL_of_ORID (b, or_node_id);
+  nook_position = Position_of_ORID (b, or_node_id);
+  nook_origin = Origin_Ord_of_ORID (b, or_node_id);
+  token_nsyid = -1;
+  cause_or_node_type = DUMMY_OR_NODE;
+  if (ANDID_is_Token (b, and_node_id))
+    {
+      const ORID predecessor_id = Predecessor_ORID_of_ANDID (b, and_node_id);
+      token_nsyid = NSYID_of_ANDID (b, and_node_id);
+      cause_or_node_type = and_node_token_type (b, and_node_id);
+      token_value = Token_Value_of_ANDID (b, and_node_id);
+      token_start =
+        predecessor_id >= 0 ? YS_Ord_of_ORID (b, predecessor_id) : nook_origin;
+    }
+}
+
+@ @<Set the nook data from the direct nook@> =
+{
+  const DNOOK dnook = DNOOK_of_V_by_IX (v, NOOK_of_V (v));
+  YS_ID_of_V (v) = YS_Ord_of_DNOOK (dnook);
+  nook_irl = IRL_of_DNOOK (dnook);
+  nook_position = Position_of_DNOOK (dnook);
+  nook_origin = Origin_Ord_of_DNOOK (dnook);
+  token_nsyid = Token_NSYID_of_DNOOK (dnook);
+  cause_or_node_type = Token_Type_of_DNOOK (dnook);
+  token_value = Token_Value_of_DNOOK (dnook);
+  token_start = Token_Start_of_DNOOK (dnook);
+}
+
 @** Lightweight boolean vectors (LBV).
 These macros and functions assume that the
 caller remembers the boolean vector's length.
@@ -13153,6 +19061,44 @@ lbv_obs_new0 (struct marpa_obstack *obs, int bits)
 @d lbv_bit_test(lbv, bit)
   ((*lbv_w ((lbv), ((LBW)(bit))) & lbv_b ((LBW)(bit))) != 0U)
 
+@*0 Count the bits in an LBV word.
+GCC and Clang have a builtin, which compiles to a single
+instruction where the hardware has one.
+Otherwise, this is the usual parallel count.
+@<Function definitions@> =
+PRIVATE int lbw_popcount(LBW word)
+{
+#if defined(__GNUC__)
+  return __builtin_popcount (word);
+#else
+  word = word - ((word >> 1) & 0x55555555u);
+  word = (word & 0x33333333u) + ((word >> 2) & 0x33333333u);
+  word = (word + (word >> 4)) & 0x0F0F0F0Fu;
+  return (int) ((word * 0x01010101u) >> 24);
+#endif
+}
+
+@*0 Find the lowest set bit in an LBV word.
+|word| must not be zero.
+As with the bit count, GCC and Clang have a builtin,
+which compiles to a single instruction where the hardware has one.
+Otherwise, this is a binary search.
+@<Function definitions@> =
+PRIVATE int lbw_ctz(LBW word)
+{
+#if defined(__GNUC__)
+  return __builtin_ctz (word);
+#else
+  int bit = 0;
+  if (!(word & 0xFFFFu)) { word >>= 16; bit += 16; }
+  if (!(word & 0xFFu)) { word >>= 8; bit += 8; }
+  if (!(word & 0xFu)) { word >>= 4; bit += 4; }
+  if (!(word & 0x3u)) { word >>= 2; bit += 2; }
+  if (!(word & 0x1u)) { bit += 1; }
+  return bit;
+#endif
+}
+
 @*0 Clone an LBV onto an obstack.
 @<Function definitions@> =
 PRIVATE LBV lbv_clone(
@@ -13452,97 +19398,93 @@ PRIVATE void bv_or_assign(Bit_Vector X, Bit_Vector Y)
 }
 
 @*0 Scan a boolean vector.
+Find the first run of set bits at or after |raw_start|.
+If there is one, its first and last bits are returned
+in |*raw_min| and |*raw_max|, and the return value is 1.
+Otherwise the return value is 0.
+@ The vector is scanned a word at a time,
+and the bits within a word are found with |lbw_ctz|,
+so that the cost is in the number of words,
+not the number of bits.
+Boolean vectors in |libmarpa| are
+typically by symbol or rule ID, and therefore
+only tens of words long.
+For this reason no attempt is made
+to use wider loads than an |LBW|.
+\par
+The vector is not written,
+because it may be in a frozen grammar,
+shared between threads.
+Instead, a masked copy of its last word is used.
 @<Function definitions@>=
 PRIVATE_NOT_INLINE
 int bv_scan(Bit_Vector bv, int raw_start, int* raw_min, int* raw_max)
 {
-    LBW start = (LBW)raw_start;
+    const LBW start = (LBW)raw_start;
+    const LBW size = BV_SIZE(bv);
+    LBW last_word;
+    LBW offset;
+    LBW value;
     LBW min;
-    LBW max;
-    LBW  size = BV_SIZE(bv);
-    LBW  mask = BV_MASK(bv);
-    LBW  offset;
-    LBW  bitmask;
-    LBW  value;
-    int empty;
 
     if (size == 0) return 0;
     if (start >= BV_BITS(bv)) return 0;
-    min = start;
-    max = start;
+    last_word = bv[size-1] & BV_MASK(bv);
     offset = start / bv_wordbits;
-    *(bv+size-1) &= mask;
-    bv += offset;
-    size -= offset;
-    bitmask = (LBW)1 << (start & bv_modmask);
-    mask = ~ (bitmask | (bitmask - (LBW)1));
-    value = *bv++;
-    if ((value & bitmask) == 0)
-    {
-        value &= mask;
-        if (value == 0)
-        {
-            offset++;
-            empty = 1;
-            while (empty && (--size > 0))
-            {
-                if ((value = *bv++)) empty = 0; else offset++;
-            }
-            if (empty) {
-              *raw_min = (int)min;
-              *raw_max = (int)max;
-              return 0;
-            }
-        }
-        start = offset * bv_wordbits;
-        bitmask = bv_lsb;
-        mask = value;
-        while (!(mask & bv_lsb))
-        {
-            bitmask <<= 1;
-            mask >>= 1;
-            start++;
-        }
-        mask = ~ (bitmask | (bitmask - 1));
-        min = start;
-        max = start;
-    }
-    value = ~ value;
-    value &= mask;
-    if (value == 0)
-    {
-        offset++;
-        empty = 1;
-        while (empty && (--size > 0))
-        {
-            if ((value = ~ *bv++)) empty = 0; else offset++;
-        }
-        if (empty) value = bv_lsb;
-    }
-    start = offset * bv_wordbits;
-    while (! (value & bv_lsb))
-    {
-        value >>= 1;
-        start++;
-    }
-    max = --start;
-    *raw_min = (int)min;
-    *raw_max = (int)max;
+
+    @t}\comment{@>
+    /* Find the first set bit at or after |start| */
+    value = (offset == size - 1 ? last_word : bv[offset])
+      & (~(LBW)0 << (start & bv_modmask));
+    while (!value)
+      {
+        if (++offset >= size)
+          {
+            *raw_min = (int) start;
+            *raw_max = (int) start;
+            return 0;
+          }
+        value = offset == size - 1 ? last_word : bv[offset];
+      }
+    min = offset * bv_wordbits + (LBW) lbw_ctz (value);
+
+    @t}\comment{@>
+    /* Find the first unset bit after |min|.
+      The unused bits of |last_word| are clear,
+      so if there is no unset bit, the run ends at the last word */
+    value = ~(offset == size - 1 ? last_word : bv[offset])
+      & (~(LBW)0 << (min & bv_modmask));
+    while (!value)
+      {
+        if (++offset >= size)
+          {
+            *raw_min = (int) min;
+            *raw_max = (int) (size * bv_wordbits) - 1;
+            return 1;
+          }
+        value = ~(offset == size - 1 ? last_word : bv[offset]);
+      }
+    *raw_min = (int) min;
+    *raw_max = (int) (offset * bv_wordbits + (LBW) lbw_ctz (value)) - 1;
     return 1;
 }
 
 @*0 Count the bits in a boolean vector.
+The vector is not written,
+because it may be in a frozen grammar,
+shared between threads.
 @<Function definitions@>=
 PRIVATE int
 bv_count (Bit_Vector v)
 {
-  int start, min, max;
+  LBW size = BV_SIZE (v);
+  const LBW mask = BV_MASK (v);
   int count = 0;
-  for (start = 0; bv_scan (v, start, &min, &max); start = max + 2)
-    {
-      count += max - min + 1;
-    }
-    return count;
+  if (size == 0)
+    return 0;
+  while (--size)
+    count += lbw_popcount (*v++);
+  return count + lbw_popcount (*v & mask);
 }
 
 @*0 The RHS closure of a vector.
@@ -13848,28 +19790,168 @@ and produces a matrix that represents the transitive closure
 of the relation.
 The matrix is assumed to be square.
 The input matrix will be destroyed.
-
-Its uses Warshall's algorithm,
+@ Warshall's algorithm,
 which is
-$O(n^3)$ where the matrix is $n$x$n$.
+$O(n^3)$ where the matrix is $n$x$n$,
+tests every bit of the matrix once for every row.
+For grammars with tens of thousands of NSYs,
+that is seconds of precomputation.
+@ Instead, the matrix is treated as a directed graph,
+and its strongly connected components (SCCs) are
+found with Tarjan's algorithm.
+All the vertices of an SCC have the same closure.
+Tarjan's algorithm finds an SCC only after it has found every
+SCC reachable from it,
+so that, when an SCC is found,
+the rows of all of its successors outside the SCC
+already hold their closures.
+The closure of the SCC is
+the direct successors of its vertices,
+together with the rows of the direct successors outside it.
+A successor already in one of those rows adds nothing,
+and its row is skipped.
+@ The result is exactly that of Warshall's algorithm.
+In particular, a vertex is in its own closure only if it
+is on a cycle, which may be a self-loop.
+The cost is that of scanning every row once,
+plus one |bv_or_assign| per row for each successor which is
+not skipped.
 @<Function definitions@> =
 PRIVATE_NOT_INLINE void transitive_closure(Bit_Matrix matrix)
 {
-  int size = matrix_columns (matrix);
-  int outer_row;
-  for (outer_row = 0; outer_row < size; outer_row++)
+  const int size = matrix_columns (matrix);
+  int *index_of_vertex;
+  int *low_of_vertex;
+  int *tarjan_stack;
+  int *dfs_vertex;
+  int *dfs_next_column;
+  Bit_Vector is_done;
+  Bit_Vector successors;
+  Bit_Vector covered;
+  int tarjan_stack_length = 0;
+  int next_index = 0;
+  int vertex;
+  if (size <= 0)
+    return;
+  index_of_vertex = marpa_new (int, size);
+  low_of_vertex = marpa_new (int, size);
+  tarjan_stack = marpa_new (int, size);
+  dfs_vertex = marpa_new (int, size);
+  dfs_next_column = marpa_new (int, size);
+  is_done = bv_create (size);
+  successors = bv_create (size);
+  covered = bv_create (size);
+  for (vertex = 0; vertex < size; vertex++)
+    {
+      index_of_vertex[vertex] = -1;
+    }
+  for (vertex = 0; vertex < size; vertex++)
+    {
+      int dfs_depth = 0;
+      if (index_of_vertex[vertex] >= 0)
+        continue;
+      {
+        const int new_vertex = vertex;
+        @<Start the closure search of |new_vertex|@>@;
+      }
+      while (dfs_depth > 0)
+        {
+          int min, max;
+          const int v = dfs_vertex[dfs_depth - 1];
+          if (bv_scan (matrix_row (matrix, v), dfs_next_column[dfs_depth - 1],
+               &min, &max))
+            {
+              const int w = min;
+              dfs_next_column[dfs_depth - 1] = w + 1;
+              if (index_of_vertex[w] < 0)
+                {
+                  const int new_vertex = w;
+                  @<Start the closure search of |new_vertex|@>@;
+                  continue;
+                }
+              if (!bv_bit_test (is_done, w)
+                  && index_of_vertex[w] < low_of_vertex[v])
+                {
+                  low_of_vertex[v] = index_of_vertex[w];
+                }
+              continue;
+            }
+          @t}\comment{@>
+          /* All of the successors of |v| have been searched */
+          dfs_depth--;
+          if (dfs_depth > 0)
+            {
+              const int parent = dfs_vertex[dfs_depth - 1];
+              if (low_of_vertex[v] < low_of_vertex[parent])
+                low_of_vertex[parent] = low_of_vertex[v];
+            }
+          if (low_of_vertex[v] == index_of_vertex[v])
+            {
+              @<Find the closure of the SCC rooted at |v|@>@;
+            }
+        }
+    }
+  bv_free (covered);
+  bv_free (successors);
+  bv_free (is_done);
+  my_free (dfs_next_column);
+  my_free (dfs_vertex);
+  my_free (tarjan_stack);
+  my_free (low_of_vertex);
+  my_free (index_of_vertex);
+}
+
+@ The search is depth-first, and kept on an explicit stack,
+because the depth can be as great as the number of vertices.
+@<Start the closure search of |new_vertex|@> =
+{
+  index_of_vertex[new_vertex] = low_of_vertex[new_vertex] = next_index++;
+  tarjan_stack[tarjan_stack_length++] = new_vertex;
+  dfs_vertex[dfs_depth] = new_vertex;
+  dfs_next_column[dfs_depth] = 0;
+  dfs_depth++;
+}
+
+@ The vertices of the SCC are those on the Tarjan stack,
+from |v| to the top.
+Any successor not yet done is one of them.
+@<Find the closure of the SCC rooted at |v|@> =
+{
+  /* |min| and |max| are those of the search,
+     which are not needed again once |v| has been popped */
+  int stack_ix;
+  int start;
+  int scc_base = tarjan_stack_length;
+  do
     {
-      Bit_Vector outer_row_v = matrix_row (matrix, outer_row);
-      int column;
-      for (column = 0; column < size; column++)
+      scc_base--;
+    }
+  while (tarjan_stack[scc_base] != v);
+  bv_clear (successors);
+  bv_clear (covered);
+  for (stack_ix = scc_base; stack_ix < tarjan_stack_length; stack_ix++)
+    {
+      bv_or_assign (successors, matrix_row (matrix, tarjan_stack[stack_ix]));
+    }
+  for (start = 0; bv_scan (successors, start, &min, &max); start = max + 2)
+    {
+      int w;
+      for (w = min; w <= max; w++)
         {
-          Bit_Vector inner_row_v = matrix_row (matrix, column);
-          if (bv_bit_test (inner_row_v, outer_row))
+          if (bv_bit_test (is_done, w) && !bv_bit_test (covered, w))
             {
-              bv_or_assign (inner_row_v, outer_row_v);
+              bv_or_assign (covered, matrix_row (matrix, w));
             }
         }
     }
+  bv_or_assign (successors, covered);
+  for (stack_ix = scc_base; stack_ix < tarjan_stack_length; stack_ix++)
+    {
+      const int scc_vertex = tarjan_stack[stack_ix];
+      bv_copy (matrix_row (matrix, scc_vertex), successors);
+      bv_bit_set (is_done, scc_vertex);
+    }
+  tarjan_stack_length = scc_base;
 }
 
 @** Efficient stacks and queues.
@@ -14081,6 +20163,15 @@ The CILAR buffer is used,
 so its current contents will be destroyed.
 @<Function definitions@> =
 PRIVATE CIL cil_bv_add(CILAR cilar, Bit_Vector bv)
+{
+  cil_buffer_bv_set (cilar, bv);
+  return cil_buffer_add (cilar);
+}
+
+@ Set the CILAR buffer to the CIL for a bit vector,
+without adding it to the CILAR.
+@<Function definitions@> =
+PRIVATE void cil_buffer_bv_set(CILAR cilar, Bit_Vector bv)
 {
   int min, max, start = 0;
   cil_buffer_clear (cilar);
@@ -14092,7 +20183,6 @@ PRIVATE CIL cil_bv_add(CILAR cilar, Bit_Vector bv)
           cil_buffer_push (cilar, new_item);
         }
     }
-  return cil_buffer_add (cilar);
 }
 
 @ Clear the CILAR buffer.
@@ -14350,6 +20440,7 @@ This earleme will be somewhere after the current earleme.
 @s PSAR_Object int
 @<Private structures@> =
 struct s_per_earley_set_arena {
+      struct marpa_obstack* t_obs;
       int t_psl_length;
       PSL t_first_psl;
       PSL t_first_free_psl;
@@ -14377,13 +20468,17 @@ But the destructor may ``safely'' be called on it.
 PRIVATE void
 psar_safe (const PSAR psar)
 {
+  psar->t_obs = NULL;
   psar->t_psl_length = 0;
   psar->t_first_psl = psar->t_first_free_psl = NULL;
 }
-@ @<Function definitions@> =
+@ The PSL's live as long as their PSAR,
+so they are allocated on an obstack of its own.
+@<Function definitions@> =
 PRIVATE void
 psar_init (const PSAR psar, int length)
 {
+  psar->t_obs = marpa_obs_init;
   psar->t_psl_length = length;
   psar->t_first_psl = psar->t_first_free_psl = psl_new (psar);
 }
@@ -14397,15 +20492,16 @@ PRIVATE void psar_destroy(const PSAR psar)
         PSL *owner = psl->t_owner;
         if (owner)
           *owner = NULL;
-        my_free ( psl);
         psl = next_psl;
       }
+    marpa_obs_free (psar->t_obs);
 }
 @ @<Function definitions@> =
 PRIVATE PSL psl_new(const PSAR psar)
 {
      int i;
-     PSL new_psl = my_malloc(Sizeof_PSL(psar));
+     PSL new_psl = marpa__obs_alloc (psar->t_obs, Sizeof_PSL (psar),
+                                     ALIGNOF (PSL_Object));
      new_psl->t_next = NULL;
      new_psl->t_prev = NULL;
      new_psl->t_owner = NULL;
@@ -14432,11 +20528,15 @@ But when the PSAR is needed for a
 a different type of PSL data,
 one which will require different stale-detection logic,
 the old PSL data need to be nulled.
+The same is true when the data the PSL's point to is freed,
+which happens when Earley sets are released.
+Stale data can be left in PSL's which are no longer owned,
+so every PSL is nulled, not just those with owners.
 @<Function definitions@> =
 PRIVATE void psar_reset(const PSAR psar)
 {
     PSL psl = psar->t_first_psl;
-    while (psl && psl->t_owner) {
+    while (psl) {
         int i;
         for (i = 0; i < psar->t_psl_length; i++) {
             PSL_Datum(psl, i) = NULL;
@@ -14559,6 +20659,16 @@ if (_MARPA_UNLIKELY(G_is_Precomputed(g))) {
     return failure_indicator;
 }
 
+@ Most changes to a frozen grammar are already
+disallowed because it is precomputed.
+This check is for those few which are allowed
+after precomputation.
+@<Fail if frozen@> =
+if (_MARPA_UNLIKELY(G_is_Frozen(g))) {
+    MARPA_ERROR(MARPA_ERR_GRAMMAR_IS_FROZEN);
+    return failure_indicator;
+}
+
 @ @<Fail if not precomputed@> =
 if (_MARPA_UNLIKELY(!G_is_Precomputed(g))) {
     MARPA_ERROR(MARPA_ERR_NOT_PRECOMPUTED);
@@ -14638,31 +20748,76 @@ if (_MARPA_UNLIKELY(!ahm_is_valid(g, item_id))) {
 @*0 Recognizer failures.
 |r| is assumed to be the value of the relevant recognizer,
 when one is required.
+These failures are reported in the recognizer's error state.
 @<Fail if recognizer started@> =
 if (_MARPA_UNLIKELY(Input_Phase_of_R(r) != R_BEFORE_INPUT)) {
-    MARPA_ERROR(MARPA_ERR_RECCE_STARTED);
+    MARPA_R_ERROR(MARPA_ERR_RECCE_STARTED);
     return failure_indicator;
 }
 @ @<Fail if recognizer not started@> =
 if (_MARPA_UNLIKELY(Input_Phase_of_R(r) == R_BEFORE_INPUT)) {
-    MARPA_ERROR(MARPA_ERR_RECCE_NOT_STARTED);
+    MARPA_R_ERROR(MARPA_ERR_RECCE_NOT_STARTED);
     return failure_indicator;
 }
 @ @<Fail if recognizer not accepting input@> =
 if (_MARPA_UNLIKELY(Input_Phase_of_R(r) != R_DURING_INPUT)) {
-    MARPA_ERROR(MARPA_ERR_RECCE_NOT_ACCEPTING_INPUT);
+    MARPA_R_ERROR(MARPA_ERR_RECCE_NOT_ACCEPTING_INPUT);
     return failure_indicator;
 }
 
 if (_MARPA_UNLIKELY(!R_is_Consistent(r))) {
-    MARPA_ERROR(MARPA_ERR_RECCE_IS_INCONSISTENT);
+    MARPA_R_ERROR(MARPA_ERR_RECCE_IS_INCONSISTENT);
     return failure_indicator;
 }
 
 @ @<Fail if not trace-safe@> =
-    @<Fail if fatal error@>@;
+    @<Fail if recognizer has a fatal error@>@;
     @<Fail if recognizer not started@>@;
 
+@ A recognizer fails if its grammar is not OK,
+as well as if it is not OK itself.
+@<Fail if recognizer has a fatal error@> =
+if (HEADER_VERSION_MISMATCH) {
+    MARPA_R_ERROR(MARPA_ERR_HEADERS_DO_NOT_MATCH);
+    return failure_indicator;
+}
+if (_MARPA_UNLIKELY(!IS_G_OK(g))) {
+    MARPA_R_ERROR(g->t_error);
+    return failure_indicator;
+}
+if (_MARPA_UNLIKELY(!IS_R_OK(r))) {
+    MARPA_R_ERROR(r->t_error);
+    return failure_indicator;
+}
+
+@ These are the symbol and assertion ID checks,
+for recognizer methods.
+@<Fail recognizer if |xsy_id| is malformed@> =
+if (_MARPA_UNLIKELY(XSYID_is_Malformed(xsy_id))) {
+    MARPA_R_ERROR(MARPA_ERR_INVALID_SYMBOL_ID);
+    return failure_indicator;
+}
+@ @<Soft fail recognizer if |xsy_id| does not exist@> =
+if (_MARPA_UNLIKELY(!XSYID_of_G_Exists(xsy_id))) {
+    MARPA_R_ERROR (MARPA_ERR_NO_SUCH_SYMBOL_ID);
+    return -1;
+}
+@ @<Fail recognizer if |xsy_id| does not exist@> =
+if (_MARPA_UNLIKELY(!XSYID_of_G_Exists(xsy_id))) {
+    MARPA_R_ERROR (MARPA_ERR_NO_SUCH_SYMBOL_ID);
+    return failure_indicator;
+}
+@ @<Fail recognizer if |zwaid| does not exist@> =
+if (_MARPA_UNLIKELY(!ZWAID_of_G_Exists(zwaid))) {
+    MARPA_R_ERROR (MARPA_ERR_NO_SUCH_ASSERTION_ID);
+    return failure_indicator;
+}
+@ @<Fail recognizer if |zwaid| is malformed@> =
+if (_MARPA_UNLIKELY(ZWAID_is_Malformed(zwaid))) {
+    MARPA_R_ERROR (MARPA_ERR_INVALID_ASSERTION_ID);
+    return failure_indicator;
+}
+
 @ It is expected the first test, for
 mismatched headers, will be optimized
 completely out if the versions
@@ -14710,20 +20865,51 @@ in the code.
 @d MARPA_INTERNAL_ERROR(message) (set_error(g, MARPA_ERR_INTERNAL, (message), 0u))
 @d MARPA_ERROR(code) (set_error(g, (code), NULL, 0u))
 @d MARPA_FATAL(code) (set_error(g, (code), NULL, FATAL_FLAG))
+@d MARPA_R_ERROR(code) (set_r_error(r, (code), NULL, 0u))
+@d MARPA_R_FATAL(code) (set_r_error(r, (code), NULL, FATAL_FLAG))
 @ Not inlined.  |r_error|
 occurs in the code quite often,
 but |r_error|
 should actually be invoked only in exceptional circumstances.
 In this case space clearly is much more important than speed.
+A frozen grammar is shared between threads,
+and is not written,
+so that an error in a method which has
+only the grammar to report it in is not recorded.
 @<Function definitions@> =
 PRIVATE_NOT_INLINE void
 set_error (GRAMMAR g, Marpa_Error_Code code, const char* message, unsigned int flags)
 {
+  if (G_is_Frozen (g))
+    return;
   g->t_error = code;
   g->t_error_string = message;
   if (flags & FATAL_FLAG)
     g->t_is_ok = 0;
 }
+
+@ Recognizer errors go into the recognizer's error state.
+A recognizer-fatal error makes only that recognizer fatal.
+Unless the grammar is frozen,
+the error is also recorded in the grammar,
+where |marpa_g_error| reports it.
+A frozen grammar is never written,
+so that recognizers of it may be used in different threads.
+@<Function definitions@> =
+PRIVATE_NOT_INLINE void
+set_r_error (RECCE r, Marpa_Error_Code code, const char* message, unsigned int flags)
+{
+  const GRAMMAR g = G_of_R (r);
+  r->t_error = code;
+  r->t_error_string = message;
+  if (flags & FATAL_FLAG)
+    r->t_is_ok = 0;
+  if (!G_is_Frozen (g))
+    {
+      g->t_error = code;
+      g->t_error_string = message;
+    }
+}
 @ If this is called when Libmarpa is in a ``not OK'' state,
 it means very bad things are happening --
 possibly memory overwrites.
@@ -14734,10 +20920,13 @@ unless it is |MARPA_ERR_NONE|.
 Since this would be completely misleading,
 we take a chance and try to
 change it to |MARPA_ERR_I_AM_NOT_OK|.
+The error of a frozen grammar is left as it is.
 @<Function definitions@> =
 PRIVATE Marpa_Error_Code
 clear_error (GRAMMAR g)
 {
+  if (G_is_Frozen (g))
+    return g->t_error;
   if (!IS_G_OK (g))
     {
       if (g->t_error == MARPA_ERR_NONE)
@@ -14815,7 +21004,7 @@ Marpa_Earley_Set_ID _marpa_r_trace_earley_set(Marpa_Recognizer r)
   YS trace_earley_set = r->t_trace_earley_set;
   @<Fail if not trace-safe@>@;
   if (!trace_earley_set) {
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_YS);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_YS);
       return failure_indicator;
   }
   return Ord_of_YS(trace_earley_set);
@@ -14838,15 +21027,15 @@ Marpa_Earleme marpa_r_earleme(Marpa_Recognizer r, Marpa_Earley_Set_ID set_id)
     @<Return |-2| on failure@>@;
     YS earley_set;
     @<Fail if recognizer not started@>@;
-    @<Fail if fatal error@>@;
+    @<Fail if recognizer has a fatal error@>@;
     if (set_id < 0) {
-        MARPA_ERROR(MARPA_ERR_INVALID_LOCATION);
+        MARPA_R_ERROR(MARPA_ERR_INVALID_LOCATION);
         return failure_indicator;
     }
     r_update_earley_sets (r);
     if (!YS_Ord_is_Valid (r, set_id))
       {
-        MARPA_ERROR(MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
+        MARPA_R_ERROR(MARPA_ERR_NO_EARLEY_SET_AT_LOCATION);
         return failure_indicator;
       }
     earley_set = YS_of_R_by_Ord (r, set_id);
@@ -14863,11 +21052,11 @@ int _marpa_r_earley_set_size(Marpa_Recognizer r, Marpa_Earley_Set_ID set_id)
     YS earley_set;
   @<Unpack recognizer objects@>@;
     @<Fail if recognizer not started@>@;
-    @<Fail if fatal error@>@;
+    @<Fail if recognizer has a fatal error@>@;
     r_update_earley_sets (r);
     if (!YS_Ord_is_Valid (r, set_id))
       {
-        MARPA_ERROR(MARPA_ERR_INVALID_LOCATION);
+        MARPA_R_ERROR(MARPA_ERR_INVALID_LOCATION);
         return failure_indicator;
       }
     earley_set = YS_of_R_by_Ord (r, set_id);
@@ -14923,7 +21112,7 @@ _marpa_r_earley_set_trace (Marpa_Recognizer r, Marpa_Earley_Set_ID set_id)
   @<Clear trace Earley set dependent data@>@;
     if (set_id < 0)
     {
-        MARPA_ERROR(MARPA_ERR_INVALID_LOCATION);
+        MARPA_R_ERROR(MARPA_ERR_INVALID_LOCATION);
         return failure_indicator;
     }
   r_update_earley_sets (r);
@@ -14957,13 +21146,13 @@ _marpa_r_earley_item_trace (Marpa_Recognizer r, Marpa_Earley_Item_ID item_id)
   if (!trace_earley_set)
     {
       @<Clear trace Earley set dependent data@>@;
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_YS);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_YS);
       return failure_indicator;
     }
   trace_earley_item_clear (r);
   if (item_id < 0)
     {
-      MARPA_ERROR (MARPA_ERR_YIM_ID_INVALID);
+      MARPA_R_ERROR (MARPA_ERR_YIM_ID_INVALID);
       return failure_indicator;
     }
   if (item_id >= YIM_Count_of_YS (trace_earley_set))
@@ -15001,7 +21190,7 @@ Marpa_Earley_Set_ID _marpa_r_earley_item_origin(Marpa_Recognizer r)
   @<Fail if not trace-safe@>@;
     if (!item) {
         @<Clear trace Earley item data@>@;
-        MARPA_ERROR(MARPA_ERR_NO_TRACE_YIM);
+        MARPA_R_ERROR(MARPA_ERR_NO_TRACE_YIM);
         return failure_indicator;
     }
     return Origin_Ord_of_YIM(item);
@@ -15022,11 +21211,11 @@ Marpa_Symbol_ID _marpa_r_leo_predecessor_symbol(Marpa_Recognizer r)
   @<Unpack recognizer objects@>@;
   @<Fail if not trace-safe@>@;
   if (!postdot_item) {
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_PIM);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_PIM);
       return failure_indicator;
   }
   if (YIM_of_PIM(postdot_item)) {
-      MARPA_ERROR(MARPA_ERR_PIM_IS_NOT_LIM);
+      MARPA_R_ERROR(MARPA_ERR_PIM_IS_NOT_LIM);
       return failure_indicator;
   }
   predecessor_leo_item = Predecessor_LIM_of_LIM(LIM_of_PIM(postdot_item));
@@ -15044,7 +21233,7 @@ Marpa_Earley_Set_ID _marpa_r_leo_base_origin(Marpa_Recognizer r)
   YIM base_earley_item;
   @<Fail if not trace-safe@>@;
   if (!postdot_item) {
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_PIM);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_PIM);
       return failure_indicator;
   }
   if (YIM_of_PIM(postdot_item)) return pim_is_not_a_leo_item;
@@ -15063,7 +21252,7 @@ Marpa_AHM_ID _marpa_r_leo_base_state(Marpa_Recognizer r)
   @<Unpack recognizer objects@>@;
   @<Fail if not trace-safe@>@;
   if (!postdot_item) {
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_PIM);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_PIM);
       return failure_indicator;
   }
   if (YIM_of_PIM(postdot_item)) return pim_is_not_a_leo_item;
@@ -15106,10 +21295,10 @@ _marpa_r_postdot_symbol_trace (Marpa_Recognizer r,
   @<Unpack recognizer objects@>@;
   @<Clear trace postdot item data@>@;
   @<Fail if not trace-safe@>@;
-    @<Fail if |xsy_id| is malformed@>@;
-    @<Soft fail if |xsy_id| does not exist@>@;
+    @<Fail recognizer if |xsy_id| is malformed@>@;
+    @<Soft fail recognizer if |xsy_id| does not exist@>@;
   if (!current_ys) {
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_YS);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_YS);
       return failure_indicator;
   }
   pim_nsy_p = PIM_NSY_P_of_YS_by_NSYID(current_ys, NSYID_by_XSYID(xsy_id));
@@ -15143,7 +21332,7 @@ _marpa_r_first_postdot_item_trace (Marpa_Recognizer r)
   @<Fail if not trace-safe@>@;
   if (!current_earley_set) {
       @<Clear trace Earley item data@>@;
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_YS);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_YS);
       return failure_indicator;
   }
   if (current_earley_set->t_postdot_sym_count <= 0) return -1;
@@ -15176,12 +21365,12 @@ _marpa_r_next_postdot_item_trace (Marpa_Recognizer r)
   pim = r->t_trace_postdot_item;
   @<Clear trace postdot item data@>@;
   if (!pim_nsy_p || !pim) {
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_PIM);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_PIM);
       return failure_indicator;
   }
   @<Fail if not trace-safe@>@;
   if (!current_set) {
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_YS);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_YS);
       return failure_indicator;
   }
   pim = Next_PIM_of_PIM(pim);
@@ -15207,7 +21396,7 @@ Marpa_Symbol_ID _marpa_r_postdot_item_symbol(Marpa_Recognizer r)
   @<Unpack recognizer objects@>@;
   @<Fail if not trace-safe@>@;
   if (!postdot_item) {
-      MARPA_ERROR(MARPA_ERR_NO_TRACE_PIM);
+      MARPA_R_ERROR(MARPA_ERR_NO_TRACE_PIM);
       return failure_indicator;
   }
   return Postdot_NSYID_of_PIM(postdot_item);
@@ -15287,7 +21476,7 @@ Marpa_Symbol_ID _marpa_r_next_token_link_trace(Marpa_Recognizer r)
     @<Set |item|, failing if necessary@>@;
     if (r->t_trace_source_type != SOURCE_IS_TOKEN) {
         trace_source_link_clear(r);
-        MARPA_ERROR(MARPA_ERR_NOT_TRACING_TOKEN_LINKS);
+        MARPA_R_ERROR(MARPA_ERR_NOT_TRACING_TOKEN_LINKS);
         return failure_indicator;
     }
     source_link = Next_SRCL_of_SRCL( r->t_trace_source_link);
@@ -15358,7 +21547,7 @@ Marpa_Symbol_ID _marpa_r_next_completion_link_trace(Marpa_Recognizer r)
     @<Set |item|, failing if necessary@>@;
     if (r->t_trace_source_type != SOURCE_IS_COMPLETION) {
         trace_source_link_clear(r);
-        MARPA_ERROR(MARPA_ERR_NOT_TRACING_COMPLETION_LINKS);
+        MARPA_R_ERROR(MARPA_ERR_NOT_TRACING_COMPLETION_LINKS);
         return failure_indicator;
     }
     source_link = Next_SRCL_of_SRCL (r->t_trace_source_link);
@@ -15419,7 +21608,7 @@ _marpa_r_next_leo_link_trace (Marpa_Recognizer r)
   if (r->t_trace_source_type != SOURCE_IS_LEO)
     {
       trace_source_link_clear (r);
-      MARPA_ERROR(MARPA_ERR_NOT_TRACING_LEO_LINKS);
+      MARPA_R_ERROR(MARPA_ERR_NOT_TRACING_LEO_LINKS);
       return failure_indicator;
     }
   source_link = Next_SRCL_of_SRCL(r->t_trace_source_link);
@@ -15436,7 +21625,7 @@ _marpa_r_next_leo_link_trace (Marpa_Recognizer r)
     item = r->t_trace_earley_item;
     if (!item) {
         trace_source_link_clear(r);
-        MARPA_ERROR(MARPA_ERR_NO_TRACE_YIM);
+        MARPA_R_ERROR(MARPA_ERR_NO_TRACE_YIM);
         return failure_indicator;
     }
 
@@ -15475,7 +21664,7 @@ AHMID _marpa_r_source_predecessor_state(Marpa_Recognizer r)
         return AHMID_of_YIM(predecessor);
     }
     }
-    MARPA_ERROR(invalid_source_type_code(source_type));
+    MARPA_R_ERROR(invalid_source_type_code(source_type));
     return failure_indicator;
 }
 
@@ -15511,7 +21700,7 @@ Marpa_Symbol_ID _marpa_r_source_token(Marpa_Recognizer r, int *value_p)
         if (value_p) *value_p = Value_of_SRCL(source_link);
         return NSYID_of_SRCL(source_link);
     }
-    MARPA_ERROR(invalid_source_type_code(source_type));
+    MARPA_R_ERROR(invalid_source_type_code(source_type));
     return failure_indicator;
 }
 
@@ -15543,7 +21732,7 @@ Marpa_Symbol_ID _marpa_r_source_leo_transition_symbol(Marpa_Recognizer r)
     case SOURCE_IS_LEO:
         return Leo_Transition_NSYID_of_SRCL(source_link);
     }
-    MARPA_ERROR(invalid_source_type_code(source_type));
+    MARPA_R_ERROR(invalid_source_type_code(source_type));
     return failure_indicator;
 }
 
@@ -15599,7 +21788,7 @@ Marpa_Earley_Set_ID _marpa_r_source_middle(Marpa_Recognizer r)
         break;
       }
     default:
-      MARPA_ERROR (invalid_source_type_code (source_type));
+      MARPA_R_ERROR (invalid_source_type_code (source_type));
       return failure_indicator;
   }
 
@@ -15611,7 +21800,7 @@ Marpa_Earley_Set_ID _marpa_r_source_middle(Marpa_Recognizer r)
 @ @<Set source link, failing if necessary@> =
     source_link = r->t_trace_source_link;
     if (!source_link) {
-        MARPA_ERROR(MARPA_ERR_NO_TRACE_SRCL);
+        MARPA_R_ERROR(MARPA_ERR_NO_TRACE_SRCL);
         return failure_indicator;
     }
 
@@ -15636,132 +21825,134 @@ or negative.
       return failure_indicator;
     }
 }
-@ @<Set |or_node| or fail@> =
+@ @<Fail if |b| has no or-nodes@> =
 {
-  if (_MARPA_UNLIKELY (!ORs_of_B(b)))
+  if (_MARPA_UNLIKELY (!b->t_or_first_andids))
     {
       MARPA_ERROR (MARPA_ERR_NO_OR_NODES);
       return failure_indicator;
     }
-  or_node = OR_of_B_by_ID(b, or_node_id);
 }
 
 @ @<Function definitions@> =
 int _marpa_b_or_node_set(Marpa_Bocage b,
   Marpa_Or_Node_ID or_node_id)
 {
-  OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
-  return YS_Ord_of_OR(or_node);
+  @<Fail if |b| has no or-nodes@>@;
+  return YS_Ord_of_ORID(b, or_node_id);
 }
 
 @ @<Function definitions@> =
 int _marpa_b_or_node_origin(Marpa_Bocage b,
   Marpa_Or_Node_ID or_node_id)
 {
-  OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
-  return Origin_Ord_of_OR(or_node);
+  @<Fail if |b| has no or-nodes@>@;
+  return Origin_Ord_of_ORID(b, or_node_id);
 }
 
 @ @<Function definitions@> =
 Marpa_IRL_ID _marpa_b_or_node_irl(Marpa_Bocage b,
   Marpa_Or_Node_ID or_node_id)
 {
-  OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
-  return IRLID_of_OR(or_node);
+  @<Fail if |b| has no or-nodes@>@;
+  return IRLID_of_ORID(b, or_node_id);
 }
 
 @ @<Function definitions@> =
 int _marpa_b_or_node_position(Marpa_Bocage b,
   Marpa_Or_Node_ID or_node_id)
 {
-  OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
-  return Position_of_OR(or_node);
+  @<Fail if |b| has no or-nodes@>@;
+  return Position_of_ORID(b, or_node_id);
 }
 
 @ @<Function definitions@> =
 int _marpa_b_or_node_is_whole(Marpa_Bocage b,
   Marpa_Or_Node_ID or_node_id)
 {
-  OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
-  return Position_of_OR(or_node) >= Length_of_IRL(IRL_of_OR(or_node)) ? 1 : 0;
+  @<Fail if |b| has no or-nodes@>@;
+  return Position_of_ORID(b, or_node_id) >=
+    Length_of_IRL(IRL_of_ORID(b, or_node_id)) ? 1 : 0;
 }
 
 @ @<Function definitions@> =
 int _marpa_b_or_node_is_semantic(Marpa_Bocage b,
   Marpa_Or_Node_ID or_node_id)
 {
-  OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
-  return ! IRL_has_Virtual_LHS(IRL_of_OR(or_node));
+  @<Fail if |b| has no or-nodes@>@;
+  return ! IRL_has_Virtual_LHS(IRL_of_ORID(b, or_node_id));
+}
+
+@ The and-nodes of an or-node of a lazy bocage
+are created when they are first traced.
+@<Expand |or_node_id| of |b| if needed@> =
+{
+  if (!OR_is_Expanded_in_B (b, or_node_id))
+    or_node_expand (b, or_node_id);
 }
 
 @ @<Function definitions@> =
 int _marpa_b_or_node_first_and(Marpa_Bocage b,
   Marpa_Or_Node_ID or_node_id)
 {
-  OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
-  return First_ANDID_of_OR(or_node);
+  @<Fail if |b| has no or-nodes@>@;
+  @<Expand |or_node_id| of |b| if needed@>@;
+  return First_ANDID_of_ORID(b, or_node_id);
 }
 
 @ @<Function definitions@> =
 int _marpa_b_or_node_last_and(Marpa_Bocage b,
   Marpa_Or_Node_ID or_node_id)
 {
-  OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
-  return First_ANDID_of_OR(or_node)
-      + AND_Count_of_OR(or_node) - 1;
+  @<Fail if |b| has no or-nodes@>@;
+  @<Expand |or_node_id| of |b| if needed@>@;
+  return First_ANDID_of_ORID(b, or_node_id)
+      + AND_Count_of_ORID(b, or_node_id) - 1;
 }
 
 @ @<Function definitions@> =
 int _marpa_b_or_node_and_count(Marpa_Bocage b,
   Marpa_Or_Node_ID or_node_id)
 {
-  OR or_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
-  @<Set |or_node| or fail@>@;
-  return AND_Count_of_OR(or_node);
+  @<Fail if |b| has no or-nodes@>@;
+  @<Expand |or_node_id| of |b| if needed@>@;
+  return AND_Count_of_ORID(b, or_node_id);
 }
 
 @*0 Ordering trace functions.
@@ -15782,6 +21973,7 @@ int _marpa_o_or_node_and_node_count(Marpa_Order o,
   @<Unpack order objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
+  order_or_node_expand (o, or_node_id);
   if (!O_is_Default(o))
   {
     ANDID ** const and_node_orderings = o->t_and_node_orderings;
@@ -15789,9 +21981,8 @@ int _marpa_o_or_node_and_node_count(Marpa_Order o,
     if (ordering) return ordering[0];
   }
   {
-    OR or_node;
-    @<Set |or_node| or fail@>@;
-    return AND_Count_of_OR (or_node);
+    @<Fail if |b| has no or-nodes@>@;
+    return AND_Count_of_ORID (b, or_node_id);
   }
 }
 
@@ -15803,6 +21994,7 @@ int _marpa_o_or_node_and_node_id_by_ix(Marpa_Order o,
   @<Unpack order objects@>@;
   @<Fail if fatal error@>@;
   @<Check |or_node_id|@>@;
+  order_or_node_expand (o, or_node_id);
   if (!O_is_Default(o))
   {
       ANDID ** const and_node_orderings = o->t_and_node_orderings;
@@ -15810,9 +22002,8 @@ int _marpa_o_or_node_and_node_id_by_ix(Marpa_Order o,
       if (ordering) return ordering[1 + ix];
   }
   {
-    OR or_node;
-    @<Set |or_node| or fail@>@;
-    return First_ANDID_of_OR (or_node) + ix;
+    @<Fail if |b| has no or-nodes@>@;
+    return First_ANDID_of_ORID (b, or_node_id) + ix;
   }
 }
 
@@ -15827,7 +22018,7 @@ int _marpa_b_and_node_count(Marpa_Bocage b)
   return AND_Count_of_B(b);
 }
 
-@ @<Check bocage |and_node_id|; set |and_node|@> =
+@ @<Check bocage |and_node_id|@> =
 {
   if (and_node_id >= AND_Count_of_B (b))
     {
@@ -15838,90 +22029,64 @@ int _marpa_b_and_node_count(Marpa_Bocage b)
       MARPA_ERROR (MARPA_ERR_ANDID_NEGATIVE);
       return failure_indicator;
     }
-  {
-    AND and_nodes = ANDs_of_B (b);
-    if (!and_nodes)
-      {
-        MARPA_ERROR (MARPA_ERR_NO_AND_NODES);
-        return failure_indicator;
-      }
-    and_node = and_nodes + and_node_id;
-  }
+  if (!b->t_and_symbols)
+    {
+      MARPA_ERROR (MARPA_ERR_NO_AND_NODES);
+      return failure_indicator;
+    }
 }
 
 @ @<Function definitions@> =
 int _marpa_b_and_node_parent(Marpa_Bocage b,
   Marpa_And_Node_ID and_node_id)
 {
-  AND and_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
-  @<Check bocage |and_node_id|; set |and_node|@>@;
-  return ID_of_OR (OR_of_AND (and_node));
+  @<Check bocage |and_node_id|@>@;
+  return and_node_parent (b, and_node_id);
 }
 
 @ @<Function definitions@> =
 int _marpa_b_and_node_predecessor(Marpa_Bocage b,
   Marpa_And_Node_ID and_node_id)
 {
-  AND and_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
-  @<Check bocage |and_node_id|; set |and_node|@>@;
-    {
-      const OR predecessor_or = Predecessor_OR_of_AND (and_node);
-      const ORID predecessor_or_id =
-        predecessor_or ? ID_of_OR (predecessor_or) : -1;
-      return predecessor_or_id;
-      }
+  @<Check bocage |and_node_id|@>@;
+  return Predecessor_ORID_of_ANDID (b, and_node_id);
 }
 
 @ @<Function definitions@> =
 int _marpa_b_and_node_cause(Marpa_Bocage b,
   Marpa_And_Node_ID and_node_id)
 {
-  AND and_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
-    @<Check bocage |and_node_id|; set |and_node|@>@;
-    {
-      const OR cause_or = Cause_OR_of_AND (and_node);
-      const ORID cause_or_id =
-        OR_is_Token(cause_or) ? -1 : ID_of_OR (cause_or);
-      return cause_or_id;
-    }
+  @<Check bocage |and_node_id|@>@;
+  if (ANDID_is_Token (b, and_node_id)) return -1;
+  return Cause_ORID_of_ANDID (b, and_node_id);
 }
 
 @ @<Function definitions@> =
 int _marpa_b_and_node_symbol(Marpa_Bocage b,
   Marpa_And_Node_ID and_node_id)
 {
-  AND and_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
-  @<Check bocage |and_node_id|; set |and_node|@>@;
-  {
-    const OR cause_or = Cause_OR_of_AND (and_node);
-    const XSYID symbol_id =
-      OR_is_Token (cause_or) ? NSYID_of_OR (cause_or) : -1;
-    return symbol_id;
-  }
+  @<Check bocage |and_node_id|@>@;
+  return NSYID_of_ANDID (b, and_node_id);
 }
 
 @ @<Function definitions@> =
 Marpa_Symbol_ID _marpa_b_and_node_token(Marpa_Bocage b,
     Marpa_And_Node_ID and_node_id, int* value_p)
 {
-  AND and_node;
-  OR cause_or;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
-    @<Check bocage |and_node_id|; set |and_node|@>@;
-
-  cause_or = Cause_OR_of_AND (and_node);
-  if (!OR_is_Token (cause_or)) return -1;
-  if (value_p) *value_p = Value_of_OR (cause_or);
-  return NSYID_of_OR (cause_or);
+  @<Check bocage |and_node_id|@>@;
+  if (!ANDID_is_Token (b, and_node_id)) return -1;
+  if (value_p) *value_p = Token_Value_of_ANDID (b, and_node_id);
+  return NSYID_of_ANDID (b, and_node_id);
 }
 
 @ The ``middle'' earley set of the and-node.
@@ -15935,18 +22100,17 @@ always be the same as ``middle'' of the or-node.
 Marpa_Earley_Set_ID _marpa_b_and_node_middle(Marpa_Bocage b,
     Marpa_And_Node_ID and_node_id)
 {
-  AND and_node;
   @<Return |-2| on failure@>@;
   @<Unpack bocage objects@>@;
-  @<Check bocage |and_node_id|; set |and_node|@>@;
+  @<Check bocage |and_node_id|@>@;
   {
-    const OR predecessor_or = Predecessor_OR_of_AND (and_node);
-    if (predecessor_or)
+    const ORID predecessor_or_id = Predecessor_ORID_of_ANDID (b, and_node_id);
+    if (predecessor_or_id >= 0)
       {
-        return YS_Ord_of_OR (predecessor_or);
+        return YS_Ord_of_ORID (b, predecessor_or_id);
       }
   }
-  return Origin_Ord_of_OR (OR_of_AND (and_node));
+  return Origin_Ord_of_ORID (b, and_node_parent (b, and_node_id));
 }
 
 @*0 Nook trace functions.
@@ -15978,7 +22142,7 @@ int _marpa_t_nook_or_node(Marpa_Tree t, int nook_id)
   @<Return |-2| on failure@>@;
   @<Unpack tree objects@>@;
    @<Check |r| and |nook_id|; set |nook|@>@;
-  return ID_of_OR(OR_of_NOOK(nook));
+  return ORID_of_NOOK(nook);
 }
 
 @ @<Function definitions@> =
@@ -16084,14 +22248,24 @@ static const char* yim_tag_safe(
   char *buffer, GRAMMAR g, YIM yim) @,@, UNUSED;
 static const char* yim_tag(GRAMMAR g, YIM yim) @,@, UNUSED;
 @ It is passed a buffer to keep it thread-safe.
+The tag shows the origin and current earlemes of the item.
+The compact layout keeps only Earley set ordinals,
+and there is no recognizer in scope to find the earlemes from them,
+so its tags show the ordinals instead.
 @<Debug function definitions@> =
 static const char *
 yim_tag_safe (char * buffer, GRAMMAR g, YIM yim)
 {
   if (!yim) return "NULL";
+#if MARPA_COMPACT_YIM
   sprintf (buffer, "S%d@@%d-%d",
-           AHMID_of_YIM (yim), Origin_Earleme_of_YIM (yim),
-           Earleme_of_YIM (yim));
+           AHMID_of_YIM (yim), Origin_Ord_of_YIM (yim),
+           YS_Ord_of_YIM (yim));
+#else
+  sprintf (buffer, "S%d@@%ld-%ld",
+           (int) AHMID_of_YIM (yim), (long) Origin_Earleme_of_YIM (yim),
+           (long) Earleme_of_YIM (yim));
+#endif
   return buffer;
 }
 
@@ -16209,6 +22383,10 @@ So I add such a comment.
 #define MARPA_DEBUG 0
 #endif
 
+#ifndef MARPA_COMPACT_YIM
+#define MARPA_COMPACT_YIM 0
+#endif
+
 #include "marpa.h"
 #include "marpa_ami.h"
 @h
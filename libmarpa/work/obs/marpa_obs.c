@@ -35,6 +35,182 @@
 #define MALLOC_OVERHEAD 32
 #define DEFAULT_CHUNK_SIZE (4096 - MALLOC_OVERHEAD)
 
+/* The chunk pool.
+ *
+ * Each thread may keep a pool of freed chunks,
+ * from which chunks are allocated before going to malloc,
+ * so that an application which creates and destroys
+ * many short-lived grammars and recognizers
+ * does not make a malloc call for every chunk.
+ *
+ * The pool is thread-local, so that no locking is needed.
+ * A chunk may be freed in a different thread from the one
+ * that allocated it, in which case it goes to the pool of the
+ * thread that frees it.
+ * Thread-local storage is not C89, and where the compiler
+ * does not provide it, there is no pool.
+ *
+ * The pool is in use while its limit is non-zero.
+ * Chunks are pooled by size class,
+ * and while the pool is in use, new chunks are rounded up
+ * to the size of their class.
+ * Chunks too big for any class, and chunks freed while the
+ * pool is full or not in use, go back to malloc.
+ */
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+# define MARPA_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+# define MARPA_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+# define MARPA_THREAD_LOCAL __declspec(thread)
+#endif
+
+/* Class |i| holds chunks of |POOL_CLASS_SIZE(i)| bytes.
+ * Class 0 is the default chunk size.
+ */
+#define POOL_CLASS_COUNT 8
+#define POOL_CLASS_SIZE(i) (((size_t)4096 << (i)) - MALLOC_OVERHEAD)
+
+struct marpa_obstack_pool
+{
+  size_t limit;                 /* 0 if the pool is not in use */
+  size_t size;                  /* bytes in the pooled chunks */
+  size_t reuse_count;           /* chunks taken from the pool */
+  struct marpa_obstack_chunk *chunks[POOL_CLASS_COUNT];
+};
+
+#if defined(MARPA_THREAD_LOCAL)
+static MARPA_THREAD_LOCAL struct marpa_obstack_pool thread_pool;
+#endif
+
+/* Returns the class of the smallest pooled chunk which
+   holds |size| bytes, or -1 if none does. */
+static int
+pool_class_of_size (size_t size)
+{
+  int class_ix;
+  for (class_ix = 0; class_ix < POOL_CLASS_COUNT; class_ix++)
+    {
+      if (size <= POOL_CLASS_SIZE (class_ix))
+        return class_ix;
+    }
+  return -1;
+}
+
+/* Allocate a chunk of at least |*p_size| bytes,
+   and set |*p_size| to its actual size */
+static struct marpa_obstack_chunk *
+chunk_alloc (size_t *p_size)
+{
+  struct marpa_obstack_chunk *chunk;
+#if defined(MARPA_THREAD_LOCAL)
+  struct marpa_obstack_pool *const pool = &thread_pool;
+  if (pool->limit)
+    {
+      const int class_ix = pool_class_of_size (*p_size);
+      if (class_ix >= 0)
+        {
+          *p_size = POOL_CLASS_SIZE (class_ix);
+          chunk = pool->chunks[class_ix];
+          if (chunk)
+            {
+              pool->chunks[class_ix] = chunk->header.prev;
+              pool->size -= *p_size;
+              pool->reuse_count++;
+              return chunk;
+            }
+        }
+    }
+#endif
+  chunk = my_malloc (*p_size);
+  chunk->header.size = *p_size;
+  return chunk;
+}
+
+static void
+chunk_free (struct marpa_obstack_chunk *chunk)
+{
+#if defined(MARPA_THREAD_LOCAL)
+  struct marpa_obstack_pool *const pool = &thread_pool;
+  const size_t size = chunk->header.size;
+  if (pool->limit && pool->size + size <= pool->limit)
+    {
+      const int class_ix = pool_class_of_size (size);
+      if (class_ix >= 0 && size == POOL_CLASS_SIZE (class_ix))
+        {
+          chunk->header.prev = pool->chunks[class_ix];
+          pool->chunks[class_ix] = chunk;
+          pool->size += size;
+          return;
+        }
+    }
+#endif
+  my_free (chunk);
+}
+
+/* Put the calling thread's pool in use,
+   with a limit of at least |size| bytes.
+   Returns 1 on success, and 0 if there is no pool
+   because there is no thread-local storage. */
+int
+marpa__obs_pool_reserve (size_t size)
+{
+#if defined(MARPA_THREAD_LOCAL)
+  if (size > thread_pool.limit)
+    thread_pool.limit = size;
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+/* Free the chunks in the calling thread's pool,
+   and take it out of use */
+void
+marpa__obs_pool_free (void)
+{
+#if defined(MARPA_THREAD_LOCAL)
+  int class_ix;
+  thread_pool.limit = 0;
+  for (class_ix = 0; class_ix < POOL_CLASS_COUNT; class_ix++)
+    {
+      struct marpa_obstack_chunk *chunk = thread_pool.chunks[class_ix];
+      while (chunk)
+        {
+          struct marpa_obstack_chunk *const prev = chunk->header.prev;
+          my_free (chunk);
+          chunk = prev;
+        }
+      thread_pool.chunks[class_ix] = NULL;
+    }
+  thread_pool.size = 0;
+#endif
+}
+
+/* Bytes in the chunks of the calling thread's pool */
+size_t
+marpa__obs_pool_size (void)
+{
+#if defined(MARPA_THREAD_LOCAL)
+  return thread_pool.size;
+#else
+  return 0;
+#endif
+}
+
+/* Chunks the calling thread has taken from its pool,
+   instead of from malloc.  Not reset by |marpa__obs_pool_free| */
+size_t
+marpa__obs_pool_reuse_count (void)
+{
+#if defined(MARPA_THREAD_LOCAL)
+  return thread_pool.reuse_count;
+#else
+  return 0;
+#endif
+}
+
 struct marpa_obstack *
 marpa__obs_begin (size_t size)
 {
@@ -45,11 +221,10 @@ marpa__obs_begin (size_t size)
 
   /* We ignore |size| if it specifies less than the default */
   size = MAX ((int)DEFAULT_CHUNK_SIZE, size);
-  chunk_base = my_malloc (size);
+  chunk = chunk_alloc (&size);
+  chunk_base = (char *) chunk;
 
   /* The chunk header goes at the beginning */
-  chunk = (struct marpa_obstack_chunk*)chunk_base;
-  chunk->header.size = size;
   chunk->header.prev = 0;
 
   /* Put the header of the obstack itself after the header of its first
@@ -59,6 +234,9 @@ marpa__obs_begin (size_t size)
   h = (struct marpa_obstack *)object_base;
   h->chunk = chunk;
   h->minimum_chunk_size = size;
+  h->total_chunk_size = size;
+  h->budget = NULL;
+  h->chunk_cache = NULL;
 
   /* Set the obstack to "idle" with the pointer just after the
      obstack header */
@@ -96,17 +274,58 @@ marpa__obs_newchunk (struct marpa_obstack *h, size_t length, size_t alignment)
   new_size = contents_offset + space_needed_for_alignment + length;
   new_size = MAX(new_size, h->minimum_chunk_size);
 
-  /* Allocate and initialize the new chunk.  */
-  new_chunk = my_malloc( new_size);
+  /* Take the new chunk from the cache if it is of the standard size,
+     and allocate and initialize it otherwise.  */
+  if (new_size == h->minimum_chunk_size && h->chunk_cache)
+    {
+      new_chunk = h->chunk_cache;
+      h->chunk_cache = new_chunk->header.prev;
+    }
+  else
+    {
+      new_chunk = chunk_alloc (&new_size);
+      h->total_chunk_size += new_size;
+      if (h->budget)
+        h->budget->used += new_size;
+    }
   h->chunk = new_chunk;
   new_chunk->header.prev = old_chunk;
-  new_chunk->header.size = new_size;
 
   h->object_base =  (char *)new_chunk + contents_offset + space_needed_for_alignment;
   h->next_free = h->object_base + length;
   return h->object_base;
 }
 
+/* Release everything in H allocated since MARK was taken.
+   Chunks of the standard size go to the cache.
+   Larger chunks, which were allocated for large objects,
+   are unlikely to be reused, and are freed.  */
+void
+marpa__obs_release_to (struct marpa_obstack *h, struct marpa_obstack_mark mark)
+{
+  struct marpa_obstack_chunk *lp = h->chunk;
+  while (lp != mark.chunk)
+    {
+      struct marpa_obstack_chunk *const plp = lp->header.prev;
+      const size_t size = lp->header.size;
+      if (size == h->minimum_chunk_size)
+        {
+          lp->header.prev = h->chunk_cache;
+          h->chunk_cache = lp;
+        }
+      else
+        {
+          h->total_chunk_size -= size;
+          if (h->budget)
+            h->budget->used -= size;
+          chunk_free (lp);
+        }
+      lp = plp;
+    }
+  h->chunk = mark.chunk;
+  h->next_free = h->object_base = mark.next_free;
+}
+
 /* Free everything in H.  */
 void
 marpa__obs_free (struct marpa_obstack *h)
@@ -116,11 +335,20 @@ marpa__obs_free (struct marpa_obstack *h)
 
   if (!h)
     return;                     /* Return safely if never initialized */
+  /* The cache goes first,
+     because the obstack header is in the first chunk.  */
+  lp = h->chunk_cache;
+  while (lp != 0)
+    {
+      plp = lp->header.prev;
+      chunk_free (lp);
+      lp = plp;
+    }
   lp = h->chunk;
   while (lp != 0)
     {
       plp = lp->header.prev;
-      my_free (lp);
+      chunk_free (lp);
       lp = plp;
     }
 }
@@ -64,12 +64,25 @@
    |next_free| == |object_base|, so the obstack is again "idle".
 */
 
+/* A memory budget, which may be shared by several obstacks.
+   The obstacks only keep |used| up to date.
+   It is up to the owner of the budget to check it against |limit|.
+*/
+struct marpa_obstack_budget
+{
+  size_t limit;                 /* 0 means no limit */
+  size_t used;
+};
+
 struct marpa_obstack    /* control current object in current chunk */
 {
   struct marpa_obstack_chunk *chunk;    /* address of current struct obstack_chunk */
   char *object_base;
   char *next_free;
   size_t minimum_chunk_size;              /* preferred size to allocate chunks in */
+  size_t total_chunk_size;                /* bytes in all chunks, for statistics */
+  struct marpa_obstack_budget *budget;    /* NULL if not budgeted */
+  struct marpa_obstack_chunk *chunk_cache;  /* released chunks, for reuse */
 };
 
 struct marpa_obstack_chunk_header               /* Lives at front of each chunk. */
@@ -85,12 +98,39 @@ struct marpa_obstack_chunk
   char contents[4];
 };
 
+/* A position in an obstack, to which it can later be released.
+   Everything allocated after the mark was taken is released with it.
+*/
+struct marpa_obstack_mark
+{
+  struct marpa_obstack_chunk *chunk;
+  char *next_free;
+};
+
 extern void* marpa__obs_newchunk (struct marpa_obstack *, size_t, size_t);
 
 extern struct marpa_obstack* marpa__obs_begin (size_t);
 
 void marpa__obs_free (struct marpa_obstack *__obstack);
 
+void marpa__obs_release_to (struct marpa_obstack *__obstack,
+                            struct marpa_obstack_mark mark);
+
+/* The chunk pool of the calling thread */
+int marpa__obs_pool_reserve (size_t size);
+void marpa__obs_pool_free (void);
+size_t marpa__obs_pool_size (void);
+size_t marpa__obs_pool_reuse_count (void);
+
+/* Charge all of the obstack's memory, present and future, to |budget| */
+static inline void
+marpa_obs_budget_attach (struct marpa_obstack *h,
+                         struct marpa_obstack_budget *budget)
+{
+  h->budget = budget;
+  budget->used += h->total_chunk_size;
+}
+
 /* Pointer to beginning of object being allocated or to be allocated next.
    Note that this might not be the final address of the object
    because a new chunk might be needed to hold the final size.  */
@@ -104,6 +144,29 @@ void marpa__obs_free (struct marpa_obstack *__obstack);
 
 # define marpa_obs_free(h)      (marpa__obs_free((h)))
 
+/* Total bytes malloc'ed for the obstack, including its header */
+# define marpa_obs_total_size(h) ((h)->total_chunk_size)
+
+/* Mark the current position of the obstack.
+   The obstack must be idle -- not building an object.  */
+static inline struct marpa_obstack_mark
+marpa_obs_mark (struct marpa_obstack *h)
+{
+  struct marpa_obstack_mark mark;
+  mark.chunk = h->chunk;
+  mark.next_free = h->next_free;
+  return mark;
+}
+
+/* Release everything allocated since |mark| was taken,
+   as if it never existed.
+   The chunks after the mark's are kept in a cache,
+   for reuse by the obstack,
+   so that they still count in its total size.
+   A mark is no longer valid once the obstack has been released
+   to an earlier mark.  */
+# define marpa_obs_release_to(h, mark) (marpa__obs_release_to((h), (mark)))
+
 /* Reject any object being built, as if it never existed */
 # define marpa_obs_reject(h) \
   ((h)->next_free = (h)->object_base)
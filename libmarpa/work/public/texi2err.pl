@@ -146,6 +146,14 @@ MARPA_ERR_INVALID_ASSERTION_ID
 MARPA_ERR_NO_SUCH_ASSERTION_ID
 MARPA_ERR_HEADERS_DO_NOT_MATCH
 MARPA_ERR_NOT_A_SEQUENCE
+MARPA_ERR_GRAMMAR_IS_FROZEN
+MARPA_ERR_MEMORY_BUDGET_EXCEEDED
+MARPA_ERR_INVALID_SNAPSHOT
+MARPA_ERR_INVALID_CHECKPOINT
+MARPA_ERR_EARLEY_SET_IS_LIVE
+MARPA_ERR_EARLEY_SET_RELEASED
+MARPA_ERR_INVALID_TASK_COUNT
+MARPA_ERR_RECCE_HAS_LAZY_BOCAGE
 );
 
 my %error_number = map { $error_codes[$_], $_ } (0 .. $#error_codes);